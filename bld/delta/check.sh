@@ -69,6 +69,11 @@ get_url() {
         echo "$fix://localhost:$(get_port "$fix")/test_pool"
         return 0
         ;;
+    tcpw)
+        # Plain tcp; only the server is different
+        echo "tcp://localhost:$(get_port "$fix")/test_pool"
+        return 0
+        ;;
     esac
 
     echo "yotest: get_url: Unknown test fixture '$fix'" >&2
@@ -0,0 +1,3 @@
+/* (c)  oblong industries */
+
+#include <libLoam/c++/ObHashMap.h>
@@ -0,0 +1,988 @@
+/* (c)  oblong industries */
+
+#ifndef OB_HASH_MAP_HAS_NO_LEGEND
+#define OB_HASH_MAP_HAS_NO_LEGEND
+
+
+#include <libLoam/c++/ObMap.h>
+#include <libLoam/c++/ObHasher.h>
+
+
+namespace oblong {
+namespace loam {
+
+
+/**
+ * A sibling of ObMap, with the same API, whose lookups by key are
+ * O(1) rather than O(n).  The entries (each an ObCons, as with
+ * ObMap) live side by side in a single ObTrove, rather than being
+ * allocated one at a time, and an open-addressing hash table (using
+ * \a HASHER, which is ObHasher by default, so anything ObHasher can
+ * hash, like Str and Slaw, will do) maps keys to their places in it.
+ *
+ * The differences from ObMap:
+ * - Removing an entry moves the last entry into its place, so that
+ *   removal is O(1) too.  Entries come out in the order they were
+ *   added only until something is removed.
+ * - A MapCons * is only good until the next Put or Remove (which may
+ *   move entries around), just like a pointer into a std::vector.
+ * - PutAtIndex, the sorts, and the CompactNull* functions have to
+ *   rebuild the hash table, so they're O(n).
+ * - Lookups by value (ConsFromVal, KeyFromVal, etc.) are still O(n).
+ */
+template <typename KEYType, typename VALType,
+          template <typename DUM1> class KEY_MEM_MGR_TAG = UnspecifiedMemMgmt,
+          template <typename DUM2> class VAL_MEM_MGR_TAG = UnspecifiedMemMgmt,
+          typename HASHER = ObHasher<KEYType>>
+class ObHashMap
+{
+/**
+ * \cond INTERNAL
+ */
+#include "OM_Helpy.h"
+  typedef OM_FUNCTIONARY::
+    Videlicet___<Helpy::key_to_be_wrapped, Helpy::val_to_be_wrapped,
+                 Helpy::key_is_contructorless, Helpy::val_is_contructorless,
+                 KEYType, VALType>
+      Viz;
+  /** \endcond */
+
+ public:
+  /**
+   * The type of an entry
+   */
+  typedef ObCons<KEYType, VALType, KEY_MEM_MGR_TAG, VAL_MEM_MGR_TAG> MapCons;
+
+  /**
+   * This can be passed to SetDupKeyBehavior() to make ObHashMap
+   * behave as a write-once map, a standard map, or a multimap.
+   */
+  enum Dup_Key_Behavior
+  {
+    Privilege_Earliest = 0,
+    Privilege_Latest = 1,
+    Allow_Duplicates = 2
+  };
+
+  typedef CrawlIterator<MapCons *, MapCons *> iterator;
+  typedef CrawlIterator<MapCons *, MapCons *> const_iterator;
+
+ OB_PRIVATE:
+  /**
+   * \cond INTERNAL
+   * A place in the hash table: which entry is there (or -1 if none),
+   * and its key's hash, so we rarely have to compare keys that don't
+   * match, and never have to hash anything twice.
+   */
+  struct Slot
+  {
+    int64 ind;
+    std::size_t hash;
+  };
+
+  ObTrove<MapCons> our_map;
+  Slot *slots;
+  int64 slot_count;  // always a power of two, or zero
+  HASHER hasher;
+  mutable KEYType null_k;
+  mutable VALType null_v;
+  Dup_Key_Behavior dup_key_behavior;
+
+  static const int64 MIN_SLOTS = 8;
+
+  MapCons *Entry (int64 ind) const { return &our_map.Nth (ind); }
+
+  /**
+   * Finds the slot for entry \a ind, whose key hashes to \a h.
+   */
+  int64 SlotForEntry (int64 ind, std::size_t h) const
+  {
+    const int64 mask = slot_count - 1;
+    int64 s = static_cast<int64> (h) & mask;
+    while (slots[s].ind != ind)
+      s = (s + 1) & mask;
+    return s;
+  }
+
+  /**
+   * Returns the index of an entry whose key is \a k, or -1.  When
+   * duplicates are allowed, returns the earliest such entry if
+   * \a latest is false, or the latest if it's true, just as ObMap's
+   * ConsFromKey and IndexForKey do.
+   */
+  int64 EntryForKey (KeyARGType k, bool latest) const
+  {
+    if (slot_count == 0)
+      return -1;
+    const std::size_t h = hasher (k);
+    const int64 mask = slot_count - 1;
+    int64 found = -1;
+    for (int64 s = static_cast<int64> (h) & mask; slots[s].ind >= 0;
+         s = (s + 1) & mask)
+      if (slots[s].hash == h && k == Entry (slots[s].ind)->Car ())
+        {
+          const int64 ind = slots[s].ind;
+          if (dup_key_behavior != Allow_Duplicates)
+            return ind;
+          if (found < 0 || (latest ? ind > found : ind < found))
+            found = ind;
+        }
+    return found;
+  }
+
+  void PlaceInSlot (int64 ind, std::size_t h)
+  {
+    const int64 mask = slot_count - 1;
+    int64 s = static_cast<int64> (h) & mask;
+    while (slots[s].ind >= 0)
+      s = (s + 1) & mask;
+    slots[s].ind = ind;
+    slots[s].hash = h;
+  }
+
+  /**
+   * Empties slot \a s, and moves any later slots in the same run
+   * back into the gap if that's closer to where they hash to, so
+   * that lookups never need to step over empty slots.
+   */
+  void VacateSlot (int64 s)
+  {
+    const int64 mask = slot_count - 1;
+    for (int64 t = (s + 1) & mask; slots[t].ind >= 0; t = (t + 1) & mask)
+      {
+        const int64 home = static_cast<int64> (slots[t].hash) & mask;
+        // can the one at t move back to s?  Only if its home isn't
+        // cyclically in (s, t].
+        if (((t - home) & mask) >= ((t - s) & mask))
+          {
+            slots[s] = slots[t];
+            s = t;
+          }
+      }
+    slots[s].ind = -1;
+  }
+
+  /**
+   * Makes room in the hash table for \a num entries, keeping it at
+   * most half full, and rebuilding it if it changes size or if
+   * \a force is true.
+   */
+  ObRetort Reindex (int64 num, bool force = false)
+  {
+    int64 want = (slot_count > 0 ? slot_count : MIN_SLOTS);
+    while (want < 2 * num)
+      want *= 2;
+    if (want != slot_count)
+      {
+        Slot *fresh = new (std::nothrow) Slot[want];
+        if (!fresh)
+          return OB_NO_MEM;
+        delete[] slots;
+        slots = fresh;
+        slot_count = want;
+      }
+    else if (!force)
+      return OB_OK;
+    for (int64 s = 0; s < slot_count; s++)
+      slots[s].ind = -1;
+    const int64 cnt = our_map.Count ();
+    for (int64 q = 0; q < cnt; q++)
+      PlaceInSlot (q, hasher (Entry (q)->Car ()));
+    return OB_OK;
+  }
+
+  ObRetort AppendEntry (KeyARGType k, ValARGType v)
+  {
+    const int64 cnt = our_map.Count ();
+    ObRetort tort = Reindex (cnt + 1);
+    if (tort.IsError ())
+      return tort;
+    if ((tort = our_map.Append (MapCons (k, v))).IsError ())
+      return tort;
+    PlaceInSlot (cnt, hasher (k));
+    return OB_OK;
+  }
+
+  /**
+   * Removes entry \a ind, moving the last entry into its place.
+   */
+  void RemoveEntry (int64 ind)
+  {
+    const int64 last = our_map.Count () - 1;
+    VacateSlot (SlotForEntry (ind, hasher (Entry (ind)->Car ())));
+    if (ind != last)
+      {
+        slots[SlotForEntry (last, hasher (Entry (last)->Car ()))].ind = ind;
+        our_map.SwapElemsAt (ind, last);
+      }
+    our_map.RemoveNth (last);
+  }
+
+  void CopyEntries (const ObHashMap &otha)
+  {
+    our_map = otha.our_map;
+    delete[] slots;
+    slots = NULL;
+    slot_count = 0;
+    if (otha.slot_count > 0
+        && (slots = new (std::nothrow) Slot[otha.slot_count]))
+      {
+        slot_count = otha.slot_count;
+        for (int64 s = 0; s < slot_count; s++)
+          slots[s] = otha.slots[s];
+      }
+    else
+      Reindex (our_map.Count (), true);
+  }
+  /** \endcond */
+
+ public:
+  /**
+   * Constructs a new ObHashMap with Privilege_Latest behavior.
+   */
+  ObHashMap ()
+      : slots (NULL),
+        slot_count (0),
+        null_k (Viz::keynullret ()),
+        null_v (Viz::valnullret ()),
+        dup_key_behavior (Privilege_Latest)
+  {
+  }
+
+  /**
+   * Create an empty map which grows geometrically, using \a multiplier.
+   */
+  explicit ObHashMap (float64 multiplier)
+      : our_map (multiplier),
+        slots (NULL),
+        slot_count (0),
+        null_k (Viz::keynullret ()),
+        null_v (Viz::valnullret ()),
+        dup_key_behavior (Privilege_Latest)
+  {
+  }
+
+  /**
+   * Copies the entries from \a otha, but the DupKeyBehavior()
+   * is not copied; it is set to Privilege_Latest.
+   */
+  ObHashMap (const ObHashMap &otha)
+      : slots (NULL),
+        slot_count (0),
+        null_k (Viz::keynullret ()),
+        null_v (Viz::valnullret ()),
+        dup_key_behavior (Privilege_Latest)
+  {
+    CopyEntries (otha);
+  }
+
+  /**
+   * Copies the entries from an ObMap, in order, as if by Put().
+   */
+  explicit ObHashMap (
+    const ObMap<KEYType, VALType, KEY_MEM_MGR_TAG, VAL_MEM_MGR_TAG> &otha)
+      : slots (NULL),
+        slot_count (0),
+        null_k (Viz::keynullret ()),
+        null_v (Viz::valnullret ()),
+        dup_key_behavior (Privilege_Latest)
+  {
+    const int64 cnt = otha.Count ();
+    EnsureRoomFor (cnt);
+    for (int64 q = 0; q < cnt; q++)
+      if (MapCons *mc = otha.NthCons (q))
+        Put (mc->Car (), mc->Cdr ());
+  }
+
+  /**
+   * Moves the entries from \a otha, and moves the DupKeyBehavior ().
+   */
+  ObHashMap (ObHashMap &&otha)
+      : our_map (std::move (otha.our_map)),
+        slots (otha.slots),
+        slot_count (otha.slot_count),
+        null_k (Viz::keynullret ()),
+        null_v (Viz::valnullret ()),
+        dup_key_behavior (otha.dup_key_behavior)
+  {
+    otha.slots = NULL;
+    otha.slot_count = 0;
+    otha.dup_key_behavior = Privilege_Latest;
+  }
+
+  ~ObHashMap () { delete[] slots; }
+
+  void Delete () { delete this; }
+
+
+  /**
+   * Returns the number of entries in the ObHashMap.
+   */
+  int64 Count () const { return our_map.Count (); }
+
+  /**
+   * Return the additive amount by which the map would grow if it
+   * were necessary (and if that amount exceeds the multiplicative
+   * growth's).
+   */
+  unt32 ArithmeticGrowthFactor () const
+  {
+    return our_map.ArithmeticGrowthFactor ();
+  }
+
+  /**
+   * Return the multiplicative factor by which the map will grow when
+   * necessary (and if that size exceeds the additive growth version).
+   */
+  float64 GeometricGrowthFactor () const
+  {
+    return our_map.GeometricGrowthFactor ();
+  }
+
+  /**
+   * Return the map's current capacity.
+   */
+  int64 Capacity () const { return our_map.Capacity (); }
+
+  /**
+   * Return the future capacity of the map (upon next enlargement).
+   */
+  int64 NextLargerCapacity () const { return our_map.NextLargerCapacity (); }
+
+  /**
+   * Configure how this map will expand; see ObMap::SetGrowthFactors().
+   * (The hash table always doubles.)
+   */
+  ObRetort SetGrowthFactors (unt32 arith_incr, float64 geom_mult = 1.0)
+  {
+    return our_map.SetGrowthFactors (arith_incr, geom_mult);
+  }
+
+  /**
+   * Make sure the map has room for at least \a num entries.
+   */
+  ObRetort EnsureRoomFor (int64 num)
+  {
+    ObRetort tort = our_map.EnsureRoomFor (num);
+    if (tort.IsError ())
+      return tort;
+    return Reindex (num);
+  }
+
+
+  /**
+   * Returns the Dup_Key_Behavior that was set with SetDupKeyBehavior().
+   */
+  Dup_Key_Behavior DupKeyBehavior () const { return dup_key_behavior; }
+
+  /**
+   * Changes the behavior of the ObHashMap to behave
+   * as a write-once map, a standard map, or a multimap.
+   */
+  void SetDupKeyBehavior (Dup_Key_Behavior dkb) { dup_key_behavior = dkb; }
+
+  /**
+   * Changes the behavior of the ObHashMap to behave as a write-once map.
+   */
+  void PrivilegeEarliest () { dup_key_behavior = Privilege_Earliest; }
+
+  /**
+   * Changes the behavior of the ObHashMap to behave as a standard map.
+   */
+  void PrivilegeLatest () { dup_key_behavior = Privilege_Latest; }
+
+  /**
+   * Changes the behavior of the ObHashMap to behave as a multimap.
+   */
+  void AllowDuplicates () { dup_key_behavior = Allow_Duplicates; }
+
+
+  /**
+   * Adds a new key-value pair to the ObHashMap.  If the key already
+   * exists, the behavior is dictated by DupKeyBehavior().
+   */
+  ObRetort Put (KeyARGType k, ValARGType v)
+  {
+    if (dup_key_behavior != Allow_Duplicates)
+      if (MapCons *mc = ConsFromKey (k))
+        {
+          if (dup_key_behavior == Privilege_Latest)
+            mc->SetCdr (v);
+          return OB_OK;
+        }
+    return AppendEntry (k, v);
+  }
+
+  /**
+   * Places a new key-value pair in the ObHashMap at index 'ind',
+   * just as ObMap::PutAtIndex() does.  This is O(n).
+   */
+  ObRetort PutAtIndex (KeyARGType k, ValARGType v, int64 ind)
+  {
+    int64 cnt = our_map.Count ();
+    if (ind < 0)
+      {
+        if (ind < -cnt)
+          ind = 0;
+        else
+          ind += cnt;
+      }
+    else if (ind > cnt)
+      ind = cnt;
+    ObRetort tort;
+    if (dup_key_behavior != Allow_Duplicates)
+      {
+        const int64 cur_ind = EntryForKey (k, false);
+        if (cur_ind >= 0)
+          {
+            if (dup_key_behavior == Privilege_Latest)
+              {
+                if (ind == cnt)
+                  ind = cnt - 1;
+                MapCons mc = *Entry (cur_ind);
+                mc.SetCdr (v);
+                our_map.RemoveNth (cur_ind);
+                our_map.Insert (mc, ind);
+                return Reindex (cnt, true);
+              }
+            return OB_OK;
+          }
+      }
+    if ((tort = our_map.Insert (MapCons (k, v), ind)).IsError ())
+      return tort;
+    return Reindex (cnt + 1, true);
+  }
+
+
+  /**
+   * returns the ordinal at which the key appears (or -1 if absent)
+   */
+  int64 IndexForKey (KeyARGType k) const { return EntryForKey (k, true); }
+
+  /**
+   * Returns true if \a k is a key in the ObHashMap.
+   */
+  bool KeyIsPresent (KeyARGType k) const { return (IndexForKey (k) >= 0); }
+  bool ContainsKey (KeyARGType k) const { return (IndexForKey (k) >= 0); }
+
+
+  /**
+   * returns the ordinal at which the val appears (or -1 if absent)
+   */
+  int64 IndexForVal (ValARGType v) const
+  {
+    for (int64 q = our_map.Count () - 1; q >= 0; q--)
+      if (v == Entry (q)->Cdr ())
+        return q;
+    return -1;
+  }
+
+  /**
+   * Returns true if \a v is a value in the ObHashMap.
+   */
+  bool ValIsPresent (ValARGType v) const { return (IndexForVal (v) >= 0); }
+  bool ContainsVal (ValARGType v) const { return (IndexForVal (v) >= 0); }
+
+
+  /**
+   * Looks up the key \a k in the map, and if it is present, returns the
+   * cons for that entry.
+   */
+  MapCons *ConsFromKey (KeyARGType k) const
+  {
+    const int64 ind = EntryForKey (k, false);
+    return (ind < 0 ? NULL : Entry (ind));
+  }
+
+  /**
+   * Looks up the value \a v in the map, and if it is present, returns the
+   * cons for that entry.
+   */
+  MapCons *ConsFromVal (ValARGType v) const
+  {
+    const int64 num = our_map.Count ();
+    for (int64 q = 0; q < num; q++)
+      if (v == Entry (q)->Cdr ())
+        return Entry (q);
+    return NULL;
+  }
+
+
+  /**
+   * Returns the \a n th entry of the map.
+   */
+  MapCons *NthCons (int64 n) const
+  {
+    const int64 cnt = our_map.Count ();
+    if (n < 0)
+      n += cnt;
+    return (n < 0 || n >= cnt ? NULL : Entry (n));
+  }
+
+  /**
+   * Returns the key (car) of the \a ind th entry of the map.
+   */
+  KeyACCESSType NthKey (int64 ind) const
+  {
+    if (MapCons *mc = NthCons (ind))
+      return mc->Car ();
+    return (null_k = Viz::keynullret ());
+  }
+
+  /**
+   * Returns the value (cdr) of the \a ind th entry of the map.
+   */
+  ValACCESSType NthVal (int64 ind) const
+  {
+    if (MapCons *mc = NthCons (ind))
+      return mc->Cdr ();
+    return (null_v = Viz::valnullret ());
+  }
+
+
+  /**
+   * If \a k is a key in the map, this will set \a v to the corresponding
+   * value and return OB_OK.  If not found, returns OB_NOT_FOUND.
+   */
+  ObRetort FillValFromKey (KeyARGType k, VALType &v) const
+  {
+    if (MapCons *mc = ConsFromKey (k))
+      {
+        v = mc->Cdr ();
+        return OB_OK;
+      }
+    return OB_NOT_FOUND;
+  }
+
+  /**
+   * If \a k is a key in the map, returns the corresponding
+   * value.  If not found, returns the "null value".
+   */
+  ValACCESSType ValFromKey (KeyARGType k) const
+  {
+    if (MapCons *mc = ConsFromKey (k))
+      return mc->Cdr ();
+    return (null_v = Viz::valnullret ());
+  }
+
+  /**
+   * Synonym for ValFromKey().
+   */
+  inline ValACCESSType Find (KeyARGType k) const { return ValFromKey (k); }
+
+
+  /**
+   * If \a v is a value in the map, sets \a k to the corresponding
+   * key and returns OB_OK.  If not found, returns OB_NOT_FOUND.
+   */
+  ObRetort FillKeyFromVal (ValARGType v, KEYType &k) const
+  {
+    if (MapCons *mc = ConsFromVal (v))
+      {
+        k = mc->Car ();
+        return OB_OK;
+      }
+    return OB_NOT_FOUND;
+  }
+
+  /**
+   * If \a v is a value in the map, returns the corresponding
+   * key.  If not found, returns the "null key".
+   */
+  KeyACCESSType KeyFromVal (ValARGType v) const
+  {
+    if (MapCons *mc = ConsFromVal (v))
+      return mc->Car ();
+    return (null_k = Viz::keynullret ());
+  }
+
+  /**
+   * If \a k is a key in the map, removes that entry and returns OB_OK.
+   * If not found, returns OB_NOT_FOUND.
+   */
+  ObRetort RemoveByKey (KeyARGType k)
+  {
+    const int64 ind = EntryForKey (k, false);
+    if (ind < 0)
+      return OB_NOT_FOUND;
+    RemoveEntry (ind);
+    return OB_OK;
+  }
+
+  /**
+   * Synonym for RemoveByKey().
+   */
+  inline ObRetort Remove (KeyARGType k) { return RemoveByKey (k); }
+
+
+  /**
+   * If \a v is a value in the map, removes that entry and returns OB_OK.
+   * If not found, returns OB_NOT_FOUND.
+   */
+  ObRetort RemoveByVal (ValARGType v)
+  {
+    const int64 num = our_map.Count ();
+    for (int64 q = 0; q < num; q++)
+      if (v == Entry (q)->Cdr ())
+        {
+          RemoveEntry (q);
+          return OB_OK;
+        }
+    return OB_NOT_FOUND;
+  }
+
+  /**
+   * Removes the \a ind th entry from the map.  Returns OB_OK if
+   * successful, or OB_BAD_INDEX if \a ind was out of range.
+   */
+  ObRetort RemoveNthCons (int64 ind)
+  {
+    const int64 cnt = our_map.Count ();
+    if (ind < 0)
+      ind += cnt;
+    if (ind < 0 || ind >= cnt)
+      return OB_BAD_INDEX;
+    RemoveEntry (ind);
+    return OB_OK;
+  }
+
+  /**
+   * Synonym for RemoveNthCons().
+   */
+  inline ObRetort RemoveNth (int64 ind) { return RemoveNthCons (ind); }
+
+
+  /**
+   * Removes any entries whose keys are null.
+   * Returns the number of entries removed, or -1 if the key
+   * type is not a pointer type.
+   */
+  int64 CompactNullKeys ()
+  {
+    if (!Helpy::key_is_pointy)
+      return -1;
+    int64 gone = 0;
+    for (int64 q = our_map.Count () - 1; q >= 0; q--)
+      if (!Entry (q)->Car ())
+        our_map.RemoveNth (q), gone++;
+    if (gone > 0)
+      Reindex (our_map.Count (), true);
+    return gone;
+  }
+
+  /**
+   * Removes any entries whose values are null.
+   * Returns the number of entries removed, or -1 if the value
+   * type is not a pointer type.
+   */
+  int64 CompactNullVals ()
+  {
+    if (!Helpy::val_is_pointy)
+      return -1;
+    int64 gone = 0;
+    for (int64 q = our_map.Count () - 1; q >= 0; q--)
+      if (!Entry (q)->Cdr ())
+        our_map.RemoveNth (q), gone++;
+    if (gone > 0)
+      Reindex (our_map.Count (), true);
+    return gone;
+  }
+
+  /**
+   * An ObHashMap never holds null entries, so there's nothing to do.
+   */
+  int64 CompactNulls () { return 0; }
+
+  /**
+   * Removes all entries from the map.
+   */
+  void Empty ()
+  {
+    our_map.Empty ();
+    for (int64 s = 0; s < slot_count; s++)
+      slots[s].ind = -1;
+  }
+
+
+  /**
+   * \cond INTERNAL
+   * Lets the comparators written for ObMap, which take a pair of
+   * MapCons *, sort our entries, which are MapCons.
+   */
+  template <typename CMPFUNQ>
+  struct ConsCmp
+  {
+    CMPFUNQ cmp;
+    ConsCmp (const CMPFUNQ &c) : cmp (c) {}
+    int operator() (MapCons &a, MapCons &b) const
+    {
+      MapCons *const pa = &a;
+      MapCons *const pb = &b;
+      return cmp (pa, pb);
+    }
+  };
+  template <typename CMPFUNQ>
+  struct KeyCmp
+  {
+    CMPFUNQ cmp;
+    KeyCmp (const CMPFUNQ &c) : cmp (c) {}
+    int operator() (MapCons &a, MapCons &b) const
+    {
+      return cmp (a.Car (), b.Car ());
+    }
+  };
+  template <typename CMPFUNQ>
+  struct ValCmp
+  {
+    CMPFUNQ cmp;
+    ValCmp (const CMPFUNQ &c) : cmp (c) {}
+    int operator() (MapCons &a, MapCons &b) const
+    {
+      return cmp (a.Cdr (), b.Cdr ());
+    }
+  };
+  /** \endcond */
+
+  /**
+   * Sorts the entries, just as ObMap::Sort() and friends do, with the
+   * same comparators; then rebuilds the hash table, which is O(n).
+   */
+  template <typename CMPFUNQ>
+  void Sort (CMPFUNQ cmp, int64 left = 0, int64 right = -1)
+  {
+    our_map.Sort (ConsCmp<CMPFUNQ> (cmp), left, right);
+    Reindex (our_map.Count (), true);
+  }
+
+  template <typename CMPFUNQ>
+  void Quicksort (CMPFUNQ cmp, int64 left = 0, int64 right = -1)
+  {
+    our_map.Quicksort (ConsCmp<CMPFUNQ> (cmp), left, right);
+    Reindex (our_map.Count (), true);
+  }
+
+  template <typename CMPFUNQ>
+  void SortByKey (CMPFUNQ cmp, int64 left = 0, int64 right = -1)
+  {
+    our_map.Sort (KeyCmp<CMPFUNQ> (cmp), left, right);
+    Reindex (our_map.Count (), true);
+  }
+
+  template <typename CMPFUNQ>
+  void QuicksortByKey (CMPFUNQ cmp, int64 left = 0, int64 right = -1)
+  {
+    our_map.Quicksort (KeyCmp<CMPFUNQ> (cmp), left, right);
+    Reindex (our_map.Count (), true);
+  }
+
+  template <typename CMPFUNQ>
+  void SortByVal (CMPFUNQ cmp, int64 left = 0, int64 right = -1)
+  {
+    our_map.Sort (ValCmp<CMPFUNQ> (cmp), left, right);
+    Reindex (our_map.Count (), true);
+  }
+
+  template <typename CMPFUNQ>
+  void QuicksortByVal (CMPFUNQ cmp, int64 left = 0, int64 right = -1)
+  {
+    our_map.Quicksort (ValCmp<CMPFUNQ> (cmp), left, right);
+    Reindex (our_map.Count (), true);
+  }
+
+
+  ObHashMap &operator= (const ObHashMap &otha)
+  {
+    if (this != &otha)
+      CopyEntries (otha);
+    return *this;
+  }
+
+  /**
+   * Sets this instance to have the exact same entries as
+   * \a otha.  However, the DupKeyBehavior() for this instance
+   * remains unchanged.
+   */
+  ObHashMap &CopyFrom (const ObHashMap &otha) { return (*this = otha); }
+
+  ObHashMap &operator= (ObHashMap &&otha) noexcept
+  {
+    if (this == &otha)
+      return *this;
+
+    our_map = std::move (otha.our_map);
+    std::swap (slots, otha.slots);
+    std::swap (slot_count, otha.slot_count);
+    dup_key_behavior = otha.dup_key_behavior;
+    otha.dup_key_behavior = Privilege_Latest;
+    otha.Empty ();
+
+    return *this;
+  }
+
+
+  /**
+   * \cond INTERNAL
+   * Crawls a range of our entries, handing out pointers to them.
+   */
+  class OC_HashConsGuts : public ObCrawl<MapCons *>::OC_Guts
+  {
+   OB_PRIVATE:
+    MapCons *f, *ff, *a, *aa;
+
+   public:
+    OC_HashConsGuts (MapCons *fr, MapCons *af)
+        : f (fr), ff (fr - 1), a (af - 1), aa (af)
+    {
+    }
+    OC_HashConsGuts (MapCons *eff, MapCons *effeff, MapCons *eigh,
+                     MapCons *eigheigh)
+        : f (eff), ff (effeff), a (eigh), aa (eigheigh)
+    {
+    }
+    bool IsEmpty () const override { return (f >= aa) || (a <= ff) || (f > a); }
+    MapCons *PopFore () override
+    {
+      assert (!IsEmpty ());
+      return f++;
+    }
+    MapCons *PopAft () override
+    {
+      assert (!IsEmpty ());
+      return a--;
+    }
+    MapCons *Fore () const override
+    {
+      assert (!IsEmpty ());
+      return f;
+    }
+    MapCons *Aft () const override
+    {
+      assert (!IsEmpty ());
+      return a;
+    }
+    void Reload () override
+    {
+      f = ff + 1;
+      a = aa - 1;
+    }
+    typename ObCrawl<MapCons *>::OC_Guts *Dup () const override
+    {
+      return new OC_HashConsGuts (f, ff, a, aa);
+    }
+  };
+
+ OB_PRIVATE:
+  OC_HashConsGuts *CrawlGuts () const
+  {
+    const int64 cnt = our_map.Count ();
+    return (cnt == 0 ? new OC_HashConsGuts (NULL, NULL)
+                     : new OC_HashConsGuts (Entry (0), Entry (0) + cnt));
+  }
+  /** \endcond */
+
+ public:
+  /**
+   * Returns an ObCrawl that iterates over the entries of this map.
+   */
+  ObCrawl<MapCons *> Crawl () const
+  {
+    return ObCrawl<MapCons *> (CrawlGuts ());
+  }
+
+  /**
+   * For compatibility with C++11 range-based for loop.  Beware that
+   * what is returned is not really a proper STL iterator; it is just
+   * good enough to make the for loop work.
+   */
+  const_iterator begin () const { return const_iterator (CrawlGuts ()); }
+
+  /**
+   * For compatibility with C++11 range-based for loop.
+   */
+  const_iterator end () const { return const_iterator (); }
+
+
+  /**
+   * \cond INTERNAL
+   */
+  class OC_MapKeyGuts : public ObCrawl<KEYType>::OC_Guts
+  {
+   OB_PRIVATE:
+    ObCrawl<MapCons *> cons_crawl;
+
+   public:
+    OC_MapKeyGuts (const ObHashMap *om) : cons_crawl (om->Crawl ()) {}
+    OC_MapKeyGuts (const ObCrawl<MapCons *> &other_crawl)
+        : cons_crawl (other_crawl)
+    {
+    }
+    bool IsEmpty () const override { return cons_crawl.isempty (); }
+    KeyCRAWLRetType PopFore () override
+    {
+      return cons_crawl.popfore ()->Car ();
+    }
+    KeyCRAWLRetType PopAft () override { return cons_crawl.popaft ()->Car (); }
+    KeyCRAWLRetType Fore () const override
+    {
+      return cons_crawl.fore ()->Car ();
+    }
+    KeyCRAWLRetType Aft () const override { return cons_crawl.aft ()->Car (); }
+    void Reload () override { cons_crawl.reload (); }
+    typename ObCrawl<KEYType>::OC_Guts *Dup () const override
+    {
+      return new OC_MapKeyGuts (cons_crawl);
+    }
+  };
+  /** \endcond */
+
+  /** Returns an ObCrawl that iterates over the keys of this map. */
+  ObCrawl<KEYType> CrawlKeys () const
+  {
+    return ObCrawl<KEYType> (new OC_MapKeyGuts (this));
+  }
+
+
+  /**
+   * \cond INTERNAL
+   */
+  class OC_MapValGuts : public ObCrawl<VALType>::OC_Guts
+  {
+   OB_PRIVATE:
+    ObCrawl<MapCons *> cons_crawl;
+
+   public:
+    OC_MapValGuts (const ObHashMap *om) : cons_crawl (om->Crawl ()) {}
+    OC_MapValGuts (const ObCrawl<MapCons *> &other_crawl)
+        : cons_crawl (other_crawl)
+    {
+    }
+    bool IsEmpty () const override { return cons_crawl.isempty (); }
+    ValCRAWLRetType PopFore () override
+    {
+      return cons_crawl.popfore ()->Cdr ();
+    }
+    ValCRAWLRetType PopAft () override { return cons_crawl.popaft ()->Cdr (); }
+    ValCRAWLRetType Fore () const override
+    {
+      return cons_crawl.fore ()->Cdr ();
+    }
+    ValCRAWLRetType Aft () const override { return cons_crawl.aft ()->Cdr (); }
+    void Reload () override { cons_crawl.reload (); }
+    typename ObCrawl<VALType>::OC_Guts *Dup () const override
+    {
+      return new OC_MapValGuts (cons_crawl);
+    }
+  };
+  /** \endcond */
+
+  /** Returns an ObCrawl that iterates over the values of this map. */
+  ObCrawl<VALType> CrawlVals () const
+  {
+    return ObCrawl<VALType> (new OC_MapValGuts (this));
+  }
+};
+}
+}  // end namespaces loam, oblong...
+
+
+#endif
@@ -6,6 +6,8 @@
 #include <unicode/utypes.h>
 #include <unicode/ucnv.h>
 #include <unicode/ustring.h>
+#include <unicode/locid.h>
+#include <unicode/uchar.h>
 
 #include <stdarg.h>
 #include <stdio.h>
@@ -62,7 +64,88 @@ static void Heinous_UTF8 (const char *str, long str_start, long char_start,
                        pos.utf8 (), val.utf8 (), caret.utf8 ());
 }
 
-static str_array Split_Like_Its_1972 (const char *u8, size_t len, char c)
+/* Byte offset of the first (or last) occurrence of needle in hay, or
+ * -1.  When both are valid utf8, a match can only start on a character
+ * boundary, so this finds the same occurrence ICU would. */
+static int64 Find_Bytes (const char *hay, int64 hay_len, const char *needle,
+                         int64 needle_len)
+{
+  if (needle_len < 1 || needle_len > hay_len)
+    return -1;
+  const char *p = hay, *last = hay + (hay_len - needle_len);
+  while (p <= last)
+    {
+      p = (const char *) memchr (p, needle[0], last - p + 1);
+      if (!p)
+        break;
+      if (!memcmp (p + 1, needle + 1, needle_len - 1))
+        return p - hay;
+      p++;
+    }
+  return -1;
+}
+
+static int64 Rfind_Bytes (const char *hay, int64 hay_len, const char *needle,
+                          int64 needle_len)
+{
+  if (needle_len < 1 || needle_len > hay_len)
+    return -1;
+  for (int64 i = hay_len - needle_len; i >= 0; i--)
+    if (hay[i] == needle[0] && !memcmp (hay + i, needle, needle_len))
+      return i;
+  return -1;
+}
+
+/* Number of characters in the first byte_len bytes of valid utf8,
+ * which is just the number of bytes that aren't continuation bytes. */
+static int64 Count_UTF8_Chars (const char *u8, int64 byte_len)
+{
+  int64 cnt = 0;
+  for (int64 i = 0; i < byte_len; i++)
+    if ((u8[i] & 0xc0) != 0x80)
+      cnt++;
+  return cnt;
+}
+
+/* Byte offset reached by moving forward n characters from byte offset
+ * idx in valid utf8, stopping at the end. */
+static int64 Skip_UTF8_Chars (const char *u8, int64 idx, int64 byte_len,
+                              int64 n)
+{
+  for (; n > 0 && idx < byte_len; n--)
+    do
+      idx++;
+    while (idx < byte_len && (u8[idx] & 0xc0) == 0x80);
+  return idx;
+}
+
+/* What UnicodeString::trim () considers whitespace */
+static inline bool Is_Trimmable (UChar32 c)
+{
+  return c == 0x20 || (c >= 0 && u_isWhitespace (c));
+}
+
+/* (deliberately not toupper () and tolower (), which heed the C locale) */
+static inline char ASCII_Upper (char c)
+{
+  return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+}
+
+static inline char ASCII_Lower (char c)
+{
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/* Upcasing and downcasing ASCII is just a matter of flipping a bit,
+ * except in Turkish and Azeri, where i and I aren't partners. */
+static bool ASCII_Casing_Is_Plain ()
+{
+  const char *lang = icu::Locale::getDefault ().getLanguage ();
+  return strcmp (lang, "tr") && strcmp (lang, "az");
+}
+
+static str_array Split_Like_Its_1972 (const char *u8, size_t len,
+                                      const char *sep, size_t sep_len)
 {
   str_array ret (2.0);
   ret.EnsureRoomFor (16);
@@ -70,8 +153,8 @@ static str_array Split_Like_Its_1972 (const char *u8, size_t len, char c)
 
   for (;;)
     {
-      const char *next = len ? (const char *) memchr (u8, c, len) : NULL;
-      if (next == NULL)
+      const int64 next = Find_Bytes (u8, len, sep, sep_len);
+      if (next < 0)
         {
           ret.Append (empty);
           ret.Nth (-1).Set (u8, len);
@@ -80,8 +163,8 @@ static str_array Split_Like_Its_1972 (const char *u8, size_t len, char c)
       else
         {
           ret.Append (empty);
-          ret.Nth (-1).Set (u8, next - u8);
-          size_t skip = 1 + (next - u8);
+          ret.Nth (-1).Set (u8, next);
+          size_t skip = sep_len + next;
           len -= skip;
           u8 += skip;
         }
@@ -94,6 +177,7 @@ void Str::_Init () noexcept
 {
   u8 = NULL;
   u8IsStale = true;
+  u8Kind = BYTES_UNSCANNED;
   u8ByteLength = u8ByteCapacity = 0;
   uString = NULL;
   uStringIsStale = true;
@@ -204,6 +288,7 @@ Str::Str (const UnicodeString &text)
     uStringIsStale = false;
   u8 = NULL;
   u8IsStale = true;
+  u8Kind = BYTES_UNSCANNED;
   u8ByteLength = u8ByteCapacity = 0;
   codePointLength = -1;
   match = NULL;
@@ -221,6 +306,7 @@ Str::Str (const UnicodeString &text, int64 start_marker, int64 length)
     uStringIsStale = false;
   u8 = NULL;
   u8IsStale = true;
+  u8Kind = BYTES_UNSCANNED;
   u8ByteLength = u8ByteCapacity = 0;
   codePointLength = -1;
   match = NULL;
@@ -230,6 +316,7 @@ Str::Str (const Str &text)
 {
   u8 = NULL;
   u8IsStale = true;
+  u8Kind = BYTES_UNSCANNED;
   uString = NULL;
   uStringIsStale = true;
   codePointLength = -1;
@@ -241,6 +328,7 @@ Str::Str (const Str &text)
 Str::Str (Str &&text) noexcept
     : u8 (text.u8),
       u8IsStale (text.u8IsStale),
+      u8Kind (text.u8Kind),
       u8ByteLength (text.u8ByteLength),
       u8ByteCapacity (text.u8ByteCapacity),
       uString (text.uString),
@@ -250,9 +338,16 @@ Str::Str (Str &&text) noexcept
 {
   if (match)
     match->SetBackPointer (this);
+  // a short string has to come along with us, rather than be pointed at
+  if (u8 == text.u8Inline)
+    {
+      memcpy (u8Inline, text.u8Inline, sizeof (u8Inline));
+      u8 = u8Inline;
+    }
 
   text.u8 = NULL;
   text.u8IsStale = true;
+  text.u8Kind = BYTES_UNSCANNED;
   text.u8ByteLength = 0;
   text.u8ByteCapacity = 0;
   text.uString = NULL;
@@ -274,6 +369,7 @@ Str::Str (const UChar32 code_point)
     uStringIsStale = false;
   u8 = NULL;
   u8IsStale = true;
+  u8Kind = BYTES_UNSCANNED;
   u8ByteLength = u8ByteCapacity = 0;
   codePointLength = -1;
   match = NULL;
@@ -303,6 +399,7 @@ Str &Str::operator= (Str &&text) noexcept
 
   swap (u8, text.u8);
   swap (u8IsStale, text.u8IsStale);
+  swap (u8Kind, text.u8Kind);
   swap (u8ByteLength, text.u8ByteLength);
   swap (u8ByteCapacity, text.u8ByteCapacity);
   swap (uString, text.uString);
@@ -312,13 +409,18 @@ Str &Str::operator= (Str &&text) noexcept
 
   if (match)
     match->SetBackPointer (this);
+  if (u8 == text.u8Inline)
+    {
+      memcpy (u8Inline, text.u8Inline, sizeof (u8Inline));
+      u8 = u8Inline;
+    }
 
   return *this;
 }
 
 Str::~Str ()
 {
-  free (u8);
+  _FreeU8 ();
   Del_Ptr (match);
   Del_Ptr (uString);
 }
@@ -344,8 +446,7 @@ Str &Str::Set (const char *text)
     _SetU8 (text, strlen (text));
   else
     {
-      free (u8);
-      u8 = NULL;
+      _FreeU8 ();
       u8IsStale = true;
     }
 
@@ -366,8 +467,7 @@ Str &Str::Set (const char *text, int64 length)
     _SetU8 (text, length);
   else
     {
-      free (u8);
-      u8 = NULL;
+      _FreeU8 ();
       u8IsStale = true;
     }
 
@@ -381,7 +481,7 @@ Str &Str::Set (const char *text, int64 length)
 
 Str &Str::Set (const UnicodeString &text)
 {
-  free (u8);
+  _FreeU8 ();
   Del_Ptr (match);
   if (uString)
     uString->setTo (text);
@@ -424,6 +524,21 @@ Str Str::VFormat (const char *format, va_list args)
 {
   char *strbuf = NULL;
   Str ret;
+
+  // Try it in the inline buffer first, since short results are common
+  va_list args2;
+  va_copy (args2, args);
+  const int len =
+    vsnprintf (ret.u8Inline, sizeof (ret.u8Inline), format, args2);
+  va_end (args2);
+  if (len >= 0 && len <= INLINE_CAPACITY)
+    {
+      ret.u8 = ret.u8Inline;
+      ret.u8ByteCapacity = INLINE_CAPACITY;
+      ret._SetU8Length (len);
+      return ret;
+    }
+
   if (vasprintf (&strbuf, format, args) < 0)
     OB_FATAL_BUG_CODE (0x11000000, "fatal: vasprintf of '%s' failed!\n",
                        format);
@@ -471,6 +586,9 @@ int64 Str::Length () const
     return codePointLength = uString->countChar32 ();
   else if (u8 && !u8IsStale)
     {
+      if (_ScanU8 () != BYTES_INVALID)
+        return codePointLength;
+      // (the scan is quiet about it, but this will say where)
       codePointLength = UTF8_Length (u8, 0, u8ByteLength);
       if (codePointLength < 0)
         {
@@ -507,6 +625,9 @@ UChar32 Str::At (int64 index) const
   if (index < 0 || index >= len)
     return 0;
 
+  if (u8 && !u8IsStale && _ScanU8 () == BYTES_ASCII)
+    return (unt8) u8[index];
+
   if (uString && !uStringIsStale)
     {
       int32 idx = uString->moveIndex32 (0, index);
@@ -543,6 +664,27 @@ Str Str::Slice (int64 index, int64 length) const
     index = Length () + index;
   if (length < 1)
     return Str ();
+
+  if (u8 && !u8IsStale && _ScanU8 () != BYTES_INVALID)
+    {
+      // no need to go through UTF-16 to count characters
+      if (index < 0)
+        index = 0;
+      length = (std::min) (length, u8ByteLength);
+      int64 idx, jdx;
+      if (u8Kind == BYTES_ASCII)
+        {
+          idx = (std::min) (index, u8ByteLength);
+          jdx = idx + (std::min) (length, u8ByteLength - idx);
+        }
+      else
+        {
+          idx = Skip_UTF8_Chars (u8, 0, u8ByteLength, index);
+          jdx = Skip_UTF8_Chars (u8, idx, u8ByteLength, length);
+        }
+      return Str (u8 + idx, jdx - idx);
+    }
+
   _FreshenUString ();
   int32 idx = uString->moveIndex32 (0, index);
   int32 jdx = uString->moveIndex32 (idx, length);
@@ -566,6 +708,32 @@ Str Str::Concat (const UChar32 code_point) const
 
 Str &Str::Append (const Str &other)
 {
+  // If both sides are already valid utf8, just glue the bytes together
+  if ((IsNull () || (u8 && !u8IsStale && _ScanU8 () != BYTES_INVALID))
+      && (other.IsNull ()
+          || (other.u8 && !other.u8IsStale
+              && other._ScanU8 () != BYTES_INVALID)))
+    {
+      const bool ascii = ((IsNull () || u8Kind == BYTES_ASCII)
+                          && (other.IsNull () || other.u8Kind == BYTES_ASCII));
+      const int64 chars = Length () + other.Length ();
+      const int64 len = IsNull () ? 0 : u8ByteLength;
+      const int64 olen = other.IsNull () ? 0 : other.u8ByteLength;
+      // grow geometrically, since Strs often get built up piece by piece
+      if (u8 && len + olen > u8ByteCapacity)
+        _EnsureU8Capacity ((std::max) (len + olen, 2 * u8ByteCapacity));
+      else
+        _EnsureU8Capacity (len + olen);
+      if (olen > 0)
+        memcpy (u8 + len, &other == this ? u8 : other.u8, olen);
+      _SetU8Length (len + olen);
+      u8Kind = ascii ? BYTES_ASCII : BYTES_UTF8;
+      uStringIsStale = true;
+      codePointLength = chars;
+      Match ();
+      return *this;
+    }
+
   _FreshenUString ();
   uString->append (other.ICUUnicodeString ());
   u8IsStale = true;
@@ -576,7 +744,14 @@ Str &Str::Append (const Str &other)
 
 Str &Str::Append (const UChar32 code_point)
 {
-  return Append (Str (code_point));
+  char buf[U8_MAX_LENGTH];
+  int32 len = 0;
+  UBool err = false;
+  U8_APPEND (buf, len, U8_MAX_LENGTH, code_point, err);
+  // (ICU would lose a NUL as utf8, so let it have that one as UTF-16)
+  if (err || code_point == 0)
+    return Append (Str (code_point));
+  return Append (Str (buf, len));
 }
 
 Str &Str::Insert (int64 index, const Str &other)
@@ -610,6 +785,19 @@ int Str::Compare (const Str &other) const
   if (other.IsNull ())
     return 1;
 
+  // For valid utf8, byte order is code point order
+  if (!u8IsStale && !other.u8IsStale && _ScanU8 () != BYTES_INVALID
+      && other._ScanU8 () != BYTES_INVALID)
+    {
+      const int64 len = (std::min) (u8ByteLength, other.u8ByteLength);
+      const int cmp = memcmp (u8, other.u8, len);
+      if (cmp)
+        return (cmp < 0) ? -1 : 1;
+      if (u8ByteLength == other.u8ByteLength)
+        return 0;
+      return (u8ByteLength < other.u8ByteLength) ? -1 : 1;
+    }
+
   _FreshenUString ();
   return uString->compareCodePointOrder (other.ICUUnicodeString ());
 }
@@ -623,6 +811,24 @@ int Str::CaseCmp (const Str &other) const
       else
         return -1;
     }
+
+  // Case folding ASCII can't change its length, or take it out of ASCII
+  if (!u8IsStale && !other.u8IsStale && other.u8
+      && _ScanU8 () == BYTES_ASCII && other._ScanU8 () == BYTES_ASCII)
+    {
+      const int64 len = (std::min) (u8ByteLength, other.u8ByteLength);
+      for (int64 i = 0; i < len; i++)
+        {
+          const unt8 a = ASCII_Lower (u8[i]);
+          const unt8 b = ASCII_Lower (other.u8[i]);
+          if (a != b)
+            return (a < b) ? -1 : 1;
+        }
+      if (u8ByteLength == other.u8ByteLength)
+        return 0;
+      return (u8ByteLength < other.u8ByteLength) ? -1 : 1;
+    }
+
   _FreshenUString ();
   return uString->caseCompare (other.ICUUnicodeString (),
                                U_COMPARE_CODE_POINT_ORDER);
@@ -670,6 +876,16 @@ Str oblong::loam::operator+ (const char *str_c, const Str &str)
 
 Str &Str::Upcase ()
 {
+  if (u8 && !u8IsStale && _ScanU8 () == BYTES_ASCII
+      && ASCII_Casing_Is_Plain ())
+    {
+      for (int64 i = 0; i < u8ByteLength; i++)
+        u8[i] = ASCII_Upper (u8[i]);
+      uStringIsStale = true;
+      Match ();
+      return *this;
+    }
+
   _FreshenUString ();
   uString->toUpper ();
   u8IsStale = true;
@@ -681,6 +897,16 @@ Str &Str::Upcase ()
 
 Str &Str::Downcase ()
 {
+  if (u8 && !u8IsStale && _ScanU8 () == BYTES_ASCII
+      && ASCII_Casing_Is_Plain ())
+    {
+      for (int64 i = 0; i < u8ByteLength; i++)
+        u8[i] = ASCII_Lower (u8[i]);
+      uStringIsStale = true;
+      Match ();
+      return *this;
+    }
+
   _FreshenUString ();
   uString->toLower ();
   u8IsStale = true;
@@ -692,6 +918,33 @@ Str &Str::Downcase ()
 
 Str &Str::Strip ()
 {
+  if (u8 && !u8IsStale && _ScanU8 () != BYTES_INVALID)
+    {
+      int32 first = 0, last = u8ByteLength, i;
+      UChar32 c;
+      for (i = last; i > first; last = i)
+        {
+          U8_PREV (u8, first, i, c);
+          if (!Is_Trimmable (c))
+            break;
+        }
+      for (i = first; i < last; first = i)
+        {
+          U8_NEXT (u8, i, last, c);
+          if (!Is_Trimmable (c))
+            break;
+        }
+      if (first > 0 || last < u8ByteLength)
+        {
+          memmove (u8, u8 + first, last - first);
+          _SetU8Length (last - first);
+          uStringIsStale = true;
+          codePointLength = -1;
+        }
+      Match ();
+      return *this;
+    }
+
   _FreshenUString ();
   uString->trim ();
   u8IsStale = true;
@@ -702,6 +955,21 @@ Str &Str::Strip ()
 
 Str &Str::Chomp (const Str &separator)
 {
+  if (u8 && !u8IsStale && separator.u8 && !separator.u8IsStale
+      && _ScanU8 () != BYTES_INVALID && separator._ScanU8 () != BYTES_INVALID)
+    {
+      const int64 len = u8ByteLength - separator.u8ByteLength;
+      if (len >= 0 && separator.u8ByteLength > 0
+          && !memcmp (u8 + len, separator.u8, separator.u8ByteLength))
+        {
+          _SetU8Length (len);
+          uStringIsStale = true;
+          codePointLength = -1;
+        }
+      Match ();
+      return *this;
+    }
+
   _FreshenUString ();
   UnicodeString sep (separator.ICUUnicodeString ());
   if (uString->endsWith (sep))
@@ -750,6 +1018,15 @@ int64 Str::Index (const Str &substring) const
 {
   if (IsNull ())
     return -1;
+  if (!u8IsStale && !substring.u8IsStale && substring.u8
+      && _ScanU8 () != BYTES_INVALID && substring._ScanU8 () != BYTES_INVALID)
+    {
+      const int64 b = Find_Bytes (u8, u8ByteLength, substring.u8,
+                                  substring.u8ByteLength);
+      if (b < 0 || u8Kind == BYTES_ASCII)
+        return b;
+      return Count_UTF8_Chars (u8, b);
+    }
   _FreshenUString ();
   return _CodeUnitIndexToCodePointIndex (
     uString->indexOf (substring.ICUUnicodeString ()));
@@ -759,6 +1036,15 @@ int64 Str::Rindex (const Str &substring) const
 {
   if (IsNull ())
     return -1;
+  if (!u8IsStale && !substring.u8IsStale && substring.u8
+      && _ScanU8 () != BYTES_INVALID && substring._ScanU8 () != BYTES_INVALID)
+    {
+      const int64 b = Rfind_Bytes (u8, u8ByteLength, substring.u8,
+                                   substring.u8ByteLength);
+      if (b < 0 || u8Kind == BYTES_ASCII)
+        return b;
+      return Count_UTF8_Chars (u8, b);
+    }
   _FreshenUString ();
   return _CodeUnitIndexToCodePointIndex (
     uString->lastIndexOf (substring.ICUUnicodeString ()));
@@ -1004,14 +1290,26 @@ str_array Str::Split (const Str &pattern) const
                       | METACHAR ('[') | METACHAR ('(') | METACHAR (')')
                       | METACHAR ('^') | METACHAR ('$') | METACHAR ('\\')
                       | METACHAR ('.');
-  char c;
 
-  // optimize for the common case
-  if (!u8IsStale && pattern.u8 && !pattern.u8IsStale  // u8 not stale
-      && pattern.u8ByteLength == 1                    // one-char pattern
-      && (c = pattern.u8[0]) != 0 && c < '{'          // not a metacharacter
-      && (c < ' ' || c > '^' || 0 == (1 & (metas >> (c - ' ')))))
-    return Split_Like_Its_1972 (u8, u8ByteLength, c);
+  // optimize for the common case, where the pattern is just a delimiter
+  // (any single byte will do, but longer ones need to be valid utf8 and
+  // be looked for in valid utf8, to be sure of finding what ICU would)
+  bool literal = (!u8IsStale && pattern.u8 && !pattern.u8IsStale  // u8 fresh
+                  && (pattern.u8ByteLength == 1
+                      || (pattern.u8ByteLength > 1
+                          && pattern._ScanU8 () != BYTES_INVALID
+                          && _ScanU8 () != BYTES_INVALID)));
+  for (int64 i = 0; literal && i < pattern.u8ByteLength; i++)
+    {
+      const unt8 c = pattern.u8[i];
+      literal = (c >= 0x80                 // part of a non-ASCII character
+                 || (c != 0 && c < '{'     // or not a metacharacter
+                     && (c < ' ' || c > '^'
+                         || 0 == (1 & (metas >> (c - ' '))))));
+    }
+  if (literal)
+    return Split_Like_Its_1972 (u8, u8ByteLength, pattern.u8,
+                                pattern.u8ByteLength);
 
   StrMatchData m (const_cast<Str *> (this), pattern);
   if (m.IsInError ())
@@ -1033,7 +1331,8 @@ void Str::_FreshenUString () const
     {
       if (uString)
         delete uString;
-      uString = new UnicodeString (u8, "UTF-8");
+      // (fromUTF8 is much quicker than going through a "UTF-8" converter)
+      uString = new UnicodeString (UnicodeString::fromUTF8 (u8));
       if (!uString->isBogus ())
         uStringIsStale = false;
     }
@@ -1241,9 +1540,12 @@ int64 Str::UTF8_Length (const char *str, int64 index, int64 byte_length)
 void Str::_CopyFieldsIntoThis (const Str &to_copy)
 {
   if ((u8IsStale = to_copy.u8IsStale) || to_copy.u8 == NULL)
-    Free_Ptr (u8);
+    _FreeU8 ();
   else
-    _SetU8 (to_copy.u8, to_copy.u8ByteLength);
+    {
+      _SetU8 (to_copy.u8, to_copy.u8ByteLength);
+      u8Kind = to_copy.u8Kind;
+    }
 
   if ((uStringIsStale = to_copy.uStringIsStale))
     uString = NULL;
@@ -1263,11 +1565,26 @@ void Str::_CopyMatchDataIntoThis (const Str &to_copy)
 
 void Str::_EnsureU8Capacity (int64 capacity)
 {
-  if (!u8)
+  if (!u8 && capacity <= INLINE_CAPACITY)
+    {
+      u8 = u8Inline;
+      u8ByteCapacity = INLINE_CAPACITY;
+    }
+  else if (!u8)
     {
       u8 = (char *) malloc (1 + capacity);
       u8ByteCapacity = capacity;
     }
+  else if (capacity > u8ByteCapacity && u8 == u8Inline)
+    {
+      char *r = (char *) malloc (1 + capacity);
+      if (r)
+        {
+          memcpy (r, u8Inline, sizeof (u8Inline));
+          u8 = r;
+          u8ByteCapacity = capacity;
+        }
+    }
   else if (capacity > u8ByteCapacity)
     {
       char *r = (char *) realloc (u8, 1 + capacity);
@@ -1288,6 +1605,7 @@ void Str::_SetU8Length (int64 length)
   u8[length] = 0;
   u8ByteLength = length;
   u8IsStale = false;
+  u8Kind = BYTES_UNSCANNED;
 }
 
 void Str::_SetU8 (const char *str, int64 length)
@@ -1297,6 +1615,41 @@ void Str::_SetU8 (const char *str, int64 length)
   _SetU8Length (length);
 }
 
+void Str::_FreeU8 ()
+{
+  if (u8 != u8Inline)
+    free (u8);
+  u8 = NULL;
+  u8ByteCapacity = 0;
+}
+
+int8 Str::_ScanU8 () const
+{
+  if (u8Kind != BYTES_UNSCANNED)
+    return u8Kind;
+
+  int32 i = 0;
+  while (i < u8ByteLength && (unt8) u8[i] < 0x80)
+    i++;
+  if (i == u8ByteLength)
+    {
+      codePointLength = u8ByteLength;
+      return u8Kind = BYTES_ASCII;
+    }
+
+  int64 cnt = i;
+  UChar32 chr;
+  while (i < u8ByteLength)
+    {
+      U8_NEXT (u8, i, u8ByteLength, chr);
+      if (chr < 0)
+        return u8Kind = BYTES_INVALID;
+      ++cnt;
+    }
+  codePointLength = cnt;
+  return u8Kind = BYTES_UTF8;
+}
+
 unt64 Str::Hash () const
 {
   if (IsNull ())
@@ -62,6 +62,14 @@ struct StrRange
  * The Str class depends heavily on the ICU library for internal
  * unicode support:  http://site.icu-project.org/
  *
+ * That said, Str keeps its text as utf8, and the everyday operations
+ * -- comparison, hashing, searching, slicing, appending, trimming,
+ * splitting on a plain delimiter, and case conversion of ASCII text --
+ * work on those bytes directly, only handing off to ICU when the text
+ * calls for genuinely unicode-aware treatment.  Short strings (up to 23
+ * bytes of utf8) are stored inside the Str object itself, so making and
+ * copying them never touches the heap.
+ *
  * Users of the Str API need not worry about ICU unless (a) they are
  * interested in compatibility with other APIs using ICU (b) they
  * have relatively unusual and complex unicode processing needs, such
@@ -145,9 +153,13 @@ class OB_LOAMXX_API Str
  OB_PRIVATE:
   mutable char *u8;
   mutable bool u8IsStale;
+  // what _ScanU8 () has found out about the bytes in u8 (one of the
+  // BYTES_ values below); only meaningful while u8 isn't stale
+  mutable int8 u8Kind;
   // length without terminating NUL (i. e. u8ByteLength = strlen (u8))
   mutable int64 u8ByteLength;
-  // capacity without terminating NUL (so u8 = malloc (u8ByteCapacity + 1))
+  // capacity without terminating NUL (so u8 = malloc (u8ByteCapacity + 1),
+  // unless u8 = u8Inline)
   mutable int64 u8ByteCapacity;
 
   mutable UnicodeString *uString;
@@ -157,6 +169,19 @@ class OB_LOAMXX_API Str
 
   StrMatchData *match;
 
+  // utf8 this short (in bytes, not counting the NUL) lives right here
+  // in u8Inline, with u8 pointing at it, instead of on the heap
+  static const int64 INLINE_CAPACITY = 23;
+  char u8Inline[INLINE_CAPACITY + 1];
+
+  enum
+  {
+    BYTES_UNSCANNED,
+    BYTES_ASCII,
+    BYTES_UTF8,
+    BYTES_INVALID
+  };
+
  public:
   typedef StrIterator iterator;
 
@@ -630,16 +655,14 @@ class OB_LOAMXX_API Str
    * literally, they must be escaped with a backslash:
    * http://www.regular-expressions.info/characters.html#special
    *
-   * Since Str offers no interface for precompiling regular
-   * expressions the way many regular expression libraries do, the
-   * regular expression must be recompiled every time Split() is
-   * called.  Furthermore, since the str_array is passed by value, and
-   * the Strs within it are contained by value, that means that the
-   * result Strs will be copied multiple times on the return path, and
-   * since Str does not implement either reference counting or the
-   * short string optimization, copying Strs is expensive.  For
-   * example, a typical Split may take 18 microseconds, which might be
-   * too slow for use in tight loops.
+   * A pattern with no metacharacters in it at all is just a
+   * delimiter, and Split() looks for it directly in the utf8, which is
+   * quick.  Otherwise, since Str offers no interface for precompiling
+   * regular expressions the way many regular expression libraries do,
+   * the regular expression must be recompiled every time Split() is
+   * called.  For example, a typical Split on a regular expression may
+   * take several microseconds, which might be too slow for use in
+   * tight loops.
    */
   str_array Split (const Str &pattern) const;
 
@@ -729,6 +752,11 @@ class OB_LOAMXX_API Str
   // combines _EnsureU8Capacity, memcpy, and _SetU8Length into one
   // convenient operation.
   void _SetU8 (const char *str, int64 length);
+  // frees u8 (unless it's u8Inline) and leaves it NULL
+  void _FreeU8 ();
+  // classifies u8 as ASCII, valid utf8, or neither (filling in
+  // codePointLength along the way, when it can), and remembers that
+  int8 _ScanU8 () const;
   void _FreshenUString () const;
   void _FreshenU8 () const;
   void _CopyFieldsIntoThis (const Str &to_copy);
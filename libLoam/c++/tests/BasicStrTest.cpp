@@ -10,8 +10,10 @@
 
 #include <gtest/gtest.h>
 #include <libLoam/c++/Str.h>
+#include <unicode/locid.h>
 #include <unicode/unistr.h>
 
+#include <string>
 #include <unordered_map>
 
 #include <type_traits>
@@ -1060,6 +1062,209 @@ TEST_F (BasicStrTest, SingleCharSplit)
     }
 }
 
+// Either side of the most utf8 a Str keeps inside itself
+TEST_F (BasicStrTest, InlineBoundary)
+{
+  for (int len = 20; len <= 28; len++)
+    {
+      SCOPED_TRACE (len);
+      std::string bytes;
+      for (int i = 0; i < len; i++)
+        bytes += (char) ('a' + i % 26);
+      // and once more with a two-byte character at the end
+      for (int pass = 0; pass < 2; pass++)
+        {
+          if (pass == 1)
+            bytes.replace (len - 2, 2, "\303\251");
+          const Str s (bytes.c_str ());
+          EXPECT_EQ (len, s.ByteLength ());
+          EXPECT_EQ (len - pass, s.Length ());
+
+          Str copy (s);
+          EXPECT_STREQ (bytes.c_str (), copy);
+          EXPECT_NE (s.utf8 (), copy.utf8 ());
+          copy.Append ("!");
+          EXPECT_STREQ (bytes.c_str (), s);
+
+          Str assigned ("x");
+          assigned = s;
+          EXPECT_STREQ (bytes.c_str (), assigned);
+          EXPECT_NE (s.utf8 (), assigned.utf8 ());
+
+          Str moved (std::move (assigned));
+          EXPECT_STREQ (bytes.c_str (), moved);
+          EXPECT_EQ (len - pass, moved.Length ());
+
+          Str move_assigned ("something else entirely, and long");
+          move_assigned = std::move (moved);
+          EXPECT_STREQ (bytes.c_str (), move_assigned);
+          EXPECT_EQ (s, move_assigned);
+          EXPECT_EQ (s.Hash (), move_assigned.Hash ());
+
+          Str short_one ("y");
+          short_one = std::move (move_assigned);
+          EXPECT_STREQ (bytes.c_str (), short_one);
+        }
+    }
+}
+
+TEST_F (BasicStrTest, AppendPastInline)
+{
+  Str s ("0123456789");
+  std::string expected ("0123456789");
+  for (int i = 0; i < 40; i++)
+    {
+      SCOPED_TRACE (i);
+      const char *more =
+        (i % 3 == 0 ? "abc" : i % 3 == 1 ? "\342\206\222" : "d");
+      s.Append (more);
+      expected += more;
+      EXPECT_STREQ (expected.c_str (), s);
+      EXPECT_EQ ((int64) expected.size (), s.ByteLength ());
+    }
+
+  // Code points, one at a time, across the edge
+  Str t ("01234567890123456789a");
+  t.Append (0xe9);
+  EXPECT_STREQ ("01234567890123456789a\303\251", t);
+  t.Append (0x1d540);
+  EXPECT_STREQ ("01234567890123456789a\303\251\360\235\225\200", t);
+  EXPECT_EQ (23, t.Length ());
+
+  // Appending a Str to itself, while it moves off to the heap
+  Str u ("twelve bytes");
+  u.Append (u);
+  EXPECT_STREQ ("twelve bytestwelve bytes", u);
+  u.Append (u);
+  EXPECT_STREQ ("twelve bytestwelve bytestwelve bytestwelve bytes", u);
+}
+
+// Splitting on a plain delimiter doesn't use a regular expression; it
+// had better split the same way one would.
+TEST_F (BasicStrTest, DelimiterSplitMatchesRegexp)
+{
+  static const char *const cases[][2] = {
+    {"a\342\206\222b\342\206\222\342\206\222c\342\206\222", "\342\206\222"},
+    {"\342\206\222a\342\206\222b", "\342\206\222"},
+    {"x, y, z, , ", ", "},
+    {"\316\261\316\262::\316\263::::\316\264", "::"},
+    {"na\303\257ve caf\303\251 na\303\257ve", "\303\251"},
+    {"na\303\257ve caf\303\251 na\303\257ve", "na\303\257"},
+    {"\344\270\200\343\200\201\344\272\214\343\200\201\344\270\211",
+     "\343\200\201"},
+    {"no delimiter here", "\342\206\222"},
+    {"\342\206\222", "\342\206\222"},
+  };
+  for (size_t i = 0; i < sizeof (cases) / sizeof (cases[0]); i++)
+    {
+      SCOPED_TRACE (i);
+      const Str s (cases[i][0]);
+      const Str delim (cases[i][1]);
+      str_array plain = s.Split (delim);
+      str_array regexp = s.Split (Str ("(?:") + delim + ")");
+      ASSERT_EQ (regexp.Count (), plain.Count ());
+      for (int64 j = 0; j < plain.Count (); j++)
+        {
+          SCOPED_TRACE (j);
+          EXPECT_STREQ (regexp.Nth (j), plain.Nth (j));
+        }
+    }
+}
+
+TEST_F (BasicStrTest, IndexAndSliceMixed)
+{
+  // a b é c d → e f 𝕀 g h
+  const Str s ("ab\303\251cd\342\206\222ef\360\235\225\200gh");
+  const icu::UnicodeString us (s.ICUUnicodeString ());
+  EXPECT_EQ (11, s.Length ());
+  EXPECT_EQ (0xe9, s.At (2));
+  EXPECT_EQ (0x2192, s.At (5));
+  EXPECT_EQ (0x1d540, s.At (8));
+  EXPECT_EQ ('h', s.At (10));
+
+  EXPECT_EQ (2, s.Index ("\303\251"));
+  EXPECT_EQ (3, s.Index ("cd"));
+  EXPECT_EQ (5, s.Index ("\342\206\222e"));
+  EXPECT_EQ (9, s.Index ("g"));
+  EXPECT_EQ (-1, s.Index ("\303\251\303\251"));
+  EXPECT_EQ (9, s.Rindex ("gh"));
+
+  const Str twice = s + s;
+  EXPECT_EQ (2, twice.Index ("\303\251"));
+  EXPECT_EQ (13, twice.Rindex ("\303\251"));
+  EXPECT_EQ (19, twice.Rindex ("\360\235\225\200"));
+
+  // (a zero-length Slice is null, not empty, so leave that out)
+  for (int64 start = 0; start < s.Length (); start++)
+    for (int64 len = 1; start + len <= s.Length (); len++)
+      {
+        SCOPED_TRACE (start);
+        SCOPED_TRACE (len);
+        const Str slice = s.Slice (start, len);
+        EXPECT_EQ (len, slice.Length ());
+        // ICU counts the 𝕀 as two
+        const int32 ustart = us.moveIndex32 (0, (int32) start);
+        const int32 ulen = us.moveIndex32 (ustart, (int32) len) - ustart;
+        EXPECT_EQ (Str (icu::UnicodeString (us, ustart, ulen)), slice);
+      }
+  EXPECT_STREQ ("\360\235\225\200gh", s.Slice (8));
+}
+
+TEST_F (BasicStrTest, InvalidUTF8Operations)
+{
+  ob_suppress_message (OBLV_WARN, 0x11000004);
+
+  // A stray continuation byte, and a lead byte with nothing after it
+  static const char bad[] = "ab\200cd \303\251f\303";
+  const Str s (bad);
+  // ICU's idea of what that says
+  const Str fixed (icu::UnicodeString::fromUTF8 (bad));
+  EXPECT_EQ (fixed.Length (), s.Length ());
+  for (int64 i = 0; i < fixed.Length (); i++)
+    EXPECT_EQ (fixed.At (i), s.At (i));
+  EXPECT_EQ (fixed.Index ("cd"), s.Index ("cd"));
+  EXPECT_EQ (fixed.Rindex ("\303\251"), s.Rindex ("\303\251"));
+  EXPECT_EQ (fixed.Slice (1, 4), s.Slice (1, 4));
+  EXPECT_EQ (fixed.Dup ().Upcase (), s.Dup ().Upcase ());
+  EXPECT_EQ (fixed.Dup ().Downcase (), s.Dup ().Downcase ());
+
+  str_array a = s.Split (" ");
+  str_array b = fixed.Split (" ");
+  ASSERT_EQ (b.Count (), a.Count ());
+  for (int64 j = 0; j < a.Count (); j++)
+    EXPECT_EQ (b.Nth (j), a.Nth (j));
+
+  Str appended (s);
+  appended.Append ("g");
+  EXPECT_EQ (Str (fixed).Append ("g"), appended);
+}
+
+// Turkish has its own ideas about dotted and dotless i
+TEST_F (BasicStrTest, CaseInTurkish)
+{
+  UErrorCode status = U_ZERO_ERROR;
+  const icu::Locale previous (icu::Locale::getDefault ());
+  icu::Locale::setDefault (icu::Locale ("tr"), status);
+  ASSERT_TRUE (U_SUCCESS (status));
+
+  static const char *const words[] = {"istanbul", "DIYARBAKIR", "Izmir",
+                                      "ascii only", "\304\260\304\261iI"};
+  for (size_t i = 0; i < sizeof (words) / sizeof (words[0]); i++)
+    {
+      SCOPED_TRACE (words[i]);
+      const icu::UnicodeString u (icu::UnicodeString::fromUTF8 (words[i]));
+      EXPECT_EQ (Str (icu::UnicodeString (u).toUpper (icu::Locale ("tr"))),
+                 Str (words[i]).Upcase ());
+      EXPECT_EQ (Str (icu::UnicodeString (u).toLower (icu::Locale ("tr"))),
+                 Str (words[i]).Downcase ());
+    }
+  EXPECT_STREQ ("\304\260STANBUL", Str ("istanbul").Upcase ());
+  EXPECT_STREQ ("d\304\261yarbak\304\261r", Str ("DIYARBAKIR").Downcase ());
+
+  icu::Locale::setDefault (previous, status);
+  EXPECT_STREQ ("ISTANBUL", Str ("istanbul").Upcase ());
+}
+
 #if defined __linux__ && U_ICU_VERSION_MAJOR_NUM >= 60
 TEST_F (BasicStrTest, Char16)
 {
@@ -0,0 +1,199 @@
+/* (c)  oblong industries */
+
+#include <gtest/gtest.h>
+#include "libLoam/c/ob-rand.h"
+#include "libLoam/c++/LoamStreams.h"
+#include "libLoam/c++/ObHashMap.h"
+#include "libLoam/c++/Str.h"
+
+using namespace oblong::loam;
+
+static int livecount = 0;
+class Dorf : public AnkleObject
+{
+  PATELLA_SUBCLASS (Dorf, AnkleObject);
+
+ public:
+  Str s;
+  Dorf (Str s_) : s (s_) { livecount++; }
+  ~Dorf () { livecount--; }
+};
+
+static int int_cmp (const int64 &a, const int64 &b)
+{
+  return (a < b ? -1 : a > b ? 1 : 0);
+}
+
+TEST (ObHashMapTest, PutFindRemove)
+{
+  ObHashMap<int64, int64> map;
+  const int64 n = 10000;
+  for (int64 i = 0; i < n; i++)
+    EXPECT_EQ (OB_OK, map.Put (i * 7, i));
+  EXPECT_EQ (n, map.Count ());
+  for (int64 i = 0; i < n; i++)
+    {
+      EXPECT_EQ (i, map.Find (i * 7));
+      EXPECT_TRUE (map.KeyIsPresent (i * 7));
+      EXPECT_FALSE (map.KeyIsPresent (i * 7 + 1));
+    }
+
+  // remove every other one, and make sure the rest are still there
+  for (int64 i = 0; i < n; i += 2)
+    EXPECT_EQ (OB_OK, map.Remove (i * 7));
+  EXPECT_EQ (OB_NOT_FOUND, map.Remove (0));
+  EXPECT_EQ (n / 2, map.Count ());
+  for (int64 i = 0; i < n; i++)
+    EXPECT_EQ (i % 2 == 1, map.ContainsKey (i * 7));
+  for (int64 q = 0; q < map.Count (); q++)
+    EXPECT_EQ (q, map.IndexForKey (map.NthKey (q)));
+
+  map.Empty ();
+  EXPECT_EQ (0, map.Count ());
+  EXPECT_FALSE (map.ContainsKey (7));
+  EXPECT_EQ (OB_OK, map.Put (7, 1));
+  EXPECT_EQ (1, map.Find (7));
+}
+
+TEST (ObHashMapTest, MatchesObMap)
+{
+  // Throw the same random operations at both, and they should agree
+  ObMap<Str, int64> plain;
+  ObHashMap<Str, int64> hashed;
+  for (int i = 0; i < 20000; i++)
+    {
+      const Str key = Str::Format ("key%d", (int) ob_rand_int32 (0, 500));
+      const int64 val = ob_rand_int32 (0, 1000);
+      if (ob_rand_int32 (0, 3) == 0)
+        EXPECT_EQ (plain.Remove (key), hashed.Remove (key));
+      else
+        EXPECT_EQ (plain.Put (key, val), hashed.Put (key, val));
+    }
+  ASSERT_EQ (plain.Count (), hashed.Count ());
+  for (int64 q = 0; q < plain.Count (); q++)
+    EXPECT_EQ (plain.NthVal (q), hashed.Find (plain.NthKey (q)));
+}
+
+TEST (ObHashMapTest, DupKeyBehavior)
+{
+  ObHashMap<Str, int64> map;
+  map.Put ("a", 1);
+  map.Put ("a", 2);
+  EXPECT_EQ (1, map.Count ());
+  EXPECT_EQ (2, map.Find ("a"));
+
+  map.PrivilegeEarliest ();
+  map.Put ("a", 3);
+  EXPECT_EQ (2, map.Find ("a"));
+
+  map.AllowDuplicates ();
+  map.Put ("a", 4);
+  map.Put ("a", 5);
+  EXPECT_EQ (3, map.Count ());
+  EXPECT_EQ (2, map.Find ("a"));  // the earliest, as with ObMap
+  EXPECT_EQ (2, map.IndexForKey ("a"));  // but the latest index
+}
+
+TEST (ObHashMapTest, Order)
+{
+  ObHashMap<int64, Str> map;
+  map.Put (3, "three");
+  map.Put (1, "one");
+  map.Put (2, "two");
+  EXPECT_EQ (3, map.NthKey (0));
+  EXPECT_EQ (1, map.NthKey (1));
+  EXPECT_EQ (2, map.NthKey (2));
+  EXPECT_EQ ("two", map.NthVal (-1));
+
+  map.PutAtIndex (0, "zero", 0);
+  EXPECT_EQ (0, map.NthKey (0));
+  EXPECT_EQ ("zero", map.Find (0));
+  EXPECT_EQ ("one", map.Find (1));
+
+  map.SortByKey (int_cmp);
+  for (int64 q = 0; q < 4; q++)
+    {
+      EXPECT_EQ (q, map.NthKey (q));
+      EXPECT_EQ (q, map.IndexForKey (q));
+    }
+
+  // The last one moves into the gap
+  EXPECT_EQ (OB_OK, map.RemoveNth (1));
+  EXPECT_EQ (3, map.NthKey (1));
+  EXPECT_EQ ("three", map.Find (3));
+  EXPECT_EQ (OB_BAD_INDEX, map.RemoveNth (3));
+}
+
+TEST (ObHashMapTest, Crawls)
+{
+  ObHashMap<int64, int64> map;
+  for (int64 i = 1; i <= 5; i++)
+    map.Put (i, 10 * i);
+  int64 sum = 0;
+  for (auto mc : map)
+    {
+      static_assert (std::is_same<decltype (mc),
+                                  ObCons<int64, int64, UnspecifiedMemMgmt,
+                                         UnspecifiedMemMgmt> *>::value,
+                     "ObHashMap should iterate over ObCons pointers, "
+                     "like ObMap");
+      sum += mc->Car () + mc->Cdr ();
+    }
+  EXPECT_EQ (165, sum);
+
+  ObCrawl<int64> keys = map.CrawlKeys ();
+  EXPECT_EQ (1, keys.popfore ());
+  EXPECT_EQ (5, keys.popaft ());
+  ObCrawl<int64> vals = map.CrawlVals ();
+  sum = 0;
+  while (!vals.isempty ())
+    sum += vals.popfore ();
+  EXPECT_EQ (150, sum);
+
+  ObHashMap<int64, int64> empty;
+  EXPECT_TRUE (empty.Crawl ().isempty ());
+  for (auto mc : empty)
+    ADD_FAILURE () << "empty map had " << mc->Car ();
+}
+
+TEST (ObHashMapTest, MemoryManagement)
+{
+  {
+    ObHashMap<Str, Dorf *> dorves;
+    dorves.Put ("one", new Dorf ("one"));
+    dorves.Put ("two", new Dorf ("two"));
+    dorves.Put ("three", new Dorf ("three"));
+    ASSERT_EQ (3, livecount);
+
+    dorves.Put ("two", new Dorf ("deux"));
+    EXPECT_EQ (3, livecount);
+    EXPECT_EQ ("deux", dorves.Find ("two")->s);
+
+    dorves.Remove ("one");
+    EXPECT_EQ (2, livecount);
+    EXPECT_EQ ("three", dorves.Find ("three")->s);
+
+    ObHashMap<Str, Dorf *> copy (dorves);
+    EXPECT_EQ (2, livecount);
+    dorves = *&dorves;  // annotate with *& to tell clang we intend this
+    EXPECT_EQ (2, copy.Count ());
+    EXPECT_EQ ("deux", copy.Find ("two")->s);
+
+    ObHashMap<Str, Dorf *> moved (std::move (copy));
+    EXPECT_EQ (0, copy.Count ());
+    EXPECT_FALSE (copy.ContainsKey ("two"));
+    EXPECT_EQ ("deux", moved.Find ("two")->s);
+  }
+  EXPECT_EQ (0, livecount);
+
+  {
+    ObMap<Dorf *, Str> plain;
+    plain.Put (new Dorf ("a"), "a");
+    plain.Put (new Dorf ("b"), "b");
+    ObHashMap<Dorf *, Str> hashed (plain);
+    EXPECT_EQ (2, hashed.Count ());
+    EXPECT_EQ ("b", hashed.Find (plain.NthKey (1)));
+    EXPECT_EQ (1, hashed.IndexForKey (plain.NthKey (1)));
+  }
+  EXPECT_EQ (0, livecount);
+}
@@ -0,0 +1,185 @@
+/* (c)  oblong industries */
+
+#include <stdlib.h>
+#include <libLoam/c++/FatherTime.h>
+#include <libLoam/c++/Str.h>
+
+#include <iostream>
+
+
+using namespace oblong::loam;
+using namespace std;
+
+
+#define ITERATIONS 2000000 /* 2 million */
+
+
+/* Count every trip to the allocator, so we can report allocations per
+ * operation as well as time.  This relies on glibc letting a program
+ * interpose malloc and friends; elsewhere we just report time. */
+static unt64 allocations = 0;
+
+#ifdef __GLIBC__
+extern "C" {
+void *__libc_malloc (size_t);
+void *__libc_calloc (size_t, size_t);
+void *__libc_realloc (void *, size_t);
+void __libc_free (void *);
+
+void *malloc (size_t n)
+{
+  allocations++;
+  return __libc_malloc (n);
+}
+
+void *calloc (size_t n, size_t m)
+{
+  allocations++;
+  return __libc_calloc (n, m);
+}
+
+void *realloc (void *p, size_t n)
+{
+  allocations++;
+  return __libc_realloc (p, n);
+}
+
+void free (void *p)
+{
+  __libc_free (p);
+}
+}
+#define ALLOCS_PER_OP(n) (float64) (allocations - allocs) / (n)
+#else
+#define ALLOCS_PER_OP(n) "?"
+#endif
+
+
+/* Keeps the compiler from discarding work whose result we don't use */
+static volatile unt64 sink;
+
+
+#define BENCH_BEGIN(str, iterations)                                           \
+  cout << "Testing " str ": ";                                                 \
+  allocs = allocations;                                                        \
+  start = FatherTime::AbsoluteTime ();                                         \
+  for (unt64 i = 0; i < (iterations); i++)                                     \
+    {
+
+#define BENCH_END(iterations)                                                  \
+  }                                                                            \
+  end = FatherTime::AbsoluteTime ();                                           \
+  cout << (end - start) / (iterations) *1e9 << "ns and "                       \
+       << ALLOCS_PER_OP (iterations) << " allocations per iteration." << endl
+
+int main (int argc, char **argv)
+{
+  float64 start, end;
+  unt64 allocs;
+
+  const Str key ("input/pointer");
+  const Str other ("input/pointes");
+  const Str path ("/usr/local/share/oblong/etc/pools.conf");
+  const Str csv ("alpha,beta,gamma,delta,epsilon,zeta");
+  const Str mixed ("Content-Type: Text/HTML; Charset=UTF-8");
+  const Str intl ("na\xc3\xafve caf\xc3\xa9 \xe2\x86\x92 r\xc3\xa9sum\xc3\xa9");
+
+  BENCH_BEGIN ("constructing a short Str", ITERATIONS);
+  {
+    Str s ("pointer");
+    sink += s.ByteLength ();
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("copying a short Str", ITERATIONS);
+  {
+    Str s (key);
+    sink += s.ByteLength ();
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("copying a long Str", ITERATIONS);
+  {
+    Str s (path);
+    sink += s.ByteLength ();
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("comparing", ITERATIONS);
+  {
+    sink += key.Compare (other);
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("comparing without case", ITERATIONS);
+  {
+    sink += key.CaseCmp (other);
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("hashing", ITERATIONS);
+  {
+    sink += path.Hash ();
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("finding a substring", ITERATIONS);
+  {
+    sink += path.Index ("oblong") + path.Rindex ("/");
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("finding a non-ASCII substring", ITERATIONS);
+  {
+    sink += intl.Index ("r\xc3\xa9");
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("slicing", ITERATIONS);
+  {
+    sink += path.Slice (5, 11).ByteLength ();
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("slicing non-ASCII", ITERATIONS);
+  {
+    sink += intl.Slice (6, 4).ByteLength ();
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("appending", ITERATIONS);
+  {
+    Str s ("input/");
+    s.Append ("pointer");
+    sink += s.ByteLength ();
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("splitting on a character", ITERATIONS / 4);
+  {
+    sink += csv.Split (",").Count ();
+  }
+  BENCH_END (ITERATIONS / 4);
+
+  BENCH_BEGIN ("splitting on a string", ITERATIONS / 4);
+  {
+    sink += mixed.Split ("; ").Count ();
+  }
+  BENCH_END (ITERATIONS / 4);
+
+  BENCH_BEGIN ("downcasing ASCII", ITERATIONS);
+  {
+    Str s (mixed);
+    sink += s.Downcase ().ByteLength ();
+  }
+  BENCH_END (ITERATIONS);
+
+  BENCH_BEGIN ("upcasing non-ASCII", ITERATIONS);
+  {
+    Str s (intl);
+    sink += s.Upcase ().ByteLength ();
+  }
+  BENCH_END (ITERATIONS);
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+
+/* (c)  oblong industries */
+
+/* CRC-32C, which uses the Castagnoli polynomial (as in iSCSI, ext4,
+ * SSE 4.2, etc.) instead of the zlib/ethernet one.  On x86-64 with
+ * gcc or clang, we use the crc32 instruction if the processor has
+ * it; everywhere else, we use "slicing-by-8" tables. */
+
+#include "libLoam/c/ob-hash.h"
+#include "libLoam/c/ob-atomic.h"
+
+#include <string.h>
+
+/* 0x1edc6f41, bit-reversed */
+#define CRC32C_POLY 0x82f63b78
+
+/* The crc32 instruction can start on another 8 bytes every cycle, but
+ * takes three cycles to finish, so big buffers go three streams at a
+ * time, each of LANE bytes, which are then stitched together with
+ * lane_shift (see shift_over_lane()). */
+#define LANE 4096
+
+static unt32 crc_table[8][256];
+static unt32 lane_shift[32];
+static bool have_sse42;
+static int32 initialized;
+
+/* Multiplies the 32x32 matrix over GF(2) \a mat (one column per
+ * word) by the vector \a vec.  (The same trick zlib uses in
+ * crc32_combine().) */
+static unt32 gf2_times (const unt32 *mat, unt32 vec)
+{
+  unt32 sum = 0;
+  for (; vec != 0; vec >>= 1, mat++)
+    if (vec & 1)
+      sum ^= *mat;
+  return sum;
+}
+
+/* Returns what crc (without the final inversion) would be after LANE
+ * more zero bytes.  Since a crc is linear in its input, the crc of
+ * A followed by B is that of A shifted over the length of B, plus
+ * (xor) the crc of B started from zero. */
+static unt32 shift_over_lane (unt32 crc)
+{
+  return gf2_times (lane_shift, crc);
+}
+
+static void crc32c_init (void)
+{
+  if (ob_atomic_int32_ref (&initialized))
+    return;
+
+  /* Doing this more than once (in racing threads) is harmless, since
+   * each time computes exactly the same thing. */
+  unt32 i, j;
+  for (i = 0; i < 256; i++)
+    {
+      unt32 c = i;
+      for (j = 0; j < 8; j++)
+        c = (c >> 1) ^ (CRC32C_POLY & (0U - (c & 1)));
+      crc_table[0][i] = c;
+    }
+  for (i = 0; i < 256; i++)
+    for (j = 1; j < 8; j++)
+      crc_table[j][i] =
+        (crc_table[j - 1][i] >> 8) ^ crc_table[0][crc_table[j - 1][i] & 0xff];
+
+  /* Start with the operator for one zero bit, and square it until it
+   * covers a whole lane. */
+  unt32 op[32], sq[32];
+  op[0] = CRC32C_POLY;
+  for (i = 1; i < 32; i++)
+    op[i] = 1U << (i - 1);
+  for (j = 1; j < 8 * LANE; j *= 2)
+    {
+      for (i = 0; i < 32; i++)
+        sq[i] = gf2_times (op, op[i]);
+      memcpy (op, sq, sizeof (op));
+    }
+  memcpy (lane_shift, op, sizeof (lane_shift));
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init ();
+  have_sse42 = __builtin_cpu_supports ("sse4.2");
+#endif
+
+  ob_atomic_int32_set (&initialized, 1);
+}
+
+static unt32 crc32c_sw (unt32 c, const byte *p, size_t n)
+{
+  for (; n >= 8; n -= 8, p += 8)
+    {
+      const unt32 lo = c ^ (p[0] | (p[1] << 8) | (p[2] << 16)
+                            | ((unt32) p[3] << 24));
+      const unt32 hi = p[4] | (p[5] << 8) | (p[6] << 16) | ((unt32) p[7] << 24);
+      c = crc_table[7][lo & 0xff] ^ crc_table[6][(lo >> 8) & 0xff]
+          ^ crc_table[5][(lo >> 16) & 0xff] ^ crc_table[4][lo >> 24]
+          ^ crc_table[3][hi & 0xff] ^ crc_table[2][(hi >> 8) & 0xff]
+          ^ crc_table[1][(hi >> 16) & 0xff] ^ crc_table[0][hi >> 24];
+    }
+  for (; n > 0; n--)
+    c = crc_table[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+  return c;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_CRC32C_HW
+
+__attribute__ ((target ("sse4.2"))) static unt32
+crc32c_hw (unt32 crc, const byte *p, size_t n)
+{
+  unt64 c0 = crc;
+  for (; n >= 3 * LANE; n -= 3 * LANE, p += 2 * LANE)
+    {
+      unt64 c1 = 0, c2 = 0, w0, w1, w2;
+      const byte *end = p + LANE;
+      for (; p < end; p += 8)
+        {
+          memcpy (&w0, p, 8);
+          memcpy (&w1, p + LANE, 8);
+          memcpy (&w2, p + 2 * LANE, 8);
+          c0 = __builtin_ia32_crc32di (c0, w0);
+          c1 = __builtin_ia32_crc32di (c1, w1);
+          c2 = __builtin_ia32_crc32di (c2, w2);
+        }
+      c0 = shift_over_lane ((unt32) c0) ^ (unt32) c1;
+      c0 = shift_over_lane ((unt32) c0) ^ (unt32) c2;
+    }
+  for (; n >= 8; n -= 8, p += 8)
+    {
+      unt64 w;
+      memcpy (&w, p, 8);
+      c0 = __builtin_ia32_crc32di (c0, w);
+    }
+  unt32 c = (unt32) c0;
+  for (; n > 0; n--)
+    c = __builtin_ia32_crc32qi (c, *p++);
+  return c;
+}
+#endif
+
+unt32 ob_crc32c (const void *data, size_t length, unt32 crc)
+{
+  crc32c_init ();
+  const byte *p = (const byte *) data;
+#ifdef HAVE_CRC32C_HW
+  if (have_sse42)
+    return ~crc32c_hw (~crc, p, length);
+#endif
+  return ~crc32c_sw (~crc, p, length);
+}
@@ -0,0 +1,153 @@
+/* (c)  oblong industries */
+
+/* Byte-swapping whole arrays at a time.  On x86-64 with gcc or clang,
+ * we use pshufb (from SSSE3) to swap 16 bytes per instruction, or its
+ * AVX2 version to swap 32, if the processor has them; everywhere
+ * else, and for the odd elements left over, we just loop. */
+
+#include "libLoam/c/ob-endian.h"
+#include "libLoam/c/ob-atomic.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_PSHUFB
+#include <immintrin.h>
+#endif
+
+/* Don't bother with the vector units for less than this many bytes */
+#define TOO_SHORT_TO_SHUFFLE 32
+
+#ifdef HAVE_PSHUFB
+
+static bool have_ssse3;
+static bool have_avx2;
+static int32 initialized;
+
+static void shuffle_init (void)
+{
+  if (ob_atomic_int32_ref (&initialized))
+    return;
+  __builtin_cpu_init ();
+  have_ssse3 = __builtin_cpu_supports ("ssse3");
+  have_avx2 = __builtin_cpu_supports ("avx2");
+  ob_atomic_int32_set (&initialized, 1);
+}
+
+/* For each size of integer, where pshufb should get each byte from,
+ * in each 16-byte half of a 32-byte register. */
+static const byte swap16_mask[32] = {1, 0, 3,  2,  5,  4,  7,  6,  //
+                                     9, 8, 11, 10, 13, 12, 15, 14, //
+                                     1, 0, 3,  2,  5,  4,  7,  6,  //
+                                     9, 8, 11, 10, 13, 12, 15, 14};
+static const byte swap32_mask[32] = {3,  2,  1,  0,  7,  6,  5,  4,  //
+                                     11, 10, 9,  8,  15, 14, 13, 12, //
+                                     3,  2,  1,  0,  7,  6,  5,  4,  //
+                                     11, 10, 9,  8,  15, 14, 13, 12};
+static const byte swap64_mask[32] = {7,  6,  5,  4,  3,  2,  1, 0, //
+                                     15, 14, 13, 12, 11, 10, 9, 8, //
+                                     7,  6,  5,  4,  3,  2,  1, 0, //
+                                     15, 14, 13, 12, 11, 10, 9, 8};
+
+/* Each of these shuffles as many whole 16-byte (or 32-byte) blocks
+ * of the \a len bytes at \a p as there are, and returns how many
+ * bytes that was.  Since every size of integer divides 16, what's
+ * left is always whole integers. */
+
+__attribute__ ((target ("ssse3"))) static size_t
+shuffle_ssse3 (byte *p, size_t len, const byte *mask)
+{
+  const __m128i m = _mm_loadu_si128 ((const __m128i *) mask);
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64)
+    {
+      __m128i a = _mm_loadu_si128 ((__m128i *) (p + i));
+      __m128i b = _mm_loadu_si128 ((__m128i *) (p + i + 16));
+      __m128i c = _mm_loadu_si128 ((__m128i *) (p + i + 32));
+      __m128i d = _mm_loadu_si128 ((__m128i *) (p + i + 48));
+      _mm_storeu_si128 ((__m128i *) (p + i), _mm_shuffle_epi8 (a, m));
+      _mm_storeu_si128 ((__m128i *) (p + i + 16), _mm_shuffle_epi8 (b, m));
+      _mm_storeu_si128 ((__m128i *) (p + i + 32), _mm_shuffle_epi8 (c, m));
+      _mm_storeu_si128 ((__m128i *) (p + i + 48), _mm_shuffle_epi8 (d, m));
+    }
+  for (; i + 16 <= len; i += 16)
+    {
+      __m128i a = _mm_loadu_si128 ((__m128i *) (p + i));
+      _mm_storeu_si128 ((__m128i *) (p + i), _mm_shuffle_epi8 (a, m));
+    }
+  return i;
+}
+
+__attribute__ ((target ("avx2"))) static size_t
+shuffle_avx2 (byte *p, size_t len, const byte *mask)
+{
+  const __m256i m = _mm256_loadu_si256 ((const __m256i *) mask);
+  size_t i = 0;
+  for (; i + 128 <= len; i += 128)
+    {
+      __m256i a = _mm256_loadu_si256 ((__m256i *) (p + i));
+      __m256i b = _mm256_loadu_si256 ((__m256i *) (p + i + 32));
+      __m256i c = _mm256_loadu_si256 ((__m256i *) (p + i + 64));
+      __m256i d = _mm256_loadu_si256 ((__m256i *) (p + i + 96));
+      _mm256_storeu_si256 ((__m256i *) (p + i), _mm256_shuffle_epi8 (a, m));
+      _mm256_storeu_si256 ((__m256i *) (p + i + 32),
+                           _mm256_shuffle_epi8 (b, m));
+      _mm256_storeu_si256 ((__m256i *) (p + i + 64),
+                           _mm256_shuffle_epi8 (c, m));
+      _mm256_storeu_si256 ((__m256i *) (p + i + 96),
+                           _mm256_shuffle_epi8 (d, m));
+    }
+  for (; i + 32 <= len; i += 32)
+    {
+      __m256i a = _mm256_loadu_si256 ((__m256i *) (p + i));
+      _mm256_storeu_si256 ((__m256i *) (p + i), _mm256_shuffle_epi8 (a, m));
+    }
+  if (i + 16 <= len)
+    {
+      __m128i a = _mm_loadu_si128 ((__m128i *) (p + i));
+      __m128i m1 = _mm_loadu_si128 ((const __m128i *) mask);
+      _mm_storeu_si128 ((__m128i *) (p + i), _mm_shuffle_epi8 (a, m1));
+      i += 16;
+    }
+  return i;
+}
+
+/* Returns how many of the \a n integers of \a size bytes at \a p
+ * got swapped, which may be none of them. */
+static size_t shuffle (void *p, size_t n, size_t size, const byte *mask)
+{
+  const size_t len = n * size;
+  if (len < TOO_SHORT_TO_SHUFFLE)
+    return 0;
+  shuffle_init ();
+  if (have_avx2)
+    return shuffle_avx2 ((byte *) p, len, mask) / size;
+  if (have_ssse3)
+    return shuffle_ssse3 ((byte *) p, len, mask) / size;
+  return 0;
+}
+
+#else
+
+#define shuffle(p, n, size, mask) 0
+
+#endif /* HAVE_PSHUFB */
+
+void ob_swap16_array (unt16 *p, size_t n)
+{
+  size_t i = shuffle (p, n, sizeof (*p), swap16_mask);
+  for (; i < n; i++)
+    p[i] = ob_swap16 (p[i]);
+}
+
+void ob_swap32_array (unt32 *p, size_t n)
+{
+  size_t i = shuffle (p, n, sizeof (*p), swap32_mask);
+  for (; i < n; i++)
+    p[i] = ob_swap32 (p[i]);
+}
+
+void ob_swap64_array (unt64 *p, size_t n)
+{
+  size_t i = shuffle (p, n, sizeof (*p), swap64_mask);
+  for (; i < n; i++)
+    p[i] = ob_swap64 (p[i]);
+}
@@ -7,7 +7,10 @@
 #ifndef OB_ENDIAN_SUBCONTINENT
 #define OB_ENDIAN_SUBCONTINENT
 
+#include <stddef.h>  // for size_t
 #include "libLoam/c/ob-types.h"
+#include "libLoam/c/ob-api.h"
+#include "libLoam/c/ob-attrs.h"
 
 #if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ > 2))
 /**
@@ -58,4 +61,33 @@ static inline unt64 ob_swap64 (unt64 x)
 #endif /* OB_HAVE_GCC_BSWAP_BUILTINS */
 }
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Byte-swap each of the \a n 16-bit integers at \a p, in place.  On
+ * processors with SSSE3 or AVX2, this swaps 16 or 32 bytes at a time,
+ * so for more than a handful of integers it's well worth calling
+ * instead of looping over ob_swap16().  \a p needn't be aligned
+ * beyond what an unt16 needs.
+ */
+OB_LOAM_API OB_HOT void ob_swap16_array (unt16 *p, size_t n);
+
+/**
+ * Byte-swap each of the \a n 32-bit integers at \a p, in place.
+ * See ob_swap16_array().
+ */
+OB_LOAM_API OB_HOT void ob_swap32_array (unt32 *p, size_t n);
+
+/**
+ * Byte-swap each of the \a n 64-bit integers at \a p, in place.
+ * See ob_swap16_array().
+ */
+OB_LOAM_API OB_HOT void ob_swap64_array (unt64 *p, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* OB_ENDIAN_SUBCONTINENT */
@@ -53,6 +53,17 @@ OB_LOAM_API OB_HOT unt64 ob_city_hash64_with_seeds (const void *key,
                                                     size_t length, unt64 seed0,
                                                     unt64 seed1);
 
+/**
+ * Computes the CRC-32C (Castagnoli) checksum of \a length bytes at
+ * \a data, continuing from \a crc, which should be 0 to start with.
+ * So ob_crc32c (b, m, ob_crc32c (a, n, 0)) is the checksum of the
+ * n bytes at a followed by the m bytes at b.  Uses the SSE 4.2 crc32
+ * instruction, if the processor has it, and works on big buffers
+ * several streams at a time.
+ */
+OB_LOAM_API OB_HOT unt32 ob_crc32c (const void *data, size_t length,
+                                    unt32 crc);
+
 /**
  * Given a 64-bit integer \a key, returns a 64-bit hash code.
  * This is a good hash that achieves avalanche, so it's possible
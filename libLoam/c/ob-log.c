@@ -18,6 +18,7 @@
 #include <math.h>
 #ifndef _MSC_VER
 #include <spawn.h>
+#include <signal.h>
 #endif
 
 #include "libLoam/c/ob-sys.h"
@@ -28,6 +29,7 @@
 #include "libLoam/c/ob-file.h"
 #include "libLoam/c/ob-string.h"
 #include "libLoam/c/ob-time.h"
+#include "libLoam/c/ob-hash.h"
 #include "libLoam/c/ob-pthread.h"
 #include "libLoam/c/private/ob-syslog.h"
 
@@ -115,7 +117,11 @@
 
 static void process_env (const char *env);
 static void ob_log_bye (void);
+static void ob_log_atfork_prepare (void);
 static void ob_log_atfork_child (void);
+#ifndef _MSC_VER
+static void async_init (void);
+#endif
 
 static void ob_log_init (void)
 {
@@ -129,12 +135,16 @@ static void ob_log_init (void)
     process_env (env);
 
 #ifndef _MSC_VER
-  // Set up an atfork handler, so that rule counts can be reinitialized
-  // to zero in the child process.
-  const int erryes = pthread_atfork (NULL, NULL, ob_log_atfork_child);
+  // Set up atfork handlers, so that rule counts can be reinitialized
+  // to zero in the child process, and so that asynchronous messages
+  // don't get lost (or logged twice) across the fork.
+  const int erryes =
+    pthread_atfork (ob_log_atfork_prepare, NULL, ob_log_atfork_child);
 
   if (erryes)
     OB_LOG_ERROR_CODE (0x10060005, "atfork() said '%s'\n", strerror (erryes));
+
+  async_init ();
 #endif
 }
 
@@ -188,6 +198,9 @@ static const char help[] =
   "\n"
   "[no]tid - print thread ID with message\n"
   "\n"
+  "[no]async - format and print messages on a background thread, so\n"
+  "            that logging costs the logging thread very little\n"
+  "\n"
   "none - turn off logging for all codes (same as \"????????????????"
   "=off\")\n"
   "\n"
@@ -298,6 +311,8 @@ static bool recognize_flag (const char *word, int32 *set, int32 *clr)
     s = OB_DST_SYSLOG;
   else if (0 == strcasecmp (word, "valgrind"))
     s = OB_DST_VALGRIND;
+  else if (0 == strcasecmp (word, "async"))
+    s = OB_FLG_ASYNC;
   else
     return false;
 
@@ -447,6 +462,54 @@ static void process_env (const char *env)
   free (cpy);
 }
 
+/* Walking the rule lists (and matching every file rule's glob against
+ * the file name) for every message adds up when something is logging
+ * a lot, so should_print() remembers which rule applies to each
+ * level and code, and each level and file name, in a little hash
+ * table.  Like the rules themselves, memos are never changed or freed
+ * once they're published.  Instead, adding a rule bumps
+ * rule_generation, and a memo from an older generation gets shadowed
+ * by a fresh one the next time it's looked up.
+ */
+
+typedef struct log_memo
+{
+  struct log_memo *next;
+  const ob_log_level *lvl;
+  int64 generation;
+  unt64 code;     // for code memos
+  void *rule;     // the ob_log_rule or ob_log_file_rule, or NULL if none
+  char fname[1];  // for file memos
+} log_memo;
+
+#define MEMO_BUCKETS 1024
+
+/* The lookups happen for every message, so where the compiler lets
+ * us, they use plain acquire loads rather than the full barriers of
+ * ob_atomic_*_ref. */
+#ifdef _MSC_VER
+#define ACQUIRE_POINTER(loc) ob_atomic_pointer_ref (loc)
+#define ACQUIRE_INT64(loc) ob_atomic_int64_ref (loc)
+#else
+#define ACQUIRE_POINTER(loc) __atomic_load_n (loc, __ATOMIC_ACQUIRE)
+#define ACQUIRE_INT64(loc) __atomic_load_n (loc, __ATOMIC_ACQUIRE)
+#endif
+
+static log_memo *code_memos[MEMO_BUCKETS];
+static log_memo *file_memos[MEMO_BUCKETS];
+static int64 rule_generation;
+
+static void memo_push (log_memo **bucket, log_memo *m)
+{
+  log_memo *head;
+  do
+    {
+      head = ob_atomic_pointer_ref (bucket);
+      m->next = head;
+    }
+  while (!ob_atomic_pointer_compare_and_swap (bucket, head, m));
+}
+
 ob_retort ob_log_add_file_rule (ob_log_level *lvl, const char *pattern,
                                 bool print)
 {
@@ -465,6 +528,7 @@ ob_retort ob_log_add_file_rule (ob_log_level *lvl, const char *pattern,
       r->next = victim;
     }
   while (!ob_atomic_pointer_compare_and_swap (head, victim, r));
+  ob_atomic_int64_add (&rule_generation, 1);
   return OB_OK;
 }
 
@@ -504,6 +568,7 @@ ob_retort ob_log_add_rule (ob_log_level *lvl, ob_log_rule rul)
       r->next = victim;
     }
   while (!ob_atomic_pointer_compare_and_swap (head, victim, r));
+  ob_atomic_int64_add (&rule_generation, 1);
   return OB_OK;
 }
 
@@ -565,6 +630,64 @@ static ob_log_rule *ob_log_find_rule (ob_log_level *lvl, unt64 code)
   return rul;
 }
 
+/* Same as ob_log_find_file_rule, but remembers the answer */
+static ob_log_file_rule *ob_log_lookup_file_rule (ob_log_level *lvl,
+                                                  const char *fname)
+{
+  if (!ACQUIRE_POINTER (&lvl->frules))
+    return NULL;
+  const int64 gen = ACQUIRE_INT64 (&rule_generation);
+  const size_t len = strlen (fname);
+  const unt64 h = ob_city_hash64 (fname, len) ^ (unt64) (uintptr_t) lvl;
+  log_memo **bucket = &file_memos[ob_hash_unt64 (h) % MEMO_BUCKETS];
+  log_memo *m;
+  for (m = ACQUIRE_POINTER (bucket); m; m = m->next)
+    if (m->lvl == lvl && 0 == strcmp (m->fname, fname))
+      {
+        if (m->generation == gen)
+          return (ob_log_file_rule *) m->rule;
+        break;
+      }
+  ob_log_file_rule *frul = ob_log_find_file_rule (lvl, fname);
+  if ((m = (log_memo *) calloc (1, sizeof (log_memo) + len)))
+    {
+      m->lvl = lvl;
+      m->generation = gen;
+      m->rule = frul;
+      memcpy (m->fname, fname, len + 1);
+      memo_push (bucket, m);
+    }
+  return frul;
+}
+
+/* Same as ob_log_find_rule, but remembers the answer */
+static ob_log_rule *ob_log_lookup_rule (ob_log_level *lvl, unt64 code)
+{
+  if (!ACQUIRE_POINTER (&lvl->rules))
+    return NULL;
+  const int64 gen = ACQUIRE_INT64 (&rule_generation);
+  const unt64 h = code ^ (unt64) (uintptr_t) lvl;
+  log_memo **bucket = &code_memos[ob_hash_unt64 (h) % MEMO_BUCKETS];
+  log_memo *m;
+  for (m = ACQUIRE_POINTER (bucket); m; m = m->next)
+    if (m->lvl == lvl && m->code == code)
+      {
+        if (m->generation == gen)
+          return (ob_log_rule *) m->rule;
+        break;
+      }
+  ob_log_rule *rul = ob_log_find_rule (lvl, code);
+  if ((m = (log_memo *) calloc (1, sizeof (log_memo))))
+    {
+      m->lvl = lvl;
+      m->generation = gen;
+      m->code = code;
+      m->rule = rul;
+      memo_push (bucket, m);
+    }
+  return rul;
+}
+
 typedef enum should_print_t { PRINT_NO, PRINT_YES, PRINT_FINAL } should_print_t;
 
 static void masked_format (char buf[17], unt64 code, unt8 matchbits)
@@ -580,11 +703,11 @@ static should_print_t should_print (ob_log_level *lvl, unt64 code,
                                     char supcode[17], int64 *maxcount_p,
                                     const char *fname)
 {
-  ob_log_file_rule *frul = ob_log_find_file_rule (lvl, fname);
+  ob_log_file_rule *frul = ob_log_lookup_file_rule (lvl, fname);
   if (frul)
     return (frul->print ? PRINT_YES : PRINT_NO);
 
-  ob_log_rule *rul = ob_log_find_rule (lvl, code);
+  ob_log_rule *rul = ob_log_lookup_rule (lvl, code);
 
   if (!rul)
     return PRINT_YES;
@@ -607,11 +730,11 @@ static should_print_t should_print (ob_log_level *lvl, unt64 code,
 static should_print_t should_print_peek (ob_log_level *lvl, unt64 code,
                                          const char *fname)
 {
-  ob_log_file_rule *frul = ob_log_find_file_rule (lvl, fname);
+  ob_log_file_rule *frul = ob_log_lookup_file_rule (lvl, fname);
   if (frul)
     return (frul->print ? PRINT_YES : PRINT_NO);
 
-  ob_log_rule *rul = ob_log_find_rule (lvl, code);
+  ob_log_rule *rul = ob_log_lookup_rule (lvl, code);
 
   if (!rul)
     return PRINT_YES;
@@ -1029,6 +1152,10 @@ typedef struct time_cache
 {
   struct timeval tv;
   bool got_time;
+  // and who logged it
+  unt32 tid;
+  bool is_main;
+  bool got_tid;
 } time_cache;
 
 static void ob_log_internal (int32 flags, time_cache *now, int64 nline,
@@ -1039,6 +1166,1022 @@ static OB_UNUSED void *win_log_critical;
 
 #define OB_DST_MASK 0x3f
 
+/* Hands msg to ob_log_internal a line at a time.  msg should end in a
+ * newline, and gets scribbled on (and put back) along the way. */
+static void log_lines (int32 flags, time_cache *now, const char *file,
+                       int lineno, ob_log_level *lvl, unt64 code, char *msg)
+{
+  int64 totlines = 0;
+  const char *p;
+  for (p = msg; *p; p++)
+    if ('\n' == *p)
+      totlines++;
+  int64 nline = 1;
+  char *q;
+  for (q = msg; *q; nline++)
+    {
+      char c = 0;
+      char *r = strchr (q, '\n');
+      if (r)
+        {
+          r++;
+          c = *r;
+          *r = 0;
+        }
+      else
+        r = q;
+      ob_log_internal (flags, now, nline, totlines, file, lineno, lvl, code,
+                       q);
+      *r = c;
+      q = r;
+    }
+}
+
+#ifndef _MSC_VER
+
+/* Asynchronous logging (OB_FLG_ASYNC)
+ *
+ * Each thread which logs asynchronously gets a ring buffer, into which
+ * it copies each message's level, code, location, time, format string
+ * and arguments.  The arguments can't just be kept as a va_list, since
+ * that's only good until the caller returns, so we copy each argument
+ * according to its conversion: numbers and pointers by value, and
+ * strings by copying them.  Formats and file names are interned the
+ * first time we see them (see async_fmt), so a record just points at
+ * them, and the format only gets parsed once.  (A format with anything
+ * we don't understand, like %n or positional arguments, gets formatted
+ * on the spot, and the result is queued instead.)  The background
+ * thread takes messages from all the rings in order of time, formats
+ * them a conversion at a time, and hands them to ob_log_internal just
+ * as if they'd been logged synchronously.
+ *
+ * Each ring has exactly one writer (the thread it belongs to) and one
+ * reader (the background thread), so it needs no locks: the writer
+ * only moves head, and the reader only moves tail.  Rings are never
+ * freed; when a thread exits, its ring waits for the next thread that
+ * wants one.  The mutex is only for putting the background thread to
+ * sleep and waking it up again, and for ob_log_flush to wait on.
+ */
+
+#define ASYNC_RING_BYTES (64 * 1024)
+// Messages which need more than this are formatted on the spot
+#define ASYNC_STAGE_BYTES 2048
+// Messages which need more than this are logged synchronously
+#define ASYNC_MAX_RECORD (ASYNC_RING_BYTES / 4)
+#define ASYNC_ALIGN(n) (((n) + 7) & ~(size_t) 7)
+
+typedef struct async_ring
+{
+  struct async_ring *next;
+  int32 owned;  // nonzero while some thread is using this ring
+  unt32 tid;    // the owner's, for OB_FLG_SHOW_TID
+  bool is_main;
+  // The writer's and the reader's sides are on separate cache lines,
+  // and each remembers how far the other had got last time it looked,
+  // so they only have to look at each other's when that runs out.
+  byte pad0[64];
+  int64 head;       // bytes ever written; only moved by the owner
+  int64 tail_seen;  // the owner's idea of tail
+  byte pad1[64];
+  int64 tail;       // bytes ever read; only moved by the background thread
+  int64 head_seen;  // the background thread's idea of head
+  byte pad2[64];
+  unt64 buf[ASYNC_RING_BYTES / sizeof (unt64)];
+} async_ring;
+
+typedef union async_arg
+{
+  long long i;
+  double d;
+  void *p;
+} async_arg;
+
+typedef enum arg_kind
+{
+  ARG_NONE,  // "%%"
+  ARG_INT,
+  ARG_LONG,
+  ARG_LLONG,
+  ARG_INTMAX,
+  ARG_SIZE,
+  ARG_PTRDIFF,
+  ARG_DOUBLE,
+  ARG_LDOUBLE,
+  ARG_STRING,
+  ARG_POINTER
+} arg_kind;
+
+typedef struct conversion
+{
+  size_t start;    // where its '%' is in the format
+  size_t len;      // of the whole specification, starting with '%'
+  int nstars;      // how many '*' widths and precisions, which take an int
+  bool star_prec;  // the last of those is the precision
+  int prec;        // literal precision, or -1
+  arg_kind kind;
+} conversion;
+
+/* A format (or a file name) as it was the first time we saw it, with
+ * its conversions already parsed.  Since records point at these, they
+ * never go away, so there's a limit on how many we'll make, in case
+ * somebody builds their formats on the fly; past that, messages get
+ * formatted on the spot. */
+typedef struct async_fmt
+{
+  struct async_fmt *next;
+  const char *key;   // the pointer it was logged with
+  const char *text;  // our own copy
+  int nconv;         // or -1 if it has something we can't carry over
+  conversion *convs;
+} async_fmt;
+
+#define ASYNC_FMT_BUCKETS 1024
+#define ASYNC_MAX_FMTS 4096
+
+typedef struct async_rec
+{
+  unt32 size;  // including the arguments which follow
+  bool skip;   // just filling up the end of the ring
+  bool is_main;
+  unt32 tid;
+  int32 flags;
+  int32 lineno;
+  ob_log_level *lvl;
+  unt64 code;
+  struct timeval tv;
+  const async_fmt *fmt;
+  const async_fmt *file;
+  // followed by the arguments
+} async_rec;
+
+#define ASYNC_HDR ASYNC_ALIGN (sizeof (async_rec))
+
+
+enum
+{
+  ASYNC_IDLE,     // background thread not started yet
+  ASYNC_RUNNING,  // background thread is running
+  ASYNC_DEAD      // couldn't start it, or we're exiting; log synchronously
+};
+
+static async_ring *async_rings;
+static pthread_key_t async_key;
+static bool async_key_ok;
+static int32 async_state;
+static bool async_stop;
+static int32 async_sleeping;
+static pthread_t async_thread;
+static pthread_mutex_t async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t async_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t async_drained = PTHREAD_COND_INITIALIZER;
+
+static async_fmt *async_fmts[ASYNC_FMT_BUCKETS];
+static async_fmt *async_files[ASYNC_FMT_BUCKETS];
+static int32 async_nfmts;
+
+// For messages which have already been formatted
+static conversion async_percent_s_conv = {0, 2, 0, false, -1, ARG_STRING};
+static async_fmt async_percent_s = {NULL, NULL, "%s", 1,
+                                    &async_percent_s_conv};
+
+// The background thread's formatting buffer
+static char *async_out;
+static size_t async_out_len, async_out_cap;
+
+/* Parses the conversion specification at fmt (which points at a '%'),
+ * returning false if it's something we can't carry over to another
+ * thread. */
+static bool parse_conversion (const char *fmt, conversion *cv)
+{
+  const char *p = fmt + 1;
+  cv->nstars = 0;
+  cv->star_prec = false;
+  cv->prec = -1;
+  if (*p == '%')
+    {
+      cv->kind = ARG_NONE;
+      cv->len = 2;
+      return true;
+    }
+  while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0'
+         || *p == '\'')
+    p++;
+  if (*p == '*')
+    cv->nstars++, p++;
+  else
+    while (*p >= '0' && *p <= '9')
+      p++;
+  if (*p == '$')
+    return false;  // positional arguments
+  if (*p == '.')
+    {
+      p++;
+      if (*p == '*')
+        cv->nstars++, cv->star_prec = true, p++;
+      else
+        for (cv->prec = 0; *p >= '0' && *p <= '9'; p++)
+          cv->prec = 10 * cv->prec + (*p - '0');
+    }
+  // "h" and "hh" make no difference to what's passed, which is an int
+  char len = 0;
+  if (p[0] == 'h')
+    p += (p[1] == 'h' ? 2 : 1);
+  else if (p[0] == 'l' && p[1] == 'l')
+    len = 'q', p += 2;
+  else if (*p && strchr ("lqLjzt", *p))
+    len = *p++;
+  switch (*p)
+    {
+      case 'd':
+      case 'i':
+      case 'o':
+      case 'u':
+      case 'x':
+      case 'X':
+        switch (len)
+          {
+            case 0:
+              cv->kind = ARG_INT;
+              break;
+            case 'l':
+              cv->kind = ARG_LONG;
+              break;
+            case 'q':
+              cv->kind = ARG_LLONG;
+              break;
+            case 'j':
+              cv->kind = ARG_INTMAX;
+              break;
+            case 'z':
+              cv->kind = ARG_SIZE;
+              break;
+            case 't':
+              cv->kind = ARG_PTRDIFF;
+              break;
+            default:
+              return false;
+          }
+        break;
+      case 'e':
+      case 'E':
+      case 'f':
+      case 'F':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        if (len == 0 || len == 'l')
+          cv->kind = ARG_DOUBLE;
+        else if (len == 'L')
+          cv->kind = ARG_LDOUBLE;
+        else
+          return false;
+        break;
+      case 'c':
+        cv->kind = ARG_INT;
+        if (len)
+          return false;  // wide character
+        break;
+      case 's':
+        cv->kind = ARG_STRING;
+        if (len)
+          return false;  // wide string
+        break;
+      case 'p':
+        cv->kind = ARG_POINTER;
+        if (len)
+          return false;
+        break;
+      default:
+        return false;  // %n, %m, and anything else unusual
+    }
+  cv->len = p + 1 - fmt;
+  return cv->len < 32;
+}
+
+/* Finds s in table (of formats if parse is true, or file names if
+ * not), adding it if it's not there.  Returns NULL if it's not there
+ * and we can't add it. */
+static const async_fmt *async_intern (async_fmt **table, const char *s,
+                                      bool parse)
+{
+  async_fmt **bucket =
+    &table[ob_hash_unt64 ((unt64) (uintptr_t) s) % ASYNC_FMT_BUCKETS];
+  async_fmt *f;
+  // Usually it's a string literal, so the pointer's enough to find
+  // it, but the contents have to match too, in case it isn't
+  for (f = ACQUIRE_POINTER (bucket); f; f = f->next)
+    if (f->key == s && 0 == strcmp (f->text, s))
+      return f;
+  if (ob_atomic_int32_ref (&async_nfmts) >= ASYNC_MAX_FMTS)
+    return NULL;
+
+  const size_t len = strlen (s);
+  size_t npct = 0;
+  const char *p;
+  if (parse)
+    for (p = strchr (s, '%'); p; p = strchr (p + 1, '%'))
+      npct++;
+  f = (async_fmt *) malloc (sizeof (*f) + npct * sizeof (conversion) + len
+                            + 1);
+  if (!f)
+    return NULL;
+  f->key = s;
+  f->convs = (conversion *) (f + 1);
+  char *text = (char *) (f->convs + npct);
+  memcpy (text, s, len + 1);
+  f->text = text;
+  f->nconv = 0;
+  for (p = (parse ? strchr (text, '%') : NULL); p; p = strchr (p, '%'))
+    {
+      conversion *cv = &f->convs[f->nconv];
+      if (!parse_conversion (p, cv))
+        {
+          f->nconv = -1;
+          break;
+        }
+      cv->start = p - text;
+      p += cv->len;
+      f->nconv++;
+    }
+  ob_atomic_int32_add (&async_nfmts, 1);
+  async_fmt *head;
+  do
+    {
+      head = ob_atomic_pointer_ref (bucket);
+      f->next = head;
+    }
+  while (!ob_atomic_pointer_compare_and_swap (bucket, head, f));
+  return f;
+}
+
+/* Builds up a record, noting if it runs out of room */
+typedef struct rec_writer
+{
+  byte *buf;
+  size_t cap;
+  size_t len;
+  bool full;
+} rec_writer;
+
+static void put_bytes (rec_writer *w, const void *src, size_t n)
+{
+  if (w->full || n > w->cap - w->len)
+    {
+      w->full = true;
+      return;
+    }
+  memcpy (w->buf + w->len, src, n);
+  w->len += n;
+}
+
+static void put_align (rec_writer *w)
+{
+  static const byte zeros[8];
+  put_bytes (w, zeros, ASYNC_ALIGN (w->len) - w->len);
+}
+
+static void put_arg (rec_writer *w, async_arg a)
+{
+  put_bytes (w, &a, sizeof (a));
+}
+
+/* Puts n bytes of s (or NULL), preceded by their length */
+static void put_string (rec_writer *w, const char *s, size_t n)
+{
+  async_arg a;
+  a.i = (s ? (long long) n : -1);
+  put_arg (w, a);
+  if (s)
+    {
+      put_bytes (w, s, n);
+      put_bytes (w, "", 1);
+      put_align (w);
+    }
+}
+
+/* Appends the arguments f calls for to w, returning false if they
+ * don't fit. */
+static bool capture_args (rec_writer *w, const async_fmt *f, va_list ap)
+{
+  int c;
+  for (c = 0; c < f->nconv && !w->full; c++)
+    {
+      const conversion cv = f->convs[c];
+      async_arg a;
+      int prec = cv.prec;
+      int i;
+      for (i = 0; i < cv.nstars; i++)
+        {
+          a.i = va_arg (ap, int);
+          if (cv.star_prec && i == cv.nstars - 1)
+            prec = (int) a.i;
+          put_arg (w, a);
+        }
+      switch (cv.kind)
+        {
+          case ARG_NONE:
+            break;
+          case ARG_INT:
+            a.i = va_arg (ap, int);
+            put_arg (w, a);
+            break;
+          case ARG_LONG:
+            a.i = va_arg (ap, long);
+            put_arg (w, a);
+            break;
+          case ARG_LLONG:
+            a.i = va_arg (ap, long long);
+            put_arg (w, a);
+            break;
+          case ARG_INTMAX:
+            a.i = va_arg (ap, intmax_t);
+            put_arg (w, a);
+            break;
+          case ARG_SIZE:
+            a.i = va_arg (ap, size_t);
+            put_arg (w, a);
+            break;
+          case ARG_PTRDIFF:
+            a.i = va_arg (ap, ptrdiff_t);
+            put_arg (w, a);
+            break;
+          case ARG_DOUBLE:
+            a.d = va_arg (ap, double);
+            put_arg (w, a);
+            break;
+          case ARG_LDOUBLE:
+            {
+              const long double ld = va_arg (ap, long double);
+              byte b[ASYNC_ALIGN (sizeof (long double))];
+              memset (b, 0, sizeof (b));
+              memcpy (b, &ld, sizeof (ld));
+              put_bytes (w, b, sizeof (b));
+            }
+            break;
+          case ARG_STRING:
+            {
+              // With a precision, s needn't be NUL-terminated
+              const char *s = va_arg (ap, const char *);
+              put_string (w, s,
+                          !s ? 0 : prec >= 0 ? strnlen (s, prec) : strlen (s));
+            }
+            break;
+          case ARG_POINTER:
+            a.p = va_arg (ap, void *);
+            put_arg (w, a);
+            break;
+        }
+    }
+  return !w->full;
+}
+
+static bool out_reserve (size_t more)
+{
+  if (async_out_len + more <= async_out_cap)
+    return true;
+  size_t cap = 2 * async_out_cap;
+  if (cap < async_out_len + more)
+    cap = async_out_len + more + 256;
+  char *tmp = (char *) realloc (async_out, cap);
+  if (!tmp)
+    return false;
+  async_out = tmp;
+  async_out_cap = cap;
+  return true;
+}
+
+static bool out_append (const char *s, size_t n)
+{
+  if (!out_reserve (n))
+    return false;
+  memcpy (async_out + async_out_len, s, n);
+  async_out_len += n;
+  return true;
+}
+
+static async_arg next_arg (const byte **cur)
+{
+  async_arg a;
+  memcpy (&a, *cur, sizeof (a));
+  *cur += sizeof (a);
+  return a;
+}
+
+#define FORMAT_STARRED(val)                                                    \
+  (nstars == 0                                                                 \
+     ? snprintf (dst, room, spec, val)                                         \
+     : nstars == 1 ? snprintf (dst, room, spec, stars[0], val)                 \
+                   : snprintf (dst, room, spec, stars[0], stars[1], val))
+
+/* Formats one conversion (whose arguments start at *cur) onto the end
+ * of async_out. */
+static bool out_format (const char *spec, const conversion *cv,
+                        const byte **cur)
+{
+  const int nstars = cv->nstars;
+  int stars[2];
+  int i;
+  for (i = 0; i < nstars; i++)
+    stars[i] = (int) next_arg (cur).i;
+  async_arg a;
+  a.i = 0;
+  long double ld = 0;
+  const char *str = NULL;
+  if (cv->kind == ARG_LDOUBLE)
+    {
+      memcpy (&ld, *cur, sizeof (ld));
+      *cur += ASYNC_ALIGN (sizeof (long double));
+    }
+  else if (cv->kind == ARG_STRING)
+    {
+      a = next_arg (cur);
+      if (a.i >= 0)
+        {
+          str = (const char *) *cur;
+          *cur += ASYNC_ALIGN (a.i + 1);
+        }
+    }
+  else
+    a = next_arg (cur);
+
+  for (;;)
+    {
+      char *dst = async_out + async_out_len;
+      const size_t room = async_out_cap - async_out_len;
+      int n;
+      switch (cv->kind)
+        {
+          case ARG_INT:
+            n = FORMAT_STARRED ((int) a.i);
+            break;
+          case ARG_LONG:
+            n = FORMAT_STARRED ((long) a.i);
+            break;
+          case ARG_LLONG:
+            n = FORMAT_STARRED (a.i);
+            break;
+          case ARG_INTMAX:
+            n = FORMAT_STARRED ((intmax_t) a.i);
+            break;
+          case ARG_SIZE:
+            n = FORMAT_STARRED ((size_t) a.i);
+            break;
+          case ARG_PTRDIFF:
+            n = FORMAT_STARRED ((ptrdiff_t) a.i);
+            break;
+          case ARG_DOUBLE:
+            n = FORMAT_STARRED (a.d);
+            break;
+          case ARG_LDOUBLE:
+            n = FORMAT_STARRED (ld);
+            break;
+          case ARG_STRING:
+            n = FORMAT_STARRED (str);
+            break;
+          case ARG_POINTER:
+            n = FORMAT_STARRED (a.p);
+            break;
+          default:
+            n = -1;
+            break;
+        }
+      if (n < 0)
+        return false;
+      if ((size_t) n < room)
+        {
+          async_out_len += n;
+          return true;
+        }
+      if (!out_reserve (n + 1))
+        return false;
+    }
+}
+
+#undef FORMAT_STARRED
+
+/* Formats the message in rec, returning NULL if that didn't work out */
+static char *format_record (const async_rec *rec)
+{
+  const async_fmt *f = rec->fmt;
+  const byte *cur = (const byte *) rec + ASYNC_HDR;
+  async_out_len = 0;
+  const char *p = f->text;
+  int c;
+  for (c = 0; c < f->nconv; c++)
+    {
+      const conversion *cv = &f->convs[c];
+      const char *pct = f->text + cv->start;
+      char spec[32];
+      if (!out_append (p, pct - p))
+        return NULL;
+      memcpy (spec, pct, cv->len);
+      spec[cv->len] = 0;
+      if (cv->kind == ARG_NONE ? !out_append ("%", 1)
+                               : !out_format (spec, cv, &cur))
+        return NULL;
+      p = pct + cv->len;
+    }
+  if (!out_append (p, strlen (p)))
+    return NULL;
+  if ((async_out_len == 0 || async_out[async_out_len - 1] != '\n')
+      && !out_append ("\n", 1))
+    return NULL;
+  if (!out_append ("", 1))
+    return NULL;
+  return async_out;
+}
+
+static void async_emit (const async_rec *rec)
+{
+  time_cache now;
+  now.tv = rec->tv;
+  now.got_time = true;
+  now.tid = rec->tid;
+  now.is_main = rec->is_main;
+  now.got_tid = true;
+  const char *file = rec->file->text;
+  char *msg = format_record (rec);
+  if (msg)
+    log_lines (rec->flags, &now, file, rec->lineno, rec->lvl, rec->code, msg);
+  else
+    // same as when vasprintf fails, below
+    ob_log_internal (rec->flags, &now, 1, 1, file, rec->lineno, rec->lvl,
+                     rec->code, rec->fmt->text);
+}
+
+/* The oldest unread record in r, or NULL if there isn't one */
+static const async_rec *async_peek (async_ring *r)
+{
+  for (;;)
+    {
+      if (r->tail == r->head_seen
+          && r->tail == (r->head_seen =
+                           __atomic_load_n (&r->head, __ATOMIC_ACQUIRE)))
+        return NULL;
+      const async_rec *rec =
+        (const async_rec *) ((byte *) r->buf + r->tail % ASYNC_RING_BYTES);
+      if (!rec->skip)
+        return rec;
+      __atomic_store_n (&r->tail, r->tail + rec->size, __ATOMIC_RELEASE);
+    }
+}
+
+/* Logs everything that's queued, oldest first, returning true if
+ * there was anything. */
+static bool async_drain (void)
+{
+  bool any = false;
+  for (;;)
+    {
+      async_ring *best = NULL;
+      const async_rec *oldest = NULL;
+      async_ring *r;
+      for (r = __atomic_load_n (&async_rings, __ATOMIC_ACQUIRE); r;
+           r = r->next)
+        {
+          const async_rec *rec = async_peek (r);
+          if (rec && (!oldest || timercmp (&rec->tv, &oldest->tv, <)))
+            best = r, oldest = rec;
+        }
+      if (!best)
+        return any;
+      async_emit (oldest);
+      __atomic_store_n (&best->tail, best->tail + oldest->size,
+                        __ATOMIC_RELEASE);
+      any = true;
+    }
+}
+
+static bool async_pending (void)
+{
+  async_ring *r;
+  for (r = ob_atomic_pointer_ref (&async_rings); r; r = r->next)
+    if (ob_atomic_int64_ref (&r->head) != ob_atomic_int64_ref (&r->tail))
+      return true;
+  return false;
+}
+
+static void async_wake_up (void)
+{
+  pthread_mutex_lock (&async_mutex);
+  pthread_cond_signal (&async_wake);
+  pthread_mutex_unlock (&async_mutex);
+}
+
+static void *async_main (OB_UNUSED void *ignored)
+{
+  for (;;)
+    {
+      const bool any = async_drain ();
+      pthread_mutex_lock (&async_mutex);
+      pthread_cond_broadcast (&async_drained);
+      if (!any)
+        {
+          if (async_stop)
+            {
+              pthread_mutex_unlock (&async_mutex);
+              return NULL;
+            }
+          // Loggers check async_sleeping after they've queued
+          // something, so either we see their message here, or they
+          // see that we're sleeping and wake us up.  The timeout is
+          // just to be on the safe side.
+          ob_atomic_int32_set (&async_sleeping, 1);
+          if (!async_pending ())
+            {
+              struct timespec ts;
+              struct timeval tv;
+              gettimeofday (&tv, NULL);
+              ts.tv_sec = tv.tv_sec + 1;
+              ts.tv_nsec = 1000 * tv.tv_usec;
+              pthread_cond_timedwait (&async_wake, &async_mutex, &ts);
+            }
+          ob_atomic_int32_set (&async_sleeping, 0);
+        }
+      pthread_mutex_unlock (&async_mutex);
+    }
+}
+
+/* Starts the background thread if it isn't already, and returns true
+ * if it's running. */
+static bool async_running (void)
+{
+  int32 st = __atomic_load_n (&async_state, __ATOMIC_ACQUIRE);
+  if (st == ASYNC_IDLE)
+    {
+      pthread_mutex_lock (&async_mutex);
+      if (async_state == ASYNC_IDLE)
+        {
+          // Signals are for somebody else to handle
+          sigset_t all, old;
+          sigfillset (&all);
+          pthread_sigmask (SIG_SETMASK, &all, &old);
+          async_stop = false;
+          const int erryes =
+            pthread_create (&async_thread, NULL, async_main, NULL);
+          pthread_sigmask (SIG_SETMASK, &old, NULL);
+          ob_atomic_int32_set (&async_state,
+                               erryes ? ASYNC_DEAD : ASYNC_RUNNING);
+        }
+      st = async_state;
+      pthread_mutex_unlock (&async_mutex);
+    }
+  return st == ASYNC_RUNNING;
+}
+
+static void async_release_ring (void *v)
+{
+  async_ring *r = (async_ring *) v;
+  ob_atomic_int32_set (&r->owned, 0);
+}
+
+/* This thread's ring, claiming one if it hasn't already */
+static async_ring *async_my_ring (void)
+{
+  async_ring *r = (async_ring *) pthread_getspecific (async_key);
+  if (r)
+    return r;
+  for (r = ob_atomic_pointer_ref (&async_rings); r; r = r->next)
+    if (ob_atomic_int32_compare_and_swap (&r->owned, 0, 1))
+      break;
+  if (!r)
+    {
+      if (!(r = (async_ring *) calloc (1, sizeof (async_ring))))
+        return NULL;
+      r->owned = 1;
+      async_ring *head;
+      do
+        {
+          head = ob_atomic_pointer_ref (&async_rings);
+          r->next = head;
+        }
+      while (!ob_atomic_pointer_compare_and_swap (&async_rings, head, r));
+    }
+  if (0 != pthread_setspecific (async_key, r))
+    {
+      async_release_ring (r);
+      return NULL;
+    }
+  ob_get_small_integer_thread_id (&r->tid, &r->is_main);
+  return r;
+}
+
+/* Waits for room for n bytes in r, and returns where to put them, or
+ * NULL if the background thread has gone away.  *advance gets how far
+ * head should move once they're there, which includes skipping the
+ * rest of the ring if they won't fit before the end. */
+static async_rec *async_reserve (async_ring *r, size_t n, size_t *advance)
+{
+  size_t off = r->head % ASYNC_RING_BYTES;
+  const size_t to_end = ASYNC_RING_BYTES - off;
+  const size_t need = (n > to_end ? to_end + n : n);
+  while (r->head + need - r->tail_seen > ASYNC_RING_BYTES)
+    {
+      r->tail_seen = __atomic_load_n (&r->tail, __ATOMIC_ACQUIRE);
+      if (r->head + need - r->tail_seen <= ASYNC_RING_BYTES)
+        break;
+      if (ob_atomic_int32_ref (&async_state) != ASYNC_RUNNING
+          || pthread_equal (pthread_self (), async_thread))
+        return NULL;
+      // The background thread has some catching up to do
+      async_wake_up ();
+      ob_micro_sleep (100);
+    }
+  byte *base = (byte *) r->buf;
+  if (n > to_end)
+    {
+      async_rec *pad = (async_rec *) (base + off);
+      pad->size = to_end;
+      pad->skip = true;
+      off = 0;
+    }
+  *advance = need;
+  return (async_rec *) (base + off);
+}
+
+/* Queues a message for the background thread, returning false if it
+ * should be logged synchronously after all.  If msg isn't NULL, it's
+ * the message already formatted, and fmt and ap are ignored. */
+static bool async_log (int32 flags, const char *file, int lineno,
+                       ob_log_level *lvl, unt64 code, const char *msg,
+                       const char *fmt, va_list ap)
+{
+  if (!async_key_ok || !async_running ())
+    return false;
+  async_ring *r = async_my_ring ();
+  if (!r)
+    return false;
+  const async_fmt *ffile = async_intern (async_files, file, false);
+  if (!ffile)
+    {
+      // Don't get ahead of what's already queued
+      ob_log_flush ();
+      return false;
+    }
+
+  unt64 stage[ASYNC_STAGE_BYTES / sizeof (unt64)];
+  rec_writer w;
+  w.buf = (byte *) stage;
+  w.cap = sizeof (stage);
+  w.len = ASYNC_HDR;
+  w.full = false;
+  char *formatted = NULL;
+  const async_fmt *f;
+  bool ok = false;
+  if (msg)
+    {
+      f = &async_percent_s;
+      put_string (&w, msg, strlen (msg));
+      ok = !w.full;
+    }
+  else if ((f = async_intern (async_fmts, fmt, true)) && f->nconv >= 0)
+    {
+      va_list aq;
+      va_copy (aq, ap);
+      ok = capture_args (&w, f, aq);
+      va_end (aq);
+    }
+  if (!ok)
+    {
+      // Too big to stage, or a format we can't carry over, so
+      // format it here, and queue the result instead
+      if (!msg)
+        {
+          va_list aq;
+          va_copy (aq, ap);
+          if (vasprintf (&formatted, fmt, aq) < 0)
+            formatted = NULL;
+          va_end (aq);
+          if (!formatted)
+            return false;
+          msg = formatted;
+        }
+      f = &async_percent_s;
+      w.cap = ASYNC_HDR + sizeof (async_arg) + ASYNC_ALIGN (strlen (msg) + 1);
+      w.len = ASYNC_HDR;
+      w.full = false;
+      if (w.cap > ASYNC_MAX_RECORD || !(w.buf = (byte *) malloc (w.cap)))
+        {
+          free (formatted);
+          // Don't get ahead of what's already queued
+          ob_log_flush ();
+          return false;
+        }
+      put_string (&w, msg, strlen (msg));
+    }
+
+  async_rec *hdr = (async_rec *) w.buf;
+  hdr->size = (unt32) w.len;
+  hdr->skip = false;
+  hdr->is_main = r->is_main;
+  hdr->tid = r->tid;
+  hdr->flags = flags;
+  hdr->lineno = lineno;
+  hdr->lvl = lvl;
+  hdr->code = code;
+  hdr->fmt = f;
+  hdr->file = ffile;
+  gettimeofday (&hdr->tv, NULL);
+
+  size_t advance;
+  async_rec *dst = async_reserve (r, w.len, &advance);
+  if (dst)
+    {
+      memcpy (dst, w.buf, w.len);
+      __atomic_store_n (&r->head, r->head + advance, __ATOMIC_RELEASE);
+      // The one full barrier: we mustn't miss async_sleeping being
+      // set by a background thread that missed our message
+      __atomic_thread_fence (__ATOMIC_SEQ_CST);
+      if (__atomic_load_n (&async_sleeping, __ATOMIC_RELAXED))
+        async_wake_up ();
+    }
+  if (w.buf != (byte *) stage)
+    free (w.buf);
+  free (formatted);
+  return (dst != NULL);
+}
+
+static void async_init (void)
+{
+  async_key_ok = (0 == pthread_key_create (&async_key, async_release_ring));
+}
+
+/* Called at exit: lets the background thread finish up, and logs
+ * synchronously from then on. */
+static void async_shutdown (void)
+{
+  pthread_mutex_lock (&async_mutex);
+  const bool running = (async_state == ASYNC_RUNNING);
+  ob_atomic_int32_set (&async_state, ASYNC_DEAD);
+  async_stop = true;
+  pthread_cond_signal (&async_wake);
+  pthread_mutex_unlock (&async_mutex);
+  if (running)
+    pthread_join (async_thread, NULL);
+  // in case anybody snuck something in at the last moment
+  async_drain ();
+}
+
+/* In the child, the background thread is gone, and so are the threads
+ * which owned all but our own ring.  Anything left in their rings is
+ * the parent's to log. */
+static void async_atfork_child (void)
+{
+  async_ring *mine =
+    (async_key_ok ? (async_ring *) pthread_getspecific (async_key) : NULL);
+  async_ring *r;
+  for (r = async_rings; r; r = r->next)
+    {
+      r->tail = r->tail_seen = r->head_seen = r->head;
+      r->owned = (r == mine);
+    }
+  if (mine)
+    ob_get_small_integer_thread_id (&mine->tid, &mine->is_main);
+  pthread_mutex_init (&async_mutex, NULL);
+  pthread_cond_init (&async_wake, NULL);
+  pthread_cond_init (&async_drained, NULL);
+  async_sleeping = 0;
+  if (async_state == ASYNC_RUNNING)
+    async_state = ASYNC_IDLE;
+}
+
+#endif  // _MSC_VER
+
+void ob_log_flush (void)
+{
+#ifndef _MSC_VER
+  if (ob_atomic_int32_ref (&async_state) != ASYNC_RUNNING
+      || pthread_equal (pthread_self (), async_thread))
+    return;
+  // Wait for what's been queued so far, but not for anything queued
+  // while we're waiting
+  async_ring *first = ob_atomic_pointer_ref (&async_rings);
+  async_ring *r;
+  size_t n = 0;
+  for (r = first; r; r = r->next)
+    n++;
+  int64 *heads = (int64 *) malloc (n * sizeof (int64) + 1);
+  if (!heads)
+    return;
+  for (n = 0, r = first; r; r = r->next)
+    heads[n++] = ob_atomic_int64_ref (&r->head);
+  pthread_mutex_lock (&async_mutex);
+  pthread_cond_signal (&async_wake);
+  while (async_state == ASYNC_RUNNING)
+    {
+      for (n = 0, r = first; r; r = r->next)
+        if (ob_atomic_int64_ref (&r->tail) < heads[n++])
+          break;
+      if (!r)
+        break;
+      pthread_cond_wait (&async_drained, &async_mutex);
+    }
+  pthread_mutex_unlock (&async_mutex);
+  free (heads);
+#endif
+}
+
 void ob_log_loc_v (const char *file, int lineno, ob_log_level *lvl, unt64 code,
                    const char *fmt, va_list ap)
 {
@@ -1056,17 +2199,31 @@ void ob_log_loc_v (const char *file, int lineno, ob_log_level *lvl, unt64 code,
   const char *p;
   time_cache now;
   now.got_time = false;
+  now.got_tid = false;
+
+  if (PRINT_FINAL == sp
+      && asprintf (&msg, "rule %s reached maximum count %" OB_FMT_64
+                         "d; suppressing\n",
+                   supcode, maxed_out)
+           < 0)
+    return;
+
+#ifndef _MSC_VER
+  // Stack traces have to come from the thread that logged, and
+  // callbacks might well expect that, too
+  if (0 != (flags & OB_FLG_ASYNC)
+      && 0 == (flags & (OB_FLG_STACK_TRACE | OB_DST_CALLBACK))
+      && async_log (flags, file, lineno, lvl, code, msg, fmt, ap))
+    {
+      free (msg);
+      return;
+    }
+#endif
 
   if (PRINT_FINAL == sp)
     {
-      int vasret = asprintf (&msg, "rule %s reached maximum count %" OB_FMT_64
-                                   "d; suppressing\n",
-                             supcode, maxed_out);
-      if (vasret >= 0)
-        {
-          ob_log_internal (flags, &now, 1, 1, file, lineno, lvl, code, msg);
-          free (msg);
-        }
+      ob_log_internal (flags, &now, 1, 1, file, lineno, lvl, code, msg);
+      free (msg);
     }
   // check for format string with no formats, newline terminated but no
   // internal newlines.
@@ -1086,14 +2243,9 @@ void ob_log_loc_v (const char *file, int lineno, ob_log_level *lvl, unt64 code,
         }
       else
         {
-          int64 totlines = 0;
-          char c = 0;
-          for (p = msg; *p; p++)
-            if ('\n' == (c = *p))
-              totlines++;
-          if (c != '\n')
+          const size_t len = strlen (msg);
+          if (len == 0 || msg[len - 1] != '\n')
             {
-              size_t len = p - msg;
               char *tmp = (char *) realloc (msg, len + 2);
               //             1 for newline + 1 for NUL ^
               if (tmp)
@@ -1101,28 +2253,9 @@ void ob_log_loc_v (const char *file, int lineno, ob_log_level *lvl, unt64 code,
                   tmp[len] = '\n';
                   tmp[len + 1] = 0;
                   msg = tmp;
-                  totlines++;
-                }
-            }
-          int64 nline = 1;
-          char *q;
-          for (q = msg; *q; nline++)
-            {
-              c = 0;
-              char *r = strchr (q, '\n');
-              if (r)
-                {
-                  r++;
-                  c = *r;
-                  *r = 0;
                 }
-              else
-                r = q;
-              ob_log_internal (flags, &now, nline, totlines, file, lineno, lvl,
-                               code, q);
-              *r = c;
-              q = r;
             }
+          log_lines (flags, &now, file, lineno, lvl, code, msg);
           free (msg);
         }
     }
@@ -1180,13 +2313,15 @@ static void ob_log_internal (int32 flags, time_cache *now, int64 nline,
   char tidbuf[16];
   if (0 != (flags & (OB_FLG_SHOW_TID | OB_FLG_SHOW_TID_NONMAIN)))
     {
-      unt32 tid;
-      bool is_main;
-      ob_get_small_integer_thread_id (&tid, &is_main);
-      if (0 != (flags & OB_FLG_SHOW_TID) || !is_main)
+      if (!now->got_tid)
+        {
+          ob_get_small_integer_thread_id (&now->tid, &now->is_main);
+          now->got_tid = true;
+        }
+      if (0 != (flags & OB_FLG_SHOW_TID) || !now->is_main)
         {
           flags |= OB_FLG_SHOW_TID;
-          snprintf (tidbuf, sizeof (tidbuf), "[t%u] ", tid);
+          snprintf (tidbuf, sizeof (tidbuf), "[t%u] ", now->tid);
         }
     }
 
@@ -1461,6 +2596,9 @@ void ob_log_loc_fatal (const char *file, int lineno, ob_log_level *lvl,
   ob_log_loc_v (file, lineno, lvl, code, fmt, ap);
   va_end (ap);
 
+  // abort() doesn't give ob_log_bye a chance to do this
+  ob_log_flush ();
+
   if (exitcode < 0)
     ob_abort_func ();
   else
@@ -1529,6 +2667,9 @@ static ob_log_level oblv_supp =
 /// This implements bug 767
 static void ob_log_bye (void)
 {
+#ifndef _MSC_VER
+  async_shutdown ();
+#endif
   summarize_suppressions (ob_atomic_pointer_ref (&oblv_bug.rules), &oblv_supp);
   summarize_suppressions (ob_atomic_pointer_ref (&oblv_error.rules),
                           &oblv_supp);
@@ -1555,8 +2696,16 @@ static void reset_counts (ob_log_rule *rul)
     }
 }
 
+static void ob_log_atfork_prepare (void)
+{
+  ob_log_flush ();
+}
+
 static void ob_log_atfork_child (void)
 {
+#ifndef _MSC_VER
+  async_atfork_child ();
+#endif
   reset_counts (ob_atomic_pointer_ref (&oblv_bug.rules));
   reset_counts (ob_atomic_pointer_ref (&oblv_error.rules));
   reset_counts (ob_atomic_pointer_ref (&oblv_deprecation.rules));
@@ -82,6 +82,9 @@
  *
  * [no]tid - print thread ID with message
  *
+ * [no]async - format and print messages on a background thread, so
+ *             that logging costs the logging thread very little
+ *
  * none - turn off logging for all codes (same as "????????????????=off")
  *
  * +pattern - always turn on logging from source files that match
@@ -449,6 +452,17 @@ extern "C" {
  */
 #define OB_FLG_SHOW_TID_NONMAIN (1 << 21)
 
+/**
+ * Copy the message's arguments into a per-thread queue, and leave the
+ * formatting and output to a background thread.  Messages from one
+ * thread come out in order; messages from different threads come out
+ * in order of when they were logged.  Levels with OB_FLG_STACK_TRACE
+ * or OB_DST_CALLBACK are always logged synchronously, as is
+ * everything on Windows.  Anything still queued when the process
+ * crashes is lost, so this is best for chatty levels like DEBUG.
+ */
+#define OB_FLG_ASYNC (1 << 20)
+
 typedef struct ob_log_rule
 {
   int64 count;
@@ -700,6 +714,14 @@ static inline bool ob_log_is_level_enabled (const ob_log_level *lvl)
 OB_LOAM_API bool ob_log_is_enabled (const char *file, ob_log_level *lvl,
                                     unt64 code);
 
+/**
+ * Waits until every message logged so far to a level with
+ * OB_FLG_ASYNC has been written out.  This happens automatically
+ * at exit, before a fatal error terminates the process, and before
+ * fork().
+ */
+OB_LOAM_API void ob_log_flush (void);
+
 typedef void (*ob_abort_func_t) (void);
 
 /**
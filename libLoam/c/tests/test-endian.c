@@ -6,6 +6,7 @@
 #include "libLoam/c/ob-endian.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "libLoam/c/ob-sys.h"
 
 // Takes numbers to swap from the command line, rather than hardcoding
@@ -14,6 +15,64 @@
 
 // Takes triples of the form: [16|32|64] value-to-swap expected-result
 
+// Also checks that ob_swap*_array() get the same answer, for arrays
+// of every length up to this many bytes, starting at every alignment
+// an integer of that size could have.
+#define ARRAY_BYTES 300
+
+static bool check_array (unt64 sz, unt64 value, unt64 expected)
+{
+  const size_t size = sz / 8;
+  unt64 buf[ARRAY_BYTES / 8 + 2];
+  size_t off, n, i;
+  for (off = 0; off < 8; off += size)
+    for (n = 0; off + n * size <= ARRAY_BYTES; n++)
+      {
+        byte *p = off + (byte *) buf;
+        // guard bytes, to catch swapping too much
+        memset (buf, 0x5a, sizeof (buf));
+        for (i = 0; i < n; i++)
+          memcpy (p + i * size, &value, size);
+        switch (sz)
+          {
+            case 16:
+              ob_swap16_array ((unt16 *) p, n);
+              break;
+            case 32:
+              ob_swap32_array ((unt32 *) p, n);
+              break;
+            default:
+              ob_swap64_array ((unt64 *) p, n);
+              break;
+          }
+        for (i = 0; i < n; i++)
+          {
+            unt64 actual = 0;
+            memcpy (&actual, p + i * size, size);
+            if (actual != expected)
+              {
+                fprintf (stderr, "Array of %" OB_FMT_SIZE "u at offset %"
+                                 OB_FMT_SIZE "u: for 0x%" OB_FMT_64 "x, "
+                                 "expected 0x%" OB_FMT_64 "x, but element %"
+                                 OB_FMT_SIZE "u was 0x%" OB_FMT_64 "x\n",
+                         n, off, value, expected, i, actual);
+                return false;
+              }
+          }
+        const byte *q = (const byte *) buf;
+        for (i = 0; i < sizeof (buf); i++)
+          if ((q + i < p || q + i >= p + n * size) && q[i] != 0x5a)
+            {
+              fprintf (stderr, "Array of %" OB_FMT_SIZE "u at offset %"
+                               OB_FMT_SIZE "u: swapped byte %" OB_FMT_SIZE
+                               "u, outside the array\n",
+                       n, off, i);
+              return false;
+            }
+      }
+  return true;
+}
+
 int main (int argc, char **argv)
 {
   if (argc < 2 || 0 != ((argc - 1) % 3))
@@ -54,6 +113,9 @@ int main (int argc, char **argv)
                    value, expected, actual);
           return EXIT_FAILURE;
         }
+
+      if (!check_array (sz, value, expected))
+        return EXIT_FAILURE;
     }
 
   return EXIT_SUCCESS;
@@ -50,6 +50,8 @@
 #include "libLoam/c/ob-hash.h"
 #include "libLoam/c/ob-log.h"
 
+#include <string.h>
+
 static const unt64 kSeed0 = 1234567;
 static const unt64 kSeed1 = OB_CONST_U64 (0xc3a5c85c97cb3127);
 enum
@@ -398,11 +400,43 @@ static void test (const unt64* expected, size_t offset, size_t len)
   check (expected[3], h64);
 }
 
+/* CRC-32C check value, and the test vectors from RFC 3720, B.4.
+ * Then, since big buffers go several streams at a time, make sure
+ * that checksumming all of data at once gives the same answer as
+ * checksumming it in pieces too small for that. */
+static void test_crc32c (void)
+{ unt8 buf[32];
+  size_t i;
+  check (0xe3069283, ob_crc32c ("123456789", 9, 0));
+  memset (buf, 0, sizeof (buf));
+  check (0x8a9136aa, ob_crc32c (buf, sizeof (buf), 0));
+  memset (buf, 0xff, sizeof (buf));
+  check (0x62a8ab43, ob_crc32c (buf, sizeof (buf), 0));
+  for (i = 0  ;  i < sizeof (buf)  ;  i++)
+    buf[i] = i;
+  check (0x46dd794e, ob_crc32c (buf, sizeof (buf), 0));
+  for (i = 0  ;  i < sizeof (buf)  ;  i++)
+    buf[i] = 31 - i;
+  check (0x113fdb5c, ob_crc32c (buf, sizeof (buf), 0));
+
+  unt32 crc = 0;
+  size_t off, len;
+  for (off = 0, len = 1  ;  off < kDataSize  ;  off += len, len = 2 * len + 3)
+    { if (len > kDataSize - off)
+        len = kDataSize - off;
+      crc = ob_crc32c (data + off, len, crc);
+    }
+  check (crc, ob_crc32c (data, kDataSize, 0));
+  check (ob_crc32c (data + 7, 12345, 0),
+         ob_crc32c (data + 12, 12340, ob_crc32c (data + 7, 5, 0)));
+}
+
 int main (int argc, char** argv)
 { setup ();
   size_t i = 0;
   for (  ;  i < kTestSize - 1  ;  i++)
     test (testdata[i], i * i, i);
   test (testdata[i], 0, kDataSize);
+  test_crc32c ();
   return errors > 0;
 }
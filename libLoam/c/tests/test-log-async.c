@@ -0,0 +1,251 @@
+/* (c)  oblong industries */
+
+// Test of asynchronous logging (OB_FLG_ASYNC): messages should come
+// out exactly as they would have synchronously, even if their
+// arguments change right after logging, each thread's messages should
+// come out in order, rules added along the way should take effect,
+// and nothing should get lost or repeated across a fork.
+
+#include "libLoam/c/ob-sys.h"
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-pthread.h"
+#include "libLoam/c/ob-string.h"
+#include "libLoam/c/ob-util.h"
+#include "libLoam/c/private/ob-syslog.h"
+#include <stdlib.h>
+#include <stdio.h>
+#ifndef _MSC_VER
+#include <sys/wait.h>
+#endif
+
+#define NTHREADS 4
+#define NMESSAGES 5000
+
+static ob_log_level async_lvl = {OB_DST_FD | OB_FLG_ASYNC,
+                                 0, /* no color */
+                                 LOG_INFO,
+                                 -1,
+                                 "",
+                                 NULL,
+                                 NULL,
+                                 NULL,
+                                 NULL};
+
+static ob_log_level rules_lvl = {OB_DST_FD | OB_FLG_ASYNC,
+                                 0, /* no color */
+                                 LOG_INFO,
+                                 -1,
+                                 "",
+                                 NULL,
+                                 NULL,
+                                 NULL,
+                                 NULL};
+
+static char expected[65536];
+
+// Logs asynchronously, and also notes what synchronous formatting
+// would have produced
+#define BOTH(...)                                                              \
+  do                                                                           \
+    {                                                                          \
+      char buf_[4096];                                                         \
+      snprintf (buf_, sizeof (buf_), __VA_ARGS__);                             \
+      ob_safe_append_string (expected, sizeof (expected), buf_);               \
+      ob_safe_append_string (expected, sizeof (expected), "\n");               \
+      ob_log (&async_lvl, 0, __VA_ARGS__);                                     \
+    }                                                                          \
+  while (0)
+
+static FILE *start_output (ob_log_level *lvl)
+{
+  FILE *f = tmpfile ();
+  if (!f)
+    error_exit ("tmpfile failed\n");
+  lvl->fd = fileno (f);
+  return f;
+}
+
+/// Flushes, and returns everything that was logged to f
+static char *finish_output (FILE *f)
+{
+  ob_log_flush ();
+  if (0 != fseek (f, 0, SEEK_END))
+    error_exit ("fseek failed\n");
+  const long len = ftell (f);
+  char *s = (char *) calloc (1, len + 1);
+  if (!s)
+    error_exit ("out of memory\n");
+  rewind (f);
+  if (len > 0 && 1 != fread (s, len, 1, f))
+    error_exit ("fread failed\n");
+  fclose (f);
+  return s;
+}
+
+static void check (const char *what, const char *got, const char *want)
+{
+  if (0 != strcmp (got, want))
+    error_exit ("%s: got\n%s\nbut expected\n%s\n", what, got, want);
+}
+
+static void test_formats (void)
+{
+  FILE *f = start_output (&async_lvl);
+  expected[0] = 0;
+
+  BOTH ("no arguments at all");
+  BOTH ("%d %i %u %x %X %o %c", -5, 7, 3000000000u, 255, 255, 8, 'z');
+  BOTH ("%hd %hhu %ld %lld %" OB_FMT_64 "x %zu %td %jd", (short) -3,
+        (unsigned char) 200, -123456789L, -1234567890123LL,
+        OB_CONST_U64 (0xfeedfacecafebeef), (size_t) 42, (ptrdiff_t) -7,
+        (intmax_t) 99);
+  BOTH ("%5d|%-5d|%05d|%+d|% d|%#x|%'d", 42, 42, 42, 42, 42, 42, 1234567);
+  BOTH ("%*d|%-*d|%.*f|%*.*f", 6, 42, 6, 42, 3, 3.14159, 10, 2, 2.71828);
+  BOTH ("%f %e %g %a %.3f %10.4E %G", 1.5, 12345.678, 0.0001, 1.0, 2.0 / 3,
+        -6.02e23, 1e-10);
+  BOTH ("%Lf %.2Le", (long double) 1.5, (long double) 12345.5);
+  BOTH ("%s|%10s|%-10s|%.3s|%.*s", "abc", "right", "left", "truncate", 2,
+        "xyz");
+  BOTH ("%p %p", (void *) &expected, (void *) NULL);
+  BOTH ("100%% sure, %d%%", 99);
+  BOTH ("%2$s %1$s", "world", "hello");
+
+  // With a precision, a string needn't be NUL-terminated
+  const char unterminated[3] = {'h', 'i', '!'};
+  BOTH ("%.2s|%.*s", unterminated, 3, unterminated);
+
+  // The argument is copied when it's logged, not when it's printed
+  char word[] = "before";
+  ob_log (&async_lvl, 0, "%s\n", word);
+  strcpy (word, "after!");
+  ob_safe_append_string (expected, sizeof (expected), "before\n");
+
+  ob_log (&async_lvl, 0, "two\nlines");
+  ob_safe_append_string (expected, sizeof (expected),
+                         "(1/2): two\n(2/2): lines\n");
+
+  // Too big to stage, and too big to queue at all
+  static char big[3000], huge[20000];
+  memset (big, 'b', sizeof (big) - 1);
+  memset (huge, 'h', sizeof (huge) - 1);
+  BOTH ("%s", big);
+  ob_log (&async_lvl, 0, "%s", huge);
+  ob_safe_append_string (expected, sizeof (expected), huge);
+  ob_safe_append_string (expected, sizeof (expected), "\n");
+  BOTH ("after the huge one");
+
+  char *got = finish_output (f);
+  check ("formats", got, expected);
+  free (got);
+}
+
+static void *chatter (void *v)
+{
+  const int who = (int) (intptr_t) v;
+  int i;
+  for (i = 0; i < NMESSAGES; i++)
+    ob_log (&async_lvl, 0, "thread %d message %d %s", who, i,
+            "and some padding to fill up the ring a bit faster");
+  return NULL;
+}
+
+static void test_threads (void)
+{
+  FILE *f = start_output (&async_lvl);
+  pthread_t thr[NTHREADS];
+  int i;
+  for (i = 0; i < NTHREADS; i++)
+    CHECK_PTHREAD_ERROR (
+      pthread_create (&thr[i], NULL, chatter, (void *) (intptr_t) i));
+  for (i = 0; i < NTHREADS; i++)
+    CHECK_PTHREAD_ERROR (pthread_join (thr[i], NULL));
+
+  char *got = finish_output (f);
+  int next[NTHREADS] = {0};
+  char *line, *lasts = NULL;
+  for (line = strtok_r (got, "\n", &lasts); line;
+       line = strtok_r (NULL, "\n", &lasts))
+    {
+      int who, n;
+      if (2 != sscanf (line, "thread %d message %d", &who, &n) || who < 0
+          || who >= NTHREADS)
+        error_exit ("garbled line '%s'\n", line);
+      if (n != next[who])
+        error_exit ("thread %d: got message %d, expected %d\n", who, n,
+                    next[who]);
+      next[who]++;
+    }
+  for (i = 0; i < NTHREADS; i++)
+    if (next[i] != NMESSAGES)
+      error_exit ("thread %d: only got %d messages\n", i, next[i]);
+  free (got);
+}
+
+static void test_rules (void)
+{
+  FILE *f = start_output (&rules_lvl);
+  int i;
+
+  // so that there's a rule list, and lookups get remembered
+  OB_DIE_ON_ERROR (ob_suppress_message (&rules_lvl, 0xdead));
+  for (i = 0; i < 3; i++)
+    ob_log (&rules_lvl, 0x10fffff5, "before suppression %d\n", i);
+  OB_DIE_ON_ERROR (ob_suppress_message (&rules_lvl, 0x10fffff5));
+  for (i = 0; i < 3; i++)
+    ob_log (&rules_lvl, 0x10fffff5, "after suppression %d\n", i);
+
+  OB_DIE_ON_ERROR (ob_log_add_file_rule (&rules_lvl, "no-such-file*", true));
+  for (i = 0; i < 3; i++)
+    ob_log (&rules_lvl, 0, "before file rule %d\n", i);
+  OB_DIE_ON_ERROR (ob_log_add_file_rule (&rules_lvl, "*test-log-async*",
+                                         false));
+  for (i = 0; i < 3; i++)
+    ob_log (&rules_lvl, 0, "after file rule %d\n", i);
+
+  char *got = finish_output (f);
+  check ("rules", got, "before suppression 0\n"
+                       "before suppression 1\n"
+                       "before suppression 2\n"
+                       "before file rule 0\n"
+                       "before file rule 1\n"
+                       "before file rule 2\n");
+  free (got);
+}
+
+#ifndef _MSC_VER
+static void test_fork (void)
+{
+  FILE *f = start_output (&async_lvl);
+  ob_log (&async_lvl, 0, "parent before fork\n");
+  const pid_t kid = fork ();
+  if (kid < 0)
+    error_exit ("fork failed\n");
+  if (kid == 0)
+    {
+      ob_log (&async_lvl, 0, "child\n");
+      exit (EXIT_SUCCESS);
+    }
+  int status = 0;
+  if (waitpid (kid, &status, 0) != kid || !WIFEXITED (status)
+      || WEXITSTATUS (status) != EXIT_SUCCESS)
+    error_exit ("child failed\n");
+  ob_log (&async_lvl, 0, "parent after fork\n");
+
+  char *got = finish_output (f);
+  check ("fork", got, "parent before fork\n"
+                      "child\n"
+                      "parent after fork\n");
+  free (got);
+}
+#endif
+
+int main (int argc, char **argv)
+{
+  test_formats ();
+  test_threads ();
+  test_rules ();
+#ifndef _MSC_VER
+  test_fork ();
+#endif
+  return EXIT_SUCCESS;
+}
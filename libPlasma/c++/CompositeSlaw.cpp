@@ -110,6 +110,24 @@ CompositeSlaw::Ref CompositeSlaw::Ingests () const
   return result;
 }
 
+/* ---------------------------------------------------------------------- */
+// List interface
+
+CompositeSlaw::Ref CompositeSlaw::Append (const SlawRefs &more) const
+{
+  SlawRefs cmps = Components ();
+  cmps.insert (cmps.end (), more.begin (), more.end ());
+  return List (cmps);
+}
+
+CompositeSlaw::Ref CompositeSlaw::ReplaceNth (int64 idx, SlawRef elem) const
+{
+  SlawRefs cmps = Components ();
+  if (idx >= 0 && idx < int64 (cmps.size ()))
+    cmps[idx] = elem;
+  return List (cmps);
+}
+
 /* ---------------------------------------------------------------------- */
 // Factory functions
 
@@ -74,6 +74,11 @@ class OB_PLASMAXX_API CompositeSlaw
   virtual SlawRefs DescripList () const = 0;
   virtual SlawRefs IngestList () const = 0;
 
+  // New lists, with more on the end, or with element idx replaced
+  // (if there is one).  Lists share what they can with this one.
+  virtual Ref Append (const SlawRefs &more) const;
+  virtual Ref ReplaceNth (int64 idx, SlawRef elem) const;
+
   bool Equals (const CompositeSlaw *other) const;
 
   SlawRefs Components () const;
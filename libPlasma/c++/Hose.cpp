@@ -97,6 +97,42 @@ ObRetort_DepositInfo Hose::Deposit (const Protein &prot)
 }
 
 
+::std::vector<ObRetort_DepositInfo>
+Hose::DepositBatch (const ::std::vector<Protein> &proteins)
+{
+  const size_t n = proteins.size ();
+  if (!is_configured)
+    {
+      last_retort = OB_HOSE_NOT_CONFIGURED;
+      return ::std::vector<ObRetort_DepositInfo> (
+        n, ObRetort_DepositInfo (OB_HOSE_NOT_CONFIGURED));
+    }
+
+  ::std::vector<ObRetort_DepositInfo> result;
+  if (n == 0)
+    {
+      last_retort = OB_OK;
+      return result;
+    }
+
+  ::std::vector<bprotein> ps (n);
+  ::std::vector<int64> idx (n);
+  ::std::vector<pool_timestamp> stamps (n);
+  for (size_t i = 0; i < n; i++)
+    ps[i] = proteins[i].ProteinValue ();
+
+  ob_retort ret =
+    pool_deposit_batch_ex (ph, &ps[0], (int64) n, &idx[0], &stamps[0]);
+  last_retort = ret;
+  result.reserve (n);
+  for (size_t i = 0; i < n; i++)
+    if (idx[i] < 0)
+      result.push_back (ObRetort_DepositInfo (idx[i]));
+    else
+      result.push_back (ObRetort_DepositInfo (OB_OK, idx[i], stamps[i]));
+  return result;
+}
+
 Protein Hose::Current ()
 {
   if (!is_configured)
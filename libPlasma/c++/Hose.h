@@ -10,6 +10,8 @@
 
 #include "libPlasma/c++/Protein.h"
 
+#include <vector>
+
 
 namespace oblong {
 namespace plasma {
@@ -186,6 +188,18 @@ class OB_PLASMAXX_API Hose : public AnkleObject
    */
   virtual ObRetort_DepositInfo Deposit (const Protein &protein);
 
+  /**
+   * Deposits several proteins at once, which for a local pool means
+   * taking the deposit lock (and waking up awaiters) just once, and
+   * for a remote one means a single round trip. Returns one
+   * ObRetort_DepositInfo per protein, in order; all the proteins
+   * that made it into the pool share a timestamp. If a deposit
+   * fails, it and the ones after it are not deposited. Sets
+   * LastRetort () to the first error, or to OB_OK.
+   */
+  virtual ::std::vector<ObRetort_DepositInfo>
+  DepositBatch (const ::std::vector<Protein> &proteins);
+
   /**
    * Fetches the next available protein in the pool, incrementing the
    * index pointer at the same time, so that you can Next (), Next (),
@@ -503,10 +503,10 @@ Slaw Slaw::ListInsert (bslaw s, int64 n) const
 
 Slaw Slaw::ListAppend (const Slaw &s) const
 {
-  detail::SlawRefs cmps = Composite ()->Components ();
+  detail::SlawRefs more;
   if (!s.IsNull ())
-    cmps.push_back (s.SlawRef ());
-  return Slaw (detail::CompositeSlaw::List (cmps));
+    more.push_back (s.SlawRef ());
+  return Slaw (Composite ()->Append (more));
 }
 
 Slaw Slaw::ListPrepend (const Slaw &s) const
@@ -519,19 +519,7 @@ Slaw Slaw::ListPrepend (const Slaw &s) const
 
 Slaw Slaw::ListConcat (const Slaw &other) const
 {
-  const detail::SlawRefs &pre = Composite ()->Components ();
-  const detail::SlawRefs &post = other.Composite ()->Components ();
-  const detail::SRSize N (pre.size ());
-  const detail::SRSize M (post.size ());
-  detail::SlawRefs cmps;
-  if (N + M > 0)
-    {
-      cmps.reserve (N + M);
-      cmps = pre;
-      for (detail::SRSize i = 0; i < M; ++i)
-        cmps.push_back (post[i]);
-    }
-  return Slaw (detail::CompositeSlaw::List (cmps));
+  return Slaw (Composite ()->Append (other.Composite ()->Components ()));
 }
 
 Slaw Slaw::ListRemoveFirst (const Slaw &s) const
@@ -597,21 +585,15 @@ Slaw Slaw::ListReplaceFirst (const Slaw &from, const Slaw &to) const
 
 Slaw Slaw::ListReplaceFirst (bslaw from, const Slaw &to) const
 {
-  int64 idx (IndexOf (from));
-  detail::SlawRefs cmps = Composite ()->Components ();
-  if (idx >= 0 && !to.IsNull ())
-    cmps[idx] = to.SlawRef ();
-  return Slaw (detail::CompositeSlaw::List (cmps));
+  const int64 idx (to.IsNull () ? -1 : IndexOf (from));
+  return Slaw (Composite ()->ReplaceNth (idx, to.SlawRef ()));
 }
 
 Slaw Slaw::ListReplaceNth (int64 n, const Slaw &s) const
 {
   if (n < 0)
     n += Count ();
-  detail::SlawRefs cmps = Composite ()->Components ();
-  if (n >= 0 && n < Count ())
-    cmps[n] = s.SlawRef ();
-  return Slaw (detail::CompositeSlaw::List (cmps));
+  return Slaw (Composite ()->ReplaceNth (n, s.SlawRef ()));
 }
 
 int64 Slaw::IndexOf (bslaw s, unt64 start) const
@@ -986,6 +986,12 @@ class OB_PLASMAXX_API Slaw
    * reinterpreted as a list. If @a s is null, the original list
    * is returned. Appending a non-null Slaw to a null one creates
    * a singleton list with the former as its only element.
+   *
+   * The new list shares this one's elements instead of copying
+   * them, and isn't encoded as a C slaw until something needs it
+   * (SlawValue(), or depositing it), so building a long list by
+   * appending to it over and over takes linear time.  The same goes
+   * for ListConcat and ListReplaceNth.
    * @sa ListPrepend, ListInsert, ListConcat
    */
   Slaw ListAppend (const Slaw &s) const OB_WARN_UNUSED_RESULT;
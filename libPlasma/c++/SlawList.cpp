@@ -8,9 +8,8 @@
 #include "PlasmaStreams.h"
 
 #include <libPlasma/c/protein.h>
+#include <libPlasma/c/slaw-builder.h>
 
-#include <functional>
-#include <algorithm>
 #include <ostream>
 #include <cassert>
 
@@ -135,6 +134,10 @@ SlawList::SlawList (const SlawRefs &elems) : elements_ (elems)
 {
 }
 
+SlawList::SlawList (const SlawRefVector &elems) : elements_ (elems)
+{
+}
+
 /* ---------------------------------------------------------------------- */
 // Typing
 
@@ -149,13 +152,19 @@ bool SlawList::IsNull () const
 }
 
 
+// Encodes the whole list once, straight into a single buffer
 SlawRef SlawList::AsSlaw () const
 {
-  const SlawRefs &cmps = elements_;
-  slabu *sb = slabu_new ();
-  for (int64 i = 0, s = Count (); i < s; ++i)
-    slabu_list_add (sb, cmps[i]);
-  return SlawRef (slaw_list_f (sb));
+  slaw_builder *b = slaw_builder_new ();
+  if (!b)
+    return SlawRef ();
+  slaw_builder_begin_list (b);
+  for (int64 i = 0, s = elements_.Count (); i < s; ++i)
+    slaw_builder_add (b, elements_[i]);
+  slaw_builder_end (b);
+  slaw result = slaw_builder_finish (b);
+  slaw_builder_free (b);
+  return SlawRef (result);
 }
 
 bool SlawList::IsEqual (const CompositeSlaw *other) const
@@ -174,30 +183,26 @@ bool SlawList::IsEqual (const CompositeSlaw *other) const
 
 int64 SlawList::Count () const
 {
-  return elements_.size ();
+  return elements_.Count ();
 }
 
 int64 SlawList::IndexOf (bslaw s, unt64 start) const
 {
-  using namespace std;
-  if (start >= elements_.size ())
-    return -1;
-  ConstSlawIter it = find_if (elements_.begin () + start, elements_.end (),
-                              bind2nd (mem_fun_ref (&SlawRef::Equals), s));
-  if (it == elements_.end ())
-    return -1;
-  return int64 (it - elements_.begin ());
+  for (int64 i = start, len = elements_.Count (); i < len; ++i)
+    if (elements_[i].Equals (s))
+      return i;
+  return -1;
 }
 
 SlawRef SlawList::Nth (int64 n) const
 {
   // don't call Count() because it is virtual and can't be inlined
-  const int64 len = elements_.size ();
+  const int64 len = elements_.Count ();
   if (n < 0)
     n += len;
   if (n < 0 || n >= len)
     return SlawRef ();
-  return elements_[size_t (n)];
+  return elements_[n];
 }
 
 SlawRefs SlawList::Slice (int64 begin, int64 end) const
@@ -208,13 +213,9 @@ SlawRefs SlawList::Slice (int64 begin, int64 end) const
   if (end < 0)
     end = len + end;
 
-  SlawRefs result;
   if (begin >= 0 && end > begin)
-    for (int64 idx = begin, top = (std::min) (len, int64 (end)); idx < top;
-         ++idx)
-      result.push_back (elements_[idx]);
-
-  return result;
+    return elements_.Slice (begin, end);
+  return SlawRefs ();
 }
 
 /* ---------------------------------------------------------------------- */
@@ -223,9 +224,9 @@ SlawRefs SlawList::Slice (int64 begin, int64 end) const
 SlawRef SlawList::Find (bslaw key) const
 {
   SlawRef value;
-  for (ConstSlawIter i = elements_.begin (), e = elements_.end (); i != e; ++i)
+  for (int64 i = 0, len = elements_.Count (); i < len; ++i)
     {
-      const SlawRef &r = *i;
+      const SlawRef &r = elements_[i];
       if (r.IsCons () && slawx_equal (key, slaw_cons_emit_car (r)))
         value = SlawRef (slaw_cons_emit_cdr (r), r);
     }
@@ -240,12 +241,13 @@ unt64 SlawList::KeyCount () const
 SlawRefs SlawList::KVList () const
 {
   SlawRefs result;
-  for (ConstSlawIter i = elements_.begin (), e = elements_.end (); i != e; ++i)
+  for (int64 i = 0, len = elements_.Count (); i < len; ++i)
     {
-      if (i->IsCons ())
+      const SlawRef &r = elements_[i];
+      if (r.IsCons ())
         {
-          result.push_back (SlawRef (slaw_cons_emit_car (*i), *i));
-          result.push_back (SlawRef (slaw_cons_emit_cdr (*i), *i));
+          result.push_back (SlawRef (slaw_cons_emit_car (r), r));
+          result.push_back (SlawRef (slaw_cons_emit_cdr (r), r));
         }
     }
 
@@ -262,21 +264,40 @@ SlawRefs SlawList::IngestList () const
 
 SlawRefs SlawList::DescripList () const
 {
-  return elements_;
+  return elements_.Refs ();
 }
 
 /* ---------------------------------------------------------------------- */
 // Implementation and debugging
 
+// These share our elements rather than copying them, so building a
+// list one element at a time doesn't take quadratic time.
+
+CompositeSlaw::Ref SlawList::Append (const SlawRefs &more) const
+{
+  SlawRefVector elems (elements_);
+  for (SRSize i = 0, n = more.size (); i < n; ++i)
+    elems.Add (more[i]);
+  return Ref (new SlawList (elems));
+}
+
+CompositeSlaw::Ref SlawList::ReplaceNth (int64 idx, SlawRef elem) const
+{
+  SlawRefVector elems (elements_);
+  if (idx >= 0 && idx < elems.Count ())
+    elems.Set (idx, elem);
+  return Ref (new SlawList (elems));
+}
+
 void SlawList::Add (SlawRef elem)
 {
-  elements_.push_back (elem);
+  elements_.Add (elem);
 }
 
 Str SlawList::ToStr () const
 {
   Str r ("[");
-  for (SRSize i = 0, N = elements_.size (); i < N; ++i)
+  for (int64 i = 0, N = elements_.Count (); i < N; ++i)
     {
       r += RefToStr (elements_[i]);
       if (i < N - 1)
@@ -287,9 +308,9 @@ Str SlawList::ToStr () const
 
 void SlawList::Spew (OStreamReference os) const
 {
-  const SRSize LEN = elements_.size ();
+  const int64 LEN = elements_.Count ();
   os.os << "#LIST(" << LEN << ")<" << ::std::endl;
-  for (size_t i = 0; i < LEN; ++i)
+  for (int64 i = 0; i < LEN; ++i)
     os.os << elements_[i] << ::std::endl;
   os.os << ">";
 }
@@ -6,6 +6,7 @@
 
 
 #include "CompositeSlaw.h"
+#include "SlawRefVector.h"
 
 
 namespace oblong {
@@ -19,6 +20,7 @@ class SlawList : public CompositeSlaw
   SlawList ();
   explicit SlawList (SlawRef list);
   explicit SlawList (const SlawRefs &elems);
+  explicit SlawList (const SlawRefVector &elems);
 
   bool IsNull () const override;
   bool IsList () const override;
@@ -33,6 +35,9 @@ class SlawList : public CompositeSlaw
   Str ToStr () const override;
   void Spew (OStreamReference os) const override;
 
+  Ref Append (const SlawRefs &more) const override;
+  Ref ReplaceNth (int64 idx, SlawRef elem) const override;
+
   void Add (SlawRef elem);
 
  private:
@@ -40,7 +45,7 @@ class SlawList : public CompositeSlaw
   SlawRefs DescripList () const override;
   SlawRefs IngestList () const override;
 
-  SlawRefs elements_;
+  SlawRefVector elements_;
 
   friend class SlawMap;
 };
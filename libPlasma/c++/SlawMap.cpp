@@ -7,6 +7,7 @@
 #include "PlasmaStreams.h"
 
 #include <libPlasma/c/protein.h>
+#include <libPlasma/c/slaw-builder.h>
 
 #include <ostream>
 #include <cassert>
@@ -18,6 +19,9 @@ namespace detail {
 
 namespace {
 
+// Maps with fewer entries than this are just searched in order
+const int64 MIN_INDEXED_ENTRIES = 16;
+
 void AddKV (SlawRefs &refs, SlawRef k, SlawRef v)
 {
   if (!k.IsNull () && !v.IsNull ())
@@ -154,20 +158,16 @@ SlawMap::SlawMap (SlawRef ref) : cmps_ (GetComponents (ref))
 {
   if (ref.IsMap ())
     pairs_ = SlawList (ref);
+  BuildIndex ();
 }
 
 SlawMap::SlawMap (const SlawRefs &cs)
 {
   if (LooksLikeAMap (cs))
-    {
-      SlawRefs tmp = UniqueKeys (ExtractPairs (cs));
-      std::swap (tmp, cmps_.elements_);
-    }
+    cmps_.elements_ = SlawRefVector (UniqueKeys (ExtractPairs (cs)));
   else
-    {
-      SlawRefs tmp = UniqueKeys (cs);
-      std::swap (tmp, cmps_.elements_);
-    }
+    cmps_.elements_ = SlawRefVector (UniqueKeys (cs));
+  BuildIndex ();
 }
 
 SlawMap::SlawMap (const Ref &base, SlawRef k, SlawRef v)
@@ -186,6 +186,7 @@ SlawMap::SlawMap (const Ref &base, SlawRef k, SlawRef v)
       cmps_.Add (k);
       cmps_.Add (v);
     }
+  BuildIndex ();
 }
 
 SlawMap::SlawMap (const Ref &base, const Ref &other)
@@ -196,6 +197,7 @@ SlawMap::SlawMap (const Ref &base, const Ref &other)
   kvs = UniqueKeys (kvs);
   for (SlawIter i = kvs.begin (), e = kvs.end (); i != e; ++i)
     cmps_.Add (*i);
+  BuildIndex ();
 }
 
 /* ---------------------------------------------------------------------- */
@@ -213,14 +215,24 @@ bool SlawMap::IsNull () const
 
 SlawRef SlawMap::AsSlaw () const
 {
-  slabu *sb = slabu_new ();
+  slaw_builder *b = slaw_builder_new ();
+  if (!b)
+    return SlawRef ();
   // Make use of our "friend" status to avoid overhead of
   // calling SlawList's virtual functions.
-  for (size_t i = 0, s = cmps_.elements_.size (); i < s; i += 2)
+  const SlawRefVector &kvs = cmps_.elements_;
+  slaw_builder_begin_map (b);
+  for (int64 i = 0, s = kvs.Count (); i + 1 < s; i += 2)
     {
-      slabu_map_put (sb, cmps_.elements_[i], cmps_.elements_[i + 1]);
+      slaw_builder_begin_cons (b);
+      slaw_builder_add (b, kvs[i]);
+      slaw_builder_add (b, kvs[i + 1]);
+      slaw_builder_end (b);
     }
-  return SlawRef (slaw_map_f (sb));
+  slaw_builder_end (b);
+  slaw result = slaw_builder_finish (b);
+  slaw_builder_free (b);
+  return SlawRef (result);
 }
 
 bool SlawMap::IsEqual (const CompositeSlaw *other) const
@@ -272,6 +284,18 @@ int64 SlawMap::IndexOf (bslaw s, unt64 start) const
 
 SlawRef SlawMap::Find (bslaw key) const
 {
+  if (!index_.empty ())
+    {
+      // Should only be one match, but if there's more, the first wins,
+      // same as below.
+      int64 first = -1;
+      auto range = index_.equal_range (slaw_hash (key));
+      for (auto i = range.first; i != range.second; ++i)
+        if ((first < 0 || i->second < first)
+            && slawx_equal (key, cmps_.elements_[i->second]))
+          first = i->second;
+      return (first < 0 ? SlawRef () : cmps_.elements_[first + 1]);
+    }
   for (int64 i = 0, s = cmps_.Count (); i < s; i += 2)
     {
       if (slawx_equal (key, cmps_.Nth (i)))
@@ -325,6 +349,19 @@ void SlawMap::Spew (OStreamReference os) const
 /* ---------------------------------------------------------------------- */
 // Private
 
+// Done once, at construction, since the keys never change after that,
+// and so that Find() doesn't have to modify anything.
+void SlawMap::BuildIndex ()
+{
+  const SlawRefVector &kvs = cmps_.elements_;
+  const int64 n = kvs.Count ();
+  if (n / 2 < MIN_INDEXED_ENTRIES)
+    return;
+  index_.reserve (n / 2);
+  for (int64 i = 0; i + 1 < n; i += 2)
+    index_.emplace (slaw_hash (kvs[i]), i);
+}
+
 void SlawMap::Sync () const
 {
   if (pairs_.Count () == 0)
@@ -7,6 +7,8 @@
 
 #include "SlawList.h"
 
+#include <unordered_map>
+
 
 namespace oblong {
 namespace plasma {
@@ -46,9 +48,13 @@ class SlawMap : public CompositeSlaw
   SlawRefs IngestList () const override;
 
   void Sync () const;
+  void BuildIndex ();
 
   mutable SlawList pairs_;
   SlawList cmps_;
+  // For maps big enough to be worth it: slaw_hash() of each key,
+  // and the position of that key in cmps_.
+  std::unordered_multimap<unt64, int64> index_;
 };
 }
 }
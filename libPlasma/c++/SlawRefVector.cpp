@@ -0,0 +1,141 @@
+/* (c)  oblong industries */
+
+#include "SlawRefVector.h"
+
+#include <algorithm>
+
+
+namespace oblong {
+namespace plasma {
+namespace detail {
+
+
+SlawRefVector::SlawRefVector () : count_ (0), shift_ (BITS)
+{
+}
+
+SlawRefVector::SlawRefVector (const SlawRefs &elems) : count_ (0), shift_ (BITS)
+{
+  // Nobody else can see our nodes yet, so these all happen in place
+  for (SRSize i = 0, n = elems.size (); i < n; ++i)
+    Add (elems[i]);
+}
+
+/* ---------------------------------------------------------------------- */
+// Access
+
+const SlawRefVector::Node *SlawRefVector::LeafFor (int64 idx) const
+{
+  if (idx >= TailOffset ())
+    return tail_.Value ();
+  const Node *n = root_.Value ();
+  for (int level = shift_; level > 0; level -= BITS)
+    n = n->kids[(idx >> level) & MASK].Value ();
+  return n;
+}
+
+SlawRefs SlawRefVector::Slice (int64 begin, int64 end) const
+{
+  SlawRefs result;
+  if (begin < 0)
+    begin = 0;
+  if (end > count_)
+    end = count_;
+  if (end <= begin)
+    return result;
+  result.reserve (end - begin);
+  // A leaf at a time, rather than walking down the tree for each one
+  for (int64 i = begin; i < end;)
+    {
+      const Node *leaf = LeafFor (i);
+      const int64 stop = (std::min) (end, (i | MASK) + 1);
+      for (; i < stop; ++i)
+        result.push_back (leaf->leaves[i & MASK]);
+    }
+  return result;
+}
+
+/* ---------------------------------------------------------------------- */
+// Modification
+
+// Makes sure nobody else can see n, by copying it if they can (or
+// making it, if it doesn't exist yet).  Copying a node adds a
+// reference to each of its children, so they'll get copied in turn
+// if we go down into them.
+void SlawRefVector::Own (NodeRef &n)
+{
+  if (n.Count () == 1)
+    return;
+  Node *fresh = (n.Value () ? new Node (*n.Value ()) : new Node);
+  n = NodeRef (fresh);
+}
+
+SlawRefVector::NodeRef SlawRefVector::NewPath (int level, const NodeRef &leaf)
+{
+  if (level == 0)
+    return leaf;
+  NodeRef n (new Node);
+  n->kids.push_back (NewPath (level - BITS, leaf));
+  return n;
+}
+
+// Hangs the (full) tail off the tree, below parent, at the position
+// of element count_ - 1.
+void SlawRefVector::PushTail (NodeRef &parent, int level)
+{
+  Own (parent);
+  const SRSize sub = ((count_ - 1) >> level) & MASK;
+  std::vector<NodeRef> &kids = parent->kids;
+  if (level == BITS)
+    kids.push_back (tail_);
+  else if (sub < kids.size ())
+    PushTail (kids[sub], level - BITS);
+  else
+    kids.push_back (NewPath (level - BITS, tail_));
+}
+
+void SlawRefVector::Add (SlawRef elem)
+{
+  if (count_ - TailOffset () == WIDTH)
+    {
+      // The tail is full; it goes into the tree, and elem starts a
+      // new one.  If the tree is full too, it grows another level.
+      if ((count_ >> BITS) > (int64 (1) << shift_))
+        {
+          NodeRef top (new Node);
+          top->kids.push_back (root_);
+          top->kids.push_back (NewPath (shift_, tail_));
+          root_ = top;
+          shift_ += BITS;
+        }
+      else
+        PushTail (root_, shift_);
+      tail_ = NodeRef ();
+    }
+  Own (tail_);
+  if (tail_->leaves.empty ())
+    tail_->leaves.reserve (WIDTH);
+  tail_->leaves.push_back (elem);
+  ++count_;
+}
+
+void SlawRefVector::Set (int64 idx, SlawRef elem)
+{
+  if (idx >= TailOffset ())
+    {
+      Own (tail_);
+      tail_->leaves[idx & MASK] = elem;
+      return;
+    }
+  NodeRef *n = &root_;
+  for (int level = shift_; level > 0; level -= BITS)
+    {
+      Own (*n);
+      n = &(*n)->kids[(idx >> level) & MASK];
+    }
+  Own (*n);
+  (*n)->leaves[idx & MASK] = elem;
+}
+}
+}
+}  // namespace oblong::plasma::detail
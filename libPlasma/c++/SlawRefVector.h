@@ -0,0 +1,86 @@
+/* (c)  oblong industries */
+
+#ifndef OBLONG_PLASMA_DETAIL_SLAWREFVECTOR_H
+#define OBLONG_PLASMA_DETAIL_SLAWREFVECTOR_H
+
+
+#include "CompositeSlaw.h"
+
+
+namespace oblong {
+namespace plasma {
+namespace detail {
+
+
+/**
+ * An immutable-looking sequence of SlawRefs, which shares its
+ * storage with the vectors it was copied from.  Copying one is
+ * constant time, and adding to the end of a copy, or replacing one
+ * of its elements, only copies the handful of nodes between the
+ * root and the element in question, rather than the whole thing.
+ * So building a list one element at a time, where each step is a
+ * new list (as Slaw::ListAppend does), is linear rather than
+ * quadratic, and every list along the way is still intact.
+ *
+ * Elements live in a tree of 32-wide nodes (so Nth only has to look
+ * through a few of them, even for a huge list), except for the last
+ * 32 or fewer, which live in a separate "tail" node so that adding
+ * to the end doesn't usually touch the tree at all.  A node which
+ * only one vector can reach is changed in place instead of copied.
+ */
+class SlawRefVector
+{
+ public:
+  SlawRefVector ();
+  explicit SlawRefVector (const SlawRefs &elems);
+
+  int64 Count () const { return count_; }
+  bool IsEmpty () const { return count_ == 0; }
+
+  /// No bounds checking; \a idx must be in [0, Count ()).
+  const SlawRef &operator[] (int64 idx) const
+  {
+    return LeafFor (idx)->leaves[idx & MASK];
+  }
+
+  void Add (SlawRef elem);
+  void Set (int64 idx, SlawRef elem);
+
+  /// Elements [begin, end), already clipped to the vector.
+  SlawRefs Slice (int64 begin, int64 end) const;
+  SlawRefs Refs () const { return Slice (0, count_); }
+
+ private:
+  static const int BITS = 5;
+  static const int64 WIDTH = 1 << BITS;
+  static const int64 MASK = WIDTH - 1;
+
+  struct Node;
+  typedef RefCounted<Node *> NodeRef;
+  struct Node
+  {
+    SlawRefs leaves;
+    std::vector<NodeRef> kids;
+  };
+
+  int64 TailOffset () const
+  {
+    return (count_ < WIDTH ? 0 : ((count_ - 1) >> BITS) << BITS);
+  }
+
+  const Node *LeafFor (int64 idx) const;
+  static void Own (NodeRef &n);
+  static NodeRef NewPath (int level, const NodeRef &leaf);
+  void PushTail (NodeRef &parent, int level);
+
+  int64 count_;
+  int shift_;
+  NodeRef root_;
+  NodeRef tail_;
+};
+}
+}
+}  // namespace oblong::plasma::detail
+
+
+#endif  // OBLONG_PLASMA_DETAIL_SLAWREFVECTOR_H
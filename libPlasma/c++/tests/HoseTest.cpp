@@ -259,6 +259,73 @@ TEST (HoseTest1, DepositInfo)
   EXPECT_EQ (POOL_NO_SUCH_POOL, tort);
 }
 
+TEST (HoseTest1, DepositBatch)
+{
+  const Str pname (PoolTestBase::PoolName ("DepositBatch").c_str ());
+  ObRetort tort;
+  Pool::Configuration conf = Pool::MMAP_SMALL;
+  conf.cpolicy = Pool::Create_Auto_Disposable;
+  Hose *h = Pool::Participate (pname, conf, &tort);
+  EXPECT_TRUE (tort.IsSplend ());
+
+  // Nothing to do is fine
+  ::std::vector<ObRetort_DepositInfo> infos =
+    h->DepositBatch (::std::vector<Protein> ());
+  EXPECT_TRUE (infos.empty ());
+  EXPECT_EQ (OB_OK, h->LastRetort ());
+  EXPECT_EQ (-1, h->NewestIndex ());
+  EXPECT_EQ (POOL_NO_SUCH_PROTEIN, h->LastRetort ());
+
+  // All sorts of proteins, all at once
+  ::std::vector<Protein> batch;
+  batch.push_back (Protein (Slaw::List ("just", "descrips"), Slaw ()));
+  batch.push_back (Protein (Slaw (), Slaw::Map ("just", "ingests")));
+  batch.push_back (Protein (Slaw::List ("both"), Slaw::Map ("n", 3)));
+  const char rude[] = "and some rude data";
+  batch.push_back (
+    Protein (protein_from_ffr (slaw_list_inline_c ("rude", NULL),
+                               slaw_map_inline_cf ("n", slaw_int32 (4), NULL),
+                               rude, sizeof (rude))));
+  infos = h->DepositBatch (batch);
+  EXPECT_EQ (OB_OK, h->LastRetort ());
+  ASSERT_EQ (batch.size (), infos.size ());
+  for (size_t i = 0; i < infos.size (); i++)
+    {
+      EXPECT_EQ (OB_OK, infos[i].Code ());
+      EXPECT_EQ ((int64) i, infos[i].index);
+      EXPECT_LT (0.0, infos[i].timestamp);
+      EXPECT_EQ (infos[0].timestamp, infos[i].timestamp);
+      Protein p = h->Nth (infos[i].index);
+      EXPECT_EQ (batch[i], p);
+      EXPECT_EQ (infos[i].timestamp, p.Timestamp ());
+    }
+
+  // One that isn't a protein spoils the whole batch
+  batch.insert (batch.begin () + 2, Protein::Null ());
+  infos = h->DepositBatch (batch);
+  EXPECT_EQ (POOL_NOT_A_PROTEIN, h->LastRetort ());
+  ASSERT_EQ (batch.size (), infos.size ());
+  for (size_t i = 0; i < infos.size (); i++)
+    {
+      EXPECT_EQ (POOL_NOT_A_PROTEIN, infos[i].Code ());
+      EXPECT_EQ (-1, infos[i].index);
+    }
+  EXPECT_EQ (3, h->NewestIndex ());
+
+  // And a hose that isn't anywhere can't deposit anything
+  tort = h->Withdraw ();
+  EXPECT_TRUE (tort.IsSplend ());
+  batch.erase (batch.begin () + 2);
+  infos = h->DepositBatch (batch);
+  EXPECT_EQ (OB_HOSE_NOT_CONFIGURED, h->LastRetort ());
+  ASSERT_EQ (batch.size (), infos.size ());
+  for (size_t i = 0; i < infos.size (); i++)
+    EXPECT_EQ (OB_HOSE_NOT_CONFIGURED, infos[i].Code ());
+  h->Delete ();
+  tort = Pool::Dispose (pname);
+  EXPECT_EQ (POOL_NO_SUCH_POOL, tort);
+}
+
 TEST (HoseTest1, TocCapacity)
 {
   const Str pname (PoolTestBase::PoolName ("TocCapacity").c_str ());
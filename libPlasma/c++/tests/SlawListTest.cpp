@@ -521,4 +521,61 @@ TEST (SlawListBasicTest, InverseBug2123)
   EXPECT_STREQ ("abc", r);
 }
 
+TEST (SlawListBasicTest, LongAppend)
+{
+  // Enough to need a few levels of the tree that the list's elements
+  // are kept in, with copies along the way that shouldn't change as
+  // the list keeps growing.
+  const int64 N = 40000;
+  Slaw l = Slaw::List ();
+  std::vector<Slaw> snapshots;
+  for (int64 i = 0; i < N; ++i)
+    {
+      if (i % 997 == 0)
+        snapshots.push_back (l);
+      l = l.ListAppend (Slaw (i));
+    }
+  ASSERT_EQ (N, l.Count ());
+  for (int64 i = 0; i < N; ++i)
+    ASSERT_EQ (i, l.Nth (i).Emit<int64> ());
+  for (size_t j = 0; j < snapshots.size (); ++j)
+    {
+      const Slaw &s = snapshots[j];
+      ASSERT_EQ (int64 (j * 997), s.Count ());
+      if (s.Count () > 0)
+        EXPECT_EQ (s.Count () - 1, s.Nth (-1).Emit<int64> ());
+    }
+
+  bslaw c = l.SlawValue ();
+  ASSERT_TRUE (slaw_is_list (c));
+  ASSERT_EQ (N, slaw_list_count (c));
+  int64 k = 0;
+  for (bslaw e = slaw_list_emit_first (c); e; e = slaw_list_emit_next (c, e))
+    EXPECT_EQ (k++, *slaw_int64_emit (e));
+
+  EXPECT_EQ (l.Slice (1000, 1003),
+             Slaw::List (int64 (1000), int64 (1001), int64 (1002)));
+}
+
+TEST (SlawListBasicTest, ReplaceAndConcatShare)
+{
+  Slaw l = Slaw::List ();
+  for (int64 i = 0; i < 2000; ++i)
+    l = l.ListAppend (Slaw (i));
+  Slaw r = l.ListReplaceNth (1500, Slaw ("x"));
+  Slaw r2 = r.ListReplaceNth (-1, Slaw ("y"));
+  EXPECT_EQ (1500, l.Nth (1500).Emit<int64> ());
+  EXPECT_EQ (Slaw ("x"), r.Nth (1500));
+  EXPECT_EQ (1999, r.Nth (1999).Emit<int64> ());
+  EXPECT_EQ (Slaw ("x"), r2.Nth (1500));
+  EXPECT_EQ (Slaw ("y"), r2.Nth (1999));
+  EXPECT_EQ (l, l.ListReplaceNth (2000, Slaw ("z")));
+
+  Slaw c = l.ListConcat (r2);
+  ASSERT_EQ (4000, c.Count ());
+  EXPECT_EQ (c.Slice (0, 2000), l);
+  EXPECT_EQ (c.Slice (2000, 4000), r2);
+  EXPECT_EQ (2000, l.Count ());
+}
+
 }  // namespace
@@ -433,6 +433,35 @@ TEST_F (SlawMapTest, FromSlawConsWithDups)
   slaw_free (kvs[5]);
 }
 
+TEST_F (SlawMapTest, BigMapWithDups)
+{
+  // Big enough to be searched with an index
+  const int N = 100;
+  slabu *sb (slabu_new ());
+  for (int i = 0; i < N; i++)
+    slabu_map_put_cf (sb, ("k" + std::to_string (i)).c_str (), slaw_int64 (i));
+  // slaw_map_f() keeps the last of any duplicates
+  slabu_list_add_f (sb, slaw_cons_cf ("k7", slaw_int64 (1007)));
+  slabu_list_add_f (sb, slaw_cons_ff (slaw_int64 (7), slaw_string ("seven")));
+  Slaw map (slaw_map_f (sb));
+
+  for (int pass = 0; pass < 3; pass++)
+    {
+      for (int i = 0; i < N; i++)
+        EXPECT_EQ (i == 7 ? 1007 : i,
+                   map.Find (("k" + std::to_string (i)).c_str ())
+                     .Emit<int64> ());
+      EXPECT_EQ (Slaw ("seven"), map.Find (int64 (7)));
+      EXPECT_TRUE (map.Find ("k100").IsNull ());
+      EXPECT_TRUE (map.Find (int64 (8)).IsNull ());
+    }
+
+  Slaw bigger = map.MapPut ("k5", "five");
+  EXPECT_EQ (Slaw ("five"), bigger.Find ("k5"));
+  EXPECT_EQ (5, map.Find ("k5").Emit<int64> ());
+  EXPECT_EQ (1007, bigger.Find ("k7").Emit<int64> ());
+}
+
 TEST_F (SlawMapTest, MapRemove)
 {
   Slaw alist (Slaw::List (Slaw::Cons ("a", "b"), Slaw::Cons ("c", "d"),
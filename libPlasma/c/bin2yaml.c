@@ -26,7 +26,7 @@ int main (int argc, char **argv)
   OB_CHECK_ABI ();
 
   ob_retort err;
-  protein p;
+  bprotein p;
   slaw_output out;
   slaw_input in;
   int c;
@@ -58,17 +58,16 @@ int main (int argc, char **argv)
                         slaw_boolean (!lossy), "directives",
                         slaw_boolean (directives), NULL);
 
-  err = slaw_input_open_binary (argv[0], &in);
+  err = slaw_input_open_binary_mapped (argv[0], &in);
   OB_DIE_ON_ERROR (err);
 
   err = slaw_output_open_text_options_f (argv[1], &out, options);
   OB_DIE_ON_ERROR (err);
 
-  while ((err = slaw_input_read (in, &p)) == OB_OK)
+  while ((err = slaw_input_read_borrowed (in, &p)) == OB_OK)
     {
       err = slaw_output_write (out, p);
       OB_DIE_ON_ERROR (err);
-      protein_free (p);
     }
 
   if (err != SLAW_END_OF_FILE)
@@ -10,6 +10,7 @@
 #include "libPlasma/c/pool.h"
 #include "libPlasma/c/pool-time.h"
 #include "libPlasma/c/pool_options.h"
+#include "libPlasma/c/slaw-builder.h"
 #include "libPlasma/c/slaw-coerce.h"
 #include "libPlasma/c/slaw-io.h"
 #include "libPlasma/c/slaw-ordering.h"
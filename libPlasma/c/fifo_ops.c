@@ -550,9 +550,9 @@ ob_retort pool_fifo_await_next_single (pool_hose ph, pool_timestamp timeout,
                                        protein *ret_prot,
                                        pool_timestamp *ret_ts, int64 *ret_index)
 {
-  // Add a fifo and do a final check for a protein deposit
-  ob_retort pret =
-    pool_fifo_multi_add_awaiter (ph, ret_prot, ret_ts, ret_index);
+  // Add a fifo and do a final check for a protein deposit.  (Go
+  // through the hose, since futex pools supply their own.)
+  ob_retort pret = ph->multi_add_awaiter (ph, ret_prot, ret_ts, ret_index);
   // Return on either success or non-transient failure, otherwise we wait
   if (pret != POOL_NO_SUCH_PROTEIN)
     return pret;
@@ -646,6 +646,6 @@ ob_retort pool_fifo_await_next_single (pool_hose ph, pool_timestamp timeout,
           // Otherwise, we got a spurious wakeup, retry
         }
     }
-  pool_fifo_multi_remove_awaiter (ph);
+  ph->multi_remove_awaiter (ph);
   return pret;
 }
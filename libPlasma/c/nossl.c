@@ -46,3 +46,43 @@ ob_retort ob_tls_client_join_thread (pthread_t thr)
 {
   return POOL_NO_TLS;
 }
+
+ob_retort ob_tls_server_start (ob_sock_t sock, bool anon_ok,
+                               bool client_auth_reqd)
+{
+  return POOL_NO_TLS;
+}
+
+ob_retort ob_tls_client_start (ob_sock_t sock, const char *host, bool anon_ok,
+                               const char *certificate,
+                               const char *private_key)
+{
+  return POOL_NO_TLS;
+}
+
+ob_retort ob_tls_send_nbytes (ob_sock_t sock, const void *buf, size_t len,
+                              ob_handle_t wake_event)
+{
+  return POOL_NO_TLS;
+}
+
+ob_retort ob_tls_send_iov (ob_sock_t sock, const struct pool_net_iov *iov,
+                           int n, ob_handle_t wake_event)
+{
+  return POOL_NO_TLS;
+}
+
+ob_retort ob_tls_recv_nbytes (ob_sock_t sock, void *buf, size_t len,
+                              ob_handle_t wake_event)
+{
+  return POOL_NO_TLS;
+}
+
+bool ob_tls_pending (ob_sock_t sock)
+{
+  return false;
+}
+
+void ob_tls_end (ob_sock_t sock, bool notify)
+{
+}
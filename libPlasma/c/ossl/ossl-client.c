@@ -72,3 +72,20 @@ ob_retort ob_tls_client_join_thread (pthread_t thr)
 {
   return ob_ossl_join_thread (thr);
 }
+
+ob_retort ob_tls_client_start (ob_sock_t sock, const char *host, bool anon_ok,
+                               const char *certificate,
+                               const char *private_key)
+{
+  ob_retort tort = ob_tls_client_available ();
+  if (tort < OB_OK)
+    return tort;
+
+  SSL *ssl = NULL;
+  tort = ob_ossl_new_ssl (sock, ossl_client_context,
+                          (ob_tls_num_cert_authorities > 0), anon_ok, false,
+                          certificate, private_key, &ssl);
+  if (tort < OB_OK)
+    return tort;
+  return ob_ossl_start_direct (ssl, EINTR_SSL_connect_harder, host, anon_ok);
+}
@@ -388,7 +388,7 @@ ob_retort ob_ossl_create_context (method_func mfun, SSL_CTX **ctx_out)
       X509_VERIFY_PARAM_free (vp);
 #endif
 
-      // Don't set cipher list here; we set it individually in ob_ossl_launch_thread
+      // Don't set cipher list here; we set it individually in ob_ossl_new_ssl
       // SSL_CTX_set_cipher_list (context, authenticated_ciphers);
       *ctx_out = context;
       OB_LOG_DEBUG_CODE (0x20500003, "created context successfully\n");
@@ -465,21 +465,24 @@ typedef struct
  * once the first SSL_connect call has completed, we can assume the list
  * is sorted, and future SSL_connect calls can happen in parallel.
  * Thus, the two different places in the code below where the mutex
- * can be released: one before the call to SSL_connect (aka args.f)
+ * can be released: one before the call to SSL_connect (aka f)
  * and one after.
  */
 static pthread_mutex_t work_around_ossl_bug_1795 = PTHREAD_MUTEX_INITIALIZER;
 static bool have_connected_before = false;
 #endif
 
-static void *ossl_common_thread_main (void *v)
+/**
+ * Performs the handshake (with \a f, which is SSL_accept or
+ * SSL_connect) on \a ssl, and checks the peer's certificate against
+ * \a host if there is one.  Returns 0 on success, or else an
+ * SSL_ERROR_* code.  t[0] through t[2] are filled in with timestamps
+ * (or, on failure, t[2] and t[3] with the errno and the error).
+ */
+long ob_ossl_handshake (SSL *ssl, conacc_func f, const char *host,
+                        bool anon_ok, unt64 t[4])
 {
-  thread_args *args_ptr = (thread_args *) v;
-  thread_args args = *args_ptr;
-  free (args_ptr);
-  unt64 t[4];
   t[0] = ob_monotonic_time ();
-  OB_LOG_DEBUG_CODE (0x20500005, "started new thread\n");
   transfer_entropy ();
   t[1] = ob_monotonic_time ();
   OB_LOG_DEBUG_CODE (0x20500006, "entropy transfer took %" OB_FMT_64 "u ns\n"
@@ -498,7 +501,7 @@ static void *ossl_common_thread_main (void *v)
       mutex_is_locked = false;
     }
 #endif
-  int ret = args.f (args.B);
+  int ret = f (ssl);
   const int erryes = errno;
 #ifndef _MSC_VER
   if (mutex_is_locked)
@@ -509,7 +512,7 @@ static void *ossl_common_thread_main (void *v)
 #endif
   if (ret != 1)
     {
-      const int interpretation = SSL_get_error (args.B, ret);
+      const int interpretation = SSL_get_error (ssl, ret);
       char *errstack = ob_ossl_err_as_string ();
       char buf[160];
       OB_LOG_ERROR_CODE (0x20500007, "SSL handshake error!\n"
@@ -525,10 +528,10 @@ static void *ossl_common_thread_main (void *v)
       t[3] = interpretation;
       ssl_error = interpretation;
     }
-  else if (args.host[0]
+  else if (host && host[0]
            && X509_V_OK
-                != (err509 = OREILLY_post_connection_check (args.B, args.host,
-                                                            args.anon_ok)))
+                != (err509 = OREILLY_post_connection_check (ssl, host,
+                                                            anon_ok)))
     {
       OB_LOG_ERROR_CODE (0x20500010, "Unhappy about peer certificate: '%s'\n",
                          X509_verify_cert_error_string (err509));
@@ -538,17 +541,31 @@ static void *ossl_common_thread_main (void *v)
     {
       char buf[160], fub[160], vers[32];
       shrink_spaces (fub, sizeof (fub),
-                     SSL_CIPHER_description (SSL_get_current_cipher (args.B),
-                                             buf, sizeof (buf)));
+                     SSL_CIPHER_description (SSL_get_current_cipher (ssl), buf,
+                                             sizeof (buf)));
       OB_LOG_INFO_CODE (0x2050000f,
                         "Connected securely using %s with cipher suite:\n%s",
                         mangle_version (vers, sizeof (vers),
-                                        SSL_get_version (args.B)),
+                                        SSL_get_version (ssl)),
                         fub);
       t[2] = ob_monotonic_time ();
-      OB_LOG_DEBUG_CODE (0x20500008, "handshake took %" OB_FMT_64 "u ns\n"
-                                     "starting data transfer\n",
+      OB_LOG_DEBUG_CODE (0x20500008, "handshake took %" OB_FMT_64 "u ns\n",
                          t[2] - t[1]);
+    }
+  return ssl_error;
+}
+
+static void *ossl_common_thread_main (void *v)
+{
+  thread_args *args_ptr = (thread_args *) v;
+  thread_args args = *args_ptr;
+  free (args_ptr);
+  unt64 t[4];
+  OB_LOG_DEBUG_CODE (0x20500005, "started new thread\n");
+  const long ssl_error =
+    ob_ossl_handshake (args.B, args.f, args.host, args.anon_ok, t);
+  if (ssl_error == 0)
+    {
       OREILLY_data_transfer (args.A, args.B);
       t[3] = ob_monotonic_time ();
       OB_LOG_DEBUG_CODE (0x20500009, "data transfer took %" OB_FMT_64 "u ns\n"
@@ -620,17 +637,11 @@ static EVP_PKEY *string_to_pkey (const char *s, SSL_CTX *context)
   return k;
 }
 
-ob_retort ob_ossl_launch_thread (int clear_sock, int cipher_sock,
-                                 SSL_CTX *context, conacc_func cafunc,
-                                 pthread_t *thr_out, bool auth_suites,
-                                 bool anon_suites, bool client_auth_required,
-                                 const char *host, const char *certificate,
-                                 const char *private_key)
+ob_retort ob_ossl_new_ssl (ob_sock_t cipher_sock, SSL_CTX *context,
+                           bool auth_suites, bool anon_suites,
+                           bool client_auth_required, const char *certificate,
+                           const char *private_key, SSL **ssl_out)
 {
-  thread_args *args = (thread_args *) calloc (1, sizeof (thread_args));
-  if (!args)
-    return OB_NO_MEM;
-
   OB_LOG_DEBUG_CODE (0x2050000b, "creating a new SSL\n");
   SSL *ssl = SSL_new (context);
   if (!ssl || 0 == SSL_set_fd (ssl, cipher_sock))
@@ -641,7 +652,6 @@ ob_retort ob_ossl_launch_thread (int clear_sock, int cipher_sock,
       free (errstack);
       if (ssl)
         SSL_free (ssl);
-      free (args);
       return POOL_TLS_ERROR;
     }
   OB_LOG_DEBUG_CODE (0x2050000c, "finished setting the socket\n");
@@ -662,7 +672,6 @@ ob_retort ob_ossl_launch_thread (int clear_sock, int cipher_sock,
           X509_free (cert);
           EVP_PKEY_free (pkey);
           SSL_free (ssl);
-          free (args);
           return POOL_TLS_ERROR;
         }
       // do something with them
@@ -678,7 +687,6 @@ ob_retort ob_ossl_launch_thread (int clear_sock, int cipher_sock,
           X509_free (cert);
           EVP_PKEY_free (pkey);
           SSL_free (ssl);
-          free (args);
           return POOL_TLS_ERROR;
         }
       // now free them
@@ -700,7 +708,6 @@ ob_retort ob_ossl_launch_thread (int clear_sock, int cipher_sock,
   if (!suites)
     {
       SSL_free (ssl);
-      free (args);
       return OB_NO_MEM;
     }
 
@@ -720,11 +727,34 @@ ob_retort ob_ossl_launch_thread (int clear_sock, int cipher_sock,
       free (errstack);
       free (suites);
       SSL_free (ssl);
-      free (args);
       return POOL_TLS_ERROR;
     }
 
   free (suites);
+  *ssl_out = ssl;
+  return OB_OK;
+}
+
+ob_retort ob_ossl_launch_thread (int clear_sock, int cipher_sock,
+                                 SSL_CTX *context, conacc_func cafunc,
+                                 pthread_t *thr_out, bool auth_suites,
+                                 bool anon_suites, bool client_auth_required,
+                                 const char *host, const char *certificate,
+                                 const char *private_key)
+{
+  thread_args *args = (thread_args *) calloc (1, sizeof (thread_args));
+  if (!args)
+    return OB_NO_MEM;
+
+  SSL *ssl = NULL;
+  ob_retort tort =
+    ob_ossl_new_ssl (cipher_sock, context, auth_suites, anon_suites,
+                     client_auth_required, certificate, private_key, &ssl);
+  if (tort < OB_OK)
+    {
+      free (args);
+      return tort;
+    }
 
   args->A = clear_sock;
   args->B = ssl;
@@ -25,6 +25,12 @@ int OREILLY_verify_callback (int ok, X509_STORE_CTX *store);
 long OREILLY_post_connection_check (SSL *ssl, const char *host, bool anon_ok);
 
 ob_retort ob_ossl_create_context (method_func mfun, SSL_CTX **ctx_out);
+ob_retort ob_ossl_new_ssl (ob_sock_t cipher_sock, SSL_CTX *context,
+                           bool auth_suites, bool anon_suites,
+                           bool client_auth_required, const char *certificate,
+                           const char *private_key, SSL **ssl_out);
+long ob_ossl_handshake (SSL *ssl, conacc_func f, const char *host,
+                        bool anon_ok, unt64 t[4]);
 ob_retort ob_ossl_launch_thread (ob_sock_t clear_sock, ob_sock_t cipher_sock,
                                  SSL_CTX *context, conacc_func cafunc,
                                  pthread_t *thr_out, bool auth_suites,
@@ -32,6 +38,8 @@ ob_retort ob_ossl_launch_thread (ob_sock_t clear_sock, ob_sock_t cipher_sock,
                                  const char *host, const char *certificate,
                                  const char *private_key);
 ob_retort ob_ossl_join_thread (pthread_t thr);
+ob_retort ob_ossl_start_direct (SSL *ssl, conacc_func f, const char *host,
+                                bool anon_ok);
 char *ob_ossl_err_as_string (void);
 const char *ob_ossl_interpretation_as_string (char *buf, size_t buf_len,
                                               int interpretation, int erryes);
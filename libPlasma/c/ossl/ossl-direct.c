@@ -0,0 +1,355 @@
+/* (c)  oblong industries */
+
+// TLS without a thread in the middle.  Once the handshake is done on
+// a pool connection's own socket, pool_net sends and receives through
+// the functions below, which run SSL_write() and SSL_read() right on
+// the caller's buffers.  (Compare ossl-io.c, which shuttles every byte
+// through a socketpair and a thread of its own.)  The SSL for each
+// socket is looked up by file descriptor, since that's all pool_net
+// hands us.
+
+#include "ossl-common.h"
+#include "libLoam/c/ob-sys.h"
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-atomic.h"
+#include "libPlasma/c/plasma-retorts.h"
+#include "libPlasma/c/private/pool-tls.h"
+#include "libPlasma/c/private/pool_impl.h"
+#include "libPlasma/c/private/pool_net.h"
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <errno.h>
+#include <string.h>
+#ifndef _MSC_VER
+#include <signal.h>
+#endif
+
+// The SSLs live in chunks of a table indexed by socket, which are
+// allocated as needed and never freed, so that looking one up takes
+// no lock.  (A socket is only used by one thread at a time, and
+// whoever passes it to another thread synchronizes some other way.)
+#define DIRECT_CHUNK_BITS 10
+#define DIRECT_CHUNK_SIZE (1 << DIRECT_CHUNK_BITS)
+#define DIRECT_CHUNKS 1024
+
+// Small pieces of a message are gathered up to go out as one record
+#define DIRECT_STAGE_SIZE 16384
+
+// Most we hand OpenSSL at once, since it counts in ints
+#define DIRECT_MAX_CHUNK (1 << 30)
+
+static SSL **direct_chunks[DIRECT_CHUNKS];
+
+static SSL **direct_slot (ob_sock_t sock, bool create)
+{
+  const size_t i = (size_t) sock;
+  if (i >= (size_t) DIRECT_CHUNK_SIZE * DIRECT_CHUNKS)
+    return NULL;
+  SSL ***chunk = &direct_chunks[i >> DIRECT_CHUNK_BITS];
+  if (!*chunk && create)
+    {
+      SSL **fresh = (SSL **) calloc (DIRECT_CHUNK_SIZE, sizeof (SSL *));
+      if (fresh && !ob_atomic_pointer_compare_and_swap (chunk, NULL, fresh))
+        free (fresh);
+    }
+  return (*chunk ? *chunk + (i & (DIRECT_CHUNK_SIZE - 1)) : NULL);
+}
+
+static SSL *direct_ssl (ob_sock_t sock)
+{
+  SSL **slot = direct_slot (sock, false);
+  return (slot ? *slot : NULL);
+}
+
+/* SSL_write() and SSL_shutdown() write to the socket themselves, and
+ * there's no way to hand them MSG_NOSIGNAL, so a peer that has gone
+ * away would get a client killed by SIGPIPE.  So hold SIGPIPE off
+ * while they run, and swallow the one we caused, if any. */
+#if defined(_MSC_VER) || defined(SO_NOSIGPIPE)
+typedef int pipe_guard;
+#define guard_pipe(g) (void) (g)
+#define unguard_pipe(g, broke) (void) (g)
+#else
+typedef sigset_t pipe_guard;
+
+static void guard_pipe (pipe_guard *old)
+{
+  sigset_t pipe;
+  sigemptyset (&pipe);
+  sigaddset (&pipe, SIGPIPE);
+  pthread_sigmask (SIG_BLOCK, &pipe, old);
+}
+
+static void unguard_pipe (pipe_guard *old, bool broke)
+{
+  if (broke && !sigismember (old, SIGPIPE))
+    {
+      sigset_t pipe;
+      sigemptyset (&pipe);
+      sigaddset (&pipe, SIGPIPE);
+      const struct timespec zero = {0, 0};
+      while (sigtimedwait (&pipe, NULL, &zero) < 0 && errno == EINTR)
+        ;
+    }
+  pthread_sigmask (SIG_SETMASK, old, NULL);
+}
+#endif
+
+ob_retort ob_ossl_start_direct (SSL *ssl, conacc_func f, const char *host,
+                                bool anon_ok)
+{
+  const ob_sock_t sock = SSL_get_fd (ssl);
+  SSL **slot = direct_slot (sock, true);
+  if (!slot)
+    {
+      OB_LOG_ERROR_CODE (0x20504000, "can't keep track of TLS on socket %d\n",
+                         (int) sock);
+      SSL_free (ssl);
+      return POOL_TLS_ERROR;
+    }
+
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+  // Hanging up without a closure alert is how pool connections end
+  SSL_set_options (ssl, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+#ifdef SSL_OP_ENABLE_KTLS
+  // If the kernel can take over the encryption after the handshake,
+  // let it; OpenSSL quietly carries on by itself if it can't.
+  SSL_set_options (ssl, SSL_OP_ENABLE_KTLS);
+#endif
+
+  unt64 t[4];
+  if (ob_ossl_handshake (ssl, f, host, anon_ok, t) != 0)
+    {
+      SSL_free (ssl);
+      return POOL_TLS_ERROR;
+    }
+
+#ifdef BIO_get_ktls_send
+  OB_LOG_DEBUG_CODE (0x20504001, "kernel TLS: %s for sending, %s for "
+                                 "receiving\n",
+                     BIO_get_ktls_send (SSL_get_wbio (ssl)) ? "yes" : "no",
+                     BIO_get_ktls_recv (SSL_get_rbio (ssl)) ? "yes" : "no");
+#endif
+
+  *slot = ssl;
+  return OB_OK;
+}
+
+/// One send or receive, which might be interrupted by wake_event
+typedef struct
+{
+  SSL *ssl;
+  ob_select2_t sel2;
+  bool waking;
+  size_t done;
+} direct_op;
+
+static ob_retort direct_begin (direct_op *op, ob_sock_t sock,
+                               ob_handle_t wake_event, ob_select2_dir dir)
+{
+  op->ssl = direct_ssl (sock);
+  op->waking = (wake_event != OB_NULL_HANDLE);
+  op->done = 0;
+  if (!op->ssl)
+    {
+      OB_LOG_BUG_CODE (0x20504002, "TLS was never started on socket %d\n",
+                       (int) sock);
+      return POOL_TLS_ERROR;
+    }
+  if (op->waking)
+    return ob_select2_prepare (&op->sel2, dir, sock, wake_event);
+  return OB_OK;
+}
+
+static ob_retort direct_wait (direct_op *op)
+{
+  if (!op->waking)
+    return OB_OK;
+  ob_retort tort = ob_select2 (&op->sel2, POOL_WAIT_FOREVER, true);
+  if (tort == POOL_AWAIT_WOKEN && op->done > 0)
+    return POOL_AWAIT_WOKEN_DIRTY;
+  return tort;
+}
+
+static ob_retort direct_finish (direct_op *op, ob_retort pret)
+{
+  if (op->waking)
+    {
+      ob_retort tort = ob_select2_finish (&op->sel2);
+      if (tort <= OB_OK && pret == OB_OK)
+        return tort;
+    }
+  return pret;
+}
+
+/// Makes a retort out of SSL_read() or SSL_write() returning \a ret
+/// with errno \a erryes, or returns OB_OK if it's worth another go.
+static ob_retort direct_error (direct_op *op, int ret, int erryes,
+                               bool sending, size_t nleft)
+{
+  const int interpretation = SSL_get_error (op->ssl, ret);
+  switch (interpretation)
+    {
+      case SSL_ERROR_WANT_READ:
+      case SSL_ERROR_WANT_WRITE:
+        // our sockets block, so this only means we were interrupted
+        return OB_OK;
+      case SSL_ERROR_SYSCALL:
+        if (erryes == EINTR)
+          return OB_OK;
+        if (ret != 0 && erryes != EPIPE && erryes != ECONNRESET)
+          break;
+      // fall through
+      case SSL_ERROR_ZERO_RETURN:
+        OB_LOG_WARNING_CODE (0x20504003, "socket was closed unexpectedly\n");
+        errno = erryes;
+        return POOL_UNEXPECTED_CLOSE;
+    }
+
+  char *errstack = ob_ossl_err_as_string ();
+  char buf[160];
+  OB_LOG_WARNING_CODE (0x20504004, "%s returned %d (%s) with %" OB_FMT_SIZE
+                                   "d bytes left\n%s",
+                       sending ? "SSL_write" : "SSL_read", ret,
+                       ob_ossl_interpretation_as_string (buf, sizeof (buf),
+                                                         interpretation,
+                                                         erryes),
+                       nleft, errstack);
+  free (errstack);
+  errno = erryes;
+  return (sending ? POOL_SEND_BADTH : POOL_RECV_BADTH);
+}
+
+static ob_retort direct_write (direct_op *op, const void *buf, size_t len)
+{
+  const char *ptr = (const char *) buf;
+  while (len > 0)
+    {
+      ob_retort tort = direct_wait (op);
+      if (tort < OB_OK)
+        return tort;
+      const int chunk =
+        (int) (len < DIRECT_MAX_CHUNK ? len : DIRECT_MAX_CHUNK);
+      pipe_guard g;
+      guard_pipe (&g);
+      ERR_clear_error ();
+      errno = 0;
+      const int ret = SSL_write (op->ssl, ptr, chunk);
+      const int erryes = errno;
+      unguard_pipe (&g, ret <= 0 && erryes == EPIPE);
+      if (ret > 0)
+        {
+          ptr += ret;
+          len -= ret;
+          op->done += ret;
+        }
+      else if ((tort = direct_error (op, ret, erryes, true, len)) < OB_OK)
+        return tort;
+    }
+  return OB_OK;
+}
+
+ob_retort ob_tls_send_nbytes (ob_sock_t sock, const void *buf, size_t len,
+                              ob_handle_t wake_event)
+{
+  direct_op op;
+  ob_retort pret = direct_begin (&op, sock, wake_event, OB_SEL2_SEND);
+  if (pret < OB_OK)
+    return pret;
+  return direct_finish (&op, direct_write (&op, buf, len));
+}
+
+ob_retort ob_tls_send_iov (ob_sock_t sock, const pool_net_iov *iov, int n,
+                           ob_handle_t wake_event)
+{
+  direct_op op;
+  ob_retort pret = direct_begin (&op, sock, wake_event, OB_SEL2_SEND);
+  if (pret < OB_OK)
+    return pret;
+
+  // Copying the little pieces together costs less than a record (with
+  // its own header and MAC, and maybe its own syscall) for each one.
+  // Big pieces go straight from where they are.
+  char stage[DIRECT_STAGE_SIZE];
+  size_t staged = 0;
+  int i;
+  for (i = 0; i < n && pret >= OB_OK; i++)
+    {
+      const size_t len = iov[i].len;
+      if (len > sizeof (stage) - staged && staged > 0)
+        {
+          pret = direct_write (&op, stage, staged);
+          staged = 0;
+        }
+      if (pret < OB_OK)
+        break;
+      if (len <= sizeof (stage) - staged)
+        {
+          memcpy (stage + staged, iov[i].base, len);
+          staged += len;
+        }
+      else
+        pret = direct_write (&op, iov[i].base, len);
+    }
+  if (pret >= OB_OK && staged > 0)
+    pret = direct_write (&op, stage, staged);
+
+  return direct_finish (&op, pret);
+}
+
+ob_retort ob_tls_recv_nbytes (ob_sock_t sock, void *buf, size_t len,
+                              ob_handle_t wake_event)
+{
+  direct_op op;
+  ob_retort pret = direct_begin (&op, sock, wake_event, OB_SEL2_RECEIVE);
+  if (pret < OB_OK)
+    return pret;
+
+  char *ptr = (char *) buf;
+  while (op.done < len)
+    {
+      // Already-decrypted data doesn't make the socket readable
+      if (SSL_pending (op.ssl) <= 0 && (pret = direct_wait (&op)) < OB_OK)
+        break;
+      const size_t nleft = len - op.done;
+      const int chunk =
+        (int) (nleft < DIRECT_MAX_CHUNK ? nleft : DIRECT_MAX_CHUNK);
+      ERR_clear_error ();
+      errno = 0;
+      const int ret = SSL_read (op.ssl, ptr + op.done, chunk);
+      const int erryes = errno;
+      if (ret > 0)
+        op.done += ret;
+      else if ((pret = direct_error (&op, ret, erryes, false, nleft)) < OB_OK)
+        break;
+    }
+
+  return direct_finish (&op, pret);
+}
+
+bool ob_tls_pending (ob_sock_t sock)
+{
+  SSL *ssl = direct_ssl (sock);
+  return (ssl && SSL_pending (ssl) > 0);
+}
+
+void ob_tls_end (ob_sock_t sock, bool notify)
+{
+  SSL **slot = direct_slot (sock, false);
+  if (!slot || !*slot)
+    return;
+  SSL *ssl = *slot;
+  *slot = NULL;
+  if (notify)
+    {
+      // Only our half; waiting for the peer's alert could take forever
+      pipe_guard g;
+      guard_pipe (&g);
+      errno = 0;
+      SSL_shutdown (ssl);
+      unguard_pipe (&g, errno == EPIPE);
+    }
+  SSL_free (ssl);
+  ERR_clear_error ();
+}
@@ -158,6 +158,28 @@ ob_retort ob_tls_server_join_thread (pthread_t thr)
   return ob_ossl_join_thread (thr);
 }
 
+ob_retort ob_tls_server_start (ob_sock_t sock, bool anon_ok,
+                               bool client_auth_required)
+{
+  ob_retort tort = ob_tls_server_available ();
+  if (tort < OB_OK)
+    return tort;
+
+  SSL *ssl = NULL;
+  tort = ob_ossl_new_ssl (sock, context,
+                          (init_server_retort != POOL_ANONYMOUS_ONLY), anon_ok,
+                          client_auth_required, NULL, NULL, &ssl);
+  if (tort < OB_OK)
+    return tort;
+#ifdef TLS1_3_VERSION
+  // TLS 1.3 session tickets arrive after the handshake, where they'd
+  // make the client's socket look readable with nothing to read; and
+  // we never resume sessions anyway.
+  SSL_set_num_tickets (ssl, 0);
+#endif
+  return ob_ossl_start_direct (ssl, SSL_accept, NULL, anon_ok);
+}
+
 // ----------------------------------------------------------------------
 // Below are Diffie-Hellman parameters for 1024, 2048, and 4096 bits,
 // generated on my computer with "openssl dhparam -C <bits>",
@@ -10,6 +10,7 @@
 #include "libPlasma/c/pool.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 int private_float64_compare (unt64 f1, unt64 f2)
 {
@@ -272,6 +273,13 @@ bool ob_nb_done (const ob_numeric_builder *nb_in)
   return (nb_in->isCurrently == 0);
 }
 
+void ob_nb_reset (ob_numeric_builder *nb_in)
+{
+  const unt64 capacity = nb_in->capacity;
+  memset (nb_in, 0, sizeof (ob_numeric_builder));
+  nb_in->capacity = capacity;
+}
+
 void ob_nb_free (ob_numeric_builder **nb_inout)
 {
   free (*nb_inout);
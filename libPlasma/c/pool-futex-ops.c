@@ -0,0 +1,451 @@
+
+/* (c)  oblong industries */
+
+///
+/// Futex-based synchronization and await/awake
+///
+#include "libLoam/c/ob-sys.h"
+
+#ifdef __gnu_linux__
+
+#include <pthread.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-time.h"
+
+#include "libPlasma/c/pool.h"
+#include "libPlasma/c/private/fifo_ops.h"
+#include "libPlasma/c/private/pool_impl.h"
+#include "libPlasma/c/private/pool_mmap.h"
+
+/// For pools created with the "futex" option, the deposit and
+/// notification locks live in the pool's own header, as process-shared
+/// robust pthread mutexes.  On Linux those are futexes: taking or
+/// dropping an uncontended lock is a single atomic operation, and only
+/// a contended lock enters the kernel.  Semaphores and flock() make a
+/// system call every time.
+///
+/// Since the locks are part of the backing file, there is nothing
+/// separate to create, destroy, or have deleted out from under us.
+/// If a process dies holding a lock, the kernel marks it as abandoned
+/// (that's the "robust" part) and the next process to take it carries
+/// on, much like SEM_UNDO does for semaphores.
+///
+/// All processes sharing such a pool must agree on the layout of
+/// pthread_mutex_t, which in practice means the same word size.
+///
+/// We get at the lock chunk through a mapping of our own (the "view")
+/// rather than the pool's main mapping, since the main mapping moves
+/// when the pool is resized, which can happen while we hold the
+/// deposit lock.  A robust mutex must stay put while it's held,
+/// because glibc keeps track of it by address.
+
+struct pool_futex_view
+{
+  byte *base;
+  size_t len;
+  pool_chunk_lock *lc;
+};
+
+static const char *idx_to_str (int idx)
+{
+  return (idx == POOL_SEM_DEPOSIT_LOCK_IDX ? "deposit" : "notification");
+}
+
+/// Returns NULL if the hose isn't (or is no longer) attached to a pool
+/// whose locks we can use, which can happen during cleanup after a
+/// failed participate.
+
+static pool_chunk_lock *futex_chunk (pool_hose ph)
+{
+  return (ph->futex_view ? ph->futex_view->lc : NULL);
+}
+
+static pthread_mutex_t *futex_lock_for (pool_hose ph, int idx)
+{
+  pool_chunk_lock *lc = futex_chunk (ph);
+  return (lc ? (pthread_mutex_t *) lc->locks[idx] : NULL);
+}
+
+ob_retort pool_futex_init_locks (pool_chunk_lock *lc)
+{
+  if (sizeof (pthread_mutex_t) > sizeof (lc->locks[0]))
+    OB_FATAL_BUG_CODE (0x20113005, "pthread_mutex_t is %" OB_FMT_64 "u bytes, "
+                                   "which won't fit in a lock chunk\n",
+                       (unt64) sizeof (pthread_mutex_t));
+
+  pthread_mutexattr_t attr;
+  int err = pthread_mutexattr_init (&attr);
+  if (err == 0)
+    err = pthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_SHARED);
+  if (err == 0)
+    err = pthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_ROBUST);
+  int i;
+  for (i = 0; err == 0 && i < 2; i++)
+    err = pthread_mutex_init ((pthread_mutex_t *) lc->locks[i], &attr);
+  pthread_mutexattr_destroy (&attr);
+  if (err != 0)
+    return ob_errno_to_retort (err);
+  lc->lock_size = sizeof (pthread_mutex_t);
+  lc->notify_seq = 0;
+  lc->notify_waiters = 0;
+  return OB_OK;
+}
+
+/// Nothing to create; the locks come with the backing file.
+
+static ob_retort pool_futex_create (pool_hose ph)
+{
+  return OB_OK;
+}
+
+/// Nothing to destroy; the locks go away with the backing file.
+
+static ob_retort pool_futex_destroy (pool_hose ph, bool it_should_exist)
+{
+  return OB_OK;
+}
+
+static ob_retort pool_futex_open (pool_hose ph)
+{
+  if (ph->futex_view)
+    return OB_OK;
+
+  pool_mmap_data *d = pool_mmap_get_data (ph);
+  if (!d || !d->lock_chunk)
+    {
+      OB_LOG_ERROR_CODE (0x20113000, "hose '%s' pool '%s': no locks in "
+                                     "pool header\n",
+                         ph->hose_name, ph->name);
+      return POOL_CORRUPT;
+    }
+  if (d->lock_chunk->lock_size != sizeof (pthread_mutex_t))
+    {
+      OB_LOG_ERROR_CODE (0x20113001, "hose '%s' pool '%s': locks are %" OB_FMT_64
+                                     "u bytes, but we expected %" OB_FMT_64
+                                     "u\n",
+                         ph->hose_name, ph->name, d->lock_chunk->lock_size,
+                         (unt64) sizeof (pthread_mutex_t));
+      return POOL_WRONG_VERSION;
+    }
+
+  // The header never moves within the file, so we only need to map
+  // as far as the end of the lock chunk.
+  const size_t off = (byte *) d->lock_chunk - d->mem;
+  const size_t page = (size_t) sysconf (_SC_PAGESIZE);
+  const size_t len = (off + sizeof (pool_chunk_lock) + page - 1) & ~(page - 1);
+  void *base =
+    mmap (NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fileno (d->file), 0);
+  if (base == MAP_FAILED)
+    {
+      const int erryes = errno;
+      OB_LOG_ERROR_CODE (0x20113006, "hose '%s' pool '%s': couldn't map "
+                                     "locks: %s\n",
+                         ph->hose_name, ph->name, strerror (erryes));
+      return ob_errno_to_retort (erryes);
+    }
+
+  struct pool_futex_view *v =
+    (struct pool_futex_view *) calloc (1, sizeof (*v));
+  if (!v)
+    {
+      munmap (base, len);
+      return OB_NO_MEM;
+    }
+  v->base = (byte *) base;
+  v->len = len;
+  v->lc = (pool_chunk_lock *) (v->base + off);
+  ph->futex_view = v;
+  return OB_OK;
+}
+
+static ob_retort pool_futex_close (pool_hose ph)
+{
+  struct pool_futex_view *v = ph->futex_view;
+  if (!v)
+    return OB_OK;
+  ph->futex_view = NULL;
+  ob_retort tort = OB_OK;
+  if (munmap (v->base, v->len) < 0)
+    tort = ob_errno_to_retort (errno);
+  free (v);
+  return tort;
+}
+
+static ob_retort pool_futex_lock (pool_hose ph, int idx)
+{
+  pthread_mutex_t *m = futex_lock_for (ph, idx);
+  if (!m)
+    return POOL_SEMAPHORES_BADTH;
+  int err = pthread_mutex_lock (m);
+  if (err == EOWNERDEAD)
+    {
+      // Whoever had it died with it.  Whatever they were doing is
+      // as finished as it's going to get, so just carry on.
+      OB_LOG_WARNING_CODE (0x20113002, "hose '%s' pool '%s': previous owner "
+                                       "of '%s lock' died holding it\n",
+                           ph->hose_name, ph->name, idx_to_str (idx));
+      err = pthread_mutex_consistent (m);
+    }
+  if (err != 0)
+    {
+      OB_LOG_ERROR_CODE (0x20113003, "hose '%s' pool '%s': '%s lock' failed "
+                                     "with '%s' (%d)\n",
+                         ph->hose_name, ph->name, idx_to_str (idx),
+                         strerror (err), err);
+      return POOL_SEMAPHORES_BADTH;
+    }
+  return OB_OK;
+}
+
+static ob_retort pool_futex_unlock (pool_hose ph, int idx)
+{
+  pthread_mutex_t *m = futex_lock_for (ph, idx);
+  if (!m)
+    return POOL_SEMAPHORES_BADTH;
+  int err = pthread_mutex_unlock (m);
+  if (err != 0)
+    {
+      OB_LOG_ERROR_CODE (0x20113004, "hose '%s' pool '%s': '%s unlock' failed "
+                                     "with '%s' (%d)\n",
+                         ph->hose_name, ph->name, idx_to_str (idx),
+                         strerror (err), err);
+      return POOL_SEMAPHORES_BADTH;
+    }
+  return OB_OK;
+}
+
+const pool_lock_ops pool_futex_ops = {pool_futex_create, pool_futex_destroy,
+                                      pool_futex_open,   pool_futex_close,
+                                      pool_futex_lock,   pool_futex_unlock};
+
+///
+/// Await/awake
+///
+/// Rather than a fifo per awaiter, which every depositor has to find
+/// in the notification directory and write to under the notification
+/// lock, a deposit just bumps notify_seq, and if anyone is asleep on
+/// it, wakes them all with one FUTEX_WAKE.  So a deposit costs the
+/// same however many awaiters there are, and never touches the file
+/// system.
+///
+/// An awaiter reads notify_seq, checks for a protein, and then sleeps
+/// only if notify_seq still has the value it read, so a deposit in
+/// between can't be missed.
+///
+/// That's all a plain pool_await_next() needs.  But gangs, hoses with
+/// pool_hose_enable_wakeup(), and the pool server want a descriptor
+/// they can select() on.  For those, the hose gets an eventfd and a
+/// "bridge" thread, which sleeps on notify_seq and pokes the eventfd
+/// each time it changes.  The bridge lasts until the hose is withdrawn.
+///
+/// If a process dies while asleep, notify_waiters stays one too high
+/// forever.  That just means depositors make a FUTEX_WAKE nobody
+/// needed, so we don't try to do anything about it.
+
+static unt32 current_seq (pool_chunk_lock *lc)
+{
+  return __atomic_load_n (&lc->notify_seq, __ATOMIC_SEQ_CST);
+}
+
+/// Sleeps until notify_seq isn't @a seen any more, or until @a rel
+/// (if not NULL) has passed.  May also return for no reason at all.
+
+static void sleep_on_seq (pool_chunk_lock *lc, unt32 seen,
+                          const struct timespec *rel)
+{
+  __atomic_add_fetch (&lc->notify_waiters, 1, __ATOMIC_SEQ_CST);
+  syscall (SYS_futex, &lc->notify_seq, FUTEX_WAIT, seen, rel, NULL, 0);
+  __atomic_sub_fetch (&lc->notify_waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+static void bump_seq (pool_chunk_lock *lc)
+{
+  __atomic_add_fetch (&lc->notify_seq, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n (&lc->notify_waiters, __ATOMIC_SEQ_CST) > 0)
+    syscall (SYS_futex, &lc->notify_seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+ob_retort pool_futex_wake_awaiters (pool_hose ph)
+{
+  pool_chunk_lock *lc = futex_chunk (ph);
+  if (!lc)
+    return POOL_SEMAPHORES_BADTH;
+  bump_seq (lc);
+  return OB_OK;
+}
+
+struct pool_futex_bridge
+{
+  pthread_t thread;
+  pid_t pid;
+  int stop;
+  int efd;
+  unt32 seen;
+  pool_chunk_lock *lc;
+};
+
+static void *bridge_main (void *arg)
+{
+  struct pool_futex_bridge *b = (struct pool_futex_bridge *) arg;
+  unt32 seen = b->seen;
+  for (;;)
+    {
+      sleep_on_seq (b->lc, seen, NULL);
+      if (__atomic_load_n (&b->stop, __ATOMIC_SEQ_CST))
+        break;
+      const unt32 now = current_seq (b->lc);
+      if (now == seen)
+        continue;
+      seen = now;
+      if (eventfd_write (b->efd, 1) < 0)
+        OB_LOG_ERROR_CODE (0x20113007, "eventfd_write failed with '%s'\n",
+                           strerror (errno));
+    }
+  return NULL;
+}
+
+/// @a seen is notify_seq as it was before our caller last looked for
+/// a protein.  The bridge starts from there, rather than from whatever
+/// notify_seq is by the time the thread gets going, so that a deposit
+/// in between still pokes the eventfd.
+
+static ob_retort start_bridge (pool_hose ph, pool_chunk_lock *lc, unt32 seen)
+{
+  struct pool_futex_bridge *b =
+    (struct pool_futex_bridge *) calloc (1, sizeof (*b));
+  if (!b)
+    return OB_NO_MEM;
+  b->pid = getpid ();
+  b->lc = lc;
+  b->seen = seen;
+  b->efd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (b->efd < 0)
+    {
+      const int erryes = errno;
+      free (b);
+      return ob_errno_to_retort (erryes);
+    }
+
+  // Signals are meant for the application's threads, not ours.
+  sigset_t all, old;
+  sigfillset (&all);
+  pthread_sigmask (SIG_BLOCK, &all, &old);
+  const int err = pthread_create (&b->thread, NULL, bridge_main, b);
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+  if (err != 0)
+    {
+      OB_LOG_ERROR_CODE (0x20113008, "hose '%s' pool '%s': couldn't start "
+                                     "notification thread: %s\n",
+                         ph->hose_name, ph->name, strerror (err));
+      OB_CHECK_POSIX_CODE (0x20113009, close (b->efd));
+      free (b);
+      return ob_errno_to_retort (err);
+    }
+
+  ph->futex_bridge = b;
+  ph->notify_handle = b->efd;
+  return OB_OK;
+}
+
+static void drain_bridge (pool_hose ph)
+{
+  eventfd_t junk;
+  if (ph->futex_bridge)
+    eventfd_read (ph->futex_bridge->efd, &junk);
+}
+
+ob_retort pool_futex_multi_add_awaiter (pool_hose ph, protein *ret_prot,
+                                        pool_timestamp *ret_ts,
+                                        int64 *ret_index)
+{
+  if (!ph->futex_bridge)
+    {
+      pool_chunk_lock *lc = futex_chunk (ph);
+      if (!lc)
+        return POOL_SEMAPHORES_BADTH;
+      // Read notify_seq before pool_next() looks, as in
+      // pool_futex_await_next_single().
+      ob_retort tort = start_bridge (ph, lc, current_seq (lc));
+      if (tort < OB_OK)
+        return tort;
+    }
+  // Anything the bridge told us about before now, this pool_next()
+  // will find.
+  drain_bridge (ph);
+  return pool_next (ph, ret_prot, ret_ts, ret_index);
+}
+
+void pool_futex_multi_remove_awaiter (pool_hose ph)
+{
+  drain_bridge (ph);
+}
+
+void pool_futex_multi_destroy_awaiter (pool_hose ph)
+{
+  struct pool_futex_bridge *b = ph->futex_bridge;
+  if (!b)
+    return;
+  ph->futex_bridge = NULL;
+  ph->notify_handle = -1;
+  // After a fork, the thread only exists in the parent.
+  if (b->pid == getpid ())
+    {
+      __atomic_store_n (&b->stop, 1, __ATOMIC_SEQ_CST);
+      // Bumping notify_seq means the bridge can't go back to sleep
+      // without seeing stop.  Everyone else just sees a spurious
+      // wakeup.
+      bump_seq (b->lc);
+      OB_CHECK_PTHREAD_CODE (0x2011300a, pthread_join (b->thread, NULL));
+    }
+  OB_CHECK_POSIX_CODE (0x2011300b, close (b->efd));
+  free (b);
+}
+
+ob_retort pool_futex_await_next_single (pool_hose ph, pool_timestamp timeout,
+                                        protein *ret_prot,
+                                        pool_timestamp *ret_ts,
+                                        int64 *ret_index)
+{
+  // pool_hose_wake_up() can only reach us through select()
+  if (ph->w.wakeup_read_fd >= 0)
+    return pool_fifo_await_next_single (ph, timeout, ret_prot, ret_ts,
+                                        ret_index);
+
+  pool_chunk_lock *lc = futex_chunk (ph);
+  if (!lc)
+    return POOL_SEMAPHORES_BADTH;
+
+  const unt64 start = ob_monotonic_time ();
+  for (;;)
+    {
+      const unt32 seen = current_seq (lc);
+      ob_retort pret = pool_next (ph, ret_prot, ret_ts, ret_index);
+      if (pret != POOL_NO_SUCH_PROTEIN)
+        return pret;
+      if (timeout == POOL_WAIT_FOREVER)
+        {
+          sleep_on_seq (lc, seen, NULL);
+          continue;
+        }
+      const unt64 waited = ob_monotonic_time () - start;
+      const unt64 limit = (timeout > 0 ? (unt64) (timeout * 1e9) : 0);
+      if (waited >= limit)
+        return POOL_AWAIT_TIMEDOUT;
+      const unt64 left = limit - waited;
+      struct timespec rel;
+      rel.tv_sec = left / OB_CONST_U64 (1000000000);
+      rel.tv_nsec = left % OB_CONST_U64 (1000000000);
+      sleep_on_seq (lc, seen, &rel);
+    }
+}
+
+#endif /* __gnu_linux__ */
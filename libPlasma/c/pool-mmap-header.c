@@ -69,7 +69,9 @@ static pool_toc_t *init_pool_toc_v0 (byte *mem, unt64 capacity)
   return result;
 }
 
-static void initialize_v0_header (unt8 slaw_vers, byte *mem, unt64 toc_cap)
+static void initialize_v0_header (unt8 slaw_vers, byte *mem, unt64 toc_cap,
+                                  OB_UNUSED unt64 dense_cap,
+                                  OB_UNUSED unt64 pool_flags)
 {
   const unt64 slav = slaw_vers; /* explicitly promote type to avoid surprises */
   POOL_MMAP_GET_MAGICV0 (mem) =
@@ -83,7 +85,8 @@ static void initialize_v0_header (unt8 slaw_vers, byte *mem, unt64 toc_cap)
 
 #define SZ(x) (x.hdr.len = sizeof (x) / sizeof (x.hdr.len))
 
-static void initialize_v1_header (unt8 slaw_vers, byte *mem, unt64 toc_cap)
+static void initialize_v1_header (unt8 slaw_vers, byte *mem, unt64 toc_cap,
+                                  unt64 dense_cap, unt64 pool_flags)
 {
   default_v1_header *h = (default_v1_header *) mem;
   OB_CLEAR (*h);
@@ -117,6 +120,62 @@ static void initialize_v1_header (unt8 slaw_vers, byte *mem, unt64 toc_cap)
       assert (foo == (volatile void *) next);
       next += pool_toc_room (toc_cap);
     }
+  if (0 != (pool_flags & POOL_FLAG_PARALLEL_DEPOSIT))
+    {
+      pool_chunk_rsrv *rh = (pool_chunk_rsrv *) next;
+      OB_CLEAR (*rh);
+      rh->hdr.sig = POOL_CHUNK_RSRV;
+      rh->hdr.len = sizeof (*rh) / sizeof (rh->hdr.len);
+      next += sizeof (*rh);
+    }
+  if (0 != (pool_flags & POOL_FLAG_FUTEX))
+    {
+      // The locks themselves are initialized by pool_futex_init_locks()
+      pool_chunk_lock *lh = (pool_chunk_lock *) next;
+      OB_CLEAR (*lh);
+      lh->hdr.sig = POOL_CHUNK_LOCK;
+      lh->hdr.len = sizeof (*lh) / sizeof (lh->hdr.len);
+      next += sizeof (*lh);
+    }
+  if (0 != (pool_flags & POOL_FLAG_GROUP_COMMIT))
+    {
+      pool_chunk_cmit *ch = (pool_chunk_cmit *) next;
+      OB_CLEAR (*ch);
+      ch->hdr.sig = POOL_CHUNK_CMIT;
+      ch->hdr.len = sizeof (*ch) / sizeof (ch->hdr.len);
+      ch->latency_usec = (int64) (POOL_COMMIT_LATENCY_DEFAULT * 1e6);
+      ch->batch = POOL_COMMIT_BATCH_DEFAULT;
+      next += sizeof (*ch);
+    }
+  if (0 != (pool_flags & POOL_FLAG_CHECKSUM))
+    {
+      pool_chunk_csum *sh = (pool_chunk_csum *) next;
+      OB_CLEAR (*sh);
+      sh->hdr.sig = POOL_CHUNK_CSUM;
+      sh->hdr.len = sizeof (*sh) / sizeof (sh->hdr.len);
+      sh->verify = POOL_VERIFY_ALWAYS;
+      sh->sample = POOL_VERIFY_SAMPLE_DEFAULT;
+      next += sizeof (*sh);
+    }
+  if (0 != (pool_flags & POOL_FLAG_DENSE_INDEX))
+    {
+      // The entries themselves start out zero, meaning "not known"
+      pool_chunk_dnse *dh = (pool_chunk_dnse *) next;
+      const unt64 room = sizeof (*dh) + dense_cap * sizeof (int64);
+      memset (dh, 0, room);
+      dh->hdr.sig = POOL_CHUNK_DNSE;
+      dh->hdr.len = room / sizeof (dh->hdr.len);
+      dh->capacity = dense_cap;
+      next += room;
+    }
+  if (0 != (pool_flags & POOL_FLAG_INCREMENTAL_RESIZE))
+    {
+      pool_chunk_rsiz *zh = (pool_chunk_rsiz *) next;
+      OB_CLEAR (*zh);
+      zh->hdr.sig = POOL_CHUNK_RSIZ;
+      zh->hdr.len = sizeof (*zh) / sizeof (zh->hdr.len);
+      next += sizeof (*zh);
+    }
 
   h->conf.header_size = (next - mem);
   h->conf.mmap_version = 1;  // well, we are initialize_v1_header(), after all!
@@ -270,10 +329,23 @@ static ob_retort read_v1_header (pool_mmap_data *d)
   d->ptoc = read_pool_toc_v1 (d->mem, header_bytes, &tort);
   d->perm_chunk =
     (pool_chunk_perm *) get_chunk (d->mem, header_octs, POOL_CHUNK_PERM, &tort);
+  d->rsrv_chunk =
+    (pool_chunk_rsrv *) get_chunk (d->mem, header_octs, POOL_CHUNK_RSRV, &tort);
+  d->lock_chunk =
+    (pool_chunk_lock *) get_chunk (d->mem, header_octs, POOL_CHUNK_LOCK, &tort);
+  d->cmit_chunk =
+    (pool_chunk_cmit *) get_chunk (d->mem, header_octs, POOL_CHUNK_CMIT, &tort);
+  d->csum_chunk =
+    (pool_chunk_csum *) get_chunk (d->mem, header_octs, POOL_CHUNK_CSUM, &tort);
+  d->dnse_chunk =
+    (pool_chunk_dnse *) get_chunk (d->mem, header_octs, POOL_CHUNK_DNSE, &tort);
+  d->rsiz_chunk =
+    (pool_chunk_rsiz *) get_chunk (d->mem, header_octs, POOL_CHUNK_RSIZ, &tort);
   return tort;
 }
 
-static unt64 size_of_v0_header (unt64 toc_cap)
+static unt64 size_of_v0_header (unt64 toc_cap, OB_UNUSED unt64 dense_cap,
+                                OB_UNUSED unt64 pool_flags)
 {
   unt64 hs = POOL_MMAP_V0_HEADER_SIZE;
   if (toc_cap > 0)
@@ -281,11 +353,24 @@ static unt64 size_of_v0_header (unt64 toc_cap)
   return hs;
 }
 
-static unt64 size_of_v1_header (unt64 toc_cap)
+static unt64 size_of_v1_header (unt64 toc_cap, unt64 dense_cap,
+                                unt64 pool_flags)
 {
   unt64 hs = sizeof (default_v1_header);
   if (toc_cap > 0)
     hs += pool_toc_room (toc_cap) + sizeof (pool_chunk_header);
+  if (0 != (pool_flags & POOL_FLAG_PARALLEL_DEPOSIT))
+    hs += sizeof (pool_chunk_rsrv);
+  if (0 != (pool_flags & POOL_FLAG_FUTEX))
+    hs += sizeof (pool_chunk_lock);
+  if (0 != (pool_flags & POOL_FLAG_GROUP_COMMIT))
+    hs += sizeof (pool_chunk_cmit);
+  if (0 != (pool_flags & POOL_FLAG_CHECKSUM))
+    hs += sizeof (pool_chunk_csum);
+  if (0 != (pool_flags & POOL_FLAG_DENSE_INDEX))
+    hs += sizeof (pool_chunk_dnse) + dense_cap * sizeof (int64);
+  if (0 != (pool_flags & POOL_FLAG_INCREMENTAL_RESIZE))
+    hs += sizeof (pool_chunk_rsiz);
   return hs;
 }
 
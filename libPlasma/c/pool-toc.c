@@ -404,6 +404,32 @@ bool pool_toc_append (pool_toc_t *pi, pool_toc_entry e, unt64 oldest_offset)
 }
 
 
+void pool_toc_rebase (pool_toc_t *pi, unt64 (*rebase) (unt64, const void *),
+                      const void *arg)
+{
+  if (!pi)
+    return;
+  // Drop the entries which have gone, the way garbage_collect() does
+  while (pi->count > 0)
+    {
+      const unt64 off = nth_entry (pi, 0)->offset;
+      if (off != POOL_TOC_UNKNOWN_OFFSET
+          && rebase (off, arg) != POOL_TOC_UNKNOWN_OFFSET)
+        break;
+      pi->count--;
+      pi->start++;
+      pi->first += pi->step;
+    }
+  unt64 n;
+  for (n = 0; n < pi->count; n++)
+    {
+      index_entry *entry = nth_entry (pi, n);
+      if (entry->offset != POOL_TOC_UNKNOWN_OFFSET)
+        entry->offset = rebase (entry->offset, arg);
+    }
+}
+
+
 #if 0 /* unused */
 void
 pool_toc_dump (const pool_toc_t *pi, FILE *out)
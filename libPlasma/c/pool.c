@@ -328,6 +328,7 @@ static void pool_free_pool_hose (pool_hose ph)
     OB_LOG_BUG_CODE (0x20101002, "leaking duffel\n");
 
   free (ph->hose_name);
+  Free_Slaw (ph->filter);
 
   dealloc_ph_structure (ph);
 }
@@ -930,6 +931,96 @@ ob_retort pool_deposit_ex (pool_hose ph, bprotein p, int64 *idx,
   return ph->deposit (ph, p, idx, ret_ts);
 }
 
+ob_retort pool_deposit_batch (pool_hose ph, const bprotein *proteins, int64 n,
+                              int64 *idx_out)
+{
+  return pool_deposit_batch_ex (ph, proteins, n, idx_out, NULL);
+}
+
+ob_retort pool_deposit_batch_ex (pool_hose ph, const bprotein *proteins,
+                                 int64 n, int64 *idx_out,
+                                 pool_timestamp *ts_out)
+{
+  CHECK_HOSE_VALIDITY (ph);
+
+  if (n < 0)
+    return OB_INVALID_ARGUMENT;
+  if (n == 0)
+    return OB_OK;
+  if (!proteins)
+    return OB_ARGUMENT_WAS_NULL;
+
+  int64 i;
+  for (i = 0; i < n; i++)
+    if (!slaw_is_protein (proteins[i]))
+      {
+        if (idx_out)
+          for (i = 0; i < n; i++)
+            idx_out[i] = POOL_NOT_A_PROTEIN;
+        return POOL_NOT_A_PROTEIN;
+      }
+
+  // The implementations always get somewhere to put the results
+  int64 *idx_scratch = NULL;
+  pool_timestamp *ts_scratch = NULL;
+  if (!idx_out)
+    idx_out = idx_scratch = (int64 *) malloc (n * sizeof (int64));
+  if (!ts_out)
+    ts_out = ts_scratch = (pool_timestamp *) malloc (n * sizeof (*ts_out));
+
+  ob_retort pret = OB_OK;
+  if (!idx_out || !ts_out)
+    {
+      pret = OB_NO_MEM;
+      if (idx_out)
+        for (i = 0; i < n; i++)
+          idx_out[i] = pret;
+    }
+  else if (ph->deposit_batch)
+    pret = ph->deposit_batch (ph, proteins, n, idx_out, ts_out);
+  else
+    for (i = 0; i < n; i++)
+      {
+        if (pret == OB_OK)
+          pret = ph->deposit (ph, proteins[i], &idx_out[i], &ts_out[i]);
+        if (pret != OB_OK)
+          idx_out[i] = pret;
+      }
+
+  free (idx_scratch);
+  free (ts_scratch);
+  return pret;
+}
+
+ob_retort pool_deposit_async (pool_hose ph, bprotein p,
+                              pool_deposit_callback cb, void *cookie)
+{
+  CHECK_HOSE_VALIDITY (ph);
+
+  if (!slaw_is_protein (p))
+    return POOL_NOT_A_PROTEIN;
+  if (ph->deposit_async)
+    return ph->deposit_async (ph, p, cb, cookie);
+
+  int64 idx = -1;
+  pool_timestamp ts = OB_NAN;
+  ob_retort pret = ph->deposit (ph, p, &idx, &ts);
+  if (pret < OB_OK)
+    return pret;
+  if (cb)
+    cb (ph, pret, idx, ts, cookie);
+  return OB_OK;
+}
+
+ob_retort pool_deposit_async_flush (pool_hose ph)
+{
+  CHECK_HOSE_VALIDITY (ph);
+
+  if (!ph->deposit_flush)
+    return OB_OK;
+  return ph->deposit_flush (ph);
+}
+
 ob_retort pool_advance_oldest (pool_hose ph, int64 idx_in)
 {
   CHECK_HOSE_VALIDITY (ph);
@@ -1140,11 +1231,10 @@ ob_retort pool_curr (pool_hose ph, protein *p, pool_timestamp *ts)
   return pret;
 }
 
-ob_retort pool_next (pool_hose ph, protein *ret_prot, pool_timestamp *ret_ts,
-                     int64 *ret_index)
+static ob_retort pool_next_unfiltered (pool_hose ph, protein *ret_prot,
+                                       pool_timestamp *ret_ts,
+                                       int64 *ret_index)
 {
-  CHECK_HOSE_VALIDITY (ph);
-
   ob_retort pret;
   int64 index_to_get = ph->index;
 
@@ -1202,6 +1292,171 @@ ob_retort pool_next (pool_hose ph, protein *ret_prot, pool_timestamp *ret_ts,
   return pret;
 }
 
+/// pool_next() for a hose whose filter the pool implementation can't
+/// apply.  Proteins which don't match are skipped for good, so that
+/// the next call doesn't have to look at them again.
+
+static ob_retort pool_next_filtered (pool_hose ph, protein *ret_prot,
+                                     pool_timestamp *ret_ts, int64 *ret_index)
+{
+  protein p = NULL;
+  if (!ret_prot)
+    ret_prot = &p;
+
+  ob_retort pret;
+  while ((pret = pool_next_unfiltered (ph, ret_prot, ret_ts, ret_index))
+         == OB_OK)
+    {
+      if (protein_search (*ret_prot, ph->filter) >= 0)
+        break;
+      Free_Protein (*ret_prot);
+    }
+
+  protein_free (p);
+  return pret;
+}
+
+ob_retort pool_next (pool_hose ph, protein *ret_prot, pool_timestamp *ret_ts,
+                     int64 *ret_index)
+{
+  CHECK_HOSE_VALIDITY (ph);
+
+  if (ph->filter && !ph->filter_in_backend)
+    return pool_next_filtered (ph, ret_prot, ret_ts, ret_index);
+  return pool_next_unfiltered (ph, ret_prot, ret_ts, ret_index);
+}
+
+ob_retort pool_nth_protein_view (pool_hose ph, int64 idx,
+                                 pool_protein_view *view)
+{
+  CHECK_HOSE_VALIDITY (ph);
+
+  if (!view)
+    return OB_ARGUMENT_WAS_NULL;
+  OB_CLEAR (*view);
+
+  ob_retort pret = POOL_UNSUPPORTED_OPERATION;
+  if (ph->nth_view)
+    pret = ph->nth_view (ph, idx, view);
+  if (pret == POOL_UNSUPPORTED_OPERATION)
+    {
+      OB_CLEAR (*view);
+      pret = ph->nth_protein (ph, idx, &view->copy, &view->ts);
+      view->p = view->copy;
+      view->idx = idx;
+    }
+  if (pret < OB_OK)
+    OB_CLEAR (*view);
+  return pret;
+}
+
+ob_retort pool_next_view (pool_hose ph, pool_protein_view *view)
+{
+  CHECK_HOSE_VALIDITY (ph);
+
+  if (!view)
+    return OB_ARGUMENT_WAS_NULL;
+  OB_CLEAR (*view);
+
+  ob_retort pret;
+  if (ph->filter)
+    {
+      pret = pool_next (ph, &view->copy, &view->ts, &view->idx);
+      view->p = view->copy;
+      return pret;
+    }
+
+  // As in pool_next_unfiltered(): if the protein we wanted has been
+  // discarded, move on to the oldest one.
+  int64 index_to_get = (ph->index < 0 ? 0 : ph->index);
+  while ((pret = pool_nth_protein_view (ph, index_to_get, view))
+         == POOL_NO_SUCH_PROTEIN)
+    {
+      int64 idx = -1;
+      pret = ph->oldest_index (ph, &idx);
+      if (OB_OK == pret && idx > index_to_get)
+        index_to_get = idx;
+      else
+        {
+          if (OB_OK == pret)
+            pret = POOL_NO_SUCH_PROTEIN;
+          break;
+        }
+    }
+
+  if (pret == OB_OK)
+    ph->index = view->idx + 1;
+  return pret;
+}
+
+ob_retort pool_view_check (pool_hose ph, const pool_protein_view *view)
+{
+  CHECK_HOSE_VALIDITY (ph);
+
+  if (!view)
+    return OB_ARGUMENT_WAS_NULL;
+  if (!view->p)
+    return POOL_NO_SUCH_PROTEIN;
+  if (view->copy || !ph->view_check)
+    return OB_OK;
+  return ph->view_check (ph, view);
+}
+
+ob_retort pool_view_release (pool_hose ph, pool_protein_view *view)
+{
+  CHECK_HOSE_VALIDITY (ph);
+
+  if (!view)
+    return OB_ARGUMENT_WAS_NULL;
+  ob_retort pret = pool_view_check (ph, view);
+
+  if (view->copy)
+    protein_free (view->copy);
+  OB_CLEAR (*view);
+  return pret;
+}
+
+bool private_filter_rejects (pool_hose ph, bprotein p)
+{
+  return (ph->filter && !ph->filter_in_backend && p
+          && protein_search (p, ph->filter) < 0);
+}
+
+ob_retort pool_hose_set_filter (pool_hose ph, bslaw filter)
+{
+  CHECK_HOSE_VALIDITY (ph);
+
+  slaw f = NULL;
+  if (filter && !slaw_is_nil (filter))
+    {
+      f = slaw_dup (filter);
+      if (!f)
+        return OB_NO_MEM;
+    }
+  Free_Slaw (ph->filter);
+  ph->filter = f;
+  ph->filter_in_backend =
+    (f && ph->set_filter && ph->set_filter (ph, f) == OB_OK);
+  return OB_OK;
+}
+
+bslaw pool_hose_get_filter (pool_hose ph)
+{
+  return ph ? ph->filter : NULL;
+}
+
+ob_retort pool_hose_set_read_ahead (pool_hose ph, int64 max_proteins,
+                                    int64 max_bytes)
+{
+  CHECK_HOSE_VALIDITY (ph);
+
+  if (max_proteins < 0 || max_bytes < 0)
+    return OB_INVALID_ARGUMENT;
+  ph->read_ahead_proteins = max_proteins;
+  ph->read_ahead_bytes = max_bytes;
+  return OB_OK;
+}
+
 ob_retort pool_await_next (pool_hose ph, pool_timestamp timeout,
                            protein *ret_prot, pool_timestamp *ret_ts,
                            int64 *ret_index)
@@ -1225,6 +1480,7 @@ ob_retort pool_await_next (pool_hose ph, pool_timestamp timeout,
   // Drat.  Now we have to do work.  Set ourselves up in a while loop
   // to handle the case that the protein we were requesting was
   // discarded.
+  pool_timestamp target = OB_NAN;
   while (true)
     {
       // At this point, the requested protein is either in the future
@@ -1254,8 +1510,22 @@ ob_retort pool_await_next (pool_hose ph, pool_timestamp timeout,
         }
 
       // Okay, our protein is officially not in existence yet.  Await
-      // a deposit.
-      pret = ph->await_next_single (ph, timeout, ret_prot, ret_ts, ret_index);
+      // a deposit.  (With a filter, the deposit might not be one we
+      // want, so the timeout has to be overall.)
+      pret = ph->await_next_single (ph,
+                                    (ph->filter ? private_incremental_timeout (
+                                                    timeout, &target)
+                                                : timeout),
+                                    ret_prot, ret_ts, ret_index);
+
+      // Local pools only wake us for proteins which pass the filter,
+      // but a remote one whose server can't filter hands us whatever
+      // comes next.
+      if (pret == OB_OK && private_filter_rejects (ph, *ret_prot))
+        {
+          Free_Protein (*ret_prot);
+          pret = POOL_NO_SUCH_PROTEIN;
+        }
 
       if (pret != POOL_NO_SUCH_PROTEIN)
         // We have found a protein, or the await timed out,
@@ -1289,8 +1559,16 @@ ob_retort pool_probe_frwd (pool_hose ph, bslaw search, protein *ret_prot,
   pool_timestamp ts;
   int64 idx = 0;
 
-  if (ph->probe_frwd)
-    return ph->probe_frwd (ph, search, ret_prot, ret_ts, ret_index);
+  // A filtered hose has to look at what pool_next() returns, since
+  // the implementation's probe_frwd() doesn't know about the filter.
+  if (ph->probe_frwd && !ph->filter)
+    {
+      pret = ph->probe_frwd (ph, search, ret_prot, ret_ts, ret_index);
+      if (pret != POOL_UNSUPPORTED_OPERATION)
+        return pret;
+      // Can happen if search is a protein filter, and the server
+      // is too old to know about those.
+    }
 
   int64 saved = ph->index;
 
@@ -1348,7 +1626,7 @@ ob_retort pool_await_probe_frwd (pool_hose ph, bslaw search,
   if (!ret_prot)
     return OB_ARGUMENT_WAS_NULL;
 
-  if (ph->await_probe_frwd)
+  if (ph->await_probe_frwd && !ph->filter)
     {
       ob_retort pret =
         ph->await_probe_frwd (ph, search, timeout, ret_prot, ret_ts, ret_index);
@@ -2402,6 +2680,14 @@ do_create:
   else
     ph->lock_ops = &pool_sem_ops;
 #endif
+#ifdef __gnu_linux__
+  if (slaw_path_get_bool (options, "futex", false))
+    {
+      ph->lock_ops = &pool_futex_ops;
+      /* the locks live in the pool header, which old pools don't have */
+      ph->pool_directory_version = POOL_DIRECTORY_VERSION_CONFIG_IN_MMAP;
+    }
+#endif
 
   if (slaw_path_get_bool (options, "single-file", false))
     ph->pool_directory_version = POOL_DIRECTORY_VERSION_SINGLE_FILE;
@@ -3274,6 +3560,13 @@ ob_retort pool_hose_clone (pool_hose orig_ph, pool_hose *new_ph)
   if (orig_ph->hose_name)
     pret = pool_set_hose_name (ph, orig_ph->hose_name);
 
+  if (OB_OK == pret && orig_ph->filter)
+    pret = pool_hose_set_filter (ph, orig_ph->filter);
+
+  if (OB_OK == pret)
+    pret = pool_hose_set_read_ahead (ph, orig_ph->read_ahead_proteins,
+                                     orig_ph->read_ahead_bytes);
+
   if (OB_OK == pret)
     {
       int64 idx;
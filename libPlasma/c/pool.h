@@ -602,6 +602,79 @@ OB_PLASMA_API ob_retort pool_deposit (pool_hose ph, bprotein p, int64 *idx);
  */
 OB_PLASMA_API ob_retort pool_deposit_ex (pool_hose ph, bprotein p, int64 *idx,
                                          pool_timestamp *ret_ts);
+
+/**
+ * Deposit the \a n proteins in \a proteins, in order, as if by that
+ * many calls to pool_deposit(), but cheaper: an mmap pool takes its
+ * deposit lock and wakes awaiters only once for the lot (and gives
+ * them all the same timestamp), and a remote pool sends them all in
+ * one request, if the server supports it.
+ *
+ * If \a idx_out is not NULL, it must have room for \a n indexes,
+ * and is filled in with the index of each protein.  If a deposit
+ * fails, the ones after it aren't attempted; their entries in
+ * \a idx_out (and that of the one which failed) are set to the
+ * error, which is also returned.  If any of \a proteins isn't a
+ * protein, none are deposited, and POOL_NOT_A_PROTEIN is returned.
+ */
+OB_PLASMA_API ob_retort pool_deposit_batch (pool_hose ph,
+                                            const bprotein *proteins, int64 n,
+                                            int64 *idx_out);
+
+/**
+ * Like pool_deposit_batch(), but if \a ts_out is not NULL, it is
+ * filled in with the timestamp of each protein deposited.
+ */
+OB_PLASMA_API ob_retort pool_deposit_batch_ex (pool_hose ph,
+                                               const bprotein *proteins,
+                                               int64 n, int64 *idx_out,
+                                               pool_timestamp *ts_out);
+
+/**
+ * How many deposits made by pool_deposit_async() can be on their way
+ * to a remote pool before it waits for the oldest to be acknowledged.
+ */
+#define POOL_DEPOSIT_WINDOW 64
+
+/**
+ * Called with the outcome of a deposit made by pool_deposit_async().
+ * \a tort is what pool_deposit_ex() would have returned, and if it
+ * is OB_OK, \a idx and \a ts are the index and timestamp the protein
+ * was given.  Since it is called from inside some later call on
+ * \a ph, it must not use \a ph itself.
+ */
+typedef void (*pool_deposit_callback) (pool_hose ph, ob_retort tort,
+                                       int64 idx, pool_timestamp ts,
+                                       void *cookie);
+
+/**
+ * Deposit a protein without waiting to hear how it went.  A remote
+ * hose sends the deposit and returns right away, so that deposits go
+ * out back to back rather than one per round trip; once
+ * POOL_DEPOSIT_WINDOW of them are in flight, it waits for the oldest
+ * to be acknowledged.  A local hose just deposits.
+ *
+ * If this returns OB_OK, \a cb (if not NULL) will be called exactly
+ * once with the outcome, and \a cookie.  That happens at the latest
+ * in pool_deposit_async_flush(), but the results of outstanding
+ * deposits are also collected when room is needed in the window, and
+ * before any other operation on the hose (including pool_withdraw()).
+ * If this returns an error, the protein was not sent, and \a cb is
+ * not called.
+ *
+ * \a p need not outlive this call.
+ */
+OB_PLASMA_API ob_retort pool_deposit_async (pool_hose ph, bprotein p,
+                                            pool_deposit_callback cb,
+                                            void *cookie);
+
+/**
+ * Wait until every deposit made with pool_deposit_async() on \a ph
+ * has been acknowledged, and its callback called.  Returns OB_OK, or
+ * the error which prevented that (which the remaining callbacks are
+ * given, too).
+ */
+OB_PLASMA_API ob_retort pool_deposit_async_flush (pool_hose ph);
 //@}
 
 /**
@@ -688,6 +761,115 @@ OB_PLASMA_API ob_retort pool_await_next (pool_hose ph, pool_timestamp timeout,
                                          pool_timestamp *ret_ts,
                                          int64 *ret_index);
 
+/**
+ * Makes this hose skip proteins which don't match \a filter (usually
+ * made with protein_filter(), but any slaw pool_probe_frwd() accepts
+ * as a search will do), when reading forward: pool_next(),
+ * pool_await_next(), pool_probe_frwd(), pool_await_probe_frwd(),
+ * and gang operations.  Proteins which are skipped are gone for good,
+ * as far as this hose is concerned.  The other ways of reading,
+ * like pool_nth_protein(), pool_prev() and pool_probe_back(), don't
+ * look at the filter.
+ *
+ * For a remote pool, the server applies the filter, if it is new
+ * enough to know how, so that proteins which don't match never cross
+ * the network.  Otherwise, they're filtered out on this end.
+ *
+ * A copy is made of \a filter.  NULL (or nil) removes the filter.
+ */
+OB_PLASMA_API ob_retort pool_hose_set_filter (pool_hose ph, bslaw filter);
+
+/**
+ * Returns the filter set with pool_hose_set_filter(), or NULL if
+ * there isn't one.  It belongs to the hose; don't free it.
+ */
+OB_PLASMA_API bslaw pool_hose_get_filter (pool_hose ph);
+
+/**
+ * Lets pool_next() on a remote hose fetch as many as \a max_proteins
+ * proteins in one round trip, and hand out the rest from memory on
+ * later calls, instead of asking the server for each protein in
+ * turn.  That's a big win for a hose which is reading through a
+ * backlog, over a slow network.  If \a max_bytes is positive, fewer
+ * proteins are fetched at once, so that (judging by the size of the
+ * ones fetched so far) they add up to about \a max_bytes.
+ *
+ * Proteins come out exactly as they would without read-ahead, with
+ * the same indexes, and the hose's index moves the same way; it's
+ * just that a protein may be fetched a little before pool_next() is
+ * called for it.  Read-ahead is off when \a max_proteins is 0, which
+ * is the default.  It is also skipped while the server is applying
+ * a filter for this hose (see pool_hose_set_filter()).  Local hoses
+ * have nothing to gain, and ignore the setting.
+ */
+OB_PLASMA_API ob_retort pool_hose_set_read_ahead (pool_hose ph,
+                                                  int64 max_proteins,
+                                                  int64 max_bytes);
+
+/**
+ * A protein borrowed from a pool by pool_nth_protein_view() or
+ * pool_next_view(), rather than copied out of it.
+ */
+typedef struct pool_protein_view
+{
+  bprotein p;        /*< the protein; don't free it or hang on to it */
+  pool_timestamp ts; /*< its timestamp */
+  int64 idx;         /*< its index */
+
+  // private: for pool_view_check() and pool_view_release()
+  protein copy;     /*< if the hose had to copy after all, the copy */
+  int64 len;        /*< length of p, in bytes */
+  unt64 entry;      /*< where p is in the pool */
+  const void *base; /*< where the pool was mapped when p was lent */
+} pool_protein_view;
+
+/**
+ * Like pool_nth_protein(), but for a local pool, \a view->p points
+ * straight into the pool, saving a malloc and a copy, which is nice
+ * when the protein is big and you only look at a bit of it.  Hoses
+ * which can't do that (remote ones, for example) lend out a copy, so
+ * this works with any hose.
+ *
+ * The catch is that nothing stops a depositor from overwriting the
+ * protein while you look at it, if the pool wraps around.  So look
+ * first, then call pool_view_check(): if it returns OB_OK, what you
+ * saw was the real protein, and if it returns POOL_NO_SUCH_PROTEIN,
+ * the protein was overwritten, and anything you read from it should
+ * be thrown away (or retried, with a copy).  Since slaw accessors
+ * trust the lengths they find, reading an overwritten protein can
+ * read anywhere in the pool; but nowhere outside it.
+ *
+ * \a view->p is only good until the next operation on \a ph, other
+ * than pool_view_check() and pool_view_release() (which may unmap it
+ * if the pool was resized).  Every successful call must be matched
+ * by one to pool_view_release().
+ */
+OB_PLASMA_API ob_retort pool_nth_protein_view (pool_hose ph, int64 idx,
+                                               pool_protein_view *view);
+
+/**
+ * Like pool_next(), but lends out the protein as
+ * pool_nth_protein_view() does.  A hose with a filter (see
+ * pool_hose_set_filter()) always lends out a copy, because the
+ * filter has to look at the whole protein before we know it's wanted.
+ */
+OB_PLASMA_API ob_retort pool_next_view (pool_hose ph, pool_protein_view *view);
+
+/**
+ * Returns OB_OK if the protein in \a view is still there, i. e. if
+ * everything read from it since it was lent out can be trusted, or
+ * POOL_NO_SUCH_PROTEIN if it has been overwritten.
+ */
+OB_PLASMA_API ob_retort pool_view_check (pool_hose ph,
+                                         const pool_protein_view *view);
+
+/**
+ * Gives back a view; \a view->p must not be used after this.  Returns
+ * what pool_view_check() would have.
+ */
+OB_PLASMA_API ob_retort pool_view_release (pool_hose ph,
+                                           pool_protein_view *view);
+
 /**
  * Enable pool_hose_wake_up() for this hose. Calling this function
  * multiple times on a hose is the same as calling it once on a
@@ -729,10 +911,11 @@ OB_PLASMA_API ob_retort pool_prev (pool_hose ph, protein *ret_prot,
 
 /**
  * Search forward in the pool for a protein with a descrip matching
- * that of the search argument. See pool_next for possible return
- * values.  On success (OB_OK), the hose's current index will be
- * 1 + *idx.  On failure (non-OB_OK), the hose's current index will
- * remain unchanged.
+ * that of the search argument (or, if \a search is a protein filter,
+ * see protein_filter(), for a protein matching the filter).  See
+ * pool_next for possible return values.  On success (OB_OK), the
+ * hose's current index will be 1 + *idx.  On failure (non-OB_OK), the
+ * hose's current index will remain unchanged.
  */
 OB_PLASMA_API ob_retort pool_probe_frwd (pool_hose ph, bslaw search,
                                          protein *ret_prot,
@@ -15,6 +15,7 @@
 #include <time.h>
 #include <limits.h>
 #include <assert.h>
+#include <signal.h>
 
 #include "libLoam/c/ob-sys.h"
 #include "libLoam/c/ob-dirs.h"
@@ -676,6 +677,15 @@ static ob_retort pool_mmap_open_file1 (const char *path, va_list vargs)
   return OB_OK;
 }
 
+/// Has the pool been resized since we mapped it?  Either its size is
+/// different, or (for pools which keep track) its resize generation.
+
+static bool mapping_is_stale (const pool_mmap_data *d)
+{
+  return (d->mapped_size != get_file_size (d)
+          || d->mapped_generation != get_resize_generation (d));
+}
+
 static void redo_mmap (pool_mmap_data *d, unt64 new_size, ob_retort *errp)
 {
   if (already_failed (errp))
@@ -692,6 +702,7 @@ static void redo_mmap (pool_mmap_data *d, unt64 new_size, ob_retort *errp)
     return;
   const mmap_version_funcs f = pool_mmap_get_version_funcs (mmv);
   ob_err_accum (errp, f.read_header (d));
+  d->mapped_generation = get_resize_generation (d);
   // cached index and entry will be invalid
   d->cached_index = -1;
   OB_INVALIDATE (d->cached_entry);
@@ -701,9 +712,8 @@ static void check_for_size_change (pool_mmap_data *d, ob_retort *errp)
 {
   if (already_failed (errp))
     return;
-  unt64 size_now = get_file_size (d);
-  if (size_now != d->mapped_size)
-    redo_mmap (d, size_now, errp);
+  if (mapping_is_stale (d))
+    redo_mmap (d, get_file_size (d), errp);
 }
 
 static void change_file_size (pool_mmap_data *d, unt64 new_size,
@@ -769,29 +779,41 @@ static void physically_resize (pool_mmap_data *d, unt64 new_size,
   redo_mmap (d, new_size, errp);
   OB_LOG_DEBUG_CODE (0x20104048, "new_size = 0x%016" OB_FMT_64 "x\n", new_size);
   ob_atomic_int64_set (&d->conf_chunk->file_size, (int64) new_size);
+  if (d->rsiz_chunk && !already_failed (errp))
+    d->mapped_generation =
+      ob_atomic_int64_add (&d->rsiz_chunk->generation, 1);
 }
 
-static void pool_mmap_sync (const pool_mmap_data *d, ob_retort *errp)
+static void sync_whole_file (const pool_mmap_data *d, ob_retort *errp)
 {
   if (already_failed (errp))
     return;
 
-  const unt64 flags = get_flags (d);
-
-  if (0 != (flags & POOL_FLAG_SYNC))
-    {
 // http://www.humboldt.co.uk/2009/03/fsync-across-platforms.html
 #if defined(_MSC_VER)
-      if (!FlushFileBuffers (d->file))
-        *errp = ob_win32err_to_retort (GetLastError ());
+  if (!FlushFileBuffers (d->file))
+    *errp = ob_win32err_to_retort (GetLastError ());
 #elif defined(__APPLE__)
-      if (fcntl (fileno (d->file), F_FULLFSYNC) == -1)
-        *errp = ob_errno_to_retort (errno);
+  if (fcntl (fileno (d->file), F_FULLFSYNC) == -1)
+    *errp = ob_errno_to_retort (errno);
 #else
-      if (fsync (fileno (d->file)) < 0)
-        *errp = ob_errno_to_retort (errno);
+  if (fsync (fileno (d->file)) < 0)
+    *errp = ob_errno_to_retort (errno);
 #endif
-    }
+}
+
+/// Is this a "sync" pool whose deposits are synced in groups, by
+/// pool_mmap_commit(), rather than one at a time, by pool_mmap_sync()?
+
+static bool commits_in_groups (const pool_mmap_data *d)
+{
+  return (d->cmit_chunk && 0 != (get_flags (d) & POOL_FLAG_SYNC));
+}
+
+static void pool_mmap_sync (const pool_mmap_data *d, ob_retort *errp)
+{
+  if (0 != (get_flags (d) & POOL_FLAG_SYNC) && !commits_in_groups (d))
+    sync_whole_file (d, errp);
 }
 
 /// Is this pool empty now and for the forseeable future?  This is
@@ -990,7 +1012,7 @@ static byte *entry_to_address_internal (const pool_mmap_data *d, unt64 entry,
 {
   if (already_failed (errp))
     return (byte *) &nothing[0];
-  if (d->mapped_size != get_file_size (d))
+  if (mapping_is_stale (d))
     {
       *errp = POOL_SIZE_CHANGED;
       return (byte *) &nothing[0];
@@ -1448,6 +1470,27 @@ static inline unt64 checksum_from_entry (const pool_mmap_data *d, unt64 entry,
 
 static ob_retort find_entry (pool_mmap_data *d, int64 idx, unt64 *ret_entry);
 
+/// Remembers that protein \a idx is at \a entry, in the dense index
+/// (if the pool has one).
+
+static void note_dense_entry (pool_mmap_data *d, int64 idx, unt64 entry)
+{
+  pool_chunk_dnse *dh = d->dnse_chunk;
+  if (dh && dh->capacity > 0)
+    ob_atomic_int64_set (&pool_dense_entries (dh)[idx % dh->capacity],
+                         (int64) entry);
+}
+
+static void clear_dense_index (pool_mmap_data *d)
+{
+  pool_chunk_dnse *dh = d->dnse_chunk;
+  if (dh)
+    memset (pool_dense_entries (dh), 0, dh->capacity * sizeof (int64));
+}
+
+static bool find_dense_entry (const pool_mmap_data *d, int64 idx,
+                              unt64 *ret_entry, ob_retort *errp);
+
 /// Routines for performing lookups by time
 
 static inline pool_timestamp timestamp_from_index (pool_mmap_data *d, int64 idx,
@@ -1521,13 +1564,46 @@ static ob_retort find_index_lookup_ends (const pool_mmap_data *d,
   return POOL_TOC_ENTRY_NULL_P (*start) ? POOL_NO_SUCH_PROTEIN : OB_OK;
 }
 
-static void find_next_protein_data (const pool_mmap_data *d, pool_toc_entry *e,
+/// Returns the entry at which the next lap around the file (after
+/// the one containing \a entry) begins.
+
+static unt64 next_lap_entry (const pool_mmap_data *d, unt64 entry,
+                             ob_retort *errp)
+{
+  const unt64 offset = entry_to_address (d, entry, errp) - d->mem;
+  return entry - offset + d->mapped_size + POOL_MMAP_PROTEINS_START_OFFSET (d);
+}
+
+/// Is \a entry the first one in its lap around the file?  Such an
+/// entry's jumpback doesn't lead anywhere useful, since the entry
+/// before it was the last one to fit at the end of the file.
+
+static bool is_first_in_lap (const pool_mmap_data *d, unt64 entry,
+                             ob_retort *errp)
+{
+  const unt64 offset = entry_to_address (d, entry, errp) - d->mem;
+  return offset == POOL_MMAP_PROTEINS_START_OFFSET (d);
+}
+
+static void find_next_protein_data (pool_mmap_data *d, pool_toc_entry *e,
                                     ob_retort *errp)
 {
   if (already_failed (errp))
     return;
   if (!POOL_TOC_ENTRY_NULL_P (*e) && e->idx < get_newest_index (d, errp))
     {
+      unt64 entry;
+      if (find_dense_entry (d, e->idx + 1, &entry, errp)
+          && fill_with_offset (d, entry, e, errp))
+        return;
+      // If e was the last entry to fit before the end of the file,
+      // what follows it is empty space, and the next entry is back
+      // at the beginning.
+      entry = next_lap_entry (d, e->offset, errp);
+      if (entry <= get_newest_entry (d)
+          && entry_to_index (d, entry, errp) == e->idx + 1
+          && fill_with_offset (d, entry, e, errp))
+        return;
       int64 delta = entry_size_from_entry_safe (d, e->offset, errp);
       if (delta < 0 || !fill_with_offset (d, e->offset + delta, e, errp))
         fill_with_oldest (d, e, errp);
@@ -1536,13 +1612,25 @@ static void find_next_protein_data (const pool_mmap_data *d, pool_toc_entry *e,
     *e = POOL_TOC_NULL_ENTRY;
 }
 
-static void find_previous_protein_data (const pool_mmap_data *d,
-                                        pool_toc_entry *e, ob_retort *errp)
+static void find_previous_protein_data (pool_mmap_data *d, pool_toc_entry *e,
+                                        ob_retort *errp)
 {
   if (already_failed (errp))
     return;
   if (!POOL_TOC_ENTRY_NULL_P (*e) && e->idx > get_oldest_index (d, errp))
     {
+      unt64 entry;
+      if (find_dense_entry (d, e->idx - 1, &entry, errp)
+          && fill_with_offset (d, entry, e, errp))
+        return;
+      if (is_first_in_lap (d, e->offset, errp))
+        {
+          // Can't jump back across the end of the file; look it up
+          if (find_entry (d, e->idx - 1, &entry) != OB_OK
+              || !fill_with_offset (d, entry, e, errp))
+            fill_with_newest (d, e, errp);
+          return;
+        }
       int64 delta = jumpback_size_from_entry_safe (d, e->offset, errp);
       if (delta < 0 || !fill_with_offset (d, e->offset - delta, e, errp))
         fill_with_newest (d, e, errp);
@@ -1551,7 +1639,7 @@ static void find_previous_protein_data (const pool_mmap_data *d,
     *e = POOL_TOC_NULL_ENTRY;
 }
 
-static ob_retort find_timestamp (const pool_mmap_data *d, pool_timestamp ts,
+static ob_retort find_timestamp (pool_mmap_data *d, pool_timestamp ts,
                                  const pool_toc_entry *start,
                                  const pool_toc_entry *last,
                                  time_comparison bound, int64 *idx)
@@ -1615,6 +1703,49 @@ static ob_retort find_timestamp (const pool_mmap_data *d, pool_timestamp ts,
   return OB_OK;
 }
 
+/// In a pool with a dense index, we can bisect our way from the
+/// range \a start to \a last (as found by find_index_lookup_ends())
+/// down to two neighboring entries, the first no later than \a ts
+/// and the second later, instead of leaving find_timestamp() to
+/// walk the whole range.  We give up (leaving find_timestamp() to
+/// walk what's left) if the index we want isn't in the dense index,
+/// or gets stompled while we look at it.
+
+static void bisect_timestamp (const pool_mmap_data *d, pool_timestamp ts,
+                              pool_toc_entry *start, pool_toc_entry *last,
+                              ob_retort *errp)
+{
+  if (already_failed (errp) || !d->dnse_chunk || start->stamp >= ts)
+    return;
+  pool_toc_entry lo = *start, hi = *last;
+  if (POOL_TOC_ENTRY_NULL_P (hi))
+    fill_with_newest (d, &hi, errp);
+  if (already_failed (errp) || hi.idx <= lo.idx)
+    return;
+  if (hi.stamp <= ts)
+    {
+      // Nothing later than ts; the newest is as close as it gets
+      *start = hi;
+      return;
+    }
+  while (hi.idx - lo.idx > 1)
+    {
+      pool_toc_entry mid;
+      mid.idx = lo.idx + (hi.idx - lo.idx) / 2;
+      if (!find_dense_entry (d, mid.idx, &mid.offset, errp))
+        break;
+      mid.stamp = timestamp_from_entry (d, mid.offset, errp);
+      if (is_entry_stompled (d, mid.offset, errp))
+        break;
+      if (mid.stamp <= ts)
+        lo = mid;
+      else
+        hi = mid;
+    }
+  *start = lo;
+  *last = hi;
+}
+
 static ob_retort pool_mmap_index_lookup (pool_hose ph, int64 *idx,
                                          pool_timestamp ts,
                                          time_comparison bound, bool relative)
@@ -1631,6 +1762,8 @@ static ob_retort pool_mmap_index_lookup (pool_hose ph, int64 *idx,
     return tort;
   pool_toc_entry start = POOL_TOC_NULL_ENTRY, end = POOL_TOC_NULL_ENTRY;
   ob_retort ret = find_index_lookup_ends (d, ts, bound, &start, &end);
+  if (OB_OK == ret)
+    bisect_timestamp (d, ts, &start, &end, &ret);
   if (OB_OK == ret)
     ret = find_timestamp (d, ts, &start, &end, bound, idx);
   return ret;
@@ -1864,12 +1997,465 @@ static void write_mmap_file (pool_mmap_data *d, unt64 *write_entry,
   *write_entry += size;
 }
 
-static unt64 compute_entry_checksum (bprotein p, int64 plen, pool_timestamp ts,
-                                     int64 idx)
+/// The part of a protein's checksum which doesn't depend on where
+/// it lands in the pool, so depositors can compute it before taking
+/// the deposit lock.  Only CRC-32C checksums split up like that;
+/// CityHash is seeded with the index, so it has to wait.
+
+static unt64 protein_checksum (const pool_mmap_data *d, bprotein p,
+                               int64 plen)
+{
+  const unt64 flags = get_flags (d);
+  if (0 == (flags & POOL_FLAG_CHECKSUM)
+      || 0 == (flags & POOL_FLAG_CHECKSUM_CRC32C))
+    return 0;
+  return ob_crc32c (p, plen, 0);
+}
+
+/// Finishes the checksum of the entry holding \a p, given what
+/// protein_checksum() returned for it.
+
+static unt64 compute_entry_checksum (const pool_mmap_data *d, bprotein p,
+                                     int64 plen, unt64 partial,
+                                     pool_timestamp ts, int64 idx)
 {
   unt64 ts_as_integer;
   memcpy (&ts_as_integer, &ts, sizeof (ts_as_integer));
-  return ob_city_hash64_with_seeds (p, plen, ts_as_integer, idx);
+  if (0 == (get_flags (d) & POOL_FLAG_CHECKSUM_CRC32C))
+    return ob_city_hash64_with_seeds (p, plen, ts_as_integer, idx);
+  const unt64 tail[2] = {ts_as_integer, (unt64) idx};
+  return ob_crc32c (tail, sizeof (tail), (unt32) partial);
+}
+
+/// Should this hose check the checksum of the protein it's reading?
+
+static bool should_verify (pool_mmap_data *d)
+{
+  if (0 == (get_flags (d) & POOL_FLAG_CHECKSUM))
+    return false;
+  const pool_chunk_csum *sh = d->csum_chunk;
+  if (!sh)
+    return true;
+  switch (sh->verify)
+    {
+      case POOL_VERIFY_NEVER:
+        return false;
+      case POOL_VERIFY_SAMPLED:
+        return (sh->sample <= 1 || 0 == (d->verify_count++ % sh->sample));
+      default:
+        return true;
+    }
+}
+
+/// Pools created with the "parallel-deposit" option let depositors
+/// copy their proteins into the pool without holding the deposit lock.
+/// Under the lock, a depositor only claims the space following the
+/// most recently claimed entry (the "reserved entry" in the rsrv chunk,
+/// which may be ahead of the newest entry), writes just enough of its
+/// entry that the next depositor can find the end of it, and records
+/// its pid against the claim.  Then it drops the lock, copies the rest
+/// of its protein, and waits for the entries before it to be published
+/// before publishing its own, so readers still see entries appear in
+/// index order.
+///
+/// Anything that overwrites old entries (wrapping around the end of
+/// the pool, or pushing the oldest entry forward), and anything else
+/// that rearranges the pool, waits until all claimed entries have been
+/// published first.  If whoever we're waiting on died between claiming
+/// its entry and publishing it, we publish it for them, as an empty
+/// protein of the same size, rather than wait forever.
+
+static inline bool has_reservations (const pool_mmap_data *d)
+{
+  return (d->rsrv_chunk != NULL);
+}
+
+static inline pool_rsrv_claim *claim_slot (const pool_mmap_data *d,
+                                           int64 idx)
+{
+  return &d->rsrv_chunk->claims[(unt64) idx % POOL_RSRV_CLAIMS];
+}
+
+/// Has the process with the given pid exited?
+
+static bool claimant_is_gone (int64 pid)
+{
+  if (pid <= 0)
+    return false;
+#ifdef _MSC_VER
+  HANDLE h = OpenProcess (SYNCHRONIZE, FALSE, (DWORD) pid);
+  if (!h)
+    return (GetLastError () == ERROR_INVALID_PARAMETER);
+  const bool gone = (WaitForSingleObject (h, 0) == WAIT_OBJECT_0);
+  CloseHandle (h);
+  return gone;
+#else
+  // EPERM means it's alive but not ours; only ESRCH means gone
+  return (kill ((pid_t) pid, 0) < 0 && errno == ESRCH);
+#endif
+}
+
+/// Add an entry which has just been published to the dense index and
+/// the pool index.
+
+static void index_entry (pool_mmap_data *d, int64 idx, unt64 entry,
+                         pool_timestamp ts)
+{
+  note_dense_entry (d, idx, entry);
+  if (!d->ptoc)
+    return;
+  pool_toc_entry e = {idx, entry, ts};
+  if (!pool_toc_append (d->ptoc, e, get_oldest_entry (d)))
+    OB_LOG_ERROR_CODE (0x2010401e,
+                       "hose '%s' pool '%s': "
+                       "failure registering protein in pool index: "
+                       "offset: %" OB_FMT_64
+                       "u, time: %lf, index: %" OB_FMT_64 "u\n",
+                       hname (d), pname (d), entry, ts, idx);
+}
+
+/// The depositor which claimed the entry with index @a idx died
+/// before publishing it, so publish it on their behalf.  Its protein
+/// may be only partly copied, so it becomes a protein with nothing
+/// but zeroed rude data, of the same length; only its header, which
+/// the claimant wrote with the deposit lock held, can be trusted.
+/// Awaiters aren't woken here; the deposit we're doing this for
+/// wakes them once it's published too.  @a dead is the claimant's pid.
+
+static void discard_claim (pool_mmap_data *d, const pool_rsrv_claim *c,
+                           int64 idx, int64 dead)
+{
+  ob_retort tort = OB_OK;
+  const unt64 entry = (unt64) c->entry;
+  const int64 plen = entry_size_from_entry (d, entry, &tort)
+                     - POOL_MMAP_PROTEIN_OFFSET (d) - POOL_MMAP_JUMPBACK_LEN;
+  byte *addr = entry_to_address (d, entry, &tort);
+  if (plen < (int64) (2 * sizeof (slaw_oct)) && !already_failed (&tort))
+    tort = POOL_CORRUPT;
+  if (primitive_get_newest_entry (d) != entry && !already_failed (&tort))
+    {
+      OB_LOG_ERROR_CODE (0x20104063,
+                         "hose '%s' pool '%s': depositor %" OB_FMT_64
+                         "d died before publishing index %" OB_FMT_64
+                         "d; discarding it\n",
+                         hname (d), pname (d), dead, idx);
+      slaw p = (slaw) (addr + POOL_MMAP_PROTEIN_OFFSET (d));
+      const unt64 rude = (unt64) plen - 2 * sizeof (slaw_oct);
+      p[1].o = (rude > 0 ? SLAW_PROTEIN_VERY_RUDE_FLAG | rude : 0);
+      memset (p + 2, 0, rude);
+      pool_timestamp ts;
+      memcpy (&ts, addr + POOL_MMAP_TIMESTAMP_OFFSET, sizeof (ts));
+      if (0 != (get_flags (d) & POOL_FLAG_CHECKSUM))
+        {
+          const unt64 sum =
+            compute_entry_checksum (d, p, plen, protein_checksum (d, p, plen),
+                                    ts, idx);
+          memcpy (addr + POOL_MMAP_CHECKSUM_OFFSET, &sum, sizeof (sum));
+        }
+      pool_mmap_sync (d, &tort);
+      set_newest_entry (d, entry, &tort);
+      if (!already_failed (&tort))
+        index_entry (d, idx, entry, ts);
+    }
+  // Even if it can't be published, don't let it hold up everyone else
+  if (already_failed (&tort))
+    OB_LOG_ERROR_CODE (0x20104064,
+                       "hose '%s' pool '%s': trouble discarding index "
+                       "%" OB_FMT_64 "d: %s\n",
+                       hname (d), pname (d), idx, ob_error_string (tort));
+  ob_atomic_int64_compare_and_swap (&d->conf_chunk->next_index, idx, idx + 1);
+}
+
+/// Wait until every entry before the one with index @a idx has been
+/// published.  Backs off from a brief pause to a millisecond between
+/// looks, and takes over publishing any entry whose depositor has died.
+
+static void wait_for_next_index (pool_mmap_data *d, int64 idx)
+{
+  const int64 me = getpid ();
+  unt32 usec = 1;
+  unt64 naps = 0;
+  int64 next;
+  while ((next = ob_atomic_int64_ref (&d->conf_chunk->next_index)) != idx)
+    {
+      pool_rsrv_claim *c = claim_slot (d, next);
+      const int64 pid = ob_atomic_int64_ref (&c->pid);
+      if (c->index == next && claimant_is_gone (pid)
+          && ob_atomic_int64_compare_and_swap (&c->pid, pid, me))
+        {
+          discard_claim (d, c, next, pid);
+          continue;
+        }
+      ob_micro_sleep (usec);
+      if (usec < 1000)
+        usec *= 2;
+      else if (++naps % 10000 == 0)
+        ob_log (OBLV_INFO, 0x20104055,
+                "hose '%s' pool '%s': still waiting for deposits "
+                "before index %" OB_FMT_64 "d\n",
+                hname (d), pname (d), idx);
+    }
+}
+
+/// Wait for all claimed entries to be published.  Must be called with
+/// the deposit lock held, so that nothing new gets claimed meanwhile.
+
+static void drain_reservations (pool_mmap_data *d)
+{
+  if (has_reservations (d) && d->rsrv_chunk->reserved_entry != 0)
+    wait_for_next_index (d, d->rsrv_chunk->reserved_index + 1);
+}
+
+/// After the newest entry has been changed behind the depositors'
+/// backs (with the deposit lock held and no claims outstanding),
+/// bring the reserved entry back in line with it.
+
+static void sync_reservations (pool_mmap_data *d)
+{
+  if (has_reservations (d))
+    d->rsrv_chunk->reserved_entry = (int64) primitive_get_newest_entry (d);
+}
+
+/// Claim the space right after the @a reserved entry, which may not
+/// have been published yet.  Returns 0 if that would mean wrapping
+/// around or overwriting the oldest entry, in which case the caller
+/// has to drain the outstanding reservations and do things the
+/// ordinary way.
+
+static unt64 claim_after_reservations (pool_mmap_data *d, unt64 reserved,
+                                       bprotein p, ob_retort *errp)
+{
+  if (already_failed (errp))
+    return 0;
+
+  if (0 != (get_flags (d) & POOL_FLAG_FROZEN))
+    {
+      *errp = POOL_FROZEN;
+      return 0;
+    }
+
+  const int64 sz = entry_size_from_entry (d, reserved, errp);
+  const unt64 write_len = entry_size_from_protein (d, p);
+  const byte *write_addr = sz + entry_to_address (d, reserved, errp);
+  const byte *oldest_addr =
+    entry_to_address (d, primitive_get_oldest_entry (d), errp);
+  if (already_failed (errp))
+    return 0;
+
+  if (write_addr + write_len >= d->mem + d->mapped_size)
+    return 0;
+  if (write_addr <= oldest_addr && write_addr + write_len > oldest_addr)
+    return 0;
+  return reserved + sz;
+}
+
+/// For "sync" pools created with the "group-commit" option,
+/// depositors don't sync with the deposit lock held.  Each one
+/// publishes its entry, notes in the cmit chunk how far the entries
+/// now go (see note_written()), and then waits in pool_mmap_commit()
+/// until somebody has synced that far.  That somebody is whichever
+/// waiter finds nobody else committing: it gives other depositors up
+/// to commit-latency to pile on, or until there are commit-batch of
+/// them (or until they stop coming), and syncs all their entries at
+/// once, with msync() on just the part of the file they occupy.
+
+/// Raises *loc to \a val, unless it's already at least that.
+
+static void atomic_raise (int64 *loc, int64 val)
+{
+  int64 was;
+  while ((was = ob_atomic_int64_ref (loc)) < val
+         && !ob_atomic_int64_compare_and_swap (loc, was, val))
+    ;
+}
+
+/// Microseconds, by a clock every process on the machine agrees on.
+
+static int64 commit_clock (void)
+{
+  return (int64) (ob_monotonic_time () / 1000);
+}
+
+/// A committer which hasn't finished after this much more than
+/// commit-latency is presumed dead, and taken over from.
+
+#define COMMIT_STALE_USEC 5000000
+
+static void note_written (pool_mmap_data *d, unt64 end, int64 count)
+{
+  pool_chunk_cmit *cm = d->cmit_chunk;
+  atomic_raise (&cm->written_end, (int64) end);
+  ob_atomic_int64_add (&cm->pending, count);
+}
+
+/// Syncs the part of the file holding the entries from \a from up to
+/// (not including) \a to, and the header, whose pointers say where
+/// the entries are.  Falls back to syncing the whole file if that's
+/// all the platform offers, or if the entries might be anywhere.
+
+static void sync_entries (const pool_mmap_data *d, unt64 from, unt64 to,
+                          ob_retort *errp)
+{
+  if (already_failed (errp))
+    return;
+#if defined(_MSC_VER) || defined(__APPLE__)
+  // msync() doesn't promise to get anything onto the disk on Mac OS X
+  sync_whole_file (d, errp);
+#else
+  const unt64 size = d->mapped_size;
+  const unt64 start = POOL_MMAP_PROTEINS_START_OFFSET (d);
+  // (Entries from before a resize, or already overwritten, are
+  // older than the oldest entry.)
+  if (size != get_file_size (d) || from < get_oldest_entry (d) || to < from
+      || to - from >= size - start)
+    {
+      sync_whole_file (d, errp);
+      return;
+    }
+
+  unt64 ranges[3][2];
+  int n = 0;
+  ranges[n][0] = 0;
+  ranges[n++][1] = start;
+  if (to > from)
+    {
+      const unt64 lo = from % size;
+      const unt64 hi = ((to - 1) % size) + 1;
+      if (lo < hi)
+        {
+          ranges[n][0] = lo;
+          ranges[n++][1] = hi;
+        }
+      else
+        {
+          ranges[n][0] = lo;
+          ranges[n++][1] = size;
+          ranges[n][0] = start;
+          ranges[n++][1] = hi;
+        }
+    }
+
+  const unt64 page = (unt64) sysconf (_SC_PAGESIZE);
+  int i;
+  for (i = 0; i < n; i++)
+    {
+      const unt64 lo = ranges[i][0] - (ranges[i][0] % page);
+      if (msync (d->mem + lo, ranges[i][1] - lo, MS_SYNC) < 0)
+        {
+          *errp = ob_errno_to_retort (errno);
+          return;
+        }
+    }
+#endif
+}
+
+/// Syncs everything deposited so far, having set committing to
+/// \a began.
+
+static void lead_commit (pool_mmap_data *d, int64 began, unt32 nap,
+                         ob_retort *errp)
+{
+  pool_chunk_cmit *cm = d->cmit_chunk;
+  const int64 latency = ob_atomic_int64_ref (&cm->latency_usec);
+  const int64 batch = ob_atomic_int64_ref (&cm->batch);
+
+  // Wait for company, but not if nobody else is depositing
+  int64 n = ob_atomic_int64_ref (&cm->pending);
+  while (n < batch && commit_clock () - began < latency)
+    {
+      ob_micro_sleep (nap);
+      const int64 more = ob_atomic_int64_ref (&cm->pending);
+      if (more == n)
+        break;
+      n = more;
+    }
+
+  // Anything counted in n is covered by to, since note_written()
+  // raises written_end first.
+  n = ob_atomic_int64_ref (&cm->pending);
+  const int64 from = ob_atomic_int64_ref (&cm->synced_end);
+  const int64 to = ob_atomic_int64_ref (&cm->written_end);
+  sync_entries (d, (unt64) from, (unt64) to, errp);
+  if (!already_failed (errp))
+    {
+      atomic_raise (&cm->synced_end, to);
+      ob_atomic_int64_add (&cm->pending, -n);
+    }
+  ob_atomic_int64_compare_and_swap (&cm->committing, began, 0);
+}
+
+/// Waits until the entries up to \a end are on disk, syncing them
+/// (and whatever else is waiting) if nobody else is.
+
+static void pool_mmap_commit (pool_mmap_data *d, unt64 end, ob_retort *errp)
+{
+  if (already_failed (errp))
+    return;
+  pool_chunk_cmit *cm = d->cmit_chunk;
+  const int64 latency = ob_atomic_int64_ref (&cm->latency_usec);
+  const int64 stale = latency + COMMIT_STALE_USEC;
+  const unt32 nap = (unt32) (latency < 160 ? 20 : latency > 8000 ? 1000
+                                                                 : latency / 8);
+  while (ob_atomic_int64_ref (&cm->synced_end) < (int64) end)
+    {
+      const int64 now = commit_clock ();
+      const int64 began = ob_atomic_int64_ref (&cm->committing);
+      if ((began == 0 || now - began > stale)
+          && ob_atomic_int64_compare_and_swap (&cm->committing, began, now))
+        {
+          lead_commit (d, now, nap, errp);
+          if (already_failed (errp))
+            return;
+        }
+      else
+        ob_micro_sleep (nap);
+    }
+}
+
+/// Sets the group commit options (see pool-create-options.md), if
+/// this pool does group commit, and \a options mentions them.
+
+static void set_commit_options (pool_mmap_data *d, bslaw options)
+{
+  pool_chunk_cmit *cm = d->cmit_chunk;
+  if (!cm)
+    return;
+  const float64 latency = slaw_path_get_float64 (options, "commit-latency", -1);
+  if (latency >= 0)
+    ob_atomic_int64_set (&cm->latency_usec, (int64) (latency * 1e6));
+  const int64 batch = slaw_path_get_int64 (options, "commit-batch", 0);
+  if (batch > 0)
+    ob_atomic_int64_set (&cm->batch, batch);
+}
+
+static const char *const verify_names[] = {"always", "sampled", "never"};
+
+/// Sets how often checksums are verified (see pool-create-options.md),
+/// if \a options says, and this pool has checksums to verify.
+
+static void set_checksum_options (pool_mmap_data *d, bslaw options)
+{
+  pool_chunk_csum *sh = d->csum_chunk;
+  if (!sh)
+    return;
+  const char *verify = slaw_path_get_string (options, "checksum-verify", NULL);
+  if (verify)
+    {
+      int64 i;
+      for (i = 0; i < 3; i++)
+        if (0 == strcmp (verify, verify_names[i]))
+          break;
+      if (i < 3)
+        ob_atomic_int64_set (&sh->verify, i);
+      else
+        OB_LOG_WARNING_CODE (0x2010405b, "unknown checksum-verify '%s' "
+                                         "for pool '%s'; should be 'always',\n"
+                                         "'sampled', or 'never'\n",
+                             verify, pname (d));
+    }
+  const int64 sample = slaw_path_get_int64 (options, "checksum-sample", 0);
+  if (sample > 0)
+    ob_atomic_int64_set (&sh->sample, sample);
 }
 
 /// The actual exported protein deposit function.
@@ -1923,6 +2509,9 @@ ob_retort pool_mmap_deposit (pool_hose ph, bprotein p, int64 *idx,
   // jumpback length.
   unt64 entry_size = entry_size_from_protein (d, p);
 
+  // Likewise for as much of the checksum as we can.
+  const unt64 partial_checksum = protein_checksum (d, p, plen);
+
   // This lock should enclose as little as possible.  Manipulation of
   // the pool's write entry, oldest entry, and newest entry, as
   // well as the actual writing of the protein must be inside it.
@@ -1939,21 +2528,54 @@ ob_retort pool_mmap_deposit (pool_hose ph, bprotein p, int64 *idx,
   if (entry_size > pool_entry_space (d) && !already_failed (&pret))
     pret = POOL_PROTEIN_BIGGER_THAN_POOL;
 
-  // The updated newest index isn't visible until we (a) write the
-  // entry (containing the index) (b) set the newest entry to point to
-  // it.
-  int64 newest_index = get_newest_index (d, &pret);
-  if (newest_index < 0)
-    newest_index = ob_atomic_int64_ref (&d->conf_chunk->next_index);
+  const bool parallel = has_reservations (d);
+  int64 newest_index;
+  unt64 former_newest_entry;
+  unt64 write_entry = 0;
+  if (parallel)
+    {
+      // Other depositors may still be copying their proteins, so go by
+      // the most recently claimed entry rather than the newest one.
+      // There's only room to keep track of so many of them, though.
+      if (d->rsrv_chunk->reserved_entry != 0
+          && d->rsrv_chunk->reserved_index
+               >= ob_atomic_int64_ref (&d->conf_chunk->next_index)
+                    + POOL_RSRV_CLAIMS - 1)
+        drain_reservations (d);
+      former_newest_entry = (unt64) d->rsrv_chunk->reserved_entry;
+      if (former_newest_entry == 0)
+        newest_index = ob_atomic_int64_ref (&d->conf_chunk->next_index);
+      else
+        newest_index = d->rsrv_chunk->reserved_index + 1;
+      if (former_newest_entry != primitive_get_newest_entry (d))
+        write_entry =
+          claim_after_reservations (d, former_newest_entry, p, &pret);
+      if (write_entry == 0 && !already_failed (&pret))
+        {
+          // Making room means touching entries which may still be
+          // in flight, so let them land first.
+          drain_reservations (d);
+          write_entry = pool_prepare_write (d, p, &pret);
+        }
+    }
   else
-    newest_index++;
+    {
+      // The updated newest index isn't visible until we (a) write the
+      // entry (containing the index) (b) set the newest entry to point
+      // to it.
+      newest_index = get_newest_index (d, &pret);
+      if (newest_index < 0)
+        newest_index = ob_atomic_int64_ref (&d->conf_chunk->next_index);
+      else
+        newest_index++;
 
-  unt64 former_newest_entry = get_newest_entry (d);
+      former_newest_entry = get_newest_entry (d);
 
-  // Update the oldest entry and write entry for the pool - deals with
-  // proteins wrapping around the end of the queue, and with
-  // overwriting the previous oldest protein.
-  unt64 write_entry = pool_prepare_write (d, p, &pret);
+      // Update the oldest entry and write entry for the pool - deals
+      // with proteins wrapping around the end of the queue, and with
+      // overwriting the previous oldest protein.
+      write_entry = pool_prepare_write (d, p, &pret);
+    }
   if (former_newest_entry == write_entry && !already_failed (&pret))
     {
       OB_LOG_ERROR_CODE (0x2010401d, "hose '%s' pool '%s': "
@@ -1976,61 +2598,282 @@ ob_retort pool_mmap_deposit (pool_hose ph, bprotein p, int64 *idx,
   // index
   write_mmap_file (d, &write_entry, &newest_index, sizeof (newest_index),
                    &pret);
-  // checksum; optional
+  // checksum; optional, and filled in once the protein is in place
+  unt64 checksum_entry = write_entry;
   if (0 != (flags & POOL_FLAG_CHECKSUM))
-    {
-      unt64 checksum =
-        compute_entry_checksum (p, plen, timestamp, newest_index);
-      write_mmap_file (d, &write_entry, &checksum, sizeof (checksum), &pret);
-    }
-  // protein itself
-  write_mmap_file (d, &write_entry, p, plen, &pret);
+    write_entry += sizeof (unt64);
+  // protein itself; for a parallel deposit, only its header for now,
+  // which is all the next depositor needs to find the end of our entry
+  const unt64 protein_entry = write_entry;
+  const int64 head = (parallel && plen > 16 ? 16 : plen);
+  write_mmap_file (d, &write_entry, p, head, &pret);
+  write_entry = protein_entry + plen;
   // jumpback length
   write_mmap_file (d, &write_entry, &entry_size, sizeof (entry_size), &pret);
 
+  bool claimed = false;
+  if (parallel)
+    {
+      if (!already_failed (&pret))
+        {
+          pool_rsrv_claim *c = claim_slot (d, newest_index);
+          ob_atomic_int64_set (&c->pid, 0);
+          c->index = newest_index;
+          c->entry = (int64) newest_entry;
+          ob_atomic_int64_set (&c->pid, getpid ());
+          d->rsrv_chunk->reserved_index = newest_index;
+          d->rsrv_chunk->reserved_entry = (int64) newest_entry;
+          claimed = true;
+        }
+      ob_err_accum (&pret, pool_deposit_unlock (ph));
+      unt64 rest_entry = protein_entry + head;
+      write_mmap_file (d, &rest_entry, (const byte *) p + head, plen - head,
+                       &pret);
+    }
+
+  if (0 != (flags & POOL_FLAG_CHECKSUM))
+    {
+      unt64 checksum = compute_entry_checksum (d, p, plen, partial_checksum,
+                                               timestamp, newest_index);
+      write_mmap_file (d, &checksum_entry, &checksum, sizeof (checksum),
+                       &pret);
+    }
+
   pool_mmap_sync (d, &pret);
 
   // Readers may be looking at the newest entry at any time, so don't
   // update it until the protein is fully written out.
-  set_newest_entry (d, newest_entry, &pret);
+  if (claimed)
+    {
+      // Entries must be published in order, and whoever claimed the
+      // entry after ours is counting on us to publish, come what may.
+      wait_for_next_index (d, newest_index);
+      ob_retort tort = OB_OK;
+      set_newest_entry (d, newest_entry, &tort);
+      ob_err_accum (&pret, tort);
+    }
+  else
+    set_newest_entry (d, newest_entry, &pret);
 
   // Check to see if we overwrote the pool header
   check_oldest_less_than_newest (d, &pret);
 
-  // Memoize deposit in the pool index
-  if (d->ptoc && !already_failed (&pret))
+  const bool group = commits_in_groups (d) && !already_failed (&pret);
+  if (group)
+    note_written (d, newest_entry + entry_size, 1);
+
+  // Memoize deposit in the pool index
+  if (!already_failed (&pret))
+    index_entry (d, newest_index, newest_entry, timestamp);
+
+  if (claimed || !already_failed (&pret))
+    ob_atomic_int64_set (&d->conf_chunk->next_index, newest_index + 1);
+
+  // Drop the deposit lock (a parallel deposit already did).
+  if (!parallel)
+    ob_err_accum (&pret, pool_deposit_unlock (ph));
+
+  // Fifo-based single pool awaiters are also awoken by the multi-pool
+  // awake.  Fifo await/awake doesn't need to hold the lock because it
+  // re-checks for a protein deposit after setting up the fifo - the
+  // fifo covers the race window between checking for a protein
+  // deposit and going to sleep.  Futex await/awake works the same
+  // way, with notify_seq standing in for the fifo.
+#ifdef __gnu_linux__
+  if (ph->futex_view)
+    ob_err_accum (&pret, pool_futex_wake_awaiters (ph));
+  else
+#endif
+    ob_err_accum (&pret, pool_multi_wake_awaiters (ph));
+
+  // Readers can have it already, but our caller has to wait until
+  // it's on disk.
+  if (group)
+    pool_mmap_commit (d, newest_entry + entry_size, &pret);
+
+  // Return the index of this protein if requested
+  if (idx)
+    *idx = newest_index;
+  if (ret_ts)
+    *ret_ts = timestamp;
+  // All done!!
+  protein_free (freeme);
+  return pret;
+}
+
+/// Write one entry the ordinary (not parallel) way, with the deposit
+/// lock held, and publish it.  Returns its index.
+
+static int64 deposit_locked (pool_mmap_data *d, bprotein p,
+                             unt64 partial_checksum, pool_timestamp timestamp,
+                             ob_retort *errp)
+{
+  if (already_failed (errp))
+    return -1;
+
+  const unt64 flags = get_flags (d);
+  const int64 plen = protein_len (p);
+  unt64 entry_size = entry_size_from_protein (d, p);
+  if (entry_size > pool_entry_space (d))
+    {
+      *errp = POOL_PROTEIN_BIGGER_THAN_POOL;
+      return -1;
+    }
+
+  int64 newest_index = get_newest_index (d, errp);
+  if (newest_index < 0)
+    newest_index = ob_atomic_int64_ref (&d->conf_chunk->next_index);
+  else
+    newest_index++;
+  const unt64 former_newest_entry = get_newest_entry (d);
+  unt64 write_entry = pool_prepare_write (d, p, errp);
+  if (former_newest_entry == write_entry && !already_failed (errp))
+    {
+      OB_LOG_ERROR_CODE (0x20104057, "hose '%s' pool '%s': "
+                                     "CORRUPTION!!! prepare write returned "
+                                     "newest entry %" OB_FMT_64 "u\n",
+                         hname (d), pname (d), write_entry);
+      *errp = POOL_CORRUPT;
+    }
+
+  const unt64 newest_entry = write_entry;
+  write_mmap_file (d, &write_entry, &timestamp, sizeof (timestamp), errp);
+  write_mmap_file (d, &write_entry, &newest_index, sizeof (newest_index),
+                   errp);
+  if (0 != (flags & POOL_FLAG_CHECKSUM))
+    {
+      unt64 checksum = compute_entry_checksum (d, p, plen, partial_checksum,
+                                               timestamp, newest_index);
+      write_mmap_file (d, &write_entry, &checksum, sizeof (checksum), errp);
+    }
+  write_mmap_file (d, &write_entry, p, plen, errp);
+  write_mmap_file (d, &write_entry, &entry_size, sizeof (entry_size), errp);
+
+  set_newest_entry (d, newest_entry, errp);
+  check_oldest_less_than_newest (d, errp);
+  if (already_failed (errp))
+    return -1;
+
+  note_dense_entry (d, newest_index, newest_entry);
+  if (d->ptoc)
     {
       pool_toc_entry e = {newest_index, newest_entry, timestamp};
       if (!pool_toc_append (d->ptoc, e, get_oldest_entry (d)))
-        OB_LOG_ERROR_CODE (0x2010401e,
+        OB_LOG_ERROR_CODE (0x20104058,
                            "hose '%s' pool '%s': "
                            "failure registering protein in pool index: "
                            "offset: %" OB_FMT_64
                            "u, time: %lf, index: %" OB_FMT_64 "u\n",
-                           hname (d), pname (d), write_entry, timestamp,
+                           hname (d), pname (d), newest_entry, timestamp,
                            newest_index);
     }
+  ob_atomic_int64_set (&d->conf_chunk->next_index, newest_index + 1);
+  return newest_index;
+}
 
-  if (!already_failed (&pret))
-    ob_atomic_int64_set (&d->conf_chunk->next_index, newest_index + 1);
+/// Deposit several proteins under one hold of the deposit lock, with
+/// one timestamp, one sync and one round of notification for all of
+/// them.  Each entry is still published as soon as it's written, so
+/// readers never have to wait for the rest of the batch.
 
-  // Drop the deposit lock.
-  ob_err_accum (&pret, pool_deposit_unlock (ph));
+ob_retort pool_mmap_deposit_batch (pool_hose ph, const bprotein *ps, int64 n,
+                                   int64 *idx_out, pool_timestamp *ts_out)
+{
+  pool_mmap_data *d = pool_mmap_get_data (ph);
+  int64 i;
 
-  // Fifo-based single pool awaiters are also awoken by the multi-pool
-  // awake.  Fifo await/awake doesn't need to hold the lock because it
-  // re-checks for a protein deposit after setting up the fifo - the
-  // fifo covers the race window between checking for a protein
-  // deposit and going to sleep.
-  ob_err_accum (&pret, pool_multi_wake_awaiters (ph));
+  // Legacy pools need each protein translated; they can take the long way.
+  if (get_slaw_version (d) != SLAW_VERSION_CURRENT)
+    {
+      ob_retort pret = OB_OK;
+      for (i = 0; i < n; i++)
+        {
+          if (pret == OB_OK)
+            pret = pool_mmap_deposit (ph, ps[i], &idx_out[i], &ts_out[i]);
+          if (pret != OB_OK)
+            idx_out[i] = pret;
+        }
+      return pret;
+    }
 
-  // Return the index of this protein if requested
-  if (idx)
-    *idx = newest_index;
-  if (ret_ts)
-    *ret_ts = timestamp;
-  // All done!!
-  protein_free (freeme);
+  const pool_timestamp timestamp = pool_timestamp_now ();
+
+  // As in pool_mmap_deposit(), checksum what we can before locking.
+  unt64 *partial = NULL;
+  if (0 != (get_flags (d) & POOL_FLAG_CHECKSUM_CRC32C))
+    {
+      partial = (unt64 *) malloc (n * sizeof (*partial));
+      if (!partial)
+        {
+          for (i = 0; i < n; i++)
+            idx_out[i] = OB_NO_MEM;
+          return OB_NO_MEM;
+        }
+      for (i = 0; i < n; i++)
+        partial[i] = protein_checksum (d, ps[i], protein_len (ps[i]));
+    }
+
+  ob_retort pret = pool_deposit_lock (ph);
+  if (pret != OB_OK)
+    {
+      free (partial);
+      for (i = 0; i < n; i++)
+        idx_out[i] = pret;
+      return pret;
+    }
+
+  check_for_size_change (d, &pret);
+
+  // We hold the lock for the whole batch anyway, so a parallel-deposit
+  // pool gets the ordinary treatment, once the deposits in flight land.
+  const bool parallel = has_reservations (d);
+  if (parallel)
+    drain_reservations (d);
+
+  int64 last = -1;
+  for (i = 0; i < n; i++)
+    {
+      const int64 idx =
+        deposit_locked (d, ps[i], partial ? partial[i] : 0, timestamp, &pret);
+      if (already_failed (&pret))
+        break;
+      idx_out[i] = last = idx;
+      ts_out[i] = timestamp;
+    }
+  unt64 end = 0;
+  if (last >= 0 && commits_in_groups (d))
+    {
+      end = get_newest_entry (d) + entry_size_from_protein (d, ps[i - 1]);
+      note_written (d, end, i);
+    }
+  for (; i < n; i++)
+    idx_out[i] = pret;
+  free (partial);
+
+  if (parallel && last >= 0)
+    {
+      d->rsrv_chunk->reserved_index = last;
+      sync_reservations (d);
+    }
+
+  pool_mmap_sync (d, &pret);
+  ob_err_accum (&pret, pool_deposit_unlock (ph));
+
+  if (last >= 0)
+    {
+#ifdef __gnu_linux__
+      if (ph->futex_view)
+        ob_err_accum (&pret, pool_futex_wake_awaiters (ph));
+      else
+#endif
+        ob_err_accum (&pret, pool_multi_wake_awaiters (ph));
+    }
+  if (end > 0)
+    {
+      ob_retort tort = OB_OK;
+      pool_mmap_commit (d, end, &tort);
+      ob_err_accum (&pret, tort);
+    }
   return pret;
 }
 
@@ -2048,9 +2891,15 @@ ob_retort pool_mmap_advance_oldest (pool_hose ph, int64 idx_in)
     {
       // a very special case that makes the pool completely empty
       pret = pool_deposit_lock (ph);
-      newest_index = get_newest_index (d, &pret);
       if (pret < OB_OK)
         return pret;
+      drain_reservations (d);
+      newest_index = get_newest_index (d, &pret);
+      if (pret < OB_OK)
+        {
+          ob_err_accum (&pret, pool_deposit_unlock (ph));
+          return pret;
+        }
       // Is it still true, now that we have the lock?
       if (idx_in == newest_index + 1)
         {
@@ -2060,6 +2909,7 @@ ob_retort pool_mmap_advance_oldest (pool_hose ph, int64 idx_in)
           // This is what makes the pool empty
           primitive_set_oldest_entry (d, new_oldest);
           primitive_set_newest_entry (d, 0);
+          sync_reservations (d);
           goto cleanup;
         }
       // If not, unlock and we're back to the "ordinary" path
@@ -2417,6 +3267,28 @@ static bool find_in_range (pool_mmap_data *d, int64 idx, unt64 *ret_entry,
   return true;
 }
 
+/// Looks \a idx up in the dense index.  Returns false if it isn't
+/// there (or the pool has no dense index), in which case we have to
+/// go looking for it the hard way.
+
+static bool find_dense_entry (const pool_mmap_data *d, int64 idx,
+                              unt64 *ret_entry, ob_retort *errp)
+{
+  pool_chunk_dnse *dh = d->dnse_chunk;
+  if (!dh || dh->capacity <= 0 || idx < 0)
+    return false;
+  const unt64 entry =
+    (unt64) ob_atomic_int64_ref (&pool_dense_entries (dh)[idx % dh->capacity]);
+  if (entry == 0)
+    return false;
+  // Some other protein may have taken the slot since, or be about
+  // to be overwritten; entry_to_index() returns -1 in the latter case.
+  if (entry_to_index (d, entry, errp) != idx || already_failed (errp))
+    return false;
+  *ret_entry = entry;
+  return true;
+}
+
 /// Given the index of an entry, find the offset of the entry in the
 /// mmap()ed region.  Can fail if the protein with the index we're
 /// looking for has been overwritten.  The index must already have
@@ -2440,6 +3312,10 @@ static ob_retort find_entry (pool_mmap_data *d, int64 idx, unt64 *ret_entry)
       return OB_OK;
     }
 
+  // Next best: a pool with a dense index knows where everything is.
+  if (find_dense_entry (d, idx, ret_entry, &tort) || already_failed (&tort))
+    return tort;
+
   // Sigh.  Must trundle through all the proteins in the pool to find
   // the one we want.  We're going to have to start over if the oldest
   // entry passes by our current search entry.  Keep retrying until we
@@ -2492,6 +3368,16 @@ static protein vanilla_prot_copy (volatile protein prot, int64 len,
   return new_prot;
 }
 
+/// Doesn't copy at all, for pool_nth_protein_view().
+
+static protein borrowed_prot (volatile protein prot, OB_UNUSED int64 len,
+                              OB_UNUSED pool_fetch_op *unused, ob_retort *errp)
+{
+  if (already_failed (errp))
+    return NULL;
+  return (protein) prot;
+}
+
 /* Put guard words around the prot8 and slaw8 arrays, so we can detect
  * out-of-bounds reads with valgrind.  (Nothing in the code below should
  * need more than two octs, but let's verify that.) */
@@ -2666,7 +3552,7 @@ static ob_retort pool_mmap_nth_protein1 (pool_mmap_data *d, int64 idx,
                                          protein *return_prot,
                                          pool_timestamp *ret_ts,
                                          prot_copy_func pcfunc,
-                                         pool_fetch_op *arg);
+                                         pool_fetch_op *arg, unt64 *ret_entry);
 
 /// Exported mmap implementation of nth_protein().
 
@@ -2683,13 +3569,69 @@ ob_retort pool_mmap_nth_protein (pool_hose ph, int64 idx, protein *return_prot,
       if (already_failed (&tort))
         break;
       tort = pool_mmap_nth_protein1 (d, idx, return_prot, ret_ts,
-                                     vanilla_prot_copy, NULL);
+                                     vanilla_prot_copy, NULL, NULL);
     }
   while (POOL_SIZE_CHANGED == tort);
 
   return tort;
 }
 
+/// mmap implementation of nth_view(): like nth_protein(), but the
+/// protein is left where it is, and the view remembers which entry
+/// and which mapping it's in, for pool_mmap_view_check().
+
+static ob_retort pool_mmap_nth_view (pool_hose ph, int64 idx,
+                                     pool_protein_view *view)
+{
+  ob_retort tort;
+  pool_mmap_data *d = pool_mmap_get_data (ph);
+  if (get_slaw_version (d) != SLAW_VERSION_CURRENT)
+    /* Old slaw formats have to be converted, i. e. copied. */
+    return POOL_UNSUPPORTED_OPERATION;
+
+  protein p = NULL;
+  unt64 entry = 0;
+  do
+    {
+      tort = OB_OK;
+      check_for_size_change (d, &tort);
+      if (already_failed (&tort))
+        break;
+      tort = pool_mmap_nth_protein1 (d, idx, &p, &view->ts, borrowed_prot,
+                                     NULL, &entry);
+    }
+  while (POOL_SIZE_CHANGED == tort);
+
+  if (tort < OB_OK)
+    return tort;
+  view->p = p;
+  view->len = slaw_len (p);
+  view->entry = entry;
+  view->base = d->mem;
+  // Also checks that what we just read is still there
+  view->idx = entry_to_index (d, entry, &tort);
+  if (tort < OB_OK)
+    return tort;
+  if (view->idx < 0)
+    return POOL_NO_SUCH_PROTEIN;
+  return OB_OK;
+}
+
+/// Was the entry behind \a view overwritten (or unmapped) since it
+/// was handed out?
+
+static ob_retort pool_mmap_view_check (pool_hose ph,
+                                       const pool_protein_view *view)
+{
+  pool_mmap_data *d = pool_mmap_get_data (ph);
+  if (view->base != d->mem || mapping_is_stale (d))
+    return POOL_NO_SUCH_PROTEIN;
+  ob_retort tort = OB_OK;
+  if (is_entry_stompled (d, view->entry, &tort))
+    return (tort < OB_OK ? tort : POOL_NO_SUCH_PROTEIN);
+  return OB_OK;
+}
+
 // Exported mmap implementation of fetch().
 
 static ob_retort pool_mmap_fetch (pool_hose ph, pool_fetch_op *ops, int64 nops,
@@ -2727,7 +3669,7 @@ static ob_retort pool_mmap_fetch (pool_hose ph, pool_fetch_op *ops, int64 nops,
         if (already_failed (&tort))
           goto woe;
         tort = pool_mmap_nth_protein1 (d, ops[i].idx, &ops[i].p, &ops[i].ts,
-                                       fetch_prot_copy, &ops[i]);
+                                       fetch_prot_copy, &ops[i], NULL);
         ops[i].tort = tort;
         again = (POOL_SIZE_CHANGED == tort);
         if (clamp && POOL_NO_SUCH_PROTEIN == tort)
@@ -2773,7 +3715,8 @@ static OB_UNUSED ob_retort pool_mmap_nth_protein1 (pool_mmap_data *d, int64 idx,
                                                    protein *return_prot,
                                                    pool_timestamp *ret_ts,
                                                    prot_copy_func pcfunc,
-                                                   pool_fetch_op *arg)
+                                                   pool_fetch_op *arg,
+                                                   unt64 *ret_entry)
 {
   // Do we have any entries at all?
   if (is_pool_empty (d))
@@ -2851,7 +3794,8 @@ static OB_UNUSED ob_retort pool_mmap_nth_protein1 (pool_mmap_data *d, int64 idx,
   const bool stomp = is_entry_stompled (d, entry, &stomp_tort);
   if (stomp || already_failed (&tort) || already_failed (&stomp_tort))
     {
-      free (new_prot);
+      if (new_prot != prot)
+        free (new_prot);
       if (stomp_tort < OB_OK)
         return stomp_tort;
       else if (stomp)
@@ -2859,13 +3803,15 @@ static OB_UNUSED ob_retort pool_mmap_nth_protein1 (pool_mmap_data *d, int64 idx,
       else
         return tort;
     }
-  const unt64 flags = get_flags (d);
-  if (0 != (flags & POOL_FLAG_CHECKSUM))
+  if (should_verify (d))
     {
-      const unt64 checksum = compute_entry_checksum (new_prot, len, ts, idx);
+      const unt64 checksum =
+        compute_entry_checksum (d, new_prot, len,
+                                protein_checksum (d, new_prot, len), ts, idx);
       if (checksum != expected_checksum)
         {
-          free (new_prot);
+          if (new_prot != prot)
+            free (new_prot);
           OB_LOG_ERROR_CODE (0x2010404f,
                              "hose '%s' pool '%s':\n"
                              "Expected checksum %016" OB_FMT_64 "x\n"
@@ -2881,6 +3827,8 @@ static OB_UNUSED ob_retort pool_mmap_nth_protein1 (pool_mmap_data *d, int64 idx,
                               get_slaw_version (d));
   if (ret_ts)
     *ret_ts = ts;
+  if (ret_entry)
+    *ret_entry = entry;
   // Heuristic: don't cache the position if we're near the beginning
   // or end of the pool, since those are easy to find anyway.  A cached
   // position in the "middle" of the pool is more valuable, so don't
@@ -2899,6 +3847,13 @@ static OB_UNUSED ob_retort pool_mmap_nth_protein1 (pool_mmap_data *d, int64 idx,
 
 static ob_retort pool_mmap_participate_cleanup (pool_hose ph, ob_retort pret)
 {
+  // This takes the notification lock, which may live in the backing
+  // file, so do it before we let go of that.
+#ifdef __gnu_linux__
+  pool_futex_multi_destroy_awaiter (ph);
+#endif
+  pool_fifo_multi_destroy_awaiter (ph);
+
   pool_mmap_data *d = NULL;
   if ((d = (pool_mmap_data *) ph->ext))
     {
@@ -2923,7 +3878,6 @@ static ob_retort pool_mmap_participate_cleanup (pool_hose ph, ob_retort pret)
       ph->ext = NULL;
     }
 
-  pool_fifo_multi_destroy_awaiter (ph);
   return pret;
 }
 
@@ -2986,12 +3940,22 @@ typedef struct
 static const option_info pool_opts[] = {
   {"auto-dispose", 'a', NEVER, RESIZABLE, POOL_FLAG_AUTO_DISPOSE},
   {"checksum", 'c', RESIZABLE, NEVER, POOL_FLAG_CHECKSUM},
+  {"checksum-algorithm", 0, RESIZABLE, NEVER, 0},
+  {"checksum-sample", 0, RESIZABLE, RESIZABLE, 0},
+  {"checksum-verify", 0, RESIZABLE, RESIZABLE, 0},
+  {"commit-batch", 0, RESIZABLE, RESIZABLE, 0},
+  {"commit-latency", 0, RESIZABLE, RESIZABLE, 0},
+  {"dense-index", 'd', RESIZABLE, NEVER, POOL_FLAG_DENSE_INDEX},
   {"flock", 'l', RESIZABLE, NEVER, POOL_FLAG_FLOCK},
   {"frozen", 'f', RESIZABLE, RESIZABLE, POOL_FLAG_FROZEN},
+  {"futex", 'x', RESIZABLE, NEVER, POOL_FLAG_FUTEX},
   {"group", 0, ALWAYS, NEVER, 0},
+  {"group-commit", 'g', RESIZABLE, NEVER, POOL_FLAG_GROUP_COMMIT},
+  {"incremental-resize", 'i', RESIZABLE, NEVER, POOL_FLAG_INCREMENTAL_RESIZE},
   {"index-capacity", 0, ALWAYS, NEVER, 0},
   {"mode", 0, ALWAYS, NEVER, 0},
   {"owner", 0, ALWAYS, NEVER, 0},
+  {"parallel-deposit", 'p', RESIZABLE, NEVER, POOL_FLAG_PARALLEL_DEPOSIT},
   {"resizable", 0, ALWAYS, NEVER, 0},
   {"single-file", 0, ALWAYS, NEVER, 0},
   {"size", 0, ALWAYS, RESIZABLE, 0},
@@ -3068,6 +4032,33 @@ static unt64 round_file_size (unt64 sz)
   return ((sz + psg) & ~psg);
 }
 
+/// How many proteins the dense index should hold, if the pool has
+/// one: what "dense-index" says, if it's a number, or else as many
+/// proteins as could possibly fit in the pool (if they were all
+/// empty).
+
+static unt64 dense_index_capacity (bprotein options, unt64 size,
+                                   unt64 toc_capacity, mmap_version_funcs f,
+                                   unt64 flags)
+{
+  if (0 == (flags & POOL_FLAG_DENSE_INDEX))
+    return 0;
+  bslaw opt = slaw_path_get_slaw (options, "dense-index");
+  int64 cap = 0;
+  if (slaw_is_numeric_int (opt) && slaw_to_int64 (opt, &cap) == OB_OK
+      && cap > 0)
+    return (unt64) cap;
+  const unt64 others = f.size_of_header (toc_capacity, 0, flags);
+  if (size <= others)
+    return 1;
+  // An empty protein takes up 16 bytes
+  unt64 smallest = POOL_MMAP_CHECKSUM_OFFSET + 16 + POOL_MMAP_JUMPBACK_LEN;
+  if (0 != (flags & POOL_FLAG_CHECKSUM))
+    smallest += sizeof (unt64);
+  // Each of which takes up a slot in the dense index, too
+  return 1 + (size - others) / (smallest + sizeof (int64));
+}
+
 ob_retort pool_mmap_create (pool_hose ph, const char *type, bprotein options)
 {
   unt64 size = mmap_pool_options_file_size (options);
@@ -3075,8 +4066,36 @@ ob_retort pool_mmap_create (pool_hose ph, const char *type, bprotein options)
   const unt8 pdv = ph->pool_directory_version;
   const unt8 mmv = pool_mmap_version_from_directory_version (pdv);
   const mmap_version_funcs f = pool_mmap_get_version_funcs (mmv);
+  // Only support flags for "new" pools.  Some of them need room in
+  // the header, so figure them out before anything else.
+  unt64 flags = (mmv > 0 ? flagify (options, POOL_DEFAULT_FLAGS) : 0);
+#ifndef __gnu_linux__
+  if (0 != (flags & POOL_FLAG_FUTEX))
+    {
+      OB_LOG_WARNING_CODE (0x20104056, "futex locks are only supported on "
+                                       "Linux; ignoring for pool '%s'\n",
+                           ph->name);
+      flags &= ~POOL_FLAG_FUTEX;
+    }
+#endif
+  if (0 != (flags & POOL_FLAG_CHECKSUM))
+    {
+      const char *algorithm =
+        slaw_path_get_string (options, "checksum-algorithm", "city");
+      if (0 == strcmp (algorithm, "crc32c"))
+        flags |= POOL_FLAG_CHECKSUM_CRC32C;
+      else if (0 != strcmp (algorithm, "city"))
+        OB_LOG_WARNING_CODE (0x2010405a, "unknown checksum-algorithm '%s'; "
+                                         "using 'city' for pool '%s'\n",
+                             algorithm, ph->name);
+    }
 
-  const unt64 header_size = f.size_of_header (toc_capacity);
+  // "dense-index" can be a number, as well as a boolean
+  if (mmv > 0 && slaw_path_get_int64 (options, "dense-index", 0) > 0)
+    flags |= POOL_FLAG_DENSE_INDEX;
+  const unt64 dense_cap = dense_index_capacity (options, size, toc_capacity,
+                                                f, flags);
+  const unt64 header_size = f.size_of_header (toc_capacity, dense_cap, flags);
   const unt64 min_size = header_size + POOL_MMAP_MIN_SIZE;
   const unt64 max_size = POOL_MMAP_MAX_SIZE;
 
@@ -3124,7 +4143,8 @@ ob_retort pool_mmap_create (pool_hose ph, const char *type, bprotein options)
       // We keep the header at the beginning of the file
       d->oldnew = (pool_mmap_oldnew *) d->mem;
 
-      f.initialize_header (SLAW_VERSION_CURRENT, d->mem, toc_capacity);
+      f.initialize_header (SLAW_VERSION_CURRENT, d->mem, toc_capacity,
+                           dense_cap, flags);
       /* Note for the confused, which includes my future self:
        * The following line is where d->conf_chunk gets set to point
        * to the mmap header for v1 files.  Before now, it was pointing
@@ -3134,16 +4154,22 @@ ob_retort pool_mmap_create (pool_hose ph, const char *type, bprotein options)
        * a bit convoluted, and I probably should have done it some
        * other way that's clearer, although I'm not sure what that is. */
       pret = f.read_header (d);
+      d->mapped_generation = get_resize_generation (d);
       if (header_size != get_header_size (d))
         OB_FATAL_BUG_CODE (0x20104037, "%" OB_FMT_64 "u != %" OB_FMT_64 "u\n",
                            header_size, get_header_size (d));
+#ifdef __gnu_linux__
+      if (d->lock_chunk && pret == OB_OK)
+        pret = pool_futex_init_locks (d->lock_chunk);
+#endif
+      set_commit_options (d, options);
+      set_checksum_options (d, options);
       d->conf_chunk->file_size = size;
       d->conf_chunk->sem_key = ph->sem_key;
-      // Only support flags for "new" pools,
-      // and don't allow auto-dispose, since it doesn't make sense here.
+      // Don't allow auto-dispose, since it doesn't make sense here.
       if (mmv > 0)
         {
-          d->conf_chunk->flags = flagify (options, POOL_DEFAULT_FLAGS);
+          d->conf_chunk->flags = flags;
           if (POOL_FLAG_AUTO_DISPOSE & d->conf_chunk->flags)
             {
               d->conf_chunk->flags &= ~POOL_FLAG_AUTO_DISPOSE;
@@ -3190,6 +4216,10 @@ static void set_lock_ops_from_flags (pool_hose ph, const pool_mmap_data *d)
     ph->lock_ops = &pool_sem_ops;
   else
     ph->lock_ops = &pool_flock_ops;
+#ifdef __gnu_linux__
+  if (0 != (flags & POOL_FLAG_FUTEX))
+    ph->lock_ops = &pool_futex_ops;
+#endif
 #endif
 }
 
@@ -3258,6 +4288,7 @@ ob_retort pool_mmap_participate (pool_hose ph)
   pret = f.read_header (d);
   if (pret < OB_OK)
     return pool_mmap_participate_cleanup (ph, pret);
+  d->mapped_generation = get_resize_generation (d);
 
   if (d->perm_chunk)
     {
@@ -3287,7 +4318,13 @@ ob_retort pool_mmap_participate (pool_hose ph)
   if (0
       != (OB_CONST_U64 (0xffffffff) & flags
           & ~(POOL_FLAG_STOP_WHEN_FULL | POOL_FLAG_FROZEN
-              | POOL_FLAG_AUTO_DISPOSE | POOL_FLAG_CHECKSUM | POOL_FLAG_FLOCK)))
+              | POOL_FLAG_AUTO_DISPOSE | POOL_FLAG_CHECKSUM | POOL_FLAG_FLOCK
+              | POOL_FLAG_PARALLEL_DEPOSIT | POOL_FLAG_CHECKSUM_CRC32C
+              | POOL_FLAG_DENSE_INDEX
+#ifdef __gnu_linux__
+              | POOL_FLAG_FUTEX
+#endif
+              )))
     {
       // If any of the 0-31 bits are set and we don't recognize them,
       // it's an error.  (It's okay for 32-63 to be unrecognized; we'll
@@ -3308,6 +4345,52 @@ ob_retort pool_mmap_participate (pool_hose ph)
       return pool_mmap_participate_cleanup (ph, POOL_WRONG_VERSION);
     }
 
+  if ((0 != (flags & POOL_FLAG_PARALLEL_DEPOSIT)) != (d->rsrv_chunk != NULL))
+    {
+      OB_LOG_ERROR_CODE (0x20104054, "For pool '%s',\n"
+                                     "parallel-deposit flag does not match "
+                                     "header\n",
+                         ph->name);
+      return pool_mmap_participate_cleanup (ph, POOL_CORRUPT);
+    }
+
+  if (d->rsrv_chunk
+      && d->rsrv_chunk->hdr.len * sizeof (unt64) < sizeof (pool_chunk_rsrv))
+    {
+      OB_LOG_ERROR_CODE (0x20104062, "For pool '%s',\n"
+                                     "reservation chunk is too small "
+                                     "(%" OB_FMT_64 "u octs)\n",
+                         ph->name, d->rsrv_chunk->hdr.len);
+      return pool_mmap_participate_cleanup (ph, POOL_CORRUPT);
+    }
+
+  if ((0 != (flags & POOL_FLAG_DENSE_INDEX)) != (d->dnse_chunk != NULL))
+    {
+      OB_LOG_ERROR_CODE (0x2010405c, "For pool '%s',\n"
+                                     "dense-index flag does not match "
+                                     "header\n",
+                         ph->name);
+      return pool_mmap_participate_cleanup (ph, POOL_CORRUPT);
+    }
+
+  if ((0 != (flags & POOL_FLAG_GROUP_COMMIT)) != (d->cmit_chunk != NULL))
+    {
+      OB_LOG_ERROR_CODE (0x20104059, "For pool '%s',\n"
+                                     "group-commit flag does not match "
+                                     "header\n",
+                         ph->name);
+      return pool_mmap_participate_cleanup (ph, POOL_CORRUPT);
+    }
+
+  if ((0 != (flags & POOL_FLAG_INCREMENTAL_RESIZE)) != (d->rsiz_chunk != NULL))
+    {
+      OB_LOG_ERROR_CODE (0x2010405d, "For pool '%s',\n"
+                                     "incremental-resize flag does not match "
+                                     "header\n",
+                         ph->name);
+      return pool_mmap_participate_cleanup (ph, POOL_CORRUPT);
+    }
+
   // This used to be in __pool_participate() in pool.c, but it had
   // to move here because we needed to "sandwich" it between reading
   // the sem key (so pool_open_semaphores could use it) and updating
@@ -3325,6 +4408,16 @@ ob_retort pool_mmap_participate (pool_hose ph)
   if (pret < OB_OK)
     return pool_mmap_participate_cleanup (ph, pret);
 
+#ifdef __gnu_linux__
+  // Pools with futex locks also do their await/awake with futexes
+  if (ph->futex_view)
+    {
+      ph->await_next_single = pool_futex_await_next_single;
+      ph->multi_add_awaiter = pool_futex_multi_add_awaiter;
+      ph->multi_remove_awaiter = pool_futex_multi_remove_awaiter;
+    }
+#endif
+
   return pret;
 }
 
@@ -3516,6 +4609,43 @@ ob_retort pool_mmap_info (pool_hose ph, int64 hops, protein *return_prot)
       return OB_NO_MEM;
     }
   ingests = slaw_maps_merge_f (ingests, flagslaw, NULL);
+  if (ingests && d->cmit_chunk)
+    ingests =
+      slaw_maps_merge_f (ingests,
+                         slaw_map_inline_cf ("commit-latency",
+                                             slaw_float64 (
+                                               d->cmit_chunk->latency_usec
+                                               / 1e6),
+                                             "commit-batch",
+                                             slaw_int64 (d->cmit_chunk->batch),
+                                             NULL),
+                         NULL);
+  if (ingests && d->dnse_chunk)
+    ingests =
+      slaw_maps_merge_f (ingests,
+                         slaw_map_inline_cf ("dense-index-capacity",
+                                             slaw_int64 (
+                                               d->dnse_chunk->capacity),
+                                             NULL),
+                         NULL);
+  if (ingests && 0 != (flags & POOL_FLAG_CHECKSUM))
+    {
+      const char *algorithm =
+        (0 != (flags & POOL_FLAG_CHECKSUM_CRC32C) ? "crc32c" : "city");
+      const int64 verify = (d->csum_chunk ? d->csum_chunk->verify : 0);
+      const int64 sample =
+        (d->csum_chunk ? d->csum_chunk->sample : POOL_VERIFY_SAMPLE_DEFAULT);
+      ingests =
+        slaw_maps_merge_f (ingests,
+                           slaw_map_inline_cf ("checksum-algorithm",
+                                               slaw_string (algorithm),
+                                               "checksum-verify",
+                                               slaw_string (
+                                                 verify_names[verify % 3]),
+                                               "checksum-sample",
+                                               slaw_int64 (sample), NULL),
+                           NULL);
+    }
   if (!ingests)
     return OB_NO_MEM;
   *return_prot = protein_from_ff (NULL, ingests);
@@ -3576,11 +4706,14 @@ static void print_how2 (how_to_resize_it how2)
 static void rebuild_toc (pool_mmap_data *d, unt64 oldest_entry,
                          unt64 newest_entry, ob_retort *errp)
 {
-  if (already_failed (errp) || !d->ptoc)
+  if (already_failed (errp) || (!d->ptoc && !d->dnse_chunk))
     return;
 
-  // clear the pool's table of contents, so we can start over
-  pool_toc_init ((byte *) d->ptoc, pool_toc_capacity (d->ptoc));
+  // clear the pool's table of contents (and dense index), so we can
+  // start over
+  if (d->ptoc)
+    pool_toc_init ((byte *) d->ptoc, pool_toc_capacity (d->ptoc));
+  clear_dense_index (d);
 
   if (newest_entry == 0)
     // This means the pool will be empty, so nothing more to do
@@ -3616,7 +4749,9 @@ static void rebuild_toc (pool_mmap_data *d, unt64 oldest_entry,
       pie.offset = entry;
       pie.stamp = *(const float64 *) (p + POOL_MMAP_TIMESTAMP_OFFSET);
       pie.idx = *(const unt64 *) (p + POOL_MMAP_INDEX_OFFSET);
-      pool_toc_append (d->ptoc, pie, oldest_entry);
+      if (d->ptoc)
+        pool_toc_append (d->ptoc, pie, oldest_entry);
+      note_dense_entry (d, pie.idx, entry);
       if (pie.idx + 1 == first_idx)
         entry = first_entry;
       else
@@ -3903,13 +5038,304 @@ static void resize_pool (pool_mmap_data *d, unt64 new_size, ob_retort *errp)
   do_resize_it (d, how2, errp);
 }
 
+// Pools with an rsiz chunk grow incrementally.  If the pool has
+// wrapped around, the wrapped part (from the oldest entry to the last
+// one in the file) gets copied to the end of the grown file,
+// POOL_RESIZE_STEP bytes at a time, last bytes first, with the
+// deposit lock dropped in between steps.  Meanwhile the depositors
+// keep eating into the front of it, which just leaves less to copy.
+// If there isn't room to copy it without copying over itself, it
+// stays where it is, and the depositors reach the new space once
+// they have made their way past it.  Either way, the proteins don't
+// change order, so switching over to the new size (which is the only
+// part done all at once) just renumbers their entries, and the table
+// of contents and dense index along with them.
+typedef struct
+{
+  unt64 old_size;
+  unt64 new_size;
+  int64 claim;
+  // The end of the wrapped segment, or 0 if the pool hasn't wrapped
+  unt64 seg2_end;
+  // How far the wrapped segment is moving, or 0 if it's staying put
+  unt64 shift;
+  // Everything from here to the end of the wrapped segment (as file
+  // offsets) has been copied
+  unt64 frontier;
+  // The grown file, mapped separately, since our own mapping has to
+  // stay the old size until we switch over
+  byte *stage;
+} growth_plan;
+
+static byte *map_for_growth (pool_mmap_data *d, unt64 size)
+{
+#ifdef _MSC_VER
+  // No staging map, so nothing gets copied
+  return NULL;
+#else
+  byte *mmem = (byte *) mmap ((caddr_t) 0, size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fileno (d->file), 0);
+  return (mmem == MAP_FAILED ? NULL : mmem);
+#endif
+}
+
+static void unmap_for_growth (growth_plan *gp)
+{
+#ifndef _MSC_VER
+  if (gp->stage)
+    OB_CHECK_POSIX_CODE (0x20104060, munmap (gp->stage, gp->new_size));
+#endif
+  gp->stage = NULL;
+}
+
+/// Figures out what the wrapped segment is now, and whether we can
+/// move it.
+
+static void plan_growth (pool_mmap_data *d, growth_plan *gp, bool may_move,
+                         ob_retort *errp)
+{
+  gp->seg2_end = gp->shift = gp->frontier = 0;
+  if (already_failed (errp) || is_pool_empty (d))
+    return;
+  const unt64 oldest = primitive_get_oldest_entry (d);
+  const unt64 first = get_first_entry (d, errp);
+  if (already_failed (errp) || first <= oldest)
+    return;
+  const unt64 last = get_last_valid_entry (d, first, errp);
+  const int64 size_last = entry_size_from_entry (d, last, errp);
+  if (already_failed (errp))
+    return;
+  const unt64 seg2_off = oldest % gp->old_size;
+  const unt64 seg2_len = last + size_last - oldest;
+  if (last < oldest || seg2_off + seg2_len > gp->old_size)
+    {
+      OB_LOG_ERROR_CODE (0x2010405e,
+                         "Corruption detected in '%s':\n"
+                         "oldest = %" OB_FMT_64 "u, last = %" OB_FMT_64 "u, "
+                         "file size = %" OB_FMT_64 "u\n",
+                         pname (d), oldest, last, gp->old_size);
+      *errp = POOL_CORRUPT;
+      return;
+    }
+  gp->seg2_end = oldest + seg2_len;
+  const unt64 dst = gp->new_size - seg2_len;
+  if (may_move && gp->stage && dst >= seg2_off + seg2_len)
+    {
+      gp->shift = dst - seg2_off;
+      gp->frontier = seg2_off + seg2_len;
+    }
+  OB_LOG_DEBUG_CODE (0x2010405f, "seg2_off = 0x%016" OB_FMT_64 "x\n"
+                                 "seg2_len = 0x%016" OB_FMT_64 "x\n"
+                                 "shift    = 0x%016" OB_FMT_64 "x\n",
+                     seg2_off, seg2_len, gp->shift);
+}
+
+/// Copies the next step's worth of the wrapped segment.  Returns true
+/// once there's nothing left to copy.
+
+static bool copy_growth_step (pool_mmap_data *d, growth_plan *gp)
+{
+  const unt64 oldest_off = primitive_get_oldest_entry (d) % gp->old_size;
+  if (gp->shift == 0 || gp->frontier <= oldest_off)
+    return true;
+  unt64 step = gp->frontier - oldest_off;
+  if (step > POOL_RESIZE_STEP)
+    step = POOL_RESIZE_STEP;
+  gp->frontier -= step;
+  memcpy (gp->stage + gp->frontier + gp->shift, d->mem + gp->frontier, step);
+  return (gp->frontier <= oldest_off);
+}
+
+typedef struct
+{
+  unt64 oldest;
+  unt64 newest;
+  unt64 seg2_end;
+  unt64 new_oldest;
+  unt64 new_newest;
+} renumbering;
+
+/// Where \a entry ends up after the switch, or POOL_TOC_UNKNOWN_OFFSET
+/// if it's no longer in the pool.
+
+static unt64 renumber_entry (unt64 entry, const void *arg)
+{
+  const renumbering *r = (const renumbering *) arg;
+  if (entry < r->oldest || entry > r->newest)
+    return POOL_TOC_UNKNOWN_OFFSET;
+  if (entry < r->seg2_end)
+    return r->new_oldest + (entry - r->oldest);
+  return r->new_newest - (r->newest - entry);
+}
+
+static void renumber_dense_index (pool_mmap_data *d, int64 oldest_index,
+                                  int64 newest_index, const renumbering *r)
+{
+  pool_chunk_dnse *dh = d->dnse_chunk;
+  if (!dh || dh->capacity <= 0)
+    return;
+  // Slots we don't visit can only hold entries from before the oldest
+  // one, which look stompled under the new numbering, too.  Readers in
+  // other processes don't take the pool lock, and keep reading the
+  // ring all through physically_resize(), so they may see any slot
+  // from before or after the switch.  That's all right, as long as
+  // each slot changes in one piece: find_dense_entry() checks whatever
+  // it reads with entry_to_index(), and anything that doesn't turn out
+  // to be the protein it wanted is just a miss.
+  int64 *ring = pool_dense_entries (dh);
+  int64 n = newest_index - oldest_index + 1;
+  if (n > dh->capacity)
+    n = dh->capacity;
+  int64 idx;
+  for (idx = newest_index - n + 1; idx <= newest_index; idx++)
+    {
+      int64 *slot = &ring[idx % dh->capacity];
+      const int64 was = ob_atomic_int64_ref (slot);
+      if (was == 0)
+        continue;
+      unt64 entry = renumber_entry ((unt64) was, r);
+      if (entry == POOL_TOC_UNKNOWN_OFFSET)
+        entry = 0;
+      ob_atomic_int64_set (slot, (int64) entry);
+    }
+}
+
+/// Switches the pool over to its new size, once everything has been
+/// copied.
+
+static void finish_growth (pool_mmap_data *d, const growth_plan *gp,
+                           ob_retort *errp)
+{
+  if (already_failed (errp))
+    return;
+
+  if (is_pool_empty (d))
+    {
+      const unt64 new_oldest = remodulate (primitive_get_oldest_entry (d),
+                                           get_header_size (d), gp->new_size);
+      primitive_set_oldest_entry (d, new_oldest);
+      physically_resize (d, gp->new_size, errp);
+      rebuild_toc (d, new_oldest, 0, errp);
+      return;
+    }
+
+  renumbering r;
+  r.oldest = primitive_get_oldest_entry (d);
+  r.newest = primitive_get_newest_entry (d);
+  r.seg2_end = gp->seg2_end;
+  r.new_oldest = remodulate (r.newest, r.oldest % gp->old_size + gp->shift,
+                             gp->new_size);
+  if (r.seg2_end == 0)
+    r.new_newest = r.new_oldest + (r.newest - r.oldest);
+  else
+    r.new_newest =
+      remodulate (r.new_oldest, r.newest % gp->old_size, gp->new_size);
+  const int64 oldest_index = entry_to_index (d, r.oldest, errp);
+  const int64 newest_index = entry_to_index (d, r.newest, errp);
+  if (already_failed (errp))
+    return;
+
+  // As in do_resize_it(), readers see a temporarily empty pool from
+  // the moment oldest moves until newest catches up with it.
+  primitive_set_oldest_entry (d, r.new_oldest);
+  physically_resize (d, gp->new_size, errp);
+  if (already_failed (errp))
+    return;
+  if (d->ptoc)
+    pool_toc_rebase (d->ptoc, renumber_entry, &r);
+  renumber_dense_index (d, oldest_index, newest_index, &r);
+  set_newest_entry (d, r.new_newest, errp);
+  check_oldest_newest_diff (d, errp);
+}
+
+/// Grows a pool with an rsiz chunk without holding the deposit lock
+/// for longer than a step at a time.  Gives up with POOL_IN_USE if
+/// some other resize comes along in the meantime.
+
+static ob_retort grow_incrementally (pool_hose ph, unt64 new_size)
+{
+  ob_retort tort = pool_deposit_lock (ph);
+  if (tort < OB_OK)
+    return tort;
+  pool_mmap_data *d = pool_mmap_get_data (ph);
+  drain_reservations (d);
+
+  growth_plan gp;
+  OB_CLEAR (gp);
+  gp.old_size = get_file_size (d);
+  gp.new_size = new_size;
+  if (new_size <= gp.old_size)
+    // Somebody else grew it first; do whatever's left the usual way
+    resize_pool (d, new_size, &tort);
+  else if (new_size > POOL_MMAP_MAX_SIZE)
+    tort = POOL_INVALID_SIZE;
+  else
+    {
+      gp.claim = ob_atomic_int64_add (&d->rsiz_chunk->claim, 1);
+      // Make room to copy into, without telling anyone about it yet
+      if (get_real_file_size (d, &tort) < new_size)
+        change_file_size (d, new_size, &tort);
+      if (!already_failed (&tort))
+        gp.stage = map_for_growth (d, new_size);
+      plan_growth (d, &gp, true, &tort);
+
+      int replans = 0;
+      bool locked = true;
+      while (!already_failed (&tort) && !copy_growth_step (d, &gp))
+        {
+          // Let the depositors have it for a bit
+          locked = false;
+          ob_err_accum (&tort, pool_deposit_unlock (ph));
+          if (already_failed (&tort))
+            break;
+          ob_micro_sleep (POOL_RESIZE_NAP);
+          tort = pool_deposit_lock (ph);
+          if (already_failed (&tort))
+            break;
+          locked = true;
+          drain_reservations (d);
+          if (get_file_size (d) != gp.old_size
+              || ob_atomic_int64_ref (&d->rsiz_chunk->claim) != gp.claim)
+            {
+              OB_LOG_INFO_CODE (0x20104061, "pool '%s' was resized by "
+                                            "someone else while growing "
+                                            "it to %" OB_FMT_64 "u\n",
+                                pname (d), new_size);
+              tort = POOL_IN_USE;
+            }
+          else if (is_pool_empty (d)
+                   || primitive_get_oldest_entry (d) >= gp.seg2_end)
+            // The depositors have been all the way through the wrapped
+            // segment (or it was emptied), so what's wrapped now is
+            // something else.  They could keep us doing this forever,
+            // so after a few tries, leave it where it is.
+            plan_growth (d, &gp, ++replans < 3, &tort);
+        }
+      unmap_for_growth (&gp);
+      if (!locked)
+        return tort;
+      finish_growth (d, &gp, &tort);
+    }
+
+  sync_reservations (d);
+  ob_err_accum (&tort, pool_deposit_unlock (ph));
+  return tort;
+}
+
 static ob_retort pool_mmap_resize (pool_hose ph, unt64 new_size)
 {
+  pool_mmap_data *d = pool_mmap_get_data (ph);
+  // Shrinking throws proteins away, and has to be done all at once.
+  if (d->rsiz_chunk && new_size > get_file_size (d))
+    return grow_incrementally (ph, new_size);
+
   ob_retort tort;
   tort = pool_deposit_lock (ph);
   if (tort < OB_OK)
     return tort;
-  resize_pool (pool_mmap_get_data (ph), new_size, &tort);
+  drain_reservations (d);
+  resize_pool (d, new_size, &tort);
+  sync_reservations (d);
   ob_err_accum (&tort, pool_deposit_unlock (ph));
   return tort;
 }
@@ -3937,9 +5363,18 @@ static ob_retort pool_mmap_change_options (pool_hose ph, bslaw options)
         {
           old_flags = get_flags (d);
           new_flags = flagify (options, old_flags);
+          // Parallel deposits, futex locks, group commit, the dense
+          // index and incremental resizes depend on header chunks that
+          // only exist if the pool was created that way.
+          const unt64 fixed = POOL_FLAG_PARALLEL_DEPOSIT | POOL_FLAG_FUTEX
+                              | POOL_FLAG_GROUP_COMMIT | POOL_FLAG_DENSE_INDEX
+                              | POOL_FLAG_INCREMENTAL_RESIZE;
+          new_flags = (new_flags & ~fixed) | (old_flags & fixed);
         }
       while (!ob_atomic_int64_compare_and_swap (&d->conf_chunk->flags,
                                                 old_flags, new_flags));
+      set_commit_options (d, options);
+      set_checksum_options (d, options);
     }
 
   return tort;
@@ -3959,7 +5394,10 @@ ob_retort pool_mmap_load_methods (pool_hose ph)
   ph->create = pool_mmap_create;
   ph->participate = pool_mmap_participate;
   ph->deposit = pool_mmap_deposit;
+  ph->deposit_batch = pool_mmap_deposit_batch;
   ph->nth_protein = pool_mmap_nth_protein;
+  ph->nth_view = pool_mmap_nth_view;
+  ph->view_check = pool_mmap_view_check;
   ph->newest_index = pool_mmap_newest_index;
   ph->oldest_index = pool_mmap_oldest_index;
   ph->index_lookup = pool_mmap_index_lookup;
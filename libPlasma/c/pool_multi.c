@@ -22,6 +22,7 @@
 
 #include "libPlasma/c/slaw.h"
 #include "libPlasma/c/slaw-string.h"
+#include "libPlasma/c/protein.h"
 #include "libPlasma/c/pool.h"
 #include "libPlasma/c/private/pool_impl.h"
 #include "libPlasma/c/private/pool_multi.h"
@@ -585,8 +586,17 @@ static ob_retort pool_multi_add_awaiter (pool_gang gang, pool_gang_member m,
   pool_hose ph = m->ph;
   ob_log (OBLV_DBUG, 0x20105008, "pool_multi_add_awaiter for pool %s\n",
           ph->name);
-  // Add this pool's notification fd to our fd set
-  pret = ph->multi_add_awaiter (ph, ret_prot, ret_ts, ret_index);
+  // Add this pool's notification fd to our fd set.  (If the hose has
+  // a filter the implementation isn't applying, we have to look at
+  // what it finds, even if our caller doesn't want it.)
+  protein p = NULL;
+  if (!ret_prot && ph->filter && !ph->filter_in_backend)
+    ret_prot = &p;
+  while ((pret = ph->multi_add_awaiter (ph, ret_prot, ret_ts, ret_index))
+           == OB_OK
+         && private_filter_rejects (ph, *ret_prot))
+    Free_Protein (*ret_prot);
+  protein_free (p);
   // Did we find a protein?
   if (pret == OB_OK)
     return OB_OK;
@@ -883,8 +893,12 @@ static ob_retort pool_opportunistic_next (pool_hose ph, protein *ret_prot,
                                           pool_timestamp *ret_ts,
                                           int64 *ret_index)
 {
-  return (ph->opportunistic_next ? ph->opportunistic_next
-                                 : pool_next) (ph, ret_prot, ret_ts, ret_index);
+  // opportunistic_next() knows nothing about filters the
+  // implementation isn't applying, but pool_next() does
+  const bool can_use = (!ph->filter || ph->filter_in_backend);
+  return (ph->opportunistic_next && can_use
+            ? ph->opportunistic_next
+            : pool_next) (ph, ret_prot, ret_ts, ret_index);
 }
 
 ob_retort pool_await_next_multi (pool_gang gang, pool_timestamp timeout,
@@ -21,6 +21,8 @@
 #include "libPlasma/c/private/pool_impl.h"
 #include "libPlasma/c/private/plasma-private.h"
 #include "libPlasma/c/private/plasma-util.h"
+#include "libPlasma/c/private/pool-tls.h"
+#include "libPlasma/c/private/pool_tcp.h"
 #include "libPlasma/c/protein.h"
 
 static const struct _slaw NIL_SINGLETON[1] = {{SLAW_NIL_ILK}};
@@ -41,11 +43,24 @@ static void set_outstanding (outstanding_await_t *dst,
   dst->idx = idx;
 }
 
+/// Throws away whatever pool_net_next() had read ahead.
+
+static void drop_read_ahead (pool_net_data *net)
+{
+  int64 i;
+  for (i = 0; i < net->ahead_count; i++)
+    Free_Protein (net->ahead[i].p);
+  net->ahead_first = net->ahead_count = 0;
+}
+
 void pool_net_free (pool_net_data *freeme)
 {
   if (freeme)
     {
       set_outstanding (&freeme->outstanding, OB_NO_AWAIT, 0, NULL);
+      free (freeme->pending);
+      drop_read_ahead (freeme);
+      free (freeme->ahead);
       free (freeme);
     }
 }
@@ -56,6 +71,24 @@ static bool is_nil_or_null (bslaw s)
   return (!s || slaw_is_nil (s));
 }
 
+/// What we ask the server to match when we're just reading forward:
+/// the hose's filter, if the server is applying it for us, or else
+/// anything at all.
+
+static bslaw hose_pattern (pool_hose ph)
+{
+  return (ph->filter && ph->filter_in_backend ? ph->filter : NIL_SINGLETON);
+}
+
+/// Older servers would take a protein filter for a descrip to search
+/// for, and never find it.
+
+static bool search_supported (pool_hose ph, bslaw search)
+{
+  return (!slaw_is_protein_filter (search)
+          || pool_net_supports_cmd (ph->net, POOL_CMD_FILTERS));
+}
+
 static bool outstanding_compatible (const outstanding_await_t *dst, int64 idx,
                                     bslaw pattern)
 {
@@ -127,7 +160,7 @@ static slaw make_err_slaw (ob_retort modern, unt32 net_version)
 ///
 /// @code
 /// 'i' - int64
-/// 'p' - protein (same thing as 'x')
+/// 'p' - protein (sent the same as 'x', but has to be a protein)
 /// 'r' - ob_retort (automatically converts for old protocols)
 /// 'R' - ob_retort (no conversion)
 /// 's' - string
@@ -306,6 +339,539 @@ static ob_retort pool_net_recv_protein_len (pool_net_data *net,
   return OB_OK;
 }
 
+/// From POOL_TCP_VERSION_WITH_BINARY_FRAMES on, requests and results
+/// aren't proteins any more, but "frames" (see pool-tcp-protocol.md),
+/// which can be put together, and taken apart, without building or
+/// copying any slawx.  A frame is two header words, the first with a
+/// magic number in its low 32 bits and the op number in its high 32,
+/// the second with the length of what follows, which is one
+/// descriptor word for each argument, (arg length << 8) | format
+/// character, followed by the argument itself padded out to a
+/// multiple of 8 bytes.  The header and descriptors (and the numeric
+/// arguments) are in the sender's byte order, and so are the slawx,
+/// which are always in the current slaw version.
+
+#define FRAME_MAGIC OB_CONST_U64 (0x504e4631)
+#define FRAME_MAX_ARGS 16
+#define FRAME_PAD(len) (((len) + 7) & ~OB_CONST_U64 (7))
+
+static const byte frame_zeros[8];
+
+static unt64 frame_descriptor (unt64 len, char tag)
+{
+  return (len << 8) | (unt64) (unt8) tag;
+}
+
+/// Adds a piece to the ones send_frame() will send, tacking it onto
+/// the last one when they're next to each other in memory.
+
+static void frame_piece (pool_net_iov *iov, int *n, const void *base,
+                         size_t len)
+{
+  if (len == 0)
+    return;
+  if (*n > 0 && (const byte *) iov[*n - 1].base + iov[*n - 1].len == base)
+    iov[*n - 1].len += len;
+  else
+    {
+      iov[*n].base = base;
+      iov[*n].len = len;
+      ++*n;
+    }
+}
+
+static ob_retort send_frame (pool_net_data *net, int op_num, const char *fmt,
+                             va_list vargs)
+{
+  // Two header words, then at most two words (a descriptor and maybe a
+  // number) for each argument, and at most three pieces each
+  unt64 words[2 + 2 * FRAME_MAX_ARGS];
+  pool_net_iov iov[1 + 3 * FRAME_MAX_ARGS];
+  int w = 2, n = 0, nargs = 0;
+  unt64 len = 0;
+  const char *p;
+
+  words[0] = ((unt64) (unt32) op_num << 32) | FRAME_MAGIC;
+  frame_piece (iov, &n, words, 2 * sizeof (unt64));
+  for (p = (fmt ? fmt : ""); *p != '\0'; p++)
+    {
+      const void *data = NULL;
+      unt64 dlen = 0;
+      char tag = *p;
+      float64 f;
+      if (++nargs > FRAME_MAX_ARGS)
+        OB_FATAL_BUG_CODE (0x20106020, "more than %d args in '%s'\n",
+                           FRAME_MAX_ARGS, fmt);
+      switch (*p)
+        {
+          case 'i':
+            words[w + 1] = (unt64) va_arg (vargs, int64);
+            break;
+          case 'r':
+            words[w + 1] = (unt64) ob_new_retort_to_old (va_arg (vargs,
+                                                                 ob_retort),
+                                                         net->net_version);
+            break;
+          case 'R':
+            tag = 'r';
+            words[w + 1] = (unt64) va_arg (vargs, ob_retort);
+            break;
+          case 't':
+            f = va_arg (vargs, float64);
+            memcpy (&words[w + 1], &f, sizeof (f));
+            break;
+          case 's':
+            data = va_arg (vargs, const char *);
+            if (data)
+              dlen = strlen ((const char *) data);
+            else
+              tag = 'n';
+            break;
+          case 'p':
+          case 'x':
+            data = va_arg (vargs, bslaw);
+            tag = 'x';
+            if (data)
+              dlen = slaw_len ((bslaw) data);
+            else
+              tag = 'n';
+            break;
+          default:
+            OB_FATAL_BUG_CODE (0x20106021, "unknown specifier character %c\n",
+                               *p);
+        }
+      if (tag == 'i' || tag == 'r' || tag == 't')
+        {
+          words[w] = frame_descriptor (sizeof (unt64), tag);
+          frame_piece (iov, &n, &words[w], 2 * sizeof (unt64));
+          w += 2;
+          len += 2 * sizeof (unt64);
+        }
+      else
+        {
+          // Strings and slawx go straight from where the caller has them
+          words[w] = frame_descriptor (dlen, tag);
+          frame_piece (iov, &n, &words[w], sizeof (unt64));
+          frame_piece (iov, &n, data, dlen);
+          frame_piece (iov, &n, frame_zeros, FRAME_PAD (dlen) - dlen);
+          w++;
+          len += sizeof (unt64) + FRAME_PAD (dlen);
+        }
+    }
+  words[1] = len;
+
+  if (net->send_iov)
+    return net->send_iov (net->connfd, iov, n, *net->wakeup_handle_loc);
+
+  int i;
+  for (i = 0; i < n; i++)
+    {
+      ob_retort pret = net->send_nbytes (net->connfd, iov[i].base, iov[i].len,
+                                         *net->wakeup_handle_loc);
+      if (pret == POOL_AWAIT_WOKEN && i > 0)
+        return POOL_AWAIT_WOKEN_DIRTY;
+      if (pret < OB_OK)
+        return pret;
+    }
+  return OB_OK;
+}
+
+/// Where unpack_frame() gets a frame's arguments from: either a frame
+/// that's already been received (as the rude data of a protein, by
+/// pool_net_recv_op()), when buf isn't NULL, or straight off net's
+/// connection, when it is.
+
+typedef struct frame_reader
+{
+  pool_net_data *net;
+  const byte *buf;
+  unt64 pos;
+  unt64 len;
+  bool swap;
+  bool broken;
+} frame_reader;
+
+static ob_retort frame_read (frame_reader *r, void *dst, unt64 n)
+{
+  if (n > r->len - r->pos)
+    return POOL_PROTOCOL_ERROR;
+  ob_retort pret = OB_OK;
+  if (r->buf)
+    memcpy (dst, r->buf + r->pos, n);
+  else if (n > 0)
+    {
+      pret = r->net->recv_nbytes (r->net->connfd, dst, n,
+                                  *r->net->wakeup_handle_loc);
+      // The header has been read already, so we're partway through
+      if (pret == POOL_AWAIT_WOKEN)
+        pret = POOL_AWAIT_WOKEN_DIRTY;
+      if (pret < OB_OK)
+        {
+          r->broken = true;
+          return pret;
+        }
+    }
+  r->pos += n;
+  return pret;
+}
+
+static ob_retort frame_skip (frame_reader *r, unt64 n)
+{
+  byte junk[512];
+  if (r->buf)
+    {
+      if (n > r->len - r->pos)
+        return POOL_PROTOCOL_ERROR;
+      r->pos += n;
+      return OB_OK;
+    }
+  while (n > 0)
+    {
+      const unt64 chunk = (n < sizeof (junk) ? n : sizeof (junk));
+      ob_retort pret = frame_read (r, junk, chunk);
+      if (pret < OB_OK)
+        return pret;
+      n -= chunk;
+    }
+  return OB_OK;
+}
+
+/// Reads a frame's header off the connection, and gets r ready to
+/// read the rest of it from there.
+
+static ob_retort frame_begin (pool_net_data *net, frame_reader *r, int *op_num)
+{
+  unt64 header[2];
+  if (net->slaw_version != SLAW_VERSION_CURRENT)
+    return POOL_WRONG_VERSION;
+  ob_retort pret = net->recv_nbytes (net->connfd, header, sizeof (header),
+                                     *net->wakeup_handle_loc);
+  if (pret != OB_OK)
+    return pret;
+  memset (r, 0, sizeof (*r));
+  r->net = net;
+  if ((header[0] & 0xffffffff) != FRAME_MAGIC)
+    {
+      header[0] = ob_swap64 (header[0]);
+      header[1] = ob_swap64 (header[1]);
+      r->swap = true;
+      if ((header[0] & 0xffffffff) != FRAME_MAGIC)
+        {
+          OB_LOG_ERROR_CODE (0x20106022, "bad frame magic 0x%" OB_FMT_64
+                                         "x\n",
+                             header[0]);
+          return POOL_PROTOCOL_ERROR;
+        }
+    }
+  r->len = header[1];
+  // Avoid DoS or bug due to unrealistic length
+  if (r->len > MAX_SLAW_SIZE || r->len % 8 != 0)
+    return POOL_PROTOCOL_ERROR;
+  *op_num = (int32) (header[0] >> 32);
+  return OB_OK;
+}
+
+/// Puts a slaw argument \a alen bytes long into our own byte order,
+/// and says whether it's all there and makes sense.
+
+static bool frame_slaw_ok (slaw s, unt64 alen, bool swap)
+{
+  if (alen < sizeof (unt64) || alen % 8 != 0)
+    return false;
+  const slaw stop = s + alen / 8;
+  const ob_retort err = (swap ? slaw_swap (s, stop) : slaw_check (s, stop));
+  return (err >= OB_OK && slaw_len (s) == (int64) alen);
+}
+
+/// Puts a received frame's payload into our own byte order, and checks
+/// that its arguments all fit and make sense, so that unpack_frame()
+/// can take them out of it without checking again.
+
+static ob_retort frame_normalize (byte *payload, unt64 len, bool swap)
+{
+  unt64 pos = 0;
+  while (pos < len)
+    {
+      unt64 *desc = (unt64 *) (payload + pos);
+      if (swap)
+        *desc = ob_swap64 (*desc);
+      const unt64 alen = *desc >> 8;
+      unt64 *arg = desc + 1;
+      pos += sizeof (unt64);
+      if (alen > len - pos || FRAME_PAD (alen) > len - pos)
+        return POOL_PROTOCOL_ERROR;
+      switch ((char) (*desc & 0xff))
+        {
+          case 'i':
+          case 'r':
+          case 't':
+            if (alen != sizeof (unt64))
+              return POOL_PROTOCOL_ERROR;
+            if (swap)
+              *arg = ob_swap64 (*arg);
+            break;
+          case 'x':
+            if (!frame_slaw_ok ((slaw) arg, alen, swap))
+              return POOL_PROTOCOL_ERROR;
+            break;
+          case 's':
+          case 'n':
+            break;
+          default:
+            return POOL_PROTOCOL_ERROR;
+        }
+      pos += FRAME_PAD (alen);
+    }
+  return OB_OK;
+}
+
+static ob_retort recv_frame (pool_net_data *net, int *op_num, protein *ret_prot)
+{
+  frame_reader r;
+  ob_retort pret = frame_begin (net, &r, op_num);
+  if (pret != OB_OK)
+    return pret;
+
+  // Keep the payload as the rude data of a protein, so whoever gets it
+  // can free it like any other
+  const unt64 olen = 2 + r.len / 8;
+  slaw s = slaw_alloc (olen);
+  if (!s)
+    return OB_NO_MEM;
+  s[0].o = SLAW_PROTEIN_ILK | (olen & 0xf) | ((olen & ~0xf) << 4);
+  s[1].o = (r.len > 0 ? SLAW_PROTEIN_VERY_RUDE_FLAG | r.len : 0);
+  pret = frame_read (&r, s + 2, r.len);
+  if (pret >= OB_OK)
+    pret = frame_normalize ((byte *) (s + 2), r.len, r.swap);
+  if (pret < OB_OK)
+    {
+      protein_free (s);
+      return pret;
+    }
+  *ret_prot = s;
+  ob_log (OBLV_DBUG, 0x20106023, "%s: op %d\n", __FUNCTION__, *op_num);
+  return OB_OK;
+}
+
+/// Does what _pool_net_unpack_op() does, for a frame.  Whatever's left
+/// of the frame after the arguments fmt asks for is skipped, so that
+/// the next one can be read.
+
+static ob_retort unpack_frame (frame_reader *r, unt32 net_vers,
+                               const char *fmt, va_list vargs)
+{
+  ob_retort pret = OB_OK;
+  int i = 0;
+  const char *p;
+  for (p = fmt; *p != '\0' && pret >= OB_OK; p++, i++)
+    {
+      // Arguments that aren't there at all look like NULLs
+      unt64 desc = frame_descriptor (0, 'n');
+      if (r->pos < r->len)
+        {
+          pret = frame_read (r, &desc, sizeof (desc));
+          if (pret < OB_OK)
+            break;
+          if (r->swap)
+            desc = ob_swap64 (desc);
+        }
+      const char tag = (char) (desc & 0xff);
+      const unt64 alen = desc >> 8;
+      const unt64 pad = FRAME_PAD (alen) - alen;
+      if (alen > r->len - r->pos || FRAME_PAD (alen) > r->len - r->pos)
+        {
+          pret = POOL_PROTOCOL_ERROR;
+          break;
+        }
+      // Where a 'p' argument went, so we can check it's a protein
+      slaw *got = NULL;
+      unt64 word = 0;
+      if ((tag == 'i' || tag == 'r' || tag == 't') && alen == sizeof (word))
+        {
+          pret = frame_read (r, &word, sizeof (word));
+          if (pret < OB_OK)
+            break;
+          if (r->swap)
+            word = ob_swap64 (word);
+        }
+      else if (*p != 's' && *p != 'x' && *p != 'p' && *p != 'b')
+        pret = frame_skip (r, alen + pad);
+      if (pret < OB_OK)
+        break;
+
+      switch (*p)
+        {
+          case 'i':
+            if (tag == 'i' && alen == sizeof (word))
+              *va_arg (vargs, int64 *) = (int64) word;
+            else
+              {
+                OB_LOG_ERROR_CODE (0x20106024, "argument %d was '%c', not an "
+                                               "int64\n",
+                                   i, tag);
+                pret = POOL_PROTOCOL_ERROR;
+              }
+            break;
+          case 'r':
+            if (tag == 'r' && alen == sizeof (word))
+              *va_arg (vargs, ob_retort *) =
+                ob_old_retort_to_new ((ob_retort) word, net_vers);
+            else
+              *va_arg (vargs, ob_retort *) = OB_UNKNOWN_ERR;
+            break;
+          case 't':
+            if (tag == 't' && alen == sizeof (word))
+              memcpy (va_arg (vargs, float64 *), &word, sizeof (word));
+            else
+              {
+                OB_LOG_ERROR_CODE (0x20106025, "argument %d was '%c', not a "
+                                               "float64\n",
+                                   i, tag);
+                pret = POOL_PROTOCOL_ERROR;
+              }
+            break;
+          case 's':
+            {
+              char **string = va_arg (vargs, char **);
+              if (tag != 's')
+                {
+                  OB_LOG_ERROR_CODE (0x20106026, "argument %d was '%c', not "
+                                                 "a string\n",
+                                     i, tag);
+                  pret = POOL_PROTOCOL_ERROR;
+                  break;
+                }
+              *string = (char *) malloc (alen + 1);
+              if (!*string)
+                {
+                  pret = OB_NO_MEM;
+                  break;
+                }
+              pret = frame_read (r, *string, alen);
+              (*string)[alen] = 0;
+              if (pret >= OB_OK)
+                pret = frame_skip (r, pad);
+              if (pret < OB_OK)
+                {
+                  free (*string);
+                  *string = NULL;
+                }
+            }
+            break;
+          case 'p':
+          case 'x':
+            {
+              slaw *slaw_slaw = va_arg (vargs, slaw *);
+              if (slaw_slaw)
+                *slaw_slaw = NULL;
+              if (*p == 'p')
+                got = slaw_slaw;
+              if ((tag == 'i' || tag == 'r' || tag == 't')
+                  && alen == sizeof (word))
+                {
+                  // Any argument can be taken as a slaw, as it could
+                  // when they were all slawx
+                  if (slaw_slaw)
+                    {
+                      float64 f;
+                      memcpy (&f, &word, sizeof (f));
+                      *slaw_slaw = (tag == 't' ? slaw_float64 (f)
+                                               : slaw_int64 ((int64) word));
+                      if (!*slaw_slaw)
+                        pret = OB_NO_MEM;
+                    }
+                  break;
+                }
+              if (tag != 'x' && tag != 's' && tag != 'n')
+                {
+                  OB_LOG_ERROR_CODE (0x20106029, "argument %d was '%c', not "
+                                                 "a slaw\n",
+                                     i, tag);
+                  pret = POOL_PROTOCOL_ERROR;
+                  break;
+                }
+              if (!slaw_slaw || tag == 'n')
+                {
+                  pret = frame_skip (r, alen + pad);
+                  break;
+                }
+              if (tag == 's')
+                {
+                  char *str = (char *) malloc (alen + 1);
+                  if (!str)
+                    {
+                      pret = OB_NO_MEM;
+                      break;
+                    }
+                  pret = frame_read (r, str, alen);
+                  str[alen] = 0;
+                  if (pret >= OB_OK)
+                    pret = frame_skip (r, pad);
+                  if (pret >= OB_OK && !(*slaw_slaw = slaw_string (str)))
+                    pret = OB_NO_MEM;
+                  free (str);
+                  break;
+                }
+              // Straight from the connection into its own slaw, when
+              // we're reading from there
+              slaw s = (slaw) malloc (alen);
+              if (!s)
+                {
+                  pret = OB_NO_MEM;
+                  break;
+                }
+              pret = frame_read (r, s, alen);
+              if (pret >= OB_OK && !r->buf
+                  && !frame_slaw_ok (s, alen, r->swap))
+                pret = POOL_PROTOCOL_ERROR;
+              if (pret < OB_OK)
+                free (s);
+              else
+                *slaw_slaw = s;
+            }
+            break;
+          case 'b':
+            if (!r->buf)
+              OB_FATAL_BUG_CODE (0x20106027, "can't borrow from a connection\n");
+            {
+              bslaw *borrowed = va_arg (vargs, bslaw *);
+              *borrowed = NULL;
+              if (tag == 'x')
+                *borrowed = (bslaw) (r->buf + r->pos);
+              else if (tag != 'n')
+                {
+                  OB_LOG_ERROR_CODE (0x2010602a, "argument %d was '%c', not "
+                                                 "a slaw\n",
+                                     i, tag);
+                  pret = POOL_PROTOCOL_ERROR;
+                  break;
+                }
+              pret = frame_skip (r, alen + pad);
+            }
+            break;
+          default:
+            OB_FATAL_BUG_CODE (0x20106028, "unknown specifier character %c\n",
+                               *p);
+        }
+
+      if (pret >= OB_OK && got && *got && !slaw_is_protein (*got))
+        {
+          OB_LOG_ERROR_CODE (0x2010602b, "argument %d is not a protein\n", i);
+          slaw_free (*got);
+          *got = NULL;
+          pret = POOL_PROTOCOL_ERROR;
+        }
+    }
+
+  if (!r->broken)
+    {
+      ob_retort tort = frame_skip (r, r->len - r->pos);
+      if (tort < OB_OK && pret >= OB_OK)
+        pret = tort;
+    }
+  return pret;
+}
+
 static ob_retort _pool_net_send_op (pool_net_data *net, int op_num,
                                     const char *fmt, va_list vargs)
 {
@@ -313,6 +879,8 @@ static ob_retort _pool_net_send_op (pool_net_data *net, int op_num,
   protein op_prot;
   ob_log (OBLV_DBUG, 0x20106001, "%s: op %d fmt %s\n", __FUNCTION__, op_num,
           fmt ? fmt : "NULL");
+  if (net->net_version >= POOL_TCP_VERSION_WITH_BINARY_FRAMES)
+    return send_frame (net, op_num, fmt, vargs);
   pret = _pool_net_pack_op (op_num, &op_prot, net->net_version, fmt, vargs);
   if (pret != OB_OK)
     return pret;
@@ -353,6 +921,8 @@ ob_retort pool_net_send_op (pool_net_data *net, int op_num, const char *fmt,
 ob_retort pool_net_recv_op (pool_net_data *net, int *op_num, protein *ret_prot)
 {
   ob_retort pret;
+  if (net->net_version >= POOL_TCP_VERSION_WITH_BINARY_FRAMES)
+    return recv_frame (net, op_num, ret_prot);
   // First pull out the length of the following protein
   unt64 len, remaining_len, header_len;
   slaw_oct header = 0;
@@ -406,9 +976,64 @@ ob_retort pool_net_recv_op (pool_net_data *net, int *op_num, protein *ret_prot)
   return pret;
 }
 
+ob_retort pool_net_op_len (const pool_net_data *net, const void *buf,
+                           size_t have, unt64 *len)
+{
+  unt64 header[2];
+  *len = 0;
+  if (net->net_version >= POOL_TCP_VERSION_WITH_BINARY_FRAMES)
+    {
+      if (net->slaw_version != SLAW_VERSION_CURRENT)
+        return POOL_WRONG_VERSION;
+      if (have < sizeof (header))
+        return OB_OK;
+      memcpy (header, buf, sizeof (header));
+      if ((header[0] & 0xffffffff) != FRAME_MAGIC)
+        {
+          if ((ob_swap64 (header[0]) & 0xffffffff) != FRAME_MAGIC)
+            return POOL_PROTOCOL_ERROR;
+          header[1] = ob_swap64 (header[1]);
+        }
+      if (header[1] > MAX_SLAW_SIZE || header[1] % 8 != 0)
+        return POOL_PROTOCOL_ERROR;
+      *len = sizeof (header) + header[1];
+      return OB_OK;
+    }
+
+  // As pool_net_recv_protein_len() sees it
+  if (have < sizeof (header[0]))
+    return OB_OK;
+  memcpy (header, buf, sizeof (header[0]));
+  if (net->net_version != 0)
+    {
+      if (net->slaw_version != SLAW_VERSION_CURRENT)
+        return POOL_WRONG_VERSION;
+      const unt64 plen = protein_len ((protein) header);
+      if (plen < sizeof (header[0]) || plen > MAX_SLAW_SIZE)
+        return POOL_PROTOCOL_ERROR;
+      *len = plen;
+      return OB_OK;
+    }
+  const unt64 plen = (I_AM_LITTLE_ENDIAN ? ob_swap64 (header[0]) : header[0]);
+  if (plen > MAX_SLAW_SIZE)
+    return POOL_PROTOCOL_ERROR;
+  *len = sizeof (header[0]) + plen;
+  return OB_OK;
+}
+
 static ob_retort _pool_net_unpack_op (bprotein op_prot, unt32 net_vers,
                                       const char *fmt, va_list vargs)
 {
+  if (net_vers >= POOL_TCP_VERSION_WITH_BINARY_FRAMES)
+    {
+      frame_reader r;
+      int64 len = 0;
+      memset (&r, 0, sizeof (r));
+      r.buf = (const byte *) protein_rude (op_prot, &len);
+      r.len = (r.buf ? len : 0);
+      return unpack_frame (&r, net_vers, fmt, vargs);
+    }
+
   bslaw list = slaw_map_find_c (protein_ingests (op_prot), ARGS_KEY);
   bslaw arg_slaw;
   slaw *slaw_slaw;
@@ -507,6 +1132,13 @@ static ob_retort _pool_net_unpack_op (bprotein op_prot, unt32 net_vers,
               {
                 *slaw_slaw = NULL;
               }
+            else if (*p == 'p' && !slaw_is_protein (arg_slaw))
+              {
+                OB_LOG_ERROR_CODE (0x2010602c, "argument %d is not a "
+                                               "protein\n",
+                                   i - 1);
+                return POOL_PROTOCOL_ERROR;
+              }
             else
               {
                 *slaw_slaw = slaw_dup (arg_slaw);
@@ -514,6 +1146,11 @@ static ob_retort _pool_net_unpack_op (bprotein op_prot, unt32 net_vers,
                   return OB_NO_MEM;
               }
             break;
+          case 'b':
+            arg_slaw = slaw_list_emit_nth (list, i++);
+            *va_arg (vargs, bslaw *) =
+              (slaw_is_nil (arg_slaw) ? NULL : arg_slaw);
+            break;
           default:
             // Since this indicates an internal programming error within libPlasma,
             // I think it makes more sense to abort than to return an error code.
@@ -580,6 +1217,25 @@ static ob_retort pool_net_recv_result_internal (pool_net_data *net,
   // fix https://lists.oblong.com/pipermail/buildtools/2012-December/000638.html
   OB_INVALIDATE (op_num);
 
+  if (net->net_version >= POOL_TCP_VERSION_WITH_BINARY_FRAMES)
+    {
+      // Unpack straight off the connection, so that slawx end up in
+      // their own memory without being copied out of the frame
+      frame_reader r;
+      for (;;)
+        {
+          pret = frame_begin (net, &r, &op_num);
+          if (pret < OB_OK)
+            return pret;
+          if (!unawait_old (&net->outstanding) && op_num == op_expected)
+            break;
+          pret = frame_skip (&r, r.len);
+          if (pret < OB_OK)
+            return pret;
+        }
+      return unpack_frame (&r, net->net_version, fmt, vargs);
+    }
+
   do
     {
       Free_Protein (results);
@@ -622,12 +1278,68 @@ ob_retort pool_net_recv_unusual_result (pool_net_data *net, int op_expected,
   return pret;
 }
 
+struct pool_net_pending_deposit
+{
+  pool_deposit_callback cb;
+  void *cookie;
+};
+
+/// Reads the results of outstanding async deposits, oldest first,
+/// until no more than \a keep are left.  If that fails, or the
+/// connection is already in no state to read them, the rest are all
+/// told so, and given up on.
+
+static ob_retort finish_deposits (pool_hose ph, int32 keep)
+{
+  pool_net_data *net = ph->net;
+  ob_retort pret = OB_OK;
+  // The server calls pool_net_clear_dirty() on its local hoses, too
+  if (!net)
+    return pret;
+  while (net->pending_count > (pret == OB_OK ? keep : 0))
+    {
+      const struct pool_net_pending_deposit pd =
+        net->pending[net->pending_first];
+      net->pending_first = (net->pending_first + 1) % POOL_DEPOSIT_WINDOW;
+      net->pending_count--;
+
+      ob_retort remote_pret = OB_OK;
+      int64 idx = -1;
+      pool_timestamp ts = OB_NAN;
+      if (pret == OB_OK && ph->dirty)
+        pret = POOL_AWAIT_WOKEN;
+      if (pret == OB_OK)
+        {
+          slaw optional_timestamp = NULL;
+          pret = pool_net_recv_result (net, "irx", &idx, &remote_pret,
+                                       &optional_timestamp);
+          if (pret == POOL_AWAIT_WOKEN || pret == POOL_AWAIT_WOKEN_DIRTY)
+            {
+              pret = POOL_AWAIT_WOKEN;
+              ph->dirty = 1;
+            }
+          const float64 *ts_ptr = slaw_float64_emit (optional_timestamp);
+          if (ts_ptr)
+            ts = *ts_ptr;
+          slaw_free (optional_timestamp);
+        }
+      if (pd.cb)
+        pd.cb (ph, (pret != OB_OK ? pret : remote_pret), idx, ts, pd.cookie);
+    }
+  return pret;
+}
+
 ob_retort pool_net_clear_dirty (pool_hose ph)
 {
   ob_retort pret;
 
   pool_validate_context (ph->ctx, "pool_net_clear_dirty");
 
+  // Anything else we send would have its result read as the result
+  // of an async deposit, so those have to be finished first.
+  if ((pret = finish_deposits (ph, 0)) != OB_OK && !ph->dirty)
+    return pret;
+
   if (!ph->dirty)
     return OB_OK;
 
@@ -638,6 +1350,7 @@ ob_retort pool_net_clear_dirty (pool_hose ph)
     return pret;
 
   ph->dirty = 0;
+  drop_read_ahead (ph->net);
 
   pret = ph->participate (ph);
   if (pret != OB_OK)
@@ -764,6 +1477,125 @@ ob_retort pool_net_deposit (pool_hose ph, bprotein p, int64 *idx,
   return remote_pret;
 }
 
+ob_retort pool_net_deposit_batch (pool_hose ph, const bprotein *ps, int64 n,
+                                  int64 *idx_out, pool_timestamp *ts_out)
+{
+  ob_retort pret, remote_pret;
+  int64 i;
+
+  if (!pool_net_supports_cmd (ph->net, POOL_CMD_DEPOSIT_BATCH))
+    {
+      pret = OB_OK;
+      for (i = 0; i < n; i++)
+        {
+          if (pret == OB_OK)
+            pret = pool_net_deposit (ph, ps[i], &idx_out[i], &ts_out[i]);
+          if (pret != OB_OK)
+            idx_out[i] = pret;
+        }
+      return pret;
+    }
+
+  if ((pret = pool_net_clear_dirty (ph)) != OB_OK)
+    return pret;
+
+  slabu *sb = slabu_new ();
+  if (!sb)
+    return OB_NO_MEM;
+  for (i = 0; i < n; i++)
+    if (slabu_list_add_z (sb, ps[i]) < 0)
+      {
+        slabu_free (sb);
+        return OB_NO_MEM;
+      }
+  slaw batch = slaw_list_f (sb);
+  if (!batch)
+    return OB_NO_MEM;
+
+  pret = pool_net_send_op (ph->net, POOL_CMD_DEPOSIT_BATCH, "x", batch);
+  slaw_free (batch);
+  if (pret == POOL_AWAIT_WOKEN_DIRTY)
+    {
+      pret = POOL_AWAIT_WOKEN;
+      ph->dirty = 1;
+    }
+  if (pret != OB_OK)
+    return pret;
+
+  slaw indexes = NULL, stamps = NULL;
+  pret = pool_net_recv_result (ph->net, "rxx", &remote_pret, &indexes,
+                               &stamps);
+  if (pret == POOL_AWAIT_WOKEN || pret == POOL_AWAIT_WOKEN_DIRTY)
+    {
+      pret = POOL_AWAIT_WOKEN;
+      ph->dirty = 1;
+    }
+  if (pret == OB_OK)
+    {
+      const int64 *ix = slaw_int64_array_emit (indexes);
+      const float64 *tx = slaw_float64_array_emit (stamps);
+      if (!ix || !tx || slaw_numeric_array_count (indexes) != n
+          || slaw_numeric_array_count (stamps) != n)
+        {
+          // The server only leaves them out if it couldn't even try
+          pret = (remote_pret < OB_OK ? remote_pret : POOL_PROTOCOL_ERROR);
+          for (i = 0; i < n; i++)
+            idx_out[i] = pret;
+        }
+      else
+        {
+          memcpy (idx_out, ix, n * sizeof (int64));
+          memcpy (ts_out, tx, n * sizeof (float64));
+          pret = remote_pret;
+        }
+    }
+  slaw_free (indexes);
+  slaw_free (stamps);
+  return pret;
+}
+
+ob_retort pool_net_deposit_async (pool_hose ph, bprotein p,
+                                  pool_deposit_callback cb, void *cookie)
+{
+  pool_net_data *net = ph->net;
+  ob_retort pret;
+  if (!net->pending)
+    {
+      net->pending = (struct pool_net_pending_deposit *)
+        calloc (POOL_DEPOSIT_WINDOW, sizeof (*net->pending));
+      if (!net->pending)
+        return OB_NO_MEM;
+    }
+  // Make room in the window.  (pool_net_clear_dirty() would finish
+  // them all, so only call it if there's something to clear.)
+  if ((pret = finish_deposits (ph, POOL_DEPOSIT_WINDOW - 1)) != OB_OK
+      && !ph->dirty)
+    return pret;
+  if (ph->dirty && (pret = pool_net_clear_dirty (ph)) != OB_OK)
+    return pret;
+
+  pret = pool_net_send_op (net, POOL_CMD_DEPOSIT, "p", p);
+  if (pret == POOL_AWAIT_WOKEN_DIRTY)
+    {
+      pret = POOL_AWAIT_WOKEN;
+      ph->dirty = 1;
+    }
+  if (pret != OB_OK)
+    return pret;
+
+  const int32 slot =
+    (net->pending_first + net->pending_count) % POOL_DEPOSIT_WINDOW;
+  net->pending[slot].cb = cb;
+  net->pending[slot].cookie = cookie;
+  net->pending_count++;
+  return OB_OK;
+}
+
+ob_retort pool_net_deposit_flush (pool_hose ph)
+{
+  return finish_deposits (ph, 0);
+}
+
 ob_retort pool_net_nth_protein (pool_hose ph, int64 idx, protein *ret_prot,
                                 pool_timestamp *ret_ts)
 {
@@ -853,7 +1685,10 @@ static ob_retort pool_net_got_response (pool_hose ph, bool *gotit)
 {
   ob_select2_t sel2;
 
-  *gotit = false;
+  // What TLS has already decrypted doesn't make the socket readable
+  *gotit = ob_tls_pending (ph->net->connfd);
+  if (*gotit)
+    return OB_OK;
 
   ob_retort tort = ob_select2_prepare (&sel2, OB_SEL2_RECEIVE, ph->net->connfd,
                                        OB_NULL_HANDLE);
@@ -1060,18 +1895,168 @@ static ob_retort pool_net_next_internal (pool_hose ph, protein *ret_prot,
   return pret;
 }
 
+/// Hands out the protein pool_next() would find at the hose's index,
+/// if we've already read it ahead, and forgets about any before it.
+/// Otherwise, returns POOL_NO_SUCH_PROTEIN.
+
+static ob_retort next_from_read_ahead (pool_hose ph, protein *ret_prot,
+                                       pool_timestamp *ret_ts,
+                                       int64 *ret_index)
+{
+  pool_net_data *net = ph->net;
+  const int64 squished = (ph->index < 0 ? 0 : ph->index);
+  if (net->ahead_first >= net->ahead_count || squished < net->ahead_from
+      || squished > net->ahead[net->ahead_count - 1].idx
+      || !is_nil_or_null (hose_pattern (ph)))
+    return POOL_NO_SUCH_PROTEIN;
+
+  // Any index between ahead_from and the first protein we got had
+  // been discarded, so pool_next() would skip over it, too.
+  for (; net->ahead[net->ahead_first].idx < squished; net->ahead_first++)
+    Free_Protein (net->ahead[net->ahead_first].p);
+
+  pool_fetch_op *op = &net->ahead[net->ahead_first++];
+  net->ahead_from = op->idx + 1;
+  if (ret_prot)
+    *ret_prot = op->p;
+  else
+    protein_free (op->p);
+  op->p = NULL;
+  if (ret_ts)
+    *ret_ts = op->ts;
+  if (ret_index)
+    *ret_index = op->idx;
+  return pool_seekto (ph, op->idx + 1);
+}
+
+/// Fetches the proteins from the hose's index on, as many as
+/// pool_hose_set_read_ahead() allows, and hands out the first of
+/// them.  Returns POOL_UNSUPPORTED_OPERATION if pool_net_next()
+/// should just ask for the one protein in the usual way.
+
+static ob_retort next_with_read_ahead (pool_hose ph, protein *ret_prot,
+                                       pool_timestamp *ret_ts,
+                                       int64 *ret_index)
+{
+  pool_net_data *net = ph->net;
+  if (ph->read_ahead_proteins <= 0 || !is_nil_or_null (hose_pattern (ph))
+      || !pool_net_supports_cmd (net, POOL_CMD_SUB_FETCH))
+    return POOL_UNSUPPORTED_OPERATION;
+
+  drop_read_ahead (net);
+  if (net->ahead_cap != ph->read_ahead_proteins)
+    {
+      pool_fetch_op *ahead = (pool_fetch_op *)
+        realloc (net->ahead, ph->read_ahead_proteins * sizeof (*ahead));
+      if (!ahead)
+        return OB_NO_MEM;
+      net->ahead = ahead;
+      net->ahead_cap = ph->read_ahead_proteins;
+    }
+
+  // Until we've seen how big the proteins are, one at a time will
+  // have to do for a byte limit.
+  int64 n = net->ahead_cap;
+  if (ph->read_ahead_bytes > 0)
+    {
+      const int64 fit = (net->ahead_avg_bytes > 0
+                           ? ph->read_ahead_bytes / net->ahead_avg_bytes
+                           : 1);
+      n = (fit < 1 ? 1 : (fit < n ? fit : n));
+    }
+
+  const int64 squished = (ph->index < 0 ? 0 : ph->index);
+  int64 i;
+  for (i = 0; i < n; i++)
+    {
+      pool_fetch_op *op = &net->ahead[i];
+      OB_CLEAR (*op);
+      op->idx = squished + i;
+      op->want_descrips = op->want_ingests = true;
+      op->rude_offset = 0;
+      op->rude_length = -1;
+    }
+  net->ahead_count = n;
+  net->ahead_from = squished;
+
+  int64 oldest = -1, newest = -1;
+  ob_retort pret = pool_net_fetch (ph, net->ahead, n, &oldest, &newest, false);
+  if (pret == POOL_AWAIT_WOKEN || pret == POOL_AWAIT_WOKEN_DIRTY)
+    {
+      pret = POOL_AWAIT_WOKEN;
+      ph->dirty = 1;
+    }
+  if (pret < OB_OK)
+    {
+      drop_read_ahead (net);
+      return pret;
+    }
+
+  // Keep the first run of proteins we got; since only the oldest
+  // proteins get discarded, anything missing before it is gone, and
+  // anything missing after it hasn't been deposited yet.
+  int64 first = 0, end;
+  while (first < n && net->ahead[first].tort == POOL_NO_SUCH_PROTEIN)
+    first++;
+  for (end = first; end < n && net->ahead[end].tort >= OB_OK; end++)
+    net->ahead_avg_bytes =
+      (net->ahead_avg_bytes > 0
+         ? (3 * net->ahead_avg_bytes + net->ahead[end].total_bytes) / 4
+         : net->ahead[end].total_bytes);
+  for (i = end; i < n; i++)
+    Free_Protein (net->ahead[i].p);
+  net->ahead_first = first;
+  net->ahead_count = end;
+
+  if (first < end)
+    return next_from_read_ahead (ph, ret_prot, ret_ts, ret_index);
+  drop_read_ahead (net);
+  // Nothing there yet, and we can say so without asking again.
+  // (Anything else, like a protein deposited while we were fetching,
+  // is left to the usual way.)
+  if (newest < squished)
+    return POOL_NO_SUCH_PROTEIN;
+  return POOL_UNSUPPORTED_OPERATION;
+}
+
 ob_retort pool_net_next (pool_hose ph, protein *ret_prot,
                          pool_timestamp *ret_ts, int64 *ret_index)
 {
+  ob_retort pret = next_from_read_ahead (ph, ret_prot, ret_ts, ret_index);
+  if (pret != POOL_NO_SUCH_PROTEIN)
+    return pret;
+  if ((pret = pool_net_clear_dirty (ph)) != OB_OK)
+    return pret;
+  pret = next_with_read_ahead (ph, ret_prot, ret_ts, ret_index);
+  if (pret != POOL_UNSUPPORTED_OPERATION)
+    return pret;
   return pool_net_next_internal (ph, ret_prot, ret_ts, ret_index, false,
-                                 NIL_SINGLETON);
+                                 hose_pattern (ph));
 }
 
 ob_retort pool_net_opportunistic_next (pool_hose ph, protein *ret_prot,
                                        pool_timestamp *ret_ts, int64 *ret_index)
 {
+  ob_retort pret = next_from_read_ahead (ph, ret_prot, ret_ts, ret_index);
+  if (pret != POOL_NO_SUCH_PROTEIN)
+    return pret;
   return pool_net_next_internal (ph, ret_prot, ret_ts, ret_index, true,
-                                 NIL_SINGLETON);
+                                 hose_pattern (ph));
+}
+
+ob_retort pool_net_set_filter (pool_hose ph, bslaw filter)
+{
+  // The server runs every search through protein_search(), so once it
+  // knows about protein filters, it can apply any filter, as long as
+  // we always go the fancy way.
+  if (pool_net_supports_cmd (ph->net, POOL_CMD_FILTERS)
+      && pool_net_supports_cmd (ph->net, POOL_CMD_FANCY_ADD_AWAITER))
+    {
+      // What we read ahead wasn't filtered
+      drop_read_ahead (ph->net);
+      return OB_OK;
+    }
+  return POOL_UNSUPPORTED_OPERATION;
 }
 
 ob_retort pool_net_prev (pool_hose ph, protein *ret_prot,
@@ -1121,6 +2106,10 @@ ob_retort pool_net_probe_frwd (pool_hose ph, bslaw search, protein *ret_prot,
   ob_retort pret, remote_pret;
   pool_timestamp ts;
   int64 idx;
+
+  if (!search_supported (ph, search))
+    return POOL_UNSUPPORTED_OPERATION;
+
   if ((pret = pool_net_clear_dirty (ph)) != OB_OK)
     return pret;
 
@@ -1173,7 +2162,8 @@ ob_retort pool_net_probe_back (pool_hose ph, bslaw search, protein *ret_prot,
   pool_timestamp ts;
   int64 idx;
 
-  if (!pool_net_supports_cmd (ph->net, POOL_CMD_PROBE_BACK))
+  if (!pool_net_supports_cmd (ph->net, POOL_CMD_PROBE_BACK)
+      || !search_supported (ph, search))
     return POOL_UNSUPPORTED_OPERATION;
 
   if ((pret = pool_net_clear_dirty (ph)) != OB_OK)
@@ -1274,7 +2264,8 @@ static ob_retort fancy_await_next_single (pool_hose ph, pool_timestamp timeout,
 
   ob_log (OBLV_DBUG, 0x20106019, "Selecting for %f\n", timeout);
 
-  tort = ob_select2 (&sel2, timeout, true);
+  tort = (ob_tls_pending (ph->net->connfd) ? OB_OK
+                                           : ob_select2 (&sel2, timeout, true));
   ob_retort t2 = ob_select2_finish (&sel2);
   pool_net_multi_remove_awaiter (ph);
 
@@ -1300,6 +2291,9 @@ ob_retort pool_net_await_probe_frwd (pool_hose ph, bslaw search,
   const bool fancy =
     pool_net_supports_cmd (ph->net, POOL_CMD_FANCY_ADD_AWAITER);
 
+  if (!search_supported (ph, search))
+    return POOL_UNSUPPORTED_OPERATION;
+
   if (timeout == POOL_NO_WAIT)
     {
       ob_retort tort =
@@ -1323,7 +2317,7 @@ ob_retort pool_net_await_next_single (pool_hose ph, pool_timestamp timeout,
 
   if (fancy)
     return fancy_await_next_single (ph, timeout, ret_prot, ret_ts, ret_index,
-                                    NIL_SINGLETON);
+                                    hose_pattern (ph));
 
   // This is the old way for old servers, although it exhibits bug 376
 
@@ -1378,7 +2372,7 @@ ob_retort pool_net_multi_add_awaiter (pool_hose ph, protein *ret_prot,
                                       pool_timestamp *ret_ts, int64 *ret_index)
 {
   return pool_net_multi_add_awaiter_internal (ph, ret_prot, ret_ts, ret_index,
-                                              NIL_SINGLETON);
+                                              hose_pattern (ph));
 }
 
 static ob_retort pool_net_multi_add_awaiter_internal (pool_hose ph,
@@ -1630,8 +2624,11 @@ ob_retort pool_net_fetch (pool_hose ph, pool_fetch_op *ops, int64 nops,
   if (!newest_idx_out)
     newest_idx_out = &(dummies[1]);
 
+  ob_retort pret = pool_net_deposit_flush (ph);
+  if (pret < OB_OK)
+    return pret;
+
   slaw s = convert_fetch_ops_to_slaw (ops, nops);
-  ob_retort pret;
   if (cmd == POOL_CMD_SUB_FETCH)
     pret = pool_net_send_op (ph->net, POOL_CMD_SUB_FETCH, "x", s);
   else
@@ -1662,7 +2659,7 @@ ob_retort pool_net_server_await (pool_hose ph, pool_net_data *net,
           timeout);
 
 considered_harmful:
-  pret = pool_fifo_multi_add_awaiter (ph, ret_prot, ret_ts, ret_index);
+  pret = ph->multi_add_awaiter (ph, ret_prot, ret_ts, ret_index);
   // Did we get a protein?  Then send it back now.
   if (pret == OB_OK)
     return pret;
@@ -1694,7 +2691,7 @@ considered_harmful:
   //been unlinked. however, our handle to the event object (->notify_handle)
   //is still in-use so we need to release it and call multi_remove_awaiter
   //in any case
-  pool_fifo_multi_remove_awaiter (ph);
+  ph->multi_remove_awaiter (ph);
 
   // Check to see if we got a protein
   pret = pool_next (ph, ret_prot, ret_ts, ret_index);
@@ -1724,3 +2721,31 @@ erroneous:
     }
   return pret;
 }
+
+ob_retort pool_net_server_notifier_arm (pool_hose ph, ob_handle_t *handle)
+{
+  // Start from the end of the pool, so that setting up the fifo
+  // doesn't have to read a protein nobody asked for.
+  int64 newest;
+  ob_retort pret = pool_newest_index (ph, &newest);
+  if (pret == OB_OK)
+    pool_seekto (ph, newest + 1);
+  else if (pret != POOL_NO_SUCH_PROTEIN)
+    return pret;
+
+  protein p = NULL;
+  pool_timestamp ts;
+  int64 idx;
+  pret = ph->multi_add_awaiter (ph, &p, &ts, &idx);
+  Free_Protein (p);
+  if (pret != OB_OK && pret != POOL_NO_SUCH_PROTEIN)
+    return pret;
+
+  *handle = ph->notify_handle;
+  return OB_OK;
+}
+
+void pool_net_server_notifier_drain (pool_hose ph)
+{
+  ph->multi_remove_awaiter (ph);
+}
@@ -42,6 +42,8 @@
 // Based on readn() and writen() from "Unix Network Programming,
 // Vol. 1, 3rd ed."
 
+#ifdef _MSC_VER
+
 ob_retort pool_tcp_send_nbytes (ob_sock_t sock, const void *buf, size_t len,
                                 ob_handle_t wake_event)
 {
@@ -134,6 +136,156 @@ ob_retort pool_tcp_send_nbytes (ob_sock_t sock, const void *buf, size_t len,
   return pret;
 }
 
+// No sendmsg() here, so just send the pieces one at a time
+
+ob_retort pool_tcp_send_iov (ob_sock_t sock, const pool_net_iov *iov, int n,
+                             ob_handle_t wake_event)
+{
+  int i;
+  for (i = 0; i < n; i++)
+    {
+      ob_retort pret =
+        pool_tcp_send_nbytes (sock, iov[i].base, iov[i].len, wake_event);
+      if (pret == POOL_AWAIT_WOKEN && i > 0)
+        return POOL_AWAIT_WOKEN_DIRTY;
+      if (pret < OB_OK)
+        return pret;
+    }
+  return OB_OK;
+}
+
+#else
+
+ob_retort pool_tcp_send_nbytes (ob_sock_t sock, const void *buf, size_t len,
+                                ob_handle_t wake_event)
+{
+  pool_net_iov one;
+  one.base = buf;
+  one.len = len;
+  return pool_tcp_send_iov (sock, &one, 1, wake_event);
+}
+
+ob_retort pool_tcp_send_iov (ob_sock_t sock, const pool_net_iov *iov, int n,
+                             ob_handle_t wake_event)
+{
+  struct iovec vec[POOL_NET_IOV_MAX];
+  struct msghdr msg;
+  size_t nleft = 0;
+  size_t len;
+  ssize_t nwritten;
+  int first, count;
+  ob_select2_t sel2;
+  ob_retort tort;
+#ifdef MSG_NOSIGNAL
+  const int send_flags = MSG_NOSIGNAL;
+#else
+  const int send_flags = 0;
+#endif
+
+  if (n > POOL_NET_IOV_MAX)
+    OB_FATAL_BUG_CODE (0x2010802d, "%d pieces is more than %d\n", n,
+                       POOL_NET_IOV_MAX);
+  for (first = count = 0; first < n; first++)
+    if (iov[first].len > 0)
+      {
+        vec[count].iov_base = (void *) iov[first].base;
+        vec[count].iov_len = iov[first].len;
+        nleft += iov[first].len;
+        count++;
+      }
+  len = nleft;
+
+  if (wake_event != OB_NULL_HANDLE)
+    {
+      tort = ob_select2_prepare (&sel2, OB_SEL2_SEND, sock, wake_event);
+      if (tort < OB_OK)
+        return tort;
+    }
+
+  ob_retort pret = OB_OK;
+
+  first = 0;
+  while (nleft > 0)
+    {
+      if (wake_event != OB_NULL_HANDLE)
+        {
+          tort = ob_select2 (&sel2, POOL_WAIT_FOREVER, true);
+          if (tort == POOL_AWAIT_WOKEN && nleft != len)
+            {
+              pret = POOL_AWAIT_WOKEN_DIRTY;
+              break;
+            }
+          else if (tort < OB_OK)
+            {
+              pret = tort;
+              break;
+            }
+        }
+
+      memset (&msg, 0, sizeof (msg));
+      msg.msg_iov = vec + first;
+      msg.msg_iovlen = count - first;
+      errno = 0;
+      nwritten = sendmsg (sock, &msg, send_flags);
+      const int erryes = errno;
+
+      if (nwritten > 0)
+        {
+          nleft -= nwritten;
+          // Skip past whatever got sent, which may end partway
+          // through one of the pieces
+          while (nwritten > 0)
+            if ((size_t) nwritten >= vec[first].iov_len)
+              nwritten -= vec[first++].iov_len;
+            else
+              {
+                vec[first].iov_base = (char *) vec[first].iov_base + nwritten;
+                vec[first].iov_len -= nwritten;
+                nwritten = 0;
+              }
+        }
+      else
+        {
+          if (SHOULD_TRY_AGAIN (nwritten))
+            {
+              // give it another go
+              nwritten = 0;
+              continue;
+            }
+
+          // it's likely the other end closed the socket for some reason
+          if (nwritten == -1 && erryes == EPIPE)
+            {
+              OB_LOG_WARNING_CODE (0x20108027,
+                                   "socket was closed unexpectedly");
+              pret = POOL_UNEXPECTED_CLOSE;
+            }
+          else
+            {
+              OB_LOG_WARNING_CODE (0x20108000,
+                                   "send() returned %" OB_FMT_SIZE "d with "
+                                   "errno '%s' with %" OB_FMT_SIZE
+                                   "d bytes left\n",
+                                   nwritten, strerror (erryes), nleft);
+              pret = POOL_SEND_BADTH;
+            }
+          errno = erryes;
+          break;
+        }
+    }
+
+  if (wake_event != OB_NULL_HANDLE)
+    {
+      tort = ob_select2_finish (&sel2);
+      if (tort <= OB_OK && pret == OB_OK)
+        return tort;
+    }
+
+  return pret;
+}
+
+#endif
+
 ob_retort pool_tcp_recv_nbytes (ob_sock_t sock, void *buf, size_t len,
                                 ob_handle_t wake_event)
 {
@@ -225,6 +377,7 @@ ob_retort pool_tcp_recv_nbytes (ob_sock_t sock, void *buf, size_t len,
 
 static ob_retort pool_tcp_close (unt64 code, pool_net_data *net)
 {
+  ob_tls_end (net->connfd, true);
   ob_retort ort = ob_close_socket (net->connfd);
   if (ort < OB_OK)
     OB_LOG_ERROR_CODE (code, "failed to close socket: %s\n",
@@ -514,6 +667,8 @@ static unt64 current_cmds (void)
   cmds |= (OB_CONST_U64 (1) << POOL_CMD_GREENHOUSE);
 #endif
   cmds |= (OB_CONST_U64 (1) << POOL_CMD_STARTTLS);
+  cmds |= (OB_CONST_U64 (1) << POOL_CMD_FILTERS);
+  cmds |= (OB_CONST_U64 (1) << POOL_CMD_DEPOSIT_BATCH);
 
   return cmds;
 }
@@ -550,15 +705,14 @@ static ob_retort negotiate_version (pool_net_data *net,
     }
 
   ob_retort pret =
-    pool_tcp_send_nbytes (net->connfd, greet, greet_size, nullWaitObject);
+    net->send_nbytes (net->connfd, greet, greet_size, nullWaitObject);
   if (pret < OB_OK)
     return pret;
 
   // get back what version the server supports
   byte vers[2];
   OB_INVALIDATE (vers);
-  pret =
-    pool_tcp_recv_nbytes (net->connfd, vers, sizeof (vers), nullWaitObject);
+  pret = net->recv_nbytes (net->connfd, vers, sizeof (vers), nullWaitObject);
   if (pret < OB_OK)
     return pret;
   net->net_version = vers[0];
@@ -585,7 +739,7 @@ static ob_retort negotiate_version (pool_net_data *net,
   // If this is protocol version 1 or higher, we get one byte saying how
   // many bytes follow, which then make up a bitmask of supported commands.
   byte len;
-  pret = pool_tcp_recv_nbytes (net->connfd, &len, sizeof (len), nullWaitObject);
+  pret = net->recv_nbytes (net->connfd, &len, sizeof (len), nullWaitObject);
   if (pret < OB_OK)
     return pret;
 
@@ -593,7 +747,7 @@ static ob_retort negotiate_version (pool_net_data *net,
   byte *cmd_bytes = (byte *) malloc (len);
   if (!cmd_bytes)
     return OB_NO_MEM;
-  pret = pool_tcp_recv_nbytes (net->connfd, cmd_bytes, len, nullWaitObject);
+  pret = net->recv_nbytes (net->connfd, cmd_bytes, len, nullWaitObject);
   if (pret < OB_OK)
     {
       free (cmd_bytes);
@@ -824,6 +978,17 @@ static ob_retort start_tls (pool_net_data *net, const char *hostname,
   const char *certificate = slaw_path_get_string (options, "certificate", NULL);
   const char *private_key = slaw_path_get_string (options, "private-key", NULL);
 
+#ifndef _MSC_VER
+  // Encrypt and decrypt right here, on our own socket
+  pret = ob_tls_client_start (net->connfd, hostname, security != Ob_Secure,
+                              certificate, private_key);
+  if (pret < OB_OK)
+    return pret;
+
+  net->send_nbytes = ob_tls_send_nbytes;
+  net->send_iov = ob_tls_send_iov;
+  net->recv_nbytes = ob_tls_recv_nbytes;
+#else
   ob_sock_t pair[2];
   if (pret >= OB_OK)
     pret = ob_socketpair_cloexec (OB_SP_DOMAIN, SOCK_STREAM, 0, pair);
@@ -837,6 +1002,7 @@ static ob_retort start_tls (pool_net_data *net, const char *hostname,
     return pret;
 
   net->connfd = pair[1];
+#endif
   return negotiate_version (net, true, hostname, port_str);
 }
 
@@ -886,6 +1052,7 @@ reconnect_to_server:
   net->wakeup_handle_loc = wakeup_handle_loc;
 
   net->send_nbytes = pool_tcp_send_nbytes;
+  net->send_iov = pool_tcp_send_iov;
   net->recv_nbytes = pool_tcp_recv_nbytes;
   OB_CLEAR (net->outstanding);
   net->outstanding.status = OB_NO_AWAIT;
@@ -1185,6 +1352,9 @@ static ob_retort pool_tcp_withdraw (pool_hose ph)
   ob_retort pret;
   parsed_pseudo_uri *d = get_parsed_pseudo_uri (ph);
 
+  // Whatever happens, the callbacks of any async deposits get called
+  pool_net_deposit_flush (ph);
+
   if (ph->dirty)
     {
       // If we have a dirty ph, the protocol isn't in a consistent state, so we
@@ -1218,6 +1388,9 @@ static ob_retort pool_tcp_hiatus (pool_hose ph)
    * (Once again, we are somewhat nonportably assuming that 0 is not
    * a valid pthread_t.) */
   ph->net->tls_thread = 0;
+  /* Likewise, the TLS session belongs to the parent; just forget it,
+   * rather than telling the server it's over. */
+  ob_tls_end (ph->net->connfd, false);
 
   ob_retort tort = pool_tcp_close (0x20108022, ph->net);
   free_parsed_pseudo_uri (d);
@@ -1461,8 +1634,10 @@ static ob_retort pool_tcp_info (pool_hose ph, int64 hops, protein *return_prot)
   if (hops > 0)
     hops--;
 
-  ob_retort pret = pool_net_send_op (ph->net, POOL_CMD_INFO, "i", hops);
+  ob_retort pret = pool_net_deposit_flush (ph);
   ob_retort remote_pret;
+  if (pret == OB_OK)
+    pret = pool_net_send_op (ph->net, POOL_CMD_INFO, "i", hops);
   if (pret == OB_OK)
     pret = pool_net_recv_result (ph->net, "rp", &remote_pret, return_prot);
   if (pret == OB_OK)
@@ -1505,5 +1680,9 @@ ob_retort pool_tcp_load_methods (pool_hose ph)
   ph->set_hose_name = pool_net_set_hose_name;
   ph->await_probe_frwd = pool_net_await_probe_frwd;
   ph->fetch = pool_net_fetch;
+  ph->set_filter = pool_net_set_filter;
+  ph->deposit_batch = pool_net_deposit_batch;
+  ph->deposit_async = pool_net_deposit_async;
+  ph->deposit_flush = pool_net_deposit_flush;
   return OB_OK;
 }
@@ -36,6 +36,10 @@
 
 #ifdef __gnu_linux__
 #include <sys/prctl.h>
+#include <sys/epoll.h>
+#include "libLoam/c/ob-pthread.h"
+// Serve connections from a pool of threads (-w) instead of forking
+#define POOL_TCP_WORKERS
 #endif
 
 #define EXIT_IN_USE 9
@@ -91,6 +95,10 @@ static bool allow_tls = true;
 static bool require_tls = false;
 static bool client_auth = false;
 
+// Command line option to serve connections from this many threads,
+// rather than forking a process per connection (0 means fork)
+static int num_workers;
+
 // an upper bound on the value of a network op
 #define NUM_CMDS 128
 
@@ -250,6 +258,11 @@ static ob_retort welcome_new_version (pool_net_data *net,
     net->net_version = POOL_TCP_VERSION_CURRENT;
   if (net->slaw_version > SLAW_VERSION_CURRENT)
     net->slaw_version = SLAW_VERSION_CURRENT;
+  // Frames carry slawx just as they are, so they need both ends to be
+  // using the current slaw version
+  if (net->slaw_version != SLAW_VERSION_CURRENT
+      && net->net_version >= POOL_TCP_VERSION_WITH_BINARY_FRAMES)
+    net->net_version = POOL_TCP_VERSION_WITH_BINARY_FRAMES - 1;
 
   unt64 cmds = 0;
 
@@ -282,6 +295,8 @@ static ob_retort welcome_new_version (pool_net_data *net,
       cmds |= (OB_CONST_U64 (1) << POOL_CMD_CHANGE_OPTIONS);
       cmds |= (OB_CONST_U64 (1) << POOL_CMD_LIST_EX);
       cmds |= (OB_CONST_U64 (1) << POOL_CMD_SUB_FETCH_EX);
+      cmds |= (OB_CONST_U64 (1) << POOL_CMD_FILTERS);
+      cmds |= (OB_CONST_U64 (1) << POOL_CMD_DEPOSIT_BATCH);
 #ifdef GREENHOUSE
       cmds |= (OB_CONST_U64 (1) << POOL_CMD_GREENHOUSE);
 #endif
@@ -408,17 +423,158 @@ static slaw convert_fetch_ops_to_slaw (const pool_fetch_op *ops, int64 nops)
   return slaw_list_f (sb);
 }
 
+#ifdef POOL_TCP_WORKERS
+typedef struct tcp_conn tcp_conn;
+#endif
+
+/// Everything we know about one client connection.  The default
+/// fork-per-connection server keeps this on tend_pool_hose()'s
+/// stack; the worker thread server (-w) keeps one per connection
+/// for as long as the connection stays open.
+typedef struct tend_state
+{
+  pool_net_data *net;
+  const char *remote_host;
+  char *poolName;
+  // The hose we operate on.  With worker threads, this is only
+  // non-NULL while a command is being processed.
+  pool_hose ph;
+  slaw hose_name;
+  // Have we successfully participated in a pool yet?
+  bool participating;
+  // Has STARTTLS been executed yet?
+  bool enabled_tls;
+  // The most recent command, so we know if the client withdrew
+  int op_num;
+  int count;
+  // Variables used for statistics
+  char *remote_hname;
+  char *remote_process;
+  int64 remote_pid;
+  int64 op_count[NUM_CMDS];
+#ifdef POOL_TCP_WORKERS
+  // Non-NULL if this connection is served by worker threads
+  tcp_conn *conn;
+#endif
+} tend_state;
+
+/// What should happen to a connection after it has processed a command.
+typedef enum
+{
+  TEND_CONTINUE, ///< read and process another command
+  TEND_FINISHED, ///< close the connection
+  TEND_PARKED,   ///< (worker threads only) awaiting a deposit
+  TEND_STARTTLS  ///< (worker threads only) needs a thread of its own
+} tend_status;
+
+#ifdef POOL_TCP_WORKERS
+static ob_retort hose_cache_join (tend_state *st, const char *type,
+                                  bprotein create_options);
+static ob_retort hose_cache_leave (tend_state *st);
+static tend_status conn_park (tend_state *st, int op_num, int64 idx,
+                              slaw search);
+#endif
+
+/// True if this connection's hoses are shared with other connections
+/// (which means they are only ours while we process a command).
+static inline bool tend_shares_hoses (const tend_state *st)
+{
+#ifdef POOL_TCP_WORKERS
+  return (st->conn != NULL);
+#else
+  return false;
+#endif
+}
+
+static void tend_state_init (tend_state *st, pool_net_data *net,
+                             const char *remote_host)
+{
+  memset (st, 0, sizeof (*st));
+  st->net = net;
+  st->remote_host = remote_host;
+  st->remote_pid = -1;
+  st->op_num = -1;
+
+#ifdef DROP_SUPPORT_FOR_SLAW_V1
+  // Don't even try to negotiate.
+  // This is inflexible, but useful during creduce.
+  net->net_version = POOL_TCP_VERSION_CURRENT;
+  net->slaw_version = SLAW_VERSION_CURRENT;
+#else
+  // Start out the connection using protocol verion 0 (which
+  // implies slaw version 1) and then possibly negotiate a
+  // higher version from there.
+  net->net_version = 0;
+  net->slaw_version = 1;
+#endif
+}
+
+static void tend_state_cleanup (tend_state *st)
+{
+  Free_Ptr (st->poolName);
+  Free_Ptr (st->remote_hname);
+  Free_Ptr (st->remote_process);
+  Free_Slaw (st->hose_name);
+}
+
+/// Logs what went wrong with a connection, and tells the caller to
+/// close it.
+static tend_status tend_badness (tend_state *st, const char *grumpy,
+                                 ob_retort badness_pret, int badness_errno,
+                                 const char *badness_file, int badness_line)
+{
+  errno = badness_errno;
+  const char *msg = ob_error_string (badness_pret);
+  slaw extra;
+  if (badness_pret == POOL_RECV_BADTH)
+    // POOL_RECV_BADTH was probably caused by a system error,
+    // so tack on errno for extra information.
+    // XXX: but sometimes this is misleading.
+    extra = slaw_string_format (" (%s)", strerror (badness_errno));
+  else if (badness_pret == ob_errno_to_retort (EACCES))
+    extra = slaw_string_format (", when OB_POOLS_DIR=%s",
+                                ob_get_standard_path (ob_pools_dir));
+  else
+    // Otherwise, there is no extra information.
+    extra = slaw_string ("");
+  ob_log_loc (badness_file, badness_line, OBLV_ERROR, 0,
+              "[pool %s] %s encountered %s%s\n",
+              (st->poolName ? st->poolName : "<unknown>"), grumpy, msg,
+              slaw_string_emit (extra));
+  slaw_free (extra);
+  return TEND_FINISHED;
+}
+
 #define SUPREME_BADNESS(what, err, e)                                          \
-  do                                                                           \
-    {                                                                          \
-      grumpy = (what);                                                         \
-      badness_pret = err;                                                      \
-      badness_file = __FILE__;                                                 \
-      badness_line = __LINE__;                                                 \
-      badness_errno = e;                                                       \
-      goto badness;                                                            \
-    }                                                                          \
-  while (0)
+  return tend_badness (st, (what), (err), (e), __FILE__, __LINE__)
+
+/// Participate in the pool named by st->poolName, creating it with
+/// the given type and options if type is non-NULL.
+static ob_retort tend_participate (tend_state *st, const char *type,
+                                   bprotein create_options)
+{
+#ifdef POOL_TCP_WORKERS
+  if (st->conn)
+    return hose_cache_join (st, type, create_options);
+#endif
+  if (type)
+    return pool_participate_creatingly (st->poolName, type, &st->ph,
+                                        create_options);
+  return pool_participate (st->poolName, &st->ph, NULL);
+}
+
+/// Give up the hose obtained by tend_participate().
+static ob_retort tend_release_hose (tend_state *st)
+{
+  st->participating = false;
+#ifdef POOL_TCP_WORKERS
+  if (st->conn)
+    return hose_cache_leave (st);
+#endif
+  ob_retort pret = pool_withdraw (st->ph);
+  st->ph = NULL;
+  return pret;
+}
 
 /// Once a connection has been established, process commands coming
 /// from the client.
@@ -429,6 +585,10 @@ static slaw convert_fetch_ops_to_slaw (const pool_fetch_op *ops, int64 nops)
 /// after the operation completes.  For a participate, we go into a
 /// loop processing "on-going" commands.  We exit out of the loop when
 /// we get a withdraw command or the connection breaks down.
+///
+/// tend_first_command() handles a single command in the first state;
+/// it returns TEND_CONTINUE with st->participating set once we have
+/// moved on to processing on-going commands with tend_command().
 
 // We attempt to be somewhat resilient against bad things happening,
 // but we really need some sort of safe protein sanity-check before
@@ -439,85 +599,70 @@ static slaw convert_fetch_ops_to_slaw (const pool_fetch_op *ops, int64 nops)
 // possible to write the recv_result so that it can deal with the case
 // of unexpected return values but it doesn't currently.
 
-static void tend_pool_hose (pool_net_data *net, const char *remote_host)
+/// Does the server side of the TLS handshake, once the client has
+/// heard that we're up for it, and then encrypts everything after.
+static tend_status tend_start_tls (tend_state *st)
+{
+  pool_net_data *net = st->net;
+#ifndef _MSC_VER
+  // Encrypt and decrypt right here, on the same socket
+  ob_retort pret = ob_tls_server_start (net->connfd, !require_tls, client_auth);
+  const int e0 = errno;
+  if (pret < OB_OK)
+    SUPREME_BADNESS ("starting TLS", pret, e0);
+  net->send_nbytes = ob_tls_send_nbytes;
+  net->send_iov = ob_tls_send_iov;
+  net->recv_nbytes = ob_tls_recv_nbytes;
+#else
+  int pair[2];
+  OB_DIE_ON_ERROR (ob_socketpair_cloexec (OB_SP_DOMAIN, SOCK_STREAM, 0, pair));
+  OB_DIE_ON_ERROR (ob_nosigpipe_sockopt_x2 (pair));
+  OB_DIE_ON_ERROR (ob_tls_server_launch_thread (pair[0], net->connfd,
+                                                &net->tls_thread, !require_tls,
+                                                client_auth));
+  net->connfd = pair[1];
+#endif
+  ob_retort send_pret = welcome_new_version_tls (net);
+  const int e = errno;
+  if (send_pret < OB_OK)
+    SUPREME_BADNESS ("re-negotiating protocol version", send_pret, e);
+  st->enabled_tls = true;
+  return TEND_CONTINUE;
+}
+
+static tend_status tend_first_command (tend_state *st)
 {
   /// All operations involve two ob_retort values: one recording the
   /// result of the actual operation, and one recording the result of
   /// the attempt to send or receive data.  We must check both.
   ob_retort pret;
   ob_retort send_pret;
-  ob_retort recv_pret;
 
+  pool_net_data *net = st->net;
   int op_num;
   protein op_protein;
-  char *poolName = NULL;
-  pool_hose ph = NULL;
-  slaw hose_name = NULL;
 
   // Variables needed for incoming requests
   protein create_options;
   protein participate_options;
-  protein deposit;
-  slaw search;
-  int64 idx;
-  pool_timestamp timeout;
   char *type;
-  // Variables needed for returning the results
-  int64 ret_index;
-  protein ret_prot;
-  pool_timestamp ret_ts;
-
-  // Variables used by SUPREME_BADNESS macro
-  const char *grumpy;      // description of where error occurred
-  ob_retort badness_pret;  // error that occurred
-  int badness_errno;       // copy of errno if we need it
-  const char *badness_file;
-  int badness_line;
-  const char *msg;
-
-  // Variables used in the main while loop:
-  bool exit_cmd_loop;
-  int count;
-
-  // Has STARTTLS been executed yet?
-  bool enabled_tls = false;
-
-  // Variables used for statistics
-  char *remote_hname = NULL;
-  char *remote_process = NULL;
-  int64 remote_pid = -1;
-  int64 op_count[NUM_CMDS];
-  OB_CLEAR (op_count);
-
-  ob_log (OBLV_DBUG, 0x20109000, "reading first command\n");
-
-#ifdef DROP_SUPPORT_FOR_SLAW_V1
-  // Don't even try to negotiate.
-  // This is inflexible, but useful during creduce.
-  net->net_version = POOL_TCP_VERSION_CURRENT;
-  net->slaw_version = SLAW_VERSION_CURRENT;
-#else
-  // Start out the connection using protocol verion 0 (which
-  // implies slaw version 1) and then possibly negotiate a
-  // higher version from there.
-  net->net_version = 0;
-  net->slaw_version = 1;
-#endif
 
-first_command:
 #ifndef _MSC_VER /* for now I don't want to mess with this on Windows */
-  ob_nop ();     /* can't have declaration immediately after label :( */
-  /* This is the hack mentioned in bug 10657 comment 8 */
-  ob_select2_t os2;
-  pret =
-    ob_select2_prepare (&os2, OB_SEL2_RECEIVE, net->connfd, OB_NULL_HANDLE);
-  if (pret < OB_OK)
-    SUPREME_BADNESS ("ob_select2_prepare", pret, errno);
-  pret = ob_select2 (&os2, 15.0, false);
-  const int foo = errno;
-  ob_select2_finish (&os2);
-  if (pret < OB_OK)
-    SUPREME_BADNESS ("ob_select2", pret, foo);
+  /* This is the hack mentioned in bug 10657 comment 8.  (A worker
+   * already has the whole command in hand.) */
+  if (!tend_shares_hoses (st))
+    {
+      ob_select2_t os2;
+      pret = ob_select2_prepare (&os2, OB_SEL2_RECEIVE, net->connfd,
+                                 OB_NULL_HANDLE);
+      if (pret < OB_OK)
+        SUPREME_BADNESS ("ob_select2_prepare", pret, errno);
+      pret = ob_select2 (&os2, 15.0, false);
+      const int foo = errno;
+      ob_select2_finish (&os2);
+      if (pret < OB_OK)
+        SUPREME_BADNESS ("ob_select2", pret, foo);
+    }
 #endif
   pret = pool_net_recv_op (net, &op_num, &op_protein);
   if (pret != OB_OK)
@@ -548,32 +693,27 @@ first_command:
                          e2);
       if (tls_available >= OB_OK)
         {
-          int pair[2];
-          OB_DIE_ON_ERROR (
-            ob_socketpair_cloexec (OB_SP_DOMAIN, SOCK_STREAM, 0, pair));
-          OB_DIE_ON_ERROR (ob_nosigpipe_sockopt_x2 (pair));
-          OB_DIE_ON_ERROR (
-            ob_tls_server_launch_thread (pair[0], net->connfd, &net->tls_thread,
-                                         !require_tls, client_auth));
-          net->connfd = pair[1];
-          send_pret = welcome_new_version_tls (net);
-          const int e = errno;
-          if (send_pret < OB_OK)
-            SUPREME_BADNESS ("re-negotiating protocol version", send_pret, e);
-          enabled_tls = true;
+#ifdef POOL_TCP_WORKERS
+          // The handshake takes as long as the client wants it to, so
+          // don't do it on a worker
+          if (st->conn)
+            return TEND_STARTTLS;
+#endif
+          return tend_start_tls (st);
         }
-      goto first_command;
+      return TEND_CONTINUE;
     }
 
   if (op_num == POOL_CMD_DISPOSE)
     {
-      pret = pool_net_unpack_op (op_protein, net->net_version, "s", &poolName);
+      pret =
+        pool_net_unpack_op (op_protein, net->net_version, "s", &st->poolName);
       if (pret != OB_OK)
         SUPREME_BADNESS ("POOL_CMD_DISPOSE: pool_net_unpack_op", pret, errno);
       const unt8 *rude_ptr;
       int64 rude_len;
       if (net->net_version == 0 && net->slaw_version == 1
-          && strcmp (poolName, "^/^/^/^") == 0
+          && strcmp (st->poolName, "^/^/^/^") == 0
           && (rude_ptr = (const unt8 *) protein_rude (op_protein, &rude_len))
                != NULL
           && rude_len == 12)
@@ -591,36 +731,35 @@ first_command:
           int e = errno;
           if (send_pret != OB_OK)
             SUPREME_BADNESS ("negotiating protocol version", send_pret, e);
-          Free_Ptr (poolName);
+          Free_Ptr (st->poolName);
           // Don't close connection; allow them to set the version and then
           // do something else on same hose.
-          goto first_command;
+          return TEND_CONTINUE;
         }
-      else if (require_tls && !enabled_tls)
+      else if (require_tls && !st->enabled_tls)
         goto bad_start;
       protein_free (op_protein);
-      ob_log (OBLV_DBUG, 0x20109002, "%s: dispose\n", poolName);
-      pret = pool_dispose (poolName);
+      ob_log (OBLV_DBUG, 0x20109002, "%s: dispose\n", st->poolName);
+      pret = pool_dispose (st->poolName);
       send_pret = pool_net_send_result (net, "r", pret);
       int e = errno;
       if (send_pret != OB_OK)
         SUPREME_BADNESS ("POOL_CMD_DISPOSE: pool_net_send_result", send_pret,
                          e);
-      Free_Ptr (poolName);
-      return;
+      return TEND_FINISHED;
     }
 
-  if (require_tls && !enabled_tls)
+  if (require_tls && !st->enabled_tls)
     goto bad_start;
 
   if (op_num == POOL_CMD_CREATE)
     {
       pret = pool_net_unpack_op_f (op_protein, net->net_version, "ssp",
-                                   &poolName, &type, &create_options);
+                                   &st->poolName, &type, &create_options);
       if (pret != OB_OK)
         SUPREME_BADNESS ("POOL_CMD_CREATE: pool_net_unpack_op", pret, errno);
-      ob_log (OBLV_DBUG, 0x20109001, "%s: create\n", poolName);
-      pret = pool_create (poolName, type, create_options);
+      ob_log (OBLV_DBUG, 0x20109001, "%s: create\n", st->poolName);
+      pret = pool_create (st->poolName, type, create_options);
       send_pret = pool_net_send_result (net, "r", pret);
       int e = errno;
       free (type);
@@ -628,43 +767,42 @@ first_command:
       // Terminate the connection by returning from the function
       if (send_pret != OB_OK)
         SUPREME_BADNESS ("POOL_CMD_CREATE: pool_net_send_result", send_pret, e);
-      Free_Ptr (poolName);
-      return;
+      return TEND_FINISHED;
     }
 
   if (op_num == POOL_CMD_SLEEP)
     {
-      pret = pool_net_unpack_op (op_protein, net->net_version, "s", &poolName);
+      pret =
+        pool_net_unpack_op (op_protein, net->net_version, "s", &st->poolName);
       if (pret != OB_OK)
         SUPREME_BADNESS ("POOL_CMD_SLEEP: pool_net_unpack_op", pret, errno);
       Free_Protein (op_protein);
-      OB_LOG_DEBUG_CODE (0x20109055, "%s: dispose\n", poolName);
-      pret = pool_sleep (poolName);
+      OB_LOG_DEBUG_CODE (0x20109055, "%s: dispose\n", st->poolName);
+      pret = pool_sleep (st->poolName);
       send_pret = pool_net_send_result (net, "r", pret);
       const int e = errno;
       if (send_pret != OB_OK)
         SUPREME_BADNESS ("POOL_CMD_SLEEP: pool_net_send_result", send_pret, e);
-      Free_Ptr (poolName);
-      return;
+      return TEND_FINISHED;
     }
 
   if (op_num == POOL_CMD_RENAME)
     {
       char *new_name = NULL;
       pret = pool_net_unpack_op_f (op_protein, net->net_version, "ss",
-                                   &poolName, &new_name);
+                                   &st->poolName, &new_name);
       if (pret != OB_OK)
         SUPREME_BADNESS ("POOL_CMD_RENAME: pool_net_unpack_op", pret, errno);
-      OB_LOG_DEBUG_CODE (0x2010904b, "%s to %s: rename\n", poolName, new_name);
-      pret = pool_rename (poolName, new_name);
+      OB_LOG_DEBUG_CODE (0x2010904b, "%s to %s: rename\n", st->poolName,
+                         new_name);
+      pret = pool_rename (st->poolName, new_name);
       send_pret = pool_net_send_result (net, "r", pret);
       const int e = errno;
       Free_Ptr (new_name);
       // Terminate the connection by returning from the function
       if (send_pret != OB_OK)
         SUPREME_BADNESS ("POOL_CMD_RENAME: pool_net_send_result", send_pret, e);
-      Free_Ptr (poolName);
-      return;
+      return TEND_FINISHED;
     }
 
   if (op_num == POOL_CMD_LIST)
@@ -678,596 +816,1560 @@ first_command:
       slaw_free (lst);
       if (send_pret != OB_OK)
         SUPREME_BADNESS ("POOL_CMD_LIST: pool_net_send_result", send_pret, e);
+      return TEND_FINISHED;
+    }
+
+  if (op_num == POOL_CMD_LIST_EX)
+    {
+      slaw lst = NULL;
+      pret =
+        pool_net_unpack_op_f (op_protein, net->net_version, "s", &st->poolName);
+      if (pret < OB_OK)
+        SUPREME_BADNESS ("POOL_CMD_LIST_EX: pool_net_unpack_op", pret, errno);
+      OB_LOG_DEBUG_CODE (0x2010905d, "%s: list_ex\n", st->poolName);
+      pret = pool_list_ex (st->poolName, &lst);
+      send_pret = pool_net_send_result (net, "rx", pret, lst);
+      int e = errno;
+      slaw_free (lst);
+      if (send_pret != OB_OK)
+        SUPREME_BADNESS ("POOL_CMD_LIST_EX: pool_net_send_result", send_pret,
+                         e);
+      return TEND_FINISHED;
+    }
+
+  // Everything from here on out starts a connection and goes into the
+  // command processing loop.
+  if (op_num == POOL_CMD_PARTICIPATE)
+    {
+      // Starting a new connection!  How fun!
+      pret = pool_net_unpack_op_f (op_protein, net->net_version, "sp",
+                                   &st->poolName, &participate_options);
+      if (pret != OB_OK)
+        SUPREME_BADNESS ("POOL_CMD_PARTICIPATE: pool_net_unpack_op", pret,
+                         errno);
+      ob_log (OBLV_DBUG, 0x20109004, "%s: participate\n", st->poolName);
+      pret = tend_participate (st, NULL, NULL);
+      int e1 = errno;
+      send_pret = pool_net_send_result (net, "r", pret);
+      int e2 = errno;
+      protein_free (participate_options);
+      if (pret != OB_OK)
+        {
+          SUPREME_BADNESS ("POOL_CMD_PARTICIPATE: pool_participate", pret, e1);
+        }
+      if (send_pret != OB_OK)
+        {
+          tend_release_hose (st);
+          SUPREME_BADNESS ("POOL_CMD_PARTICIPATE: pool_net_send_result",
+                           send_pret, e2);
+        }
+    }
+  else if (op_num == POOL_CMD_PARTICIPATE_CREATINGLY)
+    {
+      pret =
+        pool_net_unpack_op_f (op_protein, net->net_version, "sspp",
+                              &st->poolName, &type, &create_options,
+                              &participate_options);
+      // (participate_options are vestigial and are ignored)
+      if (pret != OB_OK)
+        SUPREME_BADNESS ("POOL_CMD_PARTICIPATE_CREATINGLY: "
+                         "pool_net_unpack_op",
+                         pret, errno);
+      ob_log (OBLV_DBUG, 0x20109005, "%s: participate_creatingly\n",
+              st->poolName);
+      ob_retort cret = tend_participate (st, type, create_options);
+      pret = cret;
+      if (net->net_version < POOL_TCP_VERSION_WITH_NEW_PCREATINGLY_CODES)
+        {
+          if (pret == OB_OK)
+            pret = POOL_EXISTS;
+          else if (pret == POOL_CREATED)
+            pret = OB_OK;
+        }
+      int e1 = errno;
+      send_pret = pool_net_send_result (net, "r", pret);
+      int e2 = errno;
+      free (type);
+      protein_free (participate_options);
+      protein_free (create_options);
+      if (cret != OB_OK && cret != POOL_CREATED)
+        {
+          SUPREME_BADNESS ("POOL_CMD_PARTICIPATE_CREATINGLY: "
+                           "pool_participate_creatingly",
+                           cret, e1);
+        }
+      if (send_pret != OB_OK)
+        {
+          tend_release_hose (st);
+          SUPREME_BADNESS ("POOL_CMD_PARTICIPATE_CREATINGLY: "
+                           "pool_net_send_result",
+                           send_pret, e2);
+        }
+    }
+  else
+    {
+    // No other commands are valid.
+    bad_start:
+      OB_LOG_ERROR_CODE (0x20109029, "bad starting op %d\n", op_num);
+      protein_free (op_protein);
+      return TEND_FINISHED;
+    }
+
+  ob_log (OBLV_DBUG, 0x20109006, "%s: command processing\n", st->poolName);
+
+  st->participating = true;
+  st->hose_name = slaw_string_format ("%s@%s", st->poolName, st->remote_host);
+  if (st->ph)
+    pool_set_hose_name (st->ph, slaw_string_emit (st->hose_name));
+  return TEND_CONTINUE;
+}
+
+/// Process one on-going command on a pool we are participating in.
+static tend_status tend_command (tend_state *st, int op_num,
+                                 protein op_protein)
+{
+  ob_retort pret;
+  ob_retort send_pret = OB_OK;
+  tend_status status = TEND_CONTINUE;
+
+  pool_net_data *net = st->net;
+  pool_hose ph = st->ph;
+  const char *poolName = st->poolName;
+
+  // Variables needed for incoming requests
+  slaw search;
+  int64 idx;
+  pool_timestamp timeout;
+  // Variables needed for returning the results
+  int64 ret_index = -1;
+  protein ret_prot = NULL;
+  pool_timestamp ret_ts = -1;
+
+  st->op_num = op_num;
+  if (op_num >= 0 && op_num < NUM_CMDS)
+    st->op_count[op_num]++;
+  switch (op_num)
+    {
+      case POOL_CMD_SET_HOSE_NAME:
+        set_my_name ("SET_HOSE_NAME");
+        ob_log (OBLV_DBUG, 0x20109007, "%s: set hose name\n", poolName);
+        Free_Ptr (st->remote_hname);
+        Free_Ptr (st->remote_process);
+        Free_Slaw (st->hose_name);
+        pret = pool_net_unpack_op_f (op_protein, net->net_version, "ssi",
+                                     &st->remote_hname, &st->remote_process,
+                                     &st->remote_pid);
+        if (pret >= OB_OK)
+          {
+            st->hose_name =
+              slaw_string_format ("%s@%s/%" OB_FMT_64 "d/%s", st->remote_hname,
+                                  st->remote_process, st->remote_pid,
+                                  st->remote_host);
+            // Hoses shared between worker thread connections keep
+            // their own name.
+            if (!tend_shares_hoses (st))
+              pool_set_hose_name (ph, slaw_string_emit (st->hose_name));
+            slaw tmp = slaw_string_format ("%" OB_FMT_64 "d/%s", st->remote_pid,
+                                           st->remote_host);
+            set_client_info (slaw_string_emit (tmp));
+            slaw_free (tmp);
+          }
+        // Note: there is no response to this command; none is needed.
+        break;
+      case POOL_CMD_DEPOSIT:
+        set_my_name ("DEPOSIT");
+        ob_log (OBLV_DBUG, 0x20109008, "%s: deposit %d\n", poolName,
+                st->count++);
+        {
+          // Deposit straight out of the request, rather than a copy
+          bprotein deposit = NULL;
+          pret =
+            pool_net_unpack_op (op_protein, net->net_version, "b", &deposit);
+          if (pret >= OB_OK)
+            pret = pool_deposit_ex (ph, deposit, &ret_index, &ret_ts);
+          protein_free (op_protein);
+          send_pret =
+            pool_net_send_result (net, "irt", ret_index, pret, ret_ts);
+        }
+        break;
+      case POOL_CMD_DEPOSIT_BATCH:
+        set_my_name ("DEPOSIT_BATCH");
+        {
+          slaw batch = NULL;
+          slaw indexes = NULL, stamps = NULL;
+          pret =
+            pool_net_unpack_op_f (op_protein, net->net_version, "x", &batch);
+          const int64 n = (pret < OB_OK ? 0 : slaw_list_count (batch));
+          ob_log (OBLV_DBUG, 0x20109074, "%s: deposit batch of %" OB_FMT_64
+                                         "d\n",
+                  poolName, n);
+          if (pret >= OB_OK && n < 0)
+            pret = POOL_PROTOCOL_ERROR;
+          if (pret >= OB_OK)
+            {
+              bprotein *ps = (bprotein *) calloc (n + 1, sizeof (bprotein));
+              int64 *ix = (int64 *) calloc (n + 1, sizeof (int64));
+              pool_timestamp *tx =
+                (pool_timestamp *) calloc (n + 1, sizeof (pool_timestamp));
+              if (!ps || !ix || !tx)
+                pret = OB_NO_MEM;
+              else
+                {
+                  bslaw cole = slaw_list_emit_first (batch);
+                  int64 i;
+                  for (i = 0; i < n; i++, cole = slaw_list_emit_next (batch,
+                                                                       cole))
+                    ps[i] = cole;
+                  pret = pool_deposit_batch_ex (ph, ps, n, ix, tx);
+                  indexes = slaw_int64_array (ix, n);
+                  stamps = slaw_float64_array (tx, n);
+                }
+              free (ps);
+              free (ix);
+              free (tx);
+            }
+          send_pret = pool_net_send_result (net, "rxx", pret, indexes, stamps);
+          Free_Slaw (indexes);
+          Free_Slaw (stamps);
+          Free_Slaw (batch);
+        }
+        break;
+      case POOL_CMD_NTH_PROTEIN:
+        set_my_name ("NTH_PROTEIN");
+        ob_log (OBLV_DBUG, 0x20109009, "%s: nth protein\n", poolName);
+        pret =
+          pool_net_unpack_op_f (op_protein, net->net_version, "i", &idx);
+        if (pret >= OB_OK)
+          pret = pool_nth_protein (ph, idx, &ret_prot, &ret_ts);
+        if (net->net_version < POOL_TCP_VERSION_WITH_NEW_PCREATINGLY_CODES
+            && pret == POOL_NO_SUCH_PROTEIN)
+          send_pret =
+            pool_net_send_result (net, "ptR", ret_prot, ret_ts,
+                                  ye_olde_no_protein_retorte (ph, idx));
+        else
+          send_pret =
+            pool_net_send_result (net, "ptr", ret_prot, ret_ts, pret);
+        protein_free (ret_prot);
+        break;
+      case POOL_CMD_NEXT:
+        set_my_name ("NEXT");
+        pret =
+          pool_net_unpack_op_f (op_protein, net->net_version, "i", &idx);
+        ob_log (OBLV_DBUG, 0x2010900a, "%s: next\n", poolName);
+        if (pret < OB_OK)
+          search = NULL;
+        else
+          pret = pool_seekto (ph, idx);
+        if (pret >= OB_OK)
+          pret = pool_next (ph, &ret_prot, &ret_ts, &ret_index);
+        if (net->net_version < POOL_TCP_VERSION_WITH_NEW_PCREATINGLY_CODES
+            && pret == POOL_NO_SUCH_PROTEIN)
+          send_pret =
+            pool_net_send_result (net, "ptiR", ret_prot, ret_ts, ret_index,
+                                  ye_olde_no_protein_retorte (ph, idx));
+        else
+          send_pret = pool_net_send_result (net, "ptir", ret_prot, ret_ts,
+                                            ret_index, pret);
+        protein_free (ret_prot);
+        break;
+      case POOL_CMD_PREV:
+        set_my_name ("PREV");
+        pret =
+          pool_net_unpack_op_f (op_protein, net->net_version, "i", &idx);
+        ob_log (OBLV_DBUG, 0x2010900b, "%s: prev\n", poolName);
+        if (pret < OB_OK)
+          search = NULL;
+        else
+          pret = pool_seekto (ph, idx);
+        if (pret >= OB_OK)
+          pret = pool_prev (ph, &ret_prot, &ret_ts, &ret_index);
+        // XXX: Technically, this can't happen, since POOL_CMD_PREV was
+        // added after the retorts were changed.  But, theoretically,
+        // the protocol version and the supported commands are
+        // orthogonal.
+        if (net->net_version < POOL_TCP_VERSION_WITH_NEW_PCREATINGLY_CODES
+            && pret == POOL_NO_SUCH_PROTEIN)
+          send_pret =
+            pool_net_send_result (net, "ptiR", ret_prot, ret_ts, ret_index,
+                                  ye_olde_no_protein_retorte (ph, idx));
+        else
+          send_pret = pool_net_send_result (net, "ptir", ret_prot, ret_ts,
+                                            ret_index, pret);
+        protein_free (ret_prot);
+        break;
+      case POOL_CMD_PROBE_FRWD:
+        set_my_name ("PROBE_FRWD");
+        pret = pool_net_unpack_op_f (op_protein, net->net_version, "ix",
+                                     &idx, &search);
+        ob_log (OBLV_DBUG, 0x2010900c, "%s: probe_frwd\n", poolName);
+        if (pret < OB_OK)
+          search = NULL;
+        else
+          pret = pool_seekto (ph, idx);
+        if (pret >= OB_OK)
+          pret =
+            pool_probe_frwd (ph, search, &ret_prot, &ret_ts, &ret_index);
+        slaw_free (search);
+        send_pret = pool_net_send_result (net, "ptir", ret_prot, ret_ts,
+                                          ret_index, pret);
+        protein_free (ret_prot);
+        break;
+      case POOL_CMD_PROBE_BACK:
+        set_my_name ("PROBE_BACK");
+        pret = pool_net_unpack_op_f (op_protein, net->net_version, "ix",
+                                     &idx, &search);
+        ob_log (OBLV_DBUG, 0x2010900d, "%s: probe_back\n", poolName);
+        if (pret < OB_OK)
+          search = NULL;
+        else
+          pret = pool_seekto (ph, idx);
+        if (pret >= OB_OK)
+          pret =
+            pool_probe_back (ph, search, &ret_prot, &ret_ts, &ret_index);
+        slaw_free (search);
+        send_pret = pool_net_send_result (net, "ptir", ret_prot, ret_ts,
+                                          ret_index, pret);
+        protein_free (ret_prot);
+        break;
+      case POOL_CMD_NEWEST_INDEX:
+        set_my_name ("NEWEST_INDEX");
+        ob_log (OBLV_DBUG, 0x2010900e, "%s: newest index\n", poolName);
+        // No need to unpack the op - we already know everything - but
+        // do need to free it (do this after we reply for efficiency).
+        pret = pool_newest_index (ph, &ret_index);
+        send_pret = pool_net_send_result (net, "ir", ret_index, pret);
+        protein_free (op_protein);
+        break;
+      case POOL_CMD_OLDEST_INDEX:
+        set_my_name ("OLDEST_INDEX");
+        ob_log (OBLV_DBUG, 0x2010900f, "%s: oldest index\n", poolName);
+        pret = pool_oldest_index (ph, &ret_index);
+        send_pret = pool_net_send_result (net, "ir", ret_index, pret);
+        protein_free (op_protein);
+        break;
+      case POOL_CMD_INDEX_LOOKUP:
+        set_my_name ("INDEX_LOOKUP");
+        ob_log (OBLV_DBUG, 0x20109010, "%s: index lookup\n", poolName);
+        {
+          int64 cmp = -1;
+          int64 rel = 0;
+          pret = pool_net_unpack_op_f (op_protein, net->net_version, "tii",
+                                       &ret_ts, &rel, &cmp);
+          if (pret < OB_OK)
+            ob_nop ();  // do nothing and reply with bad pret below
+          else if (cmp < OB_CLOSEST || cmp > OB_CLOSEST_HIGHER)
+            pret = POOL_UNSUPPORTED_OPERATION;
+          else
+            {
+              if (rel < 0)
+                pret = pool_seekto_time (ph, ret_ts, (time_comparison) cmp);
+              else
+                {
+                  pret = pool_seekto (ph, rel);
+                  if (OB_OK == pret)
+                    pret =
+                      pool_seekby_time (ph, ret_ts, (time_comparison) cmp);
+                }
+              if (OB_OK == pret)
+                pret = pool_index (ph, &ret_index);
+            }
+          send_pret = pool_net_send_result (net, "ir", ret_index, pret);
+        }
+        break;
+      case POOL_CMD_AWAIT_NEXT_SINGLE:
+        set_my_name ("AWAIT_NEXT_SINGLE");
+        ob_log (OBLV_DBUG, 0x20109011, "%s: await next\n", poolName);
+        pret = pool_net_unpack_op_f (op_protein, net->net_version, "t",
+                                     &timeout);
+        if (pret >= OB_OK)
+          {
+            pool_net_adjust_timeout_value_for_version (&timeout,
+                                                       net->net_version);
+            pret =
+              pool_await_next (ph, timeout, &ret_prot, &ret_ts, &ret_index);
+          }
+        send_pret = pool_net_send_result (net, "rpti", pret, ret_prot,
+                                          ret_ts, ret_index);
+        protein_free (ret_prot);
+        break;
+      case POOL_CMD_MULTI_ADD_AWAITER:
+        set_my_name ("MULTI_ADD_AWAITER");
+        ob_log (OBLV_DBUG, 0x20109012, "%s: add_awaiter\n", poolName);
+#ifdef POOL_TCP_WORKERS
+        if (st->conn)
+          {
+            protein_free (op_protein);
+            pret = pool_index (ph, &idx);
+            status = conn_park (st, op_num, (pret < OB_OK ? 0 : idx), NULL);
+            break;
+          }
+#endif
+        pret = pool_net_server_await (ph, net, POOL_WAIT_FOREVER, &ret_prot,
+                                      &ret_ts, &ret_index);
+        send_pret = pool_net_send_result (net, "rpti", pret, ret_prot,
+                                          ret_ts, ret_index);
+        protein_free (ret_prot);
+        protein_free (op_protein);
+        break;
+      case POOL_CMD_FANCY_ADD_AWAITER:
+        set_my_name ("FANCY_ADD_AWAITER");
+        pret = pool_net_unpack_op_f (op_protein, net->net_version, "ix",
+                                     &idx, &search);
+        ob_log (OBLV_DBUG, 0x2010902b,
+                "%s: fancy_add_awaiter (%" OB_FMT_64 "d)\n", poolName, idx);
+        if (pret < OB_OK)
+          send_pret = pool_net_send_op (net, POOL_CMD_FANCY_RESULT_1, "rti",
+                                        pret, ret_ts, ret_index);
+        else
+          {
+            int64 newest = -1;
+            pool_seekto (ph, idx);
+            // _pool_net_unpack_op() converts nil to NULL, which IMO is a
+            // terrible idea (bug 480), but to be safest I'll just check
+            // for either one.
+            bool unconditional = (!search || slaw_is_nil (search));
+            pret = pool_newest_index (ph, &newest);
+            if (pret < OB_OK)
+              newest = idx;
+            if (unconditional)
+              pret = pool_next (ph, &ret_prot, &ret_ts, &ret_index);
+            else
+              pret = pool_probe_frwd (ph, search, &ret_prot, &ret_ts,
+                                      &ret_index);
+            send_pret = pool_net_send_op (net, POOL_CMD_FANCY_RESULT_1,
+                                          "rti", pret, ret_ts, ret_index);
+            OB_LOG_DEBUG_CODE (0x20109041, "POOL_CMD_FANCY_RESULT_1 (%s, "
+                                           "%f, %" OB_FMT_64 "d)\n",
+                               ob_error_string (pret), ret_ts, ret_index);
+            if (pret >= OB_OK && send_pret >= OB_OK)
+              {
+                send_pret =
+                  pool_net_send_op (net, POOL_CMD_FANCY_RESULT_3, "tip",
+                                    ret_ts, ret_index, ret_prot);
+                OB_LOG_DEBUG_CODE (0x20109042, "POOL_CMD_FANCY_RESULT_3 "
+                                               "(%f, %" OB_FMT_64 "d)\n",
+                                   ret_ts, ret_index);
+                protein_free (ret_prot);
+              }
+            else if (pret == POOL_NO_SUCH_PROTEIN && send_pret >= OB_OK)
+              {
+                int64 (*func) (bslaw s, bslaw surch);
+                int64 thingy;
+                func = (unconditional ? always_return_0 : protein_search);
+                pool_seekto (ph, (thingy = (idx > newest ? idx : newest)));
+                OB_LOG_DEBUG_CODE (0x20109045,
+                                   "set index to %" OB_FMT_64 "d\n",
+                                   thingy);
+#ifdef POOL_TCP_WORKERS
+                if (st->conn)
+                  {
+                    // Rather than tie up a worker thread, wait for a
+                    // deposit (or the next command) from the reactor.
+                    if (unconditional)
+                      Free_Slaw (search);
+                    status = conn_park (st, op_num, thingy, search);
+                    search = NULL;
+                    break;
+                  }
+#endif
+                do
+                  {
+                    protein_free (ret_prot);
+                    OB_LOG_DEBUG_CODE (0x2010903b, "starting await\n");
+                    pret =
+                      pool_net_server_await (ph, net, POOL_WAIT_FOREVER,
+                                             &ret_prot, &ret_ts,
+                                             &ret_index);
+                    OB_LOG_DEBUG_CODE (0x2010903c, "finished await\n");
+                  }
+                while (pret == OB_OK && func (ret_prot, search) < 0);
+                send_pret =
+                  pool_net_send_op (net, POOL_CMD_FANCY_RESULT_2, "rti",
+                                    pret, ret_ts, ret_index);
+                OB_LOG_DEBUG_CODE (0x20109043,
+                                   "POOL_CMD_FANCY_RESULT_2 (%s, %f, "
+                                   "%" OB_FMT_64 "d)\n",
+                                   ob_error_string (pret), ret_ts,
+                                   ret_index);
+                if (pret >= OB_OK && send_pret >= OB_OK)
+                  {
+                    send_pret =
+                      pool_net_send_op (net, POOL_CMD_FANCY_RESULT_3, "tip",
+                                        ret_ts, ret_index, ret_prot);
+                    OB_LOG_DEBUG_CODE (0x20109044,
+                                       "POOL_CMD_FANCY_RESULT_3 (%f, "
+                                       "%" OB_FMT_64 "d)\n",
+                                       ret_ts, ret_index);
+                  }
+                protein_free (ret_prot);
+              }
+          }
+        Free_Slaw (search);
+        break;
+      case POOL_CMD_WITHDRAW:
+        set_my_name ("WITHDRAW");
+        ob_log (OBLV_DBUG, 0x20109013, "%s: withdraw\n", poolName);
+        protein_free (op_protein);
+        status = TEND_FINISHED;
+        break;
+      case POOL_CMD_INFO:
+        set_my_name ("INFO");
+        {
+          int64 hops;
+          ob_log (OBLV_DBUG, 0x20109014, "%s: info\n", poolName);
+          pret =
+            pool_net_unpack_op_f (op_protein, net->net_version, "i", &hops);
+          if (pret == OB_OK)
+            pret = pool_get_info (ph, hops, &ret_prot);
+          send_pret = pool_net_send_result (net, "rp", pret, ret_prot);
+          protein_free (ret_prot);
+          break;
+        }
+      case POOL_CMD_SUB_FETCH:
+        set_my_name ("SUB_FETCH");
+        ob_log (OBLV_DBUG, 0x20109040, "%s: sub fetch\n", poolName);
+        {
+          slaw s = NULL;
+          pret =
+            pool_net_unpack_op_f (op_protein, net->net_version, "x", &s);
+          int64 oldest = pret, newest = pret, nops;
+          if (pret >= OB_OK && (nops = slaw_list_count (s)) >= 0)
+            {
+              pool_fetch_op *ops =
+                (pool_fetch_op *) calloc (nops, sizeof (pool_fetch_op));
+              convert_slaw_to_fetch_ops (s, ops, nops);
+              Free_Slaw (s);
+              pool_fetch (ph, ops, nops, &oldest, &newest);
+              s = convert_fetch_ops_to_slaw (ops, nops);
+              Free_Ptr (ops);
+            }
+          else
+            {
+              ob_err_accum (&oldest, OB_UNKNOWN_ERR);
+              ob_err_accum (&newest, OB_UNKNOWN_ERR);
+            }
+          send_pret = pool_net_send_result (net, "xii", s, oldest, newest);
+          Free_Slaw (s);
+        }
+        break;
+      case POOL_CMD_SUB_FETCH_EX:
+        set_my_name ("SUB_FETCH_EX");
+        ob_log (OBLV_DBUG, 0x20109060, "%s: sub fetch ex\n", poolName);
+        {
+          slaw s = NULL;
+          int64 clamp64;
+          pret = pool_net_unpack_op_f (op_protein, net->net_version, "xi",
+                                       &s, &clamp64);
+          int64 oldest = pret, newest = pret, nops;
+          if (pret >= OB_OK && (nops = slaw_list_count (s)) >= 0)
+            {
+              pool_fetch_op *ops =
+                (pool_fetch_op *) calloc (nops, sizeof (pool_fetch_op));
+              convert_slaw_to_fetch_ops (s, ops, nops);
+              Free_Slaw (s);
+              bool clamp = (clamp64 != 0);
+              pool_fetch_ex (ph, ops, nops, &oldest, &newest, clamp);
+              s = convert_fetch_ops_to_slaw (ops, nops);
+              Free_Ptr (ops);
+            }
+          else
+            {
+              ob_err_accum (&oldest, OB_UNKNOWN_ERR);
+              ob_err_accum (&newest, OB_UNKNOWN_ERR);
+            }
+          send_pret = pool_net_send_result (net, "xii", s, oldest, newest);
+          Free_Slaw (s);
+        }
+        break;
+      case POOL_CMD_ADVANCE_OLDEST:
+        set_my_name ("ADVANCE_OLDEST");
+        OB_LOG_DEBUG_CODE (0x20109054, "%s: advance oldest\n", poolName);
+        pret =
+          pool_net_unpack_op_f (op_protein, net->net_version, "i", &idx);
+        if (pret >= OB_OK)
+          pret = pool_advance_oldest (ph, idx);
+        send_pret = pool_net_send_result (net, "r", pret);
+        break;
+      case POOL_CMD_CHANGE_OPTIONS:
+        {
+          protein opts = NULL;
+          set_my_name ("CHANGE_OPTIONS");
+          OB_LOG_DEBUG_CODE (0x20109056, "%s: change_options\n", poolName);
+          pret =
+            pool_net_unpack_op_f (op_protein, net->net_version, "p", &opts);
+          if (pret >= OB_OK)
+            pret = pool_change_options (ph, opts);
+          send_pret = pool_net_send_result (net, "r", pret);
+          Free_Protein (opts);
+        }
+        break;
+      default:
+        // Unknown command.  We can't send a result because we don't
+        // know what the remote end is expecting, so close the
+        // connection - it'll get the message across.
+        OB_LOG_ERROR_CODE (0x2010902a, "Unknown command %d\n", op_num);
+        protein_free (op_protein);
+        return TEND_FINISHED;
+    }
+
+  if (send_pret != OB_OK)
+    {
+      ob_log (OBLV_DBUG, 0x20109015, "%s: send_pret %s\n", poolName,
+              ob_error_string (send_pret));
+      return TEND_FINISHED;
+    }
+  return status;
+}
+
+/// Withdraw from the pool once the client is done with it, or has
+/// gone away.
+static void tend_hang_up (tend_state *st)
+{
+  print_op_stats (st->remote_hname ? st->remote_hname : st->poolName,
+                  st->remote_process ? st->remote_process : st->remote_host,
+                  st->op_count);
+
+  // At this point, only withdraw is allowed in normal operation.  A
+  // connection ending without a withdraw happens in particular if a
+  // process forgets to withdraw from a pool or is killed before it
+  // can withdraw.
+  if (st->op_num != POOL_CMD_WITHDRAW)
+    ob_log (OBLV_DBUG, 0x20109016, "Connection didn't end with a withdraw!\n");
+  ob_retort pret = tend_release_hose (st);
+  // Only send the result if the remote end is expecting it
+  if (st->op_num == POOL_CMD_WITHDRAW)
+    ob_ignore_retort (pool_net_send_result (st->net, "r", pret));
+  // Terminate the connection by returning from the function
+  ob_log (OBLV_DBUG, 0x20109017, "%s: exiting\n", st->poolName);
+}
+
+/// Process commands from one client until the connection ends.
+static void tend_serve (tend_state *st)
+{
+  pool_net_data *net = st->net;
+
+  ob_log (OBLV_DBUG, 0x20109000, "reading first command\n");
+
+  tend_status status;
+  while ((status = tend_first_command (st)) == TEND_CONTINUE
+         && !st->participating)
+    ;
+
+  // Now that we have a connection and a valid pool struct, handle
+  // on-going commands.
+  while (status == TEND_CONTINUE)
+    {
+      int op_num;
+      protein op_protein;
+      OB_LOG_DEBUG_CODE (0x2010903d, "waiting - %s\n",
+                         slaw_string_emit (st->hose_name));
+      set_my_name (slaw_string_emit (st->hose_name));
+      ob_retort recv_pret = pool_net_recv_op (net, &op_num, &op_protein);
+      if (recv_pret != OB_OK)
+        {
+          const int erryes = errno;
+          tend_release_hose (st);
+          tend_badness (st, "pool_net_recv_op", recv_pret, erryes, __FILE__,
+                        __LINE__);
+          break;
+        }
+      status = tend_command (st, op_num, op_protein);
+      if (status != TEND_CONTINUE)
+        tend_hang_up (st);
+    }
+}
+
+static void tend_pool_hose (pool_net_data *net, const char *remote_host)
+{
+  tend_state st;
+  tend_state_init (&st, net, remote_host);
+  tend_serve (&st);
+  tend_state_cleanup (&st);
+}
+
+/* Little wrapper function to ensure cleanup, since a connection
+ * can end in many different ways. */
+static void tend_pool_hose_tls (pool_net_data net, const char *remote_host)
+{
+  tend_pool_hose (&net, remote_host);
+#ifndef _MSC_VER
+  ob_tls_end (net.connfd, true);
+  OB_CHECK_POSIX_CODE (0x20109048, close (net.connfd));
+#endif
+  if (net.tls_thread)
+    // XXX: assumes 0 is not a valid pthread_t (which is true on Linux
+    // and OS X, but may not be true in the general case)
+    OB_DIE_ON_ERROR (ob_tls_server_join_thread (net.tls_thread));
+}
+
+#ifdef POOL_TCP_WORKERS
+
+/* Serving connections from worker threads (-w)
+ *
+ * Instead of forking a process per connection, a fixed number of
+ * worker threads share one epoll set containing every client
+ * socket.  Everything is registered with EPOLLONESHOT, so exactly one
+ * worker handles any given event; it reads whatever the client has
+ * sent, without waiting for more, into the connection's own buffer.
+ * Once a whole command is there, it processes it (and any others
+ * right behind it), then re-arms the socket.  So a client that stops
+ * partway through a command just leaves its buffer half full, rather
+ * than holding up a worker.  Replies are still sent as they're made,
+ * but a client that stops reading them for WORKER_SEND_TIMEOUT
+ * seconds gets hung up on.
+ *
+ * Hoses are shared, too: connections to the same pool check a hose
+ * out of that pool's cache entry for the duration of each command
+ * (after seeking it to the connection's own index), so the number of
+ * open hoses depends on the number of workers rather than on the
+ * number of clients.
+ *
+ * Awaits don't tie up a worker.  Instead, the connection is "parked"
+ * on its pool's cache entry, and a single notification fifo per pool
+ * (also in the epoll set) tells us when to check the parked
+ * connections for proteins.  As with pool_net_server_await(), any
+ * command from the client ends its await.
+ *
+ * POOL_CMD_AWAIT_NEXT_SINGLE still blocks a worker for the duration
+ * of the await, but we advertise POOL_CMD_FANCY_ADD_AWAITER, so only
+ * ancient clients send it.
+ *
+ * A connection that starts TLS leaves the workers altogether, for a
+ * thread of its own (see conn_tls_main()).
+ */
+
+typedef enum
+{
+  WATCH_SOCKET,
+  WATCH_POOL
+} watch_kind;
+
+/// What an epoll event refers to: a tcp_conn or a hose_cache_entry.
+typedef struct watch
+{
+  watch_kind kind;
+  void *owner;
+} watch;
+
+typedef enum
+{
+  CONN_IDLE,     ///< socket armed, waiting for the next command
+  CONN_BUSY,     ///< a worker is processing a command
+  CONN_PARKED,   ///< awaiting a deposit, socket armed
+  CONN_CHECKING  ///< a worker is checking whether the await is over
+} conn_state;
+
+typedef struct hose_cache_entry hose_cache_entry;
+
+/// How long a worker waits for a client to make any room at all for
+/// (more of) a reply, before hanging up on it
+#define WORKER_SEND_TIMEOUT 15
+
+struct tcp_conn
+{
+  tend_state st;
+  pool_net_data net;
+  ob_handle_t no_wakeup;
+  char remote_host[1024];
+  watch sock_watch;
+  // What we've read from the socket: in_pos bytes of it processed,
+  // in_len bytes in all, room for in_cap.  in_gone says the client
+  // hung up after that (with in_errno saying why, if it wasn't EOF).
+  byte *in;
+  size_t in_pos;
+  size_t in_len;
+  size_t in_cap;
+  bool in_gone;
+  int in_errno;
+  // The pool we participate in, and our index in it
+  hose_cache_entry *entry;
+  int64 index;
+  // Once we participate, the following are protected by entry->mutex
+  conn_state state;
+  // The socket became readable while another worker owned us
+  bool socket_fired;
+  int await_op;
+  int64 await_idx;
+  slaw await_search;
+  tcp_conn *next_awaiter;
+};
+
+struct hose_cache_entry
+{
+  pthread_mutex_t mutex;
+  char *name;
+  // Number of connections participating in this pool
+  int users;
+  // Hoses not currently checked out by any worker
+  pool_hose *idle;
+  int nidle;
+  // Watches the pool for deposits on behalf of parked connections
+  pool_hose notifier;
+  watch notify_watch;
+  tcp_conn *awaiters;
+  hose_cache_entry *next;
+};
+
+static int epoll_fd = -1;
+
+// The connection each worker is serving, for conn_recv_nbytes()
+static pthread_key_t serving_key;
+
+// Protects the list of entries (but not the entries themselves)
+static pthread_mutex_t hose_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static hose_cache_entry *hose_cache;
+
+static bool watch_fd (int fd, watch *w, int op)
+{
+  struct epoll_event ev;
+  OB_CLEAR (ev);
+  ev.events = EPOLLIN | EPOLLONESHOT;
+  ev.data.ptr = w;
+  if (epoll_ctl (epoll_fd, op, fd, &ev) == 0)
+    return true;
+  OB_PERROR_CODE (0x20109067, "epoll_ctl");
+  return false;
+}
+
+/// Returns the cache entry for the named pool, making it if need be.
+/// Entries live as long as the server does, because an epoll event
+/// might still refer to one after its last user has left; it's only
+/// their hoses that get released.
+static hose_cache_entry *hose_cache_find (const char *name)
+{
+  hose_cache_entry *e;
+  pthread_mutex_lock (&hose_cache_mutex);
+  for (e = hose_cache; e; e = e->next)
+    if (strcmp (e->name, name) == 0)
+      break;
+  if (!e && (e = (hose_cache_entry *) calloc (1, sizeof (*e))))
+    {
+      e->name = strdup (name);
+      e->idle = (pool_hose *) calloc (num_workers, sizeof (pool_hose));
+      if (!e->name || !e->idle)
+        {
+          Free_Ptr (e->name);
+          Free_Ptr (e->idle);
+          Free_Ptr (e);
+        }
+      else
+        {
+          pthread_mutex_init (&e->mutex, NULL);
+          e->notify_watch.kind = WATCH_POOL;
+          e->notify_watch.owner = e;
+          e->next = hose_cache;
+          hose_cache = e;
+        }
+    }
+  pthread_mutex_unlock (&hose_cache_mutex);
+  return e;
+}
+
+static ob_retort hose_cache_checkout (hose_cache_entry *e, pool_hose *ph)
+{
+  pthread_mutex_lock (&e->mutex);
+  if (e->nidle > 0)
+    {
+      *ph = e->idle[--e->nidle];
+      pthread_mutex_unlock (&e->mutex);
+      return OB_OK;
+    }
+  pthread_mutex_unlock (&e->mutex);
+  return pool_participate (e->name, ph, NULL);
+}
+
+static void hose_cache_checkin (hose_cache_entry *e, pool_hose ph)
+{
+  pthread_mutex_lock (&e->mutex);
+  if (e->users > 0 && e->nidle < num_workers)
+    {
+      e->idle[e->nidle++] = ph;
+      ph = NULL;
+    }
+  pthread_mutex_unlock (&e->mutex);
+  if (ph)
+    ob_ignore_retort (pool_withdraw (ph));
+}
+
+/// The index a freshly participated hose would start at.
+static int64 fresh_index (pool_hose ph)
+{
+  int64 newest;
+  if (pool_newest_index (ph, &newest) == OB_OK)
+    return newest + 1;
+  return 0;
+}
+
+/// The worker thread version of pool_participate() and
+/// pool_participate_creatingly().
+static ob_retort hose_cache_join (tend_state *st, const char *type,
+                                  bprotein create_options)
+{
+  tcp_conn *c = st->conn;
+  hose_cache_entry *e = hose_cache_find (st->poolName);
+  if (!e)
+    return OB_NO_MEM;
+
+  ob_retort pret = OB_OK;
+  pool_hose ph = NULL;
+  pthread_mutex_lock (&e->mutex);
+  if (e->users == 0)
+    {
+      // Nobody is using this pool yet, so this is where it really gets
+      // opened (or created), and the result is exactly what the
+      // client would have gotten from a forked server.
+      if (type)
+        pret =
+          pool_participate_creatingly (e->name, type, &ph, create_options);
+      else
+        pret = pool_participate (e->name, &ph, NULL);
+      if (pret == OB_OK || pret == POOL_CREATED)
+        {
+          pool_index (ph, &c->index);
+          e->idle[e->nidle++] = ph;
+        }
+    }
+  if (pret == OB_OK || pret == POOL_CREATED)
+    {
+      e->users++;
+      c->entry = e;
+      c->state = CONN_BUSY;
+    }
+  pthread_mutex_unlock (&e->mutex);
+
+  if (c->entry && !ph)
+    {
+      ob_retort tort = hose_cache_checkout (e, &ph);
+      if (tort < OB_OK)
+        {
+          hose_cache_leave (st);
+          return tort;
+        }
+      c->index = fresh_index (ph);
+      hose_cache_checkin (e, ph);
+    }
+  return pret;
+}
+
+/// The worker thread version of pool_withdraw().  The pool's hoses
+/// are withdrawn when its last connection leaves.
+static ob_retort hose_cache_leave (tend_state *st)
+{
+  tcp_conn *c = st->conn;
+  hose_cache_entry *e = c->entry;
+  ob_retort pret = OB_OK;
+  if (!e)
+    return pret;
+  c->entry = NULL;
+
+  pthread_mutex_lock (&e->mutex);
+  if (--e->users == 0)
+    {
+      while (e->nidle > 0)
+        ob_err_accum (&pret, pool_withdraw (e->idle[--e->nidle]));
+      if (e->notifier)
+        ob_err_accum (&pret, pool_withdraw (e->notifier));
+      e->notifier = NULL;
+    }
+  pthread_mutex_unlock (&e->mutex);
+  return pret;
+}
+
+/// Makes sure somebody is watching e's pool for deposits.  Called
+/// with e->mutex held.
+static ob_retort hose_cache_watch_deposits (hose_cache_entry *e)
+{
+  if (e->notifier)
+    return OB_OK;
+
+  pool_hose ph = NULL;
+  ob_handle_t fd;
+  ob_retort pret = pool_participate (e->name, &ph, NULL);
+  if (pret >= OB_OK)
+    pret = pool_net_server_notifier_arm (ph, &fd);
+  if (pret >= OB_OK && !watch_fd (fd, &e->notify_watch, EPOLL_CTL_ADD))
+    pret = POOL_FIFO_BADTH;
+  if (pret < OB_OK)
+    {
+      if (ph)
+        ob_ignore_retort (pool_withdraw (ph));
+      return pret;
+    }
+  e->notifier = ph;
+  return OB_OK;
+}
+
+/// Puts the socket back in the epoll set, so we hear about the
+/// client's next command.
+static void conn_rearm (tcp_conn *c)
+{
+  watch_fd (c->net.connfd, &c->sock_watch, EPOLL_CTL_MOD);
+}
+
+/// Marks the connection as waiting for its next command.  If the
+/// socket is still armed from an await, it only needs re-arming if
+/// it fired in the meantime.
+static void conn_idle (tcp_conn *c, bool armed)
+{
+  hose_cache_entry *e = c->entry;
+  if (!e)
+    {
+      conn_rearm (c);
+      return;
+    }
+  // Once the socket is armed, another worker can take over (and even
+  // free) the connection, so do it under the lock.
+  pthread_mutex_lock (&e->mutex);
+  c->state = CONN_IDLE;
+  if (!armed || c->socket_fired)
+    conn_rearm (c);
+  c->socket_fired = false;
+  pthread_mutex_unlock (&e->mutex);
+}
+
+static void conn_close (tcp_conn *c)
+{
+  tend_state_cleanup (&c->st);
+  Free_Slaw (c->await_search);
+  ob_tls_end (c->net.connfd, true);
+  OB_CHECK_POSIX_CODE (0x20109069, close (c->net.connfd));
+  if (c->net.tls_thread)
+    OB_DIE_ON_ERROR (ob_tls_server_join_thread (c->net.tls_thread));
+  free (c->in);
+  free (c);
+}
+
+/// The worker version of pool_tcp_recv_nbytes(), which hands out what
+/// conn_read() has already read, so pool_net_recv_op() never waits.
+static ob_retort conn_recv_nbytes (ob_sock_t fd, void *buf, size_t len,
+                                   OB_UNUSED ob_handle_t wake_event)
+{
+  tcp_conn *c = (tcp_conn *) pthread_getspecific (serving_key);
+  if (!c || c->net.connfd != fd)
+    OB_FATAL_BUG_CODE (0x20109076, "not serving fd %d\n", (int) fd);
+  if (c->in_len - c->in_pos < len)
+    {
+      errno = c->in_errno;
+      return (c->in_gone ? POOL_UNEXPECTED_CLOSE : POOL_PROTOCOL_ERROR);
+    }
+  memcpy (buf, c->in + c->in_pos, len);
+  c->in_pos += len;
+  return OB_OK;
+}
+
+/// How long the command at the front of c's buffer is, or 0 if we
+/// can't tell yet.
+static ob_retort conn_op_len (const tcp_conn *c, unt64 *len)
+{
+  return pool_net_op_len (&c->net, c->in + c->in_pos, c->in_len - c->in_pos,
+                          len);
+}
+
+/// Whether c's client has sent anything we haven't dealt with: a whole
+/// command, something that isn't one, or a hangup.
+static bool conn_has_input (const tcp_conn *c)
+{
+  unt64 len = 0;
+  if (c->in_gone || conn_op_len (c, &len) < OB_OK)
+    return true;
+  return (len > 0 && len <= c->in_len - c->in_pos);
+}
+
+/// Reads what the client has sent, without waiting for any more, until
+/// there's a whole command in c's buffer.  Returns an error if what's
+/// there can't be a command, and otherwise stores the command's length
+/// in len, or 0 if it isn't all there yet.
+static ob_retort conn_read (tcp_conn *c, unt64 *len)
+{
+  for (;;)
+    {
+      ob_retort pret = conn_op_len (c, len);
+      if (pret < OB_OK)
+        return pret;
+      const size_t have = c->in_len - c->in_pos;
+      if (*len > 0 && *len <= have)
+        return OB_OK;
+      *len = 0;
+      if (c->in_gone)
+        return OB_OK;
+      if (have == 0 && c->in_cap > 65536)
+        {
+          // Don't keep a big buffer around for an idle connection
+          Free_Ptr (c->in);
+          c->in_pos = c->in_len = c->in_cap = 0;
+        }
+      if (c->in_pos > 0)
+        {
+          memmove (c->in, c->in + c->in_pos, have);
+          c->in_pos = 0;
+          c->in_len = have;
+        }
+      if (c->in_len == c->in_cap)
+        {
+          // Grow as the command arrives, rather than taking the
+          // client's word for how big it's going to be
+          size_t cap = (c->in_cap < 4096 ? 4096 : 2 * c->in_cap);
+          byte *in = (byte *) realloc (c->in, cap);
+          if (!in)
+            return OB_NO_MEM;
+          c->in = in;
+          c->in_cap = cap;
+        }
+      const ssize_t got = recv (c->net.connfd, c->in + c->in_len,
+                                c->in_cap - c->in_len, MSG_DONTWAIT);
+      if (got > 0)
+        c->in_len += got;
+      else if (got < 0 && errno == EINTR)
+        continue;
+      else if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return OB_OK;
+      else
+        {
+          c->in_gone = true;
+          c->in_errno = (got < 0 ? errno : 0);
+        }
+    }
+}
+
+/// Looks for a protein that satisfies c's await, using ph.
+static ob_retort conn_check_await (tcp_conn *c, pool_hose ph, protein *p,
+                                   pool_timestamp *ts, int64 *idx)
+{
+  ob_retort pret;
+  pool_seekto (ph, c->await_idx);
+  while ((pret = pool_next (ph, p, ts, idx)) == OB_OK)
+    {
+      c->await_idx = *idx + 1;
+      if (!c->await_search || protein_search (*p, c->await_search) >= 0)
+        break;
+      Free_Protein (*p);
+    }
+  return pret;
+}
+
+/// Sends the client the reply it expects at the end of an await,
+/// and forgets about the await.
+static ob_retort conn_end_await (tcp_conn *c, ob_retort pret, protein p,
+                                 pool_timestamp ts, int64 idx)
+{
+  pool_net_data *net = &c->net;
+  ob_retort send_pret;
+
+  if (pret != OB_OK)
+    {
+      // the client expects these when there's no protein
+      p = NULL;
+      ts = 0;
+      idx = 0;
+    }
+  if (c->await_op == POOL_CMD_MULTI_ADD_AWAITER)
+    send_pret = pool_net_send_result (net, "rpti", pret, p, ts, idx);
+  else
+    {
+      send_pret =
+        pool_net_send_op (net, POOL_CMD_FANCY_RESULT_2, "rti", pret, ts, idx);
+      OB_LOG_DEBUG_CODE (0x2010906a, "POOL_CMD_FANCY_RESULT_2 (%s, %f, "
+                                     "%" OB_FMT_64 "d)\n",
+                         ob_error_string (pret), ts, idx);
+      if (pret >= OB_OK && send_pret >= OB_OK)
+        send_pret =
+          pool_net_send_op (net, POOL_CMD_FANCY_RESULT_3, "tip", ts, idx, p);
+    }
+  c->index = c->await_idx;
+  c->await_op = -1;
+  Free_Slaw (c->await_search);
+  return send_pret;
+}
+
+/// Called by tend_command() instead of blocking in an await.  The
+/// hose st->ph is checked out, and positioned at the caller's index.
+static tend_status conn_park (tend_state *st, int op_num, int64 idx,
+                              slaw search)
+{
+  tcp_conn *c = st->conn;
+  hose_cache_entry *e = c->entry;
+  protein p = NULL;
+  pool_timestamp ts = 0;
+  int64 found = 0;
+
+  c->await_op = op_num;
+  c->await_idx = idx;
+  c->await_search = search;
+
+  // Checking for a protein and parking happen under the same lock as
+  // draining the notification fifo does, so a deposit can't slip in
+  // between them unnoticed.
+  pthread_mutex_lock (&e->mutex);
+  ob_retort pret = hose_cache_watch_deposits (e);
+  if (pret >= OB_OK)
+    pret = conn_check_await (c, st->ph, &p, &ts, &found);
+  // If the next command is already here, the socket won't tell us
+  // about it, so the await ends before it starts.
+  if (pret == POOL_NO_SUCH_PROTEIN && !conn_has_input (c))
+    {
+      OB_LOG_DEBUG_CODE (0x2010906b, "%s: parked at %" OB_FMT_64 "d\n",
+                         st->poolName, c->await_idx);
+      c->state = CONN_PARKED;
+      c->next_awaiter = e->awaiters;
+      e->awaiters = c;
+      // We're about to give up the connection, so give back its hose
+      // now, too (without dropping the lock).
+      pool_hose ph = st->ph;
+      st->ph = NULL;
+      if (e->nidle < num_workers)
+        {
+          e->idle[e->nidle++] = ph;
+          ph = NULL;
+        }
+      // Any command from the client ends the await
+      conn_rearm (c);
+      pthread_mutex_unlock (&e->mutex);
+      if (ph)
+        ob_ignore_retort (pool_withdraw (ph));
+      return TEND_PARKED;
+    }
+  pthread_mutex_unlock (&e->mutex);
+
+  ob_retort send_pret = conn_end_await (c, pret, p, ts, found);
+  Free_Protein (p);
+  return (send_pret < OB_OK ? TEND_FINISHED : TEND_CONTINUE);
+}
+
+/// A TLS connection's own thread, from the handshake on.  The
+/// handshake can take as long as the client likes, and decrypted data
+/// can be waiting inside OpenSSL when epoll says the socket has
+/// nothing to read, so the connection is served the way a forked
+/// child would serve it, with hoses of its own.
+static void *conn_tls_main (void *arg)
+{
+  tcp_conn *c = (tcp_conn *) arg;
+  if (tend_start_tls (&c->st) == TEND_CONTINUE)
+    tend_serve (&c->st);
+  conn_close (c);
+  return NULL;
+}
+
+/// Takes c away from the workers for good.  Its socket isn't armed,
+/// so no worker will hear from it again.
+static void conn_go_solo (tcp_conn *c)
+{
+  if (c->in_len > c->in_pos)
+    {
+      // The client started the handshake before hearing it could, and
+      // we've already read some of it
+      tend_badness (&c->st, "STARTTLS", POOL_PROTOCOL_ERROR, 0, __FILE__,
+                    __LINE__);
+      conn_close (c);
       return;
     }
+  // It's only holding up itself now, as a forked server would
+  struct timeval forever;
+  OB_CLEAR (forever);
+  if (setsockopt (c->net.connfd, SOL_SOCKET, SO_SNDTIMEO, &forever,
+                  sizeof (forever))
+      != 0)
+    OB_PERROR_CODE (0x20109077, "setsockopt");
+  c->st.conn = NULL;
+  pthread_t thr;
+  const int err = pthread_create (&thr, NULL, conn_tls_main, c);
+  if (err != 0)
+    {
+      OB_LOG_ERROR_CODE (0x20109075, "pthread_create: %s\n", strerror (err));
+      conn_close (c);
+      return;
+    }
+  pthread_detach (thr);
+}
+
+/// Processes the command at the front of c's buffer.
+static tend_status conn_serve_one (tcp_conn *c)
+{
+  tend_state *st = &c->st;
+  tend_status status;
+
+  if (!st->participating)
+    return tend_first_command (st);
 
-  if (op_num == POOL_CMD_LIST_EX)
+  int op_num;
+  protein op_protein;
+  set_my_name (slaw_string_emit (st->hose_name));
+  ob_retort pret = pool_net_recv_op (&c->net, &op_num, &op_protein);
+  const int erryes = errno;
+  if (pret >= OB_OK)
     {
-      slaw lst = NULL;
-      pret =
-        pool_net_unpack_op_f (op_protein, net->net_version, "s", &poolName);
+      pret = hose_cache_checkout (c->entry, &st->ph);
       if (pret < OB_OK)
-        SUPREME_BADNESS ("POOL_CMD_LIST_EX: pool_net_unpack_op", pret, errno);
-      OB_LOG_DEBUG_CODE (0x2010905d, "%s: list_ex\n", poolName);
-      pret = pool_list_ex (poolName, &lst);
-      send_pret = pool_net_send_result (net, "rx", pret, lst);
-      int e = errno;
-      slaw_free (lst);
-      if (send_pret != OB_OK)
-        SUPREME_BADNESS ("POOL_CMD_LIST_EX: pool_net_send_result", send_pret,
-                         e);
-      Free_Ptr (poolName);
-      return;
+        protein_free (op_protein);
+    }
+  if (pret < OB_OK)
+    {
+      tend_release_hose (st);
+      return tend_badness (st, "pool_net_recv_op", pret, erryes, __FILE__,
+                           __LINE__);
     }
+  pool_seekto (st->ph, c->index);
+  status = tend_command (st, op_num, op_protein);
+  // Once parked, the connection may already belong to another
+  // worker, which will take it from here.
+  if (status == TEND_PARKED)
+    return status;
+  pool_index (st->ph, &c->index);
+  hose_cache_checkin (c->entry, st->ph);
+  st->ph = NULL;
+  if (status == TEND_FINISHED)
+    tend_hang_up (st);
+  return status;
+}
 
-  // Everything from here on out starts a connection and goes into the
-  // command processing loop.
-  if (op_num == POOL_CMD_PARTICIPATE)
+/// Reads what the client has sent, and processes every whole command
+/// in it.  The caller owns the connection.
+static void conn_serve (tcp_conn *c)
+{
+  tend_state *st = &c->st;
+  tend_status status = TEND_CONTINUE;
+
+  pthread_setspecific (serving_key, c);
+  while (status == TEND_CONTINUE)
     {
-      // Starting a new connection!  How fun!
-      pret = pool_net_unpack_op_f (op_protein, net->net_version, "sp",
-                                   &poolName, &participate_options);
-      if (pret != OB_OK)
-        SUPREME_BADNESS ("POOL_CMD_PARTICIPATE: pool_net_unpack_op", pret,
-                         errno);
-      ob_log (OBLV_DBUG, 0x20109004, "%s: participate\n", poolName);
-      pret = pool_participate (poolName, &ph, participate_options);
-      int e1 = errno;
-      send_pret = pool_net_send_result (net, "r", pret);
-      int e2 = errno;
-      protein_free (participate_options);
-      if (pret != OB_OK)
+      unt64 len = 0;
+      ob_retort pret = conn_read (c, &len);
+      if (pret >= OB_OK && len == 0 && !c->in_gone)
         {
-          SUPREME_BADNESS ("POOL_CMD_PARTICIPATE: pool_participate", pret, e1);
+          // Wait for the rest
+          conn_idle (c, false);
+          break;
         }
-      if (send_pret != OB_OK)
+      if (pret < OB_OK || len == 0)
         {
-          pool_withdraw (ph);
-          SUPREME_BADNESS ("POOL_CMD_PARTICIPATE: pool_net_send_result",
-                           send_pret, e2);
+          if (pret >= OB_OK)
+            pret = (c->in_errno ? POOL_RECV_BADTH : POOL_UNEXPECTED_CLOSE);
+          tend_release_hose (st);
+          tend_badness (st, "pool_net_recv_op", pret, c->in_errno, __FILE__,
+                        __LINE__);
+          status = TEND_FINISHED;
         }
+      else
+        status = conn_serve_one (c);
+
+      if (status == TEND_FINISHED)
+        conn_close (c);
+      else if (status == TEND_STARTTLS)
+        conn_go_solo (c);
     }
-  else if (op_num == POOL_CMD_PARTICIPATE_CREATINGLY)
+  pthread_setspecific (serving_key, NULL);
+}
+
+/// The client sent something (or hung up).
+static void conn_socket_ready (tcp_conn *c)
+{
+  hose_cache_entry *e = c->entry;
+  if (e)
     {
-      pret =
-        pool_net_unpack_op_f (op_protein, net->net_version, "sspp", &poolName,
-                              &type, &create_options, &participate_options);
-      // (participate_options are vestigial and are ignored)
-      if (pret != OB_OK)
-        SUPREME_BADNESS ("POOL_CMD_PARTICIPATE_CREATINGLY: "
-                         "pool_net_unpack_op",
-                         pret, errno);
-      ob_log (OBLV_DBUG, 0x20109005, "%s: participate_creatingly\n", poolName);
-      ob_retort cret =
-        pool_participate_creatingly (poolName, type, &ph, create_options);
-      pret = cret;
-      if (net->net_version < POOL_TCP_VERSION_WITH_NEW_PCREATINGLY_CODES)
+      pthread_mutex_lock (&e->mutex);
+      if (c->state == CONN_PARKED)
         {
-          if (pret == OB_OK)
-            pret = POOL_EXISTS;
-          else if (pret == POOL_CREATED)
-            pret = OB_OK;
+          // The next command cancels the await, but the client first
+          // expects to hear how the await ended.
+          tcp_conn **pc;
+          for (pc = &e->awaiters; *pc != c; pc = &(*pc)->next_awaiter)
+            ;
+          *pc = c->next_awaiter;
+          c->state = CONN_BUSY;
+          pthread_mutex_unlock (&e->mutex);
+
+          pool_hose ph = NULL;
+          protein p = NULL;
+          pool_timestamp ts = 0;
+          int64 idx = 0;
+          ob_retort pret = hose_cache_checkout (e, &ph);
+          if (pret >= OB_OK)
+            {
+              pret = conn_check_await (c, ph, &p, &ts, &idx);
+              hose_cache_checkin (e, ph);
+            }
+          ob_retort send_pret = conn_end_await (c, pret, p, ts, idx);
+          Free_Protein (p);
+          if (send_pret < OB_OK)
+            {
+              conn_close (c);
+              return;
+            }
         }
-      int e1 = errno;
-      send_pret = pool_net_send_result (net, "r", pret);
-      int e2 = errno;
-      free (type);
-      protein_free (participate_options);
-      protein_free (create_options);
-      if (cret != OB_OK && cret != POOL_CREATED)
+      else if (c->state != CONN_IDLE)
         {
-          SUPREME_BADNESS ("POOL_CMD_PARTICIPATE_CREATINGLY: "
-                           "pool_participate_creatingly",
-                           cret, e1);
+          // Whoever owns the connection will re-arm the socket
+          c->socket_fired = true;
+          pthread_mutex_unlock (&e->mutex);
+          return;
         }
-      if (send_pret != OB_OK)
+      else
         {
-          pool_withdraw (ph);
-          SUPREME_BADNESS ("POOL_CMD_PARTICIPATE_CREATINGLY: "
-                           "pool_net_send_result",
-                           send_pret, e2);
+          c->state = CONN_BUSY;
+          pthread_mutex_unlock (&e->mutex);
         }
     }
-  else
+  conn_serve (c);
+}
+
+/// Somebody deposited into e's pool; see which parked connections
+/// that satisfies.
+static void hose_cache_deposits_ready (hose_cache_entry *e)
+{
+  pthread_mutex_lock (&e->mutex);
+  if (!e->notifier)
     {
-    // No other commands are valid.
-    bad_start:
-      OB_LOG_ERROR_CODE (0x20109029, "bad starting op %d\n", op_num);
-      protein_free (op_protein);
+      // Everyone left before we got here
+      pthread_mutex_unlock (&e->mutex);
       return;
     }
+  pool_net_server_notifier_drain (e->notifier);
+  tcp_conn *c, *next, *batch = e->awaiters;
+  e->awaiters = NULL;
+  for (c = batch; c; c = c->next_awaiter)
+    c->state = CONN_CHECKING;
+  pthread_mutex_unlock (&e->mutex);
 
-  ob_log (OBLV_DBUG, 0x20109006, "%s: command processing\n", poolName);
+  pool_hose ph = NULL;
+  ob_retort hose_pret = (batch ? hose_cache_checkout (e, &ph) : OB_OK);
+  for (c = batch; c; c = next)
+    {
+      next = c->next_awaiter;
+      protein p = NULL;
+      pool_timestamp ts = 0;
+      int64 idx = 0;
+      ob_retort pret = hose_pret;
+      if (pret >= OB_OK)
+        pret = conn_check_await (c, ph, &p, &ts, &idx);
+      pthread_mutex_lock (&e->mutex);
+      if (pret == POOL_NO_SUCH_PROTEIN && !c->socket_fired)
+        {
+          c->state = CONN_PARKED;
+          c->next_awaiter = e->awaiters;
+          e->awaiters = c;
+          pthread_mutex_unlock (&e->mutex);
+          continue;
+        }
+      pthread_mutex_unlock (&e->mutex);
+      // If the client is gone (or stopped reading), make sure its
+      // socket says so, and whoever hears it will hang up
+      if (conn_end_await (c, pret, p, ts, idx) < OB_OK)
+        shutdown (c->net.connfd, SHUT_RDWR);
+      Free_Protein (p);
+      conn_idle (c, true);
+    }
+  if (ph)
+    hose_cache_checkin (e, ph);
 
-  hose_name = slaw_string_format ("%s@%s", poolName, remote_host);
-  pool_set_hose_name (ph, slaw_string_emit (hose_name));
+  pthread_mutex_lock (&e->mutex);
+  if (e->notifier)
+    watch_fd (e->notifier->notify_handle, &e->notify_watch, EPOLL_CTL_MOD);
+  pthread_mutex_unlock (&e->mutex);
+}
 
-  // Now that we have a connection and a valid pool struct, handle
-  // on-going commands.
-  exit_cmd_loop = false;
-  count = 0;
-  while (OB_LOG_DEBUG_CODE (0x2010903d, "waiting - %s\n",
-                            slaw_string_emit (hose_name)),
-         set_my_name (slaw_string_emit (hose_name)),
-         (recv_pret = pool_net_recv_op (net, &op_num, &op_protein)) == OB_OK)
-    {
-      ret_prot = NULL;
-      ret_index = -1;
-      ret_ts = -1;
-      op_count[op_num]++;
-      switch (op_num)
+static void *worker_main (OB_UNUSED void *arg)
+{
+  for (;;)
+    {
+      struct epoll_event ev;
+      int n = epoll_wait (epoll_fd, &ev, 1, -1);
+      if (n < 0)
         {
-          case POOL_CMD_SET_HOSE_NAME:
-            set_my_name ("SET_HOSE_NAME");
-            ob_log (OBLV_DBUG, 0x20109007, "%s: set hose name\n", poolName);
-            Free_Ptr (remote_hname);
-            Free_Ptr (remote_process);
-            Free_Slaw (hose_name);
-            pret = pool_net_unpack_op_f (op_protein, net->net_version, "ssi",
-                                         &remote_hname, &remote_process,
-                                         &remote_pid);
-            if (pret >= OB_OK)
-              {
-                hose_name =
-                  slaw_string_format ("%s@%s/%" OB_FMT_64 "d/%s", remote_hname,
-                                      remote_process, remote_pid, remote_host);
-                pool_set_hose_name (ph, slaw_string_emit (hose_name));
-                slaw tmp = slaw_string_format ("%" OB_FMT_64 "d/%s", remote_pid,
-                                               remote_host);
-                set_client_info (slaw_string_emit (tmp));
-                slaw_free (tmp);
-              }
-            // Note: there is no response to this command; none is needed.
-            break;
-          case POOL_CMD_DEPOSIT:
-            set_my_name ("DEPOSIT");
-            ob_log (OBLV_DBUG, 0x20109008, "%s: deposit %d\n", poolName,
-                    count++);
-            pret = pool_net_unpack_op_f (op_protein, net->net_version, "p",
-                                         &deposit);
-            if (pret < OB_OK)
-              deposit = NULL;
-            else
-              pret = pool_deposit_ex (ph, deposit, &ret_index, &ret_ts);
-            send_pret =
-              pool_net_send_result (net, "irt", ret_index, pret, ret_ts);
-            protein_free (deposit);
-            break;
-          case POOL_CMD_NTH_PROTEIN:
-            set_my_name ("NTH_PROTEIN");
-            ob_log (OBLV_DBUG, 0x20109009, "%s: nth protein\n", poolName);
-            pret =
-              pool_net_unpack_op_f (op_protein, net->net_version, "i", &idx);
-            if (pret >= OB_OK)
-              pret = pool_nth_protein (ph, idx, &ret_prot, &ret_ts);
-            if (net->net_version < POOL_TCP_VERSION_WITH_NEW_PCREATINGLY_CODES
-                && pret == POOL_NO_SUCH_PROTEIN)
-              send_pret =
-                pool_net_send_result (net, "ptR", ret_prot, ret_ts,
-                                      ye_olde_no_protein_retorte (ph, idx));
-            else
-              send_pret =
-                pool_net_send_result (net, "ptr", ret_prot, ret_ts, pret);
-            protein_free (ret_prot);
-            break;
-          case POOL_CMD_NEXT:
-            set_my_name ("NEXT");
-            pret =
-              pool_net_unpack_op_f (op_protein, net->net_version, "i", &idx);
-            ob_log (OBLV_DBUG, 0x2010900a, "%s: next\n", poolName);
-            if (pret < OB_OK)
-              search = NULL;
-            else
-              pret = pool_seekto (ph, idx);
-            if (pret >= OB_OK)
-              pret = pool_next (ph, &ret_prot, &ret_ts, &ret_index);
-            if (net->net_version < POOL_TCP_VERSION_WITH_NEW_PCREATINGLY_CODES
-                && pret == POOL_NO_SUCH_PROTEIN)
-              send_pret =
-                pool_net_send_result (net, "ptiR", ret_prot, ret_ts, ret_index,
-                                      ye_olde_no_protein_retorte (ph, idx));
-            else
-              send_pret = pool_net_send_result (net, "ptir", ret_prot, ret_ts,
-                                                ret_index, pret);
-            protein_free (ret_prot);
-            break;
-          case POOL_CMD_PREV:
-            set_my_name ("PREV");
-            pret =
-              pool_net_unpack_op_f (op_protein, net->net_version, "i", &idx);
-            ob_log (OBLV_DBUG, 0x2010900b, "%s: prev\n", poolName);
-            if (pret < OB_OK)
-              search = NULL;
-            else
-              pret = pool_seekto (ph, idx);
-            if (pret >= OB_OK)
-              pret = pool_prev (ph, &ret_prot, &ret_ts, &ret_index);
-            // XXX: Technically, this can't happen, since POOL_CMD_PREV was
-            // added after the retorts were changed.  But, theoretically,
-            // the protocol version and the supported commands are
-            // orthogonal.
-            if (net->net_version < POOL_TCP_VERSION_WITH_NEW_PCREATINGLY_CODES
-                && pret == POOL_NO_SUCH_PROTEIN)
-              send_pret =
-                pool_net_send_result (net, "ptiR", ret_prot, ret_ts, ret_index,
-                                      ye_olde_no_protein_retorte (ph, idx));
-            else
-              send_pret = pool_net_send_result (net, "ptir", ret_prot, ret_ts,
-                                                ret_index, pret);
-            protein_free (ret_prot);
-            break;
-          case POOL_CMD_PROBE_FRWD:
-            set_my_name ("PROBE_FRWD");
-            pret = pool_net_unpack_op_f (op_protein, net->net_version, "ix",
-                                         &idx, &search);
-            ob_log (OBLV_DBUG, 0x2010900c, "%s: probe_frwd\n", poolName);
-            if (pret < OB_OK)
-              search = NULL;
-            else
-              pret = pool_seekto (ph, idx);
-            if (pret >= OB_OK)
-              pret =
-                pool_probe_frwd (ph, search, &ret_prot, &ret_ts, &ret_index);
-            slaw_free (search);
-            send_pret = pool_net_send_result (net, "ptir", ret_prot, ret_ts,
-                                              ret_index, pret);
-            protein_free (ret_prot);
-            break;
-          case POOL_CMD_PROBE_BACK:
-            set_my_name ("PROBE_BACK");
-            pret = pool_net_unpack_op_f (op_protein, net->net_version, "ix",
-                                         &idx, &search);
-            ob_log (OBLV_DBUG, 0x2010900d, "%s: probe_back\n", poolName);
-            if (pret < OB_OK)
-              search = NULL;
-            else
-              pret = pool_seekto (ph, idx);
-            if (pret >= OB_OK)
-              pret =
-                pool_probe_back (ph, search, &ret_prot, &ret_ts, &ret_index);
-            slaw_free (search);
-            send_pret = pool_net_send_result (net, "ptir", ret_prot, ret_ts,
-                                              ret_index, pret);
-            protein_free (ret_prot);
-            break;
-          case POOL_CMD_NEWEST_INDEX:
-            set_my_name ("NEWEST_INDEX");
-            ob_log (OBLV_DBUG, 0x2010900e, "%s: newest index\n", poolName);
-            // No need to unpack the op - we already know everything - but
-            // do need to free it (do this after we reply for efficiency).
-            pret = pool_newest_index (ph, &ret_index);
-            send_pret = pool_net_send_result (net, "ir", ret_index, pret);
-            protein_free (op_protein);
-            break;
-          case POOL_CMD_OLDEST_INDEX:
-            set_my_name ("OLDEST_INDEX");
-            ob_log (OBLV_DBUG, 0x2010900f, "%s: oldest index\n", poolName);
-            pret = pool_oldest_index (ph, &ret_index);
-            send_pret = pool_net_send_result (net, "ir", ret_index, pret);
-            protein_free (op_protein);
-            break;
-          case POOL_CMD_INDEX_LOOKUP:
-            set_my_name ("INDEX_LOOKUP");
-            ob_log (OBLV_DBUG, 0x20109010, "%s: index lookup\n", poolName);
-            {
-              int64 cmp = -1;
-              int64 rel = 0;
-              pret = pool_net_unpack_op_f (op_protein, net->net_version, "tii",
-                                           &ret_ts, &rel, &cmp);
-              if (pret < OB_OK)
-                ob_nop ();  // do nothing and reply with bad pret below
-              else if (cmp < OB_CLOSEST || cmp > OB_CLOSEST_HIGHER)
-                pret = POOL_UNSUPPORTED_OPERATION;
-              else
-                {
-                  if (rel < 0)
-                    pret = pool_seekto_time (ph, ret_ts, (time_comparison) cmp);
-                  else
-                    {
-                      pret = pool_seekto (ph, rel);
-                      if (OB_OK == pret)
-                        pret =
-                          pool_seekby_time (ph, ret_ts, (time_comparison) cmp);
-                    }
-                  if (OB_OK == pret)
-                    pret = pool_index (ph, &ret_index);
-                }
-              send_pret = pool_net_send_result (net, "ir", ret_index, pret);
-            }
-            break;
-          case POOL_CMD_AWAIT_NEXT_SINGLE:
-            set_my_name ("AWAIT_NEXT_SINGLE");
-            ob_log (OBLV_DBUG, 0x20109011, "%s: await next\n", poolName);
-            pret = pool_net_unpack_op_f (op_protein, net->net_version, "t",
-                                         &timeout);
-            if (pret >= OB_OK)
-              {
-                pool_net_adjust_timeout_value_for_version (&timeout,
-                                                           net->net_version);
-                pret =
-                  pool_await_next (ph, timeout, &ret_prot, &ret_ts, &ret_index);
-              }
-            send_pret = pool_net_send_result (net, "rpti", pret, ret_prot,
-                                              ret_ts, ret_index);
-            protein_free (ret_prot);
-            break;
-          case POOL_CMD_MULTI_ADD_AWAITER:
-            set_my_name ("MULTI_ADD_AWAITER");
-            ob_log (OBLV_DBUG, 0x20109012, "%s: add_awaiter\n", poolName);
-            pret = pool_net_server_await (ph, net, POOL_WAIT_FOREVER, &ret_prot,
-                                          &ret_ts, &ret_index);
-            send_pret = pool_net_send_result (net, "rpti", pret, ret_prot,
-                                              ret_ts, ret_index);
-            protein_free (ret_prot);
-            protein_free (op_protein);
-            break;
-          case POOL_CMD_FANCY_ADD_AWAITER:
-            set_my_name ("FANCY_ADD_AWAITER");
-            pret = pool_net_unpack_op_f (op_protein, net->net_version, "ix",
-                                         &idx, &search);
-            ob_log (OBLV_DBUG, 0x2010902b,
-                    "%s: fancy_add_awaiter (%" OB_FMT_64 "d)\n", poolName, idx);
-            if (pret < OB_OK)
-              send_pret = pool_net_send_op (net, POOL_CMD_FANCY_RESULT_1, "rti",
-                                            pret, ret_ts, ret_index);
-            else
-              {
-                int64 newest = -1;
-                pool_seekto (ph, idx);
-                // _pool_net_unpack_op() converts nil to NULL, which IMO is a
-                // terrible idea (bug 480), but to be safest I'll just check
-                // for either one.
-                bool unconditional = (!search || slaw_is_nil (search));
-                pret = pool_newest_index (ph, &newest);
-                if (pret < OB_OK)
-                  newest = idx;
-                if (unconditional)
-                  pret = pool_next (ph, &ret_prot, &ret_ts, &ret_index);
-                else
-                  pret = pool_probe_frwd (ph, search, &ret_prot, &ret_ts,
-                                          &ret_index);
-                send_pret = pool_net_send_op (net, POOL_CMD_FANCY_RESULT_1,
-                                              "rti", pret, ret_ts, ret_index);
-                OB_LOG_DEBUG_CODE (0x20109041, "POOL_CMD_FANCY_RESULT_1 (%s, "
-                                               "%f, %" OB_FMT_64 "d)\n",
-                                   ob_error_string (pret), ret_ts, ret_index);
-                if (pret >= OB_OK && send_pret >= OB_OK)
-                  {
-                    send_pret =
-                      pool_net_send_op (net, POOL_CMD_FANCY_RESULT_3, "tip",
-                                        ret_ts, ret_index, ret_prot);
-                    OB_LOG_DEBUG_CODE (0x20109042, "POOL_CMD_FANCY_RESULT_3 "
-                                                   "(%f, %" OB_FMT_64 "d)\n",
-                                       ret_ts, ret_index);
-                    protein_free (ret_prot);
-                  }
-                else if (pret == POOL_NO_SUCH_PROTEIN && send_pret >= OB_OK)
-                  {
-                    int64 (*func) (bslaw s, bslaw surch);
-                    int64 thingy;
-                    func = (unconditional ? always_return_0 : protein_search);
-                    pool_seekto (ph, (thingy = (idx > newest ? idx : newest)));
-                    OB_LOG_DEBUG_CODE (0x20109045,
-                                       "set index to %" OB_FMT_64 "d\n",
-                                       thingy);
-                    do
-                      {
-                        protein_free (ret_prot);
-                        OB_LOG_DEBUG_CODE (0x2010903b, "starting await\n");
-                        pret =
-                          pool_net_server_await (ph, net, POOL_WAIT_FOREVER,
-                                                 &ret_prot, &ret_ts,
-                                                 &ret_index);
-                        OB_LOG_DEBUG_CODE (0x2010903c, "finished await\n");
-                      }
-                    while (pret == OB_OK && func (ret_prot, search) < 0);
-                    send_pret =
-                      pool_net_send_op (net, POOL_CMD_FANCY_RESULT_2, "rti",
-                                        pret, ret_ts, ret_index);
-                    OB_LOG_DEBUG_CODE (0x20109043,
-                                       "POOL_CMD_FANCY_RESULT_2 (%s, %f, "
-                                       "%" OB_FMT_64 "d)\n",
-                                       ob_error_string (pret), ret_ts,
-                                       ret_index);
-                    if (pret >= OB_OK && send_pret >= OB_OK)
-                      {
-                        send_pret =
-                          pool_net_send_op (net, POOL_CMD_FANCY_RESULT_3, "tip",
-                                            ret_ts, ret_index, ret_prot);
-                        OB_LOG_DEBUG_CODE (0x20109044,
-                                           "POOL_CMD_FANCY_RESULT_3 (%f, "
-                                           "%" OB_FMT_64 "d)\n",
-                                           ret_ts, ret_index);
-                      }
-                    protein_free (ret_prot);
-                  }
-              }
-            Free_Slaw (search);
-            break;
-          case POOL_CMD_WITHDRAW:
-            set_my_name ("WITHDRAW");
-            ob_log (OBLV_DBUG, 0x20109013, "%s: withdraw\n", poolName);
-            protein_free (op_protein);
-            exit_cmd_loop = true;
-            break;
-          case POOL_CMD_INFO:
-            set_my_name ("INFO");
-            {
-              int64 hops;
-              ob_log (OBLV_DBUG, 0x20109014, "%s: info\n", poolName);
-              pret =
-                pool_net_unpack_op_f (op_protein, net->net_version, "i", &hops);
-              if (pret == OB_OK)
-                pret = pool_get_info (ph, hops, &ret_prot);
-              send_pret = pool_net_send_result (net, "rp", pret, ret_prot);
-              protein_free (ret_prot);
-              break;
-            }
-          case POOL_CMD_SUB_FETCH:
-            set_my_name ("SUB_FETCH");
-            ob_log (OBLV_DBUG, 0x20109040, "%s: sub fetch\n", poolName);
-            {
-              slaw s = NULL;
-              pret =
-                pool_net_unpack_op_f (op_protein, net->net_version, "x", &s);
-              int64 oldest = pret, newest = pret, nops;
-              if (pret >= OB_OK && (nops = slaw_list_count (s)) >= 0)
-                {
-                  pool_fetch_op *ops =
-                    (pool_fetch_op *) calloc (nops, sizeof (pool_fetch_op));
-                  convert_slaw_to_fetch_ops (s, ops, nops);
-                  Free_Slaw (s);
-                  pool_fetch (ph, ops, nops, &oldest, &newest);
-                  s = convert_fetch_ops_to_slaw (ops, nops);
-                  Free_Ptr (ops);
-                }
-              else
-                {
-                  ob_err_accum (&oldest, OB_UNKNOWN_ERR);
-                  ob_err_accum (&newest, OB_UNKNOWN_ERR);
-                }
-              send_pret = pool_net_send_result (net, "xii", s, oldest, newest);
-              Free_Slaw (s);
-            }
-            break;
-          case POOL_CMD_SUB_FETCH_EX:
-            set_my_name ("SUB_FETCH_EX");
-            ob_log (OBLV_DBUG, 0x20109060, "%s: sub fetch ex\n", poolName);
-            {
-              slaw s = NULL;
-              int64 clamp64;
-              pret = pool_net_unpack_op_f (op_protein, net->net_version, "xi",
-                                           &s, &clamp64);
-              int64 oldest = pret, newest = pret, nops;
-              if (pret >= OB_OK && (nops = slaw_list_count (s)) >= 0)
-                {
-                  pool_fetch_op *ops =
-                    (pool_fetch_op *) calloc (nops, sizeof (pool_fetch_op));
-                  convert_slaw_to_fetch_ops (s, ops, nops);
-                  Free_Slaw (s);
-                  bool clamp = (clamp64 != 0);
-                  pool_fetch_ex (ph, ops, nops, &oldest, &newest, clamp);
-                  s = convert_fetch_ops_to_slaw (ops, nops);
-                  Free_Ptr (ops);
-                }
-              else
-                {
-                  ob_err_accum (&oldest, OB_UNKNOWN_ERR);
-                  ob_err_accum (&newest, OB_UNKNOWN_ERR);
-                }
-              send_pret = pool_net_send_result (net, "xii", s, oldest, newest);
-              Free_Slaw (s);
-            }
-            break;
-          case POOL_CMD_ADVANCE_OLDEST:
-            set_my_name ("ADVANCE_OLDEST");
-            OB_LOG_DEBUG_CODE (0x20109054, "%s: advance oldest\n", poolName);
-            pret =
-              pool_net_unpack_op_f (op_protein, net->net_version, "i", &idx);
-            if (pret >= OB_OK)
-              pret = pool_advance_oldest (ph, idx);
-            send_pret = pool_net_send_result (net, "r", pret);
-            break;
-          case POOL_CMD_CHANGE_OPTIONS:
-            {
-              protein opts = NULL;
-              set_my_name ("CHANGE_OPTIONS");
-              OB_LOG_DEBUG_CODE (0x20109056, "%s: change_options\n", poolName);
-              pret =
-                pool_net_unpack_op_f (op_protein, net->net_version, "p", &opts);
-              if (pret >= OB_OK)
-                pret = pool_change_options (ph, opts);
-              send_pret = pool_net_send_result (net, "r", pret);
-              Free_Protein (opts);
-            }
-            break;
-          default:
-            // Unknown command.  We can't send a result because we don't
-            // know what the remote end is expecting, so close the
-            // connection - it'll get the message across.
-            OB_LOG_ERROR_CODE (0x2010902a, "Unknown command %d\n", op_num);
-            protein_free (op_protein);
-            Free_Ptr (poolName);
-            Free_Slaw (hose_name);
-            return;
+          if (errno != EINTR)
+            OB_PERROR_CODE (0x2010906c, "epoll_wait");
+          continue;
         }
-      // Do we want to close the connection?
-      if ((exit_cmd_loop) || (send_pret != OB_OK))
-        break;
+      if (n == 0)
+        continue;
+      watch *w = (watch *) ev.data.ptr;
+      if (w->kind == WATCH_SOCKET)
+        conn_socket_ready ((tcp_conn *) w->owner);
+      else
+        hose_cache_deposits_ready ((hose_cache_entry *) w->owner);
     }
+  return NULL;
+}
 
-  if (recv_pret != OB_OK)
+/// Starts the worker threads.  Must be called after we're done
+/// forking, since threads don't survive fork().
+static void start_workers (void)
+{
+  epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  if (epoll_fd < 0)
     {
-      const int erryes = errno;
-      pool_withdraw (ph);
-      SUPREME_BADNESS ("pool_net_recv_op", recv_pret, erryes);
+      OB_PERROR_CODE (0x2010906d, "epoll_create1");
+      OB_LOG_DEBUG_CODE (0x2010906e, "calling exit (1);\n");
+      exit (1);
     }
 
-  print_op_stats (remote_hname ? remote_hname : poolName,
-                  remote_process ? remote_process : remote_host, op_count);
-
-  Free_Ptr (remote_hname);
-  Free_Ptr (remote_process);
+  initialize_logging ();
 
-  if (send_pret != OB_OK)
-    ob_log (OBLV_DBUG, 0x20109015, "%s: send_pret %s\n", poolName,
-            ob_error_string (send_pret));
-  // At this point, only withdraw is allowed in normal operation.  A
-  // connection ending without a withdraw happens in particular if a
-  // process forgets to withdraw from a pool or is killed before it
-  // can withdraw.
-  if (op_num != POOL_CMD_WITHDRAW)
-    ob_log (OBLV_DBUG, 0x20109016, "Connection didn't end with a withdraw!\n");
-  pret = pool_withdraw (ph);
-  // Only send the result if the remote end is expecting it
-  if (op_num == POOL_CMD_WITHDRAW)
-    ob_ignore_retort (pool_net_send_result (net, "r", pret));
-  // Terminate the connection by returning from the function
-  ob_log (OBLV_DBUG, 0x20109017, "%s: exiting\n", poolName);
-  Free_Ptr (poolName);
-  Free_Slaw (hose_name);
-  return;
+  const int err = pthread_key_create (&serving_key, NULL);
+  if (err != 0)
+    {
+      OB_LOG_ERROR_CODE (0x20109078, "pthread_key_create: %s\n",
+                         strerror (err));
+      exit (1);
+    }
 
-badness:
-  errno = badness_errno;
-  msg = ob_error_string (badness_pret);
-  slaw extra;
-  if (badness_pret == POOL_RECV_BADTH)
-    // POOL_RECV_BADTH was probably caused by a system error,
-    // so tack on errno for extra information.
-    // XXX: but sometimes this is misleading.
-    extra = slaw_string_format (" (%s)", strerror (badness_errno));
-  else if (badness_pret == ob_errno_to_retort (EACCES))
-    extra = slaw_string_format (", when OB_POOLS_DIR=%s",
-                                ob_get_standard_path (ob_pools_dir));
-  else
-    // Otherwise, there is no extra information.
-    extra = slaw_string ("");
-  ob_log_loc (badness_file, badness_line, OBLV_ERROR, 0,
-              "[pool %s] %s encountered %s%s\n",
-              (poolName ? poolName : "<unknown>"), grumpy, msg,
-              slaw_string_emit (extra));
-  Free_Ptr (poolName);
-  slaw_free (extra);
-  Free_Ptr (remote_hname);
-  Free_Ptr (remote_process);
-  Free_Slaw (hose_name);
+  // Leave the signals to the main thread, so they wake it from accept()
+  sigset_t blocked, old;
+  sigemptyset (&blocked);
+  sigaddset (&blocked, SIGCHLD);
+  sigaddset (&blocked, SIGINT);
+  sigaddset (&blocked, SIGTERM);
+  pthread_sigmask (SIG_BLOCK, &blocked, &old);
+  int i;
+  for (i = 0; i < num_workers; i++)
+    {
+      pthread_t thr;
+      const int err = pthread_create (&thr, NULL, worker_main, NULL);
+      if (err != 0)
+        {
+          OB_LOG_ERROR_CODE (0x2010906f, "pthread_create: %s\n",
+                             strerror (err));
+          exit (1);
+        }
+      pthread_detach (thr);
+    }
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+  OB_LOG_DEBUG_CODE (0x20109070, "started %d workers\n", num_workers);
 }
 
-/* Little wrapper function to ensure cleanup, since tend_pool_hose()
- * has many return paths. */
-static void tend_pool_hose_tls (pool_net_data net, const char *remote_host)
+/// Instead of forking, let the workers take care of a new connection.
+static void hand_to_workers (int connfd, const char *remote_host)
 {
-  tend_pool_hose (&net, remote_host);
-#ifndef _MSC_VER
-  OB_CHECK_POSIX_CODE (0x20109048, close (net.connfd));
-#endif
-  if (net.tls_thread)
-    // XXX: assumes 0 is not a valid pthread_t (which is true on Linux
-    // and OS X, but may not be true in the general case)
-    OB_DIE_ON_ERROR (ob_tls_server_join_thread (net.tls_thread));
+  tcp_conn *c = (tcp_conn *) calloc (1, sizeof (*c));
+  if (!c)
+    {
+      OB_LOG_ERROR_CODE (0x20109071, "out of memory for %s\n", remote_host);
+      OB_CHECK_POSIX_CODE (0x20109072, close (connfd));
+      return;
+    }
+  c->net.connfd = connfd;
+  c->net.send_nbytes = pool_tcp_send_nbytes;
+  c->net.send_iov = pool_tcp_send_iov;
+  c->net.recv_nbytes = conn_recv_nbytes;
+  struct timeval tv;
+  OB_CLEAR (tv);
+  tv.tv_sec = WORKER_SEND_TIMEOUT;
+  if (setsockopt (connfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof (tv)) != 0)
+    OB_PERROR_CODE (0x20109079, "setsockopt");
+  c->no_wakeup = OB_NULL_HANDLE;
+  c->net.wakeup_handle_loc = &c->no_wakeup;
+  ob_safe_copy_string (c->remote_host, sizeof (c->remote_host), remote_host);
+  tend_state_init (&c->st, &c->net, c->remote_host);
+  c->st.conn = c;
+  c->state = CONN_IDLE;
+  c->await_op = -1;
+  c->sock_watch.kind = WATCH_SOCKET;
+  c->sock_watch.owner = c;
+  if (!watch_fd (connfd, &c->sock_watch, EPOLL_CTL_ADD))
+    conn_close (c);
 }
 
+#endif /* POOL_TCP_WORKERS */
+
+
 #ifdef _MSC_VER
 
 // The Windows pool server does not fork-off child processes, it
@@ -1287,6 +2389,7 @@ unsigned int __stdcall connection_thread_entry (void *args)
   memset (&net, 0, sizeof (net));
   net.connfd = connfd;
   net.send_nbytes = pool_tcp_send_nbytes;
+  net.send_iov = pool_tcp_send_iov;
   net.recv_nbytes = pool_tcp_recv_nbytes;
 
   HANDLE null_handle = NULL;
@@ -1373,10 +2476,19 @@ static void connect_pool_hose (int connfd, int listenfd,
   memset (&net, 0, sizeof (net));
   net.connfd = connfd;
   net.send_nbytes = pool_tcp_send_nbytes;
+  net.send_iov = pool_tcp_send_iov;
   net.recv_nbytes = pool_tcp_recv_nbytes;
   net.wakeup_handle_loc = &negative_one;
   //net.outstanding_await and awaiter_added are client side only
 
+#ifdef POOL_TCP_WORKERS
+  if (num_workers > 0)
+    {
+      hand_to_workers (connfd, remote_host);
+      return;
+    }
+#endif
+
   // Fork after we set up the connection info so we can send an error
   // back if necessary.
   if (!debug)
@@ -1644,8 +2756,14 @@ static void fork_off (int listenfd)
 
   // Child - becomes background daemon
   if (0 == pid)
-    // Below never returns
-    wait_for_connection (listenfd);
+    {
+#ifdef POOL_TCP_WORKERS
+      if (num_workers > 0)
+        start_workers ();
+#endif
+      // Below never returns
+      wait_for_connection (listenfd);
+    }
   else
     print_pid (pid); /* print the pid of the server we forked */
 
@@ -1843,6 +2961,7 @@ static void print_usage (FILE *fp)
   fprintf (fp, "usage: pool_tcp_server [-cdnvqtTSIC] [-p <port>]\n");
   fprintf (fp,
            "                       [-P <file>] [-s <seconds>] [-X <file>]\n");
+  fprintf (fp, "                       [-w <workers>]\n");
   fprintf (fp, "                       [-L <pool>] [-l <pool prefix>]\n");
   fprintf (fp, "       -c count network operations\n");
   fprintf (fp,
@@ -1873,6 +2992,13 @@ static void print_usage (FILE *fp)
 #else
   fprintf (fp, "       -t (option not supported on this platform)\n");
   fprintf (fp, "       -T (option not supported on this platform)\n");
+#endif
+#ifdef POOL_TCP_WORKERS
+  fprintf (fp, "       -w serve connections from this many threads,\n");
+  fprintf (fp, "          rather than forking a process per connection\n");
+  fprintf (fp, "          (TLS connections still get a thread each)\n");
+#else
+  fprintf (fp, "       -w (option not supported on this platform)\n");
 #endif
   if (have_tls)
     {
@@ -1934,7 +3060,7 @@ int main (int argc, char *argv[])
 
   //if ( leak_mask & 1 ) { malloc (1); }
 
-  while ((c = getopt (argc, argv, "hcdnp:qvl:L:P:s:tTX:SIC")) != -1)
+  while ((c = getopt (argc, argv, "hcdnp:qvl:L:P:s:tTw:X:SIC")) != -1)
     {
       switch (c)
         {
@@ -1978,6 +3104,19 @@ int main (int argc, char *argv[])
           case 'T':
             top_info = true;
             break;
+          case 'w':
+            num_workers = atoi (optarg);
+            if (num_workers <= 0)
+              {
+                fprintf (stderr, "-w needs a positive number of workers\n");
+                usage ();
+              }
+#ifndef POOL_TCP_WORKERS
+            OB_LOG_WARNING_CODE (0x20109073, "-w is not supported on this "
+                                             "platform; ignoring it\n");
+            num_workers = 0;
+#endif
+            break;
           case 'X':
             cleanupfile = strdup (optarg);
             break;
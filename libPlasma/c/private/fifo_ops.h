@@ -5,6 +5,7 @@
  * libPlasma/c/fifo_ops.c - only used on non-Windows
  * libPlasma/c/win32/fifo_ops_win32.c - only used on Windows
  * libPlasma/c/pool-fifo.c - used on both!
+ * libPlasma/c/pool-futex-ops.c - the futex versions, only used on Linux
  * libPlasma/c/private/fifo_ops.h - prototypes for all of the above .c files
  */
 
@@ -65,6 +66,31 @@ ob_retort pool_fifo_await_next_single (pool_hose ph, pool_timestamp timeout,
                                        pool_timestamp *ret_ts,
                                        int64 *ret_index);
 
+#ifdef __gnu_linux__
+
+/**
+ * Futex-based counterparts of the above, for pools created with the
+ * "futex" option.  They live in pool-futex-ops.c, and work the same
+ * way, except that notify_handle is an eventfd rather than a fifo.
+ */
+
+void pool_futex_multi_destroy_awaiter (pool_hose ph) OB_HIDDEN;
+
+ob_retort pool_futex_multi_add_awaiter (pool_hose ph, protein *ret_prot,
+                                        pool_timestamp *ret_ts,
+                                        int64 *ret_index) OB_HIDDEN;
+
+void pool_futex_multi_remove_awaiter (pool_hose ph) OB_HIDDEN;
+
+ob_retort pool_futex_wake_awaiters (pool_hose ph) OB_HIDDEN;
+
+ob_retort pool_futex_await_next_single (pool_hose ph, pool_timestamp timeout,
+                                        protein *ret_prot,
+                                        pool_timestamp *ret_ts,
+                                        int64 *ret_index) OB_HIDDEN;
+
+#endif
+
 /**
  * Generate a probably unique fifo name and cache it in the pool hose.
  * If later on we discover that we're colliding with someone else's
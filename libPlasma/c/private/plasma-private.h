@@ -7,6 +7,7 @@
 #include "libLoam/c/ob-types.h"
 #include "libLoam/c/ob-api.h"
 #include "libPlasma/c/slaw-io.h"
+#include "libPlasma/c/slaw-builder.h"
 
 #include "libPlasma/c/private/slaw-viscera-private.h"
 #include "libPlasma/c/private/slaw-numeric-ilk-rumpus-private.h"
@@ -33,6 +34,28 @@ const void *slaw_numeric_nonarray_emit (bslaw s) OB_HIDDEN;
 slaw slaw_alloc (unt64 quadlen) OB_HIDDEN;
 unt64 slaw_octlen (bslaw s) OB_HIDDEN;
 
+/**
+ * Looks up \a key (or, if \a ckey is not NULL, the string \a ckey)
+ * in \a map using a hash index, as slaw_map_find() or
+ * slaw_map_find_c() would.  Returns false if \a map isn't indexed
+ * (it's too small, or hasn't been searched enough lately), in which
+ * case the caller should search it the usual way.  Otherwise, stores
+ * the value (or NULL if there's no such key) in \a result and
+ * returns true.  See slaw-map-index.c.
+ */
+bool slaw_map_index_find (bslaw map, bslaw key, const char *ckey,
+                          bslaw *result) OB_HIDDEN;
+
+/**
+ * Adds a numeric slaw to \a b: a single number (or vector, etc.) of
+ * \a unit_blen bytes if \a breadth is negative, or else an array of
+ * \a breadth of them, copied from \a data.  \a ilk has the numeric
+ * type bits only, as for slaw_numeric_array_raw().
+ */
+ob_retort private_slaw_builder_add_numeric (slaw_builder *b, slaw_oct ilk,
+                                            unt32 unit_blen, int64 breadth,
+                                            const void *data) OB_HIDDEN;
+
 static inline OB_ALWAYS_INLINE void
 slaw_copy_octs_from_to (bslaw fromS, slaw toS, unt64 octlen)
 {
@@ -80,6 +103,23 @@ ob_retort slaw_swap (slaw s, slaw stop) OB_HIDDEN;
  */
 ob_retort slaw_swap_sequence (slaw s, slaw stop) OB_HIDDEN;
 
+/**                 Makes the same checks slaw_swap() does, on a slaw
+ *                  which is already in native byte order, without
+ *                  changing it.  Use it on slawx from somewhere that
+ *                  can't be trusted, before looking inside them.
+ *
+ * \param[in]       s is the slaw to check
+ *
+ * \param[in]       stop points to the word after the last one \a s
+ *                  may use
+ *
+ * \return          OB_OK if \a s is all there and makes sense
+ * \return          SLAW_CORRUPT_PROTEIN if an embedded protein is invalid
+ * \return          SLAW_CORRUPT_SLAW if the slaw is invalid
+ * \return          SLAW_UNIDENTIFIED_SLAW if an unknown slaw is encountered
+ */
+ob_retort slaw_check (bslaw s, bslaw stop) OB_HIDDEN;
+
 // a function for categorizing slawx (handy for switch statements)
 
 slaw_type slaw_gettype (bslaw s) OB_HIDDEN;
@@ -105,12 +145,22 @@ OB_HIDDEN protein protein_from_opaque (const opaque_protein_info *opaque);
 typedef ob_retort (*slaw_close_func) (void *data);
 typedef ob_retort (*slaw_read_func) (slaw_input f, slaw *s);
 typedef ob_retort (*slaw_write_func) (slaw_output f, bslaw s);
+typedef ob_retort (*slaw_borrow_func) (slaw_input f, bslaw *s);
+typedef ob_retort (*slaw_seek_func) (slaw_input f, int64 n);
+typedef ob_retort (*slaw_count_func) (slaw_input f, int64 *count);
 
 struct slaw_input_struct
 {
   slaw_read_func rfunc;
   slaw_close_func cfunc;
   void *data;
+  // optional; NULL unless the input can do better than reading a copy
+  slaw_borrow_func bfunc;
+  // optional; NULL unless the input can seek (and count its slawx)
+  slaw_seek_func sfunc;
+  slaw_count_func nfunc;
+  // last slaw lent out by slaw_input_read_borrowed(), if it's a copy
+  slaw lent;
 };
 
 struct slaw_output_struct
@@ -124,6 +174,13 @@ OB_HIDDEN slaw_input new_slaw_input (void);
 OB_HIDDEN slaw_output new_slaw_output (void);
 
 OB_HIDDEN extern const byte ob_binary_header[4];
+/**
+ * Checks the 8-byte header of a binary slaw file, and says what
+ * version and endianness the slawx in it are.
+ */
+OB_HIDDEN ob_retort private_check_binary_header (const byte buf[8],
+                                                 unt8 *version,
+                                                 bool *big_endian);
 OB_HIDDEN OB_CONST bool ob_i_am_big_endian (void);
 
 /* values for "typ" */
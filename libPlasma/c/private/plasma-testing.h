@@ -22,6 +22,12 @@ extern "C" {
 
 OB_PLASMA_API void private_test_yaml_hash (void);
 
+// Whether slaw_input_open_text_handler() tries reading YAML itself
+// before resorting to libyaml (it does, unless you say otherwise),
+// and how many times so far it has had to resort to libyaml.
+OB_PLASMA_API void private_set_yaml_fast_path (bool enable);
+OB_PLASMA_API int64 private_yaml_fallback_count (void);
+
 typedef struct
 {
   int fd;
@@ -90,6 +90,11 @@ ob_retort ob_nb_dimensions (const ob_numeric_builder *nb_in, unt8 *flags_out,
  */
 bool ob_nb_done (const ob_numeric_builder *nb_in) OB_HIDDEN;
 
+/**
+ * Empty an ob_numeric_builder, so it can build another number.
+ */
+void ob_nb_reset (ob_numeric_builder *nb_in) OB_HIDDEN;
+
 /**
  * Free an ob_numeric_builder.
  */
@@ -7,6 +7,8 @@
 #include "libLoam/c/ob-api.h"
 #include "libLoam/c/ob-retorts.h"
 #include "libLoam/c/ob-pthread.h"
+#include "libLoam/c/ob-file.h"
+#include "libPlasma/c/private/pool-portable.h"
 
 #include <stdio.h>
 
@@ -14,6 +16,8 @@
 extern "C" {
 #endif
 
+struct pool_net_iov;
+
 /**
  * Prints ob_banner() information, but also appends another line
  * about the TLS implementation.  Also, returns OB_OK or POOL_NO_TLS
@@ -59,7 +63,7 @@ OB_PLASMA_API ob_retort ob_tls_server_join_thread (pthread_t thr);
  * Or, returns the success code POOL_ANONYMOUS_ONLY if TLS is supported,
  * but certificates are not available.
  */
-ob_retort ob_tls_client_available (void);
+OB_PLASMA_API ob_retort ob_tls_client_available (void);
 
 /**
  * Launches a thread which bidirectionally copies data between the
@@ -90,6 +94,58 @@ ob_retort ob_tls_client_launch_thread (int clear_sock, int cipher_sock,
  */
 ob_retort ob_tls_client_join_thread (pthread_t thr);
 
+/**
+ * Performs the server side of a TLS handshake on \a sock, in the
+ * calling thread.  Afterwards, all traffic on \a sock has to go
+ * through ob_tls_send_nbytes(), ob_tls_send_iov() and
+ * ob_tls_recv_nbytes(), which encrypt and decrypt straight from and
+ * to the caller's buffers, until ob_tls_end() is called (before
+ * closing \a sock).  Unlike ob_tls_server_launch_thread(), there is
+ * no extra thread or socketpair to copy everything through.  Where
+ * the kernel can do the encryption itself (Linux kTLS), it does.
+ *
+ * \a anon_ok and \a client_auth_reqd are as for
+ * ob_tls_server_launch_thread().
+ */
+OB_PLASMA_API ob_retort ob_tls_server_start (ob_sock_t sock, bool anon_ok,
+                                             bool client_auth_reqd);
+
+/**
+ * The client side of ob_tls_server_start().  The arguments are as
+ * for ob_tls_client_launch_thread().
+ */
+OB_PLASMA_API ob_retort ob_tls_client_start (ob_sock_t sock, const char *host,
+                                             bool anon_ok,
+                                             const char *certificate,
+                                             const char *private_key);
+
+/**
+ * Functions suitable for the send_nbytes, send_iov and recv_nbytes
+ * members of pool_net_data, for a socket on which
+ * ob_tls_server_start() or ob_tls_client_start() has succeeded.
+ */
+OB_PLASMA_API ob_retort ob_tls_send_nbytes (ob_sock_t sock, const void *buf,
+                                            size_t len, ob_handle_t wake_event);
+OB_PLASMA_API ob_retort ob_tls_send_iov (ob_sock_t sock,
+                                         const struct pool_net_iov *iov,
+                                         int n, ob_handle_t wake_event);
+OB_PLASMA_API ob_retort ob_tls_recv_nbytes (ob_sock_t sock, void *buf,
+                                            size_t len, ob_handle_t wake_event);
+
+/**
+ * Returns true if some already-decrypted data is waiting to be read
+ * from \a sock, in which case select() won't say so.
+ */
+OB_PLASMA_API bool ob_tls_pending (ob_sock_t sock);
+
+/**
+ * Finishes with TLS on \a sock, if it was started there: sends the
+ * peer a closure alert if \a notify (it should be false in a child
+ * process which merely inherited the socket), and frees everything.
+ * Does nothing for a socket TLS was never started on.
+ */
+OB_PLASMA_API void ob_tls_end (ob_sock_t sock, bool notify);
+
 #ifdef __cplusplus
 }
 #endif
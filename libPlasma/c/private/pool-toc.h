@@ -66,6 +66,14 @@ OB_PLASMA_API
 bool pool_toc_append (pool_toc_t *pi, pool_toc_entry entry,
                       unt64 oldest_offset);
 
+// Rewrites the offset of every entry, for when a resize renumbers the
+// pool's entries.  rebase returns POOL_TOC_UNKNOWN_OFFSET for offsets
+// which are no longer in the pool; those can only come before the
+// ones which are, and are dropped.
+OB_HIDDEN
+void pool_toc_rebase (pool_toc_t *pi, unt64 (*rebase) (unt64, const void *),
+                      const void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -117,6 +117,45 @@ typedef ob_retort (*participate_func_t) (pool_hose ph);
 typedef ob_retort (*deposit_func_t) (pool_hose ph, bprotein p, int64 *idx,
                                      pool_timestamp *ret_ts);
 
+/**
+ * deposit_batch() deposits \a n proteins in order, like that many
+ * calls to deposit(), but (ideally) with one lock acquisition and one
+ * notification for the lot.  \a idx_out and \a ts_out are never
+ * NULL.  If a deposit fails, the rest aren't attempted, and their
+ * entries in \a idx_out are set to the error, which is returned.
+ */
+
+typedef ob_retort (*deposit_batch_func_t) (pool_hose ph, const bprotein *ps,
+                                           int64 n, int64 *idx_out,
+                                           pool_timestamp *ts_out);
+
+/**
+ * nth_view() is like nth(), but fills in \a view with a pointer to
+ * the protein where it lies, plus whatever view_check() will need
+ * to tell whether it has been overwritten since.  Returns
+ * POOL_UNSUPPORTED_OPERATION if it can't, in which case pool.c makes
+ * a copy.
+ */
+
+typedef ob_retort (*nth_view_func_t) (pool_hose ph, int64 idx,
+                                      pool_protein_view *view);
+
+typedef ob_retort (*view_check_func_t) (pool_hose ph,
+                                        const pool_protein_view *view);
+
+/**
+ * deposit_async() sends a deposit without waiting for its result,
+ * which is handed to \a cb later (see pool_deposit_async()), and
+ * deposit_flush() waits for all such results.  Hoses which leave
+ * these NULL deposit synchronously.
+ */
+
+typedef ob_retort (*deposit_async_func_t) (pool_hose ph, bprotein p,
+                                           pool_deposit_callback cb,
+                                           void *cookie);
+
+typedef ob_retort (*deposit_flush_func_t) (pool_hose ph);
+
 /**
  * nth() returns the protein at the specified index if it exists,
  * otherwise it returns an appropriate error.
@@ -314,6 +353,15 @@ typedef ob_retort (*sleep_func_t) (pool_hose ph);
 
 typedef ob_retort (*change_options_func_t) (pool_hose ph, bslaw options);
 
+/**
+ * Offers the hose's new subscription filter (see pool_hose_set_filter())
+ * to the implementation.  Returns OB_OK if next(), await_next_single(),
+ * multi_add_awaiter() and friends will only produce matching proteins
+ * from now on, or POOL_UNSUPPORTED_OPERATION if pool_next() should
+ * do the filtering itself.
+ */
+typedef ob_retort (*set_filter_func_t) (pool_hose ph, bslaw filter);
+
 /**
  * The reason we need to store the permissions is because
  * pool_fifo_multi_add_awaiter() needs to create new fifos, and
@@ -396,6 +444,19 @@ struct pool_hose_struct
   int flock_fds[POOL_SEM_SET_COUNT];
 #endif
 
+#ifdef __gnu_linux__
+  /**
+   * For pools with futex locks: our own mapping of the pool header,
+   * which stays put when the pool is resized and remapped.
+   */
+  struct pool_futex_view *futex_view;
+  /**
+   * For pools with futex notification: the thread which turns
+   * notifications into something select() can wait on, if needed.
+   */
+  struct pool_futex_bridge *futex_bridge;
+#endif
+
   wakeup_stuff w;
 
   /**
@@ -472,6 +533,24 @@ struct pool_hose_struct
    */
   bool different_filesystem_than_tmp;
 
+  /**
+   * Subscription filter, set by pool_hose_set_filter(), or NULL.
+   */
+  slaw filter;
+
+  /**
+   * True if the pool implementation applies \a filter itself (see
+   * set_filter_func_t), so that pool_next() needn't.
+   */
+  bool filter_in_backend;
+
+  /**
+   * How far a remote hose may read ahead of pool_next(), as set by
+   * pool_hose_set_read_ahead().  Zero proteins means not at all.
+   */
+  int64 read_ahead_proteins;
+  int64 read_ahead_bytes;
+
   /**
    * Generic network pool data.
    */
@@ -528,6 +607,12 @@ struct pool_hose_struct
   dispose_func_t get_semkey;
   change_options_func_t change_options;
   withdraw_func_t hiatus;
+  set_filter_func_t set_filter;
+  deposit_batch_func_t deposit_batch;
+  deposit_async_func_t deposit_async;
+  deposit_flush_func_t deposit_flush;
+  nth_view_func_t nth_view;
+  view_check_func_t view_check;
 };
 
 struct pool_context_struct
@@ -661,6 +746,13 @@ static inline int pool_combine_modes (int mode, int mask)
 OB_HIDDEN pool_timestamp private_incremental_timeout (pool_timestamp timeout,
                                                       pool_timestamp *target);
 
+/**
+ * True if \a p doesn't match the hose's subscription filter, and the
+ * pool implementation isn't applying the filter itself, so the caller
+ * should throw \a p away.
+ */
+OB_HIDDEN bool private_filter_rejects (pool_hose ph, bprotein p);
+
 OB_HIDDEN void private_maybe_fill_index (
   pool_hose ph, ob_retort (*fn) (pool_hose ph, int64 *index_out), int64 *out);
 
@@ -19,6 +19,9 @@ OB_HIDDEN ob_retort pool_mmap_oldest_index (pool_hose ph, int64 *idx);
 
 OB_HIDDEN ob_retort pool_mmap_deposit (pool_hose ph, bprotein p, int64 *idx,
                                        pool_timestamp *ret_ts);
+OB_HIDDEN ob_retort pool_mmap_deposit_batch (pool_hose ph, const bprotein *ps,
+                                             int64 n, int64 *idx_out,
+                                             pool_timestamp *ts_out);
 OB_HIDDEN ob_retort pool_mmap_nth_protein (pool_hose ph, int64 idx,
                                            protein *return_prot,
                                            pool_timestamp *ret_ts);
@@ -110,7 +113,13 @@ typedef struct
 #define POOL_FLAG_AUTO_DISPOSE (OB_CONST_U64 (1) << 2)
 #define POOL_FLAG_CHECKSUM (OB_CONST_U64 (1) << 3)
 #define POOL_FLAG_FLOCK (OB_CONST_U64 (1) << 4)
+#define POOL_FLAG_PARALLEL_DEPOSIT (OB_CONST_U64 (1) << 5)
+#define POOL_FLAG_FUTEX (OB_CONST_U64 (1) << 6)
+#define POOL_FLAG_CHECKSUM_CRC32C (OB_CONST_U64 (1) << 7)
+#define POOL_FLAG_DENSE_INDEX (OB_CONST_U64 (1) << 8)
 #define POOL_FLAG_SYNC (OB_CONST_U64 (1) << 32)
+#define POOL_FLAG_GROUP_COMMIT (OB_CONST_U64 (1) << 33)
+#define POOL_FLAG_INCREMENTAL_RESIZE (OB_CONST_U64 (1) << 34)
 
 #ifdef __APPLE__ /* see bug 3770 for explanation */
 #define POOL_DEFAULT_FLAGS POOL_FLAG_FLOCK
@@ -144,6 +153,198 @@ typedef struct
 
 #define POOL_CHUNK_PTRS POOL_CHUNK_SIG ('p', 't', 'r', 's')
 
+/**
+ * How many claimed-but-unpublished entries a parallel-deposit pool
+ * keeps track of; a depositor which would claim more than this many
+ * entries past the newest one waits for the older ones first.
+ */
+#define POOL_RSRV_CLAIMS 32
+
+/**
+ * Who claimed the entry with index \a index (at \a entry).  The
+ * claimant stores its pid last, and anyone who takes over publishing
+ * the entry because the claimant died swaps in its own.
+ */
+typedef struct
+{
+  int64 index;
+  int64 entry;
+  int64 pid;
+} pool_rsrv_claim;
+
+/**
+ * Only present in pools created with POOL_FLAG_PARALLEL_DEPOSIT.
+ * Depositors claim space for their entries by advancing this (with
+ * the deposit lock held), then copy their proteins without holding
+ * the lock.  Entries only become visible to readers when the newest
+ * entry in the "ptrs" chunk catches up with them, which happens in
+ * index order.  When no deposit is in progress, reserved_entry is
+ * the same as the newest entry.  Each outstanding claim is recorded
+ * in claims[index % POOL_RSRV_CLAIMS], so that if its depositor dies
+ * before publishing, whoever is waiting on it can publish it instead.
+ */
+typedef struct
+{
+  pool_chunk_header hdr;
+  int64 reserved_entry;
+  int64 reserved_index;
+  pool_rsrv_claim claims[POOL_RSRV_CLAIMS];
+} pool_chunk_rsrv;
+
+#define POOL_CHUNK_RSRV POOL_CHUNK_SIG ('r', 's', 'r', 'v')
+
+/**
+ * Only present in pools created with POOL_FLAG_FUTEX.  Holds the
+ * deposit and notification locks themselves (process-shared, robust
+ * pthread mutexes, which are futexes underneath) so that pool_futex_ops
+ * can take them without a system call when they are uncontended.
+ * The mutexes are opaque to everyone else; lock_size records
+ * sizeof (pthread_mutex_t) for the library which initialized them,
+ * so an incompatible one can refuse to touch them.
+ *
+ * Such pools also replace fifo notification with notify_seq, which
+ * every deposit bumps, and which awaiters sleep on as a futex.
+ * notify_waiters counts the sleepers, so that depositors only make a
+ * system call when someone is actually waiting.
+ */
+typedef struct
+{
+  pool_chunk_header hdr;
+  unt64 lock_size;
+  unt64 locks[2][8];
+  unt32 notify_seq;
+  unt32 notify_waiters;
+} pool_chunk_lock;
+
+#define POOL_CHUNK_LOCK POOL_CHUNK_SIG ('l', 'o', 'c', 'k')
+
+/**
+ * Only present in pools created with POOL_FLAG_GROUP_COMMIT.  When
+ * such a pool is also "sync", depositors don't sync it themselves,
+ * inside the deposit lock.  Once an entry is published, its depositor
+ * waits until synced_end has passed the end of it.  Whoever finds
+ * nobody committing puts the time into committing, waits up to
+ * latency_usec for as many as batch deposits to pile up in pending,
+ * and then syncs just the bytes from synced_end to written_end (and
+ * the header) for all of them at once.  A committer which takes far
+ * longer than that (having died, say) gets taken over from.
+ *
+ * Like the sync flag, this is ignored by libraries which don't know
+ * about it; their deposits just sync the whole pool, as always.
+ */
+typedef struct
+{
+  pool_chunk_header hdr;
+  int64 latency_usec;
+  int64 batch;
+  int64 written_end;
+  int64 synced_end;
+  int64 pending;
+  int64 committing;
+} pool_chunk_cmit;
+
+#define POOL_CHUNK_CMIT POOL_CHUNK_SIG ('c', 'm', 'i', 't')
+
+/**
+ * Defaults for the "commit-latency" and "commit-batch" options.
+ */
+#define POOL_COMMIT_LATENCY_DEFAULT 0.001
+#define POOL_COMMIT_BATCH_DEFAULT 64
+
+/**
+ * Present in pools created with POOL_FLAG_CHECKSUM (by libraries
+ * which know about it).  Says how often readers should check the
+ * checksums of the proteins they read: always, never, or (when
+ * sampled) one protein in every "sample" each hose reads.  Pools
+ * without it are always checked.
+ *
+ * How the checksum is computed is up to the flags, since a library
+ * which computes it differently shouldn't be reading the pool at all:
+ * CityHash64 seeded with the timestamp and index, or, with
+ * POOL_FLAG_CHECKSUM_CRC32C, the CRC-32C of the protein followed by
+ * the timestamp and index.
+ */
+typedef struct
+{
+  pool_chunk_header hdr;
+  int64 verify;
+  int64 sample;
+} pool_chunk_csum;
+
+#define POOL_CHUNK_CSUM POOL_CHUNK_SIG ('c', 's', 'u', 'm')
+
+/**
+ * Values for verify in the csum chunk.
+ */
+#define POOL_VERIFY_ALWAYS 0
+#define POOL_VERIFY_SAMPLED 1
+#define POOL_VERIFY_NEVER 2
+
+/**
+ * Default for the "checksum-sample" option.
+ */
+#define POOL_VERIFY_SAMPLE_DEFAULT 16
+
+/**
+ * Only present in pools created with POOL_FLAG_DENSE_INDEX.  Followed
+ * by capacity int64s, a ring holding the entry of every recent
+ * protein: the entry of index i is at i % capacity, unless another
+ * protein has come along since, or nobody has put it there yet (0).
+ * Readers have to check the index in the entry they find, and that
+ * it hasn't been stompled, before believing it.  A resize rebuilds
+ * the ring along with the table of contents.
+ *
+ * Libraries which don't know about this wouldn't keep it up to date,
+ * so the flag is in the range which makes them refuse the pool.
+ */
+typedef struct
+{
+  pool_chunk_header hdr;
+  int64 capacity;
+} pool_chunk_dnse;
+
+#define POOL_CHUNK_DNSE POOL_CHUNK_SIG ('d', 'n', 's', 'e')
+
+static inline int64 *pool_dense_entries (pool_chunk_dnse *dh)
+{
+  return (int64 *) (dh + 1);
+}
+
+/**
+ * Only present in pools created with POOL_FLAG_INCREMENTAL_RESIZE.
+ * Such pools grow without holding the deposit lock for the whole
+ * resize: the wrapped part of the pool is copied to the end of the
+ * grown file a step at a time, letting deposits in between steps,
+ * and the lock is only held across the whole pool for the moment it
+ * takes to switch over to the new size.
+ *
+ * generation goes up every time the pool's geometry changes, so a
+ * hose whose mapping was made before it knows to remap, even if the
+ * file size is back to what it was.  claim goes up whenever a resize
+ * starts, so one which has been overtaken by another (or by a
+ * process which died halfway) knows to stop copying.
+ *
+ * Libraries which don't know about this resize the old way, which
+ * changes the file size, and any incremental resize in progress
+ * notices that and gives up.  So the flag sits in the range they
+ * ignore.
+ */
+typedef struct
+{
+  pool_chunk_header hdr;
+  int64 generation;
+  int64 claim;
+} pool_chunk_rsiz;
+
+#define POOL_CHUNK_RSIZ POOL_CHUNK_SIG ('r', 's', 'i', 'z')
+
+/**
+ * How many bytes an incremental resize copies per step, and how long
+ * (in microseconds) it lets depositors have the pool in between.
+ */
+#define POOL_RESIZE_STEP (1024 * 1024)
+#define POOL_RESIZE_NAP 200
+
 /**
  * The "table of contents" was originally known as the "index",
  * which is why its signature is "indx", in order to maintain
@@ -163,8 +364,10 @@ typedef struct pool_mmap_data pool_mmap_data;
 
 typedef struct
 {
-  unt64 (*size_of_header) (unt64 index_capacity);
-  void (*initialize_header) (unt8 slaw_vers, byte *mem, unt64 idx_cap);
+  unt64 (*size_of_header) (unt64 index_capacity, unt64 dense_cap,
+                           unt64 flags);
+  void (*initialize_header) (unt8 slaw_vers, byte *mem, unt64 idx_cap,
+                             unt64 dense_cap, unt64 flags);
   ob_retort (*read_header) (pool_mmap_data *d);
   ob_retort (*bootstrap) (pool_mmap_data *d);
   ob_retort (*write_config_file) (const char *name, pool_perms perms,
@@ -254,6 +457,36 @@ struct pool_mmap_data
   /** Points to configuration; can't be NULL. */
   pool_chunk_conf *conf_chunk;
 
+  /** Points to the reservations, or NULL if no parallel deposits. */
+  pool_chunk_rsrv *rsrv_chunk;
+
+  /** Points to the futex locks, or NULL if the pool doesn't use them. */
+  pool_chunk_lock *lock_chunk;
+
+  /** Points to the group commit state, or NULL if no group commit. */
+  pool_chunk_cmit *cmit_chunk;
+
+  /** Points to the checksum policy, or NULL if there isn't one. */
+  pool_chunk_csum *csum_chunk;
+
+  /** Points to the dense index, or NULL if there isn't one. */
+  pool_chunk_dnse *dnse_chunk;
+
+  /** Points to the resize state, or NULL if no incremental resize. */
+  pool_chunk_rsiz *rsiz_chunk;
+
+  /**
+   * The resize generation as of when the backing file was mapped,
+   * for pools with an rsiz chunk.
+   */
+  int64 mapped_generation;
+
+  /**
+   * How many proteins this hose has read from a pool whose checksums
+   * are only sampled.
+   */
+  int64 verify_count;
+
   /**
    * For old, non-chunked pools, conf_chunk points here instead of
    * into the backing file.
@@ -356,6 +589,13 @@ static inline unt64 get_flags (const pool_mmap_data *d)
   return (unt64) ob_atomic_int64_ref (&d->conf_chunk->flags);
 }
 
+// Always 0 for pools without an rsiz chunk.
+static inline int64 get_resize_generation (const pool_mmap_data *d)
+{
+  return (d->rsiz_chunk ? ob_atomic_int64_ref (&d->rsiz_chunk->generation)
+                        : 0);
+}
+
 // See file libPlasma/c/versions.txt for the dirty details.
 OB_HIDDEN OB_CONST unt8
 pool_mmap_version_from_directory_version (unt8 pool_directory_version);
@@ -368,6 +608,12 @@ OB_HIDDEN ob_retort pool_mmap_call_with_backing_file (
 
 OB_HIDDEN ob_retort pool_mmap_load_config (pool_hose ph);
 
+/**
+ * Initialize the locks in a freshly created lock chunk.  Only
+ * available on Linux, which is the only place pool_futex_ops is.
+ */
+OB_HIDDEN ob_retort pool_futex_init_locks (pool_chunk_lock *lc);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,6 +33,20 @@ typedef struct outstanding_await_t
   int64 idx;
 } outstanding_await_t;
 
+/**
+ * One of the pieces of a message for send_iov() (below).
+ */
+typedef struct pool_net_iov
+{
+  const void *base;
+  size_t len;
+} pool_net_iov;
+
+/**
+ * The most pieces send_iov() will be asked to send at once.
+ */
+#define POOL_NET_IOV_MAX 64
+
 /**
  * Generic support for network pool operations, independent of
  * underlying transport.  Includes support for remote execution of
@@ -86,6 +100,15 @@ typedef struct
   ob_retort (*recv_nbytes) (ob_sock_t fd, void *buf, size_t len,
                             ob_handle_t wake_event_handle);
 
+  /**
+   * send_iov() sends the \a n (at most POOL_NET_IOV_MAX) buffers in
+   * \a iov, one after another, like send_nbytes() of each in turn,
+   * but with as few system calls as it can.  If it's NULL, they're
+   * sent with send_nbytes().
+   */
+  ob_retort (*send_iov) (ob_sock_t fd, const pool_net_iov *iov, int n,
+                         ob_handle_t wake_event_handle);
+
   /**
    * What version has been negotiated for this connection?
    */
@@ -110,6 +133,30 @@ typedef struct
    * Thread for TLS.  Would eventually like to refactor this somehow.
    */
   pthread_t tls_thread;
+
+  /**
+   * Deposits sent by pool_deposit_async() whose results we haven't
+   * read yet: a ring of POOL_DEPOSIT_WINDOW entries, starting at
+   * pending_first, allocated the first time it's needed.
+   */
+  struct pool_net_pending_deposit *pending;
+  int32 pending_first;
+  int32 pending_count;
+
+  /**
+   * Proteins pool_net_next() has fetched ahead of the hose's index
+   * (see pool_hose_set_read_ahead()).  Of the ahead_cap entries in
+   * ahead, the ones from ahead_first up to (not including)
+   * ahead_count hold proteins at consecutive indexes; the indexes
+   * from ahead_from up to the first of them had been discarded.
+   * ahead_avg_bytes is the average size of what's been read so far.
+   */
+  pool_fetch_op *ahead;
+  int64 ahead_cap;
+  int64 ahead_first;
+  int64 ahead_count;
+  int64 ahead_from;
+  int64 ahead_avg_bytes;
 } pool_net_data;
 
 static inline bool pool_net_supports_cmd (const pool_net_data *net, int cmd_num)
@@ -154,6 +201,10 @@ static inline bool pool_net_supports_cmd (const pool_net_data *net, int cmd_num)
 #define POOL_CMD_SUB_FETCH_EX 29
 #define POOL_CMD_STARTTLS 30
 #define POOL_CMD_GREENHOUSE 31
+// Not a real command either; a server advertises it if it evaluates
+// protein filters (see protein_filter()) wherever it takes a search.
+#define POOL_CMD_FILTERS 32
+#define POOL_CMD_DEPOSIT_BATCH 33
 #define POOL_CMD_FANCY_RESULT_1 64
 #define POOL_CMD_FANCY_RESULT_2 65
 #define POOL_CMD_FANCY_RESULT_3 66
@@ -199,11 +250,31 @@ pool_net_send_op (pool_net_data *net, int op_num, const char *format, ...);
  *
  * Must be followed by a call to pool_net_send_result() to send the
  * return value after executing this operation.
+ *
+ * From protocol version POOL_TCP_VERSION_WITH_BINARY_FRAMES on,
+ * what comes over the wire is a binary frame (see
+ * pool-tcp-protocol.md) rather than a protein, and op_prot is a
+ * protein with the frame's arguments as its rude data.  Either way,
+ * only look inside it with pool_net_unpack_op().
  */
 
 OB_PLASMA_API OB_WARN_UNUSED_RESULT ob_retort
 pool_net_recv_op (pool_net_data *net, int *op_num, protein *op_prot);
 
+/**
+ * Says how many bytes the operation at the start of \a buf, of which
+ * \a have bytes have arrived so far, takes on the wire, so that
+ * something which reads the socket itself can tell when to hand it
+ * to pool_net_recv_op().  Stores 0 in \a len if not enough has
+ * arrived yet to tell.  Returns POOL_PROTOCOL_ERROR (or
+ * POOL_WRONG_VERSION) if what's there already can't be the start of
+ * an operation.
+ */
+
+OB_PLASMA_API OB_WARN_UNUSED_RESULT ob_retort
+pool_net_op_len (const pool_net_data *net, const void *buf, size_t have,
+                 unt64 *len);
+
 /**
  * Based on the operation number, unpack a received operation
  * according to the corresponding format.  Put the unpacked arguments
@@ -212,6 +283,10 @@ pool_net_recv_op (pool_net_data *net, int *op_num, protein *op_prot);
  * Example:
  *     pret = pool_net_unpack_op (op_protein, "ssp", &pool_name, &type,
  *                                &options);
+ *
+ * Besides the format characters pool_net_send_op() takes, this one
+ * also takes 'b', for a slaw which is left where it is: the bslaw
+ * points into op_prot, and is only good until op_prot is freed.
  */
 
 OB_PLASMA_API OB_WARN_UNUSED_RESULT ob_retort
@@ -263,6 +338,13 @@ ob_retort pool_net_set_hose_name (pool_hose ph, const char *name) OB_HIDDEN;
 
 ob_retort pool_net_deposit (pool_hose ph, bprotein p, int64 *idx,
                             pool_timestamp *ret_ts) OB_HIDDEN;
+ob_retort pool_net_deposit_batch (pool_hose ph, const bprotein *ps, int64 n,
+                                  int64 *idx_out,
+                                  pool_timestamp *ts_out) OB_HIDDEN;
+ob_retort pool_net_deposit_async (pool_hose ph, bprotein p,
+                                  pool_deposit_callback cb,
+                                  void *cookie) OB_HIDDEN;
+ob_retort pool_net_deposit_flush (pool_hose ph) OB_HIDDEN;
 ob_retort pool_net_nth_protein (pool_hose ph, int64 idx, protein *return_prot,
                                 pool_timestamp *ret_ts) OB_HIDDEN;
 ob_retort pool_net_next (pool_hose ph, protein *return_prot,
@@ -287,6 +369,7 @@ ob_retort pool_net_fetch (pool_hose ph, pool_fetch_op *ops, int64 nops,
                           bool clamp) OB_HIDDEN;
 ob_retort pool_net_advance_oldest (pool_hose ph, int64 idx_in) OB_HIDDEN;
 ob_retort pool_net_change_options (pool_hose ph, bslaw options) OB_HIDDEN;
+ob_retort pool_net_set_filter (pool_hose ph, bslaw filter) OB_HIDDEN;
 
 ob_retort pool_net_participate (pool_hose ph) OB_HIDDEN;
 ob_retort pool_net_withdraw (pool_hose ph) OB_HIDDEN;
@@ -314,6 +397,23 @@ OB_PLASMA_API ob_retort pool_net_server_await (pool_hose ph, pool_net_data *net,
                                                pool_timestamp *ret_ts,
                                                int64 *ret_index);
 
+/**
+ * Non-blocking counterpart of pool_net_server_await(), for servers
+ * that multiplex many clients.  Sets up await state on \a ph and
+ * returns the handle which becomes readable whenever a protein is
+ * deposited into its pool.  The handle stays valid (and keeps
+ * receiving notifications) until \a ph is withdrawn; call
+ * pool_net_server_notifier_drain() to reset it after each wakeup.
+ */
+OB_PLASMA_API ob_retort pool_net_server_notifier_arm (pool_hose ph,
+                                                      ob_handle_t *handle);
+
+/**
+ * Consume any pending notifications on a handle obtained from
+ * pool_net_server_notifier_arm().
+ */
+OB_PLASMA_API void pool_net_server_notifier_drain (pool_hose ph);
+
 OB_PLASMA_API void
 pool_net_adjust_timeout_value_for_version (pool_timestamp *timeout,
                                            unt8 net_version);
@@ -7,6 +7,7 @@
 #include <stddef.h>                // for size_t
 #include "libLoam/c/ob-retorts.h"  // for ob_retort
 #include "libLoam/c/ob-file.h"
+#include "libPlasma/c/private/pool-portable.h"  // for ob_handle_t
 
 #ifdef __cplusplus
 extern "C" {
@@ -48,6 +49,16 @@ OB_PLASMA_API ob_retort pool_tcp_recv_nbytes (ob_sock_t fd, void *buf,
 
 #endif
 
+struct pool_net_iov;
+
+/**
+ * Send several buffers over a TCP connection, one after another.
+ * (This is pool_net_data's send_iov.)
+ */
+OB_PLASMA_API ob_retort pool_tcp_send_iov (ob_sock_t fd,
+                                           const struct pool_net_iov *iov,
+                                           int n, ob_handle_t wake_event);
+
 /**
  * Default port for a pool TCP server to listen on.
  */
@@ -65,8 +76,9 @@ OB_PLASMA_API ob_retort pool_tcp_recv_nbytes (ob_sock_t fd, void *buf,
 #define str(s) #s
 #define POOL_TCP_PORT_STR xstr (POOL_TCP_PORT)
 
-#define POOL_TCP_VERSION_CURRENT 3
+#define POOL_TCP_VERSION_CURRENT 4
 #define POOL_TCP_VERSION_WITH_NEW_PCREATINGLY_CODES 3
+#define POOL_TCP_VERSION_WITH_BINARY_FRAMES 4
 
 /**
  * Used by pool server to get error string from errno or WSAGetLastError().
@@ -8,6 +8,8 @@
  * There are two implementations of locking: semaphores (pool_sem_ops,
  * which used to be the only way) and flock (pool_flock_ops).  See
  * bug 3770 for all the gory details of how we got here and why.
+ * On Linux, there is a third: futexes in the pool header itself
+ * (pool_futex_ops), for pools created with the "futex" option.
  */
 
 #ifndef SEM_OPS_RESEARCH
@@ -44,6 +46,12 @@ extern OB_HIDDEN const pool_lock_ops pool_sem_ops;
  */
 extern OB_HIDDEN const pool_lock_ops pool_flock_ops;
 
+/**
+ * Implementation of pool_lock_ops using robust futexes stored in the
+ * mmap pool header.  Linux only.
+ */
+extern OB_HIDDEN const pool_lock_ops pool_futex_ops;
+
 /**
  * Non-implementation of pool_lock_ops.
  */
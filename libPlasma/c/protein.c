@@ -2,6 +2,8 @@
 /* (c)  oblong industries */
 
 #include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-coerce.h"
 #include "libPlasma/c/private/plasma-private.h"
 #include "libLoam/c/ob-log.h"
 
@@ -293,11 +295,16 @@ int64 protein_search (bprotein haystack, bslaw needle)
 
 typedef int64 (*search_func) (bslaw s, bslaw search);
 
+static int64 filter_search (bprotein haystack, bslaw filter);
+
 int64 protein_search_ex (bprotein haystack, bslaw needle,
                          Protein_Search_Type how)
 {
   search_func func;
 
+  if (slaw_is_protein_filter (needle))
+    return filter_search (haystack, needle);
+
   switch (how)
     {
       case SEARCH_GAP:
@@ -314,3 +321,85 @@ int64 protein_search_ex (bprotein haystack, bslaw needle,
             ? func
             : slaw_list_find) (protein_descrips (haystack), needle);
 }
+
+
+#define FILTER_DESCRIP "protein-filter"
+
+protein protein_filter (bslaw descrips, Protein_Search_Type how,
+                        bslaw ingests, int64 min_rude, int64 max_rude)
+{
+  slabu *sb = slabu_new ();
+  if (!sb)
+    return NULL;
+  if (descrips)
+    {
+      slabu_map_put_cl (sb, "descrips", descrips);
+      slabu_map_put_cc (sb, "how", how == SEARCH_CONTIG ? "contig" : "gap");
+    }
+  if (ingests)
+    slabu_map_put_cl (sb, "ingests", ingests);
+  if (min_rude >= 0)
+    slabu_map_put_cf (sb, "min-rude", slaw_int64 (min_rude));
+  if (max_rude >= 0)
+    slabu_map_put_cf (sb, "max-rude", slaw_int64 (max_rude));
+  return protein_from_ff (slaw_list_inline_c (FILTER_DESCRIP, NULL),
+                          slaw_map_f (sb));
+}
+
+bool slaw_is_protein_filter (bslaw s)
+{
+  if (!slaw_is_protein (s))
+    return false;
+  bslaw des = protein_descrips (s);
+  return (slaw_list_count (des) == 1
+          && slawx_equal_lc (slaw_list_emit_first (des), FILTER_DESCRIP));
+}
+
+static bool rude_bound_ok (bslaw bound, int64 len, bool is_min)
+{
+  int64 n;
+  if (!bound || slaw_to_int64 (bound, &n) < OB_OK || n < 0)
+    return true;
+  return (is_min ? len >= n : len <= n);
+}
+
+/// Returns the index of the descrip match (or 0 if the filter doesn't
+/// care about descrips) if \a haystack passes \a filter, or -1 if not.
+
+static int64 filter_search (bprotein haystack, bslaw filter)
+{
+  bslaw f = protein_ingests (filter);
+
+  int64 rude_len = 0;
+  protein_rude (haystack, &rude_len);
+  if (!rude_bound_ok (slaw_map_find_c (f, "min-rude"), rude_len, true)
+      || !rude_bound_ok (slaw_map_find_c (f, "max-rude"), rude_len, false))
+    return -1;
+
+  bslaw want = slaw_map_find_c (f, "ingests");
+  if (want)
+    {
+      bslaw ingests = protein_ingests (haystack);
+      bslaw cole;
+      for (cole = slaw_list_emit_first (want); cole != NULL;
+           cole = slaw_list_emit_next (want, cole))
+        {
+          bslaw val = slaw_map_find (ingests, slaw_cons_emit_car (cole));
+          bslaw wanted = slaw_cons_emit_cdr (cole);
+          if (!val || !(slaw_is_nil (wanted) || slawx_equal (val, wanted)))
+            return -1;
+        }
+    }
+
+  bslaw descrips = slaw_map_find_c (f, "descrips");
+  if (!descrips)
+    return 0;
+  const Protein_Search_Type how =
+    (slawx_equal_lc (slaw_map_find_c (f, "how"), "contig") ? SEARCH_CONTIG
+                                                          : SEARCH_GAP);
+  // A filter can't name another filter as its descrips, so this
+  // doesn't recurse any further.
+  if (slaw_is_protein_filter (descrips))
+    return -1;
+  return protein_search_ex (haystack, descrips, how);
+}
@@ -65,6 +65,34 @@ OB_PLASMA_API int64 protein_search (bprotein haystack, bslaw needle);
 OB_PLASMA_API int64 protein_search_ex (bprotein haystack, bslaw needle,
                                        Protein_Search_Type how);
 
+/**
+ * Makes a protein filter: a search pattern which can be given to
+ * protein_search(), pool_probe_frwd(), pool_await_probe_frwd(),
+ * pool_probe_back() or pool_hose_set_filter(), and which matches a
+ * protein if all of the following hold:
+ *
+ * - \a descrips is NULL, or matches the protein's descrips the way
+ *   protein_search_ex() with \a how would
+ * - each key in the map \a ingests (if not NULL) is among the
+ *   protein's ingests, with an equal value, or with any value at all
+ *   if the value in \a ingests is nil
+ * - the protein has at least \a min_rude and at most \a max_rude
+ *   bytes of rude data (a negative bound means no bound)
+ *
+ * Over TCP, a server which supports it evaluates the filter itself
+ * (see POOL_CMD_FILTERS), so that proteins which don't match never
+ * cross the network.  The filter is itself a protein (with the single
+ * descrip "protein-filter"); free it with protein_free().
+ */
+OB_PLASMA_API protein protein_filter (bslaw descrips, Protein_Search_Type how,
+                                      bslaw ingests, int64 min_rude,
+                                      int64 max_rude);
+
+/**
+ * Returns true if \a s is a filter made by protein_filter().
+ */
+OB_PLASMA_API bool slaw_is_protein_filter (bslaw s);
+
 //
 //
 //
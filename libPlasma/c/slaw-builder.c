@@ -0,0 +1,636 @@
+/* (c)  oblong industries */
+
+// Builds slawx into one growing buffer; see slaw-builder.h.
+//
+// Everything is kept as oct offsets into the buffer, rather than
+// pointers, since the buffer moves when it grows.  Each container
+// gets a one-oct header when it's begun, which is filled in when
+// it's ended; the rare container with too many elements for a wee
+// header gets its contents moved up an oct at that point.
+
+#include "libPlasma/c/slaw-builder.h"
+#include "libPlasma/c/private/plasma-private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Where the buffer starts, if we have no better idea
+#define INITIAL_OCTS 64
+
+// Maps with more entries than this have their keys checked for
+// duplicates with a hash table, rather than by comparing every pair
+#define FEW_ENOUGH_TO_COMPARE 8
+
+typedef enum {
+  FRAME_LIST,
+  FRAME_MAP,
+  FRAME_CONS,
+  FRAME_PROTEIN,
+  FRAME_DESCRIPS,
+  FRAME_INGESTS
+} frame_kind;
+
+/// Where something is in the buffer; an empty one isn't there at all.
+typedef struct region
+{
+  unt64 at;   // in octs
+  unt64 len;  // in octs
+} region;
+
+/// Something we've begun and not yet ended.
+typedef struct builder_frame
+{
+  frame_kind kind;
+  // for containers, where the header is; for descrips and ingests,
+  // where the slaw inside them will be
+  unt64 start;
+  int64 count;
+  // the rest only matter for proteins
+  region descrips;
+  region ingests;
+  region rude;
+  int64 rude_len;  // in bytes
+  bool has_rude;
+} builder_frame;
+
+struct slaw_builder
+{
+  slaw buf;
+  unt64 used;
+  unt64 capacity;
+  // how big the last slaw we built was
+  unt64 last_len;
+
+  builder_frame *frames;
+  int64 depth;
+  int64 max_depth;
+
+  // hash table for checking map keys: oct offsets of conses, or -1
+  int64 *seen;
+  unt64 seen_slots;
+};
+
+slaw_builder *slaw_builder_new (void)
+{
+  return (slaw_builder *) calloc (1, sizeof (slaw_builder));
+}
+
+void slaw_builder_free (slaw_builder *b)
+{
+  if (!b)
+    return;
+  free (b->buf);
+  free (b->frames);
+  free (b->seen);
+  free (b);
+}
+
+int64 slaw_builder_depth (const slaw_builder *b)
+{
+  return b ? b->depth : 0;
+}
+
+static inline builder_frame *top_frame (slaw_builder *b)
+{
+  return b->depth > 0 ? &b->frames[b->depth - 1] : NULL;
+}
+
+/// Makes room for \a octs more octs at the end of the buffer, and
+/// returns where they start (which is only good until the next time
+/// the buffer grows).
+static slaw append (slaw_builder *b, unt64 octs)
+{
+  if (octs > b->capacity - b->used)
+    {
+      unt64 cap = b->capacity;
+      if (cap == 0)
+        cap = (b->last_len > INITIAL_OCTS ? b->last_len : INITIAL_OCTS);
+      while (octs > cap - b->used)
+        {
+          if (cap > (SLAW_OCTLEN_MASK >> 1))
+            return NULL;
+          cap *= 2;
+        }
+      slaw buf = (slaw) realloc (b->buf, (size_t) cap * sizeof (struct _slaw));
+      if (!buf)
+        return NULL;
+      b->buf = buf;
+      b->capacity = cap;
+    }
+  slaw s = b->buf + b->used;
+  b->used += octs;
+  return s;
+}
+
+/// Checks that another slaw can go where we are now, and counts it.
+static ob_retort note_child (slaw_builder *b)
+{
+  builder_frame *f = top_frame (b);
+  if (!f)
+    // only one slaw at a time
+    return (b->used > 0 ? SLAW_FABRICATOR_BADNESS : OB_OK);
+  switch (f->kind)
+    {
+      case FRAME_PROTEIN:
+        return SLAW_FABRICATOR_BADNESS;
+      case FRAME_CONS:
+        if (f->count >= 2)
+          return SLAW_FABRICATOR_BADNESS;
+        break;
+      case FRAME_DESCRIPS:
+      case FRAME_INGESTS:
+        if (f->count >= 1)
+          return SLAW_FABRICATOR_BADNESS;
+        break;
+      default:
+        break;
+    }
+  f->count++;
+  return OB_OK;
+}
+
+static ob_retort push_frame (slaw_builder *b, frame_kind kind, unt64 start)
+{
+  if (b->depth == b->max_depth)
+    {
+      const int64 n = (b->max_depth ? 2 * b->max_depth : 8);
+      builder_frame *frames =
+        (builder_frame *) realloc (b->frames, n * sizeof (builder_frame));
+      if (!frames)
+        return OB_NO_MEM;
+      b->frames = frames;
+      b->max_depth = n;
+    }
+  builder_frame *f = &b->frames[b->depth++];
+  memset (f, 0, sizeof (*f));
+  f->kind = kind;
+  f->start = start;
+  return OB_OK;
+}
+
+static ob_retort begin_container (slaw_builder *b, frame_kind kind)
+{
+  if (!b)
+    return OB_ARGUMENT_WAS_NULL;
+  ob_retort tort = note_child (b);
+  if (tort < OB_OK)
+    return tort;
+  const unt64 start = b->used;
+  // one oct for the header; proteins have a second
+  if (!append (b, kind == FRAME_PROTEIN ? 2 : 1))
+    return OB_NO_MEM;
+  return push_frame (b, kind, start);
+}
+
+ob_retort slaw_builder_begin_list (slaw_builder *b)
+{
+  return begin_container (b, FRAME_LIST);
+}
+
+ob_retort slaw_builder_begin_map (slaw_builder *b)
+{
+  return begin_container (b, FRAME_MAP);
+}
+
+ob_retort slaw_builder_begin_cons (slaw_builder *b)
+{
+  return begin_container (b, FRAME_CONS);
+}
+
+ob_retort slaw_builder_begin_protein (slaw_builder *b)
+{
+  return begin_container (b, FRAME_PROTEIN);
+}
+
+static ob_retort begin_part (slaw_builder *b, frame_kind kind)
+{
+  if (!b)
+    return OB_ARGUMENT_WAS_NULL;
+  builder_frame *f = top_frame (b);
+  if (!f || f->kind != FRAME_PROTEIN)
+    return SLAW_FABRICATOR_BADNESS;
+  return push_frame (b, kind, b->used);
+}
+
+ob_retort slaw_builder_begin_descrips (slaw_builder *b)
+{
+  return begin_part (b, FRAME_DESCRIPS);
+}
+
+ob_retort slaw_builder_begin_ingests (slaw_builder *b)
+{
+  return begin_part (b, FRAME_INGESTS);
+}
+
+static void write_container_header (slaw_builder *b, const builder_frame *f,
+                                    unt64 nibble, int64 count)
+{
+  const unt64 wee_count =
+    (count < SLAW_MAX_WEE_CONTAINER ? count : SLAW_MAX_WEE_CONTAINER);
+  b->buf[f->start].o = ((nibble << SLAW_NIBBLE_SHIFTY)
+                        | (wee_count << SLAW_WEE_CONTAINER_COUNT_SHIFTY)
+                        | (b->used - f->start));
+}
+
+/// Fills in the header of a list or map; if it has too many elements
+/// for a wee header, moves them up to make room for the count.
+static ob_retort end_container (slaw_builder *b, const builder_frame *f,
+                                unt64 nibble)
+{
+  if (f->count >= SLAW_MAX_WEE_CONTAINER)
+    {
+      const unt64 body = b->used - f->start - 1;
+      if (!append (b, 1))
+        return OB_NO_MEM;
+      slaw s = b->buf + f->start + 1;
+      memmove (s + 1, s, body * sizeof (struct _slaw));
+      s->o = f->count;
+    }
+  write_container_header (b, f, nibble, f->count);
+  return OB_OK;
+}
+
+/// Returns true if the \a n elements starting at \a s are all conses,
+/// with no two cars the same; which is to say, if they already make
+/// a map that slaw_map() wouldn't change.
+static bool obeys_map_invariant (slaw_builder *b, bslaw s, int64 n)
+{
+  bslaw first = s;
+  int64 i, j;
+  for (i = 0; i < n; i++, s += slaw_octlen (s))
+    if (!slaw_is_cons (s))
+      return false;
+
+  if (n <= FEW_ENOUGH_TO_COMPARE)
+    {
+      bslaw car = first;
+      for (i = 0; i < n; i++, car += slaw_octlen (car))
+        {
+          bslaw other = car + slaw_octlen (car);
+          for (j = i + 1; j < n; j++, other += slaw_octlen (other))
+            // the car of a cons is right after its (wee) header
+            if (slawx_equal (car + 1, other + 1))
+              return false;
+        }
+      return true;
+    }
+
+  unt64 slots = 16;
+  while (slots < 2 * (unt64) n)
+    slots *= 2;
+  if (slots > b->seen_slots)
+    {
+      int64 *seen = (int64 *) realloc (b->seen, slots * sizeof (int64));
+      if (!seen)
+        return false;  // slaw_map() can sort it out
+      b->seen = seen;
+      b->seen_slots = slots;
+    }
+  memset (b->seen, -1, slots * sizeof (int64));
+  const unt64 mask = slots - 1;
+
+  for (i = 0, s = first; i < n; i++, s += slaw_octlen (s))
+    {
+      unt64 h = slaw_hash (s + 1) & mask;
+      for (; b->seen[h] >= 0; h = (h + 1) & mask)
+        if (slawx_equal (s + 1, b->buf + b->seen[h] + 1))
+          return false;
+      b->seen[h] = s - b->buf;
+    }
+  return true;
+}
+
+/// The slow way to end a map, when it has things in it that
+/// slaw_map() would throw out: let slaw_map() do that, and then
+/// copy its map over ours.
+static ob_retort rebuild_map (slaw_builder *b, const builder_frame *f)
+{
+  slabu *sb = slabu_new ();
+  if (!sb)
+    return OB_NO_MEM;
+  bslaw s = b->buf + f->start + 1;
+  int64 i;
+  for (i = 0; i < f->count; i++, s += slaw_octlen (s))
+    if (slabu_list_add_z (sb, s) < 0)
+      {
+        slabu_free (sb);
+        return OB_NO_MEM;
+      }
+  slaw m = slaw_map_f (sb);
+  if (!m)
+    {
+      slabu_free (sb);
+      return OB_NO_MEM;
+    }
+  // only ever smaller than what it replaces
+  const unt64 len = slaw_octlen (m);
+  memcpy (b->buf + f->start, m, len * sizeof (struct _slaw));
+  b->used = f->start + len;
+  slaw_free (m);
+  return OB_OK;
+}
+
+static ob_retort end_map (slaw_builder *b, const builder_frame *f)
+{
+  if (obeys_map_invariant (b, b->buf + f->start + 1, f->count))
+    return end_container (b, f, SLAW_NIB_MAP);
+  return rebuild_map (b, f);
+}
+
+/// Fills in a protein's two header octs.  Its descrips, ingests and
+/// rude data usually came in that order, and are already where they
+/// belong; if not, they're put in order now.
+static ob_retort end_protein (slaw_builder *b, const builder_frame *f)
+{
+  const bool wee_rude = (f->rude_len <= 7);
+  const unt64 payload = f->start + 2;
+  unt64 at = payload;
+  bool in_order = (f->descrips.len == 0 || f->descrips.at == at);
+  at += f->descrips.len;
+  in_order = in_order && (f->ingests.len == 0 || f->ingests.at == at);
+  at += f->ingests.len;
+  in_order = in_order && (f->rude.len == 0 || f->rude.at == at);
+  at += f->rude.len;
+  in_order = in_order && (at == b->used);
+
+  byte wee[8];
+  if (wee_rude && f->rude_len > 0)
+    memcpy (wee, b->buf + f->rude.at, f->rude_len);
+
+  if (in_order)
+    {
+      // wee rude data goes in the header instead
+      if (wee_rude)
+        b->used -= f->rude.len;
+    }
+  else
+    {
+      const unt64 len =
+        f->descrips.len + f->ingests.len + (wee_rude ? 0 : f->rude.len);
+      slaw tmp = slaw_alloc (len > 0 ? len : 1);
+      if (!tmp)
+        return OB_NO_MEM;
+      slaw to = tmp;
+      memcpy (to, b->buf + f->descrips.at,
+              f->descrips.len * sizeof (struct _slaw));
+      to += f->descrips.len;
+      memcpy (to, b->buf + f->ingests.at,
+              f->ingests.len * sizeof (struct _slaw));
+      to += f->ingests.len;
+      if (!wee_rude)
+        memcpy (to, b->buf + f->rude.at, f->rude.len * sizeof (struct _slaw));
+      memcpy (b->buf + payload, tmp, len * sizeof (struct _slaw));
+      b->used = payload + len;
+      slaw_free (tmp);
+    }
+
+  const unt64 oLen = b->used - f->start;
+  slaw_oct oct2 = 0;
+  if (f->descrips.len > 0)
+    oct2 |= SLAW_PROTEIN_DESCRIPS_FLAG;
+  if (f->ingests.len > 0)
+    oct2 |= SLAW_PROTEIN_INGESTS_FLAG;
+  if (wee_rude)
+    oct2 |= ((unt64) f->rude_len << SLAW_PROTEIN_WEE_RUDE_SHIFTY);
+  else
+    oct2 |= (SLAW_PROTEIN_VERY_RUDE_FLAG | f->rude_len);
+
+  slaw p = b->buf + f->start;
+  p[0].o = SLAW_PROTEIN_ILK | (oLen & 0xf) | ((oLen & ~0xf) << 4);
+  p[1].o = oct2;
+  if (wee_rude && f->rude_len > 0)
+    memcpy (SLAW_SPECIAL_BYTES (p + 1, f->rude_len), wee, f->rude_len);
+  return OB_OK;
+}
+
+ob_retort slaw_builder_end (slaw_builder *b)
+{
+  if (!b)
+    return OB_ARGUMENT_WAS_NULL;
+  builder_frame *f = top_frame (b);
+  if (!f)
+    return SLAW_FABRICATOR_BADNESS;
+
+  ob_retort tort = OB_OK;
+  region *part;
+  switch (f->kind)
+    {
+      case FRAME_LIST:
+        tort = end_container (b, f, SLAW_NIB_LIST);
+        break;
+      case FRAME_MAP:
+        tort = end_map (b, f);
+        break;
+      case FRAME_CONS:
+        if (f->count != 2)
+          return SLAW_FABRICATOR_BADNESS;
+        write_container_header (b, f, SLAW_NIB_CONS, 2);
+        break;
+      case FRAME_PROTEIN:
+        tort = end_protein (b, f);
+        break;
+      case FRAME_DESCRIPS:
+      case FRAME_INGESTS:
+        part = (f->kind == FRAME_DESCRIPS ? &f[-1].descrips : &f[-1].ingests);
+        part->at = f->start;
+        part->len = b->used - f->start;
+        break;
+    }
+  if (tort >= OB_OK)
+    b->depth--;
+  return tort;
+}
+
+ob_retort slaw_builder_add (slaw_builder *b, bslaw s)
+{
+  if (!b || !s)
+    return OB_ARGUMENT_WAS_NULL;
+  ob_retort tort = note_child (b);
+  if (tort < OB_OK)
+    return tort;
+  const unt64 len = slaw_octlen (s);
+  slaw to = append (b, len);
+  if (!to)
+    return OB_NO_MEM;
+  memcpy (to, s, len * sizeof (struct _slaw));
+  return OB_OK;
+}
+
+ob_retort slaw_builder_add_nil (slaw_builder *b)
+{
+  if (!b)
+    return OB_ARGUMENT_WAS_NULL;
+  ob_retort tort = note_child (b);
+  if (tort < OB_OK)
+    return tort;
+  slaw s = append (b, 1);
+  if (!s)
+    return OB_NO_MEM;
+  s->o = SLAW_NIL_ILK;
+  return OB_OK;
+}
+
+ob_retort slaw_builder_add_boolean (slaw_builder *b, bool v)
+{
+  if (!b)
+    return OB_ARGUMENT_WAS_NULL;
+  ob_retort tort = note_child (b);
+  if (tort < OB_OK)
+    return tort;
+  slaw s = append (b, 1);
+  if (!s)
+    return OB_NO_MEM;
+  s->o = SLAW_BOOL_ILK | (unt64) !!v;
+  return OB_OK;
+}
+
+ob_retort slaw_builder_add_string (slaw_builder *b, const char *str)
+{
+  if (!str)
+    return OB_ARGUMENT_WAS_NULL;
+  return slaw_builder_add_substring (b, str, strlen (str));
+}
+
+// Same encoding as slaw_string_raw()
+ob_retort slaw_builder_add_substring (slaw_builder *b, const char *str,
+                                      int64 len)
+{
+  if (!b || !str)
+    return OB_ARGUMENT_WAS_NULL;
+  if (len < 0)
+    return OB_INVALID_ARGUMENT;
+  ob_retort tort = note_child (b);
+  if (tort < OB_OK)
+    return tort;
+
+  const unt64 term_len = len + 1; /* add a byte for terminating NUL */
+  slaw s;
+  if (len < 7)
+    {
+      if (!(s = append (b, 1)))
+        return OB_NO_MEM;
+      s->o = ((((slaw_oct) SLAW_NIB_WEE_STRING) << SLAW_NIBBLE_SHIFTY)
+              | (term_len << SLAW_WEE_STRING_LEN_SHIFTY));
+      memcpy (SLAW_SPECIAL_BYTES (s, term_len), str, len);
+      return OB_OK;
+    }
+
+  const unt64 pad_octs = (term_len + 7) / 8;
+  const unt64 pad_bytes = 8 * pad_octs - term_len;
+  if (!(s = append (b, 1 + pad_octs)))
+    return OB_NO_MEM;
+  s->o = ((((slaw_oct) SLAW_NIB_FULL_STRING) << SLAW_NIBBLE_SHIFTY)
+          | (pad_bytes << SLAW_FULL_STRING_PAD_SHIFTY) | (1 + pad_octs));
+  s[pad_octs].o = 0; /* the NUL, and the padding */
+  memcpy (s + 1, str, len);
+  return OB_OK;
+}
+
+ob_retort private_slaw_builder_add_numeric (slaw_builder *b, slaw_oct ilk,
+                                            unt32 unit_blen, int64 breadth,
+                                            const void *data)
+{
+  if (!b)
+    return OB_ARGUMENT_WAS_NULL;
+  if (unit_blen < 1 || unit_blen > SLAW_NUMERIC_MAX_UNIT_BSIZE + 1)
+    return SLAW_FABRICATOR_BADNESS;
+  ob_retort tort = note_child (b);
+  if (tort < OB_OK)
+    return tort;
+
+  slaw s;
+  if (breadth < 0)
+    {
+      // Same encoding as slaw_int32() and friends
+      const bool wee = (unit_blen <= 4);
+      const unt64 octs = (wee ? 0 : (unit_blen + 7) / 8);
+      if (!(s = append (b, 1 + octs)))
+        return OB_NO_MEM;
+      s->o = ilk | SLAW_NUMERIFY (unit_blen);
+      if (wee)
+        memcpy (SLAW_SPECIAL_BYTES (s, unit_blen), data, unit_blen);
+      else
+        {
+          s[octs].o = 0; /* make sure padding is initialized */
+          memcpy (s + 1, data, unit_blen);
+        }
+      return OB_OK;
+    }
+
+  // Same encoding as slaw_numeric_array_raw()
+  const unt64 bytes = (unt64) unit_blen * breadth;
+  const unt64 octs = (bytes + 7) / 8;
+  if (!(s = append (b, 1 + octs)))
+    return OB_NO_MEM;
+  s->o = (ilk | SLAW_NUMERIFY (unit_blen) | breadth | SLAW_NUMERIC_ARRAY_ILK);
+  if (0 != (7 & bytes))
+    s[octs].o = 0; /* make sure padding is initialized */
+  if (bytes > 0)
+    memcpy (s + 1, data, bytes);
+  return OB_OK;
+}
+
+ob_retort slaw_builder_add_int64 (slaw_builder *b, int64 v)
+{
+  return private_slaw_builder_add_numeric (b, SLAW_int64, sizeof (v), -1, &v);
+}
+
+ob_retort slaw_builder_add_unt64 (slaw_builder *b, unt64 v)
+{
+  return private_slaw_builder_add_numeric (b, SLAW_unt64, sizeof (v), -1, &v);
+}
+
+ob_retort slaw_builder_add_float64 (slaw_builder *b, float64 v)
+{
+  return private_slaw_builder_add_numeric (b, SLAW_float64, sizeof (v), -1,
+                                           &v);
+}
+
+ob_retort slaw_builder_add_rude_data (slaw_builder *b, const void *d,
+                                      int64 len)
+{
+  if (!b)
+    return OB_ARGUMENT_WAS_NULL;
+  if (len < 0 || (len > 0 && !d))
+    return OB_INVALID_ARGUMENT;
+  builder_frame *f = top_frame (b);
+  if (!f || f->kind != FRAME_PROTEIN || f->has_rude)
+    return SLAW_FABRICATOR_BADNESS;
+
+  const unt64 octs = (len + 7) / 8;
+  if (octs > 0)
+    {
+      const unt64 at = b->used;
+      slaw s = append (b, octs);
+      if (!s)
+        return OB_NO_MEM;
+      s[octs - 1].o = 0; /* initialize padding */
+      memcpy (s, d, len);
+      f->rude.at = at;
+      f->rude.len = octs;
+    }
+  f->rude_len = len;
+  f->has_rude = true;
+  return OB_OK;
+}
+
+slaw slaw_builder_finish (slaw_builder *b)
+{
+  if (!b)
+    return NULL;
+  slaw s = NULL;
+  if (b->depth == 0 && b->used > 0)
+    {
+      // Hand over the buffer itself, trimmed to fit
+      s = (slaw) realloc (b->buf, (size_t) b->used * sizeof (struct _slaw));
+      if (!s)
+        free (b->buf);
+      b->last_len = b->used;
+    }
+  else
+    free (b->buf);
+  b->buf = NULL;
+  b->used = b->capacity = 0;
+  b->depth = 0;
+  return s;
+}
@@ -0,0 +1,158 @@
+/* (c)  oblong industries */
+
+#ifndef SLAW_BUILDER_BOB
+#define SLAW_BUILDER_BOB
+
+/*
+  Building a big slaw the usual way (slabu_list_add(), slaw_list(),
+  slaw_map_put(), protein_from_ff() and friends) allocates every
+  element separately, and then copies them all again into each
+  container that holds them, so a protein with a 200-entry ingests
+  map costs hundreds of mallocs and several copies of the whole
+  thing.
+
+  A slaw_builder instead writes each slaw straight into one growing
+  buffer, already encoded, in the order you give them to it.  You
+  begin a container, add its elements (or begin and end containers
+  inside it), and end it; the builder goes back and fills in the
+  container's header once it knows how long it is.  When the
+  outermost slaw is done, slaw_builder_finish() hands it to you.
+
+      slaw_builder *b = slaw_builder_new ();
+      slaw_builder_begin_protein (b);
+      slaw_builder_begin_descrips (b);
+      slaw_builder_begin_list (b);
+      slaw_builder_add_string (b, "hello");
+      slaw_builder_end (b);              // the list
+      slaw_builder_end (b);              // the descrips
+      slaw_builder_begin_ingests (b);
+      slaw_builder_begin_map (b);
+      slaw_builder_begin_cons (b);
+      slaw_builder_add_string (b, "x");
+      slaw_builder_add_int64 (b, 7);
+      slaw_builder_end (b);              // the cons
+      slaw_builder_end (b);              // the map
+      slaw_builder_end (b);              // the ingests
+      slaw_builder_end (b);              // the protein
+      protein p = slaw_builder_finish (b);
+
+  The builder keeps its buffer's size in mind, so if you use the same
+  one over and over to build similar slawx, each one usually costs a
+  single allocation.  (The slaw_fabricator in slaw-walk.h, which the
+  YAML reader uses, is built on a slaw_builder.)
+
+  Maps made this way obey the same rules as maps made by slaw_map():
+  anything which isn't a cons is dropped, and if a key appears more
+  than once, the last value wins, in the position of the first.
+
+  None of these functions are thread-safe on the same builder.
+*/
+
+#include "libLoam/c/ob-api.h"
+#include "libLoam/c/ob-retorts.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/plasma-retorts.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct slaw_builder;
+/**
+ * Builds one slaw at a time into a single buffer.
+ */
+typedef struct slaw_builder slaw_builder;
+
+/**
+ * Allocates a new, empty slaw_builder, or returns NULL if out of memory.
+ */
+OB_PLASMA_API slaw_builder *slaw_builder_new (void);
+
+/**
+ * Frees a slaw_builder, and anything half-built in it.
+ */
+OB_PLASMA_API void slaw_builder_free (slaw_builder *b);
+
+/**
+ * Begins a list, map, cons or protein, which becomes the next
+ * element of whatever container is currently being built (or the
+ * slaw being built, if there isn't one).  Everything added until
+ * the matching slaw_builder_end() goes inside it.
+ *
+ * A cons must end up with exactly two elements.  A protein's
+ * contents go inside slaw_builder_begin_descrips() and
+ * slaw_builder_begin_ingests(), plus slaw_builder_add_rude_data().
+ *
+ * All of these, and all the slaw_builder_add functions, return
+ * SLAW_FABRICATOR_BADNESS if the slaw can't go where you're trying
+ * to put it (e.g. a third element in a cons, or a second slaw when
+ * the first one hasn't been finished yet), or OB_NO_MEM.
+ */
+OB_PLASMA_API ob_retort slaw_builder_begin_list (slaw_builder *b);
+OB_PLASMA_API ob_retort slaw_builder_begin_map (slaw_builder *b);
+OB_PLASMA_API ob_retort slaw_builder_begin_cons (slaw_builder *b);
+OB_PLASMA_API ob_retort slaw_builder_begin_protein (slaw_builder *b);
+
+/**
+ * Inside a protein, begins its descrips or ingests, which should be
+ * a single slaw (usually a list for the descrips, and a map for the
+ * ingests).  If you end it without adding anything, the protein
+ * doesn't have any.  If you give either one twice, the second one
+ * wins.
+ */
+OB_PLASMA_API ob_retort slaw_builder_begin_descrips (slaw_builder *b);
+OB_PLASMA_API ob_retort slaw_builder_begin_ingests (slaw_builder *b);
+
+/**
+ * Ends whatever was begun most recently.
+ */
+OB_PLASMA_API ob_retort slaw_builder_end (slaw_builder *b);
+
+/**
+ * Copies \a s into the slaw being built.
+ */
+OB_PLASMA_API ob_retort slaw_builder_add (slaw_builder *b, bslaw s);
+
+/**
+ * Add a slaw of a particular type without making it first; each is
+ * like slaw_builder_add() of the slaw that slaw_nil(),
+ * slaw_boolean(), etc. would return.
+ */
+OB_PLASMA_API ob_retort slaw_builder_add_nil (slaw_builder *b);
+OB_PLASMA_API ob_retort slaw_builder_add_boolean (slaw_builder *b, bool v);
+OB_PLASMA_API ob_retort slaw_builder_add_string (slaw_builder *b,
+                                                 const char *str);
+OB_PLASMA_API ob_retort slaw_builder_add_substring (slaw_builder *b,
+                                                    const char *str,
+                                                    int64 len);
+OB_PLASMA_API ob_retort slaw_builder_add_int64 (slaw_builder *b, int64 v);
+OB_PLASMA_API ob_retort slaw_builder_add_unt64 (slaw_builder *b, unt64 v);
+OB_PLASMA_API ob_retort slaw_builder_add_float64 (slaw_builder *b,
+                                                  float64 v);
+
+/**
+ * Inside a protein, copies \a len bytes of rude data from \a d.
+ * A protein can only have one lot of rude data.
+ */
+OB_PLASMA_API ob_retort slaw_builder_add_rude_data (slaw_builder *b,
+                                                    const void *d, int64 len);
+
+/**
+ * Returns how many containers have been begun and not yet ended.
+ */
+OB_PLASMA_API int64 slaw_builder_depth (const slaw_builder *b);
+
+/**
+ * Returns the slaw that was built, which you should free with
+ * slaw_free() as usual, and empties the builder so it can build
+ * another one.  Returns NULL (and still empties the builder) if
+ * nothing has been added, if a container hasn't been ended yet, or
+ * if out of memory.
+ */
+OB_PLASMA_API slaw slaw_builder_finish (slaw_builder *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SLAW_BUILDER_BOB */
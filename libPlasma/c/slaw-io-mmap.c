@@ -0,0 +1,326 @@
+/* (c)  oblong industries */
+
+// A slaw_input for binary slaw files which maps the whole file into
+// memory, instead of reading it through stdio.  That lets it lend
+// out slawx in place (see slaw_input_read_borrowed()), and since it
+// can find the start of each slaw without reading the slaw, it can
+// keep an index of where they all are and seek around in the file.
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-file.h"
+#include "libLoam/c/ob-endian.h"
+#include "libLoam/c/ob-sys.h"
+#include "libPlasma/c/slaw-io.h"
+#include "libPlasma/c/slaw-interop.h"
+#include "libPlasma/c/private/plasma-private.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#ifdef _MSC_VER
+
+ob_retort slaw_input_open_binary_mapped (const char *filename, slaw_input *f)
+{
+  // XXX: could use MapViewOfFile, as pool_mmap.c does
+  return slaw_input_open_binary (filename, f);
+}
+
+#else
+
+#define HEADER_LEN 8
+
+typedef struct mapped_slaw_input
+{
+  const byte *mem;
+  size_t size;
+  bool swap;
+  // byte offset and number of the slaw the next read returns
+  size_t pos;
+  int64 next;
+  // offsets[i] is where slaw i starts; we know where the first
+  // "known" slawx start, and "complete" says whether that's all
+  size_t *offsets;
+  int64 known;
+  int64 capacity;
+  bool complete;
+} mapped_slaw_input;
+
+static inline mapped_slaw_input *msi_of (slaw_input f)
+{
+  return (mapped_slaw_input *) f->data;
+}
+
+/// Remembers that slaw \a n starts at the current position, if it's
+/// the first one we don't know about yet.
+
+static ob_retort note_offset (mapped_slaw_input *msi)
+{
+  if (msi->next != msi->known)
+    return OB_OK;
+  if (msi->known == msi->capacity)
+    {
+      const int64 cap = (msi->capacity ? 2 * msi->capacity : 1024);
+      size_t *o = (size_t *) realloc (msi->offsets, cap * sizeof (size_t));
+      if (!o)
+        return OB_NO_MEM;
+      msi->offsets = o;
+      msi->capacity = cap;
+    }
+  msi->offsets[msi->known++] = msi->pos;
+  return OB_OK;
+}
+
+/// Steps over the slaw at the current position, setting \a s to
+/// where it starts and \a octlen to its length.  Only looks at the
+/// slaw's header.
+
+static ob_retort step (mapped_slaw_input *msi, bslaw *s, unt64 *octlen)
+{
+  const size_t left = msi->size - msi->pos;
+  if (left < sizeof (struct _slaw))
+    {
+      // Like binary_input_read(), treat a partial oct as the end
+      msi->complete = true;
+      return SLAW_END_OF_FILE;
+    }
+
+  struct _slaw head;
+  memcpy (&head, msi->mem + msi->pos, sizeof (head));
+  if (msi->swap)
+    head.o = ob_swap64 (head.o);
+  const unt64 len = slaw_octlen (&head);
+  if (len == 0)
+    return SLAW_UNIDENTIFIED_SLAW;
+  if (len > left / sizeof (struct _slaw))
+    {
+      OB_LOG_ERROR_CODE (0x20007000,
+                         "slaw %" OB_FMT_64 "d at offset %" OB_FMT_SIZE "u "
+                         "claims to be %" OB_FMT_64 "u octs,\n"
+                         "but only %" OB_FMT_SIZE "u bytes are left\n",
+                         msi->next, msi->pos, len, left);
+      return SLAW_CORRUPT_SLAW;
+    }
+
+  ob_retort err = note_offset (msi);
+  if (err < OB_OK)
+    return err;
+  *s = (bslaw) (msi->mem + msi->pos);
+  *octlen = len;
+  msi->pos += len * sizeof (struct _slaw);
+  msi->next++;
+  return OB_OK;
+}
+
+static ob_retort copy_out (const mapped_slaw_input *msi, bslaw from,
+                           unt64 octlen, slaw *s)
+{
+  slaw cole = slaw_alloc (octlen);
+  if (!cole)
+    return OB_NO_MEM;
+  memcpy (cole, from, octlen * sizeof (struct _slaw));
+  if (msi->swap)
+    {
+      ob_retort err = slaw_swap (cole, cole + octlen);
+      if (err < OB_OK)
+        {
+          slaw_free (cole);
+          return err;
+        }
+    }
+  *s = cole;
+  return OB_OK;
+}
+
+static ob_retort mapped_input_read (slaw_input f, slaw *s)
+{
+  mapped_slaw_input *msi = msi_of (f);
+  bslaw from;
+  unt64 octlen;
+  ob_retort err = step (msi, &from, &octlen);
+  if (err < OB_OK)
+    return err;
+  return copy_out (msi, from, octlen, s);
+}
+
+static ob_retort mapped_input_borrow (slaw_input f, bslaw *s)
+{
+  mapped_slaw_input *msi = msi_of (f);
+  bslaw from;
+  unt64 octlen;
+  ob_retort err = step (msi, &from, &octlen);
+  if (err < OB_OK)
+    return err;
+  if (!msi->swap)
+    {
+      *s = from;
+      return OB_OK;
+    }
+  // Has to be swapped, so slaw_input_read_borrowed() frees it later
+  err = copy_out (msi, from, octlen, &f->lent);
+  if (err >= OB_OK)
+    *s = f->lent;
+  return err;
+}
+
+/// Walks forward until the current slaw is \a n, or the end of the
+/// file; whichever comes first.
+
+static ob_retort walk_to (mapped_slaw_input *msi, int64 n)
+{
+  if (msi->known > 0 && msi->next < msi->known - 1)
+    {
+      // Start from the last one we know about
+      msi->next = msi->known - 1;
+      msi->pos = msi->offsets[msi->next];
+    }
+  while (msi->next < n)
+    {
+      bslaw s;
+      unt64 octlen;
+      ob_retort err = step (msi, &s, &octlen);
+      if (err < OB_OK)
+        return err;
+    }
+  return OB_OK;
+}
+
+static ob_retort mapped_input_seek (slaw_input f, int64 n)
+{
+  mapped_slaw_input *msi = msi_of (f);
+  if (n < msi->known)
+    {
+      msi->pos = msi->offsets[n];
+      msi->next = n;
+      return OB_OK;
+    }
+  const size_t pos = msi->pos;
+  const int64 next = msi->next;
+  ob_retort err = walk_to (msi, n);
+  if (err == SLAW_END_OF_FILE && msi->next == n)
+    // Seeking just past the last one is fine
+    err = OB_OK;
+  if (err < OB_OK)
+    {
+      msi->pos = pos;
+      msi->next = next;
+    }
+  return err;
+}
+
+static ob_retort mapped_input_count (slaw_input f, int64 *count)
+{
+  mapped_slaw_input *msi = msi_of (f);
+  if (!msi->complete)
+    {
+      const size_t pos = msi->pos;
+      const int64 next = msi->next;
+      ob_retort err = walk_to (msi, INT64_MAX);
+      msi->pos = pos;
+      msi->next = next;
+      if (err != SLAW_END_OF_FILE)
+        return err;
+    }
+  *count = msi->known;
+  return OB_OK;
+}
+
+static ob_retort mapped_input_close (void *data)
+{
+  mapped_slaw_input *msi = (mapped_slaw_input *) data;
+  ob_retort err = OB_OK;
+  if (munmap ((void *) msi->mem, msi->size) != 0)
+    err = ob_errno_to_retort (errno);
+  free (msi->offsets);
+  free (msi);
+  return err;
+}
+
+ob_retort slaw_input_open_binary_mapped (const char *filename, slaw_input *f)
+{
+  int fd = ob_open_cloexec (filename, O_RDONLY, 0);
+  if (fd < 0)
+    return ob_errno_to_retort (errno);
+
+  struct stat st;
+  if (fstat (fd, &st) != 0)
+    {
+      const int erryes = errno;
+      close (fd);
+      return ob_errno_to_retort (erryes);
+    }
+  if ((unt64) st.st_size > SIZE_MAX || st.st_size < HEADER_LEN)
+    {
+      // Too small to be a slaw file, or too big to map on this
+      // machine; either way, let the ordinary reader sort it out.
+      close (fd);
+      return slaw_input_open_binary (filename, f);
+    }
+
+  const size_t size = (size_t) st.st_size;
+  void *mem = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  const int erryes = errno;
+  // The mapping keeps the file around; we don't need the descriptor
+  close (fd);
+  if (mem == MAP_FAILED)
+    {
+      OB_LOG_ERROR_CODE (0x20007001, "mmap of '%s' (%" OB_FMT_SIZE
+                                     "u bytes) failed because '%s'\n",
+                         filename, size, strerror (erryes));
+      return ob_errno_to_retort (erryes);
+    }
+
+  unt8 version = ~0;
+  bool big_endian = false;
+  ob_retort err = private_check_binary_header ((const byte *) mem, &version,
+                                               &big_endian);
+  if (err >= OB_OK && version != SLAW_VERSION_CURRENT)
+    {
+      // Old slawx have to be converted as they're read, and we don't
+      // know how to find their lengths anyway.
+      munmap (mem, size);
+      return slaw_input_open_binary (filename, f);
+    }
+  if (err < OB_OK)
+    {
+      munmap (mem, size);
+      return err;
+    }
+
+#ifdef MADV_SEQUENTIAL
+  // The usual thing is to read straight through
+  madvise (mem, size, MADV_SEQUENTIAL);
+#endif
+
+  mapped_slaw_input *msi =
+    (mapped_slaw_input *) calloc (1, sizeof (mapped_slaw_input));
+  if (!msi)
+    {
+      munmap (mem, size);
+      return OB_NO_MEM;
+    }
+  *f = new_slaw_input ();
+  if (!*f)
+    {
+      free (msi);
+      munmap (mem, size);
+      return OB_NO_MEM;
+    }
+
+  msi->mem = (const byte *) mem;
+  msi->size = size;
+  msi->swap = (big_endian != ob_i_am_big_endian ());
+  msi->pos = HEADER_LEN;
+
+  (*f)->rfunc = mapped_input_read;
+  (*f)->cfunc = mapped_input_close;
+  (*f)->bfunc = mapped_input_borrow;
+  (*f)->sfunc = mapped_input_seek;
+  (*f)->nfunc = mapped_input_count;
+  (*f)->data = msi;
+
+  return OB_OK;
+}
+
+#endif /* _MSC_VER */
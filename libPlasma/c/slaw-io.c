@@ -78,8 +78,45 @@ static ob_retort private_write_binary_header (slaw_write_handler h,
   return h.write (h.cookie, buf, sizeof (buf));
 }
 
+ob_retort private_check_binary_header (const byte buf[8], unt8 *version,
+                                       bool *big_endian)
+{
+  if (memcmp (buf, ob_binary_header, sizeof (ob_binary_header)) != 0)
+    {
+      OB_LOG_ERROR_CODE (0x20002001,
+                         "binary slaw file does not begin with magic "
+                         "number %02x %02x %02x %02x\n",
+                         ob_binary_header[0], ob_binary_header[1],
+                         ob_binary_header[2], ob_binary_header[3]);
+      return SLAW_WRONG_FORMAT;
+    }
+
+  const unt8 typ = buf[5];
+  const unt16 flags = buf[7] + (buf[6] << 8);
+  *version = buf[4];
+
+  if (*version > CURRENT_VERSION)
+    {
+      OB_LOG_ERROR_CODE (0x20002002, "binary slaw file is version %u but "
+                                     "expected version %u or earlier\n",
+                         *version, CURRENT_VERSION);
+      return SLAW_WRONG_VERSION;
+    }
+
+  if (typ != PLASMA_BINARY_FILE_TYPE_SLAW)
+    {
+      OB_LOG_ERROR_CODE (0x20002003, "binary slaw file has type %u but "
+                                     "expected type %u\n",
+                         typ, PLASMA_BINARY_FILE_TYPE_SLAW);
+      return SLAW_WRONG_FORMAT;
+    }
+
+  *big_endian = ((flags & PLASMA_BINARY_FILE_FLAG_BIG_ENDIAN_SLAW) != 0);
+  return OB_OK;
+}
+
 static ob_retort private_read_binary_header (slaw_read_handler h, unt8 *version,
-                                             unt8 *typ, unt16 *flags)
+                                             bool *big_endian)
 {
   byte buf[8];
   size_t size_read;
@@ -106,21 +143,7 @@ static ob_retort private_read_binary_header (slaw_read_handler h, unt8 *version,
       return OB_UNKNOWN_ERR;
     }
 
-  if (memcmp (buf, ob_binary_header, sizeof (ob_binary_header)) != 0)
-    {
-      OB_LOG_ERROR_CODE (0x20002001,
-                         "binary slaw file does not begin with magic "
-                         "number %02x %02x %02x %02x\n",
-                         ob_binary_header[0], ob_binary_header[1],
-                         ob_binary_header[2], ob_binary_header[3]);
-      return SLAW_WRONG_FORMAT;
-    }
-
-  *version = buf[4];
-  *typ = buf[5];
-  *flags = buf[7] + (buf[6] << 8);
-
-  return OB_OK;
+  return private_check_binary_header (buf, version, big_endian);
 }
 
 typedef struct binary_slaw_input
@@ -317,9 +340,41 @@ ob_retort slaw_input_read (slaw_input f, slaw *s)
   return f->rfunc (f, s);
 }
 
+ob_retort slaw_input_read_borrowed (slaw_input f, bslaw *s)
+{
+  Free_Slaw (f->lent);
+  if (f->bfunc)
+    return f->bfunc (f, s);
+  // Can't do any better than lending out a copy
+  ob_retort err = f->rfunc (f, &f->lent);
+  if (err >= OB_OK)
+    *s = f->lent;
+  return err;
+}
+
+ob_retort slaw_input_seek (slaw_input f, int64 n)
+{
+  if (!f->sfunc)
+    return OB_INVALID_OPERATION;
+  if (n < 0)
+    return OB_BAD_INDEX;
+  Free_Slaw (f->lent);
+  return f->sfunc (f, n);
+}
+
+ob_retort slaw_input_count (slaw_input f, int64 *count)
+{
+  if (!count)
+    return OB_ARGUMENT_WAS_NULL;
+  if (!f->nfunc)
+    return OB_INVALID_OPERATION;
+  return f->nfunc (f, count);
+}
+
 ob_retort slaw_input_close (slaw_input f)
 {
   ob_retort err = f->cfunc (f->data);
+  Free_Slaw (f->lent);
   free (f);
   return err;
 }
@@ -359,35 +414,14 @@ static ob_retort make_binary_input_file (slaw_read_handler h, slaw_input *f,
 ob_retort slaw_input_open_binary_handler (slaw_read_handler h, slaw_input *f)
 {
   unt8 version = ~0;
-  unt8 typ = ~0;
-  unt16 flags = ~0;
+  bool big_endian = false;
   ob_retort err;
 
-  err = private_read_binary_header (h, &version, &typ, &flags);
+  err = private_read_binary_header (h, &version, &big_endian);
   if (err != OB_OK)
     return err;
 
-  if (version > CURRENT_VERSION)
-    {
-      OB_LOG_ERROR_CODE (0x20002002, "binary slaw file is version %u but "
-                                     "expected version %u or earlier\n",
-                         version, CURRENT_VERSION);
-      return SLAW_WRONG_VERSION;
-    }
-
-  if (typ != PLASMA_BINARY_FILE_TYPE_SLAW)
-    {
-      OB_LOG_ERROR_CODE (0x20002003, "binary slaw file has type %u but "
-                                     "expected type %u\n",
-                         typ, PLASMA_BINARY_FILE_TYPE_SLAW);
-      return SLAW_WRONG_FORMAT;
-    }
-
-  return make_binary_input_file (h, f,
-                                 ((flags
-                                   & PLASMA_BINARY_FILE_FLAG_BIG_ENDIAN_SLAW)
-                                  != 0),
-                                 version);
+  return make_binary_input_file (h, f, big_endian, version);
 }
 
 slaw_input new_slaw_input (void)
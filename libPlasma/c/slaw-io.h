@@ -92,6 +92,75 @@ OB_PLASMA_API ob_retort slaw_input_read (slaw_input f, slaw *s);
  */
 OB_PLASMA_API ob_retort slaw_input_close (slaw_input f);
 
+/**
+ *                  Opens a binary slaw file for reading by mapping it
+ *                  into memory, rather than reading it through stdio.
+ *                  Reading from the result with slaw_input_read()
+ *                  still makes a copy of each slaw, but
+ *                  slaw_input_read_borrowed() doesn't, if the file is
+ *                  in this machine's byte order; and the result can
+ *                  seek, with slaw_input_seek(), and count its slawx,
+ *                  with slaw_input_count().  (Files written in the
+ *                  old version 1 format are read as
+ *                  slaw_input_open_binary() reads them, and can't
+ *                  seek.)  Good for big recorded files, which you may
+ *                  not want to read from the beginning.
+ *
+ *                  Nothing else should write to the file while it's
+ *                  open, since we trust that the lengths in it stay
+ *                  the same.
+ *
+ * \param[in]       filename is the name of the file to open.
+ *
+ * \param[out]      f is the location that receives the newly opened
+ *                  "slaw input handle".
+ *
+ * \return          OB_OK if successful, or else another error code
+ */
+OB_PLASMA_API ob_retort slaw_input_open_binary_mapped (const char *filename,
+                                                       slaw_input *f);
+
+/**
+ *                  Like slaw_input_read(), but lends out the slaw
+ *                  instead of giving it to you: don't free it, and
+ *                  don't use it after the next call to
+ *                  slaw_input_read_borrowed(), slaw_input_seek() or
+ *                  slaw_input_close() on \a f.  For a handle from
+ *                  slaw_input_open_binary_mapped(), \a s points
+ *                  straight into the file, if it's in this machine's
+ *                  byte order; otherwise, and for any other kind of
+ *                  handle, it's a copy, which is freed for you.
+ *
+ * \return          OB_OK if successful, SLAW_END_OF_FILE if there are
+ *                  no more slawx, or else another error code
+ */
+OB_PLASMA_API ob_retort slaw_input_read_borrowed (slaw_input f, bslaw *s);
+
+/**
+ *                  Arranges for the next read from \a f to return its
+ *                  \a n th slaw (counting from zero).  Seeking to the
+ *                  slaw after the last one is allowed, and leaves
+ *                  \a f at the end of the file.  The first time past
+ *                  a given point in the file has to walk the slawx
+ *                  before it (though only their headers); after that,
+ *                  seeking anywhere before it is immediate.
+ *
+ * \return          OB_OK if successful, SLAW_END_OF_FILE if there
+ *                  aren't that many slawx (in which case \a f doesn't
+ *                  move), OB_INVALID_OPERATION if \a f can't seek
+ *                  (only handles from slaw_input_open_binary_mapped()
+ *                  can), or else another error code
+ */
+OB_PLASMA_API ob_retort slaw_input_seek (slaw_input f, int64 n);
+
+/**
+ *                  Sets \a count to the number of slawx in \a f,
+ *                  without moving it.  Only handles from
+ *                  slaw_input_open_binary_mapped() can count; others
+ *                  return OB_INVALID_OPERATION.
+ */
+OB_PLASMA_API ob_retort slaw_input_count (slaw_input f, int64 *count);
+
 /* Write slawx to a file */
 /**                 Opens a binary file into which slawx can be written.
  *                  The file has an 8-byte header that contains a magic
@@ -0,0 +1,340 @@
+/* (c)  oblong industries */
+
+///
+/// Hashed key lookup for big slaw maps
+///
+/// slaw_map_find() has to look at every entry of a map, because the
+/// last match wins.  That's fine for the typical little map, but
+/// protein ingests can have hundreds of keys, and get looked up over
+/// and over (e.g. by every handler a protein is delivered to).
+///
+/// So the second time a big enough map is searched, we build a hash
+/// table from key to cons, and keep it around.  A bslaw has nothing
+/// we could hang the table off of, and it might live anywhere (in a
+/// protein, in a pool's mapping, on the stack), so there's no telling
+/// when its memory goes away or gets reused for some other map.  So
+/// each index keeps the map's skeleton: its header, and each cons's
+/// header and key.  The index is only used while the map at that
+/// address still has that skeleton, which takes a memcmp() per entry
+/// to check, however big the values are.  (Values are always read from
+/// the map itself, so they can change, as long as they're the same
+/// size; if one's size changes, so does its cons's header.)
+///
+/// Each thread keeps its own few indexes, least recently used out
+/// first, so looking something up never takes a lock.
+///
+
+#include "libLoam/c/ob-hash.h"
+#include "libLoam/c/ob-pthread.h"
+#include "libLoam/c/ob-thread.h"
+
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/private/plasma-private.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// Maps with fewer entries than this are searched the old way;
+/// hashing the key costs about as much as the search would.
+#define MIN_INDEXED_ENTRIES 16
+
+/// Number of maps each thread keeps indexes for.
+#define INDEX_SLOTS 8
+
+typedef struct
+{
+  unt32 hash;
+  unt32 off; /* in octs, from the start of the map; 0 means empty */
+} index_entry;
+
+/// One of the map's entries.  A cons has its length in its header,
+/// so the octs from there to the end of its car say where it is, what
+/// its key is, and where the next entry starts, and that's what gets
+/// compared.  Anything else in the list just has to be the same length.
+typedef struct
+{
+  unt32 off;  /* in octs, from the start of the map */
+  unt32 octs; /* cons: header and car; otherwise: its octlen */
+  bool cons;
+} bone;
+
+typedef struct
+{
+  bslaw map; /* where it was the last time it was searched */
+  unt64 octlen;
+  unt64 last_used;
+  int64 count;        /* entries in the map, and in skeleton */
+  bone *skeleton;     /* what it looked like when the table was built */
+  unt64 head_octs;    /* octs of the map before its first entry */
+  unt64 *octs;        /* and those, then each cons's, one after another */
+  unt32 mask;         /* number of entries in table, minus 1 */
+  index_entry *table; /* NULL until built (on the second search) */
+} map_index;
+
+typedef struct
+{
+  unt64 clock;
+  map_index slots[INDEX_SLOTS];
+} index_cache;
+
+static ob_once_t cache_once = OB_ONCE_INIT;
+static pthread_key_t cache_key;
+static bool cache_key_ok;
+
+static void clear_slot (map_index *mi)
+{
+  free (mi->table);
+  free (mi->skeleton);
+  free (mi->octs);
+  memset (mi, 0, sizeof (*mi));
+}
+
+static void free_cache (void *v)
+{
+  index_cache *c = (index_cache *) v;
+  int i;
+  for (i = 0; i < INDEX_SLOTS; i++)
+    clear_slot (&c->slots[i]);
+  free (c);
+}
+
+static void make_cache_key (void)
+{
+#ifdef _MSC_VER
+  // No destructors here, so a thread's indexes outlive it
+  pthread_key_create (&cache_key, free_cache);
+  cache_key_ok = true;
+#else
+  cache_key_ok = (0 == pthread_key_create (&cache_key, free_cache));
+#endif
+}
+
+/// This thread's indexes, or NULL if it can't have any.
+
+static index_cache *my_cache (void)
+{
+  if (ob_once (&cache_once, make_cache_key) < OB_OK || !cache_key_ok)
+    return NULL;
+  index_cache *c = (index_cache *) pthread_getspecific (cache_key);
+  if (c)
+    return c;
+  if (!(c = (index_cache *) calloc (1, sizeof (*c))))
+    return NULL;
+  if (0 != pthread_setspecific (cache_key, c))
+    {
+      free (c);
+      return NULL;
+    }
+  return c;
+}
+
+static unt32 hash_bytes (const void *p, size_t len)
+{
+  return (unt32) ob_city_hash64 (p, len);
+}
+
+/// String keys hash just their characters (as far as the first NUL,
+/// since that's as far as slaw_map_find_c() compares), so that
+/// slaw_map_find_c() doesn't have to make a slaw out of its key first.
+
+static unt32 hash_key (bslaw key)
+{
+  const char *str = slaw_string_emit (key);
+  if (str)
+    return hash_bytes (str, strlen (str));
+  return (unt32) slaw_hash (key);
+}
+
+static bool key_matches (bslaw car, bslaw key, const char *ckey)
+{
+  if (!ckey)
+    return slawx_equal (car, key);
+  const char *str = slaw_string_emit (car);
+  return (str && strcmp (str, ckey) == 0);
+}
+
+/// Whether \a map still has the entries and keys it had when \a mi
+/// was built.
+
+static bool skeleton_matches (const map_index *mi, bslaw map)
+{
+  const unt64 *o = mi->octs;
+  if (memcmp (map, o, 8 * mi->head_octs) != 0)
+    return false;
+  o += mi->head_octs;
+  const bone *b = mi->skeleton;
+  const bone *end = b + mi->count;
+  for (; b < end; b++)
+    if (b->cons)
+      {
+        if (memcmp (map + b->off, o, 8 * b->octs) != 0)
+          return false;
+        o += b->octs;
+      }
+    else if (slaw_octlen (map + b->off) != b->octs)
+      return false;
+  return true;
+}
+
+static bool build_index (bslaw map, map_index *mi)
+{
+  const int64 count = slaw_list_count (map);
+  unt32 size = 4;
+  while (size < 2 * count)
+    size <<= 1;
+  bslaw first = slaw_list_emit_first (map);
+  const unt64 head_octs = (first ? first - map : 1);
+  unt64 octs = head_octs;
+  int64 n = 0;
+  bslaw cole;
+  for (cole = first; cole != NULL; cole = slaw_list_emit_next (map, cole), n++)
+    {
+      bslaw car = slaw_cons_emit_car (cole);
+      if (car)
+        octs += (car - cole) + slaw_octlen (car);
+    }
+  if (n != count)
+    return false;
+  index_entry *table = (index_entry *) calloc (size, sizeof (index_entry));
+  bone *skeleton = (bone *) malloc (count * sizeof (bone));
+  unt64 *copy = (unt64 *) malloc (8 * octs);
+  if (!table || !skeleton || !copy)
+    {
+      free (table);
+      free (skeleton);
+      free (copy);
+      return false;
+    }
+  memcpy (copy, map, 8 * head_octs);
+
+  const unt32 mask = size - 1;
+  bone *b = skeleton;
+  unt64 *o = copy + head_octs;
+  for (cole = first; cole != NULL; cole = slaw_list_emit_next (map, cole), b++)
+    {
+      const unt32 off = (unt32) (cole - map);
+      bslaw car = slaw_cons_emit_car (cole);
+      b->off = off;
+      b->cons = (car != NULL);
+      if (!car)
+        {
+          b->octs = (unt32) slaw_octlen (cole);
+          continue;
+        }
+      b->octs = (unt32) ((car - cole) + slaw_octlen (car));
+      memcpy (o, cole, 8 * b->octs);
+      o += b->octs;
+      const unt32 h = hash_key (car);
+      unt32 i;
+      for (i = h & mask;; i = (i + 1) & mask)
+        {
+          if (table[i].off == 0)
+            {
+              table[i].hash = h;
+              table[i].off = off;
+              break;
+            }
+          // Same key again: the later one wins
+          if (table[i].hash == h
+              && slawx_equal (car, slaw_cons_emit_car (map + table[i].off)))
+            {
+              table[i].off = off;
+              break;
+            }
+        }
+    }
+
+  mi->head_octs = head_octs;
+  mi->octs = copy;
+  mi->skeleton = skeleton;
+  mi->count = count;
+  mi->table = table;
+  mi->mask = mask;
+  return true;
+}
+
+/// Returns the index for @a map, built and known to be good, or NULL
+/// if this map shouldn't (yet) be searched with an index.
+
+static const map_index *index_for (index_cache *c, bslaw map)
+{
+  const unt64 octlen = slaw_octlen (map);
+  // Offsets have to fit in 32 bits
+  if (octlen > OB_CONST_U64 (0xffffffff))
+    return NULL;
+
+  map_index *mi = NULL;
+  int i;
+  for (i = 0; i < INDEX_SLOTS; i++)
+    if (c->slots[i].map == map && c->slots[i].octlen == octlen)
+      {
+        mi = &c->slots[i];
+        break;
+      }
+  c->clock++;
+
+  if (!mi)
+    {
+      // Not seen it before (or not lately).  We don't build an index
+      // until the second search, so that a map which is only searched
+      // once doesn't pay for it.
+      mi = &c->slots[0];
+      for (i = 1; i < INDEX_SLOTS; i++)
+        if (c->slots[i].last_used < mi->last_used)
+          mi = &c->slots[i];
+      clear_slot (mi);
+      mi->map = map;
+      mi->octlen = octlen;
+      mi->last_used = c->clock;
+      return NULL;
+    }
+
+  mi->last_used = c->clock;
+  if (mi->table && !skeleton_matches (mi, map))
+    {
+      // Some other map has turned up where this one used to be.
+      // Treat it like any other map we've only now seen.
+      clear_slot (mi);
+      mi->map = map;
+      mi->octlen = octlen;
+      mi->last_used = c->clock;
+      return NULL;
+    }
+  if (!mi->table && !build_index (map, mi))
+    return NULL;
+  return mi;
+}
+
+bool slaw_map_index_find (bslaw map, bslaw key, const char *ckey,
+                          bslaw *result)
+{
+  if (slaw_list_count (map) < MIN_INDEXED_ENTRIES)
+    return false;
+
+  index_cache *c = my_cache ();
+  if (!c)
+    return false;
+  const map_index *mi = index_for (c, map);
+  if (!mi)
+    return false;
+
+  const unt32 h =
+    (ckey ? hash_bytes (ckey, strlen (ckey)) : hash_key (key));
+  bslaw found = NULL;
+  unt32 i;
+  for (i = h & mi->mask; mi->table[i].off != 0; i = (i + 1) & mi->mask)
+    {
+      if (mi->table[i].hash != h)
+        continue;
+      bslaw cole = map + mi->table[i].off;
+      bslaw car = slaw_cons_emit_car (cole);
+      if (key_matches (car, key, ckey))
+        {
+          found = slaw_cons_emit_cdr (cole);
+          break;
+        }
+    }
+
+  *result = found;
+  return true;
+}
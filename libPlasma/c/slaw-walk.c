@@ -3,6 +3,7 @@
 
 #include "libLoam/c/ob-log.h"
 #include "libPlasma/c/slaw-walk.h"
+#include "libPlasma/c/slaw-builder.h"
 #include "libPlasma/c/slaw-string.h"
 #include "libPlasma/c/protein.h"
 #include "libPlasma/c/private/plasma-private.h"
@@ -494,164 +495,108 @@ ob_retort slaw_walk (void *cookie, const slaw_handler *handler, bslaw victim)
 
 // events => slaw
 
-typedef struct future_protein
-{
-  slaw descrips;
-  slaw ingests;
-  void *rude;
-  int64 rudeLen;
-} future_protein;
-
+// Everything is encoded straight into a slaw_builder as it arrives,
+// except that numeric vectors and arrays are gathered up in an
+// ob_numeric_builder first, since we don't know what type they are
+// until we've seen all of them.  (The name is historical: this used
+// to be a stack of slabus, one for each container we were inside.)
 struct slabu_chain
 {
-  slabu_chain *next;
-
-  // exactly one of these will be non-NULL; sort of like a union
-  // XXX: so maybe I should actually be using a union instead!
-  slabu *sb;
-  future_protein *pb;
+  slaw_builder *b;
   ob_numeric_builder *nb;
-
-  // only meaningful if pb is non-NULL
-  bool doing_ingests;
+  // true between the first ob_nb_enter() and the last ob_nb_leave()
+  bool doing_numeric;
 };
 
 slaw_fabricator *slaw_fabricator_new (void)
 {
-  slaw_fabricator *ret = (slaw_fabricator *) malloc (sizeof (slaw_fabricator));
-  if (ret != NULL)
-    memset (ret, 0, sizeof (slaw_fabricator));
-  return ret;
-}
-
-static ob_retort sf_push (slaw_fabricator *sf)
-{
-  slabu_chain *sc = (slabu_chain *) malloc (sizeof (slabu_chain));
-  if (sc == NULL)
-    return OB_NO_MEM;
-  memset (sc, 0, sizeof (slabu_chain));
-  sc->sb = slabu_new ();
-  if (sc->sb == NULL)
+  slaw_fabricator *ret = (slaw_fabricator *) calloc (1, sizeof (*ret));
+  if (ret == NULL)
+    return NULL;
+  slabu_chain *sc = (slabu_chain *) calloc (1, sizeof (*sc));
+  if (sc == NULL || (sc->b = slaw_builder_new ()) == NULL)
     {
       free (sc);
-      return OB_NO_MEM;
+      free (ret);
+      return NULL;
     }
-  sc->next = sf->stack;
-  sf->stack = sc;
-  return OB_OK;
+  ret->stack = sc;
+  return ret;
 }
 
-static ob_retort sf_push_probu (slaw_fabricator *sf)
+void slaw_fabricator_free (slaw_fabricator *sf)
 {
-  slabu_chain *sc = (slabu_chain *) malloc (sizeof (slabu_chain));
-  if (sc == NULL)
-    return OB_NO_MEM;
-  memset (sc, 0, sizeof (slabu_chain));
-  sc->pb = (future_protein *) calloc (1, sizeof (future_protein));
-  if (sc->pb == NULL)
+  if (sf->stack)
     {
-      free (sc);
-      return OB_NO_MEM;
+      slaw_builder_free (sf->stack->b);
+      if (sf->stack->nb)
+        ob_nb_free (&sf->stack->nb);
+      free (sf->stack);
     }
-  sc->next = sf->stack;
-  sf->stack = sc;
-  return OB_OK;
+  if (sf->result)
+    slaw_free (sf->result);
+  free (sf);
 }
 
-static ob_retort sf_push_nb (slaw_fabricator *sf)
+/// Called after anything which might have finished the outermost
+/// slaw: if it did, makes it the result.
+static ob_retort sf_settle (slaw_fabricator *sf, ob_retort tort)
 {
-  slabu_chain *sc = (slabu_chain *) malloc (sizeof (slabu_chain));
-  if (sc == NULL)
+  if (tort < OB_OK || slaw_builder_depth (sf->stack->b) > 0)
+    return tort;
+  slaw cole = slaw_builder_finish (sf->stack->b);
+  if (!cole)
     return OB_NO_MEM;
-  memset (sc, 0, sizeof (slabu_chain));
-  ob_retort tort = ob_nb_new (&sc->nb);
-  if (tort < OB_OK)
-    {
-      free (sc);
-      return tort;
-    }
-  sc->next = sf->stack;
-  sf->stack = sc;
+  slaw_free (sf->result);
+  sf->result = cole;
   return OB_OK;
 }
 
-static void sf_pop (slaw_fabricator *sf)
-{
-  if (sf->stack != NULL)
-    {
-      slabu_chain *tmp;
-      if (sf->stack->sb)
-        slabu_free (sf->stack->sb);
-      else if (sf->stack->pb)
-        {
-          slaw_free (sf->stack->pb->descrips);
-          slaw_free (sf->stack->pb->ingests);
-          free (sf->stack->pb->rude);
-          free (sf->stack->pb);
-        }
-      else if (sf->stack->nb)
-        ob_nb_free (&sf->stack->nb);
-      else
-        OB_FATAL_BUG_CODE (0x20004006, "shouldn't happen\n");
-      tmp = sf->stack->next;
-      free (sf->stack);
-      sf->stack = tmp;
-    }
-}
-
-void slaw_fabricator_free (slaw_fabricator *sf)
+static ob_retort sf_add_numeric (slaw_fabricator *sf, slaw_oct ilk,
+                                 unt32 unit_blen, int64 breadth,
+                                 const void *data)
 {
-  while (sf->stack)
-    sf_pop (sf);
-  if (sf->result)
-    slaw_free (sf->result);
-  free (sf);
+  return sf_settle (sf, private_slaw_builder_add_numeric (sf->stack->b, ilk,
+                                                          unit_blen, breadth,
+                                                          data));
 }
 
-static ob_retort sf_add_slaw (slaw_fabricator *sf, slaw cole)
+static ob_retort sf_enter (slaw_fabricator *sf, unt8 flags)
 {
-  ob_retort err = OB_OK;
-  if (sf->stack)
+  slabu_chain *sc = sf->stack;
+  if (!sc->doing_numeric)
     {
-      if (sf->stack->sb)
-        ob_err_accum (&err, slabu_list_add_x (sf->stack->sb, cole));
-      else if (sf->stack->nb)
-        err = SLAW_FABRICATOR_BADNESS;
-      else if (sf->stack->doing_ingests)
-        sf->stack->pb->ingests = cole;
+      if (sc->nb)
+        ob_nb_reset (sc->nb);
       else
-        sf->stack->pb->descrips = cole;
+        {
+          ob_retort tort = ob_nb_new (&sc->nb);
+          if (tort < OB_OK)
+            return tort;
+        }
+      sc->doing_numeric = true;
     }
-  else
-    sf->result = cole;
-
-  return err;
-}
-
-static ob_retort sf_enter (slaw_fabricator *sf, unt8 flags)
-{
-  ob_retort tort;
-  if ((!sf->stack || !sf->stack->nb) && OB_OK > (tort = sf_push_nb (sf)))
-    return tort;
-  return ob_nb_enter (sf->stack->nb, flags);
+  return ob_nb_enter (sc->nb, flags);
 }
 
 static ob_retort sf_leave (slaw_fabricator *sf, unt8 leave_flags)
 {
-  if (!sf->stack->nb)
+  slabu_chain *sc = sf->stack;
+  if (!sc->doing_numeric)
     return SLAW_FABRICATOR_BADNESS;
-  ob_retort tort = ob_nb_leave (sf->stack->nb, leave_flags);
+  ob_retort tort = ob_nb_leave (sc->nb, leave_flags);
   if (tort < OB_OK)
     return tort;
-  if (ob_nb_done (sf->stack->nb))
+  if (ob_nb_done (sc->nb))
     {
       unt8 flags, vsize, bits;
       unt64 breadth;
-      tort = ob_nb_dimensions (sf->stack->nb, &flags, &vsize, &bits, &breadth);
+      sc->doing_numeric = false;
+      tort = ob_nb_dimensions (sc->nb, &flags, &vsize, &bits, &breadth);
       if (tort < OB_OK)
         return tort;
-      const void *ptr = ob_nb_pointer (sf->stack->nb);
-      slaw_oct ilk = SLAW_NUMERIC_ILK;
+      const void *ptr = ob_nb_pointer (sc->nb);
+      slaw_oct ilk = 0;
       if ((flags & OB_MULTI) != 0)
         {
           switch (vsize)
@@ -712,44 +657,9 @@ static ob_retort sf_leave (slaw_fabricator *sf, unt8 leave_flags)
       ilk |= (sz << SLAW_NUMERIC_SIZE_SHIFTY);
 
       unt32 blen = (bits / 8) * vsize * (isComplex ? 2 : 1);
-      slaw cole;
-      byte *p;
-
-      if ((flags & OB_ARRAY) != 0)
-        {
-          cole = slaw_numeric_array_raw (ilk, blen, breadth);
-          if (!cole)
-            return OB_NO_MEM;
-          p = (byte *) (cole + 1);
-        }
-      else
-        {
-          unt64 new_bsize = blen;
-          unt64 new_osize = (((new_bsize) >> 3) + (((new_bsize) % 8) ? 1 : 0));
-          bool wee = new_bsize <= 4;
-          if (wee)
-            new_osize = 0;
-
-          ilk >>= SLAW_NUMERIC_BSIZE_SHIFTY;
-          ilk &= ~SLAW_NUMERIC_UNIT_BSIZE_MASK;
-          ilk |= (new_bsize - 1);
-          ilk <<= SLAW_NUMERIC_BSIZE_SHIFTY;
-          cole = slaw_alloc (1 + new_osize);
-          if (!cole)
-            return OB_NO_MEM;
-          cole->o = ilk;
-          if (wee)
-            p = SLAW_SPECIAL_BYTES (cole, new_bsize);
-          else
-            p = (byte *) (cole + 1);
-          byte *last = (byte *) (cole + 1 + new_osize);
-          if (!wee)
-            memset (p, 0, last - p); /* initialize padding */
-        }
-
-      memcpy (p, ptr, blen * breadth);
-      sf_pop (sf);
-      return sf_add_slaw (sf, cole);
+      return sf_add_numeric (sf, ilk, blen,
+                             ((flags & OB_ARRAY) != 0 ? (int64) breadth : -1),
+                             ptr);
     }
   return OB_OK;
 }
@@ -757,53 +667,25 @@ static ob_retort sf_leave (slaw_fabricator *sf, unt8 leave_flags)
 static ob_retort sf_begin_cons (void *cookie)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  return sf_push (sf);
+  return slaw_builder_begin_cons (sf->stack->b);
 }
 
-static ob_retort sf_end_cons (void *cookie)
+static ob_retort sf_end (void *cookie)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  slaw cole;
-  if (!sf->stack || !sf->stack->sb || slabu_count (sf->stack->sb) != 2)
-    return SLAW_FABRICATOR_BADNESS;
-  cole = slaw_cons (sf->stack->sb->esses[0], sf->stack->sb->esses[1]);
-  if (!cole)
-    return OB_NO_MEM;
-  sf_pop (sf);
-  return sf_add_slaw (sf, cole);
+  return sf_settle (sf, slaw_builder_end (sf->stack->b));
 }
 
 static ob_retort sf_begin_list (void *cookie, int64 unused)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  ob_retort err = sf_push (sf);
-  return err;
+  return slaw_builder_begin_list (sf->stack->b);
 }
 
-static ob_retort sf_end_list (void *cookie)
+static ob_retort sf_begin_map (void *cookie, int64 unused)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  slaw cole;
-  if (!sf->stack || !sf->stack->sb)
-    return SLAW_FABRICATOR_BADNESS;
-  cole = slaw_list (sf->stack->sb);
-  if (!cole)
-    return OB_NO_MEM;
-  sf_pop (sf);
-  return sf_add_slaw (sf, cole);
-}
-
-static ob_retort sf_end_map (void *cookie)
-{
-  slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  slaw cole;
-  if (!sf->stack || !sf->stack->sb)
-    return SLAW_FABRICATOR_BADNESS;
-  cole = slaw_map (sf->stack->sb);
-  if (!cole)
-    return OB_NO_MEM;
-  sf_pop (sf);
-  return sf_add_slaw (sf, cole);
+  return slaw_builder_begin_map (sf->stack->b);
 }
 
 static ob_retort sf_begin_array (void *cookie, int64 unused, int notused)
@@ -857,109 +739,89 @@ static ob_retort sf_end_complex (void *cookie)
 static ob_retort sf_handle_nil (void *cookie)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  slaw cole = slaw_nil ();
-  if (!cole)
-    return OB_NO_MEM;
-  return sf_add_slaw (sf, cole);
+  if (sf->stack->doing_numeric)
+    return SLAW_FABRICATOR_BADNESS;
+  return sf_settle (sf, slaw_builder_add_nil (sf->stack->b));
 }
 
 static ob_retort sf_handle_string (void *cookie, const char *utf8, int64 len)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  slaw cole = slaw_string_from_substring (utf8, len);
-  if (!cole)
-    return OB_NO_MEM;
-  return sf_add_slaw (sf, cole);
+  if (sf->stack->doing_numeric)
+    return SLAW_FABRICATOR_BADNESS;
+  return sf_settle (sf, slaw_builder_add_substring (sf->stack->b, utf8, len));
 }
 
 static ob_retort sf_handle_int (void *cookie, int64 val, int bits)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  slaw cole;
 
-  if (sf->stack && sf->stack->nb)
+  if (sf->stack->doing_numeric)
     return ob_nb_push_integer (&sf->stack->nb, false, bits, val);
 
+  int8 v8 = (int8) val;
+  int16 v16 = (int16) val;
+  int32 v32 = (int32) val;
   switch (bits)
     {
       case 8:
-        cole = slaw_int8 ((int8) val);
-        break;
+        return sf_add_numeric (sf, SLAW_int8, sizeof (v8), -1, &v8);
       case 16:
-        cole = slaw_int16 ((int16) val);
-        break;
+        return sf_add_numeric (sf, SLAW_int16, sizeof (v16), -1, &v16);
       case 32:
-        cole = slaw_int32 ((int32) val);
-        break;
+        return sf_add_numeric (sf, SLAW_int32, sizeof (v32), -1, &v32);
       case 64:
-        cole = slaw_int64 (val);
-        break;
+        return sf_add_numeric (sf, SLAW_int64, sizeof (val), -1, &val);
       default:
         return SLAW_FABRICATOR_BADNESS;
     }
-
-  if (!cole)
-    return OB_NO_MEM;
-  return sf_add_slaw (sf, cole);
 }
 
 static ob_retort sf_handle_unt (void *cookie, unt64 val, int bits)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  slaw cole;
 
-  if (sf->stack && sf->stack->nb)
+  if (sf->stack->doing_numeric)
     return ob_nb_push_integer (&sf->stack->nb, true, bits, val);
 
+  unt8 v8 = (unt8) val;
+  unt16 v16 = (unt16) val;
+  unt32 v32 = (unt32) val;
   switch (bits)
     {
       case 1:
-        cole = slaw_boolean ((int) val);
-        break;
+        return sf_settle (sf, slaw_builder_add_boolean (sf->stack->b,
+                                                        (bool) val));
       case 8:
-        cole = slaw_unt8 ((unt8) val);
-        break;
+        return sf_add_numeric (sf, SLAW_unt8, sizeof (v8), -1, &v8);
       case 16:
-        cole = slaw_unt16 ((unt16) val);
-        break;
+        return sf_add_numeric (sf, SLAW_unt16, sizeof (v16), -1, &v16);
       case 32:
-        cole = slaw_unt32 ((unt32) val);
-        break;
+        return sf_add_numeric (sf, SLAW_unt32, sizeof (v32), -1, &v32);
       case 64:
-        cole = slaw_unt64 (val);
-        break;
+        return sf_add_numeric (sf, SLAW_unt64, sizeof (val), -1, &val);
       default:
         return SLAW_FABRICATOR_BADNESS;
     }
-
-  if (!cole)
-    return OB_NO_MEM;
-  return sf_add_slaw (sf, cole);
 }
 
 static ob_retort sf_handle_float (void *cookie, float64 val, int bits)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  slaw cole;
 
-  if (sf->stack && sf->stack->nb)
+  if (sf->stack->doing_numeric)
     return ob_nb_push_float (&sf->stack->nb, bits, val);
 
+  float32 v32 = (float32) val;
   switch (bits)
     {
       case 32:
-        cole = slaw_float32 ((float32) val);
-        break;
+        return sf_add_numeric (sf, SLAW_float32, sizeof (v32), -1, &v32);
       case 64:
-        cole = slaw_float64 (val);
-        break;
+        return sf_add_numeric (sf, SLAW_float64, sizeof (val), -1, &val);
       default:
         return SLAW_FABRICATOR_BADNESS;
     }
-
-  if (!cole)
-    return OB_NO_MEM;
-  return sf_add_slaw (sf, cole);
 }
 
 static ob_retort sf_handle_empty_array (void *cookie, int vecsize, bool isMVec,
@@ -967,10 +829,8 @@ static ob_retort sf_handle_empty_array (void *cookie, int vecsize, bool isMVec,
                                         bool isFloat, int bits)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  slaw cole;
   unt32 blen;
-  slaw_oct ilk = SLAW_NUMERIC_ILK
-                 | ((vecsize - OB_CONST_U64 (1)) << SLAW_NUMERIC_VEC_SHIFTY);
+  slaw_oct ilk = ((vecsize - OB_CONST_U64 (1)) << SLAW_NUMERIC_VEC_SHIFTY);
 
   if (bits < 8 || bits > 64 || (bits & (bits - 1)) != 0
       || (isFloat && bits < 32))
@@ -978,7 +838,7 @@ static ob_retort sf_handle_empty_array (void *cookie, int vecsize, bool isMVec,
 
   if (isMVec)
     {
-      ilk = (SLAW_NUMERIC_ILK | SLAW_NUMERIC_MVEC_FLAG
+      ilk = (SLAW_NUMERIC_MVEC_FLAG
              | ((vecsize - OB_CONST_U64 (2)) << SLAW_NUMERIC_VEC_SHIFTY));
       if (isComplex || vecsize < 2 || vecsize > 5)
         return SLAW_FABRICATOR_BADNESS;
@@ -1019,37 +879,20 @@ static ob_retort sf_handle_empty_array (void *cookie, int vecsize, bool isMVec,
 
   blen = (bits / 8) * vecsize * (isComplex ? 2 : 1);
 
-  cole = slaw_numeric_array_raw (ilk, blen, 0);
-  if (!cole)
-    return OB_NO_MEM;
-  return sf_add_slaw (sf, cole);
+  return sf_add_numeric (sf, ilk, blen, 0, NULL);
 }
 
 static ob_retort sf_begin_protein (void *cookie)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  return sf_push_probu (sf);
-}
-
-static ob_retort sf_end_protein (void *cookie)
-{
-  slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  protein p;
-  if (!sf->stack || !sf->stack->pb)
-    return SLAW_FABRICATOR_BADNESS;
-  p = protein_from_llr (sf->stack->pb->descrips, sf->stack->pb->ingests,
-                        sf->stack->pb->rude, sf->stack->pb->rudeLen);
-  if (!p)
-    return OB_NO_MEM;
-  sf_pop (sf);
-  return sf_add_slaw (sf, p);
+  return slaw_builder_begin_protein (sf->stack->b);
 }
 
 static ob_retort sf_handle_nonstd_protein (void *cookie, const void *pp,
                                            int64 len)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  protein p = (protein) pp;
+  bprotein p = (bprotein) pp;
   unt64 p_len = protein_len (p);
   if (p_len != len)
     {
@@ -1058,62 +901,34 @@ static ob_retort sf_handle_nonstd_protein (void *cookie, const void *pp,
                          p_len, len);
       return SLAW_CORRUPT_SLAW;
     }
-  return sf_add_slaw (sf, protein_dup (p));
+  return sf_settle (sf, slaw_builder_add (sf->stack->b, p));
 }
 
 static ob_retort sf_begin_descrips (void *cookie)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  if (!sf->stack || !sf->stack->pb)
-    return SLAW_FABRICATOR_BADNESS;
-  sf->stack->doing_ingests = false;
-
-  return OB_OK;
-}
-
-static ob_retort sf_end_descips (void *cookie)
-{
-  return OB_OK;
+  return slaw_builder_begin_descrips (sf->stack->b);
 }
 
 static ob_retort sf_begin_ingests (void *cookie)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  if (!sf->stack || !sf->stack->pb)
-    return SLAW_FABRICATOR_BADNESS;
-  sf->stack->doing_ingests = true;
-
-  return OB_OK;
-}
-
-static ob_retort sf_end_ingests (void *cookie)
-{
-  return OB_OK;
+  return slaw_builder_begin_ingests (sf->stack->b);
 }
 
 static ob_retort sf_handle_rude_data (void *cookie, const void *d, int64 len)
 {
   slaw_fabricator *sf = (slaw_fabricator *) cookie;
-  if (!sf->stack || !sf->stack->pb || sf->stack->pb->rude)
-    return SLAW_FABRICATOR_BADNESS;
-
-  sf->stack->pb->rudeLen = len;
-  sf->stack->pb->rude = malloc (len);
-  if (!sf->stack->pb->rude)
-    return OB_NO_MEM;
-
-  memcpy (sf->stack->pb->rude, d, len);
-
-  return OB_OK;
+  return slaw_builder_add_rude_data (sf->stack->b, d, len);
 }
 
 const slaw_handler slaw_fabrication_handler =
   {sf_begin_cons,
-   sf_end_cons,
-   sf_begin_list, /* same function to begin list or map */
-   sf_end_map,
+   sf_end,
+   sf_begin_map,
+   sf_end,
    sf_begin_list,
-   sf_end_list,
+   sf_end,
    sf_begin_array,
    sf_end_array,
    sf_begin_multivector,
@@ -1129,10 +944,10 @@ const slaw_handler slaw_fabrication_handler =
    sf_handle_float,
    sf_handle_empty_array,
    sf_begin_protein,
-   sf_end_protein,
+   sf_end,
    sf_handle_nonstd_protein,
    sf_begin_descrips,
-   sf_end_descips,
+   sf_end,
    sf_begin_ingests,
-   sf_end_ingests,
+   sf_end,
    sf_handle_rude_data};
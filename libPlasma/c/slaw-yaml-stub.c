@@ -2,6 +2,7 @@
 /* (c)  oblong industries */
 
 #include "libPlasma/c/slaw-io.h"
+#include "libPlasma/c/private/plasma-testing.h"
 
 ob_retort slaw_input_open_text_handler (slaw_read_handler h, slaw_input *f)
 {
@@ -17,3 +18,12 @@ ob_retort slaw_output_open_text_handler (slaw_write_handler h, bslaw options,
 void private_test_yaml_hash (void)
 {
 }
+
+void private_set_yaml_fast_path (bool enable)
+{
+}
+
+int64 private_yaml_fallback_count (void)
+{
+  return 0;
+}
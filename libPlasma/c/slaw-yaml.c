@@ -16,6 +16,7 @@
 #include "libLoam/c/ob-math.h"
 #include "libLoam/c/ob-file.h"
 #include "libLoam/c/ob-hash.h"
+#include "libLoam/c/ob-atomic.h"
 #include "libLoam/c/ob-vers.h"
 
 
@@ -1277,585 +1278,1958 @@ static inline unt64 sly_hash (const yaml_char_t *s)
   if (((void *) (ptr)) != (void *) little_buffer)                              \
   free (ptr)
 
+/* One parsing event, which is all that sly_step() needs to know
+ * about it.  It can come from libyaml, or from the fast reader below,
+ * which only knows the part of YAML that we write ourselves. */
+typedef struct sly_event
+{
+  yaml_event_type_t type;
+  const char *tag;   /* NULL if the node didn't have one */
+  const char *value; /* the rest are only for scalars */
+  int64 length;
+  bool plain; /* not quoted, and not a block scalar */
+} sly_event;
+
+typedef struct sly_parse_state
+{
+  void *cookie;
+  const slaw_handler *handler;
+  slabu *stack;
+} sly_parse_state;
+
+static void sly_event_from_yaml (const yaml_event_t *event, sly_event *ev)
+{
+  memset (ev, 0, sizeof (*ev));
+  ev->type = event->type;
+  switch (event->type)
+    {
+      case YAML_SCALAR_EVENT:
+        ev->tag = (const char *) event->data.scalar.tag;
+        ev->value = (const char *) event->data.scalar.value;
+        ev->length = event->data.scalar.length;
+        ev->plain = (event->data.scalar.style == YAML_PLAIN_SCALAR_STYLE);
+        break;
+      case YAML_SEQUENCE_START_EVENT:
+        ev->tag = (const char *) event->data.sequence_start.tag;
+        break;
+      case YAML_MAPPING_START_EVENT:
+        ev->tag = (const char *) event->data.mapping_start.tag;
+        break;
+      default:
+        break;
+    }
+}
+
+/* Turns one event into calls to the slaw_handler; a document is over
+ * when the stack is empty again. */
+static ob_retort sly_step (sly_parse_state *ps, const sly_event *ev)
+{
+  const slaw_handler *handler = ps->handler;
+  void *cookie = ps->cookie;
+  slabu *stack = ps->stack;
+  byte little_buffer[64];
+  ob_retort err = OB_OK;
+  slaw popped = NULL;
+  bool pushed = false;
+  unt64 h;
+  const v3unt64 *prev = slaw_v3unt64_emit (sly_peek (stack));
+  v3unt64 v;
+  sly_plain_scalar_type plainTyp = SLY_SCALAR_UNDECIDED;
+
+  if (prev && prev->CURRENT_ELEMENT == SE_MAP
+      && 0 == (prev->CURRENT_POSITION & 1)
+      && ev->type != YAML_MAPPING_END_EVENT)
+    {
+      err = handler->begin_cons (cookie);
+    }
+  else if (prev && prev->CURRENT_ELEMENT == SE_PROTEIN
+           && 1 == (prev->CURRENT_POSITION & 1)
+           && ev->type != YAML_MAPPING_END_EVENT)
+    {
+      if (prev->CURRENT_CONTEXT == SE_DESCRIPS)
+        err = handler->begin_descrips (cookie);
+      else if (prev->CURRENT_CONTEXT == SE_INGESTS)
+        err = handler->begin_ingests (cookie);
+    }
+
+  if (err != OB_OK)
+    return err;
+
+  switch (ev->type)
+    {
+      case YAML_STREAM_START_EVENT:
+        ob_err_accum (&err, slabu_list_add_x (stack, slaw_nil ()));
+        pushed = true;
+        break;
+      case YAML_STREAM_END_EVENT:
+        popped = sly_pop (stack);
+        if (popped == NULL)
+          err = SLAW_END_OF_FILE;
+        break;
+      case YAML_DOCUMENT_START_EVENT:
+        ob_err_accum (&err, slabu_list_add_x (stack, slaw_nil ()));
+        pushed = true;
+        break;
+      case YAML_DOCUMENT_END_EVENT:
+        popped = sly_pop (stack);
+        break;
+      case YAML_ALIAS_EVENT:
+        return SLAW_ALIAS_NOT_SUPPORTED;
+      case YAML_SCALAR_EVENT:
+        if (!ev->tag
+            || (h = sly_hash ((const yaml_char_t *) ev->tag))
+                 == SE_NON_SPECIFIC)
+          {
+            if (ev->plain)
+              {
+                plainTyp = sly_classify_plain (ev->value, ev->length);
+                switch (plainTyp)
+                  {
+                    case SLY_SCALAR_NULL:
+                      h = SE_NULL;
+                      break;
+                    case SLY_SCALAR_10:
+                    case SLY_SCALAR_8:
+                    case SLY_SCALAR_16:
+                      h = SE_I64;
+                      break;
+                    case SLY_SCALAR_FLOAT:
+                    case SLY_SCALAR_INF:
+                    case SLY_SCALAR_NAN:
+                      h = SE_F64;
+                      break;
+                    case SLY_SCALAR_BOOL:
+                      h = SE_BOOL;
+                      break;
+                    default:
+                    case SLY_SCALAR_STRING:
+                      h = SE_STR;
+                      break;
+                  }
+              }
+            else
+              {
+                /* untagged quoted scalars are always strings */
+                h = SE_STR;
+              }
+          }
+        switch (h)
+          {
+            case SE_BINARY:
+              if (!prev || prev->CURRENT_CONTEXT != SE_RUDE_DATA)
+                {
+                  OB_LOG_ERROR_CODE (0x2000500d, "slaw yaml: got %s in "
+                                                 "unexpected place\n",
+                                     ev->tag);
+                  err = SLAW_PARSING_BADNESS;
+                  break;
+                }
+            // fall thru
+            case SE_NONSTD:
+            case SE_BADUTF8:
+              {
+                unt64 buflen = base64_to_bin_upper_bound (ev->length);
+                unt64 len;
+                unt8 *buf = (unt8 *) MAYBE_MALLOC (buflen);
+                memset (buf, 0, buflen);
+                len =
+                  base64_to_bin_convert (ev->length, ev->value, buflen, buf);
+                if (h == SE_NONSTD)
+                  err = handler->handle_nonstd_protein (cookie, buf, len);
+                else if (h == SE_BADUTF8)
+                  err = handler->handle_string (cookie, (const char *) buf,
+                                                len);
+                else
+                  err = handler->handle_rude_data (cookie, buf, len);
+                MAYBE_FREE (buf);
+              }
+              break;
+            case SE_BOOL:
+              {
+                char c = ev->value[0];
+                err =
+                  handler->handle_unt (cookie, (c == 't' || c == 'T'), 1);
+                break;
+              }
+            case SE_F32:
+            case SE_F64:
+              {
+                float64 number;
+                int bits = 8;
+                char *buf =
+                  (char *) MAYBE_MALLOC (ev->length + 1);
+
+                memcpy (buf, ev->value, ev->length);
+                buf[ev->length] = 0;
+
+                if (plainTyp == SLY_SCALAR_UNDECIDED)
+                  plainTyp = sly_classify_plain (ev->value, ev->length);
+
+                switch (plainTyp)
+                  {
+                    case SLY_SCALAR_NAN:
+                      number = OB_NAN;
+                      break;
+                    case SLY_SCALAR_INF:
+                      number = OB_POSINF;
+                      if (buf[0] == '-')
+                        number = -number;
+                      break;
+                    default:
+                      // XXX: use a variant of private_strtof64 instead
+                      number = strtod (buf, NULL);
+                      break;
+                  }
+                switch (h)
+                  {
+                    case SE_F64:
+                      bits *= 2;
+                    /* fall through */
+                    case SE_F32:
+                      bits *= 4;
+                      err = handler->handle_float (cookie, number, bits);
+                      break;
+                  }
+                MAYBE_FREE (buf);
+              }
+              break;
+            case SE_I16:
+            case SE_I32:
+            case SE_I64:
+            case SE_I8:
+            case SE_U16:
+            case SE_U32:
+            case SE_U64:
+            case SE_U8:
+              {
+                unt64_with_sign number;
+                int bits = 8;
+
+                if (plainTyp == SLY_SCALAR_UNDECIDED)
+                  plainTyp = sly_classify_plain ((const char *)
+                                                   ev->value,
+                                                 ev->length);
+
+                parse_integer (ev->value, ev->length, &number, plainTyp);
+                switch (h)
+                  {
+                    case SE_I64:
+                      bits *= 2;
+                    /* fall through */
+                    case SE_I32:
+                      bits *= 2;
+                    /* fall through */
+                    case SE_I16:
+                      bits *= 2;
+                    /* fall through */
+                    case SE_I8:
+                      if (number.negative)
+                        err =
+                          handler->handle_int (cookie,
+                                               -(int64) number.magnitude,
+                                               bits);
+                      else
+                        err = handler->handle_int (cookie,
+                                                   (int64) number.magnitude,
+                                                   bits);
+                      break;
+                    case SE_U64:
+                      bits *= 2;
+                    /* fall through */
+                    case SE_U32:
+                      bits *= 2;
+                    /* fall through */
+                    case SE_U16:
+                      bits *= 2;
+                    /* fall through */
+                    case SE_U8:
+                      err = handler->handle_unt (cookie, number.magnitude,
+                                                 bits);
+                      break;
+                  }
+              }
+              break;
+            case SE_NULL:
+              err = handler->handle_nil (cookie);
+              break;
+            case SE_STRING: /* the wrong way (bug 2939) */
+            case SE_STR:    /* the right way */
+              {
+                if (prev && (prev->CURRENT_ELEMENT == SE_PROTEIN)
+                    && ((prev->CURRENT_POSITION & 1) == 0))
+                  {
+                    unt64 h2 = ob_city_hash64 (ev->value, ev->length);
+                    if (h2 == SE_INGESTS || h2 == SE_DESCRIPS
+                        || h2 == SE_RUDE_DATA)
+                      {
+                        // XXXX: FIXME: cast away const
+                        ((v3unt64 *) prev)->CURRENT_CONTEXT = h2;
+                      }
+                    else
+                      {
+                        slaw tmp =
+                          slaw_string_from_substring (ev->value, ev->length);
+                        OB_LOG_ERROR_CODE (0x2000500e,
+                                           "slaw yaml: expected 'ingests', "
+                                           "'descrips',\n"
+                                           "or 'rude_data', but got '%s'\n",
+                                           slaw_string_emit (tmp));
+                        slaw_free (tmp);
+                        err = SLAW_PARSING_BADNESS;
+                      }
+                  }
+                else
+                  {
+                    err = handler->handle_string (cookie, ev->value,
+                                                  ev->length);
+                  }
+              }
+              break;
+            default:
+              {
+                const char *emptyPrefix = SLAW_TAG_PREFIX "empty/";
+                const char *multivectorPrefix = "multivector/";
+                const char *vectorPrefix = "vector/";
+                const char *complexPrefix = "complex/";
+                const size_t emptyPrefixLen = strlen (emptyPrefix);
+                const size_t multivectorPrefixLen =
+                  strlen (multivectorPrefix);
+                const size_t vectorPrefixLen = strlen (vectorPrefix);
+                const size_t complexPrefixLen = strlen (complexPrefix);
+                const char *tag = ev->tag;
+
+                if (strncmp (tag, emptyPrefix, emptyPrefixLen) == 0)
+                  {
+                    int vecsize = 1;
+                    bool isMVec = false;
+                    bool isComplex = false;
+                    bool isUnsigned = false;
+                    bool isFloat = false;
+                    int bits;
+
+                    tag += emptyPrefixLen;
+
+                    if (strncmp (tag, multivectorPrefix,
+                                 multivectorPrefixLen)
+                        == 0)
+                      {
+                        tag += multivectorPrefixLen;
+                        if (tag[0] >= '2' && tag[0] <= '5' && tag[1] == '/')
+                          {
+                            vecsize = tag[0] - '0';
+                            tag += 2;
+                            isMVec = true;
+                          }
+                        else
+                          {
+                            err = SLAW_BAD_TAG;
+                            ob_log (OBLV_WRNU, 0x20005002, "Bad tag: %s\n",
+                                    ev->tag);
+                            break;
+                          }
+                      }
+                    else if (strncmp (tag, vectorPrefix, vectorPrefixLen)
+                             == 0)
+                      {
+                        tag += vectorPrefixLen;
+                        if (tag[0] >= '2' && tag[0] <= '4' && tag[1] == '/')
+                          {
+                            vecsize = tag[0] - '0';
+                            tag += 2;
+                          }
+                        else
+                          {
+                            err = SLAW_BAD_TAG;
+                            ob_log (OBLV_WRNU, 0x20005003, "Bad tag: %s\n",
+                                    ev->tag);
+                            break;
+                          }
+                      }
+
+                    if (strncmp (tag, complexPrefix, complexPrefixLen) == 0)
+                      {
+                        isComplex = true;
+                        tag += complexPrefixLen;
+                      }
+
+                    if (tag[0] == 'u')
+                      isUnsigned = true;
+                    else if (tag[0] == 'f')
+                      isFloat = true;
+                    else if (tag[0] != 'i')
+                      {
+                        err = SLAW_BAD_TAG;
+                        ob_log (OBLV_WRNU, 0x20005004, "Bad tag: %s\n",
+                                ev->tag);
+                        break;
+                      }
+
+                    tag++;
+                    bits = atoi (tag);
+
+                    err =
+                      handler->handle_empty_array (cookie, vecsize, isMVec,
+                                                   isComplex, isUnsigned,
+                                                   isFloat, bits);
+                    break;
+                  }
+              }
+              err = SLAW_BAD_TAG;
+              ob_log (OBLV_WRNU, 0x20005005, "Bad tag: %s\n", ev->tag);
+              break;
+          }
+        break;
+      case YAML_SEQUENCE_START_EVENT:
+        if (!ev->tag
+            || (h = sly_hash ((const yaml_char_t *) ev->tag))
+                 == SE_NON_SPECIFIC)
+          h = SE_SEQ;
+        v.CURRENT_ELEMENT = h;
+        v.CURRENT_POSITION = 0;
+        v.CURRENT_CONTEXT = 0;
+        ob_err_accum (&err, slabu_list_add_x (stack, slaw_v3unt64 (v)));
+        pushed = true;
+        switch (h)
+          {
+            case SE_COMPLEX:
+              err = handler->begin_complex (cookie);
+              break;
+            case SE_VECTOR:
+              err = handler->begin_vector (cookie, -1);
+              break;
+            case SE_MULTIVECTOR:
+              err = handler->begin_multivector (cookie, -1);
+              break;
+            case SE_ARRAY:
+              err = handler->begin_array (cookie, -1, -1);
+              break;
+            case SE_SEQ:
+              err = handler->begin_list (cookie, -1);
+              break;
+            case SE_OMAP:
+              err = handler->begin_map (cookie, -1);
+              break;
+            default:
+              err = SLAW_BAD_TAG;
+              ob_log (OBLV_WRNU, 0x20005006, "Bad start sequence tag: %s\n",
+                      ev->tag);
+              break;
+          }
+        break;
+      case YAML_SEQUENCE_END_EVENT:
+        popped = sly_pop (stack);
+        if (!popped || !slaw_v3unt64_emit (popped))
+          {
+            // I don't think it should be possible for this to occur,
+            // so I'm going to call it a programming error, rather than
+            // a user error.
+            OB_LOG_BUG_CODE (0x2000500f, "slaw yaml: stack popping problem "
+                                         "at sequence end\n");
+            err = SLAW_PARSING_BADNESS;
+            break;
+          }
+        h = slaw_v3unt64_emit (popped)->CURRENT_ELEMENT;
+        switch (h)
+          {
+            case SE_COMPLEX:
+              err = handler->end_complex (cookie);
+              break;
+            case SE_VECTOR:
+              err = handler->end_vector (cookie);
+              break;
+            case SE_MULTIVECTOR:
+              err = handler->end_multivector (cookie);
+              break;
+            case SE_ARRAY:
+              err = handler->end_array (cookie);
+              break;
+            case SE_SEQ:
+              err = handler->end_list (cookie);
+              break;
+            case SE_OMAP:
+              err = handler->end_map (cookie);
+              break;
+            default:
+              err = SLAW_BAD_TAG;
+              ob_log (OBLV_WRNU, 0x20005007,
+                      "Bad end sequence tag: %" OB_FMT_64 "u\n", h);
+              break;
+          }
+        break;
+      case YAML_MAPPING_START_EVENT:
+        if (!ev->tag
+            || (h = sly_hash ((const yaml_char_t *) ev->tag))
+                 == SE_NON_SPECIFIC)
+          h = SE_MAP;
+        if (prev && prev->CURRENT_ELEMENT == SE_OMAP)
+          h = SE_CONS;
+        v.CURRENT_ELEMENT = h;
+        v.CURRENT_POSITION = 0;
+        v.CURRENT_CONTEXT = 0;
+        ob_err_accum (&err, slabu_list_add_x (stack, slaw_v3unt64 (v)));
+        pushed = true;
+        switch (h)
+          {
+            case SE_MAP:
+              err = handler->begin_map (cookie, -1);
+              break;
+            case SE_CONS:
+              err = handler->begin_cons (cookie);
+              break;
+            case SE_PROTEIN:
+              err = handler->begin_protein (cookie);
+              break;
+            default:
+              err = SLAW_BAD_TAG;
+              ob_log (OBLV_WRNU, 0x20005008, "Bad start mapping tag: %s\n",
+                      ev->tag);
+              break;
+          }
+        break;
+      case YAML_MAPPING_END_EVENT:
+        popped = sly_pop (stack);
+        if (!popped || !slaw_v3unt64_emit (popped))
+          {
+            // I don't think it should be possible for this to occur,
+            // so I'm going to call it a programming error, rather than
+            // a user error.
+            OB_LOG_BUG_CODE (0x20005010, "slaw yaml: stack popping problem "
+                                         "at mapping end\n");
+            err = SLAW_PARSING_BADNESS;
+            break;
+          }
+        h = slaw_v3unt64_emit (popped)->CURRENT_ELEMENT;
+        switch (h)
+          {
+            case SE_MAP:
+              err = handler->end_map (cookie);
+              break;
+            case SE_CONS:
+              err = handler->end_cons (cookie);
+              break;
+            case SE_PROTEIN:
+              err = handler->end_protein (cookie);
+              break;
+            default:
+              err = SLAW_BAD_TAG;
+              ob_log (OBLV_WRNU, 0x20005009,
+                      "Bad end mapping tag: %" OB_FMT_64 "u\n", h);
+              break;
+          }
+        break;
+      case YAML_NO_EVENT:
+        // This seems to be what happens if we try reading after
+        // already getting SLAW_END_OF_FILE once.  That's why
+        // MiscSlawTest.GenericOpen tests for SLAW_END_OF_FILE twice;
+        // the second time is this case.
+        err = SLAW_END_OF_FILE;
+        break;
+      default:
+        // I don't think it should be possible for this to occur,
+        // so I'm going to call it a programming error, rather than
+        // a user error.
+        OB_LOG_BUG_CODE (0x20005011, "slaw yaml: yaml parser produced "
+                                     "strange event %d\n",
+                         ev->type);
+        err = SLAW_PARSING_BADNESS;
+        break;
+    }
+
+  if (err == OB_OK && !pushed)
+    {
+      prev = slaw_v3unt64_emit (sly_peek (stack));
+      if (prev)
+        {
+          // XXXX: FIXME: cast away const
+          ((v3unt64 *) prev)->CURRENT_POSITION++;
+          if (0 == (prev->CURRENT_POSITION & 1))
+            {
+              if (prev->CURRENT_ELEMENT == SE_MAP)
+                {
+                  err = handler->end_cons (cookie);
+                }
+              else if (prev->CURRENT_ELEMENT == SE_PROTEIN)
+                {
+                  if (prev->CURRENT_CONTEXT == SE_DESCRIPS)
+                    {
+                      err = handler->end_descrips (cookie);
+                    }
+                  else if (prev->CURRENT_CONTEXT == SE_INGESTS)
+                    {
+                      err = handler->end_ingests (cookie);
+                    }
+                }
+            }
+        }
+    }
+
+  if (popped)
+    slaw_free (popped);
+
+  return err;
+}
+
 static ob_retort sly_parse (void *cookie, const slaw_handler *handler,
                             yaml_parser_t *parser)
 {
-  yaml_event_t event;
-  byte little_buffer[64];
-  slabu *stack = slabu_new ();
-  ob_retort err = OB_OK;
-  if (stack == NULL)
-    return OB_NO_MEM;
+  yaml_event_t event;
+  sly_event ev;
+  sly_parse_state ps;
+  ob_retort err = OB_OK;
+
+  ps.cookie = cookie;
+  ps.handler = handler;
+  ps.stack = slabu_new ();
+  if (ps.stack == NULL)
+    return OB_NO_MEM;
+
+  do
+    {
+      if (!yaml_parser_parse (parser, &event))
+        {
+          err = PRINT_YAML_PARSE_ERROR (parser);
+          break;
+        }
+      sly_event_from_yaml (&event, &ev);
+      err = sly_step (&ps, &ev);
+      yaml_event_delete (&event);
+    }
+  while (err == OB_OK && slabu_count (ps.stack) > 0);
+
+  slabu_free (ps.stack);
+
+  return err;
+}
+
+/* The fast reader.
+ *
+ * libyaml is thorough, and so it isn't fast: every event goes through
+ * its scanner, token queue and parser, and every scalar and tag gets a
+ * malloc of its own.  But most of the YAML we read is YAML that we
+ * wrote ourselves, which only uses a little of the language: block
+ * sequences and mappings, flow sequences for arrays and vectors,
+ * plain and quoted scalars with short tags, literal block scalars for
+ * multi-line strings and base64, and the %YAML and %TAG directives.
+ * So we read that much ourselves, a line at a time, straight out of
+ * our input buffer, and hand sly_step() the same events libyaml would
+ * have.
+ *
+ * When we meet anything else (anchors and aliases, complex keys,
+ * folded scalars, non-empty flow mappings, tabs, syntax errors...),
+ * we throw away whatever we've built of the current document, and
+ * give libyaml the input from the start of that document on; it reads
+ * the rest of the stream.  (And if it was an error, libyaml is the one
+ * that complains about it, just like before.)
+ */
+
+#define SLY_FAST_CHUNK 4096
+#define SLY_FAST_TAG_MAX 256
+#define SLY_FAST_MAX_DEPTH 200
+
+typedef struct sly_fast
+{
+  const slaw_read_handler *h;
+  sly_parse_state *ps;
+  char *buf;       /* our input, starting with the current document */
+  size_t cap;      /* bytes allocated for buf */
+  size_t len;      /* bytes read into buf */
+  size_t line;     /* start of the current line */
+  size_t eol;      /* end of the current line, i.e. its '\n' or len */
+  size_t pos;      /* where we are in the current line */
+  size_t replay;   /* how much of buf libyaml has read, after we give up */
+  bool have_line;  /* the current line is all in buf, and checked */
+  bool eof;        /* h has nothing more for us */
+  bool started;    /* we've begun a document */
+  bool give_up;    /* we've met something we leave to libyaml */
+  ob_retort tort;  /* an error from h or from sly_step() */
+  int depth;       /* how many collections we're inside */
+  unt8 directives; /* which directives this document has had */
+  char *scratch;   /* for scalars that aren't just a piece of buf */
+  size_t scratch_cap;
+  size_t scratch_len;
+  char tag[SLY_FAST_TAG_MAX]; /* the last tag we read, expanded */
+  char bang[SLY_FAST_TAG_MAX];     /* what the "!" handle stands for */
+  char bangbang[SLY_FAST_TAG_MAX]; /* and "!!" */
+} sly_fast;
+
+#define FAST_SAW_YAML 1
+#define FAST_SAW_BANG 2
+#define FAST_SAW_BANGBANG 4
+
+/* The character k after the current one, or NUL at the end of the
+ * line (a NUL in the line itself would have made us give up). */
+#define FAST_CH(r, k)                                                          \
+  ((r)->pos + (k) < (r)->eol ? (r)->buf[(r)->pos + (k)] : '\0')
+#define FAST_BLANK(r, k) (FAST_CH (r, k) == ' ' || FAST_CH (r, k) == '\0')
+
+static bool fast_give_up (sly_fast *r)
+{
+  r->give_up = true;
+  return false;
+}
+
+static bool fast_ok (const sly_fast *r)
+{
+  return !r->give_up && r->tort == OB_OK;
+}
+
+static bool fast_one_of (char c, const char *set)
+{
+  return c != '\0' && strchr (set, c) != NULL;
+}
+
+static int fast_col (const sly_fast *r)
+{
+  return (int) (r->pos - r->line);
+}
+
+static bool fast_read_more (sly_fast *r)
+{
+  size_t got = 0;
+  if (r->cap - r->len < SLY_FAST_CHUNK)
+    {
+      size_t cap = (r->cap < SLY_FAST_CHUNK ? 4 * SLY_FAST_CHUNK : 2 * r->cap);
+      char *buf = (char *) realloc (r->buf, cap);
+      if (!buf)
+        {
+          r->tort = OB_NO_MEM;
+          return false;
+        }
+      r->buf = buf;
+      r->cap = cap;
+    }
+  ob_retort tort =
+    r->h->read (r->h->cookie, (byte *) r->buf + r->len, r->cap - r->len, &got);
+  if (tort < OB_OK)
+    {
+      r->tort = tort;
+      return false;
+    }
+  if (got == 0)
+    r->eof = true;
+  r->len += got;
+  return true;
+}
+
+/* libyaml only accepts printable characters, so we make sure that's
+ * all we've got.  We also leave tabs, carriage returns, and the
+ * unicode line breaks (0x85, 0x2028 and 0x2029) to libyaml, since we
+ * never write them outside of double quotes, and they change how
+ * lines and indentation work. */
+static bool fast_check_line (const byte *p, size_t n)
+{
+  size_t i = 0;
+  while (i < n)
+    {
+      const byte c = p[i];
+      unt32 u;
+      int k, j;
+      if (c < 0x80)
+        {
+          if (c < 0x20 || c == 0x7f)
+            return false;
+          i++;
+          continue;
+        }
+      if ((c & 0xe0) == 0xc0)
+        u = c & 0x1f, k = 1;
+      else if ((c & 0xf0) == 0xe0)
+        u = c & 0x0f, k = 2;
+      else if ((c & 0xf8) == 0xf0)
+        u = c & 0x07, k = 3;
+      else
+        return false;
+      if (i + k >= n)
+        return false;
+      for (j = 1; j <= k; j++)
+        {
+          if ((p[i + j] & 0xc0) != 0x80)
+            return false;
+          u = (u << 6) | (p[i + j] & 0x3f);
+        }
+      if ((k == 1 && u < 0xa0) || (k == 2 && u < 0x800)
+          || (k == 3 && (u < 0x10000 || u > 0x10ffff))
+          || (u >= 0xd800 && u <= 0xdfff) || u == 0x2028 || u == 0x2029
+          || u == 0xfeff || u == 0xfffe || u == 0xffff)
+        return false;
+      i += k + 1;
+    }
+  return true;
+}
+
+/* Makes sure the line starting at r->line is all in buf, up to its
+ * newline (or the end of the input), and is made of characters we're
+ * happy with.  Returns false at the end of the input, or if there was
+ * trouble (which fast_ok() will tell you). */
+static bool fast_fill_line (sly_fast *r)
+{
+  size_t scanned = r->line;
+  const char *nl = NULL;
+
+  if (r->have_line)
+    return true;
+  for (;;)
+    {
+      if (r->len > scanned
+          && (nl = (const char *) memchr (r->buf + scanned, '\n',
+                                          r->len - scanned)))
+        break;
+      if (r->eof)
+        break;
+      scanned = r->len;
+      if (!fast_read_more (r))
+        return false;
+    }
+  r->eol = (nl ? (size_t) (nl - r->buf) : r->len);
+  if (!nl && r->eol == r->line)
+    return false;
+  if (!fast_check_line ((const byte *) r->buf + r->line, r->eol - r->line))
+    return fast_give_up (r);
+  r->pos = r->line;
+  r->have_line = true;
+  return true;
+}
+
+static void fast_next_line (sly_fast *r)
+{
+  r->line = (r->eol < r->len ? r->eol + 1 : r->len);
+  r->pos = r->line;
+  r->have_line = false;
+}
+
+static void fast_skip_spaces (sly_fast *r)
+{
+  while (FAST_CH (r, 0) == ' ')
+    r->pos++;
+}
+
+/* Is there nothing left on this line but (maybe) a comment? */
+static bool fast_rest_blank (sly_fast *r)
+{
+  fast_skip_spaces (r);
+  const char c = FAST_CH (r, 0);
+  return (c == '\0'
+          || (c == '#' && (r->pos == r->line || r->buf[r->pos - 1] == ' ')));
+}
+
+/* Moves to the next line with something other than spaces and
+ * comments on it, and to the first thing on it.  Returns false at the
+ * end of the input, or if there was trouble. */
+static bool fast_skip_to_content (sly_fast *r)
+{
+  for (;;)
+    {
+      if (!fast_fill_line (r))
+        return false;
+      fast_skip_spaces (r);
+      const char c = FAST_CH (r, 0);
+      if (c != '\0' && c != '#')
+        return true;
+      fast_next_line (r);
+    }
+}
+
+/* For when a node ends partway along a line: the rest of the line had
+ * better be blank.  Leaves us where fast_skip_to_content() does. */
+static bool fast_end_line (sly_fast *r)
+{
+  if (!fast_rest_blank (r))
+    return fast_give_up (r);
+  fast_next_line (r);
+  fast_skip_to_content (r);
+  return fast_ok (r);
+}
+
+/* Is this line "---" or "...", with nothing else but a space after? */
+static bool fast_doc_marker (const sly_fast *r)
+{
+  const char *p = r->buf + r->line;
+  const size_t n = r->eol - r->line;
+  return (r->pos == r->line && n >= 3
+          && (memcmp (p, "---", 3) == 0 || memcmp (p, "...", 3) == 0)
+          && (n == 3 || p[3] == ' '));
+}
+
+static bool fast_scratch_add (sly_fast *r, const char *s, size_t n)
+{
+  if (r->scratch_cap - r->scratch_len < n)
+    {
+      size_t cap = (r->scratch_cap < 256 ? 256 : r->scratch_cap);
+      while (cap - r->scratch_len < n)
+        cap *= 2;
+      char *scratch = (char *) realloc (r->scratch, cap);
+      if (!scratch)
+        {
+          r->tort = OB_NO_MEM;
+          return false;
+        }
+      r->scratch = scratch;
+      r->scratch_cap = cap;
+    }
+  memcpy (r->scratch + r->scratch_len, s, n);
+  r->scratch_len += n;
+  return true;
+}
+
+static bool fast_scratch_newlines (sly_fast *r, int64 n)
+{
+  for (; n > 0; n--)
+    if (!fast_scratch_add (r, "\n", 1))
+      return false;
+  return true;
+}
+
+static bool fast_emit (sly_fast *r, yaml_event_type_t type, const char *tag,
+                       const char *value, size_t len, bool plain)
+{
+  sly_event ev;
+  ev.type = type;
+  ev.tag = tag;
+  ev.value = value;
+  ev.length = len;
+  ev.plain = plain;
+  ob_retort tort = sly_step (r->ps, &ev);
+  if (tort != OB_OK)
+    {
+      r->tort = tort;
+      return false;
+    }
+  return true;
+}
+
+/* A scalar whose value is in buf (which may have moved since we found
+ * it, so we go by offsets) */
+static bool fast_emit_plain (sly_fast *r, const char *tag, size_t start,
+                             size_t end)
+{
+  return fast_emit (r, YAML_SCALAR_EVENT, tag,
+                    (end > start ? r->buf + start : ""), end - start, true);
+}
+
+/* A scalar whose value is in scratch */
+static bool fast_emit_scratch (sly_fast *r, const char *tag, bool plain)
+{
+  return fast_emit (r, YAML_SCALAR_EVENT, tag,
+                    (r->scratch_len > 0 ? r->scratch : ""), r->scratch_len,
+                    plain);
+}
+
+/* the characters that can go in a tag after its handle (we leave
+ * %-escapes to libyaml) */
+static bool fast_tag_char (char c)
+{
+  return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+          || (c >= '0' && c <= '9') || fast_one_of (c, "-_;/?:@&=+$.~*'()"));
+}
+
+/* those, and the ones that can also go in a verbatim tag, or a %TAG
+ * prefix */
+static bool fast_uri_char (char c)
+{
+  return fast_tag_char (c) || fast_one_of (c, "!,[]");
+}
+
+/* Reads a tag like !i32, !!omap or !<tag:yaml.org,2002:str> into
+ * r->tag, with its handle expanded the way libyaml would. */
+static bool fast_tag (sly_fast *r)
+{
+  const char *prefix = r->bang;
+  size_t start, n, plen;
+
+  r->pos++;
+  if (FAST_CH (r, 0) == '<')
+    {
+      prefix = "";
+      start = ++r->pos;
+      while (fast_uri_char (FAST_CH (r, 0)))
+        r->pos++;
+      n = r->pos - start;
+      if (n == 0 || FAST_CH (r, 0) != '>')
+        return fast_give_up (r);
+      r->pos++;
+    }
+  else
+    {
+      if (FAST_CH (r, 0) == '!')
+        {
+          prefix = r->bangbang;
+          r->pos++;
+        }
+      start = r->pos;
+      while (fast_tag_char (FAST_CH (r, 0)))
+        r->pos++;
+      n = r->pos - start;
+      if (n == 0)
+        {
+          /* a bare "!" is the non-specific tag, which libyaml doesn't
+           * expand; a bare "!!" is an error */
+          if (prefix != r->bang)
+            return fast_give_up (r);
+          prefix = "!";
+        }
+    }
+  plen = strlen (prefix);
+  if (FAST_CH (r, 0) != ' ' && FAST_CH (r, 0) != '\0')
+    return fast_give_up (r);
+  if (plen + n >= sizeof (r->tag))
+    return fast_give_up (r);
+  memcpy (r->tag, prefix, plen);
+  memcpy (r->tag + plen, r->buf + start, n);
+  r->tag[plen + n] = 0;
+  return true;
+}
+
+/* Reads a node's properties, if it has any.  We only do tags, not
+ * anchors (or aliases, which we check for here too, since this is
+ * where they would be). */
+static bool fast_props (sly_fast *r, const char **tag)
+{
+  *tag = NULL;
+  if (FAST_CH (r, 0) == '!')
+    {
+      if (!fast_tag (r))
+        return false;
+      *tag = r->tag;
+      fast_skip_spaces (r);
+    }
+  if (fast_one_of (FAST_CH (r, 0), "!&*"))
+    return fast_give_up (r);
+  return true;
+}
+
+/* Can a plain scalar start with c (followed by next)? */
+static bool fast_plain_start (char c, char next, bool flow)
+{
+  if (fast_one_of (c, "-?:"))
+    return !(next == ' ' || next == '\0'
+             || (flow && fast_one_of (next, ",[]{}")));
+  return c != '\0' && !fast_one_of (c, ",[]{}#&*!|>'\"%@`");
+}
+
+/* Moves to the end of the plain scalar starting at r->pos, as far as
+ * this line goes: to a ": ", a " #", the end of the line, or (in a
+ * flow sequence) one of ",[]{}".  Returns where the text ends, not
+ * counting trailing spaces. */
+static size_t fast_plain_line (sly_fast *r, bool flow)
+{
+  size_t end = r->pos;
+  for (;;)
+    {
+      const char c = FAST_CH (r, 0);
+      if (c == '\0')
+        break;
+      if (c == ':')
+        {
+          const char next = FAST_CH (r, 1);
+          if (next == ' ' || next == '\0'
+              || (flow && fast_one_of (next, ",[]{}")))
+            break;
+        }
+      else if (c == '#' && r->buf[r->pos - 1] == ' ')
+        break;
+      else if (flow && fast_one_of (c, ",[]{}"))
+        break;
+      r->pos++;
+      if (c != ' ')
+        end = r->pos;
+    }
+  return end;
+}
+
+/* A plain scalar in a block, which may carry on over the following
+ * lines, so long as they're indented more than \a indent; its line
+ * breaks fold into spaces (or, for blank lines, newlines). */
+static bool fast_plain_block (sly_fast *r, int indent, const char *tag)
+{
+  const size_t start = r->pos;
+  const size_t end = fast_plain_line (r, false);
+  bool folded = false;
+
+  for (;;)
+    {
+      const char c = FAST_CH (r, 0);
+      int64 breaks = 0;
+      size_t s, e;
+      if (c == ':')
+        return fast_give_up (r); /* a key where it can't be one */
+      fast_next_line (r);
+      if (c == '#')
+        break;
+      /* see whether the next line with anything on it carries on */
+      for (;;)
+        {
+          if (!fast_fill_line (r))
+            break;
+          fast_skip_spaces (r);
+          if (FAST_CH (r, 0) != '\0')
+            break;
+          breaks++;
+          fast_next_line (r);
+        }
+      if (!r->have_line || fast_col (r) <= indent || FAST_CH (r, 0) == '#'
+          || fast_doc_marker (r))
+        break;
+      if (!folded)
+        {
+          r->scratch_len = 0;
+          if (!fast_scratch_add (r, r->buf + start, end - start))
+            return false;
+          folded = true;
+        }
+      if (breaks == 0 ? !fast_scratch_add (r, " ", 1)
+                      : !fast_scratch_newlines (r, breaks))
+        return false;
+      s = r->pos;
+      e = fast_plain_line (r, false);
+      if (!fast_scratch_add (r, r->buf + s, e - s))
+        return false;
+    }
+  if (!fast_ok (r))
+    return false;
+  if (!(folded ? fast_emit_scratch (r, tag, true)
+               : fast_emit_plain (r, tag, start, end)))
+    return false;
+  fast_skip_to_content (r);
+  return fast_ok (r);
+}
+
+/* Moves a quoted scalar on to the next line with something on it.
+ * The line break becomes a space, unless there are blank lines after
+ * it, in which case those become newlines.  (Or, if it was escaped,
+ * it doesn't become anything.) */
+static bool fast_quoted_break (sly_fast *r, bool escaped)
+{
+  int64 breaks = 0;
+  for (;;)
+    {
+      fast_next_line (r);
+      if (!fast_fill_line (r) || fast_doc_marker (r))
+        return false;
+      fast_skip_spaces (r);
+      if (FAST_CH (r, 0) != '\0')
+        break;
+      breaks++;
+    }
+  if (breaks == 0 && !escaped)
+    return fast_scratch_add (r, " ", 1);
+  return fast_scratch_newlines (r, breaks);
+}
+
+/* Reads a single-quoted scalar into scratch, leaving r->pos after the
+ * closing quote.  Unless \a one_line, it can go on for several lines,
+ * which fold like a plain scalar's. */
+static bool fast_single (sly_fast *r, bool one_line)
+{
+  size_t spaces = 0; /* the ones just before r->pos */
+  r->scratch_len = 0;
+  r->pos++;
+  for (;;)
+    {
+      const char c = FAST_CH (r, 0);
+      if (c == ' ')
+        {
+          spaces++;
+          r->pos++;
+          continue;
+        }
+      /* spaces before a line break don't count; any others do */
+      if (c != '\0' && spaces > 0
+          && !fast_scratch_add (r, r->buf + r->pos - spaces, spaces))
+        return false;
+      spaces = 0;
+      if (c == '\'')
+        {
+          if (FAST_CH (r, 1) != '\'')
+            break;
+          if (!fast_scratch_add (r, "'", 1))
+            return false;
+          r->pos += 2;
+        }
+      else if (c == '\0')
+        {
+          if (one_line || !fast_quoted_break (r, false))
+            return (fast_ok (r) ? fast_give_up (r) : false);
+        }
+      else
+        {
+          const size_t s = r->pos;
+          while (FAST_CH (r, 0) != '\0' && !fast_one_of (FAST_CH (r, 0), "' "))
+            r->pos++;
+          if (!fast_scratch_add (r, r->buf + s, r->pos - s))
+            return false;
+        }
+    }
+  r->pos++;
+  return true;
+}
+
+static int fast_hex (char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+/* Reads a double-quoted scalar into scratch, leaving r->pos after the
+ * closing quote.  Unless \a one_line, it can go on for several lines
+ * (which libyaml does for long strings with control characters in
+ * them), with its line breaks folded like a single-quoted scalar's,
+ * or escaped with a backslash. */
+static bool fast_double (sly_fast *r, bool one_line)
+{
+  size_t spaces = 0; /* as in fast_single() */
+  r->scratch_len = 0;
+  r->pos++;
+  for (;;)
+    {
+      const char c = FAST_CH (r, 0);
+      char utf8[4];
+      unt32 u;
+      int i, n;
+      if (c == ' ')
+        {
+          spaces++;
+          r->pos++;
+          continue;
+        }
+      /* (spaces before an escaped line break do count) */
+      if (c != '\0' && spaces > 0
+          && !fast_scratch_add (r, r->buf + r->pos - spaces, spaces))
+        return false;
+      spaces = 0;
+      if (c == '"')
+        break;
+      if (c == '\0' || (c == '\\' && FAST_CH (r, 1) == '\0'))
+        {
+          if (one_line || !fast_quoted_break (r, c == '\\'))
+            return (fast_ok (r) ? fast_give_up (r) : false);
+          continue;
+        }
+      if (c != '\\')
+        {
+          const size_t s = r->pos;
+          while (FAST_CH (r, 0) != '\0'
+                 && !fast_one_of (FAST_CH (r, 0), "\"\\ "))
+            r->pos++;
+          if (!fast_scratch_add (r, r->buf + s, r->pos - s))
+            return false;
+          continue;
+        }
+      n = 0;
+      switch (FAST_CH (r, 1))
+        {
+          case '0':
+            u = 0;
+            break;
+          case 'a':
+            u = 7;
+            break;
+          case 'b':
+            u = 8;
+            break;
+          case 't':
+            u = 9;
+            break;
+          case 'n':
+            u = 10;
+            break;
+          case 'v':
+            u = 11;
+            break;
+          case 'f':
+            u = 12;
+            break;
+          case 'r':
+            u = 13;
+            break;
+          case 'e':
+            u = 27;
+            break;
+          case ' ':
+          case '"':
+          case '/':
+          case '\\':
+            u = (unt32) FAST_CH (r, 1);
+            break;
+          case 'N':
+            u = 0x85;
+            break;
+          case '_':
+            u = 0xa0;
+            break;
+          case 'L':
+            u = 0x2028;
+            break;
+          case 'P':
+            u = 0x2029;
+            break;
+          case 'x':
+            n = 2;
+            break;
+          case 'u':
+            n = 4;
+            break;
+          case 'U':
+            n = 8;
+            break;
+          default:
+            return fast_give_up (r);
+        }
+      r->pos += 2;
+      if (n > 0)
+        {
+          for (u = 0, i = 0; i < n; i++)
+            {
+              const int x = fast_hex (FAST_CH (r, i));
+              if (x < 0)
+                return fast_give_up (r);
+              u = (u << 4) | x;
+            }
+          r->pos += n;
+          if ((u >= 0xd800 && u <= 0xdfff) || u > 0x10ffff)
+            return fast_give_up (r);
+        }
+      if (u < 0x80)
+        utf8[0] = (char) u, n = 1;
+      else if (u < 0x800)
+        {
+          utf8[0] = (char) (0xc0 | (u >> 6));
+          utf8[1] = (char) (0x80 | (u & 0x3f));
+          n = 2;
+        }
+      else if (u < 0x10000)
+        {
+          utf8[0] = (char) (0xe0 | (u >> 12));
+          utf8[1] = (char) (0x80 | ((u >> 6) & 0x3f));
+          utf8[2] = (char) (0x80 | (u & 0x3f));
+          n = 3;
+        }
+      else
+        {
+          utf8[0] = (char) (0xf0 | (u >> 18));
+          utf8[1] = (char) (0x80 | ((u >> 12) & 0x3f));
+          utf8[2] = (char) (0x80 | ((u >> 6) & 0x3f));
+          utf8[3] = (char) (0x80 | (u & 0x3f));
+          n = 4;
+        }
+      if (!fast_scratch_add (r, utf8, n))
+        return false;
+    }
+  r->pos++;
+  return true;
+}
+
+/* A literal block scalar ("|", with maybe a chomping indicator and an
+ * indentation indicator), which is how we write multi-line strings
+ * and base64.  \a indent is the column of the collection it's in. */
+static bool fast_literal (sly_fast *r, int indent, const char *tag)
+{
+  int chomp = 0; /* -1 for strip, 0 for clip, 1 for keep */
+  int increment = 0;
+  int64 n, breaks = 0;
+  bool content = false, last_break = false;
+  int i;
+
+  r->pos++;
+  for (i = 0; i < 2; i++)
+    {
+      const char c = FAST_CH (r, 0);
+      if ((c == '+' || c == '-') && chomp == 0)
+        chomp = (c == '+' ? 1 : -1);
+      else if (c >= '1' && c <= '9' && increment == 0)
+        increment = c - '0';
+      else
+        break;
+      r->pos++;
+    }
+  if (!fast_rest_blank (r))
+    return fast_give_up (r);
+  fast_next_line (r);
+
+  if (increment > 0)
+    n = (indent >= 0 ? indent + increment : increment);
+  else
+    {
+      /* the first line with something on it sets the indentation,
+       * and any blank lines before it mustn't be longer */
+      const size_t first = r->line;
+      int64 longest = 0;
+      n = -1;
+      while (fast_fill_line (r))
+        {
+          fast_skip_spaces (r);
+          if (FAST_CH (r, 0) != '\0')
+            {
+              n = fast_col (r);
+              break;
+            }
+          if (fast_col (r) > longest)
+            longest = fast_col (r);
+          fast_next_line (r);
+        }
+      if (!fast_ok (r))
+        return false;
+      if (n >= 0 && longest > n)
+        return fast_give_up (r);
+      if (n < longest)
+        n = longest;
+      if (n < indent + 1)
+        n = indent + 1;
+      if (n < 1)
+        n = 1;
+      r->line = r->pos = first;
+      r->have_line = false;
+    }
+
+  r->scratch_len = 0;
+  for (;;)
+    {
+      size_t avail, sp = 0;
+      if (!fast_fill_line (r))
+        break;
+      avail = r->eol - r->line;
+      while (sp < (size_t) n && sp < avail && r->buf[r->line + sp] == ' ')
+        sp++;
+      if (sp == avail)
+        {
+          /* a blank line, unless it's the end of the input */
+          if (r->eol == r->len)
+            break;
+          breaks++;
+          fast_next_line (r);
+          continue;
+        }
+      if (sp < (size_t) n)
+        break;
+      if ((content && !fast_scratch_add (r, "\n", 1))
+          || !fast_scratch_newlines (r, breaks)
+          || !fast_scratch_add (r, r->buf + r->line + n, avail - n))
+        return false;
+      breaks = 0;
+      content = true;
+      last_break = (r->eol < r->len);
+      fast_next_line (r);
+    }
+  if (!fast_ok (r))
+    return false;
+  if (chomp >= 0 && content && last_break && !fast_scratch_add (r, "\n", 1))
+    return false;
+  if (chomp > 0 && !fast_scratch_newlines (r, breaks))
+    return false;
+  if (!fast_emit_scratch (r, tag, false))
+    return false;
+  fast_skip_to_content (r);
+  return fast_ok (r);
+}
+
+/* "{}", which is how libyaml writes an empty map or protein */
+static bool fast_empty_map (sly_fast *r, const char *tag)
+{
+  r->pos++;
+  fast_skip_spaces (r);
+  if (FAST_CH (r, 0) != '}')
+    return fast_give_up (r);
+  r->pos++;
+  return (fast_emit (r, YAML_MAPPING_START_EVENT, tag, NULL, 0, false)
+          && fast_emit (r, YAML_MAPPING_END_EVENT, NULL, NULL, 0, false));
+}
+
+/* Skips spaces, comments and line breaks inside a flow sequence */
+static bool fast_flow_space (sly_fast *r)
+{
+  while (fast_rest_blank (r))
+    {
+      fast_next_line (r);
+      if (!fast_fill_line (r))
+        return (fast_ok (r) ? fast_give_up (r) : false);
+      if (fast_doc_marker (r))
+        return fast_give_up (r);
+    }
+  return true;
+}
+
+static bool fast_flow_seq (sly_fast *r, const char *tag);
+
+static bool fast_flow_node (sly_fast *r)
+{
+  const char *tag;
+  size_t start, end;
+  if (!fast_props (r, &tag))
+    return false;
+  switch (FAST_CH (r, 0))
+    {
+      case '[':
+        return fast_flow_seq (r, tag);
+      case '{':
+        return fast_empty_map (r, tag);
+      case '\'':
+        return fast_single (r, false) && fast_emit_scratch (r, tag, false);
+      case '"':
+        return fast_double (r, false) && fast_emit_scratch (r, tag, false);
+    }
+  if (!fast_plain_start (FAST_CH (r, 0), FAST_CH (r, 1), true))
+    return fast_give_up (r);
+  start = r->pos;
+  end = fast_plain_line (r, true);
+  if (FAST_CH (r, 0) == ':')
+    return fast_give_up (r);
+  return fast_emit_plain (r, tag, start, end);
+}
+
+/* "[a, b, c]", which may be spread over several lines.  (If a plain
+ * scalar in one were spread over several lines, the line after it
+ * wouldn't start with a ',' or ']', and we'd give up.) */
+static bool fast_flow_seq (sly_fast *r, const char *tag)
+{
+  bool want_item = true;
+  if (++r->depth > SLY_FAST_MAX_DEPTH)
+    return fast_give_up (r);
+  if (!fast_emit (r, YAML_SEQUENCE_START_EVENT, tag, NULL, 0, false))
+    return false;
+  r->pos++;
+  for (;;)
+    {
+      if (!fast_flow_space (r))
+        return false;
+      const char c = FAST_CH (r, 0);
+      if (c == ']')
+        break; /* (after a trailing comma, too, which is fine) */
+      if (!want_item)
+        {
+          if (c != ',')
+            return fast_give_up (r);
+          r->pos++;
+          want_item = true;
+          continue;
+        }
+      if (c == ',' || !fast_flow_node (r))
+        return (c == ',' ? fast_give_up (r) : false);
+      want_item = false;
+    }
+  r->pos++;
+  r->depth--;
+  return fast_emit (r, YAML_SEQUENCE_END_EVENT, NULL, NULL, 0, false);
+}
+
+/* Does the line from \a p on start with a key: either a "?", or a
+ * simple key (maybe with a tag), followed by a ':'? */
+static bool fast_key_ahead (const sly_fast *r, size_t p)
+{
+  const char *b = r->buf;
+  const size_t e = r->eol;
+
+  size_t start;
+
+  if (p < e && b[p] == '?' && (p + 1 == e || b[p + 1] == ' '))
+    return true;
+
+  while (p < e && b[p] == '!')
+    {
+      while (p < e && b[p] != ' ')
+        p++;
+      while (p < e && b[p] == ' ')
+        p++;
+    }
+  if (p >= e)
+    return false;
+  start = p;
+  if (b[p] == '\'' || b[p] == '"')
+    {
+      const char q = b[p++];
+      for (; p < e; p++)
+        if (b[p] == '\\' && q == '"')
+          p++;
+        else if (b[p] == q && q == '\'' && p + 1 < e && b[p + 1] == '\'')
+          p++;
+        else if (b[p] == q)
+          break;
+      if (p >= e)
+        return false;
+      p++;
+    }
+  else if (p + 1 < e && ((b[p] == '[' && b[p + 1] == ']')
+                         || (b[p] == '{' && b[p + 1] == '}')))
+    p += 2; /* how libyaml writes an empty list or map as a key */
+  if (p > start)
+    {
+      for (; p < e && b[p] == ' '; p++)
+        ;
+      return (p < e && b[p] == ':' && (p + 1 == e || b[p + 1] == ' '));
+    }
+  if (!fast_plain_start (b[p], (p + 1 < e ? b[p + 1] : '\0'), false))
+    return false;
+  for (; p < e; p++)
+    if (b[p] == ':' && (p + 1 == e || b[p + 1] == ' '))
+      return true;
+    else if (b[p] == '#' && b[p - 1] == ' ')
+      return false;
+  return false;
+}
+
+/* A simple key: a scalar all on one line, followed by ':' */
+static bool fast_key (sly_fast *r)
+{
+  const char *tag;
+  if (!fast_props (r, &tag))
+    return false;
+  const char c = FAST_CH (r, 0);
+  if (c == '\'' || c == '"')
+    {
+      if (!(c == '\'' ? fast_single (r, true) : fast_double (r, true))
+          || !fast_emit_scratch (r, tag, false))
+        return false;
+      fast_skip_spaces (r);
+    }
+  else if (c == '[' || c == '{')
+    {
+      if (!(c == '[' ? fast_flow_seq (r, tag) : fast_empty_map (r, tag)))
+        return false;
+      fast_skip_spaces (r);
+    }
+  else if (fast_plain_start (c, FAST_CH (r, 1), false))
+    {
+      const size_t start = r->pos;
+      const size_t end = fast_plain_line (r, false);
+      if (!fast_emit_plain (r, tag, start, end))
+        return false;
+    }
+  else
+    return fast_give_up (r);
+  if (FAST_CH (r, 0) != ':'
+      || (FAST_CH (r, 1) != ' ' && FAST_CH (r, 1) != '\0'))
+    return fast_give_up (r);
+  r->pos++;
+  return true;
+}
+
+static bool fast_block_map (sly_fast *r, int col, const char *tag);
+static bool fast_block_seq (sly_fast *r, int col, bool indentless,
+                            const char *tag);
+
+/* A node that starts partway along a line, after its tag (if any).
+ * If \a compact (i.e. it's an element of a block sequence), it can be
+ * a block sequence or mapping starting right here, in which case its
+ * first key starts at \a key. */
+static bool fast_block_inline (sly_fast *r, int indent, const char *tag,
+                               bool compact, size_t key)
+{
+  const char c = FAST_CH (r, 0);
+  if (compact && !tag && c == '-' && FAST_BLANK (r, 1))
+    return fast_block_seq (r, fast_col (r), false, NULL);
+  if (compact && fast_key_ahead (r, key))
+    {
+      r->pos = key;
+      return fast_block_map (r, fast_col (r), NULL);
+    }
+  switch (c)
+    {
+      case '|':
+        return fast_literal (r, indent, tag);
+      case '[':
+        return fast_flow_seq (r, tag) && fast_end_line (r);
+      case '{':
+        return fast_empty_map (r, tag) && fast_end_line (r);
+      case '\'':
+        return (fast_single (r, false) && fast_emit_scratch (r, tag, false)
+                && fast_end_line (r));
+      case '"':
+        return (fast_double (r, false) && fast_emit_scratch (r, tag, false)
+                && fast_end_line (r));
+    }
+  if (!fast_plain_start (c, FAST_CH (r, 1), false))
+    return fast_give_up (r);
+  return fast_plain_block (r, indent, tag);
+}
+
+/* A node that starts on a line of its own (we're at the first thing
+ * on it), whose tag, if any, was on the line before.  If it isn't
+ * indented more than \a indent, the node is empty.  (Unless it's a
+ * key or value in a block mapping, which can be a block sequence at
+ * the same indentation as the mapping.) */
+static bool fast_block_below (sly_fast *r, int indent, bool in_map,
+                              const char *tag)
+{
+  const char *tag2;
+  size_t start;
+  int col;
+
+  if (!fast_skip_to_content (r) || fast_doc_marker (r))
+    return fast_ok (r) && fast_emit_plain (r, tag, 0, 0);
+  col = fast_col (r);
+  if (FAST_CH (r, 0) == '-' && FAST_BLANK (r, 1)
+      && (col > indent || (col == indent && in_map)))
+    return fast_block_seq (r, col, (col == indent), tag);
+  if (col <= indent)
+    return fast_emit_plain (r, tag, 0, 0);
+  if (fast_key_ahead (r, r->pos))
+    return fast_block_map (r, col, tag);
+  start = r->pos;
+  if (!fast_props (r, &tag2))
+    return false;
+  if (tag2 && tag)
+    return fast_give_up (r);
+  return fast_block_inline (r, indent, (tag2 ? tag2 : tag), false, start);
+}
+
+/* Reads the node after "---", "- ", "? " or "key:", which may be on
+ * the same line, or on the lines below.  \a indent is the column of
+ * the innermost block collection we're in (-1 at the top level).  If
+ * \a in_seq, the node can be a compact collection, as described for
+ * fast_block_inline(); \a in_map is as for fast_block_below().  Like
+ * all the fast_block functions, leaves us where fast_skip_to_content()
+ * does, at the first thing after the node. */
+static bool fast_block_node (sly_fast *r, int indent, bool in_seq,
+                             bool in_map)
+{
+  const char *tag;
+  size_t start;
+  bool ok;
+
+  if (++r->depth > SLY_FAST_MAX_DEPTH)
+    return fast_give_up (r);
+  fast_skip_spaces (r);
+  start = r->pos;
+  if (!fast_props (r, &tag))
+    return false;
+  if (fast_rest_blank (r))
+    {
+      fast_next_line (r);
+      ok = fast_block_below (r, indent, in_map, tag);
+    }
+  else
+    ok = fast_block_inline (r, indent, tag, in_seq, start);
+  r->depth--;
+  return ok;
+}
+
+static bool fast_block_seq (sly_fast *r, int col, bool indentless,
+                            const char *tag)
+{
+  if (!fast_emit (r, YAML_SEQUENCE_START_EVENT, tag, NULL, 0, false))
+    return false;
+  for (;;)
+    {
+      r->pos++; /* the '-' */
+      if (!fast_block_node (r, col, true, false))
+        return false;
+      if (!r->have_line || fast_doc_marker (r) || fast_col (r) < col)
+        break;
+      if (fast_col (r) == col && FAST_CH (r, 0) == '-'
+          && (FAST_CH (r, 1) == ' ' || FAST_CH (r, 1) == '\0'))
+        continue;
+      if (fast_col (r) == col && indentless)
+        break; /* the next key of the mapping we're the value in */
+      return fast_give_up (r);
+    }
+  return fast_emit (r, YAML_SEQUENCE_END_EVENT, NULL, NULL, 0, false);
+}
+
+static bool fast_block_map (sly_fast *r, int col, const char *tag)
+{
+  if (!fast_emit (r, YAML_MAPPING_START_EVENT, tag, NULL, 0, false))
+    return false;
+  for (;;)
+    {
+      if (FAST_CH (r, 0) == '?' && FAST_BLANK (r, 1))
+        {
+          /* an explicit key, which is how we write keys that aren't
+           * scalars; its value, if any, follows a ':' lined up with it */
+          r->pos++;
+          if (!fast_block_node (r, col, true, true))
+            return false;
+          if (r->have_line && fast_col (r) == col && FAST_CH (r, 0) == ':'
+              && FAST_BLANK (r, 1))
+            {
+              r->pos++;
+              if (!fast_block_node (r, col, true, true))
+                return false;
+            }
+          else if (!fast_emit_plain (r, NULL, 0, 0))
+            return false;
+        }
+      else if (!fast_key (r) || !fast_block_node (r, col, false, true))
+        return false;
+      if (!r->have_line || fast_doc_marker (r) || fast_col (r) < col)
+        break;
+      if (fast_col (r) > col)
+        return fast_give_up (r);
+    }
+  return fast_emit (r, YAML_MAPPING_END_EVENT, NULL, NULL, 0, false);
+}
+
+/* %YAML 1.1, or %TAG for the "!" or "!!" handle */
+static bool fast_directive (sly_fast *r)
+{
+  const char *p = r->buf + r->pos;
+  const size_t n = r->eol - r->pos;
+  char *prefix;
+  size_t start;
+  unt8 which;
 
-  do
+  if (n >= 9 && memcmp (p, "%YAML 1.1", 9) == 0 && (n == 9 || p[9] == ' '))
+    {
+      if (r->directives & FAST_SAW_YAML)
+        return fast_give_up (r);
+      r->directives |= FAST_SAW_YAML;
+      r->pos += 9;
+      return fast_end_line (r);
+    }
+  if (n >= 7 && memcmp (p, "%TAG ! ", 7) == 0)
+    {
+      which = FAST_SAW_BANG;
+      prefix = r->bang;
+      r->pos += 7;
+    }
+  else if (n >= 8 && memcmp (p, "%TAG !! ", 8) == 0)
     {
-      slaw popped = NULL;
-      bool pushed = false;
-      unt64 h;
-      const v3unt64 *prev = slaw_v3unt64_emit (sly_peek (stack));
-      v3unt64 v;
-      sly_plain_scalar_type plainTyp = SLY_SCALAR_UNDECIDED;
+      which = FAST_SAW_BANGBANG;
+      prefix = r->bangbang;
+      r->pos += 8;
+    }
+  else
+    return fast_give_up (r);
+  if (r->directives & which)
+    return fast_give_up (r);
+  r->directives |= which;
+  fast_skip_spaces (r);
+  start = r->pos;
+  while (fast_uri_char (FAST_CH (r, 0)))
+    r->pos++;
+  if (r->pos == start || r->pos - start >= SLY_FAST_TAG_MAX)
+    return fast_give_up (r);
+  memcpy (prefix, r->buf + start, r->pos - start);
+  prefix[r->pos - start] = 0;
+  return fast_end_line (r);
+}
 
-      if (!yaml_parser_parse (parser, &event))
+/* Reads one document, or the end of the stream, and gives its events
+ * to sly_step(). */
+static bool fast_document (sly_fast *r)
+{
+  strcpy (r->bang, "!");
+  strcpy (r->bangbang, YAML_TAG_PREFIX);
+  r->directives = 0;
+  r->depth = 0;
+
+  for (;;)
+    {
+      if (!fast_skip_to_content (r))
         {
-          err = PRINT_YAML_PARSE_ERROR (parser);
-          break;
+          if (!fast_ok (r))
+            return false;
+          if (r->directives)
+            return fast_give_up (r);
+          return fast_emit (r, YAML_STREAM_END_EVENT, NULL, NULL, 0, false);
         }
-
-      if (prev && prev->CURRENT_ELEMENT == SE_MAP
-          && 0 == (prev->CURRENT_POSITION & 1)
-          && event.type != YAML_MAPPING_END_EVENT)
+      if (FAST_CH (r, 0) == '%' && fast_col (r) == 0)
         {
-          err = handler->begin_cons (cookie);
+          if (!fast_directive (r))
+            return false;
         }
-      else if (prev && prev->CURRENT_ELEMENT == SE_PROTEIN
-               && 1 == (prev->CURRENT_POSITION & 1)
-               && event.type != YAML_MAPPING_END_EVENT)
+      else if (fast_doc_marker (r) && FAST_CH (r, 0) == '.'
+               && !r->directives && r->started)
         {
-          if (prev->CURRENT_CONTEXT == SE_DESCRIPS)
-            err = handler->begin_descrips (cookie);
-          else if (prev->CURRENT_CONTEXT == SE_INGESTS)
-            err = handler->begin_ingests (cookie);
+          /* libyaml skips extra "..." lines between documents (but
+           * not before the first one) */
+          r->pos += 3;
+          if (!fast_end_line (r))
+            return false;
         }
+      else
+        break;
+    }
 
-      if (err != OB_OK)
-        goto badness;
+  if (fast_doc_marker (r) && FAST_CH (r, 0) == '-')
+    {
+      r->pos += 3;
+      r->started = true;
+      if (!fast_emit (r, YAML_DOCUMENT_START_EVENT, NULL, NULL, 0, false)
+          || !fast_block_node (r, -1, false, false))
+        return false;
+    }
+  else
+    {
+      /* only the first document can go without a "---" */
+      if (r->directives || r->started || fast_col (r) != 0
+          || fast_doc_marker (r))
+        return fast_give_up (r);
+      r->started = true;
+      if (!fast_emit (r, YAML_DOCUMENT_START_EVENT, NULL, NULL, 0, false)
+          || !fast_block_below (r, -1, false, NULL))
+        return false;
+    }
 
-      switch (event.type)
+  if (r->have_line)
+    {
+      if (!fast_doc_marker (r))
+        return fast_give_up (r);
+      if (FAST_CH (r, 0) == '.')
         {
-          case YAML_STREAM_START_EVENT:
-            ob_err_accum (&err, slabu_list_add_x (stack, slaw_nil ()));
-            pushed = true;
-            break;
-          case YAML_STREAM_END_EVENT:
-            popped = sly_pop (stack);
-            if (popped == NULL)
-              err = SLAW_END_OF_FILE;
-            break;
-          case YAML_DOCUMENT_START_EVENT:
-            ob_err_accum (&err, slabu_list_add_x (stack, slaw_nil ()));
-            pushed = true;
-            break;
-          case YAML_DOCUMENT_END_EVENT:
-            popped = sly_pop (stack);
-            break;
-          case YAML_ALIAS_EVENT:
-            slabu_free (stack);
-            return SLAW_ALIAS_NOT_SUPPORTED;
-          case YAML_SCALAR_EVENT:
-            if (!event.data.scalar.tag
-                || (h = sly_hash (event.data.scalar.tag)) == SE_NON_SPECIFIC)
-              {
-                if (event.data.scalar.style == YAML_PLAIN_SCALAR_STYLE)
-                  {
-                    plainTyp = sly_classify_plain ((const char *)
-                                                     event.data.scalar.value,
-                                                   event.data.scalar.length);
-                    switch (plainTyp)
-                      {
-                        case SLY_SCALAR_NULL:
-                          h = SE_NULL;
-                          break;
-                        case SLY_SCALAR_10:
-                        case SLY_SCALAR_8:
-                        case SLY_SCALAR_16:
-                          h = SE_I64;
-                          break;
-                        case SLY_SCALAR_FLOAT:
-                        case SLY_SCALAR_INF:
-                        case SLY_SCALAR_NAN:
-                          h = SE_F64;
-                          break;
-                        case SLY_SCALAR_BOOL:
-                          h = SE_BOOL;
-                          break;
-                        default:
-                        case SLY_SCALAR_STRING:
-                          h = SE_STR;
-                          break;
-                      }
-                  }
-                else
-                  {
-                    /* untagged quoted scalars are always strings */
-                    h = SE_STR;
-                  }
-              }
-            switch (h)
-              {
-                case SE_BINARY:
-                  if (!prev || prev->CURRENT_CONTEXT != SE_RUDE_DATA)
-                    {
-                      OB_LOG_ERROR_CODE (0x2000500d, "slaw yaml: got %s in "
-                                                     "unexpected place\n",
-                                         event.data.scalar.tag);
-                      err = SLAW_PARSING_BADNESS;
-                      break;
-                    }
-                // fall thru
-                case SE_NONSTD:
-                case SE_BADUTF8:
-                  {
-                    unt64 buflen =
-                      base64_to_bin_upper_bound (event.data.scalar.length);
-                    unt64 len;
-                    unt8 *buf = (unt8 *) MAYBE_MALLOC (buflen);
-                    memset (buf, 0, buflen);
-                    len = base64_to_bin_convert (event.data.scalar.length,
-                                                 (const char *)
-                                                   event.data.scalar.value,
-                                                 buflen, buf);
-                    if (h == SE_NONSTD)
-                      err = handler->handle_nonstd_protein (cookie, buf, len);
-                    else if (h == SE_BADUTF8)
-                      err = handler->handle_string (cookie, (const char *) buf,
-                                                    len);
-                    else
-                      err = handler->handle_rude_data (cookie, buf, len);
-                    MAYBE_FREE (buf);
-                  }
-                  break;
-                case SE_BOOL:
-                  {
-                    char c = event.data.scalar.value[0];
-                    err =
-                      handler->handle_unt (cookie, (c == 't' || c == 'T'), 1);
-                    break;
-                  }
-                case SE_F32:
-                case SE_F64:
-                  {
-                    float64 number;
-                    int bits = 8;
-                    char *buf =
-                      (char *) MAYBE_MALLOC (event.data.scalar.length + 1);
-
-                    memcpy (buf, event.data.scalar.value,
-                            event.data.scalar.length);
-                    buf[event.data.scalar.length] = 0;
-
-                    if (plainTyp == SLY_SCALAR_UNDECIDED)
-                      plainTyp = sly_classify_plain ((const char *)
-                                                       event.data.scalar.value,
-                                                     event.data.scalar.length);
-
-                    switch (plainTyp)
-                      {
-                        case SLY_SCALAR_NAN:
-                          number = OB_NAN;
-                          break;
-                        case SLY_SCALAR_INF:
-                          number = OB_POSINF;
-                          if (buf[0] == '-')
-                            number = -number;
-                          break;
-                        default:
-                          // XXX: use a variant of private_strtof64 instead
-                          number = strtod (buf, NULL);
-                          break;
-                      }
-                    switch (h)
-                      {
-                        case SE_F64:
-                          bits *= 2;
-                        /* fall through */
-                        case SE_F32:
-                          bits *= 4;
-                          err = handler->handle_float (cookie, number, bits);
-                          break;
-                      }
-                    MAYBE_FREE (buf);
-                  }
-                  break;
-                case SE_I16:
-                case SE_I32:
-                case SE_I64:
-                case SE_I8:
-                case SE_U16:
-                case SE_U32:
-                case SE_U64:
-                case SE_U8:
-                  {
-                    unt64_with_sign number;
-                    int bits = 8;
-
-                    if (plainTyp == SLY_SCALAR_UNDECIDED)
-                      plainTyp = sly_classify_plain ((const char *)
-                                                       event.data.scalar.value,
-                                                     event.data.scalar.length);
-
-                    parse_integer ((const char *) event.data.scalar.value,
-                                   event.data.scalar.length, &number, plainTyp);
-                    switch (h)
-                      {
-                        case SE_I64:
-                          bits *= 2;
-                        /* fall through */
-                        case SE_I32:
-                          bits *= 2;
-                        /* fall through */
-                        case SE_I16:
-                          bits *= 2;
-                        /* fall through */
-                        case SE_I8:
-                          if (number.negative)
-                            err =
-                              handler->handle_int (cookie,
-                                                   -(int64) number.magnitude,
-                                                   bits);
-                          else
-                            err = handler->handle_int (cookie,
-                                                       (int64) number.magnitude,
-                                                       bits);
-                          break;
-                        case SE_U64:
-                          bits *= 2;
-                        /* fall through */
-                        case SE_U32:
-                          bits *= 2;
-                        /* fall through */
-                        case SE_U16:
-                          bits *= 2;
-                        /* fall through */
-                        case SE_U8:
-                          err = handler->handle_unt (cookie, number.magnitude,
-                                                     bits);
-                          break;
-                      }
-                  }
-                  break;
-                case SE_NULL:
-                  err = handler->handle_nil (cookie);
-                  break;
-                case SE_STRING: /* the wrong way (bug 2939) */
-                case SE_STR:    /* the right way */
-                  {
-                    if (prev && (prev->CURRENT_ELEMENT == SE_PROTEIN)
-                        && ((prev->CURRENT_POSITION & 1) == 0))
-                      {
-                        unt64 h2 = ob_city_hash64 (event.data.scalar.value,
-                                                   event.data.scalar.length);
-                        if (h2 == SE_INGESTS || h2 == SE_DESCRIPS
-                            || h2 == SE_RUDE_DATA)
-                          {
-                            // XXXX: FIXME: cast away const
-                            ((v3unt64 *) prev)->CURRENT_CONTEXT = h2;
-                          }
-                        else
-                          {
-                            slaw tmp =
-                              slaw_string_from_substring ((const char *) event
-                                                            .data.scalar.value,
-                                                          event.data.scalar
-                                                            .length);
-                            OB_LOG_ERROR_CODE (0x2000500e,
-                                               "slaw yaml: expected 'ingests', "
-                                               "'descrips',\n"
-                                               "or 'rude_data', but got '%s'\n",
-                                               slaw_string_emit (tmp));
-                            slaw_free (tmp);
-                            err = SLAW_PARSING_BADNESS;
-                          }
-                      }
-                    else
-                      {
-                        err = handler->handle_string (cookie,
-                                                      (const char *)
-                                                        event.data.scalar.value,
-                                                      event.data.scalar.length);
-                      }
-                  }
-                  break;
-                default:
-                  {
-                    const char *emptyPrefix = SLAW_TAG_PREFIX "empty/";
-                    const char *multivectorPrefix = "multivector/";
-                    const char *vectorPrefix = "vector/";
-                    const char *complexPrefix = "complex/";
-                    const size_t emptyPrefixLen = strlen (emptyPrefix);
-                    const size_t multivectorPrefixLen =
-                      strlen (multivectorPrefix);
-                    const size_t vectorPrefixLen = strlen (vectorPrefix);
-                    const size_t complexPrefixLen = strlen (complexPrefix);
-                    const char *tag = (const char *) event.data.scalar.tag;
-
-                    if (strncmp (tag, emptyPrefix, emptyPrefixLen) == 0)
-                      {
-                        int vecsize = 1;
-                        bool isMVec = false;
-                        bool isComplex = false;
-                        bool isUnsigned = false;
-                        bool isFloat = false;
-                        int bits;
-
-                        tag += emptyPrefixLen;
-
-                        if (strncmp (tag, multivectorPrefix,
-                                     multivectorPrefixLen)
-                            == 0)
-                          {
-                            tag += multivectorPrefixLen;
-                            if (tag[0] >= '2' && tag[0] <= '5' && tag[1] == '/')
-                              {
-                                vecsize = tag[0] - '0';
-                                tag += 2;
-                                isMVec = true;
-                              }
-                            else
-                              {
-                                err = SLAW_BAD_TAG;
-                                ob_log (OBLV_WRNU, 0x20005002, "Bad tag: %s\n",
-                                        (const char *) event.data.scalar.tag);
-                                break;
-                              }
-                          }
-                        else if (strncmp (tag, vectorPrefix, vectorPrefixLen)
-                                 == 0)
-                          {
-                            tag += vectorPrefixLen;
-                            if (tag[0] >= '2' && tag[0] <= '4' && tag[1] == '/')
-                              {
-                                vecsize = tag[0] - '0';
-                                tag += 2;
-                              }
-                            else
-                              {
-                                err = SLAW_BAD_TAG;
-                                ob_log (OBLV_WRNU, 0x20005003, "Bad tag: %s\n",
-                                        (const char *) event.data.scalar.tag);
-                                break;
-                              }
-                          }
-
-                        if (strncmp (tag, complexPrefix, complexPrefixLen) == 0)
-                          {
-                            isComplex = true;
-                            tag += complexPrefixLen;
-                          }
-
-                        if (tag[0] == 'u')
-                          isUnsigned = true;
-                        else if (tag[0] == 'f')
-                          isFloat = true;
-                        else if (tag[0] != 'i')
-                          {
-                            err = SLAW_BAD_TAG;
-                            ob_log (OBLV_WRNU, 0x20005004, "Bad tag: %s\n",
-                                    (const char *) event.data.scalar.tag);
-                            break;
-                          }
-
-                        tag++;
-                        bits = atoi (tag);
-
-                        err =
-                          handler->handle_empty_array (cookie, vecsize, isMVec,
-                                                       isComplex, isUnsigned,
-                                                       isFloat, bits);
-                        break;
-                      }
-                  }
-                  err = SLAW_BAD_TAG;
-                  ob_log (OBLV_WRNU, 0x20005005, "Bad tag: %s\n",
-                          (const char *) event.data.scalar.tag);
-                  break;
-              }
-            break;
-          case YAML_SEQUENCE_START_EVENT:
-            if (!event.data.sequence_start.tag
-                || (h = sly_hash (event.data.sequence_start.tag))
-                     == SE_NON_SPECIFIC)
-              h = SE_SEQ;
-            v.CURRENT_ELEMENT = h;
-            v.CURRENT_POSITION = 0;
-            v.CURRENT_CONTEXT = 0;
-            ob_err_accum (&err, slabu_list_add_x (stack, slaw_v3unt64 (v)));
-            pushed = true;
-            switch (h)
-              {
-                case SE_COMPLEX:
-                  err = handler->begin_complex (cookie);
-                  break;
-                case SE_VECTOR:
-                  err = handler->begin_vector (cookie, -1);
-                  break;
-                case SE_MULTIVECTOR:
-                  err = handler->begin_multivector (cookie, -1);
-                  break;
-                case SE_ARRAY:
-                  err = handler->begin_array (cookie, -1, -1);
-                  break;
-                case SE_SEQ:
-                  err = handler->begin_list (cookie, -1);
-                  break;
-                case SE_OMAP:
-                  err = handler->begin_map (cookie, -1);
-                  break;
-                default:
-                  err = SLAW_BAD_TAG;
-                  ob_log (OBLV_WRNU, 0x20005006, "Bad start sequence tag: %s\n",
-                          (const char *) event.data.sequence_start.tag);
-                  break;
-              }
-            break;
-          case YAML_SEQUENCE_END_EVENT:
-            popped = sly_pop (stack);
-            if (!popped || !slaw_v3unt64_emit (popped))
-              {
-                // I don't think it should be possible for this to occur,
-                // so I'm going to call it a programming error, rather than
-                // a user error.
-                OB_LOG_BUG_CODE (0x2000500f, "slaw yaml: stack popping problem "
-                                             "at sequence end\n");
-                err = SLAW_PARSING_BADNESS;
-                break;
-              }
-            h = slaw_v3unt64_emit (popped)->CURRENT_ELEMENT;
-            switch (h)
-              {
-                case SE_COMPLEX:
-                  err = handler->end_complex (cookie);
-                  break;
-                case SE_VECTOR:
-                  err = handler->end_vector (cookie);
-                  break;
-                case SE_MULTIVECTOR:
-                  err = handler->end_multivector (cookie);
-                  break;
-                case SE_ARRAY:
-                  err = handler->end_array (cookie);
-                  break;
-                case SE_SEQ:
-                  err = handler->end_list (cookie);
-                  break;
-                case SE_OMAP:
-                  err = handler->end_map (cookie);
-                  break;
-                default:
-                  err = SLAW_BAD_TAG;
-                  ob_log (OBLV_WRNU, 0x20005007,
-                          "Bad end sequence tag: %" OB_FMT_64 "u\n", h);
-                  break;
-              }
-            break;
-          case YAML_MAPPING_START_EVENT:
-            if (!event.data.mapping_start.tag
-                || (h = sly_hash (event.data.mapping_start.tag))
-                     == SE_NON_SPECIFIC)
-              h = SE_MAP;
-            if (prev && prev->CURRENT_ELEMENT == SE_OMAP)
-              h = SE_CONS;
-            v.CURRENT_ELEMENT = h;
-            v.CURRENT_POSITION = 0;
-            v.CURRENT_CONTEXT = 0;
-            ob_err_accum (&err, slabu_list_add_x (stack, slaw_v3unt64 (v)));
-            pushed = true;
-            switch (h)
-              {
-                case SE_MAP:
-                  err = handler->begin_map (cookie, -1);
-                  break;
-                case SE_CONS:
-                  err = handler->begin_cons (cookie);
-                  break;
-                case SE_PROTEIN:
-                  err = handler->begin_protein (cookie);
-                  break;
-                default:
-                  err = SLAW_BAD_TAG;
-                  ob_log (OBLV_WRNU, 0x20005008, "Bad start mapping tag: %s\n",
-                          (const char *) event.data.mapping_start.tag);
-                  break;
-              }
-            break;
-          case YAML_MAPPING_END_EVENT:
-            popped = sly_pop (stack);
-            if (!popped || !slaw_v3unt64_emit (popped))
-              {
-                // I don't think it should be possible for this to occur,
-                // so I'm going to call it a programming error, rather than
-                // a user error.
-                OB_LOG_BUG_CODE (0x20005010, "slaw yaml: stack popping problem "
-                                             "at mapping end\n");
-                err = SLAW_PARSING_BADNESS;
-                break;
-              }
-            h = slaw_v3unt64_emit (popped)->CURRENT_ELEMENT;
-            switch (h)
-              {
-                case SE_MAP:
-                  err = handler->end_map (cookie);
-                  break;
-                case SE_CONS:
-                  err = handler->end_cons (cookie);
-                  break;
-                case SE_PROTEIN:
-                  err = handler->end_protein (cookie);
-                  break;
-                default:
-                  err = SLAW_BAD_TAG;
-                  ob_log (OBLV_WRNU, 0x20005009,
-                          "Bad end mapping tag: %" OB_FMT_64 "u\n", h);
-                  break;
-              }
-            break;
-          case YAML_NO_EVENT:
-            // This seems to be what happens if we try reading after
-            // already getting SLAW_END_OF_FILE once.  That's why
-            // MiscSlawTest.GenericOpen tests for SLAW_END_OF_FILE twice;
-            // the second time is this case.
-            err = SLAW_END_OF_FILE;
-            break;
-          default:
-            // I don't think it should be possible for this to occur,
-            // so I'm going to call it a programming error, rather than
-            // a user error.
-            OB_LOG_BUG_CODE (0x20005011, "slaw yaml: yaml parser produced "
-                                         "strange event %d\n",
-                             event.type);
-            err = SLAW_PARSING_BADNESS;
-            break;
+          r->pos += 3;
+          if (!fast_rest_blank (r))
+            return fast_give_up (r);
+          /* and don't look any further than this line, in case more
+           * input isn't available yet */
+          fast_next_line (r);
         }
+    }
+  return fast_emit (r, YAML_DOCUMENT_END_EVENT, NULL, NULL, 0, false);
+}
 
-      if (err == OB_OK && !pushed)
-        {
-          prev = slaw_v3unt64_emit (sly_peek (stack));
-          if (prev)
-            {
-              // XXXX: FIXME: cast away const
-              ((v3unt64 *) prev)->CURRENT_POSITION++;
-              if (0 == (prev->CURRENT_POSITION & 1))
-                {
-                  if (prev->CURRENT_ELEMENT == SE_MAP)
-                    {
-                      err = handler->end_cons (cookie);
-                    }
-                  else if (prev->CURRENT_ELEMENT == SE_PROTEIN)
-                    {
-                      if (prev->CURRENT_CONTEXT == SE_DESCRIPS)
-                        {
-                          err = handler->end_descrips (cookie);
-                        }
-                      else if (prev->CURRENT_CONTEXT == SE_INGESTS)
-                        {
-                          err = handler->end_ingests (cookie);
-                        }
-                    }
-                }
-            }
-        }
+/* Reads the next slaw with the fast reader.  If it runs into
+ * something it doesn't know how to read, sets r->give_up, and leaves
+ * the document it was reading at the start of r->buf for libyaml. */
+static slaw sly_fast_read_slaw (sly_fast *r, ob_retort *err)
+{
+  sly_parse_state ps;
+  slaw s;
 
-    badness:
-      yaml_event_delete (&event);
+  /* forget about whatever came before this document */
+  if (r->line > 0)
+    {
+      memmove (r->buf, r->buf + r->line, r->len - r->line);
+      r->len -= r->line;
+      r->eol -= r->line;
+      r->pos -= r->line;
+      r->line = 0;
+    }
 
-      if (popped)
-        slaw_free (popped);
+  slaw_fabricator *sf = slaw_fabricator_new ();
+  if (sf == NULL)
+    {
+      *err = OB_NO_MEM;
+      return NULL;
+    }
+  ps.cookie = sf;
+  ps.handler = &slaw_fabrication_handler;
+  ps.stack = slabu_new ();
+  if (ps.stack == NULL)
+    {
+      slaw_fabricator_free (sf);
+      *err = OB_NO_MEM;
+      return NULL;
     }
-  while (err == OB_OK && slabu_count (stack) > 0);
 
-  slabu_free (stack);
+  r->ps = &ps;
+  r->tort = OB_OK;
+  fast_document (r);
+  r->ps = NULL;
 
-  return err;
+  *err = r->tort;
+  s = sf->result;
+  sf->result = NULL;
+  slabu_free (ps.stack);
+  slaw_fabricator_free (sf);
+  if (r->give_up)
+    {
+      slaw_free (s);
+      s = NULL;
+    }
+  return s;
 }
 
 static slaw sly_read_slaw_from_yaml (yaml_parser_t *parser, ob_retort *err)
@@ -1879,6 +3253,8 @@ static slaw sly_read_slaw_from_yaml (yaml_parser_t *parser, ob_retort *err)
 typedef struct sly_parser_holder
 {
   yaml_parser_t parser;
+  bool yaml_started; /* once we've fallen back on libyaml, we stay there */
+  sly_fast fast;
   slaw_read_handler h;
 } sly_parser_holder;
 
@@ -1893,8 +3269,11 @@ static ob_retort yaml_input_close (void *data)
   sly_parser_holder *holder = (sly_parser_holder *) data;
   ob_retort err = OB_OK;
 
-  yaml_parser_delete (&(holder->parser));
+  if (holder->yaml_started)
+    yaml_parser_delete (&(holder->parser));
   err = holder->h.close (holder->h.cookie);
+  free (holder->fast.buf);
+  free (holder->fast.scratch);
   free (holder);
 
   return err;
@@ -1939,45 +3318,48 @@ static ob_retort yaml_output_close (void *data)
   return err;
 }
 
-static ob_retort yaml_input_read_slaw (slaw_input f, slaw *s)
-{
-  sly_parser_holder *holder = (sly_parser_holder *) f->data;
-  ob_retort err;
+static bool sly_fast_path = true;
+static int64 sly_fast_fallbacks = 0;
 
-  *s = sly_read_slaw_from_yaml (&(holder->parser), &err);
+void private_set_yaml_fast_path (bool enable)
+{
+  sly_fast_path = enable;
+}
 
-  return err;
+int64 private_yaml_fallback_count (void)
+{
+  return ob_atomic_int64_add (&sly_fast_fallbacks, 0);
 }
 
+/* libyaml reads whatever the fast reader had read, but not used, and
+ * then carries on with the real input. */
 static int yaml_read_handler (void *data, unsigned char *buffer, size_t size,
                               size_t *size_read)
 {
-  const slaw_read_handler *h = (const slaw_read_handler *) data;
-  ob_retort tort = h->read (h->cookie, buffer, size, size_read);
+  sly_parser_holder *holder = (sly_parser_holder *) data;
+  sly_fast *r = &(holder->fast);
+  if (r->replay < r->len)
+    {
+      size_t n = r->len - r->replay;
+      if (n > size)
+        n = size;
+      memcpy (buffer, r->buf + r->replay, n);
+      r->replay += n;
+      *size_read = n;
+      return 1;
+    }
+  ob_retort tort = holder->h.read (holder->h.cookie, buffer, size, size_read);
   return (tort >= OB_OK);
 }
 
-ob_retort slaw_input_open_text_handler (slaw_read_handler h, slaw_input *f)
+static ob_retort sly_start_yaml (sly_parser_holder *holder)
 {
-  sly_parser_holder *holder;
   yaml_event_t event;
 
-  holder = (sly_parser_holder *) calloc (1, sizeof (sly_parser_holder));
-  if (holder == NULL)
-    {
-      return OB_NO_MEM;
-    }
-
-  holder->h = h;
-
   if (!yaml_parser_initialize (&(holder->parser)))
-    {
-      ob_retort tmp = PRINT_YAML_PARSE_ERROR (&(holder->parser));
-      free (holder);
-      return tmp;
-    }
+    return PRINT_YAML_PARSE_ERROR (&(holder->parser));
 
-  yaml_parser_set_input (&(holder->parser), yaml_read_handler, &(holder->h));
+  yaml_parser_set_input (&(holder->parser), yaml_read_handler, holder);
 
   /* Eat the stream start event */
   if (!yaml_parser_parse (&(holder->parser), &event)
@@ -1985,14 +3367,65 @@ ob_retort slaw_input_open_text_handler (slaw_read_handler h, slaw_input *f)
     {
       ob_retort err = PRINT_YAML_PARSE_ERROR (&(holder->parser));
       yaml_parser_delete (&(holder->parser));
-      free (holder);
       return err;
     }
+  yaml_event_delete (&event);
+
+  holder->yaml_started = true;
+  return OB_OK;
+}
+
+static ob_retort yaml_input_read_slaw (slaw_input f, slaw *s)
+{
+  sly_parser_holder *holder = (sly_parser_holder *) f->data;
+  ob_retort err;
+
+  if (!holder->yaml_started)
+    {
+      *s = sly_fast_read_slaw (&(holder->fast), &err);
+      if (!holder->fast.give_up)
+        return err;
+      /* start libyaml at the beginning of this document */
+      ob_atomic_int64_add (&sly_fast_fallbacks, 1);
+      holder->fast.replay = 0;
+      err = sly_start_yaml (holder);
+      if (err < OB_OK)
+        return err;
+    }
+
+  *s = sly_read_slaw_from_yaml (&(holder->parser), &err);
+
+  return err;
+}
+
+ob_retort slaw_input_open_text_handler (slaw_read_handler h, slaw_input *f)
+{
+  sly_parser_holder *holder;
+
+  holder = (sly_parser_holder *) calloc (1, sizeof (sly_parser_holder));
+  if (holder == NULL)
+    {
+      return OB_NO_MEM;
+    }
+
+  holder->h = h;
+  holder->fast.h = &(holder->h);
+
+  if (!sly_fast_path)
+    {
+      ob_retort err = sly_start_yaml (holder);
+      if (err < OB_OK)
+        {
+          free (holder);
+          return err;
+        }
+    }
 
   *f = new_slaw_input ();
   if (!*f)
     {
-      yaml_parser_delete (&(holder->parser));
+      if (holder->yaml_started)
+        yaml_parser_delete (&(holder->parser));
       free (holder);
       return OB_NO_MEM;
     }
@@ -1896,6 +1896,9 @@ bslaw slaw_map_find (bslaw s, bslaw key)
   if (!s || !key || !slaw_is_list_or_map (s))
     return NULL;
 
+  if (slaw_map_index_find (s, key, NULL, &result))
+    return result;
+
   for (cole = slaw_list_emit_first (s); cole != NULL;
        cole = slaw_list_emit_next (s, cole))
     {
@@ -1929,6 +1932,9 @@ bslaw slaw_map_find_c (bslaw s, const char *key)
   if (!s || !key || !slaw_is_list_or_map (s))
     return NULL;
 
+  if (slaw_map_index_find (s, NULL, key, &result))
+    return result;
+
   firstC = *key;
 
   // XXX: the new slaw_list_emit_next is more efficient, so the
@@ -2460,18 +2466,42 @@ static slaw_oct reswap_special_unt16s (slaw_oct ilk)
           | ((ilk >> 16) & OB_CONST_U64 (0xffff)));
 }
 
-ob_retort slaw_swap (slaw s, slaw stop)
+/// The walk behind slaw_swap() and slaw_check(): checks that \a s
+/// is all there before \a stop and makes sense, swapping it along
+/// the way if \a swap is true (and not touching it at all otherwise).
+static ob_retort walk_slaw (slaw s, slaw stop, bool swap);
+
+static ob_retort walk_slaw_sequence (slaw s, slaw stop, bool swap)
+{
+  ob_retort err = OB_OK;
+
+  while (err == OB_OK && s < stop)
+    {
+      err = walk_slaw (s, stop, swap);
+      s += slaw_octlen (s);
+    }
+
+  if (s > stop)
+    return SLAW_CORRUPT_SLAW; /* "stop" was in the middle of a slaw */
+
+  return err;
+}
+
+static ob_retort walk_slaw (slaw s, slaw stop, bool swap)
 {
   slaw payload = s + 1;
   bool wee;
   unt32 primBytes, bsize;
   unt64 breadth;
 
-  // start by swapping the header
-  slaw_oct ilk = s->o = ob_swap64 (s->o);
+  // start with the header
+  if (swap)
+    s->o = ob_swap64 (s->o);
+  const slaw_oct ilk = s->o;
   const unt64 octocat = slaw_octlen (s);
 
-  if (s + octocat > stop)
+  // (an empty one would have us going around in circles)
+  if (octocat == 0 || octocat > (unt64) (stop - s))
     return SLAW_CORRUPT_SLAW;
   stop = s + octocat;
 
@@ -2481,7 +2511,8 @@ ob_retort slaw_swap (slaw s, slaw stop)
       case SLAW_NIB_FULL_STRING: /* UTF-8 string is endian-neutral */
         return OB_OK;
       case SLAW_NIB_WEE_STRING:
-        s->o = reswap_special_bytes (ilk, SLAW_WEE_STRING_LEN (s));
+        if (swap)
+          s->o = reswap_special_bytes (ilk, SLAW_WEE_STRING_LEN (s));
         return OB_OK;
       case SLAW_NIB_LIST:
       case SLAW_NIB_MAP:
@@ -2492,10 +2523,13 @@ ob_retort slaw_swap (slaw s, slaw stop)
         /* swap the element count */
         if (!wee)
           {
-            payload->o = ob_swap64 (payload->o);
+            if (payload >= stop)
+              return SLAW_CORRUPT_SLAW;
+            if (swap)
+              payload->o = ob_swap64 (payload->o);
             payload++;
           }
-        return slaw_swap_sequence (payload, s + octocat);
+        return walk_slaw_sequence (payload, stop, swap);
       case SLAW_NIB_SINGL_SINT:
       case SLAW_NIB_SINGL_UINT:
       case SLAW_NIB_SINGL_FLOAT:
@@ -2505,11 +2539,12 @@ ob_retort slaw_swap (slaw s, slaw stop)
             switch (3 & (ilk >> SLAW_NUMERIC_SIZE_SHIFTY))
               {
                 case 0:  // 8-bit: need to unswap them
-                  s->o = reswap_special_bytes (ilk, bsize);
+                  if (swap)
+                    s->o = reswap_special_bytes (ilk, bsize);
                   return OB_OK;
                 case 1:  // 16-bit
-                  if (bsize
-                      == 4)  // if there were two unt16s, need to unswap them
+                  // if there were two unt16s, need to unswap them
+                  if (swap && bsize == 4)
                     s->o = reswap_special_unt16s (ilk);
                   return OB_OK;
                 case 2:  // 32-bit: can only be one, and it was already swapped
@@ -2529,34 +2564,31 @@ ob_retort slaw_swap (slaw s, slaw stop)
         breadth = SLAW_N_ARRAY_BREADTH (s);
       swap_numeric:
         primBytes = SLAW_NUMERIC_PRIM_BYTES (s);
-        if (primBytes == 1)
-          return OB_OK; /* 1-byte units don't need swapping */
         {
-          unt64 nprims, i;
+          unt64 nprims;
           void *e = payload;
-          unt16 *p16;
-          unt32 *p32;
-          unt64 *p64;
 
           nprims = SLAW_NUMERIC_UNIT_BSIZE (s) / primBytes;
+          if (breadth > (unt64) (stop - payload) * 8)
+            return SLAW_CORRUPT_SLAW;
           nprims *= breadth;
+          if (payload + (nprims * primBytes + 7) / 8 > stop)
+            return SLAW_CORRUPT_SLAW;
+          if (!swap)
+            return OB_OK;
 
           switch (primBytes)
             {
+              case 1: /* 1-byte units don't need swapping */
+                return OB_OK;
               case 2:
-                p16 = (unt16 *) e;
-                for (i = 0; i < nprims; i++, p16++)
-                  *p16 = ob_swap16 (*p16);
+                ob_swap16_array ((unt16 *) e, nprims);
                 return OB_OK;
               case 4:
-                p32 = (unt32 *) e;
-                for (i = 0; i < nprims; i++, p32++)
-                  *p32 = ob_swap32 (*p32);
+                ob_swap32_array ((unt32 *) e, nprims);
                 return OB_OK;
               case 8:
-                p64 = (unt64 *) e;
-                for (i = 0; i < nprims; i++, p64++)
-                  *p64 = ob_swap64 (*p64);
+                ob_swap64_array ((unt64 *) e, nprims);
                 return OB_OK;
               default:  // shouldn't happen
                 return SLAW_CORRUPT_SLAW;
@@ -2568,18 +2600,25 @@ ob_retort slaw_swap (slaw s, slaw stop)
           ob_retort err;
           slaw cole = payload + 1;
 
-          slaw_oct oct2 = payload->o = ob_swap64 (payload->o);
-          if (!PROTEIN_IS_VERY_RUDE (s))
-            payload->o =
-              reswap_special_bytes (oct2, ((oct2 & SLAW_PROTEIN_WEE_RUDE_MASK)
-                                           >> SLAW_PROTEIN_WEE_RUDE_SHIFTY));
+          if (payload >= stop)
+            return SLAW_CORRUPT_PROTEIN;
+          if (swap)
+            {
+              slaw_oct oct2 = payload->o = ob_swap64 (payload->o);
+              if (!PROTEIN_IS_VERY_RUDE (s))
+                payload->o = reswap_special_bytes (
+                  oct2, ((oct2 & SLAW_PROTEIN_WEE_RUDE_MASK)
+                         >> SLAW_PROTEIN_WEE_RUDE_SHIFTY));
+            }
 
           int nThingsToSwap =
             PROTEIN_HAS_DESCRIPS (s) + PROTEIN_HAS_INGESTS (s);
 
           for (i = 0; i < nThingsToSwap; i++)
             {
-              err = slaw_swap (cole, stop);
+              if (cole >= stop)
+                return SLAW_CORRUPT_PROTEIN;
+              err = walk_slaw (cole, stop, swap);
               if (err != OB_OK)
                 return err;
               cole += slaw_octlen (cole);
@@ -2591,20 +2630,20 @@ ob_retort slaw_swap (slaw s, slaw stop)
     }
 }
 
-ob_retort slaw_swap_sequence (slaw s, slaw stop)
+ob_retort slaw_swap (slaw s, slaw stop)
 {
-  ob_retort err = OB_OK;
-
-  while (err == OB_OK && s < stop)
-    {
-      err = slaw_swap (s, stop);
-      s += slaw_octlen (s);
-    }
+  return walk_slaw (s, stop, true);
+}
 
-  if (s > stop)
-    return SLAW_CORRUPT_SLAW; /* "stop" was in the middle of a slaw */
+ob_retort slaw_swap_sequence (slaw s, slaw stop)
+{
+  return walk_slaw_sequence (s, stop, true);
+}
 
-  return err;
+ob_retort slaw_check (bslaw s, bslaw stop)
+{
+  // Doesn't write to it when it's not swapping
+  return walk_slaw ((slaw) s, (slaw) stop, false);
 }
 
 #define E(x)                                                                   \
@@ -0,0 +1,250 @@
+
+/* (c)  oblong industries */
+
+// Tests lookups in maps big enough to get a hash index, including
+// after the map they were built for has been freed and its memory
+// (probably) reused, after a map has been overwritten in place (with
+// the same keys in the same places, and otherwise), with a value too
+// big to be worth copying, with more maps than there are indexes to go
+// around, and from several threads at once.
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-pthread.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM 200
+
+static slaw make_map (int64 bias)
+{
+  slabu *sb = slabu_new ();
+  char key[32];
+  int64 i;
+  for (i = 0; i < NUM; i++)
+    {
+      snprintf (key, sizeof (key), "key-%" OB_FMT_64 "d", i);
+      slabu_map_put_cf (sb, key, slaw_int64 (i + bias));
+    }
+  slabu_map_put_ff (sb, slaw_int64 (-1), slaw_string ("minus one"));
+  return slaw_map_f (sb);
+}
+
+/// Same keys and values as make_map(), but in the opposite order, so
+/// that it's the same size but everything's in a different place.
+
+static slaw make_backwards_map (int64 bias)
+{
+  slabu *sb = slabu_new ();
+  slabu_map_put_ff (sb, slaw_int64 (-1), slaw_string ("minus one"));
+  char key[32];
+  int64 i;
+  for (i = NUM - 1; i >= 0; i--)
+    {
+      snprintf (key, sizeof (key), "key-%" OB_FMT_64 "d", i);
+      slabu_map_put_cf (sb, key, slaw_int64 (i + bias));
+    }
+  return slaw_map_f (sb);
+}
+
+static void check_map (bslaw m, int64 bias)
+{
+  char key[32];
+  int64 i;
+  for (i = 0; i < NUM; i++)
+    {
+      snprintf (key, sizeof (key), "key-%" OB_FMT_64 "d", i);
+      const int64 *v = slaw_int64_emit (slaw_map_find_c (m, key));
+      if (!v || *v != i + bias)
+        OB_FATAL_ERROR_CODE (0x2031b000, "wrong value for %s\n", key);
+      slaw k = slaw_string (key);
+      v = slaw_int64_emit (slaw_map_find (m, k));
+      slaw_free (k);
+      if (!v || *v != i + bias)
+        OB_FATAL_ERROR_CODE (0x2031b001, "wrong value for slaw %s\n", key);
+      if (slaw_path_get_int64 (m, key, -1) != i + bias)
+        OB_FATAL_ERROR_CODE (0x2031b002, "wrong value for path %s\n", key);
+    }
+
+  if (slaw_map_find_c (m, "key-") || slaw_map_find_c (m, "nope"))
+    OB_FATAL_ERROR_CODE (0x2031b003, "found a key that isn't there\n");
+
+  slaw k = slaw_int64 (-1);
+  if (!slawx_equal_lc (slaw_map_find (m, k), "minus one"))
+    OB_FATAL_ERROR_CODE (0x2031b004, "wrong value for -1\n");
+  slaw_free (k);
+}
+
+/// A list of conses is searched like a map, and the last match wins.
+
+static void check_list (void)
+{
+  slabu *sb = slabu_new ();
+  int64 i;
+  for (i = 0; i < NUM; i++)
+    {
+      slabu_list_add_f (sb, slaw_cons_cf ("dup", slaw_int64 (i)));
+      slabu_list_add_f (sb, slaw_int64 (i));
+    }
+  slaw l = slaw_list_f (sb);
+  for (i = 0; i < 3; i++)
+    {
+      const int64 *v = slaw_int64_emit (slaw_map_find_c (l, "dup"));
+      if (!v || *v != NUM - 1)
+        OB_FATAL_ERROR_CODE (0x2031b005, "last dup didn't win\n");
+      if (slaw_map_find_c (l, "nope"))
+        OB_FATAL_ERROR_CODE (0x2031b006, "found a key that isn't there\n");
+    }
+  slaw_free (l);
+}
+
+/// Nobody calls slaw_free() on a map in a pool's mapping, or in a
+/// buffer that gets reused; it just gets overwritten.
+
+static void check_overwritten (void)
+{
+  slaw m1 = make_map (0);
+  slaw m2 = make_backwards_map (7000);
+  const int64 len = slaw_len (m1);
+  if (len != slaw_len (m2))
+    OB_FATAL_ERROR_CODE (0x2031b007, "maps should be the same size\n");
+  slaw buf = (slaw) malloc (len);
+  memcpy (buf, m1, len);
+  check_map (buf, 0);
+  check_map (buf, 0);
+  memcpy (buf, m2, len);
+  check_map (buf, 7000);
+  check_map (buf, 7000);
+  memcpy (buf, m1, len);
+  check_map (buf, 0);
+  // Same keys in the same places; only the values are different
+  slaw m3 = make_map (9000);
+  if (len != slaw_len (m3))
+    OB_FATAL_ERROR_CODE (0x2031b009, "maps should be the same size\n");
+  memcpy (buf, m3, len);
+  check_map (buf, 9000);
+  memcpy (buf, m1, len);
+  check_map (buf, 0);
+  free (buf);
+  slaw_free (m1);
+  slaw_free (m2);
+  slaw_free (m3);
+}
+
+#define BIG (4 * 1024 * 1024)
+
+/// The index only keeps (and checks) the keys, so a big value neither
+/// gets copied nor slows down each lookup; changing it in place is
+/// seen right away.
+
+static void check_big_value (void)
+{
+  char *str = (char *) malloc (BIG);
+  memset (str, 'a', BIG - 1);
+  str[BIG - 1] = 0;
+  slabu *sb = slabu_new ();
+  char key[32];
+  int64 i;
+  for (i = 0; i < NUM; i++)
+    {
+      snprintf (key, sizeof (key), "key-%" OB_FMT_64 "d", i);
+      slabu_map_put_cf (sb, key, slaw_int64 (i));
+    }
+  slabu_map_put_cf (sb, "big", slaw_string (str));
+  slabu_map_put_ff (sb, slaw_int64 (-1), slaw_string ("minus one"));
+  free (str);
+  slaw m = slaw_map_f (sb);
+
+  for (i = 0; i < 3; i++)
+    {
+      check_map (m, 0);
+      const char *big = slaw_string_emit (slaw_map_find_c (m, "big"));
+      if (!big || big[0] != 'a' || strlen (big) != BIG - 1)
+        OB_FATAL_ERROR_CODE (0x2031b00a, "wrong value for big\n");
+    }
+  char *writable = (char *) slaw_string_emit (slaw_map_find_c (m, "big"));
+  writable[0] = 'b';
+  const char *big = slaw_string_emit (slaw_map_find_c (m, "big"));
+  if (!big || big[0] != 'b')
+    OB_FATAL_ERROR_CODE (0x2031b00b, "didn't see big change\n");
+  check_map (m, 0);
+  slaw_free (m);
+}
+
+#define NMAPS 20
+
+/// More maps than a thread keeps indexes for, taking turns.
+
+static void check_many (void)
+{
+  slaw maps[NMAPS];
+  int i, pass;
+  for (i = 0; i < NMAPS; i++)
+    maps[i] = make_map (1000 * i);
+  for (pass = 0; pass < 3; pass++)
+    for (i = 0; i < NMAPS; i++)
+      check_map (maps[i], 1000 * i);
+  for (i = 0; i < NMAPS; i++)
+    slaw_free (maps[i]);
+}
+
+#define NTHREADS 4
+
+static void *check_shared (void *arg)
+{
+  bslaw m = (bslaw) arg;
+  int pass;
+  for (pass = 0; pass < 20; pass++)
+    check_map (m, 42);
+  return NULL;
+}
+
+/// Lots of threads reading the same map
+
+static void check_threads (void)
+{
+  slaw m = make_map (42);
+  pthread_t thr[NTHREADS];
+  int i;
+  for (i = 0; i < NTHREADS; i++)
+    if (pthread_create (&thr[i], NULL, check_shared, m) != 0)
+      OB_FATAL_ERROR_CODE (0x2031b008, "couldn't start thread %d\n", i);
+  for (i = 0; i < NTHREADS; i++)
+    pthread_join (thr[i], NULL);
+  slaw_free (m);
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  int64 bias;
+  for (bias = 0; bias < 5; bias++)
+    {
+      slaw m = make_map (1000 * bias);
+      check_map (m, 1000 * bias);
+      check_map (m, 1000 * bias);
+      slaw_free (m);
+    }
+
+  // Maps inside proteins
+  for (bias = 0; bias < 5; bias++)
+    {
+      protein p = protein_from_ff (NULL, make_map (1000 * bias));
+      check_map (protein_ingests (p), 1000 * bias);
+      check_map (protein_ingests (p), 1000 * bias);
+      protein_free (p);
+    }
+
+  check_list ();
+  check_overwritten ();
+  check_big_value ();
+  check_many ();
+  check_threads ();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+/* (c)  oblong industries */
+
+// Not an automated test: run it by hand to see how fast we can swap
+// the byte order of numeric arrays, which is what takes the time
+// when proteins go between machines of different endianness.
+// Compares a plain loop over ob_swap32() and friends (which is what
+// slaw_swap() used to do) with ob_swap32_array() and friends, and
+// then (optionally) times protein_fix_endian() on a real protein.
+//
+// Usage: swap-bench [megabytes [repetitions [foreign-protein.bin]]]
+
+#include "libLoam/c/ob-endian.h"
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-time.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static float64 elapsed (unt64 start)
+{
+  return (ob_monotonic_time () - start) / 1e9;
+}
+
+static void report (const char *what, size_t bytes, int reps, float64 secs)
+{
+  printf ("%-28s %8.2f GB/s\n", what, (float64) bytes * reps / secs / 1e9);
+}
+
+// noinline, so the loops aren't optimized any differently than they
+// were in slaw_swap()
+__attribute__ ((noinline)) static void loop16 (unt16 *p, size_t n)
+{
+  size_t i;
+  for (i = 0; i < n; i++, p++)
+    *p = ob_swap16 (*p);
+}
+
+__attribute__ ((noinline)) static void loop32 (unt32 *p, size_t n)
+{
+  size_t i;
+  for (i = 0; i < n; i++, p++)
+    *p = ob_swap32 (*p);
+}
+
+__attribute__ ((noinline)) static void loop64 (unt64 *p, size_t n)
+{
+  size_t i;
+  for (i = 0; i < n; i++, p++)
+    *p = ob_swap64 (*p);
+}
+
+int main (int argc, char **argv)
+{
+  const size_t mb = (argc > 1 ? strtoul (argv[1], NULL, 0) : 16);
+  const int reps = (argc > 2 ? atoi (argv[2]) : 50);
+  const char *foreign = (argc > 3 ? argv[3] : NULL);
+  const size_t bytes = mb << 20;
+  if (bytes == 0 || reps <= 0)
+    {
+      fprintf (stderr, "Usage: swap-bench [megabytes [repetitions "
+                       "[foreign-protein.bin]]]\n");
+      return EXIT_FAILURE;
+    }
+
+  unt64 *buf = (unt64 *) malloc (bytes);
+  if (!buf)
+    OB_FATAL_ERROR_CODE (0x2031d000, "couldn't allocate %" OB_FMT_SIZE
+                                     "u bytes\n",
+                         bytes);
+  memset (buf, 0x5a, bytes);
+
+  printf ("%" OB_FMT_SIZE "u MB, %d times\n", mb, reps);
+
+  unt64 start;
+  int i;
+
+#define BENCH_N(what, len, n, call)                                            \
+  start = ob_monotonic_time ();                                                \
+  for (i = 0; i < (n); i++)                                                    \
+    call;                                                                      \
+  report (what, len, n, elapsed (start))
+#define BENCH(what, call) BENCH_N (what, bytes, reps, call)
+
+  BENCH ("16-bit, one at a time", loop16 ((unt16 *) buf, bytes / 2));
+  BENCH ("16-bit, ob_swap16_array", ob_swap16_array ((unt16 *) buf, bytes / 2));
+  BENCH ("32-bit, one at a time", loop32 ((unt32 *) buf, bytes / 4));
+  BENCH ("32-bit, ob_swap32_array", ob_swap32_array ((unt32 *) buf, bytes / 4));
+  BENCH ("64-bit, one at a time", loop64 (buf, bytes / 8));
+  BENCH ("64-bit, ob_swap64_array", ob_swap64_array (buf, bytes / 8));
+
+  free (buf);
+
+  // Now a real protein of the other endianness, if we were given a
+  // file with one in it (like big-endian-protein-version2.bin, on a
+  // little-endian machine); we can't make one ourselves, since we
+  // only know how to swap from the other endianness to ours.
+  if (!foreign)
+    return EXIT_SUCCESS;
+  FILE *f = fopen (foreign, "rb");
+  if (!f)
+    OB_FATAL_ERROR_CODE (0x2031d001, "couldn't open '%s'\n", foreign);
+  byte *orig = (byte *) malloc (bytes);
+  byte *work = (byte *) malloc (bytes);
+  if (!orig || !work)
+    OB_FATAL_ERROR_CODE (0x2031d002, "couldn't allocate %" OB_FMT_SIZE
+                                     "u bytes\n",
+                         bytes);
+  // skip the 8-byte file header; the first protein follows
+  size_t len = 0;
+  if (fseek (f, 8, SEEK_SET) == 0)
+    len = fread (orig, 1, bytes, f);
+  fclose (f);
+  if (len < 16 || !slaw_is_swapped_protein ((bslaw) orig))
+    OB_FATAL_ERROR_CODE (0x2031d003, "'%s' doesn't start with a protein of "
+                                     "the other endianness\n",
+                         foreign);
+  // find out how long it is by swapping a copy
+  memcpy (work, orig, len);
+  OB_DIE_ON_ERROR (protein_fix_endian ((protein) work));
+  len = (size_t) protein_len ((bprotein) work);
+
+  const int preps = reps * (int) (bytes / len);
+  BENCH_N ("memcpy alone", len, preps, memcpy (work, orig, len));
+  start = ob_monotonic_time ();
+  for (i = 0; i < preps; i++)
+    {
+      memcpy (work, orig, len);
+      OB_DIE_ON_ERROR (protein_fix_endian ((protein) work));
+    }
+  report ("memcpy + protein_fix_endian", len, preps, elapsed (start));
+
+  free (orig);
+  free (work);
+  return EXIT_SUCCESS;
+}
@@ -3,13 +3,229 @@
 
 /* Tests for pool_net_pack_op and pool_net_unpack_op. */
 
+#include "libLoam/c/ob-endian.h"
+#include "libLoam/c/ob-file.h"
 #include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-sys.h"
 #include "libLoam/c/ob-vers.h"
 
 #include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-interop.h"
 #include "libPlasma/c/protein.h"
 #include "libPlasma/c/pool.h"
 #include "libPlasma/c/private/pool_net.h"
+#include "libPlasma/c/private/pool_tcp.h"
+
+static ob_handle_t no_wakeup = OB_NULL_HANDLE;
+
+static void connect_pair (pool_net_data *a, pool_net_data *b, unt8 version)
+{
+  int fds[2];
+  OB_DIE_ON_ERROR (ob_socketpair_cloexec (OB_SP_DOMAIN, SOCK_STREAM, 0, fds));
+  memset (a, 0, sizeof (*a));
+  a->send_nbytes = pool_tcp_send_nbytes;
+  a->recv_nbytes = pool_tcp_recv_nbytes;
+  a->send_iov = pool_tcp_send_iov;
+  a->wakeup_handle_loc = &no_wakeup;
+  a->net_version = version;
+  a->slaw_version = SLAW_VERSION_CURRENT;
+  *b = *a;
+  a->connfd = fds[0];
+  b->connfd = fds[1];
+}
+
+static void disconnect_pair (pool_net_data *a, pool_net_data *b)
+{
+  close (a->connfd);
+  close (b->connfd);
+}
+
+/* Sends a request and its result back the other way, and checks that
+ * everything arrives the way it was sent. */
+static void round_trip (unt8 version)
+{
+  pool_net_data a, b;
+  connect_pair (&a, &b, version);
+
+  protein p =
+    protein_from_ff (slaw_list_inline_c ("round", "trip", NULL),
+                     slaw_map_inline_cf ("version", slaw_unt8 (version), NULL));
+  OB_DIE_ON_ERROR (pool_net_send_op (&a, POOL_CMD_DEPOSIT, "pisxt", p,
+                                     (int64) -5, "hello", NULL, 0.25));
+
+  int op_num = -1;
+  protein op = NULL;
+  OB_DIE_ON_ERROR (pool_net_recv_op (&b, &op_num, &op));
+  if (op_num != POOL_CMD_DEPOSIT)
+    OB_FATAL_ERROR_CODE (0x2031a002, "v%u: got op %d\n", version, op_num);
+  bprotein borrowed = NULL;
+  int64 i = 0;
+  char *str = NULL;
+  slaw nothing = p;
+  pool_timestamp ts = 0;
+  OB_DIE_ON_ERROR (pool_net_unpack_op (op, version, "bisxt", &borrowed, &i,
+                                       &str, &nothing, &ts));
+  if (!proteins_equal (borrowed, p) || i != -5 || strcmp (str, "hello") != 0
+      || nothing != NULL || ts != 0.25)
+    OB_FATAL_ERROR_CODE (0x2031a003, "v%u: request didn't survive\n",
+                         version);
+  free (str);
+  protein_free (op);
+
+  // Asking for a slaw gets one, whatever was sent
+  OB_DIE_ON_ERROR (
+    pool_net_send_result (&b, "rpit", POOL_NO_SUCH_PROTEIN, p, 7, 1.5));
+  ob_retort remote = OB_OK;
+  protein q = NULL;
+  slaw seven = NULL, stamp = NULL;
+  OB_DIE_ON_ERROR (
+    pool_net_recv_result (&a, "rpxx", &remote, &q, &seven, &stamp));
+  if (remote != POOL_NO_SUCH_PROTEIN || !proteins_equal (p, q)
+      || !slaw_is_int64 (seven) || *slaw_int64_emit (seven) != 7
+      || !slaw_is_float64 (stamp) || *slaw_float64_emit (stamp) != 1.5)
+    OB_FATAL_ERROR_CODE (0x2031a004, "v%u: result didn't survive\n",
+                         version);
+  protein_free (q);
+  slaw_free (seven);
+  slaw_free (stamp);
+
+  // Fewer arguments than asked for, and more
+  OB_DIE_ON_ERROR (pool_net_send_result (&b, "r", OB_OK));
+  OB_DIE_ON_ERROR (pool_net_send_result (&b, "rii", OB_OK, 1, 2));
+  q = p;
+  OB_DIE_ON_ERROR (pool_net_recv_result (&a, "rp", &remote, &q));
+  if (remote != OB_OK || q != NULL)
+    OB_FATAL_ERROR_CODE (0x2031a005, "v%u: missing protein wasn't NULL\n",
+                         version);
+  OB_DIE_ON_ERROR (pool_net_recv_result (&a, "ri", &remote, &i));
+  if (remote != OB_OK || i != 1)
+    OB_FATAL_ERROR_CODE (0x2031a006, "v%u: extra args confused it\n",
+                         version);
+
+  protein_free (p);
+  disconnect_pair (&a, &b);
+}
+
+/* A frame in the other byte order gets turned around. */
+static void foreign_frame (void)
+{
+  pool_net_data a, b;
+  connect_pair (&a, &b, POOL_TCP_VERSION_WITH_BINARY_FRAMES);
+
+  slaw yes = slaw_boolean (true);
+  const char hi[8] = "hi";
+  unt64 frame[] = {((unt64) POOL_CMD_RESULT << 32) | 0x504e4631,
+                   4 * 8,
+                   (8 << 8) | 'i',
+                   OB_CONST_U64 (0x0102030405060708),
+                   (2 << 8) | 's',
+                   0,
+                   (8 << 8) | 'x',
+                   0};
+  memcpy (&frame[5], hi, sizeof (hi));
+  memcpy (&frame[7], yes, 8);
+  frame[1] = sizeof (frame) - 2 * 8;
+  size_t w;
+  for (w = 0; w < sizeof (frame) / 8; w++)
+    if (w != 5)
+      frame[w] = ob_swap64 (frame[w]);
+  OB_DIE_ON_ERROR (a.send_nbytes (a.connfd, frame, sizeof (frame), no_wakeup));
+
+  int64 i = 0;
+  char *str = NULL;
+  slaw x = NULL;
+  OB_DIE_ON_ERROR (pool_net_recv_result (&b, "isx", &i, &str, &x));
+  if (i != OB_CONST_I64 (0x0102030405060708) || strcmp (str, "hi") != 0
+      || !slawx_equal (x, yes))
+    OB_FATAL_ERROR_CODE (0x2031a007, "foreign frame didn't survive\n");
+  free (str);
+  slaw_free (x);
+  slaw_free (yes);
+  disconnect_pair (&a, &b);
+}
+
+/* Sends a frame with one slaw argument, whose length is right but
+ * whose insides aren't, and makes sure it's refused. */
+static void send_broken_slaw (pool_net_data *a, int op_num)
+{
+  slaw list = slaw_list_inline_c ("x", NULL);
+  slaw longer = slaw_string ("something that takes up a few more octs");
+  const unt64 octs = slaw_len (list) / 8;
+  unt64 frame[8];
+  if (octs + 3 > sizeof (frame) / 8)
+    OB_FATAL_ERROR_CODE (0x2031a008, "list is %" OB_FMT_64 "u octs\n",
+                         octs);
+  frame[0] = ((unt64) op_num << 32) | 0x504e4631;
+  frame[1] = 8 * (octs + 1);
+  frame[2] = ((8 * octs) << 8) | 'x';
+  memcpy (&frame[3], list, 8 * octs);
+  // The list's element says it goes on past the end of the list
+  const size_t elem = (size_t) ((const unt64 *) slaw_list_emit_first (list)
+                                 - (const unt64 *) list);
+  memcpy (&frame[3 + elem], longer, 8);
+  OB_DIE_ON_ERROR (
+    a->send_nbytes (a->connfd, frame, 8 * (octs + 3), no_wakeup));
+  slaw_free (list);
+  slaw_free (longer);
+}
+
+static void broken_slaw (void)
+{
+  pool_net_data a, b;
+  connect_pair (&a, &b, POOL_TCP_VERSION_WITH_BINARY_FRAMES);
+  send_broken_slaw (&a, POOL_CMD_DEPOSIT);
+  int op_num = -1;
+  protein op = NULL;
+  ob_retort pret = pool_net_recv_op (&b, &op_num, &op);
+  if (pret != POOL_PROTOCOL_ERROR || op != NULL)
+    OB_FATAL_ERROR_CODE (0x2031a009, "broken request got %s\n",
+                         ob_error_string (pret));
+  disconnect_pair (&a, &b);
+
+  connect_pair (&a, &b, POOL_TCP_VERSION_WITH_BINARY_FRAMES);
+  send_broken_slaw (&a, POOL_CMD_RESULT);
+  slaw x = NULL;
+  pret = pool_net_recv_result (&b, "x", &x);
+  if (pret != POOL_PROTOCOL_ERROR || x != NULL)
+    OB_FATAL_ERROR_CODE (0x2031a00a, "broken result got %s\n",
+                         ob_error_string (pret));
+  disconnect_pair (&a, &b);
+}
+
+/* Something that isn't a protein, where a protein belongs. */
+static void not_a_protein (unt8 version)
+{
+  pool_net_data a, b;
+  connect_pair (&a, &b, version);
+  slaw str = slaw_string ("not a protein");
+
+  OB_DIE_ON_ERROR (pool_net_send_op (&a, POOL_CMD_CHANGE_OPTIONS, "x", str));
+  int op_num = -1;
+  protein op = NULL;
+  OB_DIE_ON_ERROR (pool_net_recv_op (&b, &op_num, &op));
+  protein p = NULL;
+  ob_retort pret = pool_net_unpack_op (op, version, "p", &p);
+  if (pret != POOL_PROTOCOL_ERROR || p != NULL)
+    OB_FATAL_ERROR_CODE (0x2031a00b, "v%u: request got %s\n", version,
+                         ob_error_string (pret));
+  // It's still fine as a slaw
+  slaw x = NULL;
+  OB_DIE_ON_ERROR (pool_net_unpack_op (op, version, "x", &x));
+  if (!slawx_equal (x, str))
+    OB_FATAL_ERROR_CODE (0x2031a00c, "v%u: slaw didn't survive\n", version);
+  slaw_free (x);
+  protein_free (op);
+
+  OB_DIE_ON_ERROR (pool_net_send_result (&b, "rx", OB_OK, str));
+  ob_retort remote = OB_UNKNOWN_ERR;
+  pret = pool_net_recv_result (&a, "rp", &remote, &p);
+  if (pret != POOL_PROTOCOL_ERROR || p != NULL)
+    OB_FATAL_ERROR_CODE (0x2031a00d, "v%u: result got %s\n", version,
+                         ob_error_string (pret));
+
+  slaw_free (str);
+  disconnect_pair (&a, &b);
+}
 
 int main (int argc, char **argv)
 {
@@ -24,7 +240,8 @@ int main (int argc, char **argv)
   OB_DIE_ON_ERROR (OB_CHECK_ABI ());
 
   OB_LOG_INFO (
-    "This test causes warnings saying 'This was not a string', and that's ok");
+    "This test causes warnings saying 'This was not a string' (and "
+    "'not a protein'), and that's ok");
 
   /* Test that unpacking a pool TCP protein with a missing string
    * argument doesn't crash. (bug 17941) */
@@ -50,5 +267,12 @@ int main (int argc, char **argv)
                          "not signaled\n");
   free (str1);
 
+  round_trip (POOL_TCP_VERSION_WITH_BINARY_FRAMES - 1);
+  round_trip (POOL_TCP_VERSION_WITH_BINARY_FRAMES);
+  foreign_frame ();
+  broken_slaw ();
+  not_a_protein (POOL_TCP_VERSION_WITH_BINARY_FRAMES - 1);
+  not_a_protein (POOL_TCP_VERSION_WITH_BINARY_FRAMES);
+
   return 0;
 }
@@ -0,0 +1,295 @@
+/* (c)  oblong industries */
+
+// Builds slawx with a slaw_builder, and checks that they come out the
+// same as the ones built the usual way; and that slaw_fabricator,
+// which is built on a slaw_builder, can rebuild them from a walk.
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw-builder.h"
+#include "libPlasma/c/slaw-string.h"
+#include "libPlasma/c/slaw-walk.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int checks;
+
+static void check_walk (bslaw expected)
+{
+  slaw_fabricator *sf = slaw_fabricator_new ();
+  if (!sf)
+    OB_FATAL_ERROR_CODE (0x2031e000, "out of memory\n");
+  OB_DIE_ON_ERROR (slaw_walk (sf, &slaw_fabrication_handler, expected));
+  if (!slawx_equal (sf->result, expected)
+      || slaw_len (sf->result) != slaw_len (expected))
+    OB_FATAL_ERROR_CODE (0x2031e001, "fabricator got it wrong\n");
+  slaw_fabricator_free (sf);
+}
+
+/// Checks that \a b built the same thing as \a expected, which is freed.
+static void check_built (slaw_builder *b, slaw expected)
+{
+  slaw s = slaw_builder_finish (b);
+  if (!s || !expected)
+    OB_FATAL_ERROR_CODE (0x2031e002, "check %d: nothing built\n", checks);
+  if (slaw_len (s) != slaw_len (expected)
+      || memcmp (s, expected, slaw_len (s)) != 0)
+    {
+      slaw_spew_overview_to_stderr (expected);
+      slaw_spew_overview_to_stderr (s);
+      OB_FATAL_ERROR_CODE (0x2031e003, "check %d: built the wrong thing\n",
+                           checks);
+    }
+  check_walk (expected);
+  slaw_free (s);
+  slaw_free (expected);
+  checks++;
+}
+
+static void test_scalars (slaw_builder *b)
+{
+  OB_DIE_ON_ERROR (slaw_builder_begin_list (b));
+  slabu *sb = slabu_new ();
+  int i;
+  char str[40];
+  for (i = 0; i < 20; i++)
+    {
+      memset (str, 'a' + i, i);
+      str[i] = 0;
+      OB_DIE_ON_ERROR (slaw_builder_add_string (b, str));
+      slabu_list_add_c (sb, str);
+    }
+  OB_DIE_ON_ERROR (slaw_builder_add_nil (b));
+  slabu_list_add_x (sb, slaw_nil ());
+  OB_DIE_ON_ERROR (slaw_builder_add_boolean (b, true));
+  slabu_list_add_x (sb, slaw_boolean (true));
+  OB_DIE_ON_ERROR (slaw_builder_add_int64 (b, -12345678901LL));
+  slabu_list_add_x (sb, slaw_int64 (-12345678901LL));
+  OB_DIE_ON_ERROR (slaw_builder_add_unt64 (b, 42));
+  slabu_list_add_x (sb, slaw_unt64 (42));
+  OB_DIE_ON_ERROR (slaw_builder_add_float64 (b, 2.5));
+  slabu_list_add_x (sb, slaw_float64 (2.5));
+  const v3float64 v3 = {1, 2, 3};
+  slaw v = slaw_v3float64 (v3);
+  OB_DIE_ON_ERROR (slaw_builder_add (b, v));
+  slabu_list_add_x (sb, v);
+  int32 nums[] = {1, 2, 3};
+  slaw a = slaw_int32_array (nums, 3);
+  OB_DIE_ON_ERROR (slaw_builder_add (b, a));
+  slabu_list_add_x (sb, a);
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  check_built (b, slaw_list_f (sb));
+
+  // A slaw all by itself
+  OB_DIE_ON_ERROR (slaw_builder_add_string (b, "lonely"));
+  check_built (b, slaw_string ("lonely"));
+}
+
+static void test_containers (slaw_builder *b)
+{
+  // Lists on both sides of the wee/non-wee line, nested
+  int n;
+  for (n = 0; n < 40; n += 7)
+    {
+      slabu *outer = slabu_new ();
+      OB_DIE_ON_ERROR (slaw_builder_begin_list (b));
+      int i, j;
+      for (i = 0; i < n; i++)
+        {
+          slabu *inner = slabu_new ();
+          OB_DIE_ON_ERROR (slaw_builder_begin_list (b));
+          for (j = 0; j <= i; j++)
+            {
+              OB_DIE_ON_ERROR (slaw_builder_add_int64 (b, j));
+              slabu_list_add_x (inner, slaw_int64 (j));
+            }
+          OB_DIE_ON_ERROR (slaw_builder_end (b));
+          slabu_list_add_x (outer, slaw_list_f (inner));
+        }
+      OB_DIE_ON_ERROR (slaw_builder_end (b));
+      check_built (b, slaw_list_f (outer));
+    }
+
+  // Empty ones
+  OB_DIE_ON_ERROR (slaw_builder_begin_list (b));
+  OB_DIE_ON_ERROR (slaw_builder_begin_map (b));
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  check_built (b, slaw_list_inline_f (slaw_map_f (slabu_new ()), NULL));
+
+  OB_DIE_ON_ERROR (slaw_builder_begin_cons (b));
+  OB_DIE_ON_ERROR (slaw_builder_add_string (b, "car"));
+  OB_DIE_ON_ERROR (slaw_builder_add_string (b, "cdr"));
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  check_built (b, slaw_cons_ff (slaw_string ("car"), slaw_string ("cdr")));
+}
+
+/// Builds a map of \a n entries, with \a dups duplicate keys in it.
+static void build_map (slaw_builder *b, int n, int dups, bool junk)
+{
+  slabu *sb = slabu_new ();
+  OB_DIE_ON_ERROR (slaw_builder_begin_map (b));
+  int i;
+  for (i = 0; i < n; i++)
+    {
+      slaw key = slaw_string_format ("key %d", i < dups ? 0 : i);
+      OB_DIE_ON_ERROR (slaw_builder_begin_cons (b));
+      OB_DIE_ON_ERROR (slaw_builder_add (b, key));
+      OB_DIE_ON_ERROR (slaw_builder_add_int64 (b, i));
+      OB_DIE_ON_ERROR (slaw_builder_end (b));
+      slabu_list_add_x (sb, slaw_cons_ff (key, slaw_int64 (i)));
+      if (junk && i % 5 == 0)
+        {
+          OB_DIE_ON_ERROR (slaw_builder_add_string (b, "not a cons"));
+          slabu_list_add_c (sb, "not a cons");
+        }
+    }
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  check_built (b, slaw_map_f (sb));
+}
+
+static void test_maps (slaw_builder *b)
+{
+  build_map (b, 5, 0, false);
+  build_map (b, 5, 2, false);
+  build_map (b, 5, 0, true);
+  build_map (b, 200, 0, false);
+  build_map (b, 200, 3, false);
+  build_map (b, 200, 0, true);
+}
+
+static void build_protein (slaw_builder *b, int rude_len, bool backwards)
+{
+  byte rude[100];
+  int i;
+  for (i = 0; i < rude_len; i++)
+    rude[i] = (byte) (i * 37);
+
+  slaw des = slaw_list_inline_c ("hello", "there", NULL);
+  slaw ing = slaw_map_inline_cf ("x", slaw_int64 (7), "y",
+                                 slaw_string ("why"), NULL);
+
+  OB_DIE_ON_ERROR (slaw_builder_begin_protein (b));
+  if (backwards)
+    {
+      OB_DIE_ON_ERROR (slaw_builder_add_rude_data (b, rude, rude_len));
+      OB_DIE_ON_ERROR (slaw_builder_begin_ingests (b));
+      OB_DIE_ON_ERROR (slaw_builder_add (b, ing));
+      OB_DIE_ON_ERROR (slaw_builder_end (b));
+      // The first descrips should lose to the second
+      OB_DIE_ON_ERROR (slaw_builder_begin_descrips (b));
+      OB_DIE_ON_ERROR (slaw_builder_add_string (b, "wrong"));
+      OB_DIE_ON_ERROR (slaw_builder_end (b));
+      OB_DIE_ON_ERROR (slaw_builder_begin_descrips (b));
+      OB_DIE_ON_ERROR (slaw_builder_add (b, des));
+      OB_DIE_ON_ERROR (slaw_builder_end (b));
+    }
+  else
+    {
+      OB_DIE_ON_ERROR (slaw_builder_begin_descrips (b));
+      OB_DIE_ON_ERROR (slaw_builder_add (b, des));
+      OB_DIE_ON_ERROR (slaw_builder_end (b));
+      OB_DIE_ON_ERROR (slaw_builder_begin_ingests (b));
+      OB_DIE_ON_ERROR (slaw_builder_add (b, ing));
+      OB_DIE_ON_ERROR (slaw_builder_end (b));
+      OB_DIE_ON_ERROR (slaw_builder_add_rude_data (b, rude, rude_len));
+    }
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  check_built (b, protein_from_ffr (des, ing, rude, rude_len));
+}
+
+static void test_proteins (slaw_builder *b)
+{
+  int rude_len;
+  for (rude_len = 0; rude_len < 20; rude_len++)
+    {
+      build_protein (b, rude_len, false);
+      build_protein (b, rude_len, true);
+    }
+
+  // Nothing in it at all
+  OB_DIE_ON_ERROR (slaw_builder_begin_protein (b));
+  OB_DIE_ON_ERROR (slaw_builder_begin_descrips (b));
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  check_built (b, protein_from (NULL, NULL));
+
+  // A protein in a protein
+  protein inner = protein_from_ff (slaw_list_inline_c ("inner", NULL), NULL);
+  OB_DIE_ON_ERROR (slaw_builder_begin_protein (b));
+  OB_DIE_ON_ERROR (slaw_builder_begin_ingests (b));
+  OB_DIE_ON_ERROR (slaw_builder_begin_list (b));
+  OB_DIE_ON_ERROR (slaw_builder_add (b, inner));
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  check_built (b, protein_from_ff (NULL, slaw_list_inline_f (inner, NULL)));
+}
+
+static void expect_badness (ob_retort tort, const char *what)
+{
+  if (tort != SLAW_FABRICATOR_BADNESS)
+    OB_FATAL_ERROR_CODE (0x2031e004, "%s: expected %s, got %s\n", what,
+                         ob_error_string (SLAW_FABRICATOR_BADNESS),
+                         ob_error_string (tort));
+}
+
+static void test_mistakes (slaw_builder *b)
+{
+  expect_badness (slaw_builder_end (b), "end of nothing");
+
+  OB_DIE_ON_ERROR (slaw_builder_begin_cons (b));
+  OB_DIE_ON_ERROR (slaw_builder_add_nil (b));
+  expect_badness (slaw_builder_end (b), "cons of one");
+  OB_DIE_ON_ERROR (slaw_builder_add_nil (b));
+  expect_badness (slaw_builder_add_nil (b), "cons of three");
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+  expect_badness (slaw_builder_add_nil (b), "second slaw");
+  check_built (b, slaw_cons_ff (slaw_nil (), slaw_nil ()));
+
+  OB_DIE_ON_ERROR (slaw_builder_begin_protein (b));
+  expect_badness (slaw_builder_add_nil (b), "loose in a protein");
+  OB_DIE_ON_ERROR (slaw_builder_add_rude_data (b, "ab", 2));
+  expect_badness (slaw_builder_add_rude_data (b, "ab", 2), "rude twice");
+  OB_DIE_ON_ERROR (slaw_builder_begin_descrips (b));
+  OB_DIE_ON_ERROR (slaw_builder_add_nil (b));
+  expect_badness (slaw_builder_add_nil (b), "two descrips");
+  expect_badness (slaw_builder_begin_descrips (b), "descrips in descrips");
+  OB_DIE_ON_ERROR (slaw_builder_end (b));
+
+  // Unfinished, so nothing to show for it
+  if (slaw_builder_depth (b) != 1)
+    OB_FATAL_ERROR_CODE (0x2031e005, "depth was %" OB_FMT_64 "d\n",
+                         slaw_builder_depth (b));
+  if (slaw_builder_finish (b) != NULL)
+    OB_FATAL_ERROR_CODE (0x2031e006, "finished an unfinished protein\n");
+  if (slaw_builder_finish (b) != NULL)
+    OB_FATAL_ERROR_CODE (0x2031e007, "finished an empty builder\n");
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  slaw_builder *b = slaw_builder_new ();
+  if (!b)
+    OB_FATAL_ERROR_CODE (0x2031e008, "out of memory\n");
+  test_scalars (b);
+  test_containers (b);
+  test_maps (b);
+  test_proteins (b);
+  test_mistakes (b);
+  // and the builder still works afterwards
+  test_maps (b);
+  slaw_builder_free (b);
+
+  // A builder which has never built anything has nothing to finish
+  b = slaw_builder_new ();
+  if (slaw_builder_finish (b) != NULL)
+    OB_FATAL_ERROR_CODE (0x2031e009, "finished a new builder\n");
+  slaw_builder_free (b);
+
+  return EXIT_SUCCESS;
+}
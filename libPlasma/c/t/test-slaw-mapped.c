@@ -0,0 +1,158 @@
+/* (c)  oblong industries */
+
+// Reads binary slaw files with slaw_input_open_binary_mapped(), and
+// checks that it agrees with slaw_input_open_binary().
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-sys.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/slaw-io.h"
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw-string.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#define HOW_MANY 500
+
+static slaw nth_slaw (int64 i)
+{
+  switch (i % 3)
+    {
+      case 0:
+        return slaw_int64 (i);
+      case 1:
+        return slaw_string_format ("slaw number %" OB_FMT_64 "d", i);
+      default:
+        return protein_from_ff (slaw_list_inline_f (slaw_int64 (i), NULL),
+                                slaw_map_inline_cf ("i", slaw_int64 (i), NULL));
+    }
+}
+
+static void check_nth (int64 i, bslaw s)
+{
+  slaw expected = nth_slaw (i);
+  if (!slawx_equal (s, expected))
+    OB_FATAL_ERROR_CODE (0x2031c000, "slaw %" OB_FMT_64 "d is wrong\n", i);
+  slaw_free (expected);
+}
+
+static void test_written (const char *filename)
+{
+  slaw_output out;
+  OB_DIE_ON_ERROR (slaw_output_open_binary (filename, &out));
+  int64 i;
+  for (i = 0; i < HOW_MANY; i++)
+    {
+      slaw s = nth_slaw (i);
+      OB_DIE_ON_ERROR (slaw_output_write (out, s));
+      slaw_free (s);
+    }
+  OB_DIE_ON_ERROR (slaw_output_close (out));
+
+  slaw_input in;
+  OB_DIE_ON_ERROR (slaw_input_open_binary_mapped (filename, &in));
+
+  // Straight through, half copied and half borrowed
+  bslaw b;
+  for (i = 0; i < HOW_MANY / 2; i++)
+    {
+      slaw s;
+      OB_DIE_ON_ERROR (slaw_input_read (in, &s));
+      check_nth (i, s);
+      slaw_free (s);
+    }
+  for (; i < HOW_MANY; i++)
+    {
+      OB_DIE_ON_ERROR (slaw_input_read_borrowed (in, &b));
+      check_nth (i, b);
+    }
+  ob_retort tort = slaw_input_read_borrowed (in, &b);
+  if (tort != SLAW_END_OF_FILE)
+    OB_FATAL_ERROR_CODE (0x2031c001, "expected end of file, got %s\n",
+                         ob_error_string (tort));
+
+  // Random access
+  int64 count = -1;
+  OB_DIE_ON_ERROR (slaw_input_count (in, &count));
+  if (count != HOW_MANY)
+    OB_FATAL_ERROR_CODE (0x2031c002, "count was %" OB_FMT_64 "d\n", count);
+  for (i = 0; i < HOW_MANY; i++)
+    {
+      const int64 n = (i * 7919) % HOW_MANY;
+      OB_DIE_ON_ERROR (slaw_input_seek (in, n));
+      OB_DIE_ON_ERROR (slaw_input_read_borrowed (in, &b));
+      check_nth (n, b);
+    }
+  OB_DIE_ON_ERROR (slaw_input_seek (in, HOW_MANY));
+  if (slaw_input_read_borrowed (in, &b) != SLAW_END_OF_FILE)
+    OB_FATAL_ERROR_CODE (0x2031c003, "expected end of file after seek\n");
+  if (slaw_input_seek (in, HOW_MANY + 1) != SLAW_END_OF_FILE)
+    OB_FATAL_ERROR_CODE (0x2031c004, "seek past the end should fail\n");
+  OB_DIE_ON_ERROR (slaw_input_close (in));
+
+  // Seeking forward into parts of the file we haven't read yet
+  OB_DIE_ON_ERROR (slaw_input_open_binary_mapped (filename, &in));
+  OB_DIE_ON_ERROR (slaw_input_seek (in, HOW_MANY - 3));
+  OB_DIE_ON_ERROR (slaw_input_read_borrowed (in, &b));
+  check_nth (HOW_MANY - 3, b);
+  OB_DIE_ON_ERROR (slaw_input_seek (in, 1));
+  OB_DIE_ON_ERROR (slaw_input_read_borrowed (in, &b));
+  check_nth (1, b);
+  OB_DIE_ON_ERROR (slaw_input_close (in));
+
+  // Other inputs lend out copies, but can't seek
+  OB_DIE_ON_ERROR (slaw_input_open_binary (filename, &in));
+  OB_DIE_ON_ERROR (slaw_input_read_borrowed (in, &b));
+  check_nth (0, b);
+  if (slaw_input_seek (in, 0) != OB_INVALID_OPERATION)
+    OB_FATAL_ERROR_CODE (0x2031c005, "stdio input shouldn't seek\n");
+  OB_DIE_ON_ERROR (slaw_input_close (in));
+
+  unlink (filename);
+}
+
+// Compares the mapped and ordinary readings of one of the files of
+// various endiannesses and versions we have lying around.
+
+static void test_existing (const char *filename)
+{
+  slaw_input mapped, plain;
+  OB_DIE_ON_ERROR (slaw_input_open_binary_mapped (filename, &mapped));
+  OB_DIE_ON_ERROR (slaw_input_open_binary (filename, &plain));
+  for (;;)
+    {
+      bslaw b;
+      slaw s;
+      ob_retort t1 = slaw_input_read_borrowed (mapped, &b);
+      ob_retort t2 = slaw_input_read (plain, &s);
+      if (t1 != t2)
+        OB_FATAL_ERROR_CODE (0x2031c006, "%s: mapped said %s, plain said %s\n",
+                             filename, ob_error_string (t1),
+                             ob_error_string (t2));
+      if (t1 < OB_OK)
+        break;
+      if (!slawx_equal (b, s))
+        OB_FATAL_ERROR_CODE (0x2031c007, "%s: slawx differ\n", filename);
+      slaw_free (s);
+    }
+  OB_DIE_ON_ERROR (slaw_input_close (mapped));
+  OB_DIE_ON_ERROR (slaw_input_close (plain));
+}
+
+int mainish (int argc, char **argv)
+{
+  test_written ("scratch/test-slaw-mapped.tmp");
+  int i;
+  for (i = 1; i < argc; i++)
+    test_existing (argv[i]);
+  return EXIT_SUCCESS;
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  return check_for_leaked_file_descriptors_scoped (mainish, argc, argv);
+}
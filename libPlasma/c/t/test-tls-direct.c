@@ -0,0 +1,236 @@
+
+/* (c)  oblong industries */
+
+/* Tests TLS done right on a pool connection's socket (ossl-direct.c),
+ * over a socketpair: the STARTTLS exchange and handshake, a deposit
+ * and a next through it, and the peer hanging up when we're halfway
+ * through sending something.  SIGPIPE is left at its default, so if
+ * the rest of the write lets one through, we die. */
+
+#include "libLoam/c/ob-file.h"
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-sys.h"
+#include "libLoam/c/ob-vers.h"
+
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-interop.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/pool.h"
+#include "libPlasma/c/pool_options.h"
+#include "libPlasma/c/plasma-retorts.h"
+#include "libPlasma/c/private/pool_net.h"
+#include "libPlasma/c/private/pool_tcp.h"
+#include "libPlasma/c/private/pool-tls.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+
+#define POOL_NAME "test-tls-direct"
+
+// How much gets through before the peer hangs up, and how much after
+#define FIRST_PART 1000
+#define REST (1024 * 1024)
+
+static ob_handle_t no_wakeup = OB_NULL_HANDLE;
+
+static void connect_pair (pool_net_data *a, pool_net_data *b)
+{
+  int fds[2];
+  OB_DIE_ON_ERROR (ob_socketpair_cloexec (OB_SP_DOMAIN, SOCK_STREAM, 0, fds));
+  memset (a, 0, sizeof (*a));
+  a->send_nbytes = pool_tcp_send_nbytes;
+  a->recv_nbytes = pool_tcp_recv_nbytes;
+  a->send_iov = pool_tcp_send_iov;
+  a->wakeup_handle_loc = &no_wakeup;
+  a->net_version = POOL_TCP_VERSION_CURRENT;
+  a->slaw_version = SLAW_VERSION_CURRENT;
+  *b = *a;
+  a->connfd = fds[0];
+  b->connfd = fds[1];
+}
+
+static void use_tls (pool_net_data *net)
+{
+  net->send_nbytes = ob_tls_send_nbytes;
+  net->send_iov = ob_tls_send_iov;
+  net->recv_nbytes = ob_tls_recv_nbytes;
+}
+
+/* The server's half, which answers STARTTLS, DEPOSIT and NEXT much as
+ * pool_tcp_server would, then reads a little of something big and
+ * hangs up.  It runs in a process of its own, since ossl-common.c
+ * won't let a process's first two handshakes happen at once. */
+static int serve (pool_net_data *net, int gone_fd, int done_fd)
+{
+  int op_num = -1;
+  protein op = NULL;
+
+  OB_DIE_ON_ERROR (pool_net_recv_op (net, &op_num, &op));
+  if (op_num != POOL_CMD_STARTTLS)
+    OB_FATAL_ERROR_CODE (0x20320000, "expected STARTTLS, got %d\n", op_num);
+  protein_free (op);
+  slaw empty_map = slaw_map_f (slabu_new ());
+  OB_DIE_ON_ERROR (pool_net_send_result (net, "rx", OB_OK, empty_map));
+  slaw_free (empty_map);
+  OB_DIE_ON_ERROR (ob_tls_server_start (net->connfd, true, false));
+  use_tls (net);
+
+  pool_hose ph = NULL;
+  OB_DIE_ON_ERROR (pool_participate (POOL_NAME, &ph, NULL));
+
+  OB_DIE_ON_ERROR (pool_net_recv_op (net, &op_num, &op));
+  if (op_num != POOL_CMD_DEPOSIT)
+    OB_FATAL_ERROR_CODE (0x20320001, "expected DEPOSIT, got %d\n", op_num);
+  bprotein deposit = NULL;
+  int64 idx = -1;
+  pool_timestamp ts = 0;
+  OB_DIE_ON_ERROR (
+    pool_net_unpack_op (op, net->net_version, "b", &deposit));
+  ob_retort pret = pool_deposit_ex (ph, deposit, &idx, &ts);
+  protein_free (op);
+  OB_DIE_ON_ERROR (pool_net_send_result (net, "irt", idx, pret, ts));
+
+  OB_DIE_ON_ERROR (pool_net_recv_op (net, &op_num, &op));
+  if (op_num != POOL_CMD_NEXT)
+    OB_FATAL_ERROR_CODE (0x20320002, "expected NEXT, got %d\n", op_num);
+  OB_DIE_ON_ERROR (pool_net_unpack_op (op, net->net_version, "i", &idx));
+  protein_free (op);
+  protein p = NULL;
+  OB_DIE_ON_ERROR (pool_seekto (ph, idx));
+  pret = pool_next (ph, &p, &ts, &idx);
+  OB_DIE_ON_ERROR (pool_net_send_result (net, "ptir", p, ts, idx, pret));
+  protein_free (p);
+  OB_DIE_ON_ERROR (pool_withdraw (ph));
+
+  // Closing with something unread would get the writer ECONNRESET;
+  // it's not reading any more that gets it EPIPE (and SIGPIPE).
+  // Then hold on until the writer has noticed.
+  char some[FIRST_PART];
+  OB_DIE_ON_ERROR (net->recv_nbytes (net->connfd, some, sizeof (some),
+                                     no_wakeup));
+  OB_CHECK_POSIX_CODE (0x2032000e, shutdown (net->connfd, SHUT_RD));
+  close (gone_fd);
+  if (read (done_fd, some, 1) != 0)
+    return EXIT_FAILURE;
+  ob_tls_end (net->connfd, false);
+  OB_CHECK_POSIX_CODE (0x20320003, close (net->connfd));
+  return EXIT_SUCCESS;
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  ob_retort pret = ob_tls_server_available ();
+  if (pret < OB_OK)
+    {
+      OB_LOG_INFO_CODE (0x20320004, "no TLS (%s), so nothing to test\n",
+                        ob_error_string (pret));
+      return EXIT_SUCCESS;
+    }
+
+  // The default, so that a stray SIGPIPE kills us
+  struct sigaction act;
+  memset (&act, 0, sizeof (act));
+  act.sa_handler = SIG_DFL;
+  sigaction (SIGPIPE, &act, NULL);
+
+  ob_ignore_retort (pool_dispose (POOL_NAME));
+  protein opts = small_mmap_pool_options ();
+  OB_DIE_ON_ERROR (pool_create (POOL_NAME, "mmap", opts));
+  protein_free (opts);
+
+  pool_net_data a, b;
+  connect_pair (&a, &b);
+  // The server closes one when it hangs up, and we close the other
+  // once we've heard
+  int gone[2], done[2];
+  if (pipe (gone) != 0 || pipe (done) != 0)
+    OB_FATAL_ERROR_CODE (0x2032000f, "pipe failed: %s\n", strerror (errno));
+  fflush (stdout);
+  fflush (stderr);
+  const pid_t pid = fork ();
+  if (pid < 0)
+    OB_FATAL_ERROR_CODE (0x20320005, "fork failed: %s\n", strerror (errno));
+  if (pid == 0)
+    {
+      close (a.connfd);
+      close (gone[0]);
+      close (done[1]);
+      _exit (serve (&b, gone[1], done[0]));
+    }
+  close (b.connfd);
+  close (gone[1]);
+  close (done[0]);
+
+  // STARTTLS, as pool_tcp.c would do it
+  slaw empty_map = slaw_map_f (slabu_new ());
+  OB_DIE_ON_ERROR (pool_net_send_op (&a, POOL_CMD_STARTTLS, "x", empty_map));
+  slaw_free (empty_map);
+  ob_retort remote = OB_UNKNOWN_ERR;
+  slaw ignore_slaw = NULL;
+  OB_DIE_ON_ERROR (pool_net_recv_result (&a, "rx", &remote, &ignore_slaw));
+  slaw_free (ignore_slaw);
+  OB_DIE_ON_ERROR (remote);
+  OB_DIE_ON_ERROR (ob_tls_client_start (a.connfd, NULL, true, NULL, NULL));
+  use_tls (&a);
+
+  protein p =
+    protein_from_ff (slaw_list_inline_c ("over", "tls", NULL),
+                     slaw_map_inline_cf ("rude", slaw_string ("nope"), NULL));
+  OB_DIE_ON_ERROR (pool_net_send_op (&a, POOL_CMD_DEPOSIT, "p", p));
+  int64 idx = -1;
+  pool_timestamp ts = 0;
+  OB_DIE_ON_ERROR (pool_net_recv_result (&a, "irt", &idx, &remote, &ts));
+  OB_DIE_ON_ERROR (remote);
+  if (idx != 0 || ts <= 0)
+    OB_FATAL_ERROR_CODE (0x20320006, "deposited at %" OB_FMT_64 "d, %f\n",
+                         idx, ts);
+
+  OB_DIE_ON_ERROR (pool_net_send_op (&a, POOL_CMD_NEXT, "i", idx));
+  protein q = NULL;
+  pool_timestamp ts2 = 0;
+  int64 idx2 = -1;
+  OB_DIE_ON_ERROR (pool_net_recv_result (&a, "ptir", &q, &ts2, &idx2,
+                                         &remote));
+  OB_DIE_ON_ERROR (remote);
+  if (!proteins_equal (p, q) || idx2 != idx || ts2 != ts)
+    OB_FATAL_ERROR_CODE (0x20320007, "next didn't get what was deposited\n");
+  protein_free (q);
+  protein_free (p);
+
+  // Now the server hangs up on us partway through
+  char *big = (char *) calloc (1, FIRST_PART + REST);
+  if (!big)
+    OB_FATAL_ERROR_CODE (0x20320008, "no memory\n");
+  OB_DIE_ON_ERROR (a.send_nbytes (a.connfd, big, FIRST_PART, no_wakeup));
+  char c;
+  if (read (gone[0], &c, 1) != 0)
+    OB_FATAL_ERROR_CODE (0x20320010, "server didn't hang up\n");
+  ob_suppress_message (OBLV_WARN, 0x20504003);
+  ob_suppress_message (OBLV_WARN, 0x20504004);
+  pret = a.send_nbytes (a.connfd, big + FIRST_PART, REST, no_wakeup);
+  const int erryes = errno;
+  free (big);
+  close (done[1]);
+  if (pret != POOL_UNEXPECTED_CLOSE || erryes != EPIPE)
+    OB_FATAL_ERROR_CODE (0x20320009, "writing to nobody got %s (%s)\n",
+                         ob_error_string (pret), strerror (erryes));
+  sigset_t pending;
+  sigpending (&pending);
+  if (sigismember (&pending, SIGPIPE))
+    OB_FATAL_ERROR_CODE (0x2032000a, "SIGPIPE was left pending\n");
+
+  int status = 0;
+  while (waitpid (pid, &status, 0) < 0)
+    if (errno != EINTR)
+      OB_FATAL_ERROR_CODE (0x2032000c, "waitpid failed: %s\n",
+                           strerror (errno));
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != EXIT_SUCCESS)
+    OB_FATAL_ERROR_CODE (0x2032000d, "server half failed (status %d)\n",
+                         status);
+  ob_tls_end (a.connfd, true);
+  OB_CHECK_POSIX_CODE (0x2032000b, close (a.connfd));
+  OB_DIE_ON_ERROR (pool_dispose (POOL_NAME));
+  return EXIT_SUCCESS;
+}
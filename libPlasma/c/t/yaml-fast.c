@@ -0,0 +1,239 @@
+/* (c)  oblong industries */
+
+// slaw-yaml.c reads the YAML it writes without any help from libyaml,
+// and only falls back on libyaml for everything else.  Check that
+// the fast reader really does read everything we write, with every
+// combination of options, and that whichever way the YAML gets read,
+// it comes out the same.
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-retorts.h"
+#include "libLoam/c/ob-types.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-io.h"
+#include "libPlasma/c/slaw-string.h"
+#include "libPlasma/c/private/plasma-testing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NFLOATS 40
+
+static slaw make_samples (void)
+{
+  float32 fa[NFLOATS];
+  v3float64 vv[5];
+  char longs[300];
+  int i;
+
+  for (i = 0; i < NFLOATS; i++)
+    fa[i] = i * 1.5f;
+  memset (vv, 0, sizeof (vv));
+  vv[2].y = -0.25;
+  memset (longs, 'x', sizeof (longs));
+  for (i = 20; i < 299; i += 7)
+    longs[i] = ' ';
+  longs[299] = 0;
+
+  slaw strings =
+    slaw_list_inline_f (slaw_string (""), slaw_string ("true"),
+                        slaw_string ("  lead"), slaw_string ("trail  "),
+                        slaw_string ("line1\nline2\n"),
+                        slaw_string ("\n lead nl"), slaw_string ("no nl\nend"),
+                        slaw_string ("blank\n\n\nlines\n\n"),
+                        slaw_string ("tab\there"), slaw_string (longs),
+                        slaw_string ("a long string\twith tabs, long enough "
+                                     "that it has to\tgo onto more than "
+                                     "one line,  \t  even in quotes"),
+                        slaw_string ("it's 'quoted' and long enough to wrap "
+                                     "around the seventy column limit, yes"),
+                        slaw_string ("caf\xc3\xa9"), slaw_string ("bad\xff"),
+                        slaw_string ("# hash"), slaw_string ("a: b"),
+                        slaw_string ("x #y"), slaw_string ("- dash"),
+                        slaw_string ("[bracket]"), slaw_string ("{}"),
+                        slaw_string ("~"), slaw_string ("0x10"),
+                        slaw_string ("ctrl\x01"), slaw_string ("..."),
+                        slaw_string ("---"), NULL);
+
+  slaw numbers =
+    slaw_list_inline_f (slaw_nil (), slaw_boolean (true),
+                        slaw_boolean (false), slaw_int8 (-5), slaw_unt8 (200),
+                        slaw_int16 (999), slaw_unt32 (1000),
+                        slaw_int64 (-1234567890123LL), slaw_unt64 (~0ULL),
+                        slaw_float32 (0.5f), slaw_float64 (1e300),
+                        slaw_float64 (3.0), slaw_float64 (-0.0),
+                        slaw_v2float64 ((v2float64){1, 2}),
+                        slaw_v3int32 ((v3int32){-1, 0, 1}),
+                        slaw_float32_array (fa, NFLOATS),
+                        slaw_float32_array (fa, 0),
+                        slaw_v3float64_array (vv, 5),
+                        slaw_v3float64_array (vv, 0), NULL);
+
+  slaw containers =
+    slaw_list_inline_f (slaw_list_inline_f (slaw_list_inline_c ("a", "b",
+                                                                NULL),
+                                            slaw_list_empty (),
+                                            slaw_map_empty (), NULL),
+                        slaw_list_inline_f (slaw_list_inline_f (
+                                              slaw_list_inline_c ("deep",
+                                                                  NULL),
+                                              NULL),
+                                            NULL),
+                        slaw_map_inline_ff (slaw_int32 (5),
+                                            slaw_string ("five"),
+                                            slaw_list_inline_c ("k", NULL),
+                                            slaw_nil (), NULL),
+                        slaw_map_inline_cf ("list",
+                                            slaw_list_inline_c ("x", "y",
+                                                                NULL),
+                                            "map",
+                                            slaw_map_inline_cc ("k", "v",
+                                                                NULL),
+                                            "empty", slaw_string (""), NULL),
+                        slaw_cons_ff (slaw_string ("car"),
+                                      slaw_list_inline_c ("x", NULL)),
+                        NULL);
+
+  slaw proteins =
+    slaw_list_inline_f (protein_from_ffr (slaw_list_inline_c ("d", NULL),
+                                          slaw_map_inline_cc ("k", "v", NULL),
+                                          "rudedata", 8),
+                        protein_from_ff (NULL, NULL),
+                        protein_from_ff (slaw_list_inline_c ("only", NULL),
+                                         NULL),
+                        NULL);
+
+  return slaw_list_inline_f (strings, numbers, containers, proteins,
+                             slaw_string ("root str"),
+                             slaw_string ("root\nlit\n"), slaw_string (""),
+                             slaw_list_empty (), slaw_int32 (42), NULL);
+}
+
+// Reads every slaw in f, and returns them in a list
+static slaw read_all (FILE *f, bool fast)
+{
+  slaw_input in;
+  slaw s;
+  ob_retort tort;
+  slabu *sb = slabu_new ();
+
+  rewind (f);
+  private_set_yaml_fast_path (fast);
+  OB_DIE_ON_ERROR (slaw_input_open_text_z (f, &in));
+  while ((tort = slaw_input_read (in, &s)) == OB_OK)
+    OB_DIE_ON_ERROR (slabu_list_add_x (sb, s));
+  if (tort != SLAW_END_OF_FILE)
+    OB_FATAL_ERROR_CODE (0x2031f000, "expected SLAW_END_OF_FILE but got %s\n",
+                         ob_error_string (tort));
+  OB_DIE_ON_ERROR (slaw_input_close (in));
+  private_set_yaml_fast_path (true);
+  return slaw_list_f (sb);
+}
+
+static void check_options (bslaw samples, int i)
+{
+  const bool tag_numbers = (1 & i);
+  const bool directives = (1 & (i >> 1));
+  const bool ordered_maps = (1 & (i >> 2));
+  slaw_output out;
+  int64 n;
+
+  slaw o = slaw_map_inline_cf ("tag_numbers", slaw_boolean (tag_numbers),
+                               "directives", slaw_boolean (directives),
+                               "ordered_maps", slaw_boolean (ordered_maps),
+                               NULL);
+  FILE *f = tmpfile ();
+  if (!f)
+    OB_FATAL_ERROR_CODE (0x2031f001, "tmpfile() failed\n");
+  OB_DIE_ON_ERROR (slaw_output_open_text_options_z (f, &out, o));
+  for (n = 0; n < slaw_list_count (samples); n++)
+    OB_DIE_ON_ERROR (slaw_output_write (out, slaw_list_emit_nth (samples, n)));
+  OB_DIE_ON_ERROR (slaw_output_close (out));
+  slaw_free (o);
+
+  const int64 before = private_yaml_fallback_count ();
+  slaw fast = read_all (f, true);
+  if (private_yaml_fallback_count () != before)
+    OB_FATAL_ERROR_CODE (0x2031f002, "%d: fell back on libyaml for our own "
+                                     "YAML\n",
+                         i);
+  slaw slow = read_all (f, false);
+  fclose (f);
+
+  if (slaw_list_count (fast) != slaw_list_count (samples))
+    OB_FATAL_ERROR_CODE (0x2031f003, "%d: read %" OB_FMT_64 "d slawx, not "
+                                     "%" OB_FMT_64 "d\n",
+                         i, slaw_list_count (fast), slaw_list_count (samples));
+  if (!slawx_equal (fast, slow))
+    OB_FATAL_ERROR_CODE (0x2031f004, "%d: fast and libyaml disagree\n", i);
+  if (tag_numbers && ordered_maps && !slawx_equal (fast, samples))
+    OB_FATAL_ERROR_CODE (0x2031f005, "%d: didn't read what we wrote\n", i);
+  slaw_free (fast);
+  slaw_free (slow);
+}
+
+// Reads str both ways, and checks they agree, and whether the fast
+// reader had to fall back on libyaml
+static void check_string (const char *str, bool expect_fallback)
+{
+  slaw fast = NULL, slow = NULL;
+
+  const int64 before = private_yaml_fallback_count ();
+  private_set_yaml_fast_path (true);
+  ob_retort fast_tort = slaw_from_string (str, &fast);
+  const bool fell_back = (private_yaml_fallback_count () != before);
+  private_set_yaml_fast_path (false);
+  ob_retort slow_tort = slaw_from_string (str, &slow);
+  private_set_yaml_fast_path (true);
+
+  if (fell_back != expect_fallback)
+    OB_FATAL_ERROR_CODE (0x2031f006, "expected %sto fall back for:\n%s\n",
+                         expect_fallback ? "" : "not ", str);
+  if (fast_tort != slow_tort)
+    OB_FATAL_ERROR_CODE (0x2031f007, "got %s, but libyaml got %s for:\n%s\n",
+                         ob_error_string (fast_tort),
+                         ob_error_string (slow_tort), str);
+  if (!slawx_equal (fast, slow))
+    OB_FATAL_ERROR_CODE (0x2031f008, "fast and libyaml disagree about:\n%s\n",
+                         str);
+  slaw_free (fast);
+  slaw_free (slow);
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  slaw samples = make_samples ();
+  int i;
+  for (i = 0; i < 8; i++)
+    check_options (samples, i);
+  slaw_free (samples);
+
+  // hand-written, but still things we can read
+  check_string ("# comment\n%YAML 1.1\n--- # more\n\n- a   # after\n\n"
+                "-   b\n-\n  c\n- 'multi\n  line\n\n  quote'\n...\n",
+                false);
+  check_string ("plain\n  over\n\n  lines\n", false);
+  check_string ("%TAG ! tag:oblong.com,2009:slaw/\n---\nkey:\n- indentless\n"
+                "- seq\nother: !i8 -3\n",
+                false);
+  check_string ("? - complex\n  - key\n: value\n? lonely\n", false);
+  check_string ("--- !<tag:oblong.com,2009:slaw/i16> 7\n", false);
+  check_string ("--- |+\n  keep\n\n\n...\n", false);
+  check_string ("--- [a, [b, c], {}, \"d\\te\", 'f''g', ]\n", false);
+  check_string ("\"multi  \n line\n\n  esc\\\n  aped  \\\n  \\ x\"\n", false);
+
+  // and things we leave to libyaml
+  check_string ("{a: 1, b: [2, 3]}\n", true);
+  check_string ("- &x anchored\n- *x\n", true);
+  check_string ("--- >\n  folded\n  text\n", true);
+  check_string ("a:\tb\n", true);
+  check_string ("%TAG !e! tag:example.com,2000:\n--- !e!thing x\n", true);
+  check_string ("- [unterminated\n", true);
+
+  return EXIT_SUCCESS;
+}
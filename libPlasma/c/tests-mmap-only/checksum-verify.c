@@ -0,0 +1,180 @@
+
+/* (c)  oblong industries */
+
+// Checksummed pools, with each checksum algorithm: proteins (some
+// big enough to be checksummed several streams at a time, some
+// deposited in batches) read back fine, until we scribble on one.
+// Then reading it fails with POOL_CORRUPT, or doesn't, according to
+// the "checksum-verify" option.
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-util.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+
+// Below necessary because we muck around inside the pool hose
+#include "libPlasma/c/private/pool_impl.h"
+#include "libPlasma/c/private/pool_mmap.h"
+
+#include <stdlib.h>
+
+#define HOW_MANY 20
+#define VICTIM 3
+#define SAMPLE 4
+#define POOL_BYTES (1024 * 1024)
+
+static void usage (void)
+{
+  ob_banner (stderr);
+  fprintf (stderr, "Usage: %s <pool_name>\n", ob_get_prog_name ());
+  exit (EXIT_FAILURE);
+}
+
+static protein make_protein (int64 n)
+{
+  // Every fifth one is big
+  char *buf = (char *) malloc (50000);
+  const size_t len = (n % 5 ? 100 : 49000);
+  memset (buf, 'x', len);
+  snprintf (buf, len, "payload %03" OB_FMT_64 "d", n);
+  buf[strlen (buf)] = ' ';
+  buf[len] = 0;
+  protein p =
+    protein_from_ff (slaw_list_inline_c ("checksum", NULL),
+                     slaw_map_inline_cf ("n", slaw_int64 (n), "pad",
+                                         slaw_string (buf), NULL));
+  free (buf);
+  return p;
+}
+
+static void set_option (pool_hose h, const char *key, slaw value)
+{
+  protein opts = protein_from_ff (NULL, slaw_map_inline_cf (key, value, NULL));
+  OB_DIE_ON_ERROR (pool_change_options (h, opts));
+  protein_free (opts);
+}
+
+static void check_info (pool_hose h, const char *algorithm,
+                        const char *verify, int64 sample)
+{
+  protein info = NULL;
+  OB_DIE_ON_ERROR (pool_get_info (h, 0, &info));
+  bslaw ing = protein_ingests (info);
+  const char *a = slaw_path_get_string (ing, "checksum-algorithm", "");
+  const char *v = slaw_path_get_string (ing, "checksum-verify", "");
+  const int64 s = slaw_path_get_int64 (ing, "checksum-sample", -1);
+  if (strcmp (a, algorithm) || strcmp (v, verify) || s != sample)
+    OB_FATAL_ERROR ("expected %s/%s/%" OB_FMT_64 "d but got %s/%s/%" OB_FMT_64
+                    "d\n",
+                    algorithm, verify, sample, a, v, s);
+  protein_free (info);
+}
+
+/// Reads the victim on a fresh hose \a times times, and returns how
+/// many of those found it corrupt.
+
+static int64 count_corrupt (const char *pname, int64 times)
+{
+  pool_hose h = NULL;
+  OB_DIE_ON_ERROR (pool_participate (pname, &h, NULL));
+  int64 i, bad = 0;
+  for (i = 0; i < times; i++)
+    {
+      protein p = NULL;
+      ob_retort tort = pool_nth_protein (h, VICTIM, &p, NULL);
+      if (tort == POOL_CORRUPT)
+        bad++;
+      else
+        {
+          OB_DIE_ON_ERROR (tort);
+          protein_free (p);
+        }
+    }
+  OB_DIE_ON_ERROR (pool_withdraw (h));
+  return bad;
+}
+
+static void test_algorithm (const char *pname, const char *algorithm)
+{
+  protein opts =
+    protein_from_ff (NULL,
+                     slaw_map_inline_cf ("size", slaw_unt64 (POOL_BYTES),
+                                         "checksum", slaw_boolean (true),
+                                         "checksum-algorithm",
+                                         slaw_string (algorithm), NULL));
+  OB_DIE_ON_ERROR (pool_create (pname, "mmap", opts));
+  protein_free (opts);
+
+  pool_hose h = NULL;
+  OB_DIE_ON_ERROR (pool_participate (pname, &h, NULL));
+  pool_mmap_data *d = pool_mmap_get_data (h);
+  if (!d->csum_chunk)
+    OB_FATAL_ERROR ("no csum chunk in the header\n");
+  check_info (h, algorithm, "always", POOL_VERIFY_SAMPLE_DEFAULT);
+
+  // Half one at a time, half in a batch
+  protein ps[HOW_MANY];
+  int64 i;
+  for (i = 0; i < HOW_MANY; i++)
+    ps[i] = make_protein (i);
+  for (i = 0; i < HOW_MANY / 2; i++)
+    OB_DIE_ON_ERROR (pool_deposit (h, ps[i], NULL));
+  OB_DIE_ON_ERROR (pool_deposit_batch (h, (const bprotein *) ps + i,
+                                       HOW_MANY - i, NULL));
+  for (i = 0; i < HOW_MANY; i++)
+    {
+      protein p = NULL;
+      OB_DIE_ON_ERROR (pool_nth_protein (h, i, &p, NULL));
+      if (!proteins_equal (p, ps[i]))
+        OB_FATAL_ERROR ("%s: protein %" OB_FMT_64 "d is mangled\n", algorithm,
+                        i);
+      protein_free (p);
+      protein_free (ps[i]);
+    }
+
+  // Scribble on the victim
+  char needle[32];
+  snprintf (needle, sizeof (needle), "payload %03d", VICTIM);
+  const size_t nlen = strlen (needle);
+  byte *hit = NULL;
+  byte *b;
+  for (b = d->mem; !hit && b + nlen <= d->mem + d->mapped_size; b++)
+    if (0 == memcmp (b, needle, nlen))
+      hit = b;
+  if (!hit)
+    OB_FATAL_ERROR ("%s: couldn't find protein %d\n", algorithm, VICTIM);
+  hit[0] = 'P';
+
+  if (count_corrupt (pname, 1) != 1)
+    OB_FATAL_ERROR ("%s: didn't notice protein %d is corrupt\n", algorithm,
+                    VICTIM);
+  set_option (h, "checksum-verify", slaw_string ("never"));
+  check_info (h, algorithm, "never", POOL_VERIFY_SAMPLE_DEFAULT);
+  if (count_corrupt (pname, 1) != 0)
+    OB_FATAL_ERROR ("%s: verified with checksum-verify never\n", algorithm);
+  set_option (h, "checksum-verify", slaw_string ("sampled"));
+  set_option (h, "checksum-sample", slaw_int64 (SAMPLE));
+  check_info (h, algorithm, "sampled", SAMPLE);
+  const int64 bad = count_corrupt (pname, 2 * SAMPLE);
+  if (bad != 2)
+    OB_FATAL_ERROR ("%s: %" OB_FMT_64 "d of %d sampled reads were corrupt\n",
+                    algorithm, bad, 2 * SAMPLE);
+
+  OB_DIE_ON_ERROR (pool_withdraw (h));
+  OB_DIE_ON_ERROR (pool_dispose (pname));
+}
+
+int main (int argc, char **argv)
+{
+  OB_CHECK_ABI ();
+
+  if (argc != 2)
+    usage ();
+
+  test_algorithm (argv[1], "crc32c");
+  test_algorithm (argv[1], "city");
+  return EXIT_SUCCESS;
+}
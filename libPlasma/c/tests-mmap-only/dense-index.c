@@ -0,0 +1,199 @@
+
+/* (c)  oblong industries */
+
+// Pools with a "dense-index": deposit enough variously-sized proteins
+// to wrap around several times, then read them back by index in a
+// scrambled order, and look them up by time, before and after
+// resizing the pool, with the dense index big enough for the whole
+// pool and with one too small to remember everything (so some
+// lookups have to fall back to searching).
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-rand.h"
+#include "libLoam/c/ob-util.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+
+// Below necessary because we muck around inside the pool hose
+#include "libPlasma/c/private/pool_impl.h"
+#include "libPlasma/c/private/pool_mmap.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define HOW_MANY 3000
+#define SMALL_CAPACITY 50
+#define POOL_BYTES (128 * 1024)
+
+static void usage (void)
+{
+  ob_banner (stderr);
+  fprintf (stderr, "Usage: %s <pool_name>\n", ob_get_prog_name ());
+  exit (EXIT_FAILURE);
+}
+
+static protein make_protein (int64 n)
+{
+  char buf[300];
+  const size_t len = (n * 53) % (sizeof (buf) - 1);
+  memset (buf, 'd', len);
+  buf[len] = 0;
+  return protein_from_ff (slaw_list_inline_c ("dense", NULL),
+                          slaw_map_inline_cf ("n", slaw_int64 (n), "pad",
+                                              slaw_string (buf), NULL));
+}
+
+/// Reads every protein still in the pool, in a scrambled order, and
+/// makes sure the ones before it are gone.
+
+static void read_scrambled (pool_hose h, const char *when)
+{
+  int64 oldest, newest;
+  OB_DIE_ON_ERROR (pool_oldest_index (h, &oldest));
+  OB_DIE_ON_ERROR (pool_newest_index (h, &newest));
+  const int64 count = newest - oldest + 1;
+  ob_rand_t *r = ob_rand_allocate_state (17);
+  int64 i;
+  for (i = 0; i < 2 * count; i++)
+    {
+      const int64 idx = oldest + ob_rand_state_int32 (0, count, r);
+      protein p = NULL;
+      int64 got_idx = -1;
+      OB_DIE_ON_ERROR (pool_nth_protein (h, idx, &p, NULL));
+      const int64 n = slaw_path_get_int64 (protein_ingests (p), "n", -1);
+      if (n != idx)
+        OB_FATAL_ERROR ("%s: protein %" OB_FMT_64 "d is %" OB_FMT_64 "d\n",
+                        when, idx, n);
+      protein_free (p);
+      OB_DIE_ON_ERROR (pool_seekto (h, idx));
+      OB_DIE_ON_ERROR (pool_next (h, &p, NULL, &got_idx));
+      if (got_idx != idx)
+        OB_FATAL_ERROR ("%s: seeking to %" OB_FMT_64 "d got %" OB_FMT_64
+                        "d\n",
+                        when, idx, got_idx);
+      protein_free (p);
+    }
+  ob_rand_free_state (r);
+  protein p = NULL;
+  if (oldest > 0
+      && pool_nth_protein (h, oldest - 1, &p, NULL) != POOL_NO_SUCH_PROTEIN)
+    OB_FATAL_ERROR ("%s: protein %" OB_FMT_64 "d should be gone\n", when,
+                    oldest - 1);
+}
+
+static pool_timestamp stamps[HOW_MANY];
+
+/// The best any lookup of \a t could do, according to stamps.
+
+static pool_timestamp best_stamp (int64 oldest, int64 newest, pool_timestamp t,
+                                  time_comparison bound)
+{
+  pool_timestamp best = OB_NAN;
+  int64 i;
+  for (i = oldest; i <= newest; i++)
+    {
+      const pool_timestamp s = stamps[i];
+      if ((bound == OB_CLOSEST_LOWER && s > t)
+          || (bound == OB_CLOSEST_HIGHER && s < t))
+        continue;
+      if (best != best || fabs (s - t) < fabs (best - t))
+        best = s;
+    }
+  return best;
+}
+
+/// Seeks to times at, and in between, the times of proteins chosen
+/// at random, and checks that we land on one as close as possible.
+
+static void check_times (pool_hose h, const char *when)
+{
+  static const time_comparison bounds[] = {OB_CLOSEST, OB_CLOSEST_LOWER,
+                                           OB_CLOSEST_HIGHER};
+  int64 oldest, newest;
+  OB_DIE_ON_ERROR (pool_oldest_index (h, &oldest));
+  OB_DIE_ON_ERROR (pool_newest_index (h, &newest));
+  ob_rand_t *r = ob_rand_allocate_state (23);
+  int64 i;
+  for (i = 0; i < 300; i++)
+    {
+      const int64 k = oldest + ob_rand_state_int32 (0, newest - oldest, r);
+      const pool_timestamp t =
+        (i % 2 ? stamps[k] : (stamps[k] + stamps[k + 1]) / 2);
+      const time_comparison bound = bounds[i % 3];
+      int64 got = -1;
+      OB_DIE_ON_ERROR (pool_seekto_time (h, t, bound));
+      OB_DIE_ON_ERROR (pool_index (h, &got));
+      if (got < oldest || got > newest
+          || stamps[got] != best_stamp (oldest, newest, t, bound))
+        OB_FATAL_ERROR ("%s: seeking to time %f (bound %d) got index %" OB_FMT_64
+                        "d\n",
+                        when, t, bound, got);
+    }
+  ob_rand_free_state (r);
+}
+
+static void test_capacity (const char *pname, slaw dense)
+{
+  const bool small = slaw_is_numeric_int (dense);
+  protein opts =
+    protein_from_ff (NULL,
+                     slaw_map_inline_cf ("size", slaw_unt64 (POOL_BYTES),
+                                         "dense-index", dense, NULL));
+  OB_DIE_ON_ERROR (pool_create (pname, "mmap", opts));
+  protein_free (opts);
+
+  pool_hose h = NULL;
+  OB_DIE_ON_ERROR (pool_participate (pname, &h, NULL));
+  pool_chunk_dnse *dh = pool_mmap_get_data (h)->dnse_chunk;
+  if (!dh)
+    OB_FATAL_ERROR ("no dense index in the header\n");
+  protein info = NULL;
+  OB_DIE_ON_ERROR (pool_get_info (h, 0, &info));
+  const int64 cap =
+    slaw_path_get_int64 (protein_ingests (info), "dense-index-capacity", -1);
+  protein_free (info);
+  if (cap != dh->capacity || (small && cap != SMALL_CAPACITY)
+      || (!small && cap < POOL_BYTES / 64))
+    OB_FATAL_ERROR ("capacity is %" OB_FMT_64 "d\n", cap);
+
+  int64 i;
+  for (i = 0; i < HOW_MANY; i++)
+    {
+      protein p = make_protein (i);
+      OB_DIE_ON_ERROR (pool_deposit_ex (h, p, NULL, &stamps[i]));
+      protein_free (p);
+    }
+  int64 oldest;
+  OB_DIE_ON_ERROR (pool_oldest_index (h, &oldest));
+  if (oldest == 0)
+    OB_FATAL_ERROR ("pool never wrapped around\n");
+  read_scrambled (h, "before resize");
+  check_times (h, "before resize");
+
+  protein bigger =
+    protein_from_ff (NULL, slaw_map_inline_cf ("size",
+                                               slaw_unt64 (2 * POOL_BYTES),
+                                               NULL));
+  OB_DIE_ON_ERROR (pool_change_options (h, bigger));
+  protein_free (bigger);
+  read_scrambled (h, "after resize");
+  check_times (h, "after resize");
+
+  OB_DIE_ON_ERROR (pool_withdraw (h));
+  OB_DIE_ON_ERROR (pool_dispose (pname));
+}
+
+int main (int argc, char **argv)
+{
+  OB_CHECK_ABI ();
+
+  if (argc != 2)
+    usage ();
+
+  test_capacity (argv[1], slaw_boolean (true));
+  test_capacity (argv[1], slaw_int64 (SMALL_CAPACITY));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,20 @@
+#!/bin/bash
+
+# Test index lookups in dense-index pools
+
+PATH=${PATH}:..:.
+
+# Handle internal valgrind
+IV=""
+if [ "$#" == "2" ]; then
+    if [ "$1" == "--internal-valgrind" ]; then
+        IV=$2
+    fi
+fi
+
+TEST_POOL=${TEST_POOL}-$(basename $0)
+
+$IV \
+dense-index "${TEST_POOL}"
+
+exit $?
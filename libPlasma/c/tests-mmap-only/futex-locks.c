@@ -0,0 +1,271 @@
+
+/* (c)  oblong industries */
+
+// Create a pool with the "futex" option, and make sure that deposits,
+// awaits and reads still work after a process dies while holding the
+// deposit lock, and again after one dies holding the notification
+// lock.  Then make sure that awaiting works, both on a single hose (which
+// sleeps on the futex directly) and in a gang (which goes through the
+// eventfd), with the deposits coming from another process.
+// Finally, race deposits against hoses just starting to await through
+// the eventfd, to make sure none of those deposits go unnoticed.
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-time.h"
+#include "libLoam/c/ob-util.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+
+// Below necessary because we muck around inside the pool hose
+#include "libPlasma/c/private/pool_impl.h"
+#include "libPlasma/c/private/pool_mmap.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void usage (void)
+{
+  ob_banner (stderr);
+  fprintf (stderr, "Usage: %s <pool_name>\n", ob_get_prog_name ());
+  exit (EXIT_FAILURE);
+}
+
+static void deposit_one (pool_hose h, int64 n)
+{
+  protein p = protein_from_ff (slaw_list_inline_c ("futex", NULL),
+                               slaw_map_inline_cf ("n", slaw_int64 (n), NULL));
+  int64 idx = -1;
+  OB_DIE_ON_ERROR (pool_deposit (h, p, &idx));
+  if (idx != n)
+    OB_FATAL_ERROR ("expected index %" OB_FMT_64 "d but got %" OB_FMT_64 "d\n",
+                    n, idx);
+  protein_free (p);
+}
+
+static void reap (pid_t kid, const char *what)
+{
+  int status;
+  if (waitpid (kid, &status, 0) < 0)
+    OB_FATAL_ERROR ("waitpid: %s\n", strerror (errno));
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != EXIT_SUCCESS)
+    OB_FATAL_ERROR ("child failed to %s\n", what);
+}
+
+/// Forks a child which waits a bit, and then deposits index n.
+
+static pid_t deposit_later (const char *pname, int64 n)
+{
+  pid_t kid = fork ();
+  if (kid < 0)
+    OB_FATAL_ERROR ("fork: %s\n", strerror (errno));
+  if (kid == 0)
+    {
+      pool_hose kh = NULL;
+      OB_DIE_ON_ERROR (pool_participate (pname, &kh, NULL));
+      usleep (200000);
+      deposit_one (kh, n);
+      OB_DIE_ON_ERROR (pool_withdraw (kh));
+      _exit (EXIT_SUCCESS);
+    }
+  return kid;
+}
+
+static void check_index (protein p, int64 n)
+{
+  if (slaw_path_get_int64 (protein_ingests (p), "n", -1) != n)
+    OB_FATAL_ERROR ("expected protein %" OB_FMT_64 "d\n", n);
+}
+
+/// Forks a child which takes the lock with index idx and exits
+/// without letting go of it.
+
+static void die_holding (const char *pname, int idx)
+{
+  pid_t kid = fork ();
+  if (kid < 0)
+    OB_FATAL_ERROR ("fork: %s\n", strerror (errno));
+  if (kid == 0)
+    {
+      pool_hose kh = NULL;
+      OB_DIE_ON_ERROR (pool_participate (pname, &kh, NULL));
+      pool_mmap_data *d = pool_mmap_get_data (kh);
+      pthread_mutex_t *m = (pthread_mutex_t *) d->lock_chunk->locks[idx];
+      if (pthread_mutex_lock (m) != 0)
+        _exit (EXIT_FAILURE);
+      _exit (EXIT_SUCCESS);
+    }
+  reap (kid, "take the lock");
+}
+
+/// Once someone has died holding the lock with index idx, a deposit
+/// from another process should still wake our await, our own deposit
+/// should go through, and everything deposited so far should still be
+/// readable.  These would hang forever if the lock weren't recovered.
+/// Deposits indices n and n + 1.
+
+static void survive_dead_owner (pool_hose h, const char *pname, int idx,
+                                int64 n)
+{
+  die_holding (pname, idx);
+
+  OB_DIE_ON_ERROR (pool_seekto (h, n));
+  pid_t kid = deposit_later (pname, n);
+  protein p = NULL;
+  OB_DIE_ON_ERROR (pool_await_next (h, 10, &p, NULL, NULL));
+  check_index (p, n);
+  protein_free (p);
+  reap (kid, "deposit");
+
+  deposit_one (h, n + 1);
+
+  int64 i;
+  for (i = 0; i <= n + 1; i++)
+    {
+      OB_DIE_ON_ERROR (pool_nth_protein (h, i, &p, NULL));
+      check_index (p, i);
+      protein_free (p);
+    }
+}
+
+#define RACE_ROUNDS 200
+
+typedef struct
+{
+  const char *pname;
+  int64 first;
+  pthread_barrier_t go;
+} racer_info;
+
+/// Deposits one protein per round, as soon as the awaiter is released.
+
+static void *racing_depositor (void *arg)
+{
+  racer_info *ri = (racer_info *) arg;
+  pool_hose dh = NULL;
+  OB_DIE_ON_ERROR (pool_participate (ri->pname, &dh, NULL));
+  int i;
+  for (i = 0; i < RACE_ROUNDS; i++)
+    {
+      pthread_barrier_wait (&ri->go);
+      // Vary the delay from round to round, so as to land in the
+      // window at least some of the time
+      const unt64 until = ob_monotonic_time () + (i % 40) * 2500;
+      while (ob_monotonic_time () < until)
+        ;
+      deposit_one (dh, ri->first + i);
+    }
+  OB_DIE_ON_ERROR (pool_withdraw (dh));
+  return NULL;
+}
+
+/// Each round, a fresh hose (so a fresh eventfd thread) awaits the
+/// next index while another thread deposits it.  A deposit which lands
+/// before the eventfd thread gets going must still wake the awaiter,
+/// rather than leaving it asleep until the timeout.
+
+static void race_bridge_startup (const char *pname, int64 first)
+{
+  racer_info ri;
+  ri.pname = pname;
+  ri.first = first;
+  pthread_barrier_init (&ri.go, NULL, 2);
+  pthread_t thr;
+  if (pthread_create (&thr, NULL, racing_depositor, &ri) != 0)
+    OB_FATAL_ERROR ("couldn't start depositor\n");
+
+  int i;
+  for (i = 0; i < RACE_ROUNDS; i++)
+    {
+      pool_hose ah = NULL;
+      OB_DIE_ON_ERROR (pool_participate (pname, &ah, NULL));
+      OB_DIE_ON_ERROR (pool_hose_enable_wakeup (ah));
+      OB_DIE_ON_ERROR (pool_seekto (ah, first + i));
+      pthread_barrier_wait (&ri.go);
+      protein p = NULL;
+      ob_retort tort = pool_await_next (ah, 5, &p, NULL, NULL);
+      if (tort != OB_OK)
+        OB_FATAL_ERROR ("round %d: await got %s\n", i, ob_error_string (tort));
+      check_index (p, first + i);
+      protein_free (p);
+      OB_DIE_ON_ERROR (pool_withdraw (ah));
+    }
+
+  pthread_join (thr, NULL);
+  pthread_barrier_destroy (&ri.go);
+}
+
+int main (int argc, char **argv)
+{
+  OB_CHECK_ABI ();
+
+  if (argc != 2)
+    usage ();
+  const char *pname = argv[1];
+
+  protein opts =
+    protein_from_ff (NULL, slaw_map_inline_cf ("size", slaw_unt64 (1048576),
+                                               "futex", slaw_boolean (true),
+                                               NULL));
+  OB_DIE_ON_ERROR (pool_create (pname, "mmap", opts));
+  protein_free (opts);
+
+  pool_hose h = NULL;
+  OB_DIE_ON_ERROR (pool_participate (pname, &h, NULL));
+  if (!pool_mmap_get_data (h)->lock_chunk)
+    OB_FATAL_ERROR ("pool doesn't have futex locks\n");
+
+  deposit_one (h, 0);
+  survive_dead_owner (h, pname, POOL_SEM_DEPOSIT_LOCK_IDX, 1);
+  survive_dead_owner (h, pname, POOL_SEM_NOTIFICATION_LOCK_IDX, 3);
+
+  // Nothing new yet, so this should time out
+  OB_DIE_ON_ERROR (pool_seekto (h, 5));
+  protein p = NULL;
+  ob_retort tort = pool_await_next (h, 0.1, &p, NULL, NULL);
+  if (tort != POOL_AWAIT_TIMEDOUT)
+    OB_FATAL_ERROR ("expected timeout, got %s\n", ob_error_string (tort));
+  tort = pool_await_next (h, POOL_NO_WAIT, &p, NULL, NULL);
+  if (tort != POOL_AWAIT_TIMEDOUT)
+    OB_FATAL_ERROR ("expected timeout, got %s\n", ob_error_string (tort));
+
+  // Single-hose await
+  pid_t kid = deposit_later (pname, 5);
+  OB_DIE_ON_ERROR (pool_await_next (h, 10, &p, NULL, NULL));
+  check_index (p, 5);
+  protein_free (p);
+  reap (kid, "deposit");
+
+  // Gang await
+  pool_gang gang = NULL;
+  OB_DIE_ON_ERROR (pool_new_gang (&gang));
+  OB_DIE_ON_ERROR (pool_join_gang (gang, h));
+  kid = deposit_later (pname, 6);
+  pool_hose which = NULL;
+  OB_DIE_ON_ERROR (pool_await_next_multi (gang, 10, &which, &p, NULL, NULL));
+  if (which != h)
+    OB_FATAL_ERROR ("gang returned the wrong hose\n");
+  check_index (p, 6);
+  protein_free (p);
+  reap (kid, "deposit");
+
+  // And once more, now that the gang has its eventfd set up
+  kid = deposit_later (pname, 7);
+  OB_DIE_ON_ERROR (pool_await_next_multi (gang, 10, &which, &p, NULL, NULL));
+  check_index (p, 7);
+  protein_free (p);
+  reap (kid, "deposit");
+
+  OB_DIE_ON_ERROR (pool_leave_gang (gang, h));
+  OB_DIE_ON_ERROR (pool_disband_gang (gang, false));
+
+  race_bridge_startup (pname, 8);
+
+  OB_DIE_ON_ERROR (pool_withdraw (h));
+  OB_DIE_ON_ERROR (pool_dispose (pname));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,189 @@
+
+/* (c)  oblong industries */
+
+// Several processes deposit into a "sync" pool with "group-commit"
+// turned on, some one at a time and some in batches.  Every deposit
+// should get its own index, in order for each depositor, and by the
+// time the deposits return everything they wrote should have been
+// synced.  Also checks that the commit options can be changed, but
+// group-commit itself can't be.
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-util.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+
+// Below necessary because we muck around inside the pool hose
+#include "libPlasma/c/private/pool_impl.h"
+#include "libPlasma/c/private/pool_mmap.h"
+
+#include <stdlib.h>
+#include <sys/wait.h>
+
+#define NUM_DEPOSITORS 4
+#define DEPOSITS_EACH 200
+#define BATCH 5
+#define POOL_BYTES (1024 * 1024)
+
+static void usage (void)
+{
+  ob_banner (stderr);
+  fprintf (stderr, "Usage: %s <pool_name>\n", ob_get_prog_name ());
+  exit (EXIT_FAILURE);
+}
+
+static protein make_protein (int64 who, int64 n)
+{
+  return protein_from_ff (slaw_list_inline_c ("group-commit", NULL),
+                          slaw_map_inline_cf ("who", slaw_int64 (who), "n",
+                                              slaw_int64 (n), NULL));
+}
+
+/// Even-numbered depositors deposit one at a time, odd-numbered ones
+/// BATCH at a time.
+
+static void deposit_lots (const char *pname, int64 who)
+{
+  pool_hose h = NULL;
+  OB_DIE_ON_ERROR (pool_participate (pname, &h, NULL));
+  pool_chunk_cmit *cm = pool_mmap_get_data (h)->cmit_chunk;
+  int64 n;
+  for (n = 0; n < DEPOSITS_EACH; n += BATCH)
+    {
+      protein ps[BATCH];
+      int64 idxs[BATCH];
+      int64 i;
+      for (i = 0; i < BATCH; i++)
+        ps[i] = make_protein (who, n + i);
+      if (who % 2)
+        OB_DIE_ON_ERROR (pool_deposit_batch (h, (const bprotein *) ps, BATCH,
+                                             idxs));
+      else
+        for (i = 0; i < BATCH; i++)
+          OB_DIE_ON_ERROR (pool_deposit (h, ps[i], NULL));
+      for (i = 0; i < BATCH; i++)
+        protein_free (ps[i]);
+      // Whatever we wrote has been synced by now
+      if (cm->synced_end <= 0)
+        OB_FATAL_ERROR ("depositor %" OB_FMT_64 "d returned before any "
+                        "sync\n",
+                        who);
+    }
+  OB_DIE_ON_ERROR (pool_withdraw (h));
+}
+
+static void check_options (pool_hose h, float64 latency, int64 batch,
+                           bool group)
+{
+  protein info = NULL;
+  OB_DIE_ON_ERROR (pool_get_info (h, 0, &info));
+  bslaw ing = protein_ingests (info);
+  const float64 l = slaw_path_get_float64 (ing, "commit-latency", -1);
+  const int64 b = slaw_path_get_int64 (ing, "commit-batch", -1);
+  const bool g = slaw_path_get_bool (ing, "group-commit", false);
+  if (l != latency || b != batch || g != group)
+    OB_FATAL_ERROR ("expected %f, %" OB_FMT_64 "d, %d but got %f, %" OB_FMT_64
+                    "d, %d\n",
+                    latency, batch, group, l, b, g);
+  protein_free (info);
+}
+
+int main (int argc, char **argv)
+{
+  OB_CHECK_ABI ();
+
+  if (argc != 2)
+    usage ();
+  const char *pname = argv[1];
+
+  protein opts =
+    protein_from_ff (NULL,
+                     slaw_map_inline_cf ("size", slaw_unt64 (POOL_BYTES),
+                                         "sync", slaw_boolean (true),
+                                         "group-commit", slaw_boolean (true),
+                                         "commit-latency", slaw_float64 (0.002),
+                                         "commit-batch", slaw_int64 (8),
+                                         NULL));
+  OB_DIE_ON_ERROR (pool_create (pname, "mmap", opts));
+  protein_free (opts);
+
+  pool_hose h = NULL;
+  OB_DIE_ON_ERROR (pool_participate (pname, &h, NULL));
+  const pool_chunk_cmit *cm = pool_mmap_get_data (h)->cmit_chunk;
+  if (!cm)
+    OB_FATAL_ERROR ("no cmit chunk in the header\n");
+  check_options (h, 0.002, 8, true);
+
+  pid_t kids[NUM_DEPOSITORS];
+  int64 i;
+  for (i = 0; i < NUM_DEPOSITORS; i++)
+    {
+      kids[i] = fork ();
+      if (kids[i] < 0)
+        OB_FATAL_ERROR ("fork: %s\n", strerror (errno));
+      if (kids[i] == 0)
+        {
+          deposit_lots (pname, i);
+          exit (EXIT_SUCCESS);
+        }
+    }
+  for (i = 0; i < NUM_DEPOSITORS; i++)
+    {
+      int status;
+      if (waitpid (kids[i], &status, 0) < 0)
+        OB_FATAL_ERROR ("waitpid: %s\n", strerror (errno));
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != EXIT_SUCCESS)
+        OB_FATAL_ERROR ("depositor %" OB_FMT_64 "d failed\n", i);
+    }
+
+  if (cm->synced_end < cm->written_end || cm->pending != 0
+      || cm->committing != 0)
+    OB_FATAL_ERROR ("synced to %" OB_FMT_64 "d of %" OB_FMT_64
+                    "d, %" OB_FMT_64 "d pending, committing %" OB_FMT_64
+                    "d\n",
+                    cm->synced_end, cm->written_end, cm->pending,
+                    cm->committing);
+
+  // Each depositor's proteins are all there, in order
+  const int64 total = NUM_DEPOSITORS * DEPOSITS_EACH;
+  int64 next_n[NUM_DEPOSITORS] = {0};
+  for (i = 0; i < total; i++)
+    {
+      protein p = NULL;
+      int64 idx;
+      OB_DIE_ON_ERROR (pool_next (h, &p, NULL, &idx));
+      if (idx != i)
+        OB_FATAL_ERROR ("expected index %" OB_FMT_64 "d but got %" OB_FMT_64
+                        "d\n",
+                        i, idx);
+      bslaw ing = protein_ingests (p);
+      const int64 who = slaw_path_get_int64 (ing, "who", -1);
+      const int64 n = slaw_path_get_int64 (ing, "n", -1);
+      if (who < 0 || who >= NUM_DEPOSITORS || n != next_n[who])
+        OB_FATAL_ERROR ("unexpected who = %" OB_FMT_64 "d, n = %" OB_FMT_64
+                        "d at index %" OB_FMT_64 "d\n",
+                        who, n, idx);
+      next_n[who]++;
+      protein_free (p);
+    }
+  if (pool_next (h, NULL, NULL, NULL) != POOL_NO_SUCH_PROTEIN)
+    OB_FATAL_ERROR ("more proteins than deposits\n");
+
+  // The commit options can change; group-commit can't
+  protein change =
+    protein_from_ff (NULL,
+                     slaw_map_inline_cf ("group-commit", slaw_boolean (false),
+                                         "commit-latency", slaw_float64 (0.5),
+                                         "commit-batch", slaw_int64 (3),
+                                         NULL));
+  OB_DIE_ON_ERROR (pool_change_options (h, change));
+  protein_free (change);
+  check_options (h, 0.5, 3, true);
+
+  OB_DIE_ON_ERROR (pool_withdraw (h));
+  OB_DIE_ON_ERROR (pool_dispose (pname));
+  return EXIT_SUCCESS;
+}
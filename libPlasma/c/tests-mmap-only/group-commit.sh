@@ -0,0 +1,20 @@
+#!/bin/bash
+
+# Test group commit for sync pools
+
+PATH=${PATH}:..:.
+
+# Handle internal valgrind
+IV=""
+if [ "$#" == "2" ]; then
+    if [ "$1" == "--internal-valgrind" ]; then
+        IV=$2
+    fi
+fi
+
+TEST_POOL=${TEST_POOL}-$(basename $0)
+
+$IV \
+group-commit "${TEST_POOL}"
+
+exit $?
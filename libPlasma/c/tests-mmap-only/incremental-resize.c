@@ -0,0 +1,228 @@
+/* (c)  oblong industries */
+
+// Pools with "incremental-resize": wrap a pool around, then grow it by
+// a lot (so the wrapped proteins get copied to the end of the file),
+// by a little (so they stay where they are), and by a lot again while
+// another process keeps depositing, and finally shrink it.  After each
+// resize, every protein should still be there and intact, for a hose
+// which did the resize and for one which didn't, and the pool should
+// be able to use all of its new space.
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-util.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+
+// Below necessary because we muck around inside the pool hose
+#include "libPlasma/c/private/pool_impl.h"
+#include "libPlasma/c/private/pool_mmap.h"
+
+#include <stdlib.h>
+#include <sys/wait.h>
+
+#define POOL_BYTES (2 * 1024 * 1024)
+#define WHO_MAX 2
+
+static void usage (void)
+{
+  ob_banner (stderr);
+  fprintf (stderr, "Usage: %s <pool_name>\n", ob_get_prog_name ());
+  exit (EXIT_FAILURE);
+}
+
+static protein make_protein (int64 who, int64 k)
+{
+  char buf[3000];
+  const size_t len = (k * 97) % (sizeof (buf) - 1);
+  memset (buf, 'a' + (k % 26), len);
+  buf[len] = 0;
+  return protein_from_ff (slaw_list_inline_c ("incremental-resize", NULL),
+                          slaw_map_inline_cf ("who", slaw_int64 (who), "k",
+                                              slaw_int64 (k), "pad",
+                                              slaw_string (buf), NULL));
+}
+
+static void deposit_some (pool_hose h, int64 who, int64 *k, int64 how_many)
+{
+  int64 i;
+  for (i = 0; i < how_many; i++, (*k)++)
+    {
+      protein p = make_protein (who, *k);
+      OB_DIE_ON_ERROR (pool_deposit (h, p, NULL));
+      protein_free (p);
+    }
+}
+
+/// Reads every protein in the pool, and checks that each one is what
+/// its depositor deposited, and that each depositor's proteins follow
+/// on from one another.
+
+static void check_all (pool_hose h, const char *when)
+{
+  int64 oldest, newest;
+  OB_DIE_ON_ERROR (pool_oldest_index (h, &oldest));
+  OB_DIE_ON_ERROR (pool_newest_index (h, &newest));
+  int64 last_k[WHO_MAX] = {-1, -1};
+  int64 i;
+  for (i = oldest; i <= newest; i++)
+    {
+      protein p = NULL;
+      OB_DIE_ON_ERROR (pool_nth_protein (h, i, &p, NULL));
+      bslaw ing = protein_ingests (p);
+      const int64 who = slaw_path_get_int64 (ing, "who", -1);
+      const int64 k = slaw_path_get_int64 (ing, "k", -1);
+      if (who < 0 || who >= WHO_MAX || k < 0)
+        OB_FATAL_ERROR ("%s: protein %" OB_FMT_64 "d is garbage\n", when, i);
+      protein q = make_protein (who, k);
+      if (!proteins_equal (p, q))
+        OB_FATAL_ERROR ("%s: protein %" OB_FMT_64 "d is damaged\n", when, i);
+      if (last_k[who] >= 0 && k != last_k[who] + 1)
+        OB_FATAL_ERROR ("%s: protein %" OB_FMT_64 "d has k %" OB_FMT_64
+                        "d after %" OB_FMT_64 "d\n",
+                        when, i, k, last_k[who]);
+      last_k[who] = k;
+      protein_free (p);
+      protein_free (q);
+    }
+}
+
+static void change_size (pool_hose h, unt64 size)
+{
+  protein opts =
+    protein_from_ff (NULL, slaw_map_inline_cf ("size", slaw_unt64 (size),
+                                               NULL));
+  OB_DIE_ON_ERROR (pool_change_options (h, opts));
+  protein_free (opts);
+}
+
+/// Where the oldest entry is in the file
+
+static unt64 oldest_offset (pool_hose h)
+{
+  const pool_mmap_data *d = pool_mmap_get_data (h);
+  return d->oldnew->oldest_entry % d->mapped_size;
+}
+
+/// Resizes, and checks that the generation went up, nothing
+/// disappeared (unless shrinking), and that the other hose r can still
+/// read everything.
+
+static void resize_and_check (pool_hose h, pool_hose r, unt64 size,
+                              const char *when)
+{
+  const int64 generation = pool_mmap_get_data (h)->rsiz_chunk->generation;
+  const bool growing = (size > pool_mmap_get_data (h)->mapped_size);
+  int64 oldest, newest, oldest2, newest2;
+  OB_DIE_ON_ERROR (pool_oldest_index (h, &oldest));
+  OB_DIE_ON_ERROR (pool_newest_index (h, &newest));
+  change_size (h, size);
+  // (the header moved when the pool was remapped, so look it up again)
+  const int64 now = pool_mmap_get_data (h)->rsiz_chunk->generation;
+  if (now <= generation)
+    OB_FATAL_ERROR ("%s: generation is still %" OB_FMT_64 "d\n", when, now);
+  OB_DIE_ON_ERROR (pool_oldest_index (r, &oldest2));
+  OB_DIE_ON_ERROR (pool_newest_index (r, &newest2));
+  if (newest2 != newest || (growing && oldest2 != oldest))
+    OB_FATAL_ERROR ("%s: had %" OB_FMT_64 "d-%" OB_FMT_64 "d, now %" OB_FMT_64
+                    "d-%" OB_FMT_64 "d\n",
+                    when, oldest, newest, oldest2, newest2);
+  check_all (h, when);
+  check_all (r, when);
+}
+
+static void test_resize (const char *pname, bool extras)
+{
+  protein opts =
+    protein_from_ff (NULL,
+                     slaw_map_inline_cf ("size", slaw_unt64 (POOL_BYTES),
+                                         "incremental-resize",
+                                         slaw_boolean (true), "toc-capacity",
+                                         slaw_unt64 (extras ? 200 : 0),
+                                         "dense-index", slaw_boolean (extras),
+                                         NULL));
+  OB_DIE_ON_ERROR (pool_create (pname, "mmap", opts));
+  protein_free (opts);
+
+  pool_hose h = NULL, r = NULL;
+  OB_DIE_ON_ERROR (pool_participate (pname, &h, NULL));
+  OB_DIE_ON_ERROR (pool_participate (pname, &r, NULL));
+  if (!pool_mmap_get_data (h)->rsiz_chunk)
+    OB_FATAL_ERROR ("no rsiz chunk in the header\n");
+
+  int64 k = 0;
+  deposit_some (h, 0, &k, 2000);
+  int64 oldest, newest;
+  OB_DIE_ON_ERROR (pool_oldest_index (h, &oldest));
+  OB_DIE_ON_ERROR (pool_newest_index (h, &newest));
+  if (oldest == 0)
+    OB_FATAL_ERROR ("pool never wrapped around\n");
+  check_all (r, "before resize");
+  const int64 count = newest - oldest + 1;
+
+  // Plenty of room to copy the wrapped proteins to the end
+  resize_and_check (h, r, 4 * POOL_BYTES, "after growing a lot");
+  if (oldest_offset (h) < POOL_BYTES)
+    OB_FATAL_ERROR ("wrapped proteins didn't move\n");
+  deposit_some (h, 0, &k, 6000);
+  OB_DIE_ON_ERROR (pool_oldest_index (h, &oldest));
+  OB_DIE_ON_ERROR (pool_newest_index (h, &newest));
+  if (newest - oldest + 1 < 3 * count)
+    OB_FATAL_ERROR ("only room for %" OB_FMT_64 "d proteins\n",
+                    newest - oldest + 1);
+  check_all (r, "after filling");
+
+  // Not enough room to copy them, so they stay put
+  const unt64 before = oldest_offset (h);
+  resize_and_check (h, r, 4 * POOL_BYTES + 4096, "after growing a little");
+  if (oldest_offset (h) != before)
+    OB_FATAL_ERROR ("wrapped proteins moved from %" OB_FMT_64
+                    "u to %" OB_FMT_64 "u\n",
+                    before, oldest_offset (h));
+  deposit_some (h, 0, &k, 3000);
+  check_all (r, "after depositing past them");
+
+  // Grow while somebody else is depositing
+  const pid_t kid = fork ();
+  if (kid < 0)
+    OB_FATAL_ERROR ("fork failed\n");
+  if (kid == 0)
+    {
+      pool_hose kh = NULL;
+      int64 kk = 0;
+      OB_DIE_ON_ERROR (pool_participate (pname, &kh, NULL));
+      deposit_some (kh, 1, &kk, 8000);
+      OB_DIE_ON_ERROR (pool_withdraw (kh));
+      exit (EXIT_SUCCESS);
+    }
+  change_size (h, 16 * POOL_BYTES);
+  int status = 0;
+  if (waitpid (kid, &status, 0) != kid || !WIFEXITED (status)
+      || WEXITSTATUS (status) != EXIT_SUCCESS)
+    OB_FATAL_ERROR ("depositor failed\n");
+  check_all (h, "after growing during deposits");
+  check_all (r, "after growing during deposits");
+
+  // Shrinking is done the old way
+  resize_and_check (h, r, POOL_BYTES, "after shrinking");
+  deposit_some (h, 0, &k, 1000);
+  check_all (r, "after shrinking and depositing");
+
+  OB_DIE_ON_ERROR (pool_withdraw (r));
+  OB_DIE_ON_ERROR (pool_withdraw (h));
+  OB_DIE_ON_ERROR (pool_dispose (pname));
+}
+
+int main (int argc, char **argv)
+{
+  OB_CHECK_ABI ();
+
+  if (argc != 2)
+    usage ();
+
+  test_resize (argv[1], false);
+  test_resize (argv[1], true);
+  return EXIT_SUCCESS;
+}
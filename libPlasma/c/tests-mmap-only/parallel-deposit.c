@@ -0,0 +1,236 @@
+
+/* (c)  oblong industries */
+
+// Several processes deposit into a "parallel-deposit" pool at once,
+// while we read along.  The pool is small enough to wrap around many
+// times.  Every protein we manage to read should be intact, indices
+// should never go backwards, each depositor's proteins should show
+// up in the order it deposited them, and at the end the pool should
+// account for every deposit.  Then a depositor dies halfway through
+// copying its protein, and the next deposit should carry on anyway.
+
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-util.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/pool_options.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define NUM_DEPOSITORS 4
+#define DEPOSITS_EACH 2000
+#define POOL_BYTES (256 * 1024)
+#define DOOMED_RUDE 60000
+
+static void usage (void)
+{
+  ob_banner (stderr);
+  fprintf (stderr, "Usage: %s <pool_name>\n", ob_get_prog_name ());
+  exit (EXIT_FAILURE);
+}
+
+static protein make_protein (int64 who, int64 n)
+{
+  // Vary the length, so entries don't line up neatly with the end of
+  // the pool, and make it long enough that a torn copy would show.
+  char buf[400];
+  const size_t len = 20 + (n * 37) % (sizeof (buf) - 21);
+  memset (buf, 'a' + who, len);
+  buf[len] = 0;
+  return protein_from_ff (slaw_list_inline_c ("parallel", NULL),
+                          slaw_map_inline_cf ("who", slaw_int64 (who), "n",
+                                              slaw_int64 (n), "pad",
+                                              slaw_string (buf), NULL));
+}
+
+static void deposit_lots (const char *pname, int64 who)
+{
+  pool_hose h = NULL;
+  OB_DIE_ON_ERROR (pool_participate (pname, &h, NULL));
+  int64 n;
+  for (n = 0; n < DEPOSITS_EACH; n++)
+    {
+      protein p = make_protein (who, n);
+      OB_DIE_ON_ERROR (pool_deposit (h, p, NULL));
+      protein_free (p);
+    }
+  OB_DIE_ON_ERROR (pool_withdraw (h));
+}
+
+/// Deposit a protein whose header promises DOOMED_RUDE bytes of rude
+/// data, but which runs into an inaccessible page right after the
+/// header.  The header is all the pool copies before claiming the
+/// entry, so this dies copying the rest, with the entry claimed but
+/// not published.
+
+static void deposit_and_die (const char *pname)
+{
+  const struct rlimit no_core = {0, 0};
+  setrlimit (RLIMIT_CORE, &no_core);
+  signal (SIGSEGV, SIG_DFL);
+
+  pool_hose h = NULL;
+  OB_DIE_ON_ERROR (pool_participate (pname, &h, NULL));
+  const size_t page = (size_t) sysconf (_SC_PAGESIZE);
+  const size_t room = page + DOOMED_RUDE;
+  byte *mem =
+    mmap (NULL, room, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (mem == MAP_FAILED)
+    OB_FATAL_ERROR ("mmap: %s\n", strerror (errno));
+  protein p = protein_from_ffr (NULL, NULL, mem, DOOMED_RUDE);
+  memcpy (mem, p, 16);
+  protein_free (p);
+  if (mprotect (mem + page, room - page, PROT_NONE) < 0)
+    OB_FATAL_ERROR ("mprotect: %s\n", strerror (errno));
+  pool_deposit (h, (bprotein) mem, NULL);
+  OB_FATAL_ERROR ("deposit of a bad protein survived\n");
+}
+
+/// A depositor dies between claiming its entry and publishing it.
+/// Depositing after it shouldn't wait forever: its entry turns up as
+/// an empty protein of the same length, followed by ours.
+
+static void survive_dead_depositor (pool_hose h, const char *pname)
+{
+  int64 before = -1;
+  OB_DIE_ON_ERROR (pool_newest_index (h, &before));
+
+  const pid_t kid = fork ();
+  if (kid < 0)
+    OB_FATAL_ERROR ("fork: %s\n", strerror (errno));
+  if (kid == 0)
+    deposit_and_die (pname);
+  int status;
+  if (waitpid (kid, &status, 0) < 0)
+    OB_FATAL_ERROR ("waitpid: %s\n", strerror (errno));
+  if (!WIFSIGNALED (status) || WTERMSIG (status) != SIGSEGV)
+    OB_FATAL_ERROR ("doomed depositor didn't die as expected (%d)\n", status);
+
+  // Hanging is the failure we're looking for
+  alarm (60);
+  protein p = make_protein (NUM_DEPOSITORS, 0);
+  int64 idx = -1;
+  OB_DIE_ON_ERROR (pool_deposit (h, p, &idx));
+  alarm (0);
+  if (idx != before + 2)
+    OB_FATAL_ERROR ("expected index %" OB_FMT_64 "d but got %" OB_FMT_64
+                    "d\n",
+                    before + 2, idx);
+
+  protein q = NULL;
+  OB_DIE_ON_ERROR (pool_nth_protein (h, before + 1, &q, NULL));
+  int64 rude_len = -1;
+  const byte *rude = (const byte *) protein_rude (q, &rude_len);
+  if (protein_descrips (q) || protein_ingests (q) || rude_len != DOOMED_RUDE)
+    OB_FATAL_ERROR ("dead depositor's entry wasn't discarded\n");
+  int64 i;
+  for (i = 0; i < rude_len; i++)
+    if (rude[i] != 0)
+      OB_FATAL_ERROR ("dead depositor's entry wasn't cleared\n");
+  protein_free (q);
+
+  OB_DIE_ON_ERROR (pool_nth_protein (h, idx, &q, NULL));
+  if (!proteins_equal (p, q))
+    OB_FATAL_ERROR ("protein at index %" OB_FMT_64 "d is mangled\n", idx);
+  protein_free (q);
+  protein_free (p);
+}
+
+int main (int argc, char **argv)
+{
+  OB_CHECK_ABI ();
+
+  if (argc != 2)
+    usage ();
+  const char *pname = argv[1];
+
+  protein opts =
+    protein_from_ff (NULL,
+                     slaw_map_inline_cf ("size", slaw_unt64 (POOL_BYTES),
+                                         "checksum", slaw_boolean (true),
+                                         "parallel-deposit",
+                                         slaw_boolean (true), NULL));
+  OB_DIE_ON_ERROR (pool_create (pname, "mmap", opts));
+  protein_free (opts);
+
+  pool_hose h = NULL;
+  OB_DIE_ON_ERROR (pool_participate (pname, &h, NULL));
+
+  pid_t kids[NUM_DEPOSITORS];
+  int64 i;
+  for (i = 0; i < NUM_DEPOSITORS; i++)
+    {
+      kids[i] = fork ();
+      if (kids[i] < 0)
+        OB_FATAL_ERROR ("fork: %s\n", strerror (errno));
+      if (kids[i] == 0)
+        {
+          deposit_lots (pname, i);
+          exit (EXIT_SUCCESS);
+        }
+    }
+
+  int64 next_n[NUM_DEPOSITORS] = {0};
+  int64 last_idx = -1;
+  int64 seen = 0;
+  const int64 total = NUM_DEPOSITORS * DEPOSITS_EACH;
+  while (last_idx < total - 1)
+    {
+      protein p = NULL;
+      int64 idx;
+      ob_retort tort = pool_await_next (h, 10, &p, NULL, &idx);
+      if (tort == POOL_AWAIT_TIMEDOUT)
+        OB_FATAL_ERROR ("timed out after index %" OB_FMT_64 "d\n", last_idx);
+      OB_DIE_ON_ERROR (tort);
+      if (idx <= last_idx)
+        OB_FATAL_ERROR ("index went from %" OB_FMT_64 "d to %" OB_FMT_64
+                        "d\n",
+                        last_idx, idx);
+      last_idx = idx;
+      bslaw ing = protein_ingests (p);
+      const int64 who = slaw_path_get_int64 (ing, "who", -1);
+      const int64 n = slaw_path_get_int64 (ing, "n", -1);
+      if (who < 0 || who >= NUM_DEPOSITORS || n < next_n[who])
+        OB_FATAL_ERROR ("unexpected who = %" OB_FMT_64 "d, n = %" OB_FMT_64
+                        "d at index %" OB_FMT_64 "d\n",
+                        who, n, idx);
+      next_n[who] = n + 1;
+      protein q = make_protein (who, n);
+      if (!proteins_equal (p, q))
+        OB_FATAL_ERROR ("protein at index %" OB_FMT_64 "d is mangled\n", idx);
+      protein_free (q);
+      protein_free (p);
+      seen++;
+    }
+
+  for (i = 0; i < NUM_DEPOSITORS; i++)
+    {
+      int status;
+      if (waitpid (kids[i], &status, 0) < 0)
+        OB_FATAL_ERROR ("waitpid: %s\n", strerror (errno));
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != EXIT_SUCCESS)
+        OB_FATAL_ERROR ("depositor %" OB_FMT_64 "d failed\n", i);
+    }
+
+  int64 newest = -1;
+  OB_DIE_ON_ERROR (pool_newest_index (h, &newest));
+  if (newest != total - 1)
+    OB_FATAL_ERROR ("expected newest index %" OB_FMT_64 "d but got %" OB_FMT_64
+                    "d\n",
+                    total - 1, newest);
+  OB_LOG_INFO ("read %" OB_FMT_64 "d of %" OB_FMT_64 "d proteins\n", seen,
+               total);
+
+  survive_dead_depositor (h, pname);
+
+  OB_DIE_ON_ERROR (pool_withdraw (h));
+  OB_DIE_ON_ERROR (pool_dispose (pname));
+  return EXIT_SUCCESS;
+}
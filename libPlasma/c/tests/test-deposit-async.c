@@ -0,0 +1,198 @@
+
+/* (c)  oblong industries */
+
+// Tests pool_deposit_async(): every deposit's callback gets called
+// exactly once, in order, with the right index, whether the results
+// are collected by pool_deposit_async_flush(), by some other
+// operation on the hose, or by pool_withdraw().
+
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-vers.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define HOW_MANY (3 * POOL_DEPOSIT_WINDOW + 5)
+
+typedef struct
+{
+  int64 calls;
+  int64 idx;
+  pool_timestamp ts;
+} result;
+
+static result results[4 * HOW_MANY];
+static int64 expected_calls;
+
+static void usage (void)
+{
+  fprintf (stderr, "Usage: test-deposit-async [-t <type>] [-s <size>] "
+                   "[-i <toc cap>] <pool_name>\n");
+  exit (EXIT_FAILURE);
+}
+
+static void deposited (OB_UNUSED pool_hose ph, ob_retort tort, int64 idx,
+                       pool_timestamp ts, void *cookie)
+{
+  const int64 n = (int64) (intptr_t) cookie;
+  if (tort != OB_OK)
+    OB_FATAL_ERROR_CODE (0x20415000, "deposit %" OB_FMT_64 "d failed: %s\n", n,
+                         ob_error_string (tort));
+  if (n != expected_calls++)
+    OB_FATAL_ERROR_CODE (0x20415001, "callback for %" OB_FMT_64
+                                     "d came out of order\n",
+                         n);
+  results[n].calls++;
+  results[n].idx = idx;
+  results[n].ts = ts;
+}
+
+static void deposit_some (pool_hose ph, int64 first, int64 count)
+{
+  int64 i;
+  for (i = first; i < first + count; i++)
+    {
+      protein p =
+        protein_from_ff (slaw_list_inline_c ("async", NULL),
+                         slaw_map_inline_cf ("n", slaw_int64 (i), NULL));
+      ob_retort pret =
+        pool_deposit_async (ph, p, deposited, (void *) (intptr_t) i);
+      if (pret != OB_OK)
+        OB_FATAL_ERROR_CODE (0x20415002, "pool_deposit_async returned %s\n",
+                             ob_error_string (pret));
+      protein_free (p);
+    }
+}
+
+static void check_results (int64 upto)
+{
+  if (expected_calls != upto)
+    OB_FATAL_ERROR_CODE (0x20415003, "expected %" OB_FMT_64
+                                     "d callbacks, got %" OB_FMT_64 "d\n",
+                         upto, expected_calls);
+  int64 i;
+  for (i = 0; i < upto; i++)
+    {
+      if (results[i].calls != 1)
+        OB_FATAL_ERROR_CODE (0x20415004, "callback for %" OB_FMT_64
+                                         "d called %" OB_FMT_64 "d times\n",
+                             i, results[i].calls);
+      if (results[i].idx != i)
+        OB_FATAL_ERROR_CODE (0x20415005, "deposit %" OB_FMT_64
+                                         "d got index %" OB_FMT_64 "d\n",
+                             i, results[i].idx);
+      if (i > 0 && results[i].ts < results[i - 1].ts)
+        OB_FATAL_ERROR_CODE (0x20415006,
+                             "timestamps went backwards at %" OB_FMT_64 "d\n",
+                             i);
+    }
+}
+
+static int mainish (int argc, char **argv)
+{
+  pool_cmd_info cmd;
+  int c;
+
+  memset (&cmd, 0, sizeof (cmd));
+  while ((c = getopt (argc, argv, "i:s:t:")) != -1)
+    {
+      switch (c)
+        {
+          case 'i':
+            cmd.toc_capacity = strtoll (optarg, NULL, 0);
+            break;
+          case 's':
+            cmd.size = strtoll (optarg, NULL, 0);
+            break;
+          case 't':
+            cmd.type = optarg;
+            break;
+          default:
+            usage ();
+        }
+    }
+  pool_cmd_setup_options (&cmd);
+  if (pool_cmd_get_poolname (&cmd, argc, argv, optind))
+    usage ();
+
+  ob_retort pret = pool_participate_creatingly (cmd.pool_name, cmd.type,
+                                                &cmd.ph, cmd.create_options);
+  if (pret < 0)
+    OB_FATAL_ERROR_CODE (0x20415007, "no can participate_creatingly %s: %s\n",
+                         cmd.pool_name, ob_error_string (pret));
+
+  // Flushed explicitly
+  int64 done = 0;
+  deposit_some (cmd.ph, done, HOW_MANY);
+  done += HOW_MANY;
+  OB_DIE_ON_ERROR (pool_deposit_async_flush (cmd.ph));
+  check_results (done);
+  OB_DIE_ON_ERROR (pool_deposit_async_flush (cmd.ph));
+
+  // Collected by some other operation
+  deposit_some (cmd.ph, done, HOW_MANY);
+  done += HOW_MANY;
+  int64 newest = -1;
+  OB_DIE_ON_ERROR (pool_newest_index (cmd.ph, &newest));
+  check_results (done);
+  if (newest != done - 1)
+    OB_FATAL_ERROR_CODE (0x20415008, "newest index is %" OB_FMT_64 "d\n",
+                         newest);
+
+  // Mixed with ordinary deposits, and reads
+  deposit_some (cmd.ph, done, 3);
+  done += 3;
+  protein p = NULL;
+  int64 idx = -1;
+  pret = pool_nth_protein (cmd.ph, done - 1, &p, NULL);
+  if (pret != OB_OK || slaw_path_get_int64 (protein_ingests (p), "n", -1)
+                         != done - 1)
+    OB_FATAL_ERROR_CODE (0x20415009, "couldn't read back protein %" OB_FMT_64
+                                     "d: %s\n",
+                         done - 1, ob_error_string (pret));
+  check_results (done);
+  OB_DIE_ON_ERROR (pool_deposit (cmd.ph, p, &idx));
+  protein_free (p);
+  if (idx != done)
+    OB_FATAL_ERROR_CODE (0x2041500a, "pool_deposit got index %" OB_FMT_64
+                                     "d\n",
+                         idx);
+  // That one had no callback, so skip over it
+  results[done].calls = 1;
+  results[done].idx = done;
+  results[done].ts = results[done - 1].ts;
+  expected_calls = ++done;
+
+  slaw notProtein = slaw_string ("not a protein");
+  pret = pool_deposit_async (cmd.ph, notProtein, deposited, NULL);
+  slaw_free (notProtein);
+  if (pret != POOL_NOT_A_PROTEIN)
+    OB_FATAL_ERROR_CODE (0x2041500b, "expected POOL_NOT_A_PROTEIN, got %s\n",
+                         ob_error_string (pret));
+
+  // Collected on the way out
+  deposit_some (cmd.ph, done, HOW_MANY);
+  done += HOW_MANY;
+  OB_DIE_ON_ERROR (pool_withdraw (cmd.ph));
+  check_results (done);
+
+  pret = pool_dispose (cmd.pool_name);
+  if (pret != OB_OK)
+    OB_FATAL_ERROR_CODE (0x2041500c, "no can stop %s: %s\n", cmd.pool_name,
+                         ob_error_string (pret));
+
+  pool_cmd_free_options (&cmd);
+
+  return EXIT_SUCCESS;
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  return check_for_leaked_file_descriptors_scoped (mainish, argc, argv);
+}
@@ -0,0 +1,207 @@
+
+/* (c)  oblong industries */
+
+// Tests pool_deposit_batch(): the proteins land in order with
+// consecutive indexes and one timestamp, an awaiter in another thread
+// sees every one of them, and a batch with something that isn't a
+// protein in it deposits nothing.
+
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-vers.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <libLoam/c/ob-pthread.h>
+
+#define BATCH 17
+#define ROUNDS 20
+
+static void usage (void)
+{
+  fprintf (stderr, "Usage: test-deposit-batch [-t <type>] [-s <size>] "
+                   "[-i <toc cap>] <pool_name>\n");
+  exit (EXIT_FAILURE);
+}
+
+static void make_batch (protein *ps, int64 first)
+{
+  int64 i;
+  for (i = 0; i < BATCH; i++)
+    ps[i] =
+      protein_from_ff (slaw_list_inline_c ("batch", NULL),
+                       slaw_map_inline_cf ("n", slaw_int64 (first + i), NULL));
+}
+
+static void free_batch (protein *ps)
+{
+  int64 i;
+  for (i = 0; i < BATCH; i++)
+    protein_free (ps[i]);
+}
+
+static void deposit_batch (pool_hose ph, int64 first)
+{
+  protein ps[BATCH];
+  int64 idx[BATCH];
+  pool_timestamp ts[BATCH];
+  make_batch (ps, first);
+
+  ob_retort pret =
+    pool_deposit_batch_ex (ph, (const bprotein *) ps, BATCH, idx, ts);
+  if (pret != OB_OK)
+    OB_FATAL_ERROR_CODE (0x20414000, "pool_deposit_batch returned %s\n",
+                         ob_error_string (pret));
+
+  int64 i;
+  for (i = 0; i < BATCH; i++)
+    {
+      if (idx[i] != first + i)
+        OB_FATAL_ERROR_CODE (0x20414001, "expected index %" OB_FMT_64
+                                         "d but got %" OB_FMT_64 "d\n",
+                             first + i, idx[i]);
+      if (ts[i] != ts[0] || ts[i] <= 0)
+        OB_FATAL_ERROR_CODE (0x20414002, "bad timestamp %f for index %" OB_FMT_64
+                                         "d\n",
+                             ts[i], idx[i]);
+    }
+  free_batch (ps);
+}
+
+static void *send_some_batches (void *v)
+{
+  const char *poolName = (const char *) v;
+  pool_hose ph;
+
+  ob_retort err = pool_participate (poolName, &ph, NULL);
+  if (err != OB_OK)
+    OB_FATAL_ERROR_CODE (0x20414003, "no can participate %s: %s\n", poolName,
+                         ob_error_string (err));
+
+  int64 round;
+  for (round = 1; round <= ROUNDS; round++)
+    deposit_batch (ph, round * BATCH);
+
+  OB_DIE_ON_ERROR (pool_withdraw (ph));
+  return NULL;
+}
+
+static int mainish (int argc, char **argv)
+{
+  pool_cmd_info cmd;
+  int c;
+
+  memset (&cmd, 0, sizeof (cmd));
+  while ((c = getopt (argc, argv, "i:s:t:")) != -1)
+    {
+      switch (c)
+        {
+          case 'i':
+            cmd.toc_capacity = strtoll (optarg, NULL, 0);
+            break;
+          case 's':
+            cmd.size = strtoll (optarg, NULL, 0);
+            break;
+          case 't':
+            cmd.type = optarg;
+            break;
+          default:
+            usage ();
+        }
+    }
+  pool_cmd_setup_options (&cmd);
+  if (pool_cmd_get_poolname (&cmd, argc, argv, optind))
+    usage ();
+
+  ob_retort pret = pool_participate_creatingly (cmd.pool_name, cmd.type,
+                                                &cmd.ph, cmd.create_options);
+  if (pret < 0)
+    OB_FATAL_ERROR_CODE (0x20414004, "no can participate_creatingly %s: %s\n",
+                         cmd.pool_name, ob_error_string (pret));
+
+  // An empty batch is fine, and does nothing
+  pret = pool_deposit_batch (cmd.ph, NULL, 0, NULL);
+  if (pret != OB_OK)
+    OB_FATAL_ERROR_CODE (0x20414005, "empty batch returned %s\n",
+                         ob_error_string (pret));
+
+  deposit_batch (cmd.ph, 0);
+
+  // One bad apple spoils the batch
+  protein ps[BATCH];
+  int64 idx[BATCH];
+  make_batch (ps, 1000);
+  slaw notProtein = slaw_string ("not a protein");
+  bprotein mixed[BATCH];
+  int64 i;
+  for (i = 0; i < BATCH; i++)
+    mixed[i] = (i == BATCH / 2 ? notProtein : ps[i]);
+  pret = pool_deposit_batch (cmd.ph, mixed, BATCH, idx);
+  if (pret != POOL_NOT_A_PROTEIN)
+    OB_FATAL_ERROR_CODE (0x20414006, "expected POOL_NOT_A_PROTEIN, got %s\n",
+                         ob_error_string (pret));
+  for (i = 0; i < BATCH; i++)
+    if (idx[i] != POOL_NOT_A_PROTEIN)
+      OB_FATAL_ERROR_CODE (0x20414007, "index %" OB_FMT_64 "d is %" OB_FMT_64
+                                       "d, not POOL_NOT_A_PROTEIN\n",
+                           i, idx[i]);
+  slaw_free (notProtein);
+  free_batch (ps);
+
+  int64 newest = -1;
+  OB_DIE_ON_ERROR (pool_newest_index (cmd.ph, &newest));
+  if (newest != BATCH - 1)
+    OB_FATAL_ERROR_CODE (0x20414008, "newest index is %" OB_FMT_64 "d\n",
+                         newest);
+
+  // Somebody else deposits while we await
+  OB_DIE_ON_ERROR (pool_seekto (cmd.ph, BATCH));
+  pthread_t thr;
+  if (pthread_create (&thr, NULL, send_some_batches, (void *) cmd.pool_name)
+      != 0)
+    {
+      perror ("pthread_create");
+      return EXIT_FAILURE;
+    }
+
+  for (i = BATCH; i < (ROUNDS + 1) * BATCH; i++)
+    {
+      protein p = NULL;
+      int64 got = -1;
+      pret = pool_await_next (cmd.ph, 60, &p, NULL, &got);
+      if (pret != OB_OK)
+        OB_FATAL_ERROR_CODE (0x20414009, "pool_await_next returned %s\n",
+                             ob_error_string (pret));
+      if (got != i || slaw_path_get_int64 (protein_ingests (p), "n", -1) != i)
+        OB_FATAL_ERROR_CODE (0x2041400a, "expected protein %" OB_FMT_64
+                                         "d but got %" OB_FMT_64 "d\n",
+                             i, got);
+      protein_free (p);
+    }
+
+  if (pthread_join (thr, NULL) != 0)
+    {
+      perror ("pthread_join");
+      return EXIT_FAILURE;
+    }
+
+  OB_DIE_ON_ERROR (pool_withdraw (cmd.ph));
+  pret = pool_dispose (cmd.pool_name);
+  if (pret != OB_OK)
+    OB_FATAL_ERROR_CODE (0x2041400b, "no can stop %s: %s\n", cmd.pool_name,
+                         ob_error_string (pret));
+
+  pool_cmd_free_options (&cmd);
+
+  return EXIT_SUCCESS;
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  return check_for_leaked_file_descriptors_scoped (mainish, argc, argv);
+}
@@ -0,0 +1,237 @@
+
+/* (c)  oblong industries */
+
+// Tests protein filters, both as a search for pool_probe_frwd() and
+// friends, and as a hose's subscription filter.  Over tcp, the server
+// does the filtering if it can, and we do it if it can't, but the
+// results should be the same either way.
+
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-time.h"
+#include "libLoam/c/ob-vers.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <libLoam/c/ob-pthread.h>
+
+#define ROUNDS 50
+
+static void usage (void)
+{
+  fprintf (stderr, "Usage: test-filter [-t <type>] [-s <size>] [-i <toc cap>]"
+                   "<pool_name>\n");
+  exit (EXIT_FAILURE);
+}
+
+/// Only every fourth protein (i % 4 == 3) passes the filter; the
+/// others each fail exactly one of its tests.
+
+static protein make_protein (int64 i)
+{
+  static const char rude[32] = "rude data, rude data, rude data";
+  const int which = (int) (i % 4);
+  slaw des = (which == 0 ? slaw_list_inline_c ("b", "a", NULL)
+                         : slaw_list_inline_c ("a", "x", "b", NULL));
+  slaw ing =
+    slaw_map_inline_cf ("count", slaw_int64 (i), "kind",
+                        slaw_string (which == 1 ? "toss" : "keep"), NULL);
+  return protein_from_ffr (des, ing, rude, (which == 2 ? 32 : 8));
+}
+
+static protein make_filter (void)
+{
+  slaw des = slaw_list_inline_c ("a", "b", NULL);
+  slaw ing = slaw_map_inline_cf ("kind", slaw_string ("keep"), "count",
+                                 slaw_nil (), NULL);
+  protein f = protein_filter (des, SEARCH_GAP, ing, 4, 16);
+  slaw_free (des);
+  slaw_free (ing);
+  if (!f || !slaw_is_protein_filter (f))
+    OB_FATAL_ERROR_CODE (0x20413000, "couldn't make a filter\n");
+  return f;
+}
+
+static void deposit_round (pool_hose ph, int64 round)
+{
+  int64 i;
+  for (i = 4 * round; i < 4 * round + 4; i++)
+    {
+      protein p = make_protein (i);
+      ob_retort err = pool_deposit (ph, p, NULL);
+      if (err != OB_OK)
+        OB_FATAL_ERROR_CODE (0x20413001, "pool_deposit returned %s\n",
+                             ob_error_string (err));
+      protein_free (p);
+    }
+}
+
+static void *send_some_proteins (void *v)
+{
+  const char *poolName = (const char *) v;
+  pool_hose ph;
+
+  ob_retort err = pool_participate (poolName, &ph, NULL);
+  if (err != OB_OK)
+    OB_FATAL_ERROR_CODE (0x20413002, "no can participate %s: %s\n", poolName,
+                         ob_error_string (err));
+
+  int64 round;
+  for (round = 1; round <= ROUNDS; round++)
+    {
+      deposit_round (ph, round);
+      if (round % 10 == 0)
+        ob_micro_sleep (10000);
+    }
+
+  OB_DIE_ON_ERROR (pool_withdraw (ph));
+  return NULL;
+}
+
+static void expect_match (ob_retort err, protein p, int64 idx, int64 round,
+                          const char *what)
+{
+  if (err != OB_OK)
+    OB_FATAL_ERROR_CODE (0x20413003, "%s returned %s in round %" OB_FMT_64
+                                     "d\n",
+                         what, ob_error_string (err), round);
+  const int64 want = 4 * round + 3;
+  const int64 got = slaw_path_get_int64 (protein_ingests (p), "count", -1);
+  if (got != want || idx != want)
+    OB_FATAL_ERROR_CODE (0x20413004,
+                         "%s expected %" OB_FMT_64 "d but got %" OB_FMT_64
+                         "d (index %" OB_FMT_64 "d)\n",
+                         what, want, got, idx);
+  protein_free (p);
+}
+
+static int mainish (int argc, char **argv)
+{
+  pool_cmd_info cmd;
+  int c;
+
+  memset (&cmd, 0, sizeof (cmd));
+  while ((c = getopt (argc, argv, "i:s:t:")) != -1)
+    {
+      switch (c)
+        {
+          case 'i':
+            cmd.toc_capacity = strtoll (optarg, NULL, 0);
+            break;
+          case 's':
+            cmd.size = strtoll (optarg, NULL, 0);
+            break;
+          case 't':
+            cmd.type = optarg;
+            break;
+          default:
+            usage ();
+        }
+    }
+  pool_cmd_setup_options (&cmd);
+  if (pool_cmd_get_poolname (&cmd, argc, argv, optind))
+    usage ();
+
+  ob_retort pret = pool_participate_creatingly (cmd.pool_name, cmd.type,
+                                                &cmd.ph, cmd.create_options);
+  if (pret < 0)
+    OB_FATAL_ERROR_CODE (0x20413005, "no can participate_creatingly %s: %s\n",
+                         cmd.pool_name, ob_error_string (pret));
+
+  protein filter = make_filter ();
+  protein p = NULL;
+  int64 idx = -1;
+
+  // As a search
+  deposit_round (cmd.ph, 0);
+  pret = pool_probe_frwd (cmd.ph, filter, &p, NULL, &idx);
+  expect_match (pret, p, idx, 0, "pool_probe_frwd");
+  pret = pool_probe_back (cmd.ph, filter, &p, NULL, &idx);
+  expect_match (pret, p, idx, 0, "pool_probe_back");
+  pret = pool_probe_frwd (cmd.ph, filter, &p, NULL, &idx);
+  expect_match (pret, p, idx, 0, "pool_probe_frwd");
+  pret = pool_await_probe_frwd (cmd.ph, filter, 0.1, &p, NULL, &idx);
+  if (pret != POOL_AWAIT_TIMEDOUT)
+    OB_FATAL_ERROR_CODE (0x20413006, "expected timeout, got %s\n",
+                         ob_error_string (pret));
+
+  // As a subscription
+  OB_DIE_ON_ERROR (pool_rewind (cmd.ph));
+  OB_DIE_ON_ERROR (pool_hose_set_filter (cmd.ph, filter));
+  if (!proteins_equal (pool_hose_get_filter (cmd.ph), filter))
+    OB_FATAL_ERROR_CODE (0x20413007, "filter didn't stick\n");
+  pret = pool_next (cmd.ph, &p, NULL, &idx);
+  expect_match (pret, p, idx, 0, "pool_next");
+  pret = pool_next (cmd.ph, &p, NULL, &idx);
+  if (pret != POOL_NO_SUCH_PROTEIN)
+    OB_FATAL_ERROR_CODE (0x20413008, "expected no protein, got %s\n",
+                         ob_error_string (pret));
+
+  pthread_t thr;
+  if (pthread_create (&thr, NULL, send_some_proteins, (void *) cmd.pool_name)
+      != 0)
+    {
+      perror ("pthread_create");
+      return EXIT_FAILURE;
+    }
+
+  int64 round;
+  for (round = 1; round <= ROUNDS / 2; round++)
+    {
+      pret = pool_await_next (cmd.ph, 60, &p, NULL, &idx);
+      expect_match (pret, p, idx, round, "pool_await_next");
+    }
+
+  pool_gang gang = NULL;
+  OB_DIE_ON_ERROR (pool_new_gang (&gang));
+  OB_DIE_ON_ERROR (pool_join_gang (gang, cmd.ph));
+  for (; round <= ROUNDS; round++)
+    {
+      pool_hose which = NULL;
+      pret = pool_await_next_multi (gang, 60, &which, &p, NULL, &idx);
+      expect_match (pret, p, idx, round, "pool_await_next_multi");
+    }
+  OB_DIE_ON_ERROR (pool_leave_gang (gang, cmd.ph));
+  OB_DIE_ON_ERROR (pool_disband_gang (gang, false));
+
+  if (pthread_join (thr, NULL) != 0)
+    {
+      perror ("pthread_join");
+      return EXIT_FAILURE;
+    }
+
+  pret = pool_await_next (cmd.ph, 0.1, &p, NULL, &idx);
+  if (pret != POOL_AWAIT_TIMEDOUT)
+    OB_FATAL_ERROR_CODE (0x20413009, "expected timeout, got %s\n",
+                         ob_error_string (pret));
+
+  // Without the filter, we get everything again
+  OB_DIE_ON_ERROR (pool_hose_set_filter (cmd.ph, NULL));
+  OB_DIE_ON_ERROR (pool_seekto (cmd.ph, 0));
+  pret = pool_next (cmd.ph, &p, NULL, &idx);
+  if (pret != OB_OK || idx != 0)
+    OB_FATAL_ERROR_CODE (0x2041300a, "unfiltered pool_next failed: %s\n",
+                         ob_error_string (pret));
+  protein_free (p);
+
+  protein_free (filter);
+  OB_DIE_ON_ERROR (pool_withdraw (cmd.ph));
+  pret = pool_dispose (cmd.pool_name);
+  if (pret != OB_OK)
+    OB_FATAL_ERROR_CODE (0x2041300b, "no can stop %s: %s\n", cmd.pool_name,
+                         ob_error_string (pret));
+
+  pool_cmd_free_options (&cmd);
+
+  return EXIT_SUCCESS;
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  return check_for_leaked_file_descriptors_scoped (mainish, argc, argv);
+}
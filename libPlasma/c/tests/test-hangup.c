@@ -0,0 +1,318 @@
+
+/* (c)  oblong industries */
+
+// Tests that clients going away doesn't upset anybody else.  Each
+// round, a bunch of processes await the same pool at once (more of
+// them than a worker thread pool server has workers, so they had
+// better not be tying the workers up).  Some of them are killed while
+// they wait, and one just leaves without withdrawing.  Then a deposit
+// has to wake up everybody who's left, and the pool has to go on
+// working as usual.  Then, for a pool on a server, some clients get
+// partway through sending a command and stop, and everybody else has
+// to get on with it.
+
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-sys.h"
+#include "libLoam/c/ob-time.h"
+#include "libLoam/c/ob-vers.h"
+#include "libPlasma/c/private/pool_tcp.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netdb.h>
+
+#define AWAITERS 8
+#define VICTIMS 3
+#define ROUNDS 5
+#define STALLERS 4
+
+static void usage (void)
+{
+  fprintf (stderr, "Usage: test-hangup [-t <type>] [-s <size>] "
+                   "[-i <toc cap>] <pool_name>\n");
+  exit (EXIT_FAILURE);
+}
+
+/// Runs in a child: awaits protein number \a idx, and says whether it
+/// got it.  Writes a byte to \a ready_fd once it's about to await.
+static int await_one (const char *pname, int64 idx, int ready_fd)
+{
+  pool_hose ph;
+  ob_retort pret = pool_participate (pname, &ph, NULL);
+  if (pret != OB_OK)
+    {
+      OB_LOG_ERROR_CODE (0x20418000, "no can participate %s: %s\n", pname,
+                         ob_error_string (pret));
+      return EXIT_FAILURE;
+    }
+  OB_DIE_ON_ERROR (pool_seekto (ph, idx));
+  if (write (ready_fd, "r", 1) != 1)
+    return EXIT_FAILURE;
+
+  protein p = NULL;
+  int64 got = -1;
+  pret = pool_await_next (ph, 30, &p, NULL, &got);
+  if (pret != OB_OK)
+    {
+      OB_LOG_ERROR_CODE (0x20418001, "pool_await_next returned %s\n",
+                         ob_error_string (pret));
+      return EXIT_FAILURE;
+    }
+  const int64 n = slaw_path_get_int64 (protein_ingests (p), "n", -1);
+  protein_free (p);
+  if (got != idx || n != idx)
+    {
+      OB_LOG_ERROR_CODE (0x20418002, "expected protein %" OB_FMT_64
+                                     "d but got %" OB_FMT_64
+                                     "d (n = %" OB_FMT_64 "d)\n",
+                         idx, got, n);
+      return EXIT_FAILURE;
+    }
+  OB_DIE_ON_ERROR (pool_withdraw (ph));
+  return EXIT_SUCCESS;
+}
+
+/// Runs in a child: joins the pool and leaves without a word.
+static int walk_out (const char *pname)
+{
+  pool_hose ph;
+  ob_retort pret = pool_participate (pname, &ph, NULL);
+  if (pret != OB_OK)
+    {
+      OB_LOG_ERROR_CODE (0x20418003, "no can participate %s: %s\n", pname,
+                         ob_error_string (pret));
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+static pid_t spawn_awaiter (const char *pname, int64 idx, int ready_fd)
+{
+  fflush (stdout);
+  fflush (stderr);
+  const pid_t pid = fork ();
+  if (pid < 0)
+    OB_FATAL_ERROR_CODE (0x20418004, "fork failed: %s\n", strerror (errno));
+  if (pid == 0)
+    _exit (ready_fd < 0 ? walk_out (pname) : await_one (pname, idx, ready_fd));
+  return pid;
+}
+
+static int reap (pid_t pid)
+{
+  int status = 0;
+  while (waitpid (pid, &status, 0) < 0)
+    if (errno != EINTR)
+      OB_FATAL_ERROR_CODE (0x20418005, "waitpid failed: %s\n",
+                           strerror (errno));
+  return status;
+}
+
+static void one_round (pool_hose ph, const char *pname, int64 idx)
+{
+  int fds[2];
+  if (pipe (fds) != 0)
+    OB_FATAL_ERROR_CODE (0x20418006, "pipe failed: %s\n", strerror (errno));
+
+  pid_t kids[AWAITERS];
+  int i;
+  for (i = 0; i < AWAITERS; i++)
+    kids[i] = spawn_awaiter (pname, idx, fds[1]);
+  for (i = 0; i < AWAITERS; i++)
+    {
+      char c;
+      if (read (fds[0], &c, 1) != 1)
+        OB_FATAL_ERROR_CODE (0x20418007, "awaiter %d never got ready\n", i);
+    }
+  close (fds[0]);
+  close (fds[1]);
+
+  // Give them time to really be waiting, then hang up some of them
+  OB_DIE_ON_ERROR (ob_micro_sleep (200000));
+  for (i = 0; i < VICTIMS; i++)
+    {
+      kill (kids[i], SIGKILL);
+      const int status = reap (kids[i]);
+      if (!WIFSIGNALED (status))
+        OB_FATAL_ERROR_CODE (0x20418008, "awaiter %d wasn't killed\n", i);
+    }
+  if (reap (spawn_awaiter (pname, idx, -1)) != 0)
+    OB_FATAL_ERROR_CODE (0x20418009, "walking out failed\n");
+
+  protein p =
+    protein_from_ff (slaw_list_inline_c ("hangup", NULL),
+                     slaw_map_inline_cf ("n", slaw_int64 (idx), NULL));
+  int64 dep = -1;
+  OB_DIE_ON_ERROR (pool_deposit (ph, p, &dep));
+  protein_free (p);
+  if (dep != idx)
+    OB_FATAL_ERROR_CODE (0x2041800a, "deposited at %" OB_FMT_64
+                                     "d, not %" OB_FMT_64 "d\n",
+                         dep, idx);
+
+  for (i = VICTIMS; i < AWAITERS; i++)
+    {
+      const int status = reap (kids[i]);
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != EXIT_SUCCESS)
+        OB_FATAL_ERROR_CODE (0x2041800b, "awaiter %d failed (status %d)\n", i,
+                             status);
+    }
+
+  // And the pool still works for the one who stayed
+  protein q = NULL;
+  int64 got = -1;
+  OB_DIE_ON_ERROR (pool_next (ph, &q, NULL, &got));
+  if (got != idx)
+    OB_FATAL_ERROR_CODE (0x2041800c, "pool_next got %" OB_FMT_64
+                                     "d, not %" OB_FMT_64 "d\n",
+                         got, idx);
+  protein_free (q);
+}
+
+/// Connects to the server for \a pname (which has to be a tcp:// or
+/// tcpo:// pool), and starts a command it never finishes.  Returns -1
+/// for a pool that isn't on a server.
+static int stall (const char *pname)
+{
+  const char *host = strstr (pname, "://");
+  if (!host || strncmp (pname, "tcp", 3) != 0)
+    return -1;
+  host += 3;
+  char hostname[256], port[16];
+  const size_t hlen = strcspn (host, ":/");
+  if (hlen >= sizeof (hostname))
+    OB_FATAL_ERROR_CODE (0x2041800f, "host name too long in %s\n", pname);
+  memcpy (hostname, host, hlen);
+  hostname[hlen] = 0;
+  snprintf (port, sizeof (port), "%d", POOL_TCP_PORT);
+  if (host[hlen] == ':')
+    snprintf (port, sizeof (port), "%d", atoi (host + hlen + 1));
+
+  struct addrinfo hint, *ai = NULL;
+  memset (&hint, 0, sizeof (hint));
+  hint.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo (hostname, port, &hint, &ai) != 0 || !ai)
+    OB_FATAL_ERROR_CODE (0x20418010, "can't look up %s\n", hostname);
+  const int fd = socket (ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if (fd < 0 || connect (fd, ai->ai_addr, ai->ai_addrlen) != 0)
+    OB_FATAL_ERROR_CODE (0x20418011, "can't connect to %s:%s: %s\n",
+                         hostname, port, strerror (errno));
+  freeaddrinfo (ai);
+  // The first three bytes of an eight byte length
+  const byte partial[3] = {0, 0, 0};
+  if (write (fd, partial, sizeof (partial)) != sizeof (partial))
+    OB_FATAL_ERROR_CODE (0x20418012, "write failed: %s\n", strerror (errno));
+  return fd;
+}
+
+/// With more clients stuck partway through a command than a worker
+/// thread pool server has workers, other clients still get served.
+static void stall_round (pool_hose ph, const char *pname, int64 idx)
+{
+  int fds[STALLERS];
+  int i;
+  for (i = 0; i < STALLERS; i++)
+    if ((fds[i] = stall (pname)) < 0)
+      return;
+
+  // Rather than hang, die
+  alarm (60);
+  int ready[2];
+  if (pipe (ready) != 0)
+    OB_FATAL_ERROR_CODE (0x20418013, "pipe failed: %s\n", strerror (errno));
+  const pid_t kid = spawn_awaiter (pname, idx, ready[1]);
+  char c;
+  if (read (ready[0], &c, 1) != 1)
+    OB_FATAL_ERROR_CODE (0x20418014, "awaiter never got ready\n");
+  close (ready[0]);
+  close (ready[1]);
+
+  protein p =
+    protein_from_ff (slaw_list_inline_c ("stalled", NULL),
+                     slaw_map_inline_cf ("n", slaw_int64 (idx), NULL));
+  int64 dep = -1;
+  OB_DIE_ON_ERROR (pool_deposit (ph, p, &dep));
+  protein_free (p);
+  if (dep != idx)
+    OB_FATAL_ERROR_CODE (0x20418015, "deposited at %" OB_FMT_64
+                                     "d, not %" OB_FMT_64 "d\n",
+                         dep, idx);
+  const int status = reap (kid);
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != EXIT_SUCCESS)
+    OB_FATAL_ERROR_CODE (0x20418016, "awaiter failed (status %d)\n", status);
+  protein q = NULL;
+  int64 got = -1;
+  OB_DIE_ON_ERROR (pool_next (ph, &q, NULL, &got));
+  if (got != idx)
+    OB_FATAL_ERROR_CODE (0x20418017, "pool_next got %" OB_FMT_64
+                                     "d, not %" OB_FMT_64 "d\n",
+                         got, idx);
+  protein_free (q);
+  alarm (0);
+
+  for (i = 0; i < STALLERS; i++)
+    close (fds[i]);
+}
+
+static int mainish (int argc, char **argv)
+{
+  pool_cmd_info cmd;
+  int c;
+
+  memset (&cmd, 0, sizeof (cmd));
+  while ((c = getopt (argc, argv, "i:s:t:")) != -1)
+    {
+      switch (c)
+        {
+          case 'i':
+            cmd.toc_capacity = strtoll (optarg, NULL, 0);
+            break;
+          case 's':
+            cmd.size = strtoll (optarg, NULL, 0);
+            break;
+          case 't':
+            cmd.type = optarg;
+            break;
+          default:
+            usage ();
+        }
+    }
+  pool_cmd_setup_options (&cmd);
+  if (pool_cmd_get_poolname (&cmd, argc, argv, optind))
+    usage ();
+
+  ob_retort pret = pool_participate_creatingly (cmd.pool_name, cmd.type,
+                                                &cmd.ph, cmd.create_options);
+  if (pret < 0)
+    OB_FATAL_ERROR_CODE (0x2041800d, "no can participate_creatingly %s: %s\n",
+                         cmd.pool_name, ob_error_string (pret));
+
+  int64 round;
+  for (round = 0; round < ROUNDS; round++)
+    one_round (cmd.ph, cmd.pool_name, round);
+  stall_round (cmd.ph, cmd.pool_name, round);
+
+  OB_DIE_ON_ERROR (pool_withdraw (cmd.ph));
+  pret = pool_dispose (cmd.pool_name);
+  if (pret != OB_OK)
+    OB_FATAL_ERROR_CODE (0x2041800e, "no can stop %s: %s\n", cmd.pool_name,
+                         ob_error_string (pret));
+
+  pool_cmd_free_options (&cmd);
+
+  return EXIT_SUCCESS;
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  return check_for_leaked_file_descriptors_scoped (mainish, argc, argv);
+}
@@ -0,0 +1,228 @@
+
+/* (c)  oblong industries */
+
+// Tests pool_hose_set_read_ahead(): with read-ahead on, pool_next()
+// and pool_await_next() hand out the same proteins, with the same
+// indexes, as without it, including after seeking around, when
+// proteins we'd like to read have been discarded, and when other
+// hoses deposit while we read.
+
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-vers.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define HOW_MANY 100
+#define WINDOW 16
+#define BIG_RUDE 50000
+
+static void usage (void)
+{
+  fprintf (stderr, "Usage: test-read-ahead [-t <type>] [-s <size>] "
+                   "[-i <toc cap>] <pool_name>\n");
+  exit (EXIT_FAILURE);
+}
+
+static protein make_protein (int64 n, int64 rude_len)
+{
+  void *rude = calloc (1, rude_len);
+  protein p = protein_from_ffr (slaw_list_inline_c ("ahead", NULL),
+                                slaw_map_inline_cf ("n", slaw_int64 (n), NULL),
+                                rude, rude_len);
+  free (rude);
+  return p;
+}
+
+static void deposit_some (pool_hose ph, int64 first, int64 count,
+                          int64 rude_len)
+{
+  int64 i;
+  for (i = first; i < first + count; i++)
+    {
+      protein p = make_protein (i, rude_len);
+      OB_DIE_ON_ERROR (pool_deposit (ph, p, NULL));
+      protein_free (p);
+    }
+}
+
+/// Reads with pool_next() until there's nothing left, checking that
+/// the proteins come out in order starting at \a first, and that
+/// the hose's index keeps up.  Returns how many were read.
+
+static int64 read_all (pool_hose ph, int64 first)
+{
+  int64 want = first;
+  protein p = NULL;
+  pool_timestamp ts = -1;
+  int64 idx = -1;
+  ob_retort pret;
+  while ((pret = pool_next (ph, &p, &ts, &idx)) == OB_OK)
+    {
+      const int64 n = slaw_path_get_int64 (protein_ingests (p), "n", -1);
+      if (idx != want || n != want)
+        OB_FATAL_ERROR_CODE (0x20417000, "expected protein %" OB_FMT_64
+                                         "d but got %" OB_FMT_64
+                                         "d at index %" OB_FMT_64 "d\n",
+                             want, n, idx);
+      if (ts <= 0)
+        OB_FATAL_ERROR_CODE (0x20417001, "bad timestamp %f for %" OB_FMT_64
+                                         "d\n",
+                             ts, idx);
+      protein_free (p);
+      int64 cur = -1;
+      OB_DIE_ON_ERROR (pool_index (ph, &cur));
+      if (cur != idx + 1)
+        OB_FATAL_ERROR_CODE (0x20417002, "index is %" OB_FMT_64
+                                         "d after reading %" OB_FMT_64 "d\n",
+                             cur, idx);
+      want++;
+    }
+  if (pret != POOL_NO_SUCH_PROTEIN)
+    OB_FATAL_ERROR_CODE (0x20417003, "pool_next returned %s\n",
+                         ob_error_string (pret));
+  return want - first;
+}
+
+static int mainish (int argc, char **argv)
+{
+  pool_cmd_info cmd;
+  int c;
+
+  memset (&cmd, 0, sizeof (cmd));
+  while ((c = getopt (argc, argv, "i:s:t:")) != -1)
+    {
+      switch (c)
+        {
+          case 'i':
+            cmd.toc_capacity = strtoll (optarg, NULL, 0);
+            break;
+          case 's':
+            cmd.size = strtoll (optarg, NULL, 0);
+            break;
+          case 't':
+            cmd.type = optarg;
+            break;
+          default:
+            usage ();
+        }
+    }
+  pool_cmd_setup_options (&cmd);
+  if (pool_cmd_get_poolname (&cmd, argc, argv, optind))
+    usage ();
+
+  ob_retort pret = pool_participate_creatingly (cmd.pool_name, cmd.type,
+                                                &cmd.ph, cmd.create_options);
+  if (pret < 0)
+    OB_FATAL_ERROR_CODE (0x20417004, "no can participate_creatingly %s: %s\n",
+                         cmd.pool_name, ob_error_string (pret));
+
+  pret = pool_hose_set_read_ahead (cmd.ph, -1, 0);
+  if (pret != OB_INVALID_ARGUMENT)
+    OB_FATAL_ERROR_CODE (0x20417005, "expected OB_INVALID_ARGUMENT, got %s\n",
+                         ob_error_string (pret));
+  OB_DIE_ON_ERROR (pool_hose_set_read_ahead (cmd.ph, WINDOW, 0));
+
+  // An empty pool, then one with something in it
+  int64 got = read_all (cmd.ph, 0);
+  if (got != 0)
+    OB_FATAL_ERROR_CODE (0x20417006, "read %" OB_FMT_64 "d from empty pool\n",
+                         got);
+  deposit_some (cmd.ph, 0, HOW_MANY, 8);
+  got = read_all (cmd.ph, 0);
+  if (got != HOW_MANY)
+    OB_FATAL_ERROR_CODE (0x20417007, "read %" OB_FMT_64 "d of %d\n", got,
+                         HOW_MANY);
+
+  // Reading again after more arrive, or after seeking around, in the
+  // middle of what was read ahead
+  deposit_some (cmd.ph, HOW_MANY, 3, 8);
+  got = read_all (cmd.ph, HOW_MANY);
+  if (got != 3)
+    OB_FATAL_ERROR_CODE (0x20417008, "read %" OB_FMT_64 "d of 3\n", got);
+  OB_DIE_ON_ERROR (pool_seekto (cmd.ph, 10));
+  protein p = NULL;
+  int64 idx = -1;
+  OB_DIE_ON_ERROR (pool_next (cmd.ph, &p, NULL, &idx));
+  protein_free (p);
+  OB_DIE_ON_ERROR (pool_seekto (cmd.ph, 5));
+  OB_DIE_ON_ERROR (pool_next (cmd.ph, &p, NULL, &idx));
+  if (idx != 5)
+    OB_FATAL_ERROR_CODE (0x20417009, "seeking back got %" OB_FMT_64 "d\n",
+                         idx);
+  protein_free (p);
+  OB_DIE_ON_ERROR (pool_seekto (cmd.ph, 12));
+  OB_DIE_ON_ERROR (pool_next (cmd.ph, NULL, NULL, &idx));
+  if (idx != 12)
+    OB_FATAL_ERROR_CODE (0x2041700a, "seeking ahead got %" OB_FMT_64 "d\n",
+                         idx);
+  got = read_all (cmd.ph, 13);
+  if (got != HOW_MANY + 3 - 13)
+    OB_FATAL_ERROR_CODE (0x2041700b, "read %" OB_FMT_64 "d after seeking\n",
+                         got);
+
+  // Somebody else laps us, so we skip ahead to the oldest protein
+  pool_hose other = NULL;
+  OB_DIE_ON_ERROR (pool_participate (cmd.pool_name, &other, NULL));
+  int64 oldest = 0;
+  int64 next = HOW_MANY + 3;
+  while (oldest < 2)
+    {
+      deposit_some (other, next++, 1, BIG_RUDE);
+      OB_DIE_ON_ERROR (pool_oldest_index (other, &oldest));
+    }
+  OB_DIE_ON_ERROR (pool_seekto (cmd.ph, oldest - 2));
+  got = read_all (cmd.ph, oldest);
+  if (got != next - oldest)
+    OB_FATAL_ERROR_CODE (0x2041700c, "read %" OB_FMT_64 "d of %" OB_FMT_64
+                                     "d after being lapped\n",
+                         got, next - oldest);
+
+  // Again, with a byte limit smaller than one protein
+  OB_DIE_ON_ERROR (pool_hose_set_read_ahead (cmd.ph, WINDOW, 1000));
+  OB_DIE_ON_ERROR (pool_rewind (cmd.ph));
+  got = read_all (cmd.ph, oldest);
+  if (got != next - oldest)
+    OB_FATAL_ERROR_CODE (0x20417010, "read %" OB_FMT_64 "d of %" OB_FMT_64
+                                     "d with a byte limit\n",
+                         got, next - oldest);
+
+  // And awaiting works as it always did
+  deposit_some (other, next, 2, 8);
+  OB_DIE_ON_ERROR (pool_withdraw (other));
+  int64 i;
+  for (i = next; i < next + 2; i++)
+    {
+      pret = pool_await_next (cmd.ph, 60, &p, NULL, &idx);
+      if (pret != OB_OK || idx != i)
+        OB_FATAL_ERROR_CODE (0x2041700d, "pool_await_next got %" OB_FMT_64
+                                         "d: %s\n",
+                             idx, ob_error_string (pret));
+      protein_free (p);
+    }
+  pret = pool_await_next (cmd.ph, 0.1, &p, NULL, &idx);
+  if (pret != POOL_AWAIT_TIMEDOUT)
+    OB_FATAL_ERROR_CODE (0x2041700e, "expected timeout, got %s\n",
+                         ob_error_string (pret));
+
+  OB_DIE_ON_ERROR (pool_withdraw (cmd.ph));
+  pret = pool_dispose (cmd.pool_name);
+  if (pret != OB_OK)
+    OB_FATAL_ERROR_CODE (0x2041700f, "no can stop %s: %s\n", cmd.pool_name,
+                         ob_error_string (pret));
+
+  pool_cmd_free_options (&cmd);
+
+  return EXIT_SUCCESS;
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  return check_for_leaked_file_descriptors_scoped (mainish, argc, argv);
+}
@@ -0,0 +1,193 @@
+
+/* (c)  oblong industries */
+
+// Tests pool_nth_protein_view() and pool_next_view(): the proteins
+// they lend out are the ones that were deposited, and once the pool
+// wraps around over a borrowed protein, pool_view_check() says so
+// (for local pools; remote ones lend out copies, which stay good).
+
+#include "libPlasma/c/pool_cmd.h"
+#include "libPlasma/c/protein.h"
+#include "libPlasma/c/slaw.h"
+#include "libPlasma/c/slaw-path.h"
+#include "libLoam/c/ob-log.h"
+#include "libLoam/c/ob-vers.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define HOW_MANY 10
+#define NKEYS 40
+#define BIG_RUDE 100000
+
+static void usage (void)
+{
+  fprintf (stderr, "Usage: test-view [-t <type>] [-s <size>] [-i <toc cap>] "
+                   "<pool_name>\n");
+  exit (EXIT_FAILURE);
+}
+
+/// Enough ingests that looking them up builds a hash index (see
+/// slaw-map-index.c), which mustn't be used for whatever turns up at
+/// the same address after release.
+
+static protein make_protein (int64 n, int64 rude_len)
+{
+  slabu *sb = slabu_new ();
+  char key[32];
+  int64 i;
+  for (i = 0; i < NKEYS; i++)
+    {
+      snprintf (key, sizeof (key), "key-%" OB_FMT_64 "d", i);
+      slabu_map_put_cf (sb, key, slaw_int64 (n * 1000 + i));
+    }
+  void *rude = calloc (1, rude_len);
+  protein p = protein_from_ffr (slaw_list_inline_c ("view", NULL),
+                                slaw_map_f (sb), rude, rude_len);
+  free (rude);
+  return p;
+}
+
+static void check_view (pool_hose ph, const pool_protein_view *view, int64 n)
+{
+  if (view->idx != n)
+    OB_FATAL_ERROR_CODE (0x20416000, "expected index %" OB_FMT_64
+                                     "d but got %" OB_FMT_64 "d\n",
+                         n, view->idx);
+  bslaw ing = protein_ingests (view->p);
+  int pass;
+  for (pass = 0; pass < 2; pass++)
+    {
+      int64 i;
+      for (i = 0; i < NKEYS; i++)
+        {
+          char key[32];
+          snprintf (key, sizeof (key), "key-%" OB_FMT_64 "d", i);
+          if (slaw_path_get_int64 (ing, key, -1) != n * 1000 + i)
+            OB_FATAL_ERROR_CODE (0x20416001, "protein %" OB_FMT_64
+                                             "d has the wrong %s\n",
+                                 n, key);
+        }
+    }
+  ob_retort pret = pool_view_check (ph, view);
+  if (pret != OB_OK)
+    OB_FATAL_ERROR_CODE (0x20416002, "view of %" OB_FMT_64 "d went bad: %s\n",
+                         n, ob_error_string (pret));
+}
+
+static int mainish (int argc, char **argv)
+{
+  pool_cmd_info cmd;
+  int c;
+
+  memset (&cmd, 0, sizeof (cmd));
+  while ((c = getopt (argc, argv, "i:s:t:")) != -1)
+    {
+      switch (c)
+        {
+          case 'i':
+            cmd.toc_capacity = strtoll (optarg, NULL, 0);
+            break;
+          case 's':
+            cmd.size = strtoll (optarg, NULL, 0);
+            break;
+          case 't':
+            cmd.type = optarg;
+            break;
+          default:
+            usage ();
+        }
+    }
+  pool_cmd_setup_options (&cmd);
+  if (pool_cmd_get_poolname (&cmd, argc, argv, optind))
+    usage ();
+
+  ob_retort pret = pool_participate_creatingly (cmd.pool_name, cmd.type,
+                                                &cmd.ph, cmd.create_options);
+  if (pret < 0)
+    OB_FATAL_ERROR_CODE (0x20416003, "no can participate_creatingly %s: %s\n",
+                         cmd.pool_name, ob_error_string (pret));
+
+  int64 i;
+  for (i = 0; i < HOW_MANY; i++)
+    {
+      protein p = make_protein (i, 8);
+      OB_DIE_ON_ERROR (pool_deposit (cmd.ph, p, NULL));
+      protein_free (p);
+    }
+
+  const bool local = (strstr (cmd.pool_name, "://") == NULL);
+  pool_protein_view view;
+
+  // Random access
+  for (i = HOW_MANY - 1; i >= 0; i--)
+    {
+      OB_DIE_ON_ERROR (pool_nth_protein_view (cmd.ph, i, &view));
+      if (local && view.copy)
+        OB_FATAL_ERROR_CODE (0x20416004, "local pool lent out a copy\n");
+      check_view (cmd.ph, &view, i);
+      OB_DIE_ON_ERROR (pool_view_release (cmd.ph, &view));
+    }
+  pret = pool_nth_protein_view (cmd.ph, HOW_MANY, &view);
+  if (pret != POOL_NO_SUCH_PROTEIN || view.p)
+    OB_FATAL_ERROR_CODE (0x20416005, "expected no protein, got %s\n",
+                         ob_error_string (pret));
+
+  // Sequential access
+  OB_DIE_ON_ERROR (pool_rewind (cmd.ph));
+  for (i = 0; i < HOW_MANY; i++)
+    {
+      OB_DIE_ON_ERROR (pool_next_view (cmd.ph, &view));
+      check_view (cmd.ph, &view, i);
+      OB_DIE_ON_ERROR (pool_view_release (cmd.ph, &view));
+    }
+  pret = pool_next_view (cmd.ph, &view);
+  if (pret != POOL_NO_SUCH_PROTEIN)
+    OB_FATAL_ERROR_CODE (0x20416006, "expected no protein, got %s\n",
+                         ob_error_string (pret));
+
+  // Hang on to the oldest protein while another hose laps us
+  OB_DIE_ON_ERROR (pool_nth_protein_view (cmd.ph, 0, &view));
+  pool_hose other = NULL;
+  OB_DIE_ON_ERROR (pool_participate (cmd.pool_name, &other, NULL));
+  int64 oldest = 0;
+  for (i = HOW_MANY; oldest == 0; i++)
+    {
+      protein p = make_protein (i, BIG_RUDE);
+      OB_DIE_ON_ERROR (pool_deposit (other, p, NULL));
+      protein_free (p);
+      OB_DIE_ON_ERROR (pool_oldest_index (other, &oldest));
+    }
+  OB_DIE_ON_ERROR (pool_withdraw (other));
+
+  pret = pool_view_release (cmd.ph, &view);
+  if (pret != (local ? POOL_NO_SUCH_PROTEIN : OB_OK))
+    OB_FATAL_ERROR_CODE (0x20416007, "lapped view was %s\n",
+                         ob_error_string (pret));
+
+  // And pool_next_view() skips ahead past what's gone
+  OB_DIE_ON_ERROR (pool_rewind (cmd.ph));
+  OB_DIE_ON_ERROR (pool_next_view (cmd.ph, &view));
+  if (view.idx != oldest)
+    OB_FATAL_ERROR_CODE (0x20416008, "expected oldest index %" OB_FMT_64
+                                     "d but got %" OB_FMT_64 "d\n",
+                         oldest, view.idx);
+  OB_DIE_ON_ERROR (pool_view_release (cmd.ph, &view));
+
+  OB_DIE_ON_ERROR (pool_withdraw (cmd.ph));
+  pret = pool_dispose (cmd.pool_name);
+  if (pret != OB_OK)
+    OB_FATAL_ERROR_CODE (0x20416009, "no can stop %s: %s\n", cmd.pool_name,
+                         ob_error_string (pret));
+
+  pool_cmd_free_options (&cmd);
+
+  return EXIT_SUCCESS;
+}
+
+int main (int argc, char **argv)
+{
+  OB_DIE_ON_ERROR (OB_CHECK_ABI ());
+
+  return check_for_leaked_file_descriptors_scoped (mainish, argc, argv);
+}